@@ -135,6 +135,7 @@ int main(int argc, char *argv[]) {
         else if (argv[i][0] == '-' && argv[i][1] == 't') texture.flags.tile = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'm') texture.flags.mipmap = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'w') texture.flags.wrap = true;
+        else if (argv[i][0] == '-' && argv[i][1] == 's') texture.flags.swizzle = true;
         else return 0;
     }
 
@@ -162,29 +163,33 @@ int main(int argc, char *argv[]) {
     for (u16 i = 0; i < texture.mip_count; i++, mip++, loader_mip++) {
         mip->width  = loader_mip->width;
         mip->height = loader_mip->height;
-        mip->texel_quads = new TexelQuad[(mip->width + 1) * (mip->height + 1)];
+        mip->texel_quads = new TexelQuad[TextureMip::GetQuadCount(mip->width, mip->height, texture.texelLayout())]();
 
-        TexelQuad *texel_quad = mip->texel_quads;
+        // Quads get converted in rows, and stored in rows or in tiles (see TexelLayout):
         PixelQuad *loader_texel_quad = loader_mip->texel_quads;
-        u32 texel_quads_count = (u32)(mip->width + 1) * (u32)(mip->height + 1);
-        for (u32 t = 0; t < texel_quads_count; t++, texel_quad++, loader_texel_quad++) {
-            texel_quad->R.TL = (u8)(loader_texel_quad->TL.color.r * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->G.TL = (u8)(loader_texel_quad->TL.color.g * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->B.TL = (u8)(loader_texel_quad->TL.color.b * FLOAT_TO_COLOR_COMPONENT);
-
-            texel_quad->R.TR = (u8)(loader_texel_quad->TR.color.r * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->G.TR = (u8)(loader_texel_quad->TR.color.g * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->B.TR = (u8)(loader_texel_quad->TR.color.b * FLOAT_TO_COLOR_COMPONENT);
-
-            texel_quad->R.BL = (u8)(loader_texel_quad->BL.color.r * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->G.BL = (u8)(loader_texel_quad->BL.color.g * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->B.BL = (u8)(loader_texel_quad->BL.color.b * FLOAT_TO_COLOR_COMPONENT);
-
-            texel_quad->R.BR = (u8)(loader_texel_quad->BR.color.r * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->G.BR = (u8)(loader_texel_quad->BR.color.g * FLOAT_TO_COLOR_COMPONENT);
-            texel_quad->B.BR = (u8)(loader_texel_quad->BR.color.b * FLOAT_TO_COLOR_COMPONENT);
-
-        }
+        u32 stride = mip->width + 1;
+        for (u32 y = 0; y <= mip->height; y++)
+            for (u32 x = 0; x < stride; x++, loader_texel_quad++) {
+                TexelQuad *texel_quad = mip->texel_quads + (texture.flags.swizzle ?
+                        TextureMip::GetQuadIndex<TexelLayoutTiles>(x, y, stride) :
+                        TextureMip::GetQuadIndex(x, y, stride));
+
+                texel_quad->R.TL = (u8)(loader_texel_quad->TL.color.r * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->G.TL = (u8)(loader_texel_quad->TL.color.g * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->B.TL = (u8)(loader_texel_quad->TL.color.b * FLOAT_TO_COLOR_COMPONENT);
+
+                texel_quad->R.TR = (u8)(loader_texel_quad->TR.color.r * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->G.TR = (u8)(loader_texel_quad->TR.color.g * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->B.TR = (u8)(loader_texel_quad->TR.color.b * FLOAT_TO_COLOR_COMPONENT);
+
+                texel_quad->R.BL = (u8)(loader_texel_quad->BL.color.r * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->G.BL = (u8)(loader_texel_quad->BL.color.g * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->B.BL = (u8)(loader_texel_quad->BL.color.b * FLOAT_TO_COLOR_COMPONENT);
+
+                texel_quad->R.BR = (u8)(loader_texel_quad->BR.color.r * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->G.BR = (u8)(loader_texel_quad->BR.color.g * FLOAT_TO_COLOR_COMPONENT);
+                texel_quad->B.BR = (u8)(loader_texel_quad->BR.color.b * FLOAT_TO_COLOR_COMPONENT);
+            }
     }
 
     save(texture, texture_file_path);
@@ -1,7 +1,8 @@
 #include "../slim/draw/circle.h"
 #include "../slim/draw/rectangle.h"
-#include "../slim/draw/texture.h"
+#include "../slim/draw/sprites.h"
 #include "../slim/serialization/texture.h"
+#include "../slim/core/jobs.h"
 #include "../slim/app.h"
 
 // Or using the single-header file:
@@ -65,6 +66,7 @@ struct TileMapApp : SlimApp {
     }
 
     Canvas canvas;
+    SpriteBatch sprites;
 
     char* floor_texture_file_name = (char*)"floor.texture";
     char* wall_texture_file_name = (char*)"wall.texture";
@@ -206,54 +208,62 @@ struct TileMapApp : SlimApp {
 
     void OnRender() override {
         canvas.clear();
+        // Tiles are drawn as a batch of sprites, culled, grouped by texture and drawn tile by tile in parallel:
         for (int y = 0; y < row_count; y++) {
             for (int x = 0; x < column_count; x++)
-                drawTexture(map[y][x].is_full ? wall_texture : floor_texture, canvas, RectI{
-                        pixelOfTileX((float)x),
-                        pixelOfTileX((float)(x + 1)),
-                        pixelOfTileY((float)y),
-                        pixelOfTileY((float)(y + 1))
-                }, false);
+                sprites.add(map[y][x].is_full ? wall_texture : floor_texture, Rect{
+                        (float)x * pixels_per_tile + pan_x,
+                        (float)(x + 1) * pixels_per_tile + pan_x,
+                        (float)y * pixels_per_tile + pan_y,
+                        (float)(y + 1) * pixels_per_tile + pan_y
+                });
         }
+        sprites.draw(canvas);
 
         if (lights_count) {
-            for (int y = 0; y < canvas.dimensions.height; y++) {
-                for (int x = 0; x < canvas.dimensions.width; x++) {
-                    float X = tileOfPixelX(x);
-                    float Y = tileOfPixelY(y);
-                    if (isOutOfBounds(X, Y) || map[(int)Y][(int)X].is_full)
-                        continue;
-
-                    Color accumulated_light;
-                    for (int l = 0; l < lights_count; l++) {
-                        Light &light = lights[l];
-
-                        float circle_fraction = getCircleFraction(light.pos_x - X,
-                                                                  light.pos_y - Y);
-                        int first_index = 1 + (int)((circle_fraction + 0.25f) * light_points_count);
-                        int last_index = first_index + (light_points_count / 2);
-                        int lit_point_count = 0;
-                        for (int i = first_index; i < last_index; i++) {
-                            float lightPointX = light.pos_x + light_points[i % light_points_count].X;
-                            float lightPointY = light.pos_y + light_points[i % light_points_count].Y;
-
-                            if (!inShadow(lightPointX, lightPointY, X, Y))
-                                lit_point_count++;
-                        }
-                        if (lit_point_count == 0)
+            // Lighting is computed per pixel independently, so tiles of the canvas are lit in parallel:
+            RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+            parallelFor2D(bounds, 64, 64, [&](const RectI &tile) {
+                // Pixels are written directly (rather than drawn), so the tile needs to be resolved:
+                canvas.markDirty(tile);
+                for (int y = tile.top; y <= tile.bottom; y++) {
+                    for (int x = tile.left; x <= tile.right; x++) {
+                        float X = tileOfPixelX(x);
+                        float Y = tileOfPixelY(y);
+                        if (isOutOfBounds(X, Y) || map[(int)Y][(int)X].is_full)
                             continue;
 
-                        float dX = light.pos_x - X;
-                        float dY = light.pos_y - Y;
-                        float squared_distance = dX*dX + dY*dY;
-
-                        accumulated_light += light.color * ((light.intensity / squared_distance
-                                ) * ((float)lit_point_count / (float)(light_points_count / 2)));
+                        Color accumulated_light;
+                        for (int l = 0; l < lights_count; l++) {
+                            Light &light = lights[l];
+
+                            float circle_fraction = getCircleFraction(light.pos_x - X,
+                                                                      light.pos_y - Y);
+                            int first_index = 1 + (int)((circle_fraction + 0.25f) * light_points_count);
+                            int last_index = first_index + (light_points_count / 2);
+                            int lit_point_count = 0;
+                            for (int i = first_index; i < last_index; i++) {
+                                float lightPointX = light.pos_x + light_points[i % light_points_count].X;
+                                float lightPointY = light.pos_y + light_points[i % light_points_count].Y;
+
+                                if (!inShadow(lightPointX, lightPointY, X, Y))
+                                    lit_point_count++;
+                            }
+                            if (lit_point_count == 0)
+                                continue;
+
+                            float dX = light.pos_x - X;
+                            float dY = light.pos_y - Y;
+                            float squared_distance = dX*dX + dY*dY;
+
+                            accumulated_light += light.color * ((light.intensity / squared_distance
+                                    ) * ((float)lit_point_count / (float)(light_points_count / 2)));
+                        }
+                        Pixel &pixel = canvas.pixels[canvas.dimensions.width * y + x];
+                        pixel.color = (pixel.color * accumulated_light).clamped();
                     }
-                    Pixel &pixel = canvas.pixels[canvas.dimensions.width * y + x];
-                    pixel.color = (pixel.color * accumulated_light).clamped();
                 }
-            }
+            });
 
             float X = tileOfPixelX(mouse::pos_x);
             float Y = tileOfPixelY(mouse::pos_y);
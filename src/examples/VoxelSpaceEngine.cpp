@@ -8,6 +8,7 @@
 #include "../slim/draw/image.h"
 #include "../slim/serialization/image.h"
 #include "../slim/serialization/texture.h"
+#include "../slim/core/jobs.h"
 #include "../slim/app.h"
 
 // Or using the single-header file:
@@ -122,72 +123,104 @@ struct App : SlimApp {
             }
         }
 
+        // The terrain gets marched with texture sampling specialized on how the textures' texel quads are laid out:
+        if (height_texture.flags.swizzle) {
+            if (color_texture.flags.swizzle) renderTerrain<TexelLayoutTiles, TexelLayoutTiles>();
+            else                             renderTerrain<TexelLayoutTiles, TexelLayoutRows>();
+        } else {
+            if (color_texture.flags.swizzle) renderTerrain<TexelLayoutRows, TexelLayoutTiles>();
+            else                             renderTerrain<TexelLayoutRows, TexelLayoutRows>();
+        }
+
+        // Pixels were written directly (rather than drawn), so the whole canvas needs to be resolved:
+        canvas.markDirty();
+        canvas.drawToWindow();
+    }
+
+    // Rays march diagonally across the height and color maps, so tiled texel quads keep more of their samples in cache:
+    template <TexelLayout HEIGHT_LAYOUT, TexelLayout COLOR_LAYOUT>
+    void renderTerrain() {
         ByteColor* heights = height_map.content;
         ByteColor* colors = color_map.content;
-        ByteColor color;
 
         i32 Hh = height_map.height;
         i32 Hw = height_map.width;
         i32 Ch = color_map.height;
         i32 Cw = color_map.width;
-        f32 u, v;
 
-        vec2 column = far_left;
         vec2 column_step = (far_right - far_left) / (f32)canvas.dimensions.width;// * (canvas.dimensions.f_width / (2 * far_distance));
-        vec2 step, current;
-        i32 X, Y;
-        f32 max_projected_elevation, projected_elevation, sampled_elevation;
-        for (u16 x = 0; x < canvas.dimensions.width; x++) {
-            max_projected_elevation = 0;
-            step = (column - position) / (f32)far_distance;
-            current = position;
-            for (u16 z = 1; z <= far_distance; z++) {
-                if (use_images) {
-                    X = (i32)current.x;
-                    Y = (i32)current.y;
-                    if (X < 0 || X >= Hw) X = (X + 100 * Hw) % Hw;
-                    if (Y < 0 || Y >= Hh) Y = (Y + 100 * Hh) % Hh;
-                    color = heights[Hw * Y + X];
-                } else {
-                    u = current.x / Hw;
-                    v = current.y / Hh;
-                    if (u < 0) u += 100.0f;
-                    if (u > 1) u -= (f32) ((i32) u);
-                    if (v < 0) v += 100.0f;
-                    if (v > 1) v -= (f32) ((i32) v);
-                    color = height_texture.mips[0].sample(u, v).color.toByteColor();
-                }
-                sampled_elevation = (f32)color.R * 50.0f;// - (vertical_aim * 10.0f * z);
-                projected_elevation = ((f32)sampled_elevation - elevation) / (f32)z - vertical_aim*10.f;
-                if (projected_elevation > max_projected_elevation) {
+
+        // Each column of the terrain is ray-marched independently, so strips of columns are rendered in parallel:
+        RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+        parallelFor2D(bounds, 16, canvas.dimensions.height, [&](const RectI &tile) {
+            ByteColor color;
+            f32 u, v;
+            vec2 step, current;
+            i32 X, Y;
+            f32 max_projected_elevation, projected_elevation, sampled_elevation;
+            f32 us[8], vs[8];
+            Pixel height_samples[8];
+            vec2 column = column_step.scaleAdd((f32)tile.left, far_left);
+            for (i32 x = tile.left; x <= tile.right; x++) {
+                max_projected_elevation = 0;
+                step = (column - position) / (f32)far_distance;
+                current = position;
+                for (u16 z = 1; z <= far_distance; z++) {
                     if (use_images) {
-                        X = (i32)current.x * 2;
-                        Y = (i32)current.y * 2;
-                        if (X < 0 || X >= Cw) X = (X + 100 * Cw) % Cw;
-                        if (Y < 0 || Y >= Ch) Y = (Y + 100 * Ch) % Ch;
-                        color = colors[Cw * Y + X];
+                        X = (i32)current.x;
+                        Y = (i32)current.y;
+                        if (X < 0 || X >= Hw) X = (X + 100 * Hw) % Hw;
+                        if (Y < 0 || Y >= Hh) Y = (Y + 100 * Hh) % Hh;
+                        color = heights[Hw * Y + X];
                     } else {
-                        u = current.x * 2.0f / Cw;
-                        v = current.y * 2.0f / Ch;
-                        if (u < 0) u += 100.0f; if (u > 1) u -= (f32)((i32)u);
-                        if (v < 0) v += 100.0f; if (v > 1) v -= (f32)((i32)v);
-                        color  = color_texture.mips[1].sample(u, v).color.toByteColor();
+                        // Heights are sampled 8 steps ahead at a time, in one packet:
+                        u32 lane = (u32)(z - 1) & 7;
+                        if (!lane) {
+                            vec2 ahead = current;
+                            for (u32 i = 0; i < 8; i++, ahead += step) {
+                                u = ahead.x / Hw;
+                                v = ahead.y / Hh;
+                                if (u < 0) u += 100.0f;
+                                if (u > 1) u -= (f32) ((i32) u);
+                                if (v < 0) v += 100.0f;
+                                if (v > 1) v -= (f32) ((i32) v);
+                                us[i] = u;
+                                vs[i] = v;
+                            }
+                            height_texture.mips[0].sample8<HEIGHT_LAYOUT>(us, vs, height_samples);
+                        }
+                        color = height_samples[lane].color.toByteColor();
                     }
-
-                    for (i32 y = (i32)max_projected_elevation; y < (i32)projected_elevation; y++) {
-                        if (y >= 0 && y < canvas.dimensions.height)
-                            canvas.pixels[(canvas.dimensions.height - y) * canvas.dimensions.width + x].color = color;
+                    sampled_elevation = (f32)color.R * 50.0f;// - (vertical_aim * 10.0f * z);
+                    projected_elevation = ((f32)sampled_elevation - elevation) / (f32)z - vertical_aim*10.f;
+                    if (projected_elevation > max_projected_elevation) {
+                        if (use_images) {
+                            X = (i32)current.x * 2;
+                            Y = (i32)current.y * 2;
+                            if (X < 0 || X >= Cw) X = (X + 100 * Cw) % Cw;
+                            if (Y < 0 || Y >= Ch) Y = (Y + 100 * Ch) % Ch;
+                            color = colors[Cw * Y + X];
+                        } else {
+                            u = current.x * 2.0f / Cw;
+                            v = current.y * 2.0f / Ch;
+                            if (u < 0) u += 100.0f; if (u > 1) u -= (f32)((i32)u);
+                            if (v < 0) v += 100.0f; if (v > 1) v -= (f32)((i32)v);
+                            color  = color_texture.mips[1].sample<COLOR_LAYOUT>(u, v).color.toByteColor();
+                        }
+
+                        for (i32 y = (i32)max_projected_elevation; y < (i32)projected_elevation; y++) {
+                            if (y >= 0 && y < canvas.dimensions.height)
+                                canvas.pixels[(canvas.dimensions.height - y) * canvas.dimensions.width + x].color = color;
+                        }
+
+                        max_projected_elevation = projected_elevation;
                     }
 
-                    max_projected_elevation = projected_elevation;
+                    current += step;
                 }
-
-                current += step;
+                column += column_step;
             }
-            column += column_step;
-        }
-
-        canvas.drawToWindow();
+        });
     }
 
     void OnKeyChanged(u8 key, bool is_pressed) override {
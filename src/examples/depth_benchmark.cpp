@@ -0,0 +1,135 @@
+#define SLIMMER
+
+#include "../slim/math/vec2.h"
+#include "../slim/draw/line.h"
+#include "../slim/draw/triangle.h"
+#include "../slim/draw/rectangle.h"
+#include "../slim/core/string.h"
+#include "../slim/app.h"
+// Or using the single-header file:
+//#include "../slim.h"
+
+// Times drawing layers of depth-tested 3D lines interleaved with opaque (and translucent) panels,
+// with the per-tile min/max depths letting lines skip tiles hidden behind the panels, against drawing it without them,
+// and checks that both produce exactly the same content.
+// Average microseconds per frame are reported in the window title (printed on exit when headless).
+// Press 'Q' to cycle through NoAA, SSAA and MSAA.
+
+#define LAYER_COUNT 8
+#define LINES_PER_LAYER 3000
+
+struct DepthBenchmarkApp : SlimApp {
+    Canvas canvas;
+    u32 *reference_content = (u32*)os::getMemory(WINDOW_CONTENT_SIZE);
+
+    u64 coarse_depth_ticks = 0;
+    u64 no_coarse_depth_ticks = 0;
+    u32 frame_count = 0;
+    bool bit_identical = true;
+
+    char title_buffer[256];
+    String title{title_buffer, 0};
+
+    void OnWindowResize(u16 width, u16 height) override {
+        canvas.dimensions.update(width, height);
+        resetResults();
+    }
+
+    void OnKeyChanged(u8 key, bool is_pressed) override {
+        if (!is_pressed && key == 'Q') {
+            canvas.antialias = canvas.antialias == NoAA ? SSAA : (canvas.antialias == SSAA ? MSAA : NoAA);
+            resetResults();
+        }
+    }
+
+    void OnRender() override {
+        u32 content_size = (u32)window::width * (u32)window::height;
+
+        canvas.clear();
+        u64 ticks_before = timers::getTicks();
+        drawScene();
+        coarse_depth_ticks += timers::getTicks() - ticks_before;
+        canvas.drawToWindow();
+        for (u32 i = 0; i < content_size; i++)
+            reference_content[i] = window::content[i];
+
+        // Without per-tile depths every pixel of every line gets depth-tested against the canvas depths:
+        f32 *tile_min_depths = canvas.tile_min_depths;
+        f32 *tile_max_depths = canvas.tile_max_depths;
+        canvas.tile_min_depths = canvas.tile_max_depths = nullptr;
+        canvas.clear();
+        ticks_before = timers::getTicks();
+        drawScene();
+        no_coarse_depth_ticks += timers::getTicks() - ticks_before;
+        canvas.tile_min_depths = tile_min_depths;
+        canvas.tile_max_depths = tile_max_depths;
+        canvas.drawToWindow();
+        for (u32 i = 0; i < content_size; i++)
+            if (window::content[i] != reference_content[i]) {
+                bit_identical = false;
+                break;
+            }
+
+        frame_count++;
+        updateTitle();
+    }
+
+    // Each layer scatters pseudo-random lines at pseudo-random depths, then covers parts of the window with panels.
+    // Panels carry no depth so they end up in front of the lines drawn so far, hiding the tiles they fully cover from later ones:
+    void drawScene() {
+        u32 state = 0x9E3779B9;
+        auto random = [&]() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return (f32)(state & 0xFFFF) / 65535.0f;
+        };
+
+        f32 width = canvas.dimensions.f_width;
+        f32 height = canvas.dimensions.f_height;
+        for (u32 layer = 0; layer < LAYER_COUNT; layer++) {
+            for (u32 i = 0; i < LINES_PER_LAYER; i++) {
+                f32 x = random() * width;
+                f32 y = random() * height;
+                f32 z = 0.5f + random() * 100.0f;
+                canvas.drawLine(x, y, z, x + random() * 200.0f - 100.0f, y + random() * 200.0f - 100.0f, z + random() * 20.0f,
+                                Color(random(), random(), random()), random() < 0.5f ? 1.0f : 0.6f, (u8)(i % 2));
+            }
+
+            f32 x = random() * width * 0.5f;
+            f32 y = random() * height * 0.5f;
+            canvas.fillRect(RectI{(i32)x, (i32)(x + width * 0.5f), (i32)y, (i32)(y + height * 0.5f)}, Color(random(), random(), random()));
+            canvas.fillTriangle(random() * width, random() * height, random() * width, random() * height, random() * width, random() * height,
+                                Color(random(), random(), random()), layer % 2 ? 1.0f : 0.5f);
+            x = random() * width * 0.5f;
+            y = random() * height * 0.5f;
+            canvas.fillRect(Rect{x, x + 200.3f, y, y + 150.7f}, Color(random(), random(), random()));
+        }
+    }
+
+    void appendResult(const char *label, u64 ticks) {
+        NumberString number;
+        number = (i32)(timers::microseconds_per_tick * (f64)ticks / (f64)frame_count);
+        title.copyFrom((char*)label, title.length);
+        title.copyFrom(number.string.char_ptr, title.length);
+        title.copyFrom((char*)"us", title.length);
+    }
+
+    void updateTitle() {
+        title.copyFrom((char*)(canvas.antialias == SSAA ? "SSAA" : (canvas.antialias == MSAA ? "MSAA" : "NoAA")), 0);
+        appendResult(" | Tile depths: ", coarse_depth_ticks);
+        appendResult(" | Without: ", no_coarse_depth_ticks);
+        title.copyFrom((char*)(bit_identical ? " | Bit-identical" : " | MISMATCH"), title.length);
+        os::setWindowTitle(title.char_ptr);
+    }
+
+    void resetResults() {
+        coarse_depth_ticks = no_coarse_depth_ticks = 0;
+        frame_count = 0;
+        bit_identical = true;
+    }
+};
+
+SlimApp* createApp() {
+    return new DepthBenchmarkApp();
+}
@@ -27,14 +27,14 @@ struct App : SlimApp {
             if (controls::is_pressed::ctrl)
             {
                 gradient_size += mouse::wheel_scroll_amount / 10;
-                gradient_size = max(10, gradient_size);
+                if (gradient_size < 10) gradient_size = 10;
             } else if (controls::is_pressed::alt)
             {
                 S += mouse::wheel_scroll_amount / 10;
-                S = max(10, S);
+                if (S < 10) S = 10;
             } else {
                 R += mouse::wheel_scroll_amount / 10;
-                R = max(10, R);
+                if (R < 10) R = 10;
             }
         }
         center_x = mouse::pos_x;
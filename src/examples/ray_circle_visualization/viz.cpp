@@ -459,7 +459,7 @@ struct VizApp : SlimApp {
                         (i32)hud.top + (i32)(hud.settings.line_height * 2 * FONT_HEIGHT)
                 };
                 canvas.drawText((char*)"When it's equal to the radius, there is a single intersection point", extra_message_pos, Step.value_color);
-                canvas.drawText((char*)"When it's smaller than the radius, there are 2 intersection points", extra_message_pos + vec2{0, hud.settings.line_height * FONT_HEIGHT}, Step.value_color);
+                canvas.drawText((char*)"When it's smaller than the radius, there are 2 intersection points", extra_message_pos + vec2{0.0f, hud.settings.line_height * FONT_HEIGHT}, Step.value_color);
             } if (step >= 6) {
                 Step.title = (char*)"Step 4: ";
                 Step.value.string = (char*)"The 2 intersection points are at the same distance from the closest-point";
@@ -468,7 +468,7 @@ struct VizApp : SlimApp {
                         (i32)hud.top + (i32)(hud.settings.line_height * 2 * FONT_HEIGHT)
                 };
                 canvas.drawText((char*)"The pythagoras theorem is used to determine this distance", extra_message_pos, Step.value_color);
-                canvas.drawText((char*)"using the radius and the distance of the closest point from the center", extra_message_pos + vec2{0, hud.settings.line_height * FONT_HEIGHT}, Step.value_color);
+                canvas.drawText((char*)"using the radius and the distance of the closest point from the center", extra_message_pos + vec2{0.0f, hud.settings.line_height * FONT_HEIGHT}, Step.value_color);
             }
 
             drawHUD(hud, canvas);
@@ -0,0 +1,131 @@
+#define SLIMMER
+
+#include "../slim/draw/canvas.h"
+#include "../slim/core/string.h"
+#include "../slim/app.h"
+// Or using the single-header file:
+//#include "../slim.h"
+
+// Times resolving the canvas into the window content (Canvas::drawToWindow) with every available kernel,
+// and checks that each of them produces exactly the same content as the scalar kernel does.
+// Average microseconds per frame are reported in the window title (printed on exit when headless).
+// Press 'Q' to toggle between NoAA and SSAA (which resolves 4 samples per pixel).
+
+enum ResolveMode {
+    ScalarMode,
+    SSE2Mode,
+    AVX2Mode,
+    MultithreadedMode,
+
+    ResolveModeCount
+};
+
+struct ResolveBenchmarkApp : SlimApp {
+    Canvas canvas;
+    u32 *reference_content = (u32*)os::getMemory(WINDOW_CONTENT_SIZE);
+
+    u64 ticks[ResolveModeCount]{};
+    u32 frame_count = 0;
+    bool bit_identical = true;
+
+    char title_buffer[256];
+    String title{title_buffer, 0};
+
+    void OnWindowResize(u16 width, u16 height) override {
+        canvas.dimensions.update(width, height);
+        fillCanvas();
+        resetResults();
+    }
+
+    void OnKeyChanged(u8 key, bool is_pressed) override {
+        if (!is_pressed && key == 'Q') {
+            canvas.antialias = canvas.antialias == NoAA ? SSAA : NoAA;
+            fillCanvas();
+            resetResults();
+        }
+    }
+
+    void OnRender() override {
+        // The scalar kernel defines the expected content:
+        measure(ScalarMode);
+        u32 content_size = (u32)window::width * (u32)window::height;
+        for (u32 i = 0; i < content_size; i++)
+            reference_content[i] = window::content[i];
+
+        if (resolve::kernel != ResolveScalar) measure(SSE2Mode);
+        if (resolve::kernel == ResolveAVX2) measure(AVX2Mode);
+        measure(MultithreadedMode);
+
+        frame_count++;
+        updateTitle();
+    }
+
+    void measure(ResolveMode mode) {
+        ResolveKernel best_kernel = resolve::kernel;
+        resolve::multithreaded = mode == MultithreadedMode;
+        if (mode == ScalarMode) resolve::kernel = ResolveScalar;
+        if (mode == SSE2Mode) resolve::kernel = ResolveSSE2;
+
+        // The pixels are not drawn through the canvas, so have all of them resolved every time:
+        canvas.markDirty();
+
+        u64 ticks_before = timers::getTicks();
+        canvas.drawToWindow();
+        ticks[mode] += timers::getTicks() - ticks_before;
+
+        resolve::kernel = best_kernel;
+        resolve::multithreaded = true;
+
+        u32 content_size = (u32)window::width * (u32)window::height;
+        if (mode != ScalarMode)
+            for (u32 i = 0; i < content_size; i++)
+                if (window::content[i] != reference_content[i]) {
+                    bit_identical = false;
+                    break;
+                }
+    }
+
+    void appendResult(const char *label, ResolveMode mode) {
+        NumberString number;
+        number = (i32)(timers::microseconds_per_tick * (f64)ticks[mode] / (f64)frame_count);
+        title.copyFrom((char*)label, title.length);
+        title.copyFrom(number.string.char_ptr, title.length);
+        title.copyFrom((char*)"us", title.length);
+    }
+
+    void updateTitle() {
+        title.copyFrom((char*)(canvas.antialias == SSAA ? "SSAA" : "NoAA"), 0);
+        appendResult(" | Scalar: ", ScalarMode);
+        if (resolve::kernel != ResolveScalar) appendResult(" | SSE2: ", SSE2Mode);
+        if (resolve::kernel == ResolveAVX2) appendResult(" | AVX2: ", AVX2Mode);
+        appendResult(" | Multithreaded: ", MultithreadedMode);
+        title.copyFrom((char*)(bit_identical ? " | Bit-identical" : " | MISMATCH"), title.length);
+        os::setWindowTitle(title.char_ptr);
+    }
+
+    void resetResults() {
+        for (u64 &mode_ticks : ticks) mode_ticks = 0;
+        frame_count = 0;
+        bit_identical = true;
+    }
+
+    // Fills every sample with pseudo-random colors, including transparent and over-saturated ones:
+    void fillCanvas() {
+        u32 sample_count = canvas.dimensions.width_times_height * (canvas.antialias == SSAA ? 4 : 1);
+        u32 state = 0x9E3779B9;
+        for (u32 i = 0; i < sample_count; i++) {
+            f32 components[4];
+            for (f32 &component : components) {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                component = (f32)(state & 0xFFFF) / 60000.0f;
+            }
+            storePixel(canvas.pixels[i], Pixel{components[0], components[1], components[2], components[3] < 0.1f ? 0.0f : components[3]});
+        }
+    }
+};
+
+SlimApp* createApp() {
+    return new ResolveBenchmarkApp();
+}
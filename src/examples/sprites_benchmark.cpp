@@ -0,0 +1,171 @@
+#define SLIMMER
+
+#include "../slim/draw/texture.h"
+#include "../slim/draw/sprites.h"
+#include "../slim/core/string.h"
+#include "../slim/app.h"
+// Or using the single-header file:
+//#include "../slim.h"
+
+// Times drawing many small, semi-transparent textured sprites one drawImage() call at a time,
+// against adding all of them to a SpriteBatch and drawing that (culled, sorted, binned into tiles, drawn in parallel),
+// and checks that both produce exactly the same content.
+// Sprites are generated grouped by texture and from large to small (so by mip), the order the batch sorts them in.
+// Average microseconds per frame are reported in the window title (printed on exit when headless).
+// Press 'Q' to cycle through NoAA, SSAA and MSAA.
+
+#define SPRITE_COUNT 100000
+
+struct SpritesBenchmarkApp : SlimApp {
+    Canvas canvas;
+    SpriteBatch batch;
+    u32 *reference_content = (u32*)os::getMemory(WINDOW_CONTENT_SIZE);
+    Rect *bounds = (Rect*)os::getMemory(sizeof(Rect) * SPRITE_COUNT);
+    f32 *opacities = (f32*)os::getMemory(sizeof(f32) * SPRITE_COUNT);
+
+    Texture textures[2];
+
+    u64 one_by_one_ticks = 0;
+    u64 batched_ticks = 0;
+    u32 frame_count = 0;
+    bool bit_identical = true;
+
+    char title_buffer[256];
+    String title{title_buffer, 0};
+
+    SpritesBenchmarkApp() {
+        generateTexture(textures[0], 64, BrightRed, BrightYellow);
+        generateTexture(textures[1], 32, BrightBlue, BrightGreen);
+    }
+
+    void OnWindowResize(u16 width, u16 height) override {
+        canvas.dimensions.update(width, height);
+        generateSprites();
+        resetResults();
+    }
+
+    void OnKeyChanged(u8 key, bool is_pressed) override {
+        if (!is_pressed && key == 'Q') {
+            canvas.antialias = canvas.antialias == NoAA ? SSAA : (canvas.antialias == SSAA ? MSAA : NoAA);
+            resetResults();
+        }
+    }
+
+    INLINE const Texture& textureOf(u32 i) const { return textures[i < SPRITE_COUNT / 2 ? 0 : 1]; }
+
+    void OnRender() override {
+        u32 content_size = (u32)window::width * (u32)window::height;
+
+        canvas.clear();
+        u64 ticks_before = timers::getTicks();
+        for (u32 i = 0; i < SPRITE_COUNT; i++) {
+            const Texture &texture = textureOf(i);
+            const Rect &rect = bounds[i];
+            drawImage(texture, canvas, mat2{
+                    (rect.right - rect.left) / (f32)texture.width, 0.0f,
+                    0.0f, (rect.bottom - rect.top) / (f32)texture.height
+            }, vec2{rect.left, rect.top}, ImageFilterBilinear, opacities[i]);
+        }
+        one_by_one_ticks += timers::getTicks() - ticks_before;
+        canvas.drawToWindow();
+        for (u32 i = 0; i < content_size; i++)
+            reference_content[i] = window::content[i];
+
+        canvas.clear();
+        ticks_before = timers::getTicks();
+        for (u32 i = 0; i < SPRITE_COUNT; i++)
+            batch.add(textureOf(i), bounds[i], Rect{0.0f, 1.0f, 0.0f, 1.0f}, White, opacities[i]);
+        batch.draw(canvas);
+        batched_ticks += timers::getTicks() - ticks_before;
+        canvas.drawToWindow();
+        for (u32 i = 0; i < content_size; i++)
+            if (window::content[i] != reference_content[i]) {
+                bit_identical = false;
+                break;
+            }
+
+        frame_count++;
+        updateTitle();
+    }
+
+    void appendResult(const char *label, u64 ticks) {
+        NumberString number;
+        number = (i32)(timers::microseconds_per_tick * (f64)ticks / (f64)frame_count);
+        title.copyFrom((char*)label, title.length);
+        title.copyFrom(number.string.char_ptr, title.length);
+        title.copyFrom((char*)"us", title.length);
+    }
+
+    void updateTitle() {
+        title.copyFrom((char*)(canvas.antialias == SSAA ? "SSAA" : (canvas.antialias == MSAA ? "MSAA" : "NoAA")), 0);
+        appendResult(" | One by one: ", one_by_one_ticks);
+        appendResult(" | Batched: ", batched_ticks);
+        title.copyFrom((char*)(bit_identical ? " | Bit-identical" : " | MISMATCH"), title.length);
+        os::setWindowTitle(title.char_ptr);
+    }
+
+    void resetResults() {
+        one_by_one_ticks = batched_ticks = 0;
+        frame_count = 0;
+        bit_identical = true;
+    }
+
+    // Scatters square sprites of pseudo-random positions and opacities over (and a bit beyond) the window,
+    // half of them of each texture, each half shrinking from 32 pixels wide to 4:
+    void generateSprites() {
+        u32 state = 0x9E3779B9;
+        auto random = [&]() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return (f32)(state & 0xFFFF) / 65535.0f;
+        };
+
+        f32 width = canvas.dimensions.f_width;
+        f32 height = canvas.dimensions.f_height;
+        const u32 half_count = SPRITE_COUNT / 2;
+        for (u32 i = 0; i < SPRITE_COUNT; i++) {
+            f32 size = 32.0f - 28.0f * (f32)(i % half_count) / (f32)half_count;
+            f32 left = random() * (width + 40.0f) - 20.0f - size * 0.5f;
+            f32 top = random() * (height + 40.0f) - 20.0f - size * 0.5f;
+            bounds[i] = Rect{left, left + size, top, top + size};
+            opacities[i] = 0.25f + random() * 0.75f;
+        }
+    }
+
+    // A mipmapped checkerboard (of 4x4 squares) of the given colors, with each mip's texel quads clamped to its edges:
+    static void generateTexture(Texture &texture, u32 size, Color color, Color other_color) {
+        texture.updateDimensions(size, size);
+        texture.flags.mipmap = true;
+        texture.mip_count = 1;
+        for (u32 mip_size = size; mip_size > 4; mip_size /= 2) texture.mip_count++;
+        texture.mips = (TextureMip*)os::getMemory(sizeof(TextureMip) * texture.mip_count);
+
+        for (u32 m = 0; m < texture.mip_count; m++) {
+            TextureMip &mip = texture.mips[m];
+            mip.width = mip.height = size >> m;
+            mip.texel_quads = (TexelQuad*)os::getMemory(sizeof(TexelQuad) * (mip.width + 1) * (mip.height + 1));
+            auto texel = [&](i32 x, i32 y) -> Color {
+                x = clampedValue(x, 0, (i32)mip.width - 1);
+                y = clampedValue(y, 0, (i32)mip.height - 1);
+                return ((x * 4 / (i32)mip.width + y * 4 / (i32)mip.height) & 1) ? color : other_color;
+            };
+            TexelQuad *texel_quad = mip.texel_quads;
+            for (i32 y = 0; y <= (i32)mip.height; y++)
+                for (i32 x = 0; x <= (i32)mip.width; x++, texel_quad++) {
+                    Color TL = texel(x - 1, y - 1), TR = texel(x, y - 1), BL = texel(x - 1, y), BR = texel(x, y);
+                    TexelQuadComponent *components = &texel_quad->R;
+                    for (u32 c = 0; c < 3; c++) {
+                        components[c].TL = (u8)(TL.components[c] * FLOAT_TO_COLOR_COMPONENT);
+                        components[c].TR = (u8)(TR.components[c] * FLOAT_TO_COLOR_COMPONENT);
+                        components[c].BL = (u8)(BL.components[c] * FLOAT_TO_COLOR_COMPONENT);
+                        components[c].BR = (u8)(BR.components[c] * FLOAT_TO_COLOR_COMPONENT);
+                    }
+                }
+        }
+    }
+};
+
+SlimApp* createApp() {
+    return new SpritesBenchmarkApp();
+}
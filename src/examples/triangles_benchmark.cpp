@@ -0,0 +1,130 @@
+#define SLIMMER
+
+#include "../slim/math/vec2.h"
+#include "../slim/draw/triangle.h"
+#include "../slim/core/string.h"
+#include "../slim/app.h"
+// Or using the single-header file:
+//#include "../slim.h"
+
+// Times filling a mesh of many small, semi-transparent triangles one fillTriangle() call at a time,
+// against submitting all of them at once through fillTriangles() (binned into tiles, rasterized in parallel),
+// and checks that both produce exactly the same content.
+// Average microseconds per frame are reported in the window title (printed on exit when headless).
+// Press 'Q' to cycle through NoAA, SSAA and MSAA.
+
+#define TRIANGLE_COUNT 100000
+
+// With a single worker fillTriangles() draws them one by one as well, so workers can be set here (0 for one per core)
+// to time and check the binned path on any machine:
+#define WORKER_COUNT 0
+
+struct TrianglesBenchmarkApp : SlimApp {
+    bool workers_started = jobs::initialize(WORKER_COUNT);
+    Canvas canvas;
+    u32 *reference_content = (u32*)os::getMemory(WINDOW_CONTENT_SIZE);
+    vec2 *vertices = (vec2*)os::getMemory(sizeof(vec2) * TRIANGLE_COUNT * 3);
+    u32 *indices = (u32*)os::getMemory(sizeof(u32) * TRIANGLE_COUNT * 3);
+    Color *colors = (Color*)os::getMemory(sizeof(Color) * TRIANGLE_COUNT);
+
+    u64 one_by_one_ticks = 0;
+    u64 batched_ticks = 0;
+    u32 frame_count = 0;
+    bool bit_identical = true;
+
+    char title_buffer[256];
+    String title{title_buffer, 0};
+
+    void OnWindowResize(u16 width, u16 height) override {
+        canvas.dimensions.update(width, height);
+        generateMesh();
+        resetResults();
+    }
+
+    void OnKeyChanged(u8 key, bool is_pressed) override {
+        if (!is_pressed && key == 'Q') {
+            canvas.antialias = canvas.antialias == NoAA ? SSAA : (canvas.antialias == SSAA ? MSAA : NoAA);
+            resetResults();
+        }
+    }
+
+    void OnRender() override {
+        u32 content_size = (u32)window::width * (u32)window::height;
+
+        canvas.clear();
+        u64 ticks_before = timers::getTicks();
+        for (u32 i = 0; i < TRIANGLE_COUNT; i++)
+            canvas.fillTriangle(vertices[indices[3 * i]], vertices[indices[3 * i + 1]], vertices[indices[3 * i + 2]], colors[i], 0.75f);
+        one_by_one_ticks += timers::getTicks() - ticks_before;
+        canvas.drawToWindow();
+        for (u32 i = 0; i < content_size; i++)
+            reference_content[i] = window::content[i];
+
+        canvas.clear();
+        ticks_before = timers::getTicks();
+        canvas.fillTriangles(vertices, indices, TRIANGLE_COUNT, colors, 0.75f);
+        batched_ticks += timers::getTicks() - ticks_before;
+        canvas.drawToWindow();
+        for (u32 i = 0; i < content_size; i++)
+            if (window::content[i] != reference_content[i]) {
+                bit_identical = false;
+                break;
+            }
+
+        frame_count++;
+        updateTitle();
+    }
+
+    void appendResult(const char *label, u64 ticks) {
+        NumberString number;
+        number = (i32)(timers::microseconds_per_tick * (f64)ticks / (f64)frame_count);
+        title.copyFrom((char*)label, title.length);
+        title.copyFrom(number.string.char_ptr, title.length);
+        title.copyFrom((char*)"us", title.length);
+    }
+
+    void updateTitle() {
+        title.copyFrom((char*)(canvas.antialias == SSAA ? "SSAA" : (canvas.antialias == MSAA ? "MSAA" : "NoAA")), 0);
+        NumberString number;
+        number = (i32)jobs::worker_count;
+        title.copyFrom((char*)" | Workers: ", title.length);
+        title.copyFrom(number.string.char_ptr, title.length);
+        appendResult(" | One by one: ", one_by_one_ticks);
+        appendResult(" | Batched: ", batched_ticks);
+        title.copyFrom((char*)(bit_identical ? " | Bit-identical" : " | MISMATCH"), title.length);
+        os::setWindowTitle(title.char_ptr);
+    }
+
+    void resetResults() {
+        one_by_one_ticks = batched_ticks = 0;
+        frame_count = 0;
+        bit_identical = true;
+    }
+
+    // Scatters small pseudo-random triangles of pseudo-random colors over (and a bit beyond) the window:
+    void generateMesh() {
+        u32 state = 0x9E3779B9;
+        auto random = [&]() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return (f32)(state & 0xFFFF) / 65535.0f;
+        };
+
+        f32 width = canvas.dimensions.f_width;
+        f32 height = canvas.dimensions.f_height;
+        for (u32 i = 0; i < TRIANGLE_COUNT; i++) {
+            vec2 center{random() * (width + 20.0f) - 10.0f, random() * (height + 20.0f) - 10.0f};
+            f32 size = 4.0f + random() * 24.0f;
+            for (u32 v = 0; v < 3; v++) {
+                vertices[3 * i + v] = vec2{center.x + (random() - 0.5f) * size, center.y + (random() - 0.5f) * size};
+                indices[3 * i + v] = 3 * i + v;
+            }
+            colors[i] = Color(random(), random(), random());
+        }
+    }
+};
+
+SlimApp* createApp() {
+    return new TrianglesBenchmarkApp();
+}
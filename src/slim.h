@@ -4,7 +4,6 @@
 
 #include <cmath>
 
-
 #if defined(__clang__)
     #define COMPILER_CLANG 1
     #define COMPILER_CLANG_OR_GCC 1
@@ -105,10 +104,11 @@
 
 typedef unsigned char      u8;
 typedef unsigned short     u16;
-typedef unsigned long int  u32;
+typedef unsigned int       u32;
 typedef unsigned long long u64;
 typedef signed   short     i16;
-typedef signed   long int  i32;
+typedef signed   int       i32;
+typedef signed   long long i64;
 
 typedef float  f32;
 typedef double f64;
@@ -734,7 +734,6 @@ struct Pixel {
     }
 };
 
-
 struct TiledGridDimensions {
     u32 width = 0;
     u32 height = 0;
@@ -834,6 +833,7 @@ union ImageFlags {
         unsigned int mipmap:1;
         unsigned int flip:1;
         unsigned int wrap:1;
+        unsigned int swizzle:1;
     };
     u32 flags = 0;
 };
@@ -843,6 +843,7 @@ struct ImageInfo : TiledGridDimensions {
     ImageFlags flags;
 };
 
+
 template <typename T>
 struct Image : ImageInfo {
     T* content = nullptr;
@@ -853,10 +854,171 @@ struct PixelImage : Image<Pixel> {};
 struct FloatImage : Image<f32> {};
 struct ByteColorImage : Image<ByteColor> {};
 
-#define PIXEL_SIZE (sizeof(Pixel))
+// Half-float conversions (round to nearest even, infinities and NaNs are preserved):
+INLINE_XPU u16 floatToHalf(f32 value) {
+    union { f32 f; u32 u; } bits{value};
+    u32 sign = bits.u & 0x80000000;
+    bits.u ^= sign;
+
+    u16 half;
+    if (bits.u >= (143 << 23)) // Too large for a half (or infinity/NaN)
+        half = bits.u > (255 << 23) ? 0x7E00 : 0x7C00;
+    else if (bits.u < (113 << 23)) { // Denormal half, let the float unit do the rounding
+        union { u32 u; f32 f; } magic{126 << 23};
+        bits.f += magic.f;
+        half = (u16)(bits.u - magic.u);
+    } else {
+        u32 odd_mantissa = (bits.u >> 13) & 1;
+        bits.u += ((u32)(15 - 127) << 23) + 0xFFF + odd_mantissa;
+        half = (u16)(bits.u >> 13);
+    }
+
+    return half | (u16)(sign >> 16);
+}
+
+INLINE_XPU f32 halfToFloat(u16 half) {
+    union { u32 u; f32 f; } bits{(u32)(half & 0x7FFF) << 13};
+    u32 exponent = bits.u & (0x7C00 << 13);
+    bits.u += (127 - 15) << 23;
+    if (exponent == (0x7C00 << 13)) // Infinity/NaN
+        bits.u += (128 - 16) << 23;
+    else if (exponent == 0) { // Denormal
+        union { u32 u; f32 f; } magic{113 << 23};
+        bits.u += 1 << 23;
+        bits.f -= magic.f;
+    }
+    bits.u |= (u32)(half & 0x8000) << 16;
+    return bits.f;
+}
+
+// Canvas pixel storage formats, selected at compile time by defining CANVAS_PIXEL_FORMAT before any include:
+//   CANVAS_PIXEL_FORMAT_F32     : Pixel (16 bytes), the default
+//   CANVAS_PIXEL_FORMAT_RGBA16F : PixelRGBA16F (8 bytes), the same values as Pixel stored as half floats
+//   CANVAS_PIXEL_FORMAT_RGBA8   : PixelRGBA8 (4 bytes), premultiplied color stored gamma-encoded, as presented
+// Drawing always blends in Pixel form, loading and storing samples through loadPixel() and storePixel().
+#define CANVAS_PIXEL_FORMAT_F32 0
+#define CANVAS_PIXEL_FORMAT_RGBA16F 1
+#define CANVAS_PIXEL_FORMAT_RGBA8 2
+
+#ifndef CANVAS_PIXEL_FORMAT
+#define CANVAS_PIXEL_FORMAT CANVAS_PIXEL_FORMAT_F32
+#endif
+
+struct PixelRGBA16F {
+    u16 r, g, b, opacity;
+};
+
+// Byte order matches the window content (0xAARRGGBB as a little-endian u32):
+struct PixelRGBA8 {
+    union {
+        struct { u8 B, G, R, A; };
+        u32 value;
+    };
+};
+
+// Decodes a gamma-encoded byte back to linear, so that encoding the result gives back the same byte:
+struct ByteToLinearTable {
+    f32 values[256];
+
+    ByteToLinearTable() {
+        values[0] = 0.0f;
+        values[255] = 1.0f;
+        for (u32 i = 1; i < 255; i++) {
+            f32 value = ((f32)i + 0.5f) * COLOR_COMPONENT_TO_FLOAT;
+            values[i] = value * value;
+        }
+    }
+};
+ByteToLinearTable byte_to_linear;
+
+// Linear values in 16-bit fixed point (65535 being 1), for storing and blending bytes with integer math:
+struct ByteToLinear16Table {
+    u16 values[256];
+
+    ByteToLinear16Table() {
+        for (u32 i = 0; i < 256; i++) values[i] = (u16)(byte_to_linear.values[i] * 65535.0f + 0.5f);
+    }
+};
+ByteToLinear16Table byte_to_linear16;
+
+// Gamma-encodes a 16-bit linear value to a byte, as Pixel::asContent() does for floats (with decoded bytes encoding back to themselves).
+// Also the gamma 2 color encode table (see getColorEncodeTable()), hence the 3 bytes of padding for AVX2 gathers:
+struct Linear16ToByteTable {
+    u8 values[65536 + 3];
+
+    Linear16ToByteTable() {
+        for (u32 i = 0; i < 65536; i++) values[i] = (u8)(FLOAT_TO_COLOR_COMPONENT * sqrtf((f32)i / 65535.0f));
+        for (u32 i = 0; i < 256; i++) values[byte_to_linear16.values[i]] = (u8)i;
+    }
+};
+Linear16ToByteTable linear16_to_byte;
+
+INLINE u16 toLinear16(f32 value) {
+    return (u16)(clampedValue(value) * 65535.0f + 0.5f);
+}
+
+INLINE_XPU Pixel loadPixel(const Pixel &stored) { return stored; }
+INLINE_XPU void storePixel(Pixel &stored, const Pixel &pixel) { stored = pixel; }
+
+INLINE_XPU Pixel loadPixel(const PixelRGBA16F &stored) {
+    return {halfToFloat(stored.r), halfToFloat(stored.g), halfToFloat(stored.b), halfToFloat(stored.opacity)};
+}
+INLINE_XPU void storePixel(PixelRGBA16F &stored, const Pixel &pixel) {
+    stored.r = floatToHalf(pixel.color.r);
+    stored.g = floatToHalf(pixel.color.g);
+    stored.b = floatToHalf(pixel.color.b);
+    stored.opacity = floatToHalf(pixel.opacity);
+}
+
+INLINE Pixel loadPixel(const PixelRGBA8 &stored) {
+    return {
+        byte_to_linear.values[stored.R],
+        byte_to_linear.values[stored.G],
+        byte_to_linear.values[stored.B],
+        (f32)stored.A * COLOR_COMPONENT_TO_FLOAT
+    };
+}
+INLINE void storePixel(PixelRGBA8 &stored, const Pixel &pixel) {
+    stored.R = linear16_to_byte.values[toLinear16(pixel.color.r)];
+    stored.G = linear16_to_byte.values[toLinear16(pixel.color.g)];
+    stored.B = linear16_to_byte.values[toLinear16(pixel.color.b)];
+    stored.A = (u8)(clampedValue(pixel.opacity) * FLOAT_TO_COLOR_COMPONENT + 0.5f);
+}
+
+#if CANVAS_PIXEL_FORMAT == CANVAS_PIXEL_FORMAT_RGBA8
+typedef PixelRGBA8 CanvasPixel;
+#elif CANVAS_PIXEL_FORMAT == CANVAS_PIXEL_FORMAT_RGBA16F
+typedef PixelRGBA16F CanvasPixel;
+#else
+typedef Pixel CanvasPixel;
+#endif
+
+#define PIXEL_SIZE (sizeof(CanvasPixel))
 #define CANVAS_PIXELS_SIZE (MAX_WINDOW_SIZE * PIXEL_SIZE * 4)
 #define CANVAS_DEPTHS_SIZE (MAX_WINDOW_SIZE * sizeof(f32) * 4)
-#define CANVAS_SIZE (CANVAS_PIXELS_SIZE + CANVAS_DEPTHS_SIZE)
+
+// Canvases track which of their tiles (in window pixels) were drawn into since they were last drawn to the window:
+#define CANVAS_TILE_SIZE_SHIFT 6
+#define CANVAS_TILE_SIZE (1 << CANVAS_TILE_SIZE_SHIFT)
+#define CANVAS_MAX_TILE_COLUMNS ((MAX_WIDTH + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE)
+#define CANVAS_MAX_TILE_ROWS ((MAX_HEIGHT + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE)
+#define CANVAS_DIRTY_TILES_SIZE (((CANVAS_MAX_TILE_COLUMNS * CANVAS_MAX_TILE_ROWS) + 63) & ~63)
+
+// Defining CANVAS_LAZY_CLEAR before any include makes clearing a canvas just start a new clear epoch:
+// Tiles from an older epoch read as the clear value, and are only cleared in memory once drawn into.
+#define CANVAS_TILE_EPOCHS_SIZE (CANVAS_DIRTY_TILES_SIZE * sizeof(u32))
+// The epoch a tile holds while one thread clears it in memory, with others drawing into it waiting for the clear epoch:
+#define CANVAS_TILE_EPOCH_CLEARING 0xFFFFFFFF
+
+// With MSAA pixels are stored once (along with a single depth) for as long as their samples are all the same.
+// The memory SSAA would use for the other 3 samples of each pixel is split into a pool of samples per tile, for pixels whose samples differ.
+// The memory SSAA would use for the other 3 depths of each pixel holds where each pixel's samples are, and how many of each pool are in use:
+#define CANVAS_MSAA_TILE_SAMPLES ((((u32)MAX_WINDOW_SIZE * 3) / (CANVAS_MAX_TILE_COLUMNS * CANVAS_MAX_TILE_ROWS)) & ~7u)
+
+// A coarse depth buffer of a min and a max depth per tile, for pixels drawn with depth to skip per-pixel work:
+#define CANVAS_TILE_DEPTHS_SIZE (CANVAS_DIRTY_TILES_SIZE * sizeof(f32) * 2)
+
+#define CANVAS_SIZE (CANVAS_PIXELS_SIZE + CANVAS_DEPTHS_SIZE + CANVAS_DIRTY_TILES_SIZE + CANVAS_TILE_EPOCHS_SIZE + CANVAS_TILE_DEPTHS_SIZE)
 
 struct Dimensions {
     u32 width_times_height{(u32)DEFAULT_WIDTH * (u32)DEFAULT_HEIGHT};
@@ -936,6 +1098,13 @@ namespace os {
     void* openFileForWriting(const char* file_path);
     bool readFromFile(void *out, unsigned long, void *handle);
     bool writeToFile(void *out, unsigned long, void *handle);
+
+    typedef void (*ThreadFunction)(void *parameter);
+    u32 getCoreCount();
+    bool createThread(ThreadFunction thread_function, void *parameter);
+    void* createSemaphore(u32 initial_count = 0);
+    void signalSemaphore(void *semaphore, u32 count = 1);
+    void waitForSemaphore(void *semaphore);
 }
 
 namespace timers {
@@ -1099,21 +1268,41 @@ namespace memory {
 
         void* allocate(u64 size) {
             if (!address) return nullptr;
+            if (occupied + size > capacity) return nullptr;
             occupied += size;
-            if (occupied > capacity) return nullptr;
 
             void* current_address = address;
             address += size;
             return current_address;
         }
+
+        // Frees everything allocated so far at once, for reusing the memory:
+        void reset() {
+            address -= occupied;
+            occupied = 0;
+        }
     };
 }
 
+#define WINDOW_MAX_DIRTY_RECT_COUNT 64
+
 namespace window {
     u16 width{DEFAULT_WIDTH};
     u16 height{DEFAULT_HEIGHT};
     char* title{(char*)""};
     u32 *content{nullptr};
+
+    // The canvas the content was last resolved from and at what size, for it to resolve only its dirty tiles next time.
+    // Anything else writing into the content resets the source, so that the next canvas resolves everything:
+    const void *content_source{nullptr};
+    u16 content_source_width{0};
+    u16 content_source_height{0};
+
+    // When presenting partially, only the dirty rectangles of the content get presented (possibly none).
+    // Platforms present the whole content otherwise, and reset both after every present:
+    bool present_partially{false};
+    u32 dirty_rect_count{0};
+    RectI dirty_rects[WINDOW_MAX_DIRTY_RECT_COUNT];
 }
 
 void writeHeader(const ImageInfo &info, void *file) {
@@ -1184,3103 +1373,7677 @@ bool load(T &value, char *file_path, memory::MonotonicAllocator *memory_allocato
     return true;
 }
 
-struct String {
-    u32 length;
-    char *char_ptr;
 
-    String() noexcept : String{(char*)"", 0} {}
-    String(char *char_ptr) noexcept : length{getLength(char_ptr)}, char_ptr{char_ptr} {}
-    String(char *char_ptr, u32 length) noexcept : length{length}, char_ptr{char_ptr} {}
+// SIMD support is detected at compile time (SSE2 being part of x64), and picked at runtime by what the CPU has (see simd::level).
+// AVX2 and AVX-512 code gets compiled per function (with SLIM_TARGET_AVX2/SLIM_TARGET_AVX512), so builds run on any x64 CPU.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SLIM_SSE2 1
+    #include <emmintrin.h>
+    #if defined(COMPILER_MSVC)
+        #define SLIM_AVX2 1
+        #define SLIM_AVX512 1
+        #define SLIM_TARGET_AVX2
+        #define SLIM_TARGET_AVX512
+        #include <intrin.h>
+        #include <immintrin.h>
+    #elif defined(COMPILER_CLANG_OR_GCC)
+        #define SLIM_AVX2 1
+        #define SLIM_AVX512 1
+        #define SLIM_TARGET_AVX2 __attribute__((target("avx2")))
+        #define SLIM_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512vl,avx512bw")))
+        #include <immintrin.h>
+    #endif
+#endif
 
-    static String getFilePath(char *file_name, char *buffer, char *adjacent_file) {
-        String str(buffer);
-        u32 offset = getDirectoryLength(adjacent_file);
-        str.copyFrom(adjacent_file, file_name, offset);
-        return str;
-    }
+// Methods of the 8-wide types are only inlined (not forced to be), as forcing them into code compiled
+// without AVX2 (like a template shared by the kernels of all widths) fails to compile.
+// Once such code gets inlined into a function compiled with AVX2, so do they:
+#define SLIM_INLINE_AVX2 SLIM_TARGET_AVX2 inline
+
+// Kernel bodies shared by all widths have to be inlined into the kernels even in debug builds,
+// as passing 8-wide values between code compiled with and without AVX2 does not agree on how to pass them:
+#if defined(COMPILER_MSVC)
+    #define SLIM_INLINE_KERNEL inline __forceinline
+#elif defined(COMPILER_CLANG_OR_GCC)
+    #define SLIM_INLINE_KERNEL inline __attribute__((always_inline))
+#else
+    #define SLIM_INLINE_KERNEL inline
+#endif
 
-    void copyFrom(char* CharPtr, u32 offset) {
-        length = offset;
-        char *source_char = CharPtr;
-        char *string_char = char_ptr + offset;
-        while (source_char[0]) {
-            *string_char = *source_char;
-            string_char++;
-            source_char++;
-            length++;
-        }
-        *string_char = 0;
-    }
+enum SimdLevel {
+    SimdScalar,
+    SimdSSE2,
+    SimdAVX2,
+    SimdAVX512
+};
 
-    void copyFrom(char* CharPtr1, char* CharPtr2, u32 offset) {
-        copyFrom(CharPtr1, 0);
-        copyFrom(CharPtr2, offset);
-    }
+bool cpuHasAVX2() {
+#if defined(SLIM_AVX2) && defined(COMPILER_MSVC)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
 
-    String& operator = (char* CharPtr) {
-        char_ptr = CharPtr;
-        length = getLength(char_ptr);
-        return *this;
-    }
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+    if (!os_saves_ymm) return false;
 
-    static u32 getLength(char *string) {
-        char *ptr = string;
-        u32 length = 0;
-        if (ptr) while (ptr[length]) length++;
-        return length;
-    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(SLIM_AVX2)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
 
-    static u32 getDirectoryLength(char *path) {
-        u32 path_len = getLength(path);
-        u32 dir_len = path_len;
-        while ((path[dir_len] != '/') && (path[dir_len] != '\\')) dir_len--;
-        return dir_len + 1;
-    }
-};
+// AVX-512 kernels use the foundation, vector length and byte/word extensions:
+bool cpuHasAVX512() {
+#if defined(SLIM_AVX512) && defined(COMPILER_MSVC)
+    if (!cpuHasAVX2()) return false;
 
-struct NumberString {
-    u8 float_digits_count = 3;
-    String string{_buffer, 0};
-    char _buffer[13]{};
+    bool os_saves_zmm = (_xgetbv(0) & 0xE6) == 0xE6;
+    if (!os_saves_zmm) return false;
 
-    explicit NumberString(u8 digit_count = 3) : float_digits_count{digit_count}, string{_buffer, 1} {
-        _buffer[12] = 0;
-        for (u8 i = 0; i < 12; i++)
-            _buffer[i] = ' ';
-    }
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) && (info[1] & (1 << 30)) && (info[1] & (1 << 31));
+#elif defined(SLIM_AVX512)
+    return __builtin_cpu_supports("avx2") &&
+           __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512vl") &&
+           __builtin_cpu_supports("avx512bw");
+#else
+    return false;
+#endif
+}
 
-    explicit NumberString(const char *str, u8 digits_count = 3) : float_digits_count{digits_count}, string{_buffer, 1} {
-        _buffer[12] = 0;
-        char *char_ptr = (char*)str;
-        string.length = (u8)String::getLength(char_ptr);
-        if (string.length > 12) string.length = 12;
-        if ((*str >= '0') && (*str <= '9')) {
-            char_ptr += string.length;
-            char_ptr--;
-            for (i32 i = 11; i >= 0; i--, char_ptr--)
-                _buffer[i] = (11 - i) < float_digits_count ? *char_ptr : ' ';
-        } else {
-            for (u8 i = 0; i < string.length; i++, char_ptr++) _buffer[i] = *char_ptr;
-            _buffer[string.length] = 0;
-        }
-    }
+SimdLevel getBestSimdLevel() {
+#ifdef SLIM_SSE2
+    return cpuHasAVX512() ? SimdAVX512 : (cpuHasAVX2() ? SimdAVX2 : SimdSSE2);
+#else
+    return SimdScalar;
+#endif
+}
 
-    NumberString& operator = (i32 number) {
-        char *buffer = _buffer;
-        buffer[12] = 0;
+namespace simd {
+    SimdLevel level = getBestSimdLevel();
+}
 
-        bool is_negative = number < 0;
-        if (is_negative) number = -number;
+// Picks the widest of the given variants of a kernel that the level allows, falling back to narrower ones (down to scalar).
+// Variants that are not compiled in are given as nullptr, which the SIMD_<LEVEL>_KERNEL() macros take care of:
+template <typename Kernel>
+Kernel selectKernel(Kernel scalar, Kernel sse2, Kernel avx2 = nullptr, Kernel avx512 = nullptr, SimdLevel level = simd::level) {
+    if (avx512 && level >= SimdAVX512) return avx512;
+    if (avx2   && level >= SimdAVX2)   return avx2;
+    if (sse2   && level >= SimdSSE2)   return sse2;
+    return scalar;
+}
 
-        if (number) {
-            u32 temp;
-            buffer += 11;
-            string.char_ptr = buffer;
-            string.length = 0;
+#ifdef SLIM_SSE2
+    #define SIMD_SSE2_KERNEL(kernel) (kernel)
+#else
+    #define SIMD_SSE2_KERNEL(kernel) nullptr
+#endif
+#ifdef SLIM_AVX2
+    #define SIMD_AVX2_KERNEL(kernel) (kernel)
+#else
+    #define SIMD_AVX2_KERNEL(kernel) nullptr
+#endif
+#ifdef SLIM_AVX512
+    #define SIMD_AVX512_KERNEL(kernel) (kernel)
+#else
+    #define SIMD_AVX512_KERNEL(kernel) nullptr
+#endif
 
-            for (u8 i = 0; i < 11; i++) {
-                temp = number;
-                number /= 10;
-                string.length++;
-                *buffer-- = (char)('0' + temp - number * 10);
-                if (!number) {
-                    if (is_negative) {
-                        *buffer = '-';
-                        string.char_ptr--;
-                        string.length++;
-                    }
+// Lanes of floats and integers, with a scalar backend where the instruction set is not available.
+// Kernel bodies can be written once as templates over the lane types (of the same width, see the width members):
+// f32x4 and i32x4 (SSE2), f32x8 and i32x8 (AVX2, usable in functions compiled with SLIM_TARGET_AVX2 or SLIM_TARGET_AVX512).
+// Comparisons give masks (all bits set for the lanes where they hold) to select with, or to get as bits with mask().
+
+#ifdef SLIM_SSE2
+struct f32x4 {
+    static constexpr u32 width = 4;
+    __m128 v;
+
+    INLINE f32x4() = default;
+    INLINE f32x4(__m128 v) : v{v} {}
+    INLINE f32x4(f32 value) : v{_mm_set1_ps(value)} {}
+
+    INLINE static f32x4 load(const f32 *values) { return _mm_loadu_ps(values); }
+    INLINE void store(f32 *values) const { _mm_storeu_ps(values, v); }
+
+    INLINE f32x4 operator + (const f32x4 &rhs) const { return _mm_add_ps(v, rhs.v); }
+    INLINE f32x4 operator - (const f32x4 &rhs) const { return _mm_sub_ps(v, rhs.v); }
+    INLINE f32x4 operator * (const f32x4 &rhs) const { return _mm_mul_ps(v, rhs.v); }
+    INLINE f32x4 operator / (const f32x4 &rhs) const { return _mm_div_ps(v, rhs.v); }
+    INLINE f32x4 operator & (const f32x4 &rhs) const { return _mm_and_ps(v, rhs.v); }
+    INLINE f32x4 operator | (const f32x4 &rhs) const { return _mm_or_ps(v, rhs.v); }
+    INLINE f32x4 operator <  (const f32x4 &rhs) const { return _mm_cmplt_ps(v, rhs.v); }
+    INLINE f32x4 operator <= (const f32x4 &rhs) const { return _mm_cmple_ps(v, rhs.v); }
+    INLINE f32x4 operator >  (const f32x4 &rhs) const { return _mm_cmpgt_ps(v, rhs.v); }
+    INLINE f32x4 operator >= (const f32x4 &rhs) const { return _mm_cmpge_ps(v, rhs.v); }
+    INLINE f32x4 operator == (const f32x4 &rhs) const { return _mm_cmpeq_ps(v, rhs.v); }
+    INLINE u32 mask() const { return (u32)_mm_movemask_ps(v); }
+};
 
-                    break;
-                }
-                string.char_ptr--;
-            }
-        } else {
-            buffer[11] = '0';
-            string.length = 1;
-            string.char_ptr = buffer + 11;
-        }
+INLINE f32x4 minimum(const f32x4 &a, const f32x4 &b) { return _mm_min_ps(a.v, b.v); }
+INLINE f32x4 maximum(const f32x4 &a, const f32x4 &b) { return _mm_max_ps(a.v, b.v); }
+INLINE f32x4 sqrt(const f32x4 &a) { return _mm_sqrt_ps(a.v); }
+INLINE f32x4 approxRsqrt(const f32x4 &a) { return _mm_rsqrt_ps(a.v); } // About 12 bits of precision
+INLINE f32x4 approxRcp(const f32x4 &a) { return _mm_rcp_ps(a.v); }
+#ifdef FP_FAST_FMAF // Fused exactly when fast_mul_add() is, for kernels to match scalar code using it
+INLINE f32x4 mulAdd(const f32x4 &a, const f32x4 &b, const f32x4 &c) { return _mm_fmadd_ps(a.v, b.v, c.v); }
+#else
+INLINE f32x4 mulAdd(const f32x4 &a, const f32x4 &b, const f32x4 &c) { return _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v); }
+#endif
+INLINE f32x4 select(const f32x4 &mask, const f32x4 &a, const f32x4 &b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+INLINE f32x4 floor(const f32x4 &a) { // Truncates, then steps down the negative values that got rounded up (for values within the range of i32)
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+}
+
+// Splits pairs of interleaved values (like the x and y of points) into the lanes of even and odd ones, and back:
+INLINE void deinterleave(const f32x4 &a, const f32x4 &b, f32x4 &even, f32x4 &odd) {
+    even = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0));
+    odd  = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1));
+}
+INLINE void interleave(const f32x4 &even, const f32x4 &odd, f32x4 &a, f32x4 &b) {
+    a = _mm_unpacklo_ps(even.v, odd.v);
+    b = _mm_unpackhi_ps(even.v, odd.v);
+}
+
+struct i32x4 {
+    static constexpr u32 width = 4;
+    __m128i v;
+
+    INLINE i32x4() = default;
+    INLINE i32x4(__m128i v) : v{v} {}
+    INLINE i32x4(i32 value) : v{_mm_set1_epi32(value)} {}
+
+    INLINE static i32x4 load(const i32 *values) { return _mm_loadu_si128((const __m128i*)values); }
+    INLINE void store(i32 *values) const { _mm_storeu_si128((__m128i*)values, v); }
+
+    INLINE i32x4 operator + (const i32x4 &rhs) const { return _mm_add_epi32(v, rhs.v); }
+    INLINE i32x4 operator - (const i32x4 &rhs) const { return _mm_sub_epi32(v, rhs.v); }
+    INLINE i32x4 operator & (const i32x4 &rhs) const { return _mm_and_si128(v, rhs.v); }
+    INLINE i32x4 operator | (const i32x4 &rhs) const { return _mm_or_si128(v, rhs.v); }
+    INLINE i32x4 operator ^ (const i32x4 &rhs) const { return _mm_xor_si128(v, rhs.v); }
+    INLINE i32x4 operator ~ () const { return _mm_xor_si128(v, _mm_set1_epi32(-1)); }
+    INLINE i32x4 operator << (i32 bits) const { return _mm_sll_epi32(v, _mm_cvtsi32_si128(bits)); }
+    INLINE i32x4 operator >> (i32 bits) const { return _mm_sra_epi32(v, _mm_cvtsi32_si128(bits)); }
+    INLINE i32x4 operator == (const i32x4 &rhs) const { return _mm_cmpeq_epi32(v, rhs.v); }
+    INLINE i32x4 operator >  (const i32x4 &rhs) const { return _mm_cmpgt_epi32(v, rhs.v); }
+    INLINE i32x4 operator <  (const i32x4 &rhs) const { return _mm_cmplt_epi32(v, rhs.v); }
+    INLINE u32 mask() const { return (u32)_mm_movemask_ps(_mm_castsi128_ps(v)); }
+};
 
-        return *this;
-    }
+// SSE2 has no 32-bit lane multiplication (keeping the low halves), so the even and odd lanes get multiplied separately:
+INLINE i32x4 mulLow(const i32x4 &a, const i32x4 &b) {
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+INLINE i32x4 andNot(const i32x4 &mask, const i32x4 &a) { return _mm_andnot_si128(mask.v, a.v); }
+INLINE i32x4 select(const i32x4 &mask, const i32x4 &a, const i32x4 &b) { return _mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v)); }
+INLINE i32x4 truncateToI32(const f32x4 &a) { return _mm_cvttps_epi32(a.v); }
+INLINE f32x4 toF32(const i32x4 &a) { return _mm_cvtepi32_ps(a.v); }
+INLINE i32x4 gather(const i32 *values, const i32x4 &indices) {
+    alignas(16) i32 lanes[4];
+    indices.store(lanes);
+    return _mm_setr_epi32(values[lanes[0]], values[lanes[1]], values[lanes[2]], values[lanes[3]]);
+}
+INLINE f32x4 gather(const f32 *values, const i32x4 &indices) {
+    alignas(16) i32 lanes[4];
+    indices.store(lanes);
+    return _mm_setr_ps(values[lanes[0]], values[lanes[1]], values[lanes[2]], values[lanes[3]]);
+}
+
+struct u8x16 {
+    static constexpr u32 width = 16;
+    __m128i v;
+
+    INLINE u8x16() = default;
+    INLINE u8x16(__m128i v) : v{v} {}
+    INLINE u8x16(u8 value) : v{_mm_set1_epi8((char)value)} {}
+
+    INLINE static u8x16 load(const u8 *values) { return _mm_loadu_si128((const __m128i*)values); }
+    INLINE void store(u8 *values) const { _mm_storeu_si128((__m128i*)values, v); }
+
+    INLINE u8x16 operator + (const u8x16 &rhs) const { return _mm_add_epi8(v, rhs.v); }
+    INLINE u8x16 operator - (const u8x16 &rhs) const { return _mm_sub_epi8(v, rhs.v); }
+    INLINE u8x16 operator & (const u8x16 &rhs) const { return _mm_and_si128(v, rhs.v); }
+    INLINE u8x16 operator | (const u8x16 &rhs) const { return _mm_or_si128(v, rhs.v); }
+    INLINE u8x16 operator == (const u8x16 &rhs) const { return _mm_cmpeq_epi8(v, rhs.v); }
+    INLINE u32 mask() const { return (u32)_mm_movemask_epi8(v); }
+};
 
-    NumberString& operator = (f32 number) {
-        f32 factor = 1;
-        for (u8 i = 0; i < float_digits_count; i++) factor *= 10;
-        i32 int_num = (i32)(number * factor);
-        if (int_num == 0) {
-            *this = (i32)factor;
-            string.length++;
-            string.char_ptr[0] = '.';
-            string.char_ptr--;
-            string.char_ptr[0] = '0';
-            return *this;
-        }
+INLINE u8x16 addSaturated(const u8x16 &a, const u8x16 &b) { return _mm_adds_epu8(a.v, b.v); }
+INLINE u8x16 subSaturated(const u8x16 &a, const u8x16 &b) { return _mm_subs_epu8(a.v, b.v); }
+INLINE u8x16 average(const u8x16 &a, const u8x16 &b) { return _mm_avg_epu8(a.v, b.v); } // Rounding up
+INLINE u8x16 minimum(const u8x16 &a, const u8x16 &b) { return _mm_min_epu8(a.v, b.v); }
+INLINE u8x16 maximum(const u8x16 &a, const u8x16 &b) { return _mm_max_epu8(a.v, b.v); }
+INLINE u8x16 select(const u8x16 &mask, const u8x16 &a, const u8x16 &b) { return _mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v)); }
+#else
+// The scalar backends keep the lanes in arrays (and masks as lanes with all their bits set):
+INLINE f32 _maskLane(bool is_set) {
+    union { u32 bits; f32 value; } lane{is_set ? 0xFFFFFFFF : 0};
+    return lane.value;
+}
 
-        bool is_negative = number < 0;
-        bool is_fraction = is_negative ? number > -1 : number < 1;
+INLINE u32 _laneBits(f32 value) {
+    union { f32 value; u32 bits; } lane{value};
+    return lane.bits;
+}
 
-        *this = int_num;
+INLINE f32 _bitsLane(u32 bits) {
+    union { u32 bits; f32 value; } lane{bits};
+    return lane.value;
+}
 
-        if (is_fraction) {
-            u32 len = string.length;
-            string.length++;
-            string.char_ptr--;
-            if (is_negative) {
-                string.char_ptr[0] = '-';
-                string.char_ptr[1] = '0';
-            } else
-                string.char_ptr[0] = '0';
+struct f32x4 {
+    static constexpr u32 width = 4;
+    f32 v[4];
 
-            if (len < float_digits_count) {
-                for (u32 i = 0; i < (float_digits_count - len); i++) {
-                    string.length++;
-                    string.char_ptr--;
-                    string.char_ptr[0] = '0';
-                }
-            }
-        }
+    INLINE f32x4() = default;
+    INLINE f32x4(f32 value) : v{value, value, value, value} {}
 
-        static char tmp[13];
-        tmp[string.length + 1] = 0;
-        for (u8 i = 0; i < (u8)string.length; i++) {
-            u8 char_count_from_right_to_left = (u8)string.length - i - 1;
-            if (char_count_from_right_to_left >= float_digits_count) tmp[i] = string.char_ptr[i];
-            else                                                     tmp[i + 1] = string.char_ptr[i];
-        }
-        tmp[string.length - float_digits_count] = '.';
-        string.copyFrom(tmp, 0);
-        if (is_negative) string.length++;
+    INLINE static f32x4 load(const f32 *values) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[i]; return result; }
+    INLINE void store(f32 *values) const { for (u32 i = 0; i < 4; i++) values[i] = v[i]; }
 
-        return *this;
-    }
+    INLINE f32x4 operator + (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] + rhs.v[i]; return result; }
+    INLINE f32x4 operator - (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] - rhs.v[i]; return result; }
+    INLINE f32x4 operator * (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] * rhs.v[i]; return result; }
+    INLINE f32x4 operator / (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] / rhs.v[i]; return result; }
+    INLINE f32x4 operator & (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _bitsLane(_laneBits(v[i]) & _laneBits(rhs.v[i])); return result; }
+    INLINE f32x4 operator | (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _bitsLane(_laneBits(v[i]) | _laneBits(rhs.v[i])); return result; }
+    INLINE f32x4 operator <  (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] <  rhs.v[i]); return result; }
+    INLINE f32x4 operator <= (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] <= rhs.v[i]); return result; }
+    INLINE f32x4 operator >  (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] >  rhs.v[i]); return result; }
+    INLINE f32x4 operator >= (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] >= rhs.v[i]); return result; }
+    INLINE f32x4 operator == (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] == rhs.v[i]); return result; }
+    INLINE u32 mask() const { u32 bits = 0; for (u32 i = 0; i < 4; i++) bits |= (_laneBits(v[i]) >> 31) << i; return bits; }
 };
 
+INLINE f32x4 minimum(const f32x4 &a, const f32x4 &b) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE f32x4 maximum(const f32x4 &a, const f32x4 &b) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE f32x4 sqrt(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = sqrtf(a.v[i]); return result; }
+INLINE f32x4 approxRsqrt(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = 1.0f / sqrtf(a.v[i]); return result; }
+INLINE f32x4 approxRcp(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = 1.0f / a.v[i]; return result; }
+INLINE f32x4 mulAdd(const f32x4 &a, const f32x4 &b, const f32x4 &c) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = fast_mul_add(a.v[i], b.v[i], c.v[i]); return result; }
+INLINE f32x4 select(const f32x4 &mask, const f32x4 &a, const f32x4 &b) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _laneBits(mask.v[i]) ? a.v[i] : b.v[i]; return result; }
+INLINE f32x4 floor(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = floorf(a.v[i]); return result; }
+INLINE void deinterleave(const f32x4 &a, const f32x4 &b, f32x4 &even, f32x4 &odd) {
+    for (u32 i = 0; i < 2; i++) {
+        even.v[i] = a.v[2 * i]; even.v[i + 2] = b.v[2 * i];
+        odd.v[i] = a.v[2 * i + 1]; odd.v[i + 2] = b.v[2 * i + 1];
+    }
+}
+INLINE void interleave(const f32x4 &even, const f32x4 &odd, f32x4 &a, f32x4 &b) {
+    for (u32 i = 0; i < 2; i++) {
+        a.v[2 * i] = even.v[i]; a.v[2 * i + 1] = odd.v[i];
+        b.v[2 * i] = even.v[i + 2]; b.v[2 * i + 1] = odd.v[i + 2];
+    }
+}
+
+struct i32x4 {
+    static constexpr u32 width = 4;
+    i32 v[4];
+
+    INLINE i32x4() = default;
+    INLINE i32x4(i32 value) : v{value, value, value, value} {}
+
+    INLINE static i32x4 load(const i32 *values) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[i]; return result; }
+    INLINE void store(i32 *values) const { for (u32 i = 0; i < 4; i++) values[i] = v[i]; }
+
+    INLINE i32x4 operator + (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)v[i] + (u32)rhs.v[i]); return result; }
+    INLINE i32x4 operator - (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)v[i] - (u32)rhs.v[i]); return result; }
+    INLINE i32x4 operator & (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] & rhs.v[i]; return result; }
+    INLINE i32x4 operator | (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] | rhs.v[i]; return result; }
+    INLINE i32x4 operator ^ (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] ^ rhs.v[i]; return result; }
+    INLINE i32x4 operator ~ () const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = ~v[i]; return result; }
+    INLINE i32x4 operator << (i32 bits) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)v[i] << bits); return result; }
+    INLINE i32x4 operator >> (i32 bits) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] >> bits; return result; }
+    INLINE i32x4 operator == (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] == rhs.v[i] ? -1 : 0; return result; }
+    INLINE i32x4 operator >  (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] >  rhs.v[i] ? -1 : 0; return result; }
+    INLINE i32x4 operator <  (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] <  rhs.v[i] ? -1 : 0; return result; }
+    INLINE u32 mask() const { u32 bits = 0; for (u32 i = 0; i < 4; i++) bits |= ((u32)v[i] >> 31) << i; return bits; }
+};
 
-template <typename T>
-u32 getSizeInBytes(const Image<T> &image) {
-    return sizeof(T) * image.size * (image.flags.channel ? (image.flags.alpha ? 4 : 3) : 1);
-}
+INLINE i32x4 mulLow(const i32x4 &a, const i32x4 &b) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)a.v[i] * (u32)b.v[i]); return result; }
+INLINE i32x4 andNot(const i32x4 &mask, const i32x4 &a) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = ~mask.v[i] & a.v[i]; return result; }
+INLINE i32x4 select(const i32x4 &mask, const i32x4 &a, const i32x4 &b) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = mask.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE i32x4 truncateToI32(const f32x4 &a) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)a.v[i]; return result; }
+INLINE f32x4 toF32(const i32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (f32)a.v[i]; return result; }
+INLINE i32x4 gather(const i32 *values, const i32x4 &indices) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[indices.v[i]]; return result; }
+INLINE f32x4 gather(const f32 *values, const i32x4 &indices) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[indices.v[i]]; return result; }
+
+struct u8x16 {
+    static constexpr u32 width = 16;
+    u8 v[16];
+
+    INLINE u8x16() = default;
+    INLINE u8x16(u8 value) { for (u32 i = 0; i < 16; i++) v[i] = value; }
+
+    INLINE static u8x16 load(const u8 *values) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = values[i]; return result; }
+    INLINE void store(u8 *values) const { for (u32 i = 0; i < 16; i++) values[i] = v[i]; }
+
+    INLINE u8x16 operator + (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = (u8)(v[i] + rhs.v[i]); return result; }
+    INLINE u8x16 operator - (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = (u8)(v[i] - rhs.v[i]); return result; }
+    INLINE u8x16 operator & (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = v[i] & rhs.v[i]; return result; }
+    INLINE u8x16 operator | (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = v[i] | rhs.v[i]; return result; }
+    INLINE u8x16 operator == (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = v[i] == rhs.v[i] ? 0xFF : 0; return result; }
+    INLINE u32 mask() const { u32 bits = 0; for (u32 i = 0; i < 16; i++) bits |= (u32)(v[i] >> 7) << i; return bits; }
+};
 
-template <typename T>
-bool allocateMemory(Image<T> &image, memory::MonotonicAllocator *memory_allocator) {
-    u32 size = getSizeInBytes(image);
-    if (size > (memory_allocator->capacity - memory_allocator->occupied)) return false;
-    image.content = (T*)memory_allocator->allocate(size);
-    return true;
-}
+INLINE u8x16 addSaturated(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) { u32 sum = a.v[i] + b.v[i]; result.v[i] = (u8)(sum < 255 ? sum : 255); } return result; }
+INLINE u8x16 subSaturated(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = a.v[i] > b.v[i] ? (u8)(a.v[i] - b.v[i]) : 0; return result; }
+INLINE u8x16 average(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = (u8)((a.v[i] + b.v[i] + 1) >> 1); return result; }
+INLINE u8x16 minimum(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE u8x16 maximum(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE u8x16 select(const u8x16 &mask, const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = mask.v[i] ? a.v[i] : b.v[i]; return result; }
+#endif
 
-template <typename T>
-void readContent(Image<T> &image, void *file) {
-    os::readFromFile((void*)image.content, getSizeInBytes(image), file);
-}
+// Without AVX2, the 8-wide types are pairs of 4-wide ones:
+#ifdef SLIM_AVX2
+struct f32x8 {
+    static constexpr u32 width = 8;
+    __m256 v;
+
+    f32x8() = default;
+    SLIM_INLINE_AVX2 f32x8(__m256 v) : v{v} {}
+    SLIM_INLINE_AVX2 f32x8(f32 value) : v{_mm256_set1_ps(value)} {}
+
+    SLIM_INLINE_AVX2 static f32x8 load(const f32 *values) { return _mm256_loadu_ps(values); }
+    SLIM_INLINE_AVX2 void store(f32 *values) const { _mm256_storeu_ps(values, v); }
+
+    SLIM_INLINE_AVX2 f32x8 operator + (const f32x8 &rhs) const { return _mm256_add_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator - (const f32x8 &rhs) const { return _mm256_sub_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator * (const f32x8 &rhs) const { return _mm256_mul_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator / (const f32x8 &rhs) const { return _mm256_div_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator & (const f32x8 &rhs) const { return _mm256_and_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator | (const f32x8 &rhs) const { return _mm256_or_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator <  (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_LT_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator <= (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_LE_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator >  (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_GT_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator >= (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_GE_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator == (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_EQ_OQ); }
+    SLIM_INLINE_AVX2 u32 mask() const { return (u32)_mm256_movemask_ps(v); }
+};
 
-template <typename T>
-void writeContent(const Image<T> &image, void *file) {
-    os::writeToFile((void*)image.content, getSizeInBytes(image), file);
+SLIM_INLINE_AVX2 f32x8 minimum(const f32x8 &a, const f32x8 &b) { return _mm256_min_ps(a.v, b.v); }
+SLIM_INLINE_AVX2 f32x8 maximum(const f32x8 &a, const f32x8 &b) { return _mm256_max_ps(a.v, b.v); }
+SLIM_INLINE_AVX2 f32x8 sqrt(const f32x8 &a) { return _mm256_sqrt_ps(a.v); }
+SLIM_INLINE_AVX2 f32x8 approxRsqrt(const f32x8 &a) { return _mm256_rsqrt_ps(a.v); }
+SLIM_INLINE_AVX2 f32x8 approxRcp(const f32x8 &a) { return _mm256_rcp_ps(a.v); }
+#ifdef FP_FAST_FMAF
+SLIM_INLINE_AVX2 f32x8 mulAdd(const f32x8 &a, const f32x8 &b, const f32x8 &c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+#else
+SLIM_INLINE_AVX2 f32x8 mulAdd(const f32x8 &a, const f32x8 &b, const f32x8 &c) { return _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v); }
+#endif
+SLIM_INLINE_AVX2 f32x8 select(const f32x8 &mask, const f32x8 &a, const f32x8 &b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+SLIM_INLINE_AVX2 f32x8 floor(const f32x8 &a) { return _mm256_floor_ps(a.v); }
+
+// Shuffles happen within 128-bit halves, so the halves then get put back in order:
+SLIM_INLINE_AVX2 void deinterleave(const f32x8 &a, const f32x8 &b, f32x8 &even, f32x8 &odd) {
+    even = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+    odd  = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+SLIM_INLINE_AVX2 void interleave(const f32x8 &even, const f32x8 &odd, f32x8 &a, f32x8 &b) {
+    __m256 low  = _mm256_unpacklo_ps(even.v, odd.v);
+    __m256 high = _mm256_unpackhi_ps(even.v, odd.v);
+    a = _mm256_permute2f128_ps(low, high, 0x20);
+    b = _mm256_permute2f128_ps(low, high, 0x31);
+}
+
+struct i32x8 {
+    static constexpr u32 width = 8;
+    __m256i v;
+
+    i32x8() = default;
+    SLIM_INLINE_AVX2 i32x8(__m256i v) : v{v} {}
+    SLIM_INLINE_AVX2 i32x8(i32 value) : v{_mm256_set1_epi32(value)} {}
+
+    SLIM_INLINE_AVX2 static i32x8 load(const i32 *values) { return _mm256_loadu_si256((const __m256i*)values); }
+    SLIM_INLINE_AVX2 void store(i32 *values) const { _mm256_storeu_si256((__m256i*)values, v); }
+
+    SLIM_INLINE_AVX2 i32x8 operator + (const i32x8 &rhs) const { return _mm256_add_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator - (const i32x8 &rhs) const { return _mm256_sub_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator & (const i32x8 &rhs) const { return _mm256_and_si256(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator | (const i32x8 &rhs) const { return _mm256_or_si256(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator ^ (const i32x8 &rhs) const { return _mm256_xor_si256(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator ~ () const { return _mm256_xor_si256(v, _mm256_set1_epi32(-1)); }
+    SLIM_INLINE_AVX2 i32x8 operator << (i32 bits) const { return _mm256_sll_epi32(v, _mm_cvtsi32_si128(bits)); }
+    SLIM_INLINE_AVX2 i32x8 operator >> (i32 bits) const { return _mm256_sra_epi32(v, _mm_cvtsi32_si128(bits)); }
+    SLIM_INLINE_AVX2 i32x8 operator == (const i32x8 &rhs) const { return _mm256_cmpeq_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator >  (const i32x8 &rhs) const { return _mm256_cmpgt_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator <  (const i32x8 &rhs) const { return _mm256_cmpgt_epi32(rhs.v, v); }
+    SLIM_INLINE_AVX2 u32 mask() const { return (u32)_mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+};
+
+SLIM_INLINE_AVX2 i32x8 mulLow(const i32x8 &a, const i32x8 &b) { return _mm256_mullo_epi32(a.v, b.v); }
+SLIM_INLINE_AVX2 i32x8 andNot(const i32x8 &mask, const i32x8 &a) { return _mm256_andnot_si256(mask.v, a.v); }
+SLIM_INLINE_AVX2 i32x8 select(const i32x8 &mask, const i32x8 &a, const i32x8 &b) { return _mm256_blendv_epi8(b.v, a.v, mask.v); }
+SLIM_INLINE_AVX2 i32x8 truncateToI32(const f32x8 &a) { return _mm256_cvttps_epi32(a.v); }
+SLIM_INLINE_AVX2 f32x8 toF32(const i32x8 &a) { return _mm256_cvtepi32_ps(a.v); }
+SLIM_INLINE_AVX2 i32x8 gather(const i32 *values, const i32x8 &indices) { return _mm256_i32gather_epi32((const int*)values, indices.v, 4); }
+SLIM_INLINE_AVX2 f32x8 gather(const f32 *values, const i32x8 &indices) { return _mm256_i32gather_ps(values, indices.v, 4); }
+#else
+struct f32x8 {
+    static constexpr u32 width = 8;
+    f32x4 low, high;
+
+    INLINE f32x8() = default;
+    INLINE f32x8(const f32x4 &low, const f32x4 &high) : low{low}, high{high} {}
+    INLINE f32x8(f32 value) : low{value}, high{value} {}
+
+    INLINE static f32x8 load(const f32 *values) { return {f32x4::load(values), f32x4::load(values + 4)}; }
+    INLINE void store(f32 *values) const { low.store(values); high.store(values + 4); }
+
+    INLINE f32x8 operator + (const f32x8 &rhs) const { return {low + rhs.low, high + rhs.high}; }
+    INLINE f32x8 operator - (const f32x8 &rhs) const { return {low - rhs.low, high - rhs.high}; }
+    INLINE f32x8 operator * (const f32x8 &rhs) const { return {low * rhs.low, high * rhs.high}; }
+    INLINE f32x8 operator / (const f32x8 &rhs) const { return {low / rhs.low, high / rhs.high}; }
+    INLINE f32x8 operator & (const f32x8 &rhs) const { return {low & rhs.low, high & rhs.high}; }
+    INLINE f32x8 operator | (const f32x8 &rhs) const { return {low | rhs.low, high | rhs.high}; }
+    INLINE f32x8 operator <  (const f32x8 &rhs) const { return {low <  rhs.low, high <  rhs.high}; }
+    INLINE f32x8 operator <= (const f32x8 &rhs) const { return {low <= rhs.low, high <= rhs.high}; }
+    INLINE f32x8 operator >  (const f32x8 &rhs) const { return {low >  rhs.low, high >  rhs.high}; }
+    INLINE f32x8 operator >= (const f32x8 &rhs) const { return {low >= rhs.low, high >= rhs.high}; }
+    INLINE f32x8 operator == (const f32x8 &rhs) const { return {low == rhs.low, high == rhs.high}; }
+    INLINE u32 mask() const { return low.mask() | high.mask() << 4; }
+};
+
+INLINE f32x8 minimum(const f32x8 &a, const f32x8 &b) { return {minimum(a.low, b.low), minimum(a.high, b.high)}; }
+INLINE f32x8 maximum(const f32x8 &a, const f32x8 &b) { return {maximum(a.low, b.low), maximum(a.high, b.high)}; }
+INLINE f32x8 sqrt(const f32x8 &a) { return {sqrt(a.low), sqrt(a.high)}; }
+INLINE f32x8 approxRsqrt(const f32x8 &a) { return {approxRsqrt(a.low), approxRsqrt(a.high)}; }
+INLINE f32x8 approxRcp(const f32x8 &a) { return {approxRcp(a.low), approxRcp(a.high)}; }
+INLINE f32x8 select(const f32x8 &mask, const f32x8 &a, const f32x8 &b) { return {select(mask.low, a.low, b.low), select(mask.high, a.high, b.high)}; }
+INLINE f32x8 floor(const f32x8 &a) { return {floor(a.low), floor(a.high)}; }
+INLINE void deinterleave(const f32x8 &a, const f32x8 &b, f32x8 &even, f32x8 &odd) {
+    deinterleave(a.low, a.high, even.low, odd.low);
+    deinterleave(b.low, b.high, even.high, odd.high);
+}
+INLINE void interleave(const f32x8 &even, const f32x8 &odd, f32x8 &a, f32x8 &b) {
+    interleave(even.low, odd.low, a.low, a.high);
+    interleave(even.high, odd.high, b.low, b.high);
+}
+
+struct i32x8 {
+    static constexpr u32 width = 8;
+    i32x4 low, high;
+
+    INLINE i32x8() = default;
+    INLINE i32x8(const i32x4 &low, const i32x4 &high) : low{low}, high{high} {}
+    INLINE i32x8(i32 value) : low{value}, high{value} {}
+
+    INLINE static i32x8 load(const i32 *values) { return {i32x4::load(values), i32x4::load(values + 4)}; }
+    INLINE void store(i32 *values) const { low.store(values); high.store(values + 4); }
+
+    INLINE i32x8 operator + (const i32x8 &rhs) const { return {low + rhs.low, high + rhs.high}; }
+    INLINE i32x8 operator - (const i32x8 &rhs) const { return {low - rhs.low, high - rhs.high}; }
+    INLINE i32x8 operator & (const i32x8 &rhs) const { return {low & rhs.low, high & rhs.high}; }
+    INLINE i32x8 operator | (const i32x8 &rhs) const { return {low | rhs.low, high | rhs.high}; }
+    INLINE i32x8 operator ^ (const i32x8 &rhs) const { return {low ^ rhs.low, high ^ rhs.high}; }
+    INLINE i32x8 operator ~ () const { return {~low, ~high}; }
+    INLINE i32x8 operator << (i32 bits) const { return {low << bits, high << bits}; }
+    INLINE i32x8 operator >> (i32 bits) const { return {low >> bits, high >> bits}; }
+    INLINE i32x8 operator == (const i32x8 &rhs) const { return {low == rhs.low, high == rhs.high}; }
+    INLINE i32x8 operator >  (const i32x8 &rhs) const { return {low >  rhs.low, high >  rhs.high}; }
+    INLINE i32x8 operator <  (const i32x8 &rhs) const { return {low <  rhs.low, high <  rhs.high}; }
+    INLINE u32 mask() const { return low.mask() | high.mask() << 4; }
+};
+
+INLINE i32x8 mulLow(const i32x8 &a, const i32x8 &b) { return {mulLow(a.low, b.low), mulLow(a.high, b.high)}; }
+INLINE i32x8 andNot(const i32x8 &mask, const i32x8 &a) { return {andNot(mask.low, a.low), andNot(mask.high, a.high)}; }
+INLINE i32x8 select(const i32x8 &mask, const i32x8 &a, const i32x8 &b) { return {select(mask.low, a.low, b.low), select(mask.high, a.high, b.high)}; }
+INLINE i32x8 truncateToI32(const f32x8 &a) { return {truncateToI32(a.low), truncateToI32(a.high)}; }
+INLINE f32x8 toF32(const i32x8 &a) { return {toF32(a.low), toF32(a.high)}; }
+INLINE i32x8 gather(const i32 *values, const i32x8 &indices) { return {gather(values, indices.low), gather(values, indices.high)}; }
+INLINE f32x8 gather(const f32 *values, const i32x8 &indices) { return {gather(values, indices.low), gather(values, indices.high)}; }
+#endif
+
+// Approximate reciprocal square roots refined by a Newton-Raphson step (to about 22 bits of precision):
+template <typename F32>
+SLIM_INLINE_KERNEL F32 refinedRsqrt(const F32 &value) {
+    F32 estimate = approxRsqrt(value);
+    return estimate * (F32{1.5f} - F32{0.5f} * value * estimate * estimate);
 }
 
-template <typename T>
-u32 getTotalMemoryForImages(String *image_files, u32 image_count) {
-    u32 memory_size{0};
-    for (u32 i = 0; i < image_count; i++) {
-        Image<T> image;
-        loadHeader(image, image_files[i].char_ptr);
-        memory_size += getSizeInBytes(image);
-    }
-    return memory_size;
+
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+// A fixed pool of worker threads, each owning a work-stealing deque (Chase-Lev).
+// The thread that submits a batch pushes it onto its own deque and helps running it until it is done,
+// while idle workers steal from the other end. Batches may be submitted from within jobs as well.
+// Threads are created lazily on first use (or by calling jobs::initialize() explicitly).
+// The thread that initializes the pool counts as the first worker. Other threads submitting batches claim deques of their own
+// (up to JOBS_MAX_SUBMITTER_COUNT of them, any further ones run their batches by themselves).
+// Lazy initialization is not thread safe, so pools submitted to from several threads are to be initialized up front.
+
+#ifndef JOBS_MAX_WORKER_COUNT
+#define JOBS_MAX_WORKER_COUNT 64
+#endif
+
+#ifndef JOBS_QUEUE_CAPACITY
+#define JOBS_QUEUE_CAPACITY 4096 // Must be a power of 2
+#endif
+
+#ifndef JOBS_MAX_SUBMITTER_COUNT
+#define JOBS_MAX_SUBMITTER_COUNT 8
+#endif
+
+#define JOBS_SPIN_COUNT 1024
+
+namespace atomics {
+#ifdef COMPILER_MSVC
+    INLINE i32 load(volatile i32 *value) { i32 result = *value; _ReadWriteBarrier(); return result; }
+    INLINE i64 load(volatile i64 *value) { return _InterlockedCompareExchange64(value, 0, 0); }
+    INLINE void store(volatile i32 *value, i32 new_value) { _InterlockedExchange((volatile long*)value, (long)new_value); }
+    INLINE void store(volatile i64 *value, i64 new_value) {
+        i64 old_value = *value;
+        i64 seen_value;
+        while ((seen_value = _InterlockedCompareExchange64(value, new_value, old_value)) != old_value) old_value = seen_value;
+    }
+    INLINE i32 add(volatile i32 *value, i32 amount) { return (i32)_InterlockedExchangeAdd((volatile long*)value, (long)amount) + amount; }
+    INLINE bool compareAndSwap(volatile i32 *value, i32 expected, i32 desired) { return _InterlockedCompareExchange((volatile long*)value, (long)desired, (long)expected) == (long)expected; }
+    INLINE bool compareAndSwap(volatile i64 *value, i64 expected, i64 desired) { return _InterlockedCompareExchange64(value, desired, expected) == expected; }
+    INLINE void fence() { _mm_mfence(); }
+    INLINE void pause() { _mm_pause(); }
+#else
+    INLINE i32 load(volatile i32 *value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+    INLINE i64 load(volatile i64 *value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+    INLINE void store(volatile i32 *value, i32 new_value) { __atomic_store_n(value, new_value, __ATOMIC_RELEASE); }
+    INLINE void store(volatile i64 *value, i64 new_value) { __atomic_store_n(value, new_value, __ATOMIC_RELEASE); }
+    INLINE i32 add(volatile i32 *value, i32 amount) { return __atomic_add_fetch(value, amount, __ATOMIC_ACQ_REL); }
+    INLINE bool compareAndSwap(volatile i32 *value, i32 expected, i32 desired) { return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED); }
+    INLINE bool compareAndSwap(volatile i64 *value, i64 expected, i64 desired) { return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED); }
+    INLINE void fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+    #if defined(__i386__) || defined(__x86_64__)
+    INLINE void pause() { __builtin_ia32_pause(); }
+    #else
+    INLINE void pause() {}
+    #endif
+#endif
 }
 
-template <typename T>
-struct ImagePack {
-    ImagePack(u8 count, Image<T> *images, char **files, char* adjacent_file, u64 memory_base = Terabytes(3)) {
-        char string_buffer[200];
-        u32 memory_size{0};
-        Image<T> *image = images;
-        for (u32 i = 0; i < count; i++, image++) {
-            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
-            loadHeader(*image, string.char_ptr);
-            memory_size += getSizeInBytes(*image);
+namespace jobs {
+    typedef void (*JobFunction)(void *data, u32 index);
+
+    struct Job {
+        JobFunction function;
+        void *data;
+        u32 index;
+        volatile i32 *pending;
+    };
+
+    struct WorkQueue {
+        volatile i64 top{0};
+        volatile i64 bottom{0};
+        Job jobs[JOBS_QUEUE_CAPACITY];
+
+        // Only ever called by the owning worker:
+        bool push(const Job &job) {
+            i64 b = atomics::load(&bottom);
+            i64 t = atomics::load(&top);
+            if (b - t >= JOBS_QUEUE_CAPACITY)
+                return false;
+
+            jobs[b & (JOBS_QUEUE_CAPACITY - 1)] = job;
+            atomics::store(&bottom, b + 1);
+            return true;
         }
-        memory::MonotonicAllocator memory_allocator{memory_size, memory_base};
 
-        image = images;
-        for (u32 i = 0; i < count; i++, image++) {
-            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
-            load(*image, string.char_ptr, &memory_allocator);
+        // Only ever called by the owning worker (takes the most recently pushed job):
+        bool pop(Job &job) {
+            i64 b = atomics::load(&bottom) - 1;
+            atomics::store(&bottom, b);
+            atomics::fence();
+            i64 t = atomics::load(&top);
+            if (t > b) { // Empty
+                atomics::store(&bottom, b + 1);
+                return false;
+            }
+
+            job = jobs[b & (JOBS_QUEUE_CAPACITY - 1)];
+            if (t == b) { // Last job, race against thieves for it:
+                bool won = atomics::compareAndSwap(&top, t, t + 1);
+                atomics::store(&bottom, b + 1);
+                return won;
+            }
+
+            return true;
         }
-    }
-};
 
-struct TexelQuadComponent {
-    u8 TL, TR, BL, BR;
-};
+        // Called by any other worker (takes the least recently pushed job):
+        bool steal(Job &job) {
+            i64 t = atomics::load(&top);
+            atomics::fence();
+            i64 b = atomics::load(&bottom);
+            if (t >= b)
+                return false;
 
-struct TexelQuad {
-    TexelQuadComponent R, G, B;
-};
+            job = jobs[t & (JOBS_QUEUE_CAPACITY - 1)];
+            return atomics::compareAndSwap(&top, t, t + 1);
+        }
+    };
 
-struct TextureMip {
-    u32 width, height;
-    TexelQuad *texel_quads;
+    WorkQueue *queues{nullptr}; // Of the workers, followed by the ones of other submitting threads
+    u32 worker_count{0};
+    volatile i32 submitter_count{0}; // Deques claimed by other threads (may go past JOBS_MAX_SUBMITTER_COUNT)
+    void *wake_up_semaphore{nullptr};
+    volatile i32 sleeping_worker_count{0};
+    thread_local i32 current_queue{-1}; // -1 until the thread is a worker or claims a deque (-2 when none were left)
 
-    INLINE_XPU Pixel sample(f32 u, f32 v) const {
-        if (u > 1) u -= (f32)((u32)u);
-        if (v > 1) v -= (f32)((u32)v);
+    INLINE void runJob(const Job &job) {
+        job.function(job.data, job.index);
+        atomics::add(job.pending, -1);
+    }
 
-        const f32 U = u * (f32)width  + 0.5f;
-        const f32 V = v * (f32)height + 0.5f;
-        const u32 x = (u32)U;
-        const u32 y = (u32)V;
-        const f32 r = U - (f32)x;
-        const f32 b = V - (f32)y;
-        const f32 l = 1 - r;
-        const f32 t = 1 - b;
-        const f32 tl = t * l * COLOR_COMPONENT_TO_FLOAT;
-        const f32 tr = t * r * COLOR_COMPONENT_TO_FLOAT;
-        const f32 bl = b * l * COLOR_COMPONENT_TO_FLOAT;
-        const f32 br = b * r * COLOR_COMPONENT_TO_FLOAT;
+    INLINE u32 getQueueCount() {
+        i32 submitters = atomics::load(&submitter_count);
+        return worker_count + (u32)(submitters < JOBS_MAX_SUBMITTER_COUNT ? submitters : JOBS_MAX_SUBMITTER_COUNT);
+    }
 
-        const TexelQuad texel_quad = texel_quads[y * (width + 1) + x];
-        return {
-                fast_mul_add((f32)texel_quad.R.BR, br, fast_mul_add((f32)texel_quad.R.BL, bl, fast_mul_add((f32)texel_quad.R.TR, tr, (f32)texel_quad.R.TL * tl))),
-                fast_mul_add((f32)texel_quad.G.BR, br, fast_mul_add((f32)texel_quad.G.BL, bl, fast_mul_add((f32)texel_quad.G.TR, tr, (f32)texel_quad.G.TL * tl))),
-                fast_mul_add((f32)texel_quad.B.BR, br, fast_mul_add((f32)texel_quad.B.BL, bl, fast_mul_add((f32)texel_quad.B.TR, tr, (f32)texel_quad.B.TL * tl))),
-                1.0f
-        };
+    bool findJob(u32 queue, Job &job) {
+        if (queues[queue].pop(job))
+            return true;
+
+        u32 queue_count = getQueueCount();
+        for (u32 i = 1; i < queue_count; i++)
+            if (queues[(queue + i) % queue_count].steal(job))
+                return true;
+
+        return false;
     }
-};
 
-struct Texture : ImageInfo {
-    TextureMip *mips = nullptr;
+    // Takes back a worker's count as asleep, unless submitters already took all of them for waking workers up:
+    bool cancelSleep() {
+        i32 sleeping = atomics::load(&sleeping_worker_count);
+        while (sleeping > 0) {
+            if (atomics::compareAndSwap(&sleeping_worker_count, sleeping, sleeping - 1))
+                return true;
 
-    XPU static u32 GetMipLevel(f32 texel_area, u32 mip_count) {
-        u32 mip_level = 0;
-        while (texel_area > 1 && ++mip_level < mip_count) texel_area *= 0.25f;
-        if (mip_level >= mip_count)
-            mip_level = mip_count - 1;
+            sleeping = atomics::load(&sleeping_worker_count);
+        }
+        return false;
+    }
+
+    void workerThread(void *parameter) {
+        u32 worker = (u32)(u64)parameter;
+        current_queue = (i32)worker;
+
+        Job job;
+        u32 spin_count = 0;
+        for (;;) {
+            if (findJob(worker, job)) {
+                runJob(job);
+                spin_count = 0;
+            } else if (++spin_count < JOBS_SPIN_COUNT)
+                atomics::pause();
+            else {
+                // Submitters only wake as many workers as are asleep, so wake-ups never accumulate.
+                // Jobs pushed before this worker counted itself as asleep woke nobody up, so it looks once more.
+                // When it finds one but a submitter already took its count, a wake-up is on its way and gets waited for:
+                atomics::add(&sleeping_worker_count, 1);
+                atomics::fence();
+                if (findJob(worker, job)) {
+                    runJob(job);
+                    if (!cancelSleep()) os::waitForSemaphore(wake_up_semaphore);
+                } else
+                    os::waitForSemaphore(wake_up_semaphore);
+                spin_count = 0;
+            }
+        }
+    }
 
-        return mip_level;
+    void wakeUpWorkers(u32 count) {
+        atomics::fence(); // The jobs are pushed before checking for sleepers (who check for jobs after counting themselves)
+        i32 sleeping = atomics::load(&sleeping_worker_count);
+        while (count && sleeping > 0) {
+            if (atomics::compareAndSwap(&sleeping_worker_count, sleeping, sleeping - 1)) {
+                os::signalSemaphore(wake_up_semaphore);
+                count--;
+            }
+            sleeping = atomics::load(&sleeping_worker_count);
+        }
     }
 
-    XPU static u32 GetMipLevel(u32 width, u32 height, u32 mip_count, f32 uv_area) {
-        return GetMipLevel(uv_area * (f32)(width * height), mip_count);
+    // The calling thread counts as the first worker, so a worker count of 1 runs everything inline:
+    bool initialize(u32 count = 0) {
+        if (queues) return true;
+
+        if (!count) count = os::getCoreCount();
+        if (count > JOBS_MAX_WORKER_COUNT) count = JOBS_MAX_WORKER_COUNT;
+        if (count < 1) count = 1;
+
+        queues = (WorkQueue*)os::getMemory(sizeof(WorkQueue) * (count + JOBS_MAX_SUBMITTER_COUNT));
+        if (!queues) return false;
+        for (u32 i = 0; i < count + JOBS_MAX_SUBMITTER_COUNT; i++) queues[i].top = queues[i].bottom = 0;
+        current_queue = 0;
+
+        if (count > 1) {
+            wake_up_semaphore = os::createSemaphore(0);
+            if (!wake_up_semaphore) count = 1;
+        }
+
+        // Set before any worker starts reading it, a worker that fails to start just leaves its queue empty:
+        worker_count = count;
+        for (u32 i = 1; i < count; i++)
+            if (!os::createThread(workerThread, (void*)(u64)i))
+                break;
+
+        return true;
     }
 
-    XPU static u32 GetMipLevel(const Texture &texture, f32 uv_area) {
-        return GetMipLevel(uv_area * (f32)(texture.width * texture.height), texture.mip_count);
+    // Gives a thread that is not a worker a deque of its own to submit from, returning false when none are left:
+    bool claimQueue() {
+        i32 submitter = atomics::add(&submitter_count, 1) - 1;
+        current_queue = submitter < JOBS_MAX_SUBMITTER_COUNT ? (i32)worker_count + submitter : -2;
+        return current_queue >= 0;
     }
 
-    INLINE_XPU Pixel sample(f32 u, f32 v, f32 uv_area) const {
-        return mips[flags.mipmap ? GetMipLevel(uv_area * (f32)(width * height), mip_count) : 0].sample(u, v);
+    // Runs function(data, index) for every index in [0, count), returning once all of them are done:
+    void run(JobFunction function, void *data, u32 count) {
+        if (!count) return;
+        if (!queues) initialize();
+        if (current_queue == -2 || (current_queue == -1 && !claimQueue())) {
+            for (u32 i = 0; i < count; i++) function(data, i);
+            return;
+        }
+
+        volatile i32 pending = (i32)count;
+        u32 worker = (u32)current_queue;
+        WorkQueue &queue = queues[worker];
+        Job job{function, data, 0, &pending};
+
+        // Pushed in reverse so that the owner pops the first jobs and thieves take the last ones:
+        u32 pushed = 0;
+        for (u32 i = count; i > 0; i--) {
+            job.index = i - 1;
+            if (!queue.push(job)) { // Full, run this one right away:
+                runJob(job);
+                continue;
+            }
+            if (worker_count > 1 && ++pushed == worker_count)
+                wakeUpWorkers(worker_count - 1);
+        }
+        if (worker_count > 1 && pushed < worker_count)
+            wakeUpWorkers(pushed);
+
+        while (atomics::load(&pending)) {
+            if (findJob(worker, job))
+                runJob(job);
+            else
+                atomics::pause();
+        }
     }
+
+    template <typename TileFunction>
+    struct TileBatch {
+        const TileFunction *function;
+        RectI bounds;
+        i32 tile_width;
+        i32 tile_height;
+        u32 columns;
+
+        static void runTile(void *data, u32 index) {
+            TileBatch<TileFunction> &batch = *(TileBatch<TileFunction>*)data;
+            i32 left = batch.bounds.left + (i32)(index % batch.columns) * batch.tile_width;
+            i32 top  = batch.bounds.top  + (i32)(index / batch.columns) * batch.tile_height;
+            RectI tile{left, left + batch.tile_width - 1, top, top + batch.tile_height - 1};
+            if (tile.right  > batch.bounds.right)  tile.right  = batch.bounds.right;
+            if (tile.bottom > batch.bounds.bottom) tile.bottom = batch.bounds.bottom;
+            (*batch.function)(tile);
+        }
+    };
+}
+
+// Splits the given (inclusive) bounds into tiles and calls tile_function(const RectI &tile) for each, in parallel:
+template <typename TileFunction>
+void parallelFor2D(RectI bounds, i32 tile_width, i32 tile_height, const TileFunction &tile_function) {
+    if (!bounds || tile_width < 1 || tile_height < 1)
+        return;
+
+    u32 columns = (u32)((bounds.right - bounds.left) / tile_width) + 1;
+    u32 rows = (u32)((bounds.bottom - bounds.top) / tile_height) + 1;
+    jobs::TileBatch<TileFunction> batch{&tile_function, bounds, tile_width, tile_height, columns};
+    jobs::run(jobs::TileBatch<TileFunction>::runTile, &batch, columns * rows);
+}
+
+
+// Resolving converts canvas pixels (linear, squared color) into window content (sRGB-ish bytes, 0x00RRGGBB).
+// The scalar kernels define the reference output (Pixel::asContent, averaging pixel quads for SSAA),
+// the SIMD kernels reproduce it bit-for-bit: Components are averaged in single precision in the same order,
+// then square rooted and scaled to bytes in double precision. So is the scalar path, as the unqualified sqrt() of
+// Pixel::asContent resolves to the C library's double sqrt(), with <cmath> declaring the float overload in std only.
+// Both sides have to stay in double precision: Truncating the float sqrtf() * 255 instead rounds some roots that lie
+// just below a byte value up to it (136 of the floats in [0, 1], like 0.000138408301 giving 3 rather than 2).
+// Each canvas pixel storage format (see CanvasPixel) has its own resolvePixels() overload.
+
+enum ResolveKernel {
+    ResolveScalar,
+    ResolveSSE2,
+    ResolveAVX2
 };
 
-u32 getSizeInBytes(const Texture &texture) {
-    u32 mip_width  = texture.width;
-    u32 mip_height = texture.height;
-    u32 memory_size = 0;
+// The AVX2 kernels are also the best ones for AVX-512 CPUs:
+ResolveKernel getBestResolveKernel() {
+    switch (simd::level) {
+        case SimdAVX512:
+        case SimdAVX2: return ResolveAVX2;
+        case SimdSSE2: return ResolveSSE2;
+        default:       return ResolveScalar;
+    }
+}
+
+namespace resolve {
+    ResolveKernel kernel = getBestResolveKernel();
+    bool multithreaded = true;
+}
+
+void _resolvePixelsScalar(const Pixel *pixels, u32 *content, u32 count) {
+    for (u32 i = 0; i < count; i++, pixels++)
+        content[i] = pixels->opacity == 0.0f ? 0 : pixels->asContent();
+}
+
+void _resolvePixelQuadsScalar(const Pixel *pixel_quads, u32 *content, u32 count) {
+    for (u32 i = 0; i < count; i++, pixel_quads += 4)
+        content[i] = (
+                (pixel_quads[0].opacity == 0.0f) &&
+                (pixel_quads[1].opacity == 0.0f) &&
+                (pixel_quads[2].opacity == 0.0f) &&
+                (pixel_quads[3].opacity == 0.0f)
+        ) ? 0 : ((pixel_quads[0] + pixel_quads[1] + pixel_quads[2] + pixel_quads[3]) * 0.25f).asContent();
+}
+
+#ifdef SLIM_SSE2
+// Color components above 1 are clamped to 1 (giving 255), min(1, NaN) stays NaN and truncates to 0 like the scalar cast:
+INLINE __m128i _resolveComponentsSSE2(__m128 components) {
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d scale = _mm_set1_pd(FLOAT_TO_COLOR_COMPONENT);
+    __m128d low  = _mm_cvtps_pd(components);
+    __m128d high = _mm_cvtps_pd(_mm_movehl_ps(components, components));
+    low  = _mm_mul_pd(_mm_sqrt_pd(_mm_min_pd(one, low)), scale);
+    high = _mm_mul_pd(_mm_sqrt_pd(_mm_min_pd(one, high)), scale);
+    __m128i values = _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+    return _mm_and_si128(values, _mm_set1_epi32(MAX_COLOR_VALUE));
+}
+
+INLINE __m128i _packContentSSE2(__m128i R, __m128i G, __m128i B, __m128 transparent) {
+    __m128i content = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(R, 16), _mm_slli_epi32(G, 8)), B);
+    return _mm_andnot_si128(_mm_castps_si128(transparent), content);
+}
+
+// Averages 4 consecutive pixels in the same order as the scalar path: ((p0 + p1) + p2) + p3
+INLINE __m128 _blendPixelQuadSSE2(const Pixel *pixel_quad) {
+    const f32 *components = (const f32*)pixel_quad;
+    __m128 sum = _mm_add_ps(_mm_loadu_ps(components), _mm_loadu_ps(components + 4));
+    sum = _mm_add_ps(sum, _mm_loadu_ps(components + 8));
+    sum = _mm_add_ps(sum, _mm_loadu_ps(components + 12));
+    return _mm_mul_ps(sum, _mm_set1_ps(0.25f));
+}
+
+INLINE __m128 _isTransparentPixelQuadSSE2(const Pixel *pixel_quad) {
+    const f32 *components = (const f32*)pixel_quad;
+    const __m128 zero = _mm_setzero_ps();
+    __m128 transparent = _mm_and_ps(_mm_cmpeq_ps(_mm_loadu_ps(components), zero), _mm_cmpeq_ps(_mm_loadu_ps(components + 4), zero));
+    transparent = _mm_and_ps(transparent, _mm_cmpeq_ps(_mm_loadu_ps(components + 8), zero));
+    return _mm_and_ps(transparent, _mm_cmpeq_ps(_mm_loadu_ps(components + 12), zero));
+}
+
+void _resolvePixelsSSE2(const Pixel *pixels, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixels += 4) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r = _mm_loadu_ps(components);
+        __m128 g = _mm_loadu_ps(components + 4);
+        __m128 b = _mm_loadu_ps(components + 8);
+        __m128 a = _mm_loadu_ps(components + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        __m128 transparent = _mm_cmpeq_ps(a, _mm_setzero_ps());
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _resolveComponentsSSE2(r),
+                _resolveComponentsSSE2(g),
+                _resolveComponentsSSE2(b),
+                transparent));
+    }
+    if (i < count) _resolvePixelsScalar(pixels, content + i, count - i);
+}
+
+void _resolvePixelQuadsSSE2(const Pixel *pixel_quads, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixel_quads += 16) {
+        __m128 r = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a = _blendPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        // Only the opacity lane of each quad's mask matters, it ends up as the last row once transposed:
+        __m128 t0 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t1 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t2 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(t0, t1, t2, transparent);
+
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _resolveComponentsSSE2(r),
+                _resolveComponentsSSE2(g),
+                _resolveComponentsSSE2(b),
+                transparent));
+    }
+    if (i < count) _resolvePixelQuadsScalar(pixel_quads, content + i, count - i);
+}
+#endif
 
-    do {
-        memory_size += sizeof(TextureMip);
-        memory_size += (mip_width + 1) * (mip_height + 1) * sizeof(TexelQuad);
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 INLINE __m128i _resolveComponentsAVX2(__m128 components) {
+    __m256d values = _mm256_cvtps_pd(components);
+    values = _mm256_min_pd(_mm256_set1_pd(1.0), values);
+    values = _mm256_mul_pd(_mm256_sqrt_pd(values), _mm256_set1_pd(FLOAT_TO_COLOR_COMPONENT));
+    return _mm256_cvttpd_epi32(values);
+}
+
+SLIM_TARGET_AVX2 INLINE __m256i _packContentAVX2(__m128i R0, __m128i G0, __m128i B0, __m128 transparent0,
+                                                 __m128i R1, __m128i G1, __m128i B1, __m128 transparent1) {
+    const __m256i mask = _mm256_set1_epi32(MAX_COLOR_VALUE);
+    __m256i R = _mm256_and_si256(_mm256_setr_m128i(R0, R1), mask);
+    __m256i G = _mm256_and_si256(_mm256_setr_m128i(G0, G1), mask);
+    __m256i B = _mm256_and_si256(_mm256_setr_m128i(B0, B1), mask);
+    __m256i transparent = _mm256_castps_si256(_mm256_setr_m128(transparent0, transparent1));
+    __m256i content = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(R, 16), _mm256_slli_epi32(G, 8)), B);
+    return _mm256_andnot_si256(transparent, content);
+}
+
+SLIM_TARGET_AVX2 void _resolvePixelsAVX2(const Pixel *pixels, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixels += 8) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r0 = _mm_loadu_ps(components);
+        __m128 g0 = _mm_loadu_ps(components + 4);
+        __m128 b0 = _mm_loadu_ps(components + 8);
+        __m128 a0 = _mm_loadu_ps(components + 12);
+        __m128 r1 = _mm_loadu_ps(components + 16);
+        __m128 g1 = _mm_loadu_ps(components + 20);
+        __m128 b1 = _mm_loadu_ps(components + 24);
+        __m128 a1 = _mm_loadu_ps(components + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+        _mm256_storeu_si256((__m256i*)(content + i), _packContentAVX2(
+                _resolveComponentsAVX2(r0), _resolveComponentsAVX2(g0), _resolveComponentsAVX2(b0), _mm_cmpeq_ps(a0, _mm_setzero_ps()),
+                _resolveComponentsAVX2(r1), _resolveComponentsAVX2(g1), _resolveComponentsAVX2(b1), _mm_cmpeq_ps(a1, _mm_setzero_ps())));
+    }
+    if (i < count) _resolvePixelsSSE2(pixels, content + i, count - i);
+}
+
+SLIM_TARGET_AVX2 void _resolvePixelQuadsAVX2(const Pixel *pixel_quads, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixel_quads += 32) {
+        __m128 r0 = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g0 = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b0 = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a0 = _blendPixelQuadSSE2(pixel_quads + 12);
+        __m128 r1 = _blendPixelQuadSSE2(pixel_quads + 16);
+        __m128 g1 = _blendPixelQuadSSE2(pixel_quads + 20);
+        __m128 b1 = _blendPixelQuadSSE2(pixel_quads + 24);
+        __m128 a1 = _blendPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+
+        __m128 t00 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t01 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t02 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent0 = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        __m128 t10 = _isTransparentPixelQuadSSE2(pixel_quads + 16);
+        __m128 t11 = _isTransparentPixelQuadSSE2(pixel_quads + 20);
+        __m128 t12 = _isTransparentPixelQuadSSE2(pixel_quads + 24);
+        __m128 transparent1 = _isTransparentPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(t00, t01, t02, transparent0);
+        _MM_TRANSPOSE4_PS(t10, t11, t12, transparent1);
+
+        _mm256_storeu_si256((__m256i*)(content + i), _packContentAVX2(
+                _resolveComponentsAVX2(r0), _resolveComponentsAVX2(g0), _resolveComponentsAVX2(b0), transparent0,
+                _resolveComponentsAVX2(r1), _resolveComponentsAVX2(g1), _resolveComponentsAVX2(b1), transparent1));
+    }
+    if (i < count) _resolvePixelQuadsSSE2(pixel_quads, content + i, count - i);
+}
+#endif
 
-        mip_width /= 2;
-        mip_height /= 2;
-    } while (texture.flags.mipmap && mip_width > 2 && mip_height > 2);
+// Resolves a row (or any contiguous run) of pixels, or of pixel quads when super-sampled:
+void resolvePixels(const Pixel *pixels, u32 *content, u32 count, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    switch (kernel) {
+#ifdef SLIM_AVX2
+        case ResolveAVX2:
+            if (pixel_quads) _resolvePixelQuadsAVX2(pixels, content, count);
+            else             _resolvePixelsAVX2(pixels, content, count);
+            return;
+#endif
+#ifdef SLIM_SSE2
+        case ResolveSSE2:
+            if (pixel_quads) _resolvePixelQuadsSSE2(pixels, content, count);
+            else             _resolvePixelsSSE2(pixels, content, count);
+            return;
+#endif
+        default:
+            if (pixel_quads) _resolvePixelQuadsScalar(pixels, content, count);
+            else             _resolvePixelsScalar(pixels, content, count);
+    }
+}
 
-    return memory_size;
+// The byte format is stored as presented, so unless super-sampled its pixels only need their opacity masked out:
+void _resolveBytePixelsScalar(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    for (u32 i = 0; i < count; i++)
+        content[i] = pixels[i].A ? (pixels[i].value & 0x00FFFFFF) : 0;
 }
 
-bool allocateMemory(Texture &texture, memory::MonotonicAllocator *memory_allocator) {
-    u32 size = getSizeInBytes(texture);
-    if (size > (memory_allocator->capacity - memory_allocator->occupied)) return false;
-    texture.mips = (TextureMip*)memory_allocator->allocate(sizeof(TextureMip) * texture.mip_count);
-    TextureMip *texture_mip = texture.mips;
-    u32 mip_width  = texture.width;
-    u32 mip_height = texture.height;
+// Written once for both widths: Returns how many pixels got resolved, leaving the rest for the narrower kernel.
+template <typename I32>
+SLIM_INLINE_KERNEL u32 _resolveBytePixelsWide(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    const I32 color_mask{0x00FFFFFF};
+    const I32 zero{0};
+    u32 i = 0;
+    for (; i + I32::width <= count; i += I32::width) {
+        I32 values = I32::load((const i32*)(pixels + i));
+        I32 transparent = andNot(color_mask, values) == zero;
+        andNot(transparent, values & color_mask).store((i32*)(content + i));
+    }
+    return i;
+}
 
-    do {
-        texture_mip->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * (mip_height + 1) * (mip_width + 1));
-        mip_width /= 2;
-        mip_height /= 2;
-        texture_mip++;
-    } while (texture.flags.mipmap && mip_width > 2 && mip_height > 2);
+#ifdef SLIM_SSE2
+void _resolveBytePixelsSSE2(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    u32 i = _resolveBytePixelsWide<i32x4>(pixels, content, count);
+    if (i < count) _resolveBytePixelsScalar(pixels + i, content + i, count - i);
+}
+#endif
 
-    return true;
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 void _resolveBytePixelsAVX2(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    u32 i = _resolveBytePixelsWide<i32x8>(pixels, content, count);
+    if (i < count) _resolveBytePixelsSSE2(pixels + i, content + i, count - i);
 }
+#endif
 
-void readContent(Texture &texture, void *file) {
-    TextureMip *texture_mip = texture.mips;
-    for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
-        os::readFromFile(&texture_mip->width,  sizeof(u32), file);
-        os::readFromFile(&texture_mip->height, sizeof(u32), file);
-        os::readFromFile(texture_mip->texel_quads, sizeof(TexelQuad) * (texture_mip->width + 1) * (texture_mip->height + 1), file);
+// Other formats are decoded into pixels a chunk at a time, and resolved from there:
+#define RESOLVE_CHUNK_SIZE 256
+
+template <typename StoredPixel>
+void _resolveStoredPixels(const StoredPixel *pixels, u32 *content, u32 count, bool pixel_quads, ResolveKernel kernel) {
+    Pixel decoded_pixels[RESOLVE_CHUNK_SIZE];
+    u32 samples_per_pixel = pixel_quads ? 4 : 1;
+    u32 chunk_pixel_count = RESOLVE_CHUNK_SIZE / samples_per_pixel;
+    while (count) {
+        u32 pixel_count = count < chunk_pixel_count ? count : chunk_pixel_count;
+        u32 sample_count = pixel_count * samples_per_pixel;
+        for (u32 i = 0; i < sample_count; i++) decoded_pixels[i] = loadPixel(pixels[i]);
+        resolvePixels(decoded_pixels, content, pixel_count, pixel_quads, kernel);
+
+        pixels += sample_count;
+        content += pixel_count;
+        count -= pixel_count;
     }
 }
-void writeContent(const Texture &texture, void *file) {
-    TextureMip *texture_mip = texture.mips;
-    for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
-        os::writeToFile(&texture_mip->width,  sizeof(u32), file);
-        os::writeToFile(&texture_mip->height, sizeof(u32), file);
-        os::writeToFile(texture_mip->texel_quads, sizeof(TexelQuad) * (texture_mip->width + 1) * (texture_mip->height + 1), file);
+
+void resolvePixels(const PixelRGBA16F *pixels, u32 *content, u32 count, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    _resolveStoredPixels(pixels, content, count, pixel_quads, kernel);
+}
+
+void resolvePixels(const PixelRGBA8 *pixels, u32 *content, u32 count, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    if (pixel_quads) {
+        _resolveStoredPixels(pixels, content, count, pixel_quads, kernel);
+        return;
+    }
+
+    switch (kernel) {
+#ifdef SLIM_AVX2
+        case ResolveAVX2: _resolveBytePixelsAVX2(pixels, content, count); return;
+#endif
+#ifdef SLIM_SSE2
+        case ResolveSSE2: _resolveBytePixelsSSE2(pixels, content, count); return;
+#endif
+        default: _resolveBytePixelsScalar(pixels, content, count);
     }
 }
 
-u32 getTotalMemoryForTextures(String *texture_files, u32 texture_count) {
-    u32 memory_size{0};
-    for (u32 i = 0; i < texture_count; i++) {
-        Texture texture;
-        loadHeader(texture, texture_files[i].char_ptr);
-        memory_size += getSizeInBytes(texture);
+
+// Color spaces that linear pixels get encoded into for the window (and that byte colors get decoded from):
+// By default canvases encode with a square root (gamma 2), as the reference resolve kernels do (see resolve.h).
+// The other color spaces go through lookup tables instead of evaluating their transfer functions per component:
+enum ColorSpace {
+    ColorSpaceGamma2,
+    ColorSpaceSRGB,
+    ColorSpaceGamma22,
+    ColorSpaceLinear
+};
+
+// The transfer functions the tables get built from (values are clamped to [0, 1]):
+f32 encodeColorComponent(f32 linear, ColorSpace color_space) {
+    linear = clampedValue(linear);
+    switch (color_space) {
+        case ColorSpaceGamma2:  return sqrtf(linear);
+        case ColorSpaceSRGB:    return linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+        case ColorSpaceGamma22: return powf(linear, 1.0f / 2.2f);
+        default:                return linear;
     }
-    return memory_size;
 }
 
-struct TexturePack {
-    TexturePack(u8 count, Texture *textures, char **files, char* adjacent_file, u64 memory_base = Terabytes(3)) {
-        char string_buffer[200];
-        u32 memory_size{0};
-        Texture *texture = textures;
-        for (u32 i = 0; i < count; i++, texture++) {
-            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
-            loadHeader(*texture, string.char_ptr);
-            memory_size += getSizeInBytes(*texture);
-        }
-        memory::MonotonicAllocator memory_allocator{memory_size, memory_base};
+f32 decodeColorComponent(f32 encoded, ColorSpace color_space) {
+    encoded = clampedValue(encoded);
+    switch (color_space) {
+        case ColorSpaceGamma2:  return encoded * encoded;
+        case ColorSpaceSRGB:    return encoded <= 0.04045f ? encoded / 12.92f : powf((encoded + 0.055f) / 1.055f, 2.4f);
+        case ColorSpaceGamma22: return powf(encoded, 2.2f);
+        default:                return encoded;
+    }
+}
 
-        texture = textures;
-        for (u32 i = 0; i < count; i++, texture++) {
-            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
-            load(*texture, string.char_ptr, &memory_allocator);
-        }
+// Encodes linear values in 16-bit fixed point (65535 being 1) to bytes, rounding to the nearest byte.
+// Gamma 2 (which truncates like Pixel::asContent() does) is encoded through linear16_to_byte instead.
+// There are 3 bytes of padding at the end, so that AVX2 can gather the bytes as 32-bit values:
+#define COLOR_ENCODE_TABLE_SIZE 65536
+
+struct ColorEncodeTable {
+    u8 values[COLOR_ENCODE_TABLE_SIZE + 3];
+    bool is_built;
+
+    void build(ColorSpace color_space) {
+        for (u32 i = 0; i < COLOR_ENCODE_TABLE_SIZE; i++)
+            values[i] = (u8)(FLOAT_TO_COLOR_COMPONENT * encodeColorComponent((f32)i / 65535.0f, color_space) + 0.5f);
+        is_built = true;
     }
 };
+ColorEncodeTable color_encode_tables[3]; // Of the color spaces after gamma 2
 
+// Tables are built on first use, so this is to be called before encoding from multiple threads:
+const u8* getColorEncodeTable(ColorSpace color_space) {
+    if (color_space == ColorSpaceGamma2)
+        return linear16_to_byte.values;
 
-struct HUDLine {
-    String title{}, alternate_value{};
-    NumberString value{};
-    enum ColorID title_color{BrightGrey};
-    enum ColorID value_color{BrightGrey};
-    enum ColorID alternate_value_color{Grey};
-    bool *use_alternate{nullptr};
-    bool invert_alternate_use{false};
+    ColorEncodeTable &table = color_encode_tables[color_space - 1];
+    if (!table.is_built) table.build(color_space);
+    return table.values;
+}
 
-    HUDLine(enum ColorID default_color = BrightGrey) :
-            title{},
-            alternate_value{},
-            value{},
-            title_color{default_color},
-            value_color{default_color} {}
-    HUDLine(char* title_char_ptr,
-            enum ColorID default_color = BrightGrey) :
-            title{title_char_ptr},
-            alternate_value{},
-            value{},
-            title_color{default_color},
-            value_color{default_color} {}
-    HUDLine(char* title_char_ptr,
-            char* value_char_ptr,
-            enum ColorID default_color = BrightGrey) :
-            title{title_char_ptr},
-            alternate_value{},
-            value{value_char_ptr},
-            title_color{default_color},
-            alternate_value_color{default_color}
-    {}
-    HUDLine(char* title_char_ptr,
-            char* value_char_ptr,
-            char* alternate_value_char_ptr,
-            bool *use_alternate = nullptr,
-            bool invert_alternate_use = false,
-            enum ColorID value_color = BrightGrey,
-            enum ColorID alternate_value_color = Grey,
-            enum ColorID title_color = BrightGrey) :
-            title{title_char_ptr},
-            alternate_value{alternate_value_char_ptr},
-            value{value_char_ptr},
-            title_color{title_color},
-            value_color{value_color},
-            alternate_value_color{alternate_value_color},
-            use_alternate{use_alternate},
-            invert_alternate_use{invert_alternate_use}
-    {}
-};
+// Decodes bytes to linear values, exactly as converting them to floats and applying the transfer function would:
+struct ColorDecodeTable {
+    f32 values[256];
 
-struct HUDSettings {
-    u32 line_count{0};
-    f32 line_height{1.0f};
-    enum ColorID default_color{BrightGrey};
+    explicit ColorDecodeTable(ColorSpace color_space) {
+        for (u32 i = 0; i < 256; i++) values[i] = decodeColorComponent((f32)i * COLOR_COMPONENT_TO_FLOAT, color_space);
+    }
 
-    HUDSettings(u32 line_count = 0,
-                f32 line_height = 1.0f,
-                ColorID default_color = BrightGrey) : line_count{line_count}, line_height{line_height}, default_color{default_color} {}
+    // As Color::applyGamma() does:
+    explicit ColorDecodeTable(f32 gamma) {
+        for (u32 i = 0; i < 256; i++) values[i] = powf((f32)i * COLOR_COMPONENT_TO_FLOAT, gamma);
+    }
 };
-struct HUD {
-    HUDSettings settings;
-    HUDLine *lines = nullptr;
-    i32 left = 10, top = 10;
-    bool enabled{true};
 
-    HUD() = default;
-    HUD(HUDSettings settings,
-        HUDLine *lines,
-        i32 left = 10,
-        i32 top = 10) :
-            settings{settings}, lines{lines}, left{left}, top{top} {
-        if (settings.default_color != BrightGrey) for (u32 i = 0; i < settings.line_count; i++)
-                lines[i].title_color = lines[i].alternate_value_color = lines[i].value_color = settings.default_color;
-    }
-    HUD(HUDSettings settings, memory::AllocateMemory allocate_memory = nullptr, i32 left = 10, i32 top = 10) : settings{settings}, left{left}, top{top} {
-        if (settings.line_count) {
-            lines = (HUDLine*)allocate_memory(settings.line_count * sizeof(HUDLine));
-            for (u32 i = 0; i < settings.line_count; i++)
-                lines[i] = HUDLine{settings.default_color};
-        }
+// Decodes B, G, R (and A) byte components into pixels, with opacity as a plain fraction (0 without alpha):
+void decodeColorComponents(const u8 *components, Pixel *pixels, u32 count, bool alpha, const ColorDecodeTable &table) {
+    const u32 component_count = alpha ? 4 : 3;
+    for (u32 i = 0; i < count; i++, components += component_count) {
+        f32 opacity = alpha ? (f32)components[3] * COLOR_COMPONENT_TO_FLOAT : 0.0f;
+#ifdef SLIM_SSE2
+        _mm_storeu_ps(&pixels[i].color.r, _mm_setr_ps(table.values[components[2]], table.values[components[1]], table.values[components[0]], opacity));
+#else
+        pixels[i] = Pixel{table.values[components[2]], table.values[components[1]], table.values[components[0]], opacity};
+#endif
     }
-};
+}
 
-#define SLIM_VEC2
+// Encoding linear pixels through a table works like resolving them does (transparent pixels giving 0, pixel quads averaged first),
+// with the components scaled to table indices in batches and the bytes looked up (gathered with AVX2):
+INLINE u32 _encodeComponent(f32 value, const u8 *table) {
+    value = value > 1.0f ? 1.0f : (value > 0.0f ? value : 0.0f); // NaN encodes as 0
+    return table[(u32)(value * 65535.0f + 0.5f)];
+}
 
+INLINE u32 _encodePixel(const Pixel &pixel, const u8 *table) {
+    return _encodeComponent(pixel.color.r, table) << 16 | _encodeComponent(pixel.color.g, table) << 8 | _encodeComponent(pixel.color.b, table);
+}
 
-struct vec2i {
-    i32 x, y;
+void _encodePixelsScalar(const Pixel *pixels, u32 *content, u32 count, const u8 *table) {
+    for (u32 i = 0; i < count; i++, pixels++)
+        content[i] = pixels->opacity == 0.0f ? 0 : _encodePixel(*pixels, table);
+}
 
-    INLINE_XPU vec2i() noexcept : vec2i{0} {}
-    INLINE_XPU vec2i(i32 x, i32 y) noexcept : x(x), y(y) {}
-    INLINE_XPU vec2i(vec2i &other) noexcept : vec2i{other.x, other.y} {}
-    INLINE_XPU explicit vec2i(i32 value) noexcept : vec2i{value, value} {}
+void _encodePixelQuadsScalar(const Pixel *pixel_quads, u32 *content, u32 count, const u8 *table) {
+    for (u32 i = 0; i < count; i++, pixel_quads += 4)
+        content[i] = (
+                (pixel_quads[0].opacity == 0.0f) &&
+                (pixel_quads[1].opacity == 0.0f) &&
+                (pixel_quads[2].opacity == 0.0f) &&
+                (pixel_quads[3].opacity == 0.0f)
+        ) ? 0 : _encodePixel((pixel_quads[0] + pixel_quads[1] + pixel_quads[2] + pixel_quads[3]) * 0.25f, table);
+}
 
-    INLINE_XPU bool operator == (const vec2i &other) const {
-        return (other.x == x) &&
-               (other.y == y);
-    }
+#ifdef SLIM_SSE2
+INLINE __m128i _toEncodeTableIndicesSSE2(__m128 components) {
+    components = _mm_min_ps(_mm_max_ps(components, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(components, _mm_set1_ps(65535.0f)), _mm_set1_ps(0.5f)));
+}
 
-    INLINE_XPU vec2i & operator = (f32 value) {
-        x = y = (i32)value;
-        return *this;
-    }
+INLINE __m128i _encodeComponentsSSE2(__m128 components, const u8 *table) {
+    alignas(16) u32 indices[4];
+    _mm_store_si128((__m128i*)indices, _toEncodeTableIndicesSSE2(components));
+    return _mm_setr_epi32(table[indices[0]], table[indices[1]], table[indices[2]], table[indices[3]]);
+}
 
-    INLINE_XPU vec2i & operator = (i32 value) {
-        x = y = value;
-        return *this;
+void _encodePixelsSSE2(const Pixel *pixels, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixels += 4) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r = _mm_loadu_ps(components);
+        __m128 g = _mm_loadu_ps(components + 4);
+        __m128 b = _mm_loadu_ps(components + 8);
+        __m128 a = _mm_loadu_ps(components + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _encodeComponentsSSE2(r, table),
+                _encodeComponentsSSE2(g, table),
+                _encodeComponentsSSE2(b, table),
+                _mm_cmpeq_ps(a, _mm_setzero_ps())));
     }
+    if (i < count) _encodePixelsScalar(pixels, content + i, count - i, table);
+}
 
-    INLINE_XPU bool operator ! () const {
-        return nonZero();
-    }
+void _encodePixelQuadsSSE2(const Pixel *pixel_quads, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixel_quads += 16) {
+        __m128 r = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a = _blendPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
 
-    INLINE_XPU vec2i operator - () const {
-        return {
-                -x,
-                -y
-        };
-    }
+        __m128 t0 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t1 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t2 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(t0, t1, t2, transparent);
 
-    INLINE_XPU vec2i operator - (const vec2i &rhs) const {
-        return {
-                x - rhs.x,
-                y - rhs.y
-        };
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _encodeComponentsSSE2(r, table),
+                _encodeComponentsSSE2(g, table),
+                _encodeComponentsSSE2(b, table),
+                transparent));
     }
+    if (i < count) _encodePixelQuadsScalar(pixel_quads, content + i, count - i, table);
+}
+#endif
 
-    INLINE_XPU vec2i operator + (const vec2i &rhs) const {
-        return {
-                x + rhs.x,
-                y + rhs.y
-        };
-    }
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 INLINE __m256i _encodeComponentsAVX2(__m128 components0, __m128 components1, const u8 *table) {
+    __m256i indices = _mm256_setr_m128i(_toEncodeTableIndicesSSE2(components0), _toEncodeTableIndicesSSE2(components1));
+    __m256i values = _mm256_i32gather_epi32((const int*)table, indices, 1);
+    return _mm256_and_si256(values, _mm256_set1_epi32(0xFF));
+}
+
+SLIM_TARGET_AVX2 INLINE __m256i _packEncodedContentAVX2(__m256i R, __m256i G, __m256i B, __m128 transparent0, __m128 transparent1) {
+    __m256i transparent = _mm256_castps_si256(_mm256_setr_m128(transparent0, transparent1));
+    __m256i content = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(R, 16), _mm256_slli_epi32(G, 8)), B);
+    return _mm256_andnot_si256(transparent, content);
+}
+
+SLIM_TARGET_AVX2 void _encodePixelsAVX2(const Pixel *pixels, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixels += 8) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r0 = _mm_loadu_ps(components);
+        __m128 g0 = _mm_loadu_ps(components + 4);
+        __m128 b0 = _mm_loadu_ps(components + 8);
+        __m128 a0 = _mm_loadu_ps(components + 12);
+        __m128 r1 = _mm_loadu_ps(components + 16);
+        __m128 g1 = _mm_loadu_ps(components + 20);
+        __m128 b1 = _mm_loadu_ps(components + 24);
+        __m128 a1 = _mm_loadu_ps(components + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+        _mm256_storeu_si256((__m256i*)(content + i), _packEncodedContentAVX2(
+                _encodeComponentsAVX2(r0, r1, table),
+                _encodeComponentsAVX2(g0, g1, table),
+                _encodeComponentsAVX2(b0, b1, table),
+                _mm_cmpeq_ps(a0, _mm_setzero_ps()),
+                _mm_cmpeq_ps(a1, _mm_setzero_ps())));
+    }
+    if (i < count) _encodePixelsSSE2(pixels, content + i, count - i, table);
+}
+
+SLIM_TARGET_AVX2 void _encodePixelQuadsAVX2(const Pixel *pixel_quads, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixel_quads += 32) {
+        __m128 r0 = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g0 = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b0 = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a0 = _blendPixelQuadSSE2(pixel_quads + 12);
+        __m128 r1 = _blendPixelQuadSSE2(pixel_quads + 16);
+        __m128 g1 = _blendPixelQuadSSE2(pixel_quads + 20);
+        __m128 b1 = _blendPixelQuadSSE2(pixel_quads + 24);
+        __m128 a1 = _blendPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+
+        __m128 t00 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t01 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t02 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent0 = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        __m128 t10 = _isTransparentPixelQuadSSE2(pixel_quads + 16);
+        __m128 t11 = _isTransparentPixelQuadSSE2(pixel_quads + 20);
+        __m128 t12 = _isTransparentPixelQuadSSE2(pixel_quads + 24);
+        __m128 transparent1 = _isTransparentPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(t00, t01, t02, transparent0);
+        _MM_TRANSPOSE4_PS(t10, t11, t12, transparent1);
+
+        _mm256_storeu_si256((__m256i*)(content + i), _packEncodedContentAVX2(
+                _encodeComponentsAVX2(r0, r1, table),
+                _encodeComponentsAVX2(g0, g1, table),
+                _encodeComponentsAVX2(b0, b1, table),
+                transparent0, transparent1));
+    }
+    if (i < count) _encodePixelQuadsSSE2(pixel_quads, content + i, count - i, table);
+}
+#endif
 
-    INLINE_XPU vec2i operator * (const vec2i &rhs) const {
-        return {
-                x * rhs.x,
-                y * rhs.y
-        };
+// Encodes a row (or any contiguous run) of pixels, or of pixel quads when super-sampled, through a table from getColorEncodeTable():
+void encodePixels(const Pixel *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    switch (kernel) {
+#ifdef SLIM_AVX2
+        case ResolveAVX2:
+            if (pixel_quads) _encodePixelQuadsAVX2(pixels, content, count, table);
+            else             _encodePixelsAVX2(pixels, content, count, table);
+            return;
+#endif
+#ifdef SLIM_SSE2
+        case ResolveSSE2:
+            if (pixel_quads) _encodePixelQuadsSSE2(pixels, content, count, table);
+            else             _encodePixelsSSE2(pixels, content, count, table);
+            return;
+#endif
+        default:
+            if (pixel_quads) _encodePixelQuadsScalar(pixels, content, count, table);
+            else             _encodePixelsScalar(pixels, content, count, table);
     }
+}
 
-    INLINE_XPU vec2i operator / (const vec2i &rhs) const {
-        return {
-                x / rhs.x,
-                y / rhs.y
-        };
-    }
+// Other formats are decoded into pixels a chunk at a time, and encoded from there:
+template <typename StoredPixel>
+void _encodeStoredPixels(const StoredPixel *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads, ResolveKernel kernel) {
+    Pixel decoded_pixels[RESOLVE_CHUNK_SIZE];
+    u32 samples_per_pixel = pixel_quads ? 4 : 1;
+    u32 chunk_pixel_count = RESOLVE_CHUNK_SIZE / samples_per_pixel;
+    while (count) {
+        u32 pixel_count = count < chunk_pixel_count ? count : chunk_pixel_count;
+        u32 sample_count = pixel_count * samples_per_pixel;
+        for (u32 i = 0; i < sample_count; i++) decoded_pixels[i] = loadPixel(pixels[i]);
+        encodePixels(decoded_pixels, content, pixel_count, table, pixel_quads, kernel);
 
-    INLINE_XPU vec2i& operator -= (const vec2i &rhs) {
-        x -= rhs.x;
-        y -= rhs.y;
-        return *this;
+        pixels += sample_count;
+        content += pixel_count;
+        count -= pixel_count;
     }
+}
 
-    INLINE_XPU vec2i& operator += (const vec2i &rhs) {
-        x += rhs.x;
-        y += rhs.y;
-        return *this;
-    }
+void encodePixels(const PixelRGBA16F *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    _encodeStoredPixels(pixels, content, count, table, pixel_quads, kernel);
+}
 
-    INLINE_XPU vec2i& operator *= (const vec2i &rhs) {
-        x *= rhs.x;
-        y *= rhs.y;
-        return *this;
+// Bytes are linear in 16-bit fixed point once decoded, which is what the table is indexed by:
+void encodePixels(const PixelRGBA8 *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    if (pixel_quads) {
+        _encodeStoredPixels(pixels, content, count, table, pixel_quads, kernel);
+        return;
     }
 
-    INLINE_XPU vec2i& operator /= (const vec2i &rhs) {
-        x /= rhs.x;
-        y /= rhs.y;
-        return *this;
-    }
+    for (u32 i = 0; i < count; i++)
+        content[i] = pixels[i].A ? (
+                (u32)table[byte_to_linear16.values[pixels[i].R]] << 16 |
+                (u32)table[byte_to_linear16.values[pixels[i].G]] << 8 |
+                (u32)table[byte_to_linear16.values[pixels[i].B]]) : 0;
+}
 
-    INLINE_XPU vec2i operator - (i32 rhs) const {
-        return {
-                x - rhs,
-                y - rhs
-        };
-    }
 
-    INLINE_XPU vec2i operator + (i32 rhs) const {
-        return {
-                x + rhs,
-                y + rhs
-        };
-    }
+struct String {
+    u32 length;
+    char *char_ptr;
 
-    INLINE_XPU vec2i operator * (i32 rhs) const {
-        return {
-                x * rhs,
-                y * rhs
-        };
-    }
+    String() noexcept : String{(char*)"", 0} {}
+    String(char *char_ptr) noexcept : length{getLength(char_ptr)}, char_ptr{char_ptr} {}
+    String(char *char_ptr, u32 length) noexcept : length{length}, char_ptr{char_ptr} {}
 
-    INLINE_XPU vec2i operator / (i32 rhs) const {
-        return {
-                x / rhs,
-                y / rhs
-        };
+    static String getFilePath(char *file_name, char *buffer, char *adjacent_file) {
+        String str(buffer);
+        u32 offset = getDirectoryLength(adjacent_file);
+        str.copyFrom(adjacent_file, file_name, offset);
+        return str;
     }
 
-    INLINE_XPU vec2i& operator -= (i32 rhs) {
-        x -= rhs;
-        y -= rhs;
-        return *this;
+    void copyFrom(char* CharPtr, u32 offset) {
+        length = offset;
+        char *source_char = CharPtr;
+        char *string_char = char_ptr + offset;
+        while (source_char[0]) {
+            *string_char = *source_char;
+            string_char++;
+            source_char++;
+            length++;
+        }
+        *string_char = 0;
     }
 
-    INLINE_XPU vec2i& operator += (i32 rhs) {
-        x += rhs;
-        y += rhs;
-        return *this;
+    void copyFrom(char* CharPtr1, char* CharPtr2, u32 offset) {
+        copyFrom(CharPtr1, 0);
+        copyFrom(CharPtr2, offset);
     }
 
-    INLINE_XPU vec2i& operator *= (i32 rhs) {
-        x *= rhs;
-        y *= rhs;
+    String& operator = (char* CharPtr) {
+        char_ptr = CharPtr;
+        length = getLength(char_ptr);
         return *this;
     }
 
-    INLINE_XPU vec2i& operator /= (i32 rhs) {
-        x /= rhs;
-        y /= rhs;
-        return *this;
+    static u32 getLength(char *string) {
+        char *ptr = string;
+        u32 length = 0;
+        if (ptr) while (ptr[length]) length++;
+        return length;
     }
 
-    INLINE_XPU vec2i operator - (f32 rhs) const {
-        return {
-                (i32)((f32)x - rhs),
-                (i32)((f32)y - rhs)
-        };
+    static u32 getDirectoryLength(char *path) {
+        u32 path_len = getLength(path);
+        u32 dir_len = path_len;
+        while ((path[dir_len] != '/') && (path[dir_len] != '\\')) dir_len--;
+        return dir_len + 1;
     }
+};
 
-    INLINE_XPU vec2i operator + (f32 rhs) const {
-        return {
-                (i32)((f32)x + rhs),
-                (i32)((f32)y + rhs)
-        };
-    }
+struct NumberString {
+    u8 float_digits_count = 3;
+    String string{_buffer, 0};
+    char _buffer[13]{};
 
-    INLINE_XPU vec2i operator * (f32 rhs) const {
-        return {
-                (i32)((f32)x * rhs),
-                (i32)((f32)y * rhs)
-        };
+    explicit NumberString(u8 digit_count = 3) : float_digits_count{digit_count}, string{_buffer, 1} {
+        _buffer[12] = 0;
+        for (u8 i = 0; i < 12; i++)
+            _buffer[i] = ' ';
     }
 
-    INLINE_XPU vec2i operator / (f32 rhs) const {
-        return {
-                (i32)((f32)x / rhs),
-                (i32)((f32)y / rhs)
-        };
+    explicit NumberString(const char *str, u8 digits_count = 3) : float_digits_count{digits_count}, string{_buffer, 1} {
+        _buffer[12] = 0;
+        char *char_ptr = (char*)str;
+        string.length = (u8)String::getLength(char_ptr);
+        if (string.length > 12) string.length = 12;
+        if ((*str >= '0') && (*str <= '9')) {
+            char_ptr += string.length;
+            char_ptr--;
+            for (i32 i = 11; i >= 0; i--, char_ptr--)
+                _buffer[i] = (11 - i) < float_digits_count ? *char_ptr : ' ';
+        } else {
+            for (u8 i = 0; i < string.length; i++, char_ptr++) _buffer[i] = *char_ptr;
+            _buffer[string.length] = 0;
+        }
     }
 
-    INLINE_XPU vec2i& operator -= (f32 rhs) {
-        x -= (i32)rhs;
-        y -= (i32)rhs;
-        return *this;
-    }
+    NumberString& operator = (i32 number) {
+        char *buffer = _buffer;
+        buffer[12] = 0;
 
-    INLINE_XPU vec2i& operator += (f32 rhs) {
-        x += (i32)rhs;
-        y += (i32)rhs;
-        return *this;
-    }
+        bool is_negative = number < 0;
+        if (is_negative) number = -number;
+
+        if (number) {
+            u32 temp;
+            buffer += 11;
+            string.char_ptr = buffer;
+            string.length = 0;
+
+            for (u8 i = 0; i < 11; i++) {
+                temp = number;
+                number /= 10;
+                string.length++;
+                *buffer-- = (char)('0' + temp - number * 10);
+                if (!number) {
+                    if (is_negative) {
+                        *buffer = '-';
+                        string.char_ptr--;
+                        string.length++;
+                    }
+
+                    break;
+                }
+                string.char_ptr--;
+            }
+        } else {
+            buffer[11] = '0';
+            string.length = 1;
+            string.char_ptr = buffer + 11;
+        }
 
-    INLINE_XPU vec2i& operator *= (f32 rhs) {
-        x *= (i32)rhs;
-        y *= (i32)rhs;
         return *this;
     }
 
-    INLINE_XPU vec2i& operator /= (f32 rhs) {
-        x /= (i32)rhs;
-        y /= (i32)rhs;
+    NumberString& operator = (f32 number) {
+        f32 factor = 1;
+        for (u8 i = 0; i < float_digits_count; i++) factor *= 10;
+        i32 int_num = (i32)(number * factor);
+        if (int_num == 0) {
+            *this = (i32)factor;
+            string.length++;
+            string.char_ptr[0] = '.';
+            string.char_ptr--;
+            string.char_ptr[0] = '0';
+            return *this;
+        }
+
+        bool is_negative = number < 0;
+        bool is_fraction = is_negative ? number > -1 : number < 1;
+
+        *this = int_num;
+
+        if (is_fraction) {
+            u32 len = string.length;
+            string.length++;
+            string.char_ptr--;
+            if (is_negative) {
+                string.char_ptr[0] = '-';
+                string.char_ptr[1] = '0';
+            } else
+                string.char_ptr[0] = '0';
+
+            if (len < float_digits_count) {
+                for (u32 i = 0; i < (float_digits_count - len); i++) {
+                    string.length++;
+                    string.char_ptr--;
+                    string.char_ptr[0] = '0';
+                }
+            }
+        }
+
+        static char tmp[13];
+        tmp[string.length + 1] = 0;
+        for (u8 i = 0; i < (u8)string.length; i++) {
+            u8 char_count_from_right_to_left = (u8)string.length - i - 1;
+            if (char_count_from_right_to_left >= float_digits_count) tmp[i] = string.char_ptr[i];
+            else                                                     tmp[i + 1] = string.char_ptr[i];
+        }
+        tmp[string.length - float_digits_count] = '.';
+        string.copyFrom(tmp, 0);
+        if (is_negative) string.length++;
+
         return *this;
     }
+};
 
-    INLINE_XPU bool nonZero() const {
-        return x != 0 ||
-               y != 0;
-    }
 
-    INLINE_XPU i32 minimum() const {
-        return x < y ? x : y;
-    }
+struct TexelQuadComponent {
+    u8 TL, TR, BL, BR;
+};
 
-    INLINE_XPU i32 maximum() const {
-        return x > y ? x : y;
-    }
+struct TexelQuad {
+    TexelQuadComponent R, G, B;
+};
 
-    INLINE_XPU vec2i clamped() const {
-        return {
-                clampedValue(x),
-                clampedValue(y)
-        };
-    }
+// How the texel quads of a mip are laid out in memory. Mips are a grid of (width + 1) by (height + 1) quads,
+// stored either in rows, or in tiles of 4x4 quads (stored one after the other in rows of tiles, the ones along the right
+// and bottom edges padded to whole tiles). Tiles keep the quads around a position close together in memory
+// whichever direction sampling moves in (a tile spans 3 cache lines), rather than only along rows.
+// Textures with `flags.swizzle` set have tiled mips:
+enum TexelLayout {
+    TexelLayoutRows,
+    TexelLayoutTiles
+};
 
-    INLINE_XPU vec2i clamped(const vec2i &upper) const {
-        return {
-                clampedValue(x, upper.x),
-                clampedValue(y, upper.y)
-        };
-    }
+struct TextureMip {
+    u32 width, height;
+    TexelQuad *texel_quads;
 
-    INLINE_XPU vec2i clamped(const f32 min_value, const f32 max_value) const {
-        return {
-                (i32)(clampedValue((f32)x, min_value, max_value)),
-                (i32)(clampedValue((f32)y, min_value, max_value))
-        };
-    }
+    // The index of the quad at column x and row y of a grid that is stride quads wide:
+    template <TexelLayout LAYOUT = TexelLayoutRows>
+    INLINE_XPU static u32 GetQuadIndex(u32 x, u32 y, u32 stride) {
+        if (LAYOUT == TexelLayoutTiles)
+            return ((((y >> 2) * ((stride + 3) >> 2) + (x >> 2)) << 4) | ((y & 3) << 2) | (x & 3));
 
-    INLINE_XPU vec2i clamped(const i32 min_value, const i32 max_value) const {
-        return {
-                clampedValue(x, min_value, max_value),
-                clampedValue(y, min_value, max_value)
-        };
+        return y * stride + x;
     }
 
-    INLINE_XPU vec2i approachTo(const vec2i &trg, f32 diff) const {
-        return {
-                (i32)(approach((f32)x, (f32)trg.x, diff)),
-                (i32)(approach((f32)y, (f32)trg.y, diff))
-        };
+    INLINE_XPU static u32 GetQuadCount(u32 width, u32 height, TexelLayout layout = TexelLayoutRows) {
+        if (layout == TexelLayoutTiles)
+            return ((width + 4) >> 2) * ((height + 4) >> 2) * 16;
+
+        return (width + 1) * (height + 1);
     }
 
-    INLINE_XPU vec2i scaleAdd(f32 factor, const vec2i &to_be_added) const {
+    template <TexelLayout LAYOUT = TexelLayoutRows>
+    INLINE_XPU Pixel sample(f32 u, f32 v) const {
+        if (u > 1) u -= (f32)((u32)u);
+        if (v > 1) v -= (f32)((u32)v);
+
+        const f32 U = u * (f32)width  + 0.5f;
+        const f32 V = v * (f32)height + 0.5f;
+        const u32 x = (u32)U;
+        const u32 y = (u32)V;
+        const f32 r = U - (f32)x;
+        const f32 b = V - (f32)y;
+        const f32 l = 1 - r;
+        const f32 t = 1 - b;
+        const f32 tl = t * l * COLOR_COMPONENT_TO_FLOAT;
+        const f32 tr = t * r * COLOR_COMPONENT_TO_FLOAT;
+        const f32 bl = b * l * COLOR_COMPONENT_TO_FLOAT;
+        const f32 br = b * r * COLOR_COMPONENT_TO_FLOAT;
+
+        const TexelQuad texel_quad = texel_quads[GetQuadIndex<LAYOUT>(x, y, width + 1)];
         return {
-                (i32)fast_mul_add((f32)x, factor, (f32)to_be_added.x),
-                (i32)fast_mul_add((f32)y, factor, (f32)to_be_added.y)
+                fast_mul_add((f32)texel_quad.R.BR, br, fast_mul_add((f32)texel_quad.R.BL, bl, fast_mul_add((f32)texel_quad.R.TR, tr, (f32)texel_quad.R.TL * tl))),
+                fast_mul_add((f32)texel_quad.G.BR, br, fast_mul_add((f32)texel_quad.G.BL, bl, fast_mul_add((f32)texel_quad.G.TR, tr, (f32)texel_quad.G.TL * tl))),
+                fast_mul_add((f32)texel_quad.B.BR, br, fast_mul_add((f32)texel_quad.B.BL, bl, fast_mul_add((f32)texel_quad.B.TR, tr, (f32)texel_quad.B.TL * tl))),
+                1.0f
         };
     }
+
+    // Sample 4 (or 8) positions at once (given as arrays of u and v), with the same results as sample() for each:
+    template <TexelLayout LAYOUT = TexelLayoutRows> void sample4(const f32 *u, const f32 *v, Pixel *out) const;
+    template <TexelLayout LAYOUT = TexelLayoutRows> void sample8(const f32 *u, const f32 *v, Pixel *out) const;
 };
 
+template <TexelLayout LAYOUT, typename I32>
+SLIM_INLINE_KERNEL I32 _texelQuadIndexLanes(const I32 &x, const I32 &y, i32 stride) {
+    if (LAYOUT == TexelLayoutTiles) {
+        const I32 mask{3};
+        const I32 tile = mulLow(y >> 2, I32{(stride + 3) >> 2}) + (x >> 2);
+        return (tile << 4) | ((y & mask) << 2) | (x & mask);
+    }
+
+    return mulLow(y, I32{stride}) + x;
+}
+
+// Samples packets of positions the way TextureMip::sample() does (the same operations in the same order, fused or not).
+// The components of the texel quads (the 4 texels around a position, a byte each) are gathered as integers,
+// and the pixels get interleaved back into place:
+template <typename F32, typename I32>
+SLIM_INLINE_KERNEL F32 _weighTexelQuadLanes(const I32 &values, const F32 &tl, const F32 &tr, const F32 &bl, const F32 &br) {
+    const I32 byte_mask{255};
+    return mulAdd(toF32((values >> 24) & byte_mask), br,
+           mulAdd(toF32((values >> 16) & byte_mask), bl,
+           mulAdd(toF32((values >> 8) & byte_mask), tr,
+                  toF32(values & byte_mask) * tl)));
+}
+
+template <typename F32>
+SLIM_INLINE_KERNEL void _storePixelLanes(const F32 &red, const F32 &green, const F32 &blue, const F32 &opacity, Pixel *out) {
+    F32 red_blue[2], green_opacity[2], pixels[2];
+    interleave(red, blue, red_blue[0], red_blue[1]);
+    interleave(green, opacity, green_opacity[0], green_opacity[1]);
+    f32 *values = &out->color.r;
+    for (u32 i = 0; i < 2; i++, values += F32::width * 2) {
+        interleave(red_blue[i], green_opacity[i], pixels[0], pixels[1]);
+        pixels[0].store(values);
+        pixels[1].store(values + F32::width);
+    }
+}
+
+template <TexelLayout LAYOUT, typename F32, typename I32>
+SLIM_INLINE_KERNEL void _sampleTextureMipWide(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    const F32 one{1.0f};
+    const F32 half{0.5f};
+    const F32 to_float{COLOR_COMPONENT_TO_FLOAT};
+    F32 U = F32::load(u);
+    F32 V = F32::load(v);
+    U = select(U > one, U - toF32(truncateToI32(U)), U);
+    V = select(V > one, V - toF32(truncateToI32(V)), V);
+    U = U * F32{(f32)texture_mip.width} + half;
+    V = V * F32{(f32)texture_mip.height} + half;
+
+    const I32 x = truncateToI32(U);
+    const I32 y = truncateToI32(V);
+    const F32 r = U - toF32(x);
+    const F32 b = V - toF32(y);
+    const F32 l = one - r;
+    const F32 t = one - b;
+    const F32 tl = t * l * to_float;
+    const F32 tr = t * r * to_float;
+    const F32 bl = b * l * to_float;
+    const F32 br = b * r * to_float;
+
+    const I32 quad = _texelQuadIndexLanes<LAYOUT>(x, y, (i32)texture_mip.width + 1);
+    const I32 offset = quad + quad + quad;
+    const i32 *components = (const i32*)texture_mip.texel_quads;
+    _storePixelLanes(_weighTexelQuadLanes(gather(components, offset), tl, tr, bl, br),
+                     _weighTexelQuadLanes(gather(components, offset + I32{1}), tl, tr, bl, br),
+                     _weighTexelQuadLanes(gather(components, offset + I32{2}), tl, tr, bl, br),
+                     one, out);
+}
+
+template <TexelLayout LAYOUT>
+void _sampleTextureMip8Scalar(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    for (u32 i = 0; i < 8; i++) out[i] = texture_mip.sample<LAYOUT>(u[i], v[i]);
+}
+
+#ifdef SLIM_SSE2
+template <TexelLayout LAYOUT>
+void _sampleTextureMip8SSE2(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    _sampleTextureMipWide<LAYOUT, f32x4, i32x4>(texture_mip, u, v, out);
+    _sampleTextureMipWide<LAYOUT, f32x4, i32x4>(texture_mip, u + 4, v + 4, out + 4);
+}
+#endif
 
-struct vec2 {
-    union {
-        struct {f32 components[2]; };
-        struct {f32 x, y; };
-        struct {f32 u, v; };
-    };
+#ifdef SLIM_AVX2
+template <TexelLayout LAYOUT>
+SLIM_TARGET_AVX2 void _sampleTextureMip8AVX2(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    _sampleTextureMipWide<LAYOUT, f32x8, i32x8>(texture_mip, u, v, out);
+}
+#endif
 
-    static vec2 X, Y;
+typedef void (*SampleTextureMip8Kernel)(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out);
+SampleTextureMip8Kernel sample_texture_mip8_kernel = selectKernel<SampleTextureMip8Kernel>(
+        _sampleTextureMip8Scalar<TexelLayoutRows>,
+        SIMD_SSE2_KERNEL(_sampleTextureMip8SSE2<TexelLayoutRows>),
+        SIMD_AVX2_KERNEL(_sampleTextureMip8AVX2<TexelLayoutRows>));
+SampleTextureMip8Kernel sample_tiled_texture_mip8_kernel = selectKernel<SampleTextureMip8Kernel>(
+        _sampleTextureMip8Scalar<TexelLayoutTiles>,
+        SIMD_SSE2_KERNEL(_sampleTextureMip8SSE2<TexelLayoutTiles>),
+        SIMD_AVX2_KERNEL(_sampleTextureMip8AVX2<TexelLayoutTiles>));
+
+// 4 lanes are either SSE2 or the scalar backend of f32x4, so need no picking:
+template <TexelLayout LAYOUT>
+INLINE void TextureMip::sample4(const f32 *u, const f32 *v, Pixel *out) const {
+    _sampleTextureMipWide<LAYOUT, f32x4, i32x4>(*this, u, v, out);
+}
+
+template <TexelLayout LAYOUT>
+INLINE void TextureMip::sample8(const f32 *u, const f32 *v, Pixel *out) const {
+    if (LAYOUT == TexelLayoutTiles) sample_tiled_texture_mip8_kernel(*this, u, v, out);
+    else                            sample_texture_mip8_kernel(*this, u, v, out);
+}
+
+// Where a pixel lands in a texture, see Texture::getFootprint():
+struct TextureFootprint {
+    f32 lod = 0;          // Level of detail of each tap
+    f32 du = 0, dv = 0;   // From one tap to the next (in uv), along the longer axis
+    u32 tap_count = 1;
+};
 
-    INLINE_XPU vec2() : vec2{0} {}
-    INLINE_XPU vec2(f32 x, f32 y) noexcept : x(x), y(y) {}
-    INLINE_XPU vec2(i32 x, i32 y) noexcept : x((f32)x), y((f32)y) {}
-    INLINE_XPU vec2(const vec2 &other) noexcept : vec2{other.x, other.y} {}
-    INLINE_XPU explicit vec2(f32 value) noexcept : vec2{value, value} {}
-    INLINE_XPU explicit vec2(vec2i &other) noexcept : vec2{(f32)other.x, (f32)other.y} {}
-    INLINE_XPU explicit vec2(const vec2i &other) noexcept : vec2{(f32)other.x, (f32)other.y} {}
+struct Texture : ImageInfo {
+    TextureMip *mips = nullptr;
 
-    INLINE_XPU bool operator == (const vec2 &other) const {
-        return (other.x == x) &&
-               (other.y == y);
+    XPU static u32 GetMipLevel(f32 texel_area, u32 mip_count) {
+        u32 mip_level = 0;
+        while (texel_area > 1 && ++mip_level < mip_count) texel_area *= 0.25f;
+        if (mip_level >= mip_count)
+            mip_level = mip_count - 1;
+
+        return mip_level;
     }
 
-    INLINE_XPU vec2 & operator = (f32 value) {
-        x = y = value;
-        return *this;
+    // The level of detail between mip levels (which GetMipLevel() rounds up to), for filtering across the 2 nearest mips:
+    XPU static f32 GetMipLOD(f32 texel_area, u32 mip_count) {
+        if (texel_area <= 1 || mip_count <= 1)
+            return 0;
+
+        const f32 lod = 0.5f * log2f(texel_area); // Each level halving texels along each axis, so quartering their areas
+        const f32 max_lod = (f32)(mip_count - 1);
+        return lod < max_lod ? lod : max_lod;
     }
 
-    INLINE_XPU vec2 & operator = (i32 value) {
-        x = y = (f32)value;
-        return *this;
+    XPU static u32 GetMipLevel(u32 width, u32 height, u32 mip_count, f32 uv_area) {
+        return GetMipLevel(uv_area * (f32)(width * height), mip_count);
     }
 
-    INLINE_XPU bool operator ! () const {
-        return nonZero();
+    XPU static u32 GetMipLevel(const Texture &texture, f32 uv_area) {
+        return GetMipLevel(uv_area * (f32)(texture.width * texture.height), texture.mip_count);
     }
 
-    INLINE_XPU vec2 operator - () const {
-        return {
-                -x,
-                -y
-        };
+    INLINE_XPU TexelLayout texelLayout() const {
+        return flags.swizzle ? TexelLayoutTiles : TexelLayoutRows;
     }
 
-    INLINE_XPU vec2 operator - (const vec2 &rhs) const {
-        return {
-                x - rhs.x,
-                y - rhs.y
-        };
+    INLINE_XPU Pixel sample(f32 u, f32 v, f32 uv_area) const {
+        return _sampleMip(mips[flags.mipmap ? GetMipLevel(uv_area * (f32)(width * height), mip_count) : 0], u, v);
     }
 
-    INLINE_XPU vec2 operator + (const vec2 &rhs) const {
-        return {
-                x + rhs.x,
-                y + rhs.y
-        };
+    // Samples the 2 mips nearest to the level of detail, blending between them by where it lies in between:
+    INLINE_XPU Pixel sampleTrilinear(f32 u, f32 v, f32 uv_area) const {
+        if (!flags.mipmap)
+            return _sampleMip(mips[0], u, v);
+
+        return sampleLOD(u, v, GetMipLOD(uv_area * (f32)(width * height), mip_count));
     }
 
-    INLINE_XPU vec2 operator * (const vec2 &rhs) const {
-        return {
-                x * rhs.x,
-                y * rhs.y
-        };
+    // Levels of detail are clamped to the mips there are, with the last mip sampled alone:
+    INLINE_XPU Pixel sampleLOD(f32 u, f32 v, f32 lod) const {
+        lod = _clampedLOD(lod);
+        const u32 mip_level = (u32)lod;
+        const f32 fraction = lod - (f32)mip_level;
+        Pixel pixel = _sampleMip(mips[mip_level], u, v);
+        if (fraction > 0)
+            pixel.color = pixel.color.lerpTo(_sampleMip(mips[mip_level + 1], u, v).color, fraction);
+
+        return pixel;
     }
 
-    INLINE_XPU vec2 operator / (const vec2 &rhs) const {
-        return {
-                x / rhs.x,
-                y / rhs.y
-        };
+    // Packets of 4 (or 8) positions sampled trilinearly (with the same results as sampleTrilinear() for each).
+    // The level of detail is shared by all of them, as it would be for neighboring pixels:
+    void sampleTrilinear4(const f32 *u, const f32 *v, f32 uv_area, Pixel *out) const {
+        _sampleTrilinear(u, v, uv_area, out, 4);
     }
 
-    INLINE_XPU vec2& operator -= (const vec2 &rhs) {
-        x -= rhs.x;
-        y -= rhs.y;
-        return *this;
+    void sampleTrilinear8(const f32 *u, const f32 *v, f32 uv_area, Pixel *out) const {
+        _sampleTrilinear(u, v, uv_area, out, 8);
     }
 
-    INLINE_XPU vec2& operator += (const vec2 &rhs) {
-        x += rhs.x;
-        y += rhs.y;
-        return *this;
+    // The footprint of a pixel in the texture, given the screen-space derivatives of u and v (per pixel to the right and down).
+    // The level of detail comes from the longer of the 2 axes (so that nothing gets under-filtered along either of them).
+    // With an anisotropy above 1, up to that many taps get spread along the longer axis instead, each one only needing
+    // the level of detail of its share of it (no coarser than the shorter axis):
+    XPU TextureFootprint getFootprint(f32 du_dx, f32 dv_dx, f32 du_dy, f32 dv_dy, u32 max_anisotropy = 1) const {
+        TextureFootprint footprint;
+        const f32 x_length_squared = _texelLengthSquared(du_dx, dv_dx);
+        const f32 y_length_squared = _texelLengthSquared(du_dy, dv_dy);
+        const bool x_is_major = x_length_squared >= y_length_squared;
+        f32 major_length_squared = x_is_major ? x_length_squared : y_length_squared;
+        const f32 minor_length_squared = x_is_major ? y_length_squared : x_length_squared;
+
+        if (max_anisotropy > 1 && major_length_squared > minor_length_squared) {
+            const f32 ratio = minor_length_squared > 0 ? sqrtf(major_length_squared / minor_length_squared) : (f32)max_anisotropy;
+            footprint.tap_count = ratio < (f32)max_anisotropy ? (u32)ceilf(ratio) : max_anisotropy;
+            if (footprint.tap_count > 1) {
+                const f32 one_over_tap_count = 1.0f / (f32)footprint.tap_count;
+                footprint.du = (x_is_major ? du_dx : du_dy) * one_over_tap_count;
+                footprint.dv = (x_is_major ? dv_dx : dv_dy) * one_over_tap_count;
+                major_length_squared *= one_over_tap_count * one_over_tap_count;
+            }
+        }
+        if (flags.mipmap)
+            footprint.lod = GetMipLOD(major_length_squared, mip_count);
+
+        return footprint;
     }
 
-    INLINE_XPU vec2& operator *= (const vec2 &rhs) {
-        x *= rhs.x;
-        y *= rhs.y;
-        return *this;
+    // The mip closest to a texel per pixel along the longer axis of its footprint (for drawing from a single mip):
+    XPU u32 getMipLevel(f32 du_dx, f32 dv_dx, f32 du_dy, f32 dv_dy) const {
+        if (!flags.mipmap)
+            return 0;
+
+        const f32 x_length_squared = _texelLengthSquared(du_dx, dv_dx);
+        const f32 y_length_squared = _texelLengthSquared(du_dy, dv_dy);
+        return GetMipLevel(x_length_squared > y_length_squared ? x_length_squared : y_length_squared, mip_count);
     }
 
-    INLINE_XPU vec2& operator /= (const vec2 &rhs) {
-        x /= rhs.x;
-        y /= rhs.y;
-        return *this;
+    // Samples by the screen-space derivatives of u and v (instead of a uv area, see getFootprint()):
+    INLINE_XPU Pixel sampleGrad(f32 u, f32 v, f32 du_dx, f32 dv_dx, f32 du_dy, f32 dv_dy, u32 max_anisotropy = 1) const {
+        return sample(u, v, getFootprint(du_dx, dv_dx, du_dy, dv_dy, max_anisotropy));
     }
 
-    INLINE_XPU vec2 operator - (f32 rhs) const {
-        return {
-                x - rhs,
-                y - rhs
-        };
+    // Averages the footprint's taps, centered around the position:
+    INLINE_XPU Pixel sample(f32 u, f32 v, const TextureFootprint &footprint) const {
+        if (footprint.tap_count == 1)
+            return sampleLOD(u, v, footprint.lod);
+
+        Color color{0.0f, 0.0f, 0.0f};
+        f32 offset = -0.5f * (f32)(footprint.tap_count - 1);
+        for (u32 t = 0; t < footprint.tap_count; t++, offset += 1.0f)
+            color += sampleLOD(_wrapped(u + footprint.du * offset),
+                               _wrapped(v + footprint.dv * offset), footprint.lod).color;
+
+        return {color / (f32)footprint.tap_count, 1.0f};
     }
 
-    INLINE_XPU vec2 operator + (f32 rhs) const {
-        return {
-                x + rhs,
-                y + rhs
-        };
+    // Samples a 2x2 quad of pixels (top-left, top-right, bottom-left, bottom-right), as GPUs do:
+    // The derivatives are taken from the differences between its positions, for a level of detail (and taps) per quad.
+    void sampleQuad(const f32 *u, const f32 *v, Pixel *out, u32 max_anisotropy = 1) const {
+        const TextureFootprint footprint = getFootprint(u[1] - u[0], v[1] - v[0], u[2] - u[0], v[2] - v[0], max_anisotropy);
+        if (footprint.tap_count == 1) {
+            _sampleLOD(u, v, footprint.lod, out, 4);
+            return;
+        }
+
+        Color colors[4] = {};
+        Pixel taps[4];
+        f32 tap_u[4], tap_v[4];
+        f32 offset = -0.5f * (f32)(footprint.tap_count - 1);
+        for (u32 t = 0; t < footprint.tap_count; t++, offset += 1.0f) {
+            for (u32 i = 0; i < 4; i++) {
+                tap_u[i] = _wrapped(u[i] + footprint.du * offset);
+                tap_v[i] = _wrapped(v[i] + footprint.dv * offset);
+            }
+            _sampleLOD(tap_u, tap_v, footprint.lod, taps, 4);
+            for (u32 i = 0; i < 4; i++) colors[i] += taps[i].color;
+        }
+
+        const f32 one_over_tap_count = 1.0f / (f32)footprint.tap_count;
+        for (u32 i = 0; i < 4; i++) out[i] = Pixel{colors[i] * one_over_tap_count, 1.0f};
     }
 
-    INLINE_XPU vec2 operator * (f32 rhs) const {
-        return {
-                x * rhs,
-                y * rhs
-        };
+    INLINE_XPU f32 _texelLengthSquared(f32 du, f32 dv) const {
+        du *= (f32)width;
+        dv *= (f32)height;
+        return du * du + dv * dv;
     }
 
-    INLINE_XPU vec2 operator / (f32 rhs) const {
-        f32 factor = 1.0f / rhs;
-        return {
-                x * factor,
-                y * factor
-        };
+    // Taps offset to before the start of the texture wrap around it (as mips do past its end):
+    INLINE_XPU static f32 _wrapped(f32 coordinate) {
+        return coordinate < 0 ? coordinate - floorf(coordinate) : coordinate;
     }
 
-    INLINE_XPU vec2& operator -= (f32 rhs) {
-        x -= rhs;
-        y -= rhs;
-        return *this;
+    // Mips of textures get sampled by the layout of their texel quads (specialized, see TexelLayout):
+    INLINE_XPU Pixel _sampleMip(const TextureMip &texture_mip, f32 u, f32 v) const {
+        return flags.swizzle ? texture_mip.sample<TexelLayoutTiles>(u, v) : texture_mip.sample(u, v);
     }
 
-    INLINE_XPU vec2& operator += (f32 rhs) {
-        x += rhs;
-        y += rhs;
-        return *this;
+    INLINE void _samplePacket(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out, u32 count) const {
+        if (flags.swizzle) {
+            if (count == 8) texture_mip.sample8<TexelLayoutTiles>(u, v, out);
+            else            texture_mip.sample4<TexelLayoutTiles>(u, v, out);
+        } else {
+            if (count == 8) texture_mip.sample8(u, v, out);
+            else            texture_mip.sample4(u, v, out);
+        }
     }
 
-    INLINE_XPU vec2& operator *= (f32 rhs) {
-        x *= rhs;
-        y *= rhs;
+    void _sampleTrilinear(const f32 *u, const f32 *v, f32 uv_area, Pixel *out, u32 count) const {
+        if (!flags.mipmap) {
+            _samplePacket(mips[0], u, v, out, count);
+            return;
+        }
+
+        _sampleLOD(u, v, GetMipLOD(uv_area * (f32)(width * height), mip_count), out, count);
+    }
+
+    INLINE_XPU f32 _clampedLOD(f32 lod) const {
+        const f32 max_lod = mip_count > 1 ? (f32)(mip_count - 1) : 0;
+        return lod > 0 ? (lod < max_lod ? lod : max_lod) : 0; // Also mapping NaNs to the first mip
+    }
+
+    void _sampleLOD(const f32 *u, const f32 *v, f32 lod, Pixel *out, u32 count) const {
+        lod = _clampedLOD(lod);
+        const u32 mip_level = (u32)lod;
+        const f32 fraction = lod - (f32)mip_level;
+        _samplePacket(mips[mip_level], u, v, out, count);
+        if (fraction > 0) {
+            Pixel next[8];
+            _samplePacket(mips[mip_level + 1], u, v, next, count);
+            for (u32 i = 0; i < count; i++) out[i].color = out[i].color.lerpTo(next[i].color, fraction);
+        }
+    }
+};
+
+
+struct HUDLine {
+    String title, alternate_value;
+    NumberString value;
+    enum ColorID title_color = BrightGrey;
+    enum ColorID value_color = BrightGrey;
+    enum ColorID alternate_value_color = Grey;
+    bool *use_alternate = nullptr;
+    bool invert_alternate_use = false;
+
+    HUDLine(enum ColorID default_color = BrightGrey) :
+            title{},
+            alternate_value{},
+            value{},
+            title_color{default_color},
+            value_color{default_color} {}
+    HUDLine(char* title_char_ptr,
+            enum ColorID default_color = BrightGrey) :
+            title{title_char_ptr},
+            alternate_value{},
+            value{},
+            title_color{default_color},
+            value_color{default_color} {}
+    HUDLine(char* title_char_ptr,
+            char* value_char_ptr,
+            enum ColorID default_color = BrightGrey) :
+                    title{title_char_ptr},
+                    alternate_value{},
+                    value{value_char_ptr},
+                    title_color{default_color},
+                    alternate_value_color{default_color}
+                    {}
+    HUDLine(char* title_char_ptr,
+            char* value_char_ptr,
+            char* alternate_value_char_ptr,
+            bool *use_alternate = nullptr,
+            bool invert_alternate_use = false,
+            enum ColorID value_color = BrightGrey,
+            enum ColorID alternate_value_color = Grey,
+            enum ColorID title_color = BrightGrey) :
+            title{title_char_ptr},
+            alternate_value{alternate_value_char_ptr},
+            value{value_char_ptr},
+            title_color{title_color},
+            value_color{value_color},
+            alternate_value_color{alternate_value_color},
+            use_alternate{use_alternate},
+            invert_alternate_use{invert_alternate_use}
+    {}
+};
+
+struct HUDSettings {
+    u32 line_count = 0;
+    f32 line_height = 1.2f;
+    enum ColorID default_color = BrightGrey;
+
+    HUDSettings(u32 line_count = 0,
+                f32 line_height = 1.2f,
+                ColorID default_color = BrightGrey) : line_count{line_count}, line_height{line_height}, default_color{default_color} {}
+};
+struct HUD {
+    HUDSettings settings;
+    HUDLine *lines = nullptr;
+    i32 left = 10, top = 10;
+    bool enabled = true;
+
+    HUD() = default;
+    HUD(HUDSettings settings,
+        HUDLine *lines,
+        i32 left = 10,
+        i32 top = 10) :
+        settings{settings}, lines{lines}, left{left}, top{top} {
+        if (settings.default_color != BrightGrey) for (u32 i = 0; i < settings.line_count; i++)
+            lines[i].title_color = lines[i].alternate_value_color = lines[i].value_color = settings.default_color;
+    }
+    HUD(HUDSettings settings, memory::AllocateMemory allocate_memory = nullptr, i32 left = 10, i32 top = 10) : settings{settings}, left{left}, top{top} {
+        if (settings.line_count) {
+            lines = (HUDLine*)allocate_memory(settings.line_count * sizeof(HUDLine));
+            for (u32 i = 0; i < settings.line_count; i++)
+                lines[i] = HUDLine{settings.default_color};
+        }
+    }
+};
+
+
+#define SLIM_VEC2
+
+struct vec2i {
+    i32 x, y;
+
+    INLINE_XPU vec2i() noexcept : vec2i{0} {}
+    INLINE_XPU vec2i(i32 x, i32 y) noexcept : x(x), y(y) {}
+    INLINE_XPU vec2i(vec2i &other) noexcept : vec2i{other.x, other.y} {}
+    INLINE_XPU explicit vec2i(i32 value) noexcept : vec2i{value, value} {}
+
+    INLINE_XPU bool operator == (const vec2i &other) const {
+        return (other.x == x) &&
+               (other.y == y);
+    }
+
+    INLINE_XPU vec2i & operator = (f32 value) {
+        x = y = (i32)value;
         return *this;
     }
 
-    INLINE_XPU vec2& operator /= (f32 rhs) {
-        f32 factor = 1.0f / rhs;
-        x *= factor;
-        y *= factor;
+    INLINE_XPU vec2i & operator = (i32 value) {
+        x = y = value;
         return *this;
     }
 
-    INLINE_XPU vec2 operator - (i32 rhs) const {
+    INLINE_XPU bool operator ! () const {
+        return nonZero();
+    }
+
+    INLINE_XPU vec2i operator - () const {
         return {
-                x - (f32)rhs,
-                y - (f32)rhs
+                -x,
+                -y
         };
     }
 
-    INLINE_XPU vec2 operator + (i32 rhs) const {
+    INLINE_XPU vec2i operator - (const vec2i &rhs) const {
         return {
-                x + (f32)rhs,
-                y + (f32)rhs
+                x - rhs.x,
+                y - rhs.y
         };
     }
 
-    INLINE_XPU vec2 operator * (i32 rhs) const {
+    INLINE_XPU vec2i operator + (const vec2i &rhs) const {
         return {
-                x * (f32)rhs,
-                y * (f32)rhs
+                x + rhs.x,
+                y + rhs.y
         };
     }
 
-    INLINE_XPU vec2 operator / (i32 rhs) const {
-        f32 factor = 1.0f / (f32)rhs;
+    INLINE_XPU vec2i operator * (const vec2i &rhs) const {
         return {
-                x * factor,
-                y * factor
+                x * rhs.x,
+                y * rhs.y
         };
     }
 
-    INLINE_XPU vec2& operator -= (i32 rhs) {
-        x -= (f32)rhs;
-        y -= (f32)rhs;
+    INLINE_XPU vec2i operator / (const vec2i &rhs) const {
+        return {
+                x / rhs.x,
+                y / rhs.y
+        };
+    }
+
+    INLINE_XPU vec2i& operator -= (const vec2i &rhs) {
+        x -= rhs.x;
+        y -= rhs.y;
         return *this;
     }
 
-    INLINE_XPU vec2& operator += (i32 rhs) {
-        x += (f32)rhs;
-        y += (f32)rhs;
+    INLINE_XPU vec2i& operator += (const vec2i &rhs) {
+        x += rhs.x;
+        y += rhs.y;
         return *this;
     }
 
-    INLINE_XPU vec2& operator *= (i32 rhs) {
-        x *= (f32)rhs;
-        y *= (f32)rhs;
+    INLINE_XPU vec2i& operator *= (const vec2i &rhs) {
+        x *= rhs.x;
+        y *= rhs.y;
         return *this;
     }
 
-    INLINE_XPU vec2& operator /= (i32 rhs) {
-        f32 factor = 1.0f / (f32)rhs;
-        x *= factor;
-        y *= factor;
+    INLINE_XPU vec2i& operator /= (const vec2i &rhs) {
+        x /= rhs.x;
+        y /= rhs.y;
         return *this;
     }
 
-    INLINE_XPU vec2 operator - (const vec2i &rhs) const {
+    INLINE_XPU vec2i operator - (i32 rhs) const {
         return {
-                x - (f32)rhs.x,
-                y - (f32)rhs.y
+                x - rhs,
+                y - rhs
         };
     }
 
-    INLINE_XPU vec2 operator + (const vec2i &rhs) const {
+    INLINE_XPU vec2i operator + (i32 rhs) const {
         return {
-                x + (f32)rhs.x,
-                y + (f32)rhs.y
+                x + rhs,
+                y + rhs
         };
     }
 
-    INLINE_XPU vec2 operator * (const vec2i &rhs) const {
+    INLINE_XPU vec2i operator * (i32 rhs) const {
         return {
-                x * (f32)rhs.x,
-                y * (f32)rhs.y
+                x * rhs,
+                y * rhs
         };
     }
 
-    INLINE_XPU vec2 operator / (const vec2i &rhs) const {
+    INLINE_XPU vec2i operator / (i32 rhs) const {
         return {
-                x / (f32)rhs.x,
-                y / (f32)rhs.y
+                x / rhs,
+                y / rhs
         };
     }
 
-    INLINE_XPU vec2& operator -= (const vec2i &rhs) {
-        x -= (f32)rhs.x;
-        y -= (f32)rhs.y;
+    INLINE_XPU vec2i& operator -= (i32 rhs) {
+        x -= rhs;
+        y -= rhs;
         return *this;
     }
 
-    INLINE_XPU vec2& operator += (const vec2i &rhs) {
-        x += (f32)rhs.x;
-        y += (f32)rhs.y;
+    INLINE_XPU vec2i& operator += (i32 rhs) {
+        x += rhs;
+        y += rhs;
         return *this;
     }
 
-    INLINE_XPU vec2& operator *= (const vec2i &rhs) {
-        x *= (f32)rhs.x;
-        y *= (f32)rhs.y;
+    INLINE_XPU vec2i& operator *= (i32 rhs) {
+        x *= rhs;
+        y *= rhs;
         return *this;
     }
 
-    INLINE_XPU vec2& operator /= (const vec2i &rhs) {
-        x /= (f32)rhs.x;
-        y /= (f32)rhs.y;
+    INLINE_XPU vec2i& operator /= (i32 rhs) {
+        x /= rhs;
+        y /= rhs;
         return *this;
     }
 
-    INLINE_XPU bool nonZero() const {
-        return x != 0.0f ||
-               y != 0.0f;
+    INLINE_XPU vec2i operator - (f32 rhs) const {
+        return {
+                (i32)((f32)x - rhs),
+                (i32)((f32)y - rhs)
+        };
     }
 
-    INLINE_XPU f32 minimum() const {
-        return x < y ? x : y;
+    INLINE_XPU vec2i operator + (f32 rhs) const {
+        return {
+                (i32)((f32)x + rhs),
+                (i32)((f32)y + rhs)
+        };
     }
 
-    INLINE_XPU f32 maximum() const {
-        return x > y ? x : y;
+    INLINE_XPU vec2i operator * (f32 rhs) const {
+        return {
+                (i32)((f32)x * rhs),
+                (i32)((f32)y * rhs)
+        };
     }
 
-    INLINE_XPU vec2 perp() const {
+    INLINE_XPU vec2i operator / (f32 rhs) const {
         return {
-                -y,
-                x
+                (i32)((f32)x / rhs),
+                (i32)((f32)y / rhs)
         };
     }
 
-    INLINE_XPU f32 dot(const vec2 &rhs) const {
-        return (x * rhs.x) + (y * rhs.y);
+    INLINE_XPU vec2i& operator -= (f32 rhs) {
+        x -= (i32)rhs;
+        y -= (i32)rhs;
+        return *this;
     }
 
-    INLINE_XPU f32 cross(const vec2 &rhs) const {
-        return (x * rhs.y) - (y * rhs.x);
+    INLINE_XPU vec2i& operator += (f32 rhs) {
+        x += (i32)rhs;
+        y += (i32)rhs;
+        return *this;
     }
 
-    INLINE_XPU f32 squaredLength() const {
-        return x*x + y*y;
+    INLINE_XPU vec2i& operator *= (f32 rhs) {
+        x *= (i32)rhs;
+        y *= (i32)rhs;
+        return *this;
     }
 
-    INLINE_XPU f32 length() const {
-        return sqrtf(squaredLength());
+    INLINE_XPU vec2i& operator /= (f32 rhs) {
+        x /= (i32)rhs;
+        y /= (i32)rhs;
+        return *this;
     }
 
-    INLINE_XPU vec2 normalized() const {
-        return *this / length();
+    INLINE_XPU bool nonZero() const {
+        return x != 0 ||
+               y != 0;
     }
 
-    INLINE_XPU vec2 reflectedAround(const vec2 &N) const {
-        return N.scaleAdd(-2 * dot(N), *this);
+    INLINE_XPU i32 minimum() const {
+        return x < y ? x : y;
     }
 
-    INLINE_XPU vec2 clamped() const {
+    INLINE_XPU i32 maximum() const {
+        return x > y ? x : y;
+    }
+
+    INLINE_XPU vec2i clamped() const {
         return {
                 clampedValue(x),
                 clampedValue(y)
         };
     }
 
-    INLINE_XPU vec2 clamped(const vec2 &upper) const {
+    INLINE_XPU vec2i clamped(const vec2i &upper) const {
         return {
                 clampedValue(x, upper.x),
                 clampedValue(y, upper.y)
         };
     }
 
-    INLINE_XPU vec2 clamped(const vec2 &lower, const vec2 &upper) const {
+    INLINE_XPU vec2i clamped(const f32 min_value, const f32 max_value) const {
         return {
-                clampedValue(x, lower.x, upper.x),
-                clampedValue(y, lower.y, upper.y)
+                (i32)(clampedValue((f32)x, min_value, max_value)),
+                (i32)(clampedValue((f32)y, min_value, max_value))
         };
     }
 
-    INLINE_XPU vec2 clamped(const f32 min_value, const f32 max_value) const {
+    INLINE_XPU vec2i clamped(const i32 min_value, const i32 max_value) const {
         return {
                 clampedValue(x, min_value, max_value),
                 clampedValue(y, min_value, max_value)
         };
     }
 
-    INLINE_XPU vec2 approachTo(const vec2 &trg, f32 diff) const {
-        return {
-                approach(x, trg.x, diff),
-                approach(y, trg.y, diff)
-        };
-    }
-
-    INLINE_XPU vec2 lerpTo(const vec2 &to, f32 by) const {
-        return (to - *this).scaleAdd(by, *this);
-    }
-
-    INLINE_XPU vec2 scaleAdd(f32 factor, const vec2 &to_be_added) const {
+    INLINE_XPU vec2i approachTo(const vec2i &trg, f32 diff) const {
         return {
-                fast_mul_add(x, factor, to_be_added.x),
-                fast_mul_add(y, factor, to_be_added.y)
+                (i32)(approach((f32)x, (f32)trg.x, diff)),
+                (i32)(approach((f32)y, (f32)trg.y, diff))
         };
     }
 
-    INLINE_XPU vec2 mulAdd(const vec2 &factors, const vec2 &to_be_added) const {
+    INLINE_XPU vec2i scaleAdd(f32 factor, const vec2i &to_be_added) const {
         return {
-                fast_mul_add(x, factors.x, to_be_added.x),
-                fast_mul_add(y, factors.y, to_be_added.y)
+                (i32)fast_mul_add((f32)x, factor, (f32)to_be_added.x),
+                (i32)fast_mul_add((f32)y, factor, (f32)to_be_added.y)
         };
     }
 };
 
-vec2 vec2::X{1.0f, 0.0f};
-vec2 vec2::Y{0.0f, 1.0f};
 
-INLINE_XPU vec2 minimum(const vec2 &a, const vec2 &b) {
-    return {
-            a.x < b.x ? a.x : b.x,
-            a.y < b.y ? a.y : b.y
+struct vec2 {
+    union {
+        struct {f32 components[2]; };
+        struct {f32 x, y; };
+        struct {f32 u, v; };
     };
-}
 
-INLINE_XPU vec2 maximum(const vec2 &a, const vec2 &b) {
-    return {
-            a.x > b.x ? a.x : b.x,
-            a.y > b.y ? a.y : b.y
-    };
-}
+    static vec2 X, Y;
 
-INLINE_XPU vec2i minimum(const vec2i &a, const vec2i &b) {
-    return {
-            a.x < b.x ? a.x : b.x,
-            a.y < b.y ? a.y : b.y
-    };
-}
+    INLINE_XPU vec2() : vec2{0} {}
+    INLINE_XPU vec2(f32 x, f32 y) noexcept : x(x), y(y) {}
+    INLINE_XPU vec2(i32 x, i32 y) noexcept : x((f32)x), y((f32)y) {}
+    INLINE_XPU vec2(const vec2 &other) noexcept : vec2{other.x, other.y} {}
+    INLINE_XPU explicit vec2(f32 value) noexcept : vec2{value, value} {}
+    INLINE_XPU explicit vec2(vec2i &other) noexcept : vec2{(f32)other.x, (f32)other.y} {}
+    INLINE_XPU explicit vec2(const vec2i &other) noexcept : vec2{(f32)other.x, (f32)other.y} {}
 
-INLINE_XPU vec2i maximum(const vec2i &a, const vec2i &b) {
-    return {
-            a.x > b.x ? a.x : b.x,
-            a.y > b.y ? a.y : b.y
-    };
-}
+    INLINE_XPU bool operator == (const vec2 &other) const {
+        return (other.x == x) &&
+               (other.y == y);
+    }
 
-INLINE_XPU vec2i operator - (const vec2i &lhs, const vec2 &rhs) {
-    return {
-            lhs.x - (i32)rhs.x,
-            lhs.y - (i32)rhs.y
-    };
-}
+    INLINE_XPU vec2 & operator = (f32 value) {
+        x = y = value;
+        return *this;
+    }
 
-INLINE_XPU vec2i operator + (const vec2i &lhs, const vec2 &rhs) {
-    return {
-            lhs.x + (i32)rhs.x,
-            lhs.y + (i32)rhs.y
-    };
-}
+    INLINE_XPU vec2 & operator = (i32 value) {
+        x = y = (f32)value;
+        return *this;
+    }
 
-INLINE vec2i operator * (const vec2i &lhs, const vec2 &rhs) {
-    return {
-            lhs.x * (i32)rhs.x,
-            lhs.y * (i32)rhs.y
-    };
-}
+    INLINE_XPU bool operator ! () const {
+        return nonZero();
+    }
 
-INLINE_XPU vec2i operator / (const vec2i &lhs, const vec2 &rhs) {
-    return {
-            lhs.x / (i32)rhs.x,
-            lhs.y / (i32)rhs.y
-    };
-}
+    INLINE_XPU vec2 operator - () const {
+        return {
+                -x,
+                -y
+        };
+    }
 
-INLINE_XPU vec2i operator - (i32 lhs, const vec2 &rhs) {
-    return {
-            lhs - (i32)rhs.x,
-            lhs - (i32)rhs.y
-    };
-}
+    INLINE_XPU vec2 operator - (const vec2 &rhs) const {
+        return {
+                x - rhs.x,
+                y - rhs.y
+        };
+    }
 
-INLINE vec2i operator + (i32 lhs, const vec2 &rhs) {
-    return {
-            lhs + (i32)rhs.x,
-            lhs + (i32)rhs.y
-    };
-}
+    INLINE_XPU vec2 operator + (const vec2 &rhs) const {
+        return {
+                x + rhs.x,
+                y + rhs.y
+        };
+    }
 
-INLINE vec2i operator * (i32 lhs, const vec2 &rhs) {
-    return {
-            lhs * (i32)rhs.x,
-            lhs * (i32)rhs.y
-    };
-}
+    INLINE_XPU vec2 operator * (const vec2 &rhs) const {
+        return {
+                x * rhs.x,
+                y * rhs.y
+        };
+    }
 
-INLINE_XPU vec2i operator / (i32 lhs, const vec2 &rhs) {
-    return {
-            lhs / (i32)rhs.x,
-            lhs / (i32)rhs.y
-    };
-}
+    INLINE_XPU vec2 operator / (const vec2 &rhs) const {
+        return {
+                x / rhs.x,
+                y / rhs.y
+        };
+    }
 
-INLINE_XPU vec2i operator - (i32 lhs, const vec2i &rhs) {
-    return {
-            lhs - rhs.x,
-            lhs - rhs.y
-    };
-}
+    INLINE_XPU vec2& operator -= (const vec2 &rhs) {
+        x -= rhs.x;
+        y -= rhs.y;
+        return *this;
+    }
 
-INLINE_XPU vec2i operator + (i32 lhs, const vec2i &rhs) {
-    return {
-            lhs + rhs.x,
-            lhs + rhs.y
-    };
-}
+    INLINE_XPU vec2& operator += (const vec2 &rhs) {
+        x += rhs.x;
+        y += rhs.y;
+        return *this;
+    }
 
-INLINE_XPU vec2i operator * (i32 lhs, const vec2i &rhs) {
-    return {
-            lhs * rhs.x,
-            lhs * rhs.y
-    };
-}
-
-INLINE_XPU vec2i operator / (i32 lhs, const vec2i &rhs) {
-    return {
-            lhs / rhs.x,
-            lhs / rhs.y
-    };
-}
-
-INLINE_XPU vec2 operator - (f32 lhs, const vec2 &rhs) {
-    return {
-            lhs - rhs.x,
-            lhs - rhs.y
-    };
-}
-
-INLINE_XPU vec2 operator + (f32 lhs, const vec2 &rhs) {
-    return {
-            lhs + rhs.x,
-            lhs + rhs.y
-    };
-}
-
-INLINE_XPU vec2 operator / (f32 lhs, const vec2 &rhs) {
-    return {
-            lhs / rhs.x,
-            lhs / rhs.y
-    };
-}
+    INLINE_XPU vec2& operator *= (const vec2 &rhs) {
+        x *= rhs.x;
+        y *= rhs.y;
+        return *this;
+    }
 
-INLINE_XPU vec2 operator * (f32 lhs, const vec2 &rhs) {
-    return {
-            lhs * rhs.x,
-            lhs * rhs.y
-    };
-}
+    INLINE_XPU vec2& operator /= (const vec2 &rhs) {
+        x /= rhs.x;
+        y /= rhs.y;
+        return *this;
+    }
 
-INLINE_XPU vec2 lerp(const vec2 &from, const vec2 &to, f32 by) {
-    return (to - from).scaleAdd(by, from);
-}
+    INLINE_XPU vec2 operator - (f32 rhs) const {
+        return {
+                x - rhs,
+                y - rhs
+        };
+    }
 
-struct mat2 {
-    vec2 X, Y;
+    INLINE_XPU vec2 operator + (f32 rhs) const {
+        return {
+                x + rhs,
+                y + rhs
+        };
+    }
 
-    static mat2 Identity;
+    INLINE_XPU vec2 operator * (f32 rhs) const {
+        return {
+                x * rhs,
+                y * rhs
+        };
+    }
 
-    INLINE_XPU mat2() : mat2{
-            vec2{1.0f, 0.0f},
-            vec2{0.0f, 1.0f}
-    } {}
-    INLINE_XPU mat2(vec2i x, vec2i y) noexcept : X{x}, Y{y} {}
-    INLINE_XPU mat2(vec2i x, vec2 y) noexcept : X{x}, Y{y} {}
-    INLINE_XPU mat2(vec2 x, vec2i y) noexcept : X{x}, Y{y} {}
-    INLINE_XPU mat2(vec2 x, vec2 y) noexcept : X{x}, Y{y} {}
-    INLINE_XPU mat2(f32 Xx, f32 Xy, f32 Yx, f32 Yy) noexcept : X{Xx, Xy}, Y{Yx, Yy} {}
-    INLINE_XPU mat2(i32 Xx, i32 Xy, i32 Yx, i32 Yy) noexcept : X{(f32)Xx, (f32)Xy}, Y{(f32)Yx, (f32)Yy} {}
-    INLINE_XPU mat2(const mat2 &other) noexcept : mat2{other.X, other.Y} {}
+    INLINE_XPU vec2 operator / (f32 rhs) const {
+        f32 factor = 1.0f / rhs;
+        return {
+                x * factor,
+                y * factor
+        };
+    }
 
-    INLINE_XPU f32 det() const {
-        return X.x*Y.y - X.y*Y.x;
+    INLINE_XPU vec2& operator -= (f32 rhs) {
+        x -= rhs;
+        y -= rhs;
+        return *this;
     }
 
-    INLINE_XPU bool has_inverse() const {
-        return det() != 0;
+    INLINE_XPU vec2& operator += (f32 rhs) {
+        x += rhs;
+        y += rhs;
+        return *this;
     }
 
-    INLINE_XPU mat2 operator ! () const {
-        return inverted();
+    INLINE_XPU vec2& operator *= (f32 rhs) {
+        x *= rhs;
+        y *= rhs;
+        return *this;
     }
 
-    INLINE_XPU mat2 operator ~ () const {
-        return transposed();
+    INLINE_XPU vec2& operator /= (f32 rhs) {
+        f32 factor = 1.0f / rhs;
+        x *= factor;
+        y *= factor;
+        return *this;
     }
 
-    INLINE_XPU mat2 operator + (f32 rhs) const {
+    INLINE_XPU vec2 operator - (i32 rhs) const {
         return {
-                X.x + rhs, X.y + rhs,
-                Y.x + rhs, Y.y + rhs
+                x - (f32)rhs,
+                y - (f32)rhs
         };
     }
 
-    INLINE_XPU mat2 operator - (f32 rhs) const {
+    INLINE_XPU vec2 operator + (i32 rhs) const {
         return {
-                X.x - rhs, X.y - rhs,
-                Y.x - rhs, Y.y - rhs
+                x + (f32)rhs,
+                y + (f32)rhs
         };
     }
 
-    INLINE_XPU mat2 operator * (f32 rhs) const {
+    INLINE_XPU vec2 operator * (i32 rhs) const {
         return {
-                X.x * rhs, X.y * rhs,
-                Y.x * rhs, Y.y * rhs
+                x * (f32)rhs,
+                y * (f32)rhs
         };
     }
 
-    INLINE_XPU mat2 operator / (f32 rhs) const {
-        f32 factor = 1.0f / rhs;
+    INLINE_XPU vec2 operator / (i32 rhs) const {
+        f32 factor = 1.0f / (f32)rhs;
         return {
-                X.x * factor, X.y * factor,
-                Y.x * factor, Y.y * factor
+                x * factor,
+                y * factor
         };
     }
 
-    INLINE_XPU mat2 operator + (const mat2 &rhs) const {
-        return {
-                X.x + rhs.X.x, X.y + rhs.X.y,
-                Y.x + rhs.Y.x, Y.y + rhs.Y.y
-        };
+    INLINE_XPU vec2& operator -= (i32 rhs) {
+        x -= (f32)rhs;
+        y -= (f32)rhs;
+        return *this;
     }
 
-    INLINE_XPU mat2 operator - (const mat2 &rhs) const {
+    INLINE_XPU vec2& operator += (i32 rhs) {
+        x += (f32)rhs;
+        y += (f32)rhs;
+        return *this;
+    }
+
+    INLINE_XPU vec2& operator *= (i32 rhs) {
+        x *= (f32)rhs;
+        y *= (f32)rhs;
+        return *this;
+    }
+
+    INLINE_XPU vec2& operator /= (i32 rhs) {
+        f32 factor = 1.0f / (f32)rhs;
+        x *= factor;
+        y *= factor;
+        return *this;
+    }
+
+    INLINE_XPU vec2 operator - (const vec2i &rhs) const {
         return {
-                X.x - rhs.X.x, X.y - rhs.X.y,
-                Y.x - rhs.Y.x, Y.y - rhs.Y.y
+                x - (f32)rhs.x,
+                y - (f32)rhs.y
         };
     }
 
-    INLINE_XPU mat2 operator * (const mat2 &rhs) const {
+    INLINE_XPU vec2 operator + (const vec2i &rhs) const {
         return {
-                X.x*rhs.X.x + X.y*rhs.Y.x, // Row 1 | Column 1
-                X.x*rhs.X.y + X.y*rhs.Y.y, // Row 1 | Column 2
-                Y.x*rhs.X.x + Y.y*rhs.Y.x, // Row 2 | Column 1
-                Y.x*rhs.X.y + Y.y*rhs.Y.y  // Row 2 | Column 2
+                x + (f32)rhs.x,
+                y + (f32)rhs.y
         };
     }
 
-    INLINE_XPU vec2 operator * (const vec2 &rhs) const {
+    INLINE_XPU vec2 operator * (const vec2i &rhs) const {
         return {
-                X.x*rhs.x + Y.x*rhs.y,
-                X.y*rhs.x + Y.y*rhs.y
+                x * (f32)rhs.x,
+                y * (f32)rhs.y
         };
     }
 
-    INLINE_XPU void operator += (const mat2 &rhs) {
-        X.x += rhs.X.x;
-        X.y += rhs.X.y;
-        Y.x += rhs.Y.x;
-        Y.y += rhs.Y.y;
+    INLINE_XPU vec2 operator / (const vec2i &rhs) const {
+        return {
+                x / (f32)rhs.x,
+                y / (f32)rhs.y
+        };
     }
 
-    INLINE_XPU void operator -= (const mat2 &rhs) {
-        X.x -= rhs.X.x;
-        X.y -= rhs.X.y;
-        Y.x -= rhs.Y.x;
-        Y.y -= rhs.Y.y;
+    INLINE_XPU vec2& operator -= (const vec2i &rhs) {
+        x -= (f32)rhs.x;
+        y -= (f32)rhs.y;
+        return *this;
     }
 
-    INLINE_XPU void operator *= (const mat2 &rhs) {
-        mat2 lhs{*this};
-        X.x = lhs.X.x*rhs.X.x + lhs.X.y*rhs.Y.x; // Row 1 | Column 1
-        X.y = lhs.X.x*rhs.X.y + lhs.X.y*rhs.Y.y; // Row 1 | Column 2
-        Y.x = lhs.Y.x*rhs.X.x + lhs.Y.y*rhs.Y.x; // Row 2 | Column 1
-        Y.y = lhs.Y.x*rhs.X.y + lhs.Y.y*rhs.Y.y; // Row 2 | Column 2
+    INLINE_XPU vec2& operator += (const vec2i &rhs) {
+        x += (f32)rhs.x;
+        y += (f32)rhs.y;
+        return *this;
     }
 
-    INLINE_XPU void operator += (f32 rhs) {
-        X.x += rhs;
-        X.y += rhs;
-        Y.x += rhs;
-        Y.y += rhs;
+    INLINE_XPU vec2& operator *= (const vec2i &rhs) {
+        x *= (f32)rhs.x;
+        y *= (f32)rhs.y;
+        return *this;
     }
 
-    INLINE_XPU void operator -= (f32 rhs) {
-        X.x -= rhs;
-        X.y -= rhs;
-        Y.x -= rhs;
-        Y.y -= rhs;
+    INLINE_XPU vec2& operator /= (const vec2i &rhs) {
+        x /= (f32)rhs.x;
+        y /= (f32)rhs.y;
+        return *this;
     }
 
-    INLINE_XPU void operator *= (f32 rhs) {
-        X.x *= rhs;
-        X.y *= rhs;
-        Y.x *= rhs;
-        Y.y *= rhs;
+    INLINE_XPU bool nonZero() const {
+        return x != 0.0f ||
+               y != 0.0f;
     }
 
-    INLINE_XPU void operator /= (f32 rhs) {
-        f32 factor = 1.0f / rhs;
-        X.x *= factor;
-        X.y *= factor;
-        Y.x *= factor;
-        Y.y *= factor;
+    INLINE_XPU f32 minimum() const {
+        return x < y ? x : y;
     }
 
-    INLINE_XPU void setRotation(f32 angle) {
-        X.x = Y.y = cos(angle);
-        Y.x = X.y = sin(angle);
-        X.y = -X.y;
+    INLINE_XPU f32 maximum() const {
+        return x > y ? x : y;
     }
 
-    INLINE_XPU void rotate(f32 angle) {
-        f32 c = cos(angle);
-        f32 s = sin(angle);
-        mat2 lhs{*this};
-        X.x = c*lhs.X.x + s*lhs.X.y; // Row 1 | Column 1
-        X.y = c*lhs.X.y - s*lhs.X.x; // Row 1 | Column 2
-        Y.x = c*lhs.Y.x + s*lhs.Y.y; // Row 2 | Column 1
-        Y.y = c*lhs.Y.y - s*lhs.Y.x; // Row 2 | Column 2
-    }
-
-    INLINE_XPU mat2 rotated_by(f32 angle) const {
-        f32 c = cos(angle);
-        f32 s = sin(angle);
+    INLINE_XPU vec2 perp() const {
         return {
-                c*X.x + s*X.y, c*Y.x + s*Y.y,
-                c*X.y - s*X.x, c*Y.y - s*Y.x
+                -y,
+                x
         };
     }
 
-    INLINE_XPU mat2 transposed() const {
-        return {
-                X.x, Y.x,
-                X.y, Y.y
-        };
+    INLINE_XPU f32 dot(const vec2 &rhs) const {
+        return (x * rhs.x) + (y * rhs.y);
     }
 
-    INLINE_XPU mat2 inverted() const {
-        return mat2{
-                Y.y, -X.y,
-                -Y.x, X.x
-        } / det();
+    INLINE_XPU f32 cross(const vec2 &rhs) const {
+        return (x * rhs.y) - (y * rhs.x);
     }
-};
-mat2 mat2::Identity = {};
-
-INLINE_XPU mat2 operator * (f32 lhs, const mat2 &rhs) {
-    return rhs * lhs;
-}
-
-INLINE_XPU mat2 operator + (f32 lhs, const mat2 &rhs) {
-    return rhs + lhs;
-}
-
-INLINE_XPU mat2 outer(const vec2 &lhs, const vec2 &rhs) {
-    return {
-            lhs * rhs.x,
-            lhs * rhs.y
-    };
-}
 
+    INLINE_XPU f32 squaredLength() const {
+        return x*x + y*y;
+    }
 
-enum AntiAliasing {
-    NoAA,
-    MSAA,
-    SSAA
-};
-
-struct Canvas {
-    Dimensions dimensions;
-    Pixel *pixels{nullptr};
-    f32 *depths{nullptr};
-
-    AntiAliasing antialias;
-
-    Canvas(u16 width = MAX_WIDTH, u16 height = MAX_HEIGHT, AntiAliasing antialiasing = NoAA) : antialias{antialiasing} {
-        if (memory::canvas_memory_capacity) {
-            pixels = (Pixel*)memory::canvas_memory;
-            memory::canvas_memory += CANVAS_PIXELS_SIZE;
-            memory::canvas_memory_capacity -= CANVAS_PIXELS_SIZE;
+    INLINE_XPU f32 length() const {
+        return sqrtf(squaredLength());
+    }
 
-            depths = (f32*)memory::canvas_memory;
-            memory::canvas_memory += CANVAS_DEPTHS_SIZE;
-            memory::canvas_memory_capacity -= CANVAS_DEPTHS_SIZE;
+    INLINE_XPU vec2 normalized() const {
+        return *this / length();
+    }
 
-            dimensions.update(MAX_WIDTH, MAX_HEIGHT);
-            clear();
-            dimensions.update(width, height);
-        } else {
-            pixels = nullptr;
-            depths = nullptr;
-        }
+    INLINE_XPU vec2 reflectedAround(const vec2 &N) const {
+        return N.scaleAdd(-2 * dot(N), *this);
     }
 
-    Canvas(Pixel *pixels, f32 *depths) noexcept : pixels{pixels}, depths{depths} {}
+    INLINE_XPU vec2 clamped() const {
+        return {
+                clampedValue(x),
+                clampedValue(y)
+        };
+    }
 
-    void clear(f32 red = 0, f32 green = 0, f32 blue = 0, f32 opacity = 1.0f, f32 depth = INFINITY) const {
-        i32 pixels_width  = dimensions.width;
-        i32 pixels_height = dimensions.height;
-        i32 depths_width  = dimensions.width;
-        i32 depths_height = dimensions.height;
+    INLINE_XPU vec2 clamped(const vec2 &upper) const {
+        return {
+                clampedValue(x, upper.x),
+                clampedValue(y, upper.y)
+        };
+    }
 
-        if (antialias != NoAA) {
-            depths_width *= 2;
-            depths_height *= 2;
-            if (antialias == SSAA) {
-                pixels_width *= 2;
-                pixels_height *= 2;
-            }
-        }
+    INLINE_XPU vec2 clamped(const vec2 &lower, const vec2 &upper) const {
+        return {
+                clampedValue(x, lower.x, upper.x),
+                clampedValue(y, lower.y, upper.y)
+        };
+    }
 
-        i32 pixels_count = pixels_width * pixels_height;
-        i32 depths_count = depths_width * depths_height;
+    INLINE_XPU vec2 clamped(const f32 min_value, const f32 max_value) const {
+        return {
+                clampedValue(x, min_value, max_value),
+                clampedValue(y, min_value, max_value)
+        };
+    }
 
-        Pixel pixel{red, green, blue, opacity};
+    INLINE_XPU vec2 approachTo(const vec2 &trg, f32 diff) const {
+        return {
+                approach(x, trg.x, diff),
+                approach(y, trg.y, diff)
+        };
+    }
 
-        if (pixels) for (i32 i = 0; i < pixels_count; i++) pixels[i] = pixel;
-        if (depths) for (i32 i = 0; i < depths_count; i++) depths[i] = depth;
+    INLINE_XPU vec2 lerpTo(const vec2 &to, f32 by) const {
+        return (to - *this).scaleAdd(by, *this);
     }
 
-    void drawFrom(Canvas& source_canvas, const RectI* source_bounds = nullptr, const RectI* target_bounds = nullptr, f32 opacity = 1.0f, bool blend = true, bool include_depths = false) {
-        RectI src{
-                0, source_canvas.dimensions.width,
-                0, source_canvas.dimensions.height
+    INLINE_XPU vec2 scaleAdd(f32 factor, const vec2 &to_be_added) const {
+        return {
+                fast_mul_add(x, factor, to_be_added.x),
+                fast_mul_add(y, factor, to_be_added.y)
         };
-        if (source_bounds)
-            src -= *source_bounds;
+    }
 
-        RectI trg{
-                0, dimensions.width,
-                0, dimensions.height
+    INLINE_XPU vec2 mulAdd(const vec2 &factors, const vec2 &to_be_added) const {
+        return {
+                fast_mul_add(x, factors.x, to_be_added.x),
+                fast_mul_add(y, factors.y, to_be_added.y)
         };
-        if (target_bounds)
-            trg = *target_bounds;
-
-        if ((antialias == SSAA) && (source_canvas.antialias == SSAA)) {
-            src *= 2;
-            trg *= 2;
-        }
+    }
+};
 
-        f32 depth;
+vec2 vec2::X{1.0f, 0.0f};
+vec2 vec2::Y{0.0f, 1.0f};
 
-        i32 src_y = src.top;
-        for (i32 y = trg.top; y < trg.bottom; y++, src_y++) {
-            if (y < 0 || y >= dimensions.height)
-                continue;
+INLINE_XPU vec2 minimum(const vec2 &a, const vec2 &b) {
+    return {
+            a.x < b.x ? a.x : b.x,
+            a.y < b.y ? a.y : b.y
+    };
+}
 
-            i32 src_x = src.left;
+INLINE_XPU vec2 maximum(const vec2 &a, const vec2 &b) {
+    return {
+            a.x > b.x ? a.x : b.x,
+            a.y > b.y ? a.y : b.y
+    };
+}
 
-            for (i32 x = trg.left; x < trg.right; x++, src_x++) {
-                if (x < 0 || x >= dimensions.width)
-                    continue;
+INLINE_XPU vec2i minimum(const vec2i &a, const vec2i &b) {
+    return {
+            a.x < b.x ? a.x : b.x,
+            a.y < b.y ? a.y : b.y
+    };
+}
 
-                i32 src_offset = source_canvas.antialias == SSAA ? (
-                        (source_canvas.dimensions.stride * (src_y >> 1) + (src_x >> 1)) * 4 + (2 * (src_y & 1)) + (src_x & 1)
-                ) : (
-                                         source_canvas.dimensions.stride * src_y + src_x
-                                 );
+INLINE_XPU vec2i maximum(const vec2i &a, const vec2i &b) {
+    return {
+            a.x > b.x ? a.x : b.x,
+            a.y > b.y ? a.y : b.y
+    };
+}
 
-                Pixel& pixel{ source_canvas.pixels[src_offset] };
-                if ((pixel.opacity == 0.0f) || (
-                        (pixel.color.r == 0.0f) &&
-                        (pixel.color.g == 0.0f) &&
-                        (pixel.color.b == 0.0f)))
-                    continue;
+INLINE_XPU vec2i operator - (const vec2i &lhs, const vec2 &rhs) {
+    return {
+            lhs.x - (i32)rhs.x,
+            lhs.y - (i32)rhs.y
+    };
+}
 
-                if (include_depths)
-                    depth = source_canvas.depths[src_offset];
+INLINE_XPU vec2i operator + (const vec2i &lhs, const vec2 &rhs) {
+    return {
+            lhs.x + (i32)rhs.x,
+            lhs.y + (i32)rhs.y
+    };
+}
 
-                if (blend) {
-                    setPixel(x, y, pixel.color / pixel.opacity, pixel.opacity * opacity, include_depths ? depth : 0.0f);
-                }
-                else {
-                    i32 trg_offset = antialias == SSAA ? (
-                            (dimensions.stride * (y >> 1) + (x >> 1)) * 4 + (2 * (y & 1)) + (x & 1)
-                    ) : (
-                                             dimensions.stride * y + x
-                                     );
-                    pixels[trg_offset] = source_canvas.pixels[src_offset];
-                    if (include_depths && depth < depths[trg_offset])
-                        depths[trg_offset] = depth;
-                }
-            }
-        }
-    }
+INLINE vec2i operator * (const vec2i &lhs, const vec2 &rhs) {
+    return {
+            lhs.x * (i32)rhs.x,
+            lhs.y * (i32)rhs.y
+    };
+}
 
-    void drawToWindow() const {
-        u32 *content_value = window::content;
-        Pixel *pixel = pixels;
-        for (u16 y = 0; y < window::height; y++)
-            for (u16 x = 0; x < window::width; x++, content_value++) {
-                *content_value = getPixelContent(pixel);
+INLINE_XPU vec2i operator / (const vec2i &lhs, const vec2 &rhs) {
+    return {
+            lhs.x / (i32)rhs.x,
+            lhs.y / (i32)rhs.y
+    };
+}
 
-                if (antialias == SSAA)
-                    pixel += 4;
-                else
-                    pixel++;
-            }
-    }
+INLINE_XPU vec2i operator - (i32 lhs, const vec2 &rhs) {
+    return {
+            lhs - (i32)rhs.x,
+            lhs - (i32)rhs.y
+    };
+}
 
-    INLINE void setPixel(i32 x, i32 y, const Color &color, f32 opacity = 1.0f, f32 depth = 0, f32 z_top = 0, f32 z_bottom = 0, f32 z_right = 0) const {
-        int w = dimensions.width;
-        int h = dimensions.height;
-        if (antialias == SSAA) {
-            w <<= 1;
-            h <<= 1;
-        }
-        if (x < 0 || y < 0 || x >= w || y >= h)
-            return;
+INLINE vec2i operator + (i32 lhs, const vec2 &rhs) {
+    return {
+            lhs + (i32)rhs.x,
+            lhs + (i32)rhs.y
+    };
+}
 
-        opacity = clampedValue(opacity);
-        Pixel pixel{color.clamped(), opacity};
-        pixel.color *= pixel.color;
-        if (opacity != 1.0f)
-            pixel.color *= pixel.opacity;
+INLINE vec2i operator * (i32 lhs, const vec2 &rhs) {
+    return {
+            lhs * (i32)rhs.x,
+            lhs * (i32)rhs.y
+    };
+}
 
-        u32 offset = antialias == SSAA ? ((dimensions.stride * (y >> 1) + (x >> 1)) * 4 + (2 * (y & 1)) + (x & 1)) : (dimensions.stride * y + x);
-        Pixel *out_pixel = pixels + offset;
-        f32 *out_depth = depths ? (depths + (antialias == MSAA ? offset * 4 : offset)) : nullptr;
-        if (
-                (
-                        (out_depth == nullptr ||
-                         *out_depth == INFINITY) &&
-                        (out_pixel->color.r == 0) &&
-                        (out_pixel->color.g == 0) &&
-                        (out_pixel->color.b == 0)
-                ) ||
-                (
-                        (opacity == 1.0f) &&
-                        (depth == 0.0f) &&
-                        (z_top == 0.0f) &&
-                        (z_bottom == 0.0f) &&
-                        (z_right == 0.0f)
-                )
-                ) {
-            *out_pixel = pixel;
-            if (depths) {
-                out_depth[0] = depth;
-                if (antialias == MSAA) out_depth[1] = out_depth[2] = out_depth[3] = 0;
-            }
+INLINE_XPU vec2i operator / (i32 lhs, const vec2 &rhs) {
+    return {
+            lhs / (i32)rhs.x,
+            lhs / (i32)rhs.y
+    };
+}
 
-            return;
-        }
+INLINE_XPU vec2i operator - (i32 lhs, const vec2i &rhs) {
+    return {
+            lhs - rhs.x,
+            lhs - rhs.y
+    };
+}
 
-        Pixel *bg{out_pixel}, *fg{&pixel};
-        if (antialias == MSAA) {
-            Pixel accumulated_pixel{};
-            for (u8 i = 0; i < 4; i++) {
-                if (depths) {
-                    if (i) depth = i == 1 ? z_top : (i == 2 ? z_bottom : z_right);
-                    _sortPixelsByDepth(depth, &pixel, out_depth, out_pixel, &bg, &fg);
-                    out_depth++;
-                }
-                accumulated_pixel += fg->opacity == 1 ? *fg : fg->alphaBlendOver(*bg);
-            }
-            *out_pixel = accumulated_pixel * 0.25f;
-        } else {
-            if (depths)
-                _sortPixelsByDepth(depth, &pixel, out_depth, out_pixel, &bg, &fg);
-            *out_pixel = fg->opacity == 1 ? *fg : fg->alphaBlendOver(*bg);
-        }
-    }
+INLINE_XPU vec2i operator + (i32 lhs, const vec2i &rhs) {
+    return {
+            lhs + rhs.x,
+            lhs + rhs.y
+    };
+}
 
-    INLINE u32 getPixelContent(Pixel *pixel) const {
-        return antialias == SSAA ? _isTransparentPixelQuad(pixel) ? 0 : _blendPixelQuad(pixel).asContent() :
-               pixel->opacity == 0.0f ? 0 : pixel->asContent();
-    }
+INLINE_XPU vec2i operator * (i32 lhs, const vec2i &rhs) {
+    return {
+            lhs * rhs.x,
+            lhs * rhs.y
+    };
+}
 
-    INLINE void drawText(char *str, i32 x, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-#ifdef SLIM_VEC2
-    INLINE void drawText(char *str, vec2i position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawText(char *str, vec2 position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-#endif
+INLINE_XPU vec2i operator / (i32 lhs, const vec2i &rhs) {
+    return {
+            lhs / rhs.x,
+            lhs / rhs.y
+    };
+}
 
-    INLINE void drawNumber(i32 number, i32 x, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-#ifdef SLIM_VEC2
-    INLINE void drawNumber(i32 number, vec2i position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawNumber(i32 number, vec2 position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-#endif
+INLINE_XPU vec2 operator - (f32 lhs, const vec2 &rhs) {
+    return {
+            lhs - rhs.x,
+            lhs - rhs.y
+    };
+}
 
-    INLINE void drawHLine(RangeI x_range, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawHLine(i32 x_start, i32 x_end, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawVLine(RangeI y_range, i32 x, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawVLine(i32 y_start, i32 y_end, i32 x, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawLine(f32 x1, f32 y1, f32 x2, f32 y2, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
+INLINE_XPU vec2 operator + (f32 lhs, const vec2 &rhs) {
+    return {
+            lhs + rhs.x,
+            lhs + rhs.y
+    };
+}
 
-#ifdef SLIM_VEC2
-    INLINE void drawLine(vec2 from, vec2 to, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawLine(vec2i from, vec2i to, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
-#endif
+INLINE_XPU vec2 operator / (f32 lhs, const vec2 &rhs) {
+    return {
+            lhs / rhs.x,
+            lhs / rhs.y
+    };
+}
 
-    INLINE void drawRect(RectI rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawRect(Rect rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillRect(RectI rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillRect(Rect rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+INLINE_XPU vec2 operator * (f32 lhs, const vec2 &rhs) {
+    return {
+            lhs * rhs.x,
+            lhs * rhs.y
+    };
+}
 
-    INLINE void drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+INLINE_XPU vec2 lerp(const vec2 &from, const vec2 &to, f32 by) {
+    return (to - from).scaleAdd(by, from);
+}
 
-#ifdef SLIM_VEC2
-    INLINE void drawTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-#endif
 
-    INLINE void fillCircle(i32 center_x, i32 center_y, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawCircle(i32 center_x, i32 center_y, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-#ifdef SLIM_VEC2
-    INLINE void drawCircle(vec2i center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillCircle(vec2i center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void drawCircle(vec2 center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-    INLINE void fillCircle(vec2 center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
-#endif
+struct mat2 {
+    vec2 X, Y;
 
-private:
-    static INLINE bool _isTransparentPixelQuad(Pixel *pixel_quad) {
-        return (
-                (pixel_quad[0].opacity == 0.0f) &&
-                (pixel_quad[1].opacity == 0.0f) &&
-                (pixel_quad[2].opacity == 0.0f) &&
-                (pixel_quad[3].opacity == 0.0f)
-        );
-    }
+    static mat2 Identity;
 
-    INLINE Pixel _blendPixelQuad(Pixel *pixel_quad) const {
-        return (pixel_quad[0] + pixel_quad[1] + pixel_quad[2] + pixel_quad[3]) * 0.25f;
+    INLINE_XPU mat2() : mat2{
+            vec2{1.0f, 0.0f},
+            vec2{0.0f, 1.0f}
+    } {}
+    INLINE_XPU mat2(vec2i x, vec2i y) noexcept : X{x}, Y{y} {}
+    INLINE_XPU mat2(vec2i x, vec2 y) noexcept : X{x}, Y{y} {}
+    INLINE_XPU mat2(vec2 x, vec2i y) noexcept : X{x}, Y{y} {}
+    INLINE_XPU mat2(vec2 x, vec2 y) noexcept : X{x}, Y{y} {}
+    INLINE_XPU mat2(f32 Xx, f32 Xy, f32 Yx, f32 Yy) noexcept : X{Xx, Xy}, Y{Yx, Yy} {}
+    INLINE_XPU mat2(i32 Xx, i32 Xy, i32 Yx, i32 Yy) noexcept : X{(f32)Xx, (f32)Xy}, Y{(f32)Yx, (f32)Yy} {}
+    INLINE_XPU mat2(const mat2 &other) noexcept : mat2{other.X, other.Y} {}
+
+    INLINE_XPU f32 det() const {
+        return X.x*Y.y - X.y*Y.x;
     }
 
-    static INLINE void _sortPixelsByDepth(f32 depth, Pixel *pixel, f32 *out_depth, Pixel *out_pixel, Pixel **background, Pixel **foreground) {
-        if (depth == 0.0f || depth < *out_depth) {
-            *out_depth = depth;
-            *background = out_pixel;
-            *foreground = pixel;
-        } else {
-            *background = pixel;
-            *foreground = out_pixel;
-        }
+    INLINE_XPU bool has_inverse() const {
+        return det() != 0;
     }
-};
 
+    INLINE_XPU mat2 operator ! () const {
+        return inverted();
+    }
 
-void drawImage(const PixelImage &image, const Canvas &canvas, RectI bounds, f32 opacity = 1.0f) {
-    if (bounds.right < 0 ||
-        bounds.bottom < 0 ||
-        bounds.left >= canvas.dimensions.width ||
-        bounds.top >= canvas.dimensions.height)
-        return;
+    INLINE_XPU mat2 operator ~ () const {
+        return transposed();
+    }
 
-    i32 image_width = (i32)image.width;
-    i32 image_height = (i32)image.height;
-    i32 width = bounds.right - bounds.left;
-    i32 height = bounds.bottom - bounds.top;
-    if (width > image_width) {
-        width = image_width;
-        bounds.right = bounds.left + width;
+    INLINE_XPU mat2 operator + (f32 rhs) const {
+        return {
+                X.x + rhs, X.y + rhs,
+                Y.x + rhs, Y.y + rhs
+        };
     }
-    if (height > image_height) {
-        height = image_height;
-        bounds.bottom = bounds.top + height;
+
+    INLINE_XPU mat2 operator - (f32 rhs) const {
+        return {
+                X.x - rhs, X.y - rhs,
+                Y.x - rhs, Y.y - rhs
+        };
     }
 
-    Pixel *pixel = image.content;
-    if (image.flags.tile) {
-        TiledGridInfo grid{image};
-        u32 X, Y = 0;
-        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
-            X = 0;
-            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
-            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
-                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
+    INLINE_XPU mat2 operator * (f32 rhs) const {
+        return {
+                X.x * rhs, X.y * rhs,
+                Y.x * rhs, Y.y * rhs
+        };
+    }
 
-                for (u32 y = 0; y < tile_height; y++)
-                    for (u32 x = 0; x < tile_width; x++, pixel++)
-                        canvas.setPixel(X + x, Y + y, pixel->color, image.flags.alpha ? (pixel->opacity * opacity) : opacity);
+    INLINE_XPU mat2 operator / (f32 rhs) const {
+        f32 factor = 1.0f / rhs;
+        return {
+                X.x * factor, X.y * factor,
+                Y.x * factor, Y.y * factor
+        };
+    }
 
-                X += image.tile_width;
-            }
-            Y += image.tile_height;
-        }
-    } else {
-        i32 remainder_x = image_width - width;
-        for (i32 y = bounds.top; y <= bounds.bottom; y++) {
-            for (i32 x = bounds.left; x <= bounds.right; x++, pixel++)
-                canvas.setPixel(x, y, pixel->color, image.flags.alpha ? (pixel->opacity * opacity) : opacity);
+    INLINE_XPU mat2 operator + (const mat2 &rhs) const {
+        return {
+                X.x + rhs.X.x, X.y + rhs.X.y,
+                Y.x + rhs.Y.x, Y.y + rhs.Y.y
+        };
+    }
 
-            pixel += remainder_x;
-        }
+    INLINE_XPU mat2 operator - (const mat2 &rhs) const {
+        return {
+                X.x - rhs.X.x, X.y - rhs.X.y,
+                Y.x - rhs.Y.x, Y.y - rhs.Y.y
+        };
     }
-}
 
-void drawImage(const FloatImage &image, const Canvas &canvas, RectI bounds, f32 opacity = 1.0f) {
-    if (bounds.right < 0 ||
-        bounds.bottom < 0 ||
-        bounds.left >= canvas.dimensions.width ||
-        bounds.top >= canvas.dimensions.height)
-        return;
+    INLINE_XPU mat2 operator * (const mat2 &rhs) const {
+        return {
+                X.x*rhs.X.x + X.y*rhs.Y.x, // Row 1 | Column 1
+                X.x*rhs.X.y + X.y*rhs.Y.y, // Row 1 | Column 2
+                Y.x*rhs.X.x + Y.y*rhs.Y.x, // Row 2 | Column 1
+                Y.x*rhs.X.y + Y.y*rhs.Y.y  // Row 2 | Column 2
+        };
+    }
 
-    i32 image_width = (i32)image.width;
-    i32 image_height = (i32)image.height;
-    i32 width = bounds.right - bounds.left;
-    i32 height = bounds.bottom - bounds.top;
-    if (width > image_width) {
-        width = image_width;
-        bounds.right = bounds.left + width;
+    INLINE_XPU vec2 operator * (const vec2 &rhs) const {
+        return {
+                X.x*rhs.x + Y.x*rhs.y,
+                X.y*rhs.x + Y.y*rhs.y
+        };
     }
-    if (height > image_height) {
-        height = image_height;
-        bounds.bottom = bounds.top + height;
+
+    INLINE_XPU void operator += (const mat2 &rhs) {
+        X.x += rhs.X.x;
+        X.y += rhs.X.y;
+        Y.x += rhs.Y.x;
+        Y.y += rhs.Y.y;
     }
 
-    bool has_opacity = image.flags.alpha;
-    i32 channels_per_pixel = has_opacity ? 4 : 3;
-    Color color;
-    f32 pixel_opacity;
-    f32 *channel = image.content;
-    if (image.flags.tile) {
-        TiledGridInfo grid{image};
-        u32 X, Y = 0;
-        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
-            X = 0;
-            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
-            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
-                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
+    INLINE_XPU void operator -= (const mat2 &rhs) {
+        X.x -= rhs.X.x;
+        X.y -= rhs.X.y;
+        Y.x -= rhs.Y.x;
+        Y.y -= rhs.Y.y;
+    }
 
-                for (u32 y = 0; y < tile_height; y++) {
-                    for (u32 x = 0; x < tile_width; x++) {
-                        color.r = *(channel++);
-                        color.g = *(channel++);
-                        color.b = *(channel++);
-                        if (has_opacity)
-                            pixel_opacity = *(channel++);
-                        else
-                            pixel_opacity = 1.0f;
+    INLINE_XPU void operator *= (const mat2 &rhs) {
+        mat2 lhs{*this};
+        X.x = lhs.X.x*rhs.X.x + lhs.X.y*rhs.Y.x; // Row 1 | Column 1
+        X.y = lhs.X.x*rhs.X.y + lhs.X.y*rhs.Y.y; // Row 1 | Column 2
+        Y.x = lhs.Y.x*rhs.X.x + lhs.Y.y*rhs.Y.x; // Row 2 | Column 1
+        Y.y = lhs.Y.x*rhs.X.y + lhs.Y.y*rhs.Y.y; // Row 2 | Column 2
+    }
 
-                        canvas.setPixel(X + x, Y + y, color, pixel_opacity * opacity);
-                    }
-                }
+    INLINE_XPU void operator += (f32 rhs) {
+        X.x += rhs;
+        X.y += rhs;
+        Y.x += rhs;
+        Y.y += rhs;
+    }
 
-                X += image.tile_width;
-            }
-            Y += image.tile_height;
-        }
-    } else {
-        i32 remainder_x = ((i32)image.stride - width) * channels_per_pixel;
-        for (i32 y = bounds.top; y <= bounds.bottom; y++) {
-            for (i32 x = bounds.left; x <= bounds.right; x++) {
-                color.r = *(channel++);
-                color.g = *(channel++);
-                color.b = *(channel++);
-                if (has_opacity)
-                    pixel_opacity = *(channel++);
-                else
-                    pixel_opacity = 1.0f;
+    INLINE_XPU void operator -= (f32 rhs) {
+        X.x -= rhs;
+        X.y -= rhs;
+        Y.x -= rhs;
+        Y.y -= rhs;
+    }
 
-                canvas.setPixel(x, y, color, pixel_opacity * opacity);
-            }
+    INLINE_XPU void operator *= (f32 rhs) {
+        X.x *= rhs;
+        X.y *= rhs;
+        Y.x *= rhs;
+        Y.y *= rhs;
+    }
 
-            channel += remainder_x;
-        }
+    INLINE_XPU void operator /= (f32 rhs) {
+        f32 factor = 1.0f / rhs;
+        X.x *= factor;
+        X.y *= factor;
+        Y.x *= factor;
+        Y.y *= factor;
+    }
+
+    INLINE_XPU void setRotation(f32 angle) {
+        X.x = Y.y = cos(angle);
+        Y.x = X.y = sin(angle);
+        X.y = -X.y;
+    }
+
+    INLINE_XPU void rotate(f32 angle) {
+        f32 c = cos(angle);
+        f32 s = sin(angle);
+        mat2 lhs{*this};
+        X.x = c*lhs.X.x + s*lhs.X.y; // Row 1 | Column 1
+        X.y = c*lhs.X.y - s*lhs.X.x; // Row 1 | Column 2
+        Y.x = c*lhs.Y.x + s*lhs.Y.y; // Row 2 | Column 1
+        Y.y = c*lhs.Y.y - s*lhs.Y.x; // Row 2 | Column 2
+    }
+
+    INLINE_XPU mat2 rotated_by(f32 angle) const {
+        f32 c = cos(angle);
+        f32 s = sin(angle);
+        return {
+                c*X.x + s*X.y, c*Y.x + s*Y.y,
+                c*X.y - s*X.x, c*Y.y - s*Y.x
+        };
+    }
+
+    INLINE_XPU mat2 transposed() const {
+        return {
+                X.x, Y.x,
+                X.y, Y.y
+        };
+    }
+
+    INLINE_XPU mat2 inverted() const {
+        return mat2{
+                Y.y, -X.y,
+                -Y.x, X.x
+        } / det();
     }
+};
+mat2 mat2::Identity = {};
+
+INLINE_XPU mat2 operator * (f32 lhs, const mat2 &rhs) {
+    return rhs * lhs;
 }
 
-void drawImage(const ByteColorImage &image, const Canvas &canvas, RectI bounds, f32 opacity = 1.0f) {
-    if (bounds.right < 0 ||
-        bounds.bottom < 0 ||
-        bounds.left >= canvas.dimensions.width ||
-        bounds.top >= canvas.dimensions.height)
-        return;
+INLINE_XPU mat2 operator + (f32 lhs, const mat2 &rhs) {
+    return rhs + lhs;
+}
 
-    i32 image_width = (i32)image.width;
-    i32 image_height = (i32)image.height;
-    i32 width = bounds.right - bounds.left;
-    i32 height = bounds.bottom - bounds.top;
-    if (width > image_width) {
-        width = image_width;
-        bounds.right = bounds.left + width;
+INLINE_XPU mat2 outer(const vec2 &lhs, const vec2 &rhs) {
+    return {
+            lhs * rhs.x,
+            lhs * rhs.y
+    };
+}
+
+
+// Packets of 2D vectors, with their x and y components in separate lanes (structure of arrays).
+// As with the lane types (see core/simd.h), vec2x8 is for code compiled with AVX2 (or for kernel bodies shared by all widths),
+// and the methods are force-inlined so that they always end up inside such code:
+template <typename F32>
+struct vec2x {
+    static constexpr u32 width = F32::width;
+    F32 x, y;
+
+    SLIM_INLINE_KERNEL vec2x() = default;
+    SLIM_INLINE_KERNEL vec2x(const F32 &x, const F32 &y) : x{x}, y{y} {}
+    SLIM_INLINE_KERNEL explicit vec2x(const vec2 &value) : x{value.x}, y{value.y} {}
+
+    SLIM_INLINE_KERNEL static vec2x load(const f32 *xs, const f32 *ys) {
+        return {F32::load(xs), F32::load(ys)};
     }
-    if (height > image_height) {
-        height = image_height;
-        bounds.bottom = bounds.top + height;
+
+    SLIM_INLINE_KERNEL void store(f32 *xs, f32 *ys) const {
+        x.store(xs);
+        y.store(ys);
     }
 
-    Pixel pixel;;
-    ByteColor *byte_color = image.content;
-    if (image.flags.tile) {
-        TiledGridInfo grid{image};
-        u32 X, Y = 0;
-        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
-            X = 0;
-            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
-            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
-                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
+    // From and to arrays of vec2 (or any x, y pairs):
+    SLIM_INLINE_KERNEL static vec2x loadInterleaved(const f32 *values) {
+        vec2x result;
+        deinterleave(F32::load(values), F32::load(values + width), result.x, result.y);
+        return result;
+    }
 
-                for (u32 y = 0; y < tile_height; y++) {
-                    for (u32 x = 0; x < tile_width; x++, byte_color++) {
-                        pixel = *byte_color;
-                        canvas.setPixel(X + x, Y + y, pixel.color, image.flags.alpha ? (pixel.opacity * opacity) : opacity);
-                    }
-                }
+    SLIM_INLINE_KERNEL void storeInterleaved(f32 *values) const {
+        F32 first, second;
+        interleave(x, y, first, second);
+        first.store(values);
+        second.store(values + width);
+    }
 
-                X += image.tile_width;
-            }
-            Y += image.tile_height;
-        }
-    } else {
-        i32 remainder_x = (i32)image.stride - width;
-        for (i32 y = bounds.top; y <= bounds.bottom; y++) {
-            for (i32 x = bounds.left; x <= bounds.right; x++, byte_color++) {
-                pixel = *byte_color;
-                canvas.setPixel(x, y, pixel.color, image.flags.alpha ? (pixel.opacity * opacity) : opacity);
-            }
+    SLIM_INLINE_KERNEL vec2x operator + (const vec2x &rhs) const { return {x + rhs.x, y + rhs.y}; }
+    SLIM_INLINE_KERNEL vec2x operator - (const vec2x &rhs) const { return {x - rhs.x, y - rhs.y}; }
+    SLIM_INLINE_KERNEL vec2x operator * (const vec2x &rhs) const { return {x * rhs.x, y * rhs.y}; }
+    SLIM_INLINE_KERNEL vec2x operator * (const F32 &rhs) const { return {x * rhs, y * rhs}; }
+    SLIM_INLINE_KERNEL vec2x operator / (const F32 &rhs) const { return {x / rhs, y / rhs}; }
 
-            byte_color += remainder_x;
-        }
+    SLIM_INLINE_KERNEL F32 dot(const vec2x &rhs) const {
+        return (x * rhs.x) + (y * rhs.y);
     }
-}
 
-void drawImageToWindow(const ByteColorImage &image, RectI bounds, f32 opacity = 1.0f) {
-    if (bounds.right < 0 ||
-        bounds.bottom < 0 ||
-        bounds.left >= window::width ||
-        bounds.top >= window::height)
-        return;
+    SLIM_INLINE_KERNEL F32 cross(const vec2x &rhs) const {
+        return (x * rhs.y) - (y * rhs.x);
+    }
 
-    i32 image_width = (i32)image.width;
-    i32 image_height = (i32)image.height;
-    i32 width = bounds.right - bounds.left;
-    i32 height = bounds.bottom - bounds.top;
-    if (width > image_width) {
-        width = image_width;
-        bounds.right = bounds.left + width;
+    SLIM_INLINE_KERNEL F32 squaredLength() const {
+        return x*x + y*y;
     }
-    if (height > image_height) {
-        height = image_height;
-        bounds.bottom = bounds.top + height;
+
+    SLIM_INLINE_KERNEL F32 length() const {
+        return sqrt(squaredLength());
     }
 
-    ByteColor *byte_color = image.content;
-    if (image.flags.tile) {
-        TiledGridInfo grid{image};
-        u32 X, Y = 0;
-        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
-            X = 0;
-            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
-            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
-                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
+    SLIM_INLINE_KERNEL vec2x normalized() const {
+        return *this / length();
+    }
 
-                for (u32 y = 0; y < tile_height; y++)
-                    for (u32 x = 0; x < tile_width; x++, byte_color++)
-                        window::content[window::width * (Y + y) + X + x] = byte_color->value;
+    // Through reciprocal square roots, approximated and refined (see refinedRsqrt()) instead of divided by:
+    SLIM_INLINE_KERNEL F32 approxLength() const {
+        F32 squared_length = squaredLength();
+        return squared_length * refinedRsqrt(squared_length);
+    }
 
-                X += image.tile_width;
-            }
-            Y += image.tile_height;
-        }
-    } else {
-        i32 remainder_x = (i32)image.stride - width;
-        for (i32 y = bounds.top; y <= bounds.bottom; y++) {
-            for (i32 x = bounds.left; x <= bounds.right; x++, byte_color++)
-                window::content[window::width * y + x] = byte_color->value;
+    SLIM_INLINE_KERNEL vec2x approxNormalized() const {
+        return *this * refinedRsqrt(squaredLength());
+    }
 
-            byte_color += remainder_x;
-        }
+    // Rotated as by a mat2 set to the rotation (see mat2::setRotation()), given the cosine and sine of the angle per lane:
+    SLIM_INLINE_KERNEL vec2x rotated(const F32 &cos_angle, const F32 &sin_angle) const {
+        return {
+                x*cos_angle + y*sin_angle,
+                y*cos_angle - x*sin_angle
+        };
     }
-}
 
-void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f) {
-    Color texel_color;
-    i32 draw_width = draw_bounds.right - draw_bounds.left+1;
-    i32 draw_height = draw_bounds.bottom - draw_bounds.top+1;
-    if (cropped) {
-        if (draw_width > (i32)texture_mip.width) draw_width = (i32)texture_mip.width;
-        if (draw_height > (i32)texture_mip.height) draw_height = (i32)texture_mip.height;
-        i32 remainder_x = 1 + (i32)texture_mip.width - draw_width;
-        TexelQuad *texel_quad = texture_mip.texel_quads;
-        i32 Y = draw_bounds.top;
-        for (i32 y = 0; y < draw_height; y++, Y++) {
-            i32 X = draw_bounds.left;
-            for (i32 x = 0; x < draw_width; x++, X++, texel_quad++) {
-                texel_color.r = (f32)texel_quad->R.BR * COLOR_COMPONENT_TO_FLOAT;
-                texel_color.g = (f32)texel_quad->G.BR * COLOR_COMPONENT_TO_FLOAT;
-                texel_color.b = (f32)texel_quad->B.BR * COLOR_COMPONENT_TO_FLOAT;
-                canvas.setPixel(X, Y, texel_color, opacity);
+    SLIM_INLINE_KERNEL vec2x rotated(f32 angle) const {
+        return rotated(F32{cosf(angle)}, F32{sinf(angle)});
+    }
+
+    SLIM_INLINE_KERNEL vec2x lerpTo(const vec2x &to, const F32 &by) const {
+        return (to - *this) * by + *this;
+    }
+
+    // Transformed as by mat2::operator*, then translated:
+    SLIM_INLINE_KERNEL vec2x transformed(const vec2x &X, const vec2x &Y, const vec2x &translation) const {
+        return X*x + Y*y + translation;
+    }
+};
+
+typedef vec2x<f32x4> vec2x4;
+typedef vec2x<f32x8> vec2x8;
+
+template <typename F32>
+SLIM_INLINE_KERNEL vec2x<F32> lerp(const vec2x<F32> &from, const vec2x<F32> &to, const F32 &by) {
+    return from.lerpTo(to, by);
+}
+
+// Bulk transforms of arrays of points (which may be transformed in place), in packets of the widest width the CPU has:
+void _transformPointsScalar(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    for (u32 i = 0; i < count; i++) out[i] = matrix * in[i] + translation;
+}
+
+template <typename F32>
+SLIM_INLINE_KERNEL u32 _transformPointsWide(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    const vec2x<F32> X{matrix.X}, Y{matrix.Y}, T{translation};
+    u32 i = 0;
+    for (; i + F32::width <= count; i += F32::width)
+        vec2x<F32>::loadInterleaved(&in[i].x).transformed(X, Y, T).storeInterleaved(&out[i].x);
+    return i;
+}
+
+#ifdef SLIM_SSE2
+void _transformPointsSSE2(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    u32 i = _transformPointsWide<f32x4>(matrix, translation, in, out, count);
+    if (i < count) _transformPointsScalar(matrix, translation, in + i, out + i, count - i);
+}
+#endif
+
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 void _transformPointsAVX2(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    u32 i = _transformPointsWide<f32x8>(matrix, translation, in, out, count);
+    if (i < count) _transformPointsSSE2(matrix, translation, in + i, out + i, count - i);
+}
+#endif
+
+typedef void (*TransformPointsKernel)(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count);
+TransformPointsKernel transform_points_kernel = selectKernel<TransformPointsKernel>(
+        _transformPointsScalar,
+        SIMD_SSE2_KERNEL(_transformPointsSSE2),
+        SIMD_AVX2_KERNEL(_transformPointsAVX2));
+
+// Gives the same results as transforming each point with mat2::operator* and adding the translation:
+INLINE void transformPoints(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    transform_points_kernel(matrix, translation, in, out, count);
+}
+
+
+// Fills values with the given one, using non-temporal stores that bypass the caches where possible:
+// Clearing whole buffers through the caches would only evict everything else from them.
+template <typename T>
+void streamFill(T *values, u64 count, const T &value) {
+#ifdef SLIM_SSE2
+    if (16 % sizeof(T) == 0 && ((u64)values & 15) % sizeof(T) == 0) {
+        for (; count && ((u64)values & 15); count--) *values++ = value;
+
+        alignas(16) T lanes[16 / sizeof(T)];
+        for (T &lane : lanes) lane = value;
+        __m128i pattern = _mm_load_si128((const __m128i*)lanes);
+
+        u64 vector_count = count / (16 / sizeof(T));
+        __m128i *vectors = (__m128i*)values;
+        for (u64 i = 0; i < vector_count; i++) _mm_stream_si128(vectors + i, pattern);
+        _mm_sfence();
+
+        values += vector_count * (16 / sizeof(T));
+        count  -= vector_count * (16 / sizeof(T));
+    }
+#endif
+    for (u64 i = 0; i < count; i++) values[i] = value;
+}
+
+// Fills a (short) span of values with the given one using vector stores, keeping the span in the caches:
+template <typename T>
+INLINE void spanFill(T *values, u32 count, const T &value) {
+#ifdef SLIM_SSE2
+    if (16 % sizeof(T) == 0 && count >= 16 / sizeof(T)) {
+        alignas(16) T lanes[16 / sizeof(T)];
+        for (T &lane : lanes) lane = value;
+        __m128i pattern = _mm_load_si128((const __m128i*)lanes);
+
+        u32 vector_count = count / (16 / sizeof(T));
+        __m128i *vectors = (__m128i*)values;
+        for (u32 i = 0; i < vector_count; i++) _mm_storeu_si128(vectors + i, pattern);
+
+        values += vector_count * (16 / sizeof(T));
+        count  -= vector_count * (16 / sizeof(T));
+    }
+#endif
+    for (u32 i = 0; i < count; i++) values[i] = value;
+}
+
+// Blends a (depth-less) pixel over a span of samples, as setPixel() does when given no depth:
+// Samples that are still background (black with no depth in front) get replaced instead, and their depths are zeroed.
+template <typename T>
+INLINE void blendSpan(T *samples, f32 *depths, u32 count, const Pixel &pixel) {
+    for (u32 i = 0; i < count; i++) {
+        Pixel current_pixel{loadPixel(samples[i])};
+        bool is_background = (depths == nullptr || depths[i] == INFINITY) &&
+                current_pixel.color.r == 0 &&
+                current_pixel.color.g == 0 &&
+                current_pixel.color.b == 0;
+        storePixel(samples[i], is_background ? pixel : pixel.alphaBlendOver(current_pixel));
+        if (depths) depths[i] = 0;
+    }
+}
+
+#ifdef SLIM_SSE2
+// Full-float samples blend 4 components at once (with the same operations as Pixel::alphaBlendOver, so bit-identical):
+template <>
+INLINE void blendSpan<Pixel>(Pixel *samples, f32 *depths, u32 count, const Pixel &pixel) {
+    __m128 foreground = _mm_loadu_ps(&pixel.color.r);
+    __m128 transparency = _mm_set1_ps(1.0f - pixel.opacity);
+    __m128 zero = _mm_setzero_ps();
+    for (u32 i = 0; i < count; i++) {
+        f32 *sample = &samples[i].color.r;
+        __m128 background = _mm_loadu_ps(sample);
+        bool is_background = (depths == nullptr || depths[i] == INFINITY) &&
+                (_mm_movemask_ps(_mm_cmpeq_ps(background, zero)) & 7) == 7;
+        _mm_storeu_ps(sample, is_background ? foreground : _mm_add_ps(foreground, _mm_mul_ps(background, transparency)));
+        if (depths) depths[i] = 0;
+    }
+}
+#endif
+
+// Byte samples blend in 16-bit fixed point with no floats, going through tables to and from linear values.
+// The color of the (premultiplied) pixel and its transparency are converted once, the transparency scaled by 65536 (for a shift):
+INLINE u32 blendLinear16(u32 foreground, u32 background, u32 transparency) {
+    u32 value = foreground + ((background * transparency) >> 16);
+    return value < 65535 ? value : 65535;
+}
+
+template <>
+INLINE void blendSpan<PixelRGBA8>(PixelRGBA8 *samples, f32 *depths, u32 count, const Pixel &pixel) {
+    PixelRGBA8 foreground;
+    storePixel(foreground, pixel);
+    const u32 red = toLinear16(pixel.color.r);
+    const u32 green = toLinear16(pixel.color.g);
+    const u32 blue = toLinear16(pixel.color.b);
+    const u32 opacity = toLinear16(pixel.opacity);
+    const f32 transparency_float = (1.0f - clampedValue(pixel.opacity)) * 65536.0f;
+    const u32 transparency = transparency_float < 65535.0f ? (u32)transparency_float : 65535;
+    // Runs of the same background (common on flat, composited surfaces) reuse the last blended value:
+    u32 last_background = count ? ~samples[0].value : 0;
+    u32 last_blended = 0;
+    for (u32 i = 0; i < count; i++) {
+        u32 background = samples[i].value;
+        bool is_background = (depths == nullptr || depths[i] == INFINITY) && !(background & 0xFFFFFF);
+        if (is_background)
+            samples[i].value = foreground.value;
+        else {
+            if (background != last_background) { // Assembled as a whole, as byte stores could alias anything:
+                last_background = background;
+                last_blended =
+                    (u32)linear16_to_byte.values[blendLinear16(blue,  byte_to_linear16.values[background & 0xFF], transparency)] |
+                    (u32)linear16_to_byte.values[blendLinear16(green, byte_to_linear16.values[(background >> 8) & 0xFF], transparency)] << 8 |
+                    (u32)linear16_to_byte.values[blendLinear16(red,   byte_to_linear16.values[(background >> 16) & 0xFF], transparency)] << 16 |
+                    ((blendLinear16(opacity, (background >> 24) * 257, transparency) * 255 + 32768) >> 16) << 24;
+            }
+            samples[i].value = last_blended;
+        }
+        if (depths) depths[i] = 0;
+    }
+}
+
+// Averages the samples of a pixel (summing them in order, then scaling the sum):
+template <typename T>
+INLINE Pixel averageSamples(const T *samples, u32 count) {
+    Pixel sum{loadPixel(samples[0])};
+    for (u32 i = 1; i < count; i++) sum += loadPixel(samples[i]);
+    return sum * (1.0f / (f32)count);
+}
+
+#ifdef SLIM_SSE2
+template <>
+INLINE Pixel averageSamples<Pixel>(const Pixel *samples, u32 count) {
+    __m128 sum = _mm_loadu_ps(&samples[0].color.r);
+    for (u32 i = 1; i < count; i++) sum = _mm_add_ps(sum, _mm_loadu_ps(&samples[i].color.r));
+    Pixel average;
+    _mm_storeu_ps(&average.color.r, _mm_mul_ps(sum, _mm_set1_ps(1.0f / (f32)count)));
+    return average;
+}
+#endif
+
+// Whether 2 stored pixels are the same, bit for bit:
+INLINE bool isSameStoredPixel(const CanvasPixel &a, const CanvasPixel &b) {
+    const u32 *a_words = (const u32*)&a;
+    const u32 *b_words = (const u32*)&b;
+    for (u32 i = 0; i < sizeof(CanvasPixel) / 4; i++)
+        if (a_words[i] != b_words[i])
+            return false;
+    return true;
+}
+
+enum AntiAliasing {
+    NoAA,
+    MSAA,
+    SSAA
+};
+
+// The memory layout of an anti-aliasing mode, known at compile time in code specialized on it (like Canvas::setPixel<SSAA>).
+// Coordinates are in samples, which with SSAA are twice the window's (each pixel's 4 samples being next to each other).
+// With MSAA, coordinates are in pixels as a pixel's samples are only stored separately while they differ (see Canvas::coverSamples):
+template <AntiAliasing AA>
+struct AntiAliasingLayout {
+    static constexpr u32 samples_per_pixel = AA == SSAA ? 4 : 1;
+    static constexpr i32 sample_shift = AA == SSAA ? 1 : 0;
+
+    static INLINE u32 sampleOffset(u32 stride, i32 x, i32 y) {
+        return AA == SSAA ? ((stride * (y >> 1) + (x >> 1)) * 4 + (2 * (y & 1)) + (x & 1)) : (stride * y + x);
+    }
+};
+
+// Where the samples of a pixel are with MSAA, on rotated grids of 2, 4 or 8 samples (as x and y offsets from its center, in pixels):
+const f32 MSAA_SAMPLE_POSITIONS_2[2][2] = {{4.0f / 16, 4.0f / 16}, {-4.0f / 16, -4.0f / 16}};
+const f32 MSAA_SAMPLE_POSITIONS_4[4][2] = {{-2.0f / 16, -6.0f / 16}, {6.0f / 16, -2.0f / 16}, {-6.0f / 16, 2.0f / 16}, {2.0f / 16, 6.0f / 16}};
+const f32 MSAA_SAMPLE_POSITIONS_8[8][2] = {{1.0f / 16, -3.0f / 16}, {-1.0f / 16, 3.0f / 16}, {5.0f / 16, 1.0f / 16}, {-3.0f / 16, -5.0f / 16}, {-5.0f / 16, 5.0f / 16}, {-7.0f / 16, -1.0f / 16}, {3.0f / 16, 7.0f / 16}, {7.0f / 16, -7.0f / 16}};
+
+INLINE const f32 (*getSamplePositions(u32 sample_count))[2] {
+    return sample_count == 8 ? MSAA_SAMPLE_POSITIONS_8 : (sample_count == 4 ? MSAA_SAMPLE_POSITIONS_4 : MSAA_SAMPLE_POSITIONS_2);
+}
+
+struct Canvas;
+struct DrawCommand;
+typedef void (*ReplayDrawCommand)(const DrawCommand &command, const Canvas &canvas);
+
+// A recorded drawing call, followed by its payload (if any, like the text to draw).
+// Replaying it makes the same call again, into a canvas that is clipped to a tile:
+struct DrawCommand {
+    ReplayDrawCommand replay;
+    u32 size; // Including the payload
+    u8 line_width;
+    bool has_viewport_bounds;
+    RectI bounds; // What it may draw into, in window pixels
+    RectI viewport_bounds;
+    Color color;
+    f32 opacity;
+    union {
+        f32 values[6];
+        i32 integers[6];
+    };
+
+    INLINE const RectI* getViewportBounds() const { return has_viewport_bounds ? &viewport_bounds : nullptr; }
+    INLINE char* getPayload() const { return (char*)(this + 1); }
+};
+
+#ifndef DISPLAY_LIST_CAPACITY
+#define DISPLAY_LIST_CAPACITY Megabytes(16)
+#endif
+
+// Drawing calls recorded back to back, to be drawn later on tile by tile in parallel (see Canvas::display_list):
+struct DisplayList {
+    memory::MonotonicAllocator memory;
+    u8 *commands;
+    u32 command_count{0};
+
+    explicit DisplayList(u64 capacity = DISPLAY_LIST_CAPACITY) : memory{capacity}, commands{memory.address} {}
+
+    INLINE u8* end() const { return memory.address; }
+
+    DrawCommand* allocate(u32 payload_size) {
+        u32 size = (u32)(sizeof(DrawCommand) + payload_size + 7) & ~7u;
+        DrawCommand *command = (DrawCommand*)memory.allocate(size);
+        if (command) {
+            command->size = size;
+            command_count++;
+        }
+        return command;
+    }
+
+    void reset() {
+        memory.reset();
+        command_count = 0;
+    }
+};
+
+#ifndef FRAGMENT_BUFFER_CAPACITY
+#define FRAGMENT_BUFFER_CAPACITY Megabytes(64)
+#endif
+
+// How many fragments of a sample get composited (the nearest ones, any farther ones being dropped):
+#ifndef FRAGMENTS_PER_SAMPLE
+#define FRAGMENTS_PER_SAMPLE 16
+#endif
+
+// A translucent pixel drawn with depth, set aside to be composited in depth order (see Canvas::fragments):
+struct Fragment {
+    Pixel pixel;
+    f32 depth;
+    u32 next; // The fragment of the same sample that was added before it (0 for none)
+};
+
+// Fragments linked into a list per sample, from an arena that gets emptied once they are all composited.
+// The arena starts with the heads of the lists (one per sample of the canvas), the rest of it holds fragments:
+struct FragmentBuffer {
+    memory::MonotonicAllocator memory;
+    u32 *heads{nullptr}; // The fragment added last per sample (0 for none)
+    Fragment *fragments{nullptr}; // The first one is not used
+    u32 head_count{0};
+    u32 capacity{0};
+    volatile i32 count{1};
+    u8 tiles[CANVAS_DIRTY_TILES_SIZE]; // Which canvas tiles have any fragments
+
+    explicit FragmentBuffer(u64 capacity = FRAGMENT_BUFFER_CAPACITY) : memory{capacity} {}
+
+    // Lays the memory out for the given number of samples, with all of their lists empty.
+    // When the arena can not even fit the heads (as for large SSAA canvases), it holds no fragments and pixels get drawn right away:
+    void reset(u32 sample_count) {
+        memory.reset();
+        count = 1;
+        for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++) tiles[i] = 0;
+        heads = (u32*)memory.allocate(sizeof(u32) * sample_count);
+        if (!heads) {
+            head_count = capacity = 0;
+            fragments = nullptr;
+            return;
+        }
+
+        head_count = sample_count;
+        for (u32 i = 0; i < sample_count; i++) heads[i] = 0;
+        capacity = (u32)((memory.capacity - memory.occupied) / sizeof(Fragment));
+        fragments = (Fragment*)memory.allocate(sizeof(Fragment) * capacity);
+    }
+
+    // Adds a fragment to the list of the sample at the given offset, returning false when full:
+    INLINE bool add(u32 offset, const Pixel &pixel, f32 depth) {
+        if (!capacity) return false;
+
+        i32 index = atomics::add(&count, 1) - 1;
+        if ((u32)index >= capacity) return false;
+
+        Fragment &fragment = fragments[index];
+        fragment.pixel = pixel;
+        fragment.depth = depth;
+        volatile i32 *head = (volatile i32*)(heads + offset);
+        i32 next;
+        do {
+            next = atomics::load(head);
+            fragment.next = (u32)next;
+        } while (!atomics::compareAndSwap(head, next, index));
+        return true;
+    }
+};
+
+struct Canvas {
+    Dimensions dimensions;
+    CanvasPixel *pixels{nullptr};
+    f32 *depths{nullptr};
+    u8 *dirty_tiles{nullptr};
+    u32 *tile_epochs{nullptr};
+
+    // Per tile, bounds on the depths of its pixels (kept by clear() and the drawing functions, not by writing into pixels directly):
+    // No pixel of a tile is nearer than its min depth, and while its max depth is finite all of its pixels are opaque and no farther.
+    // Pixels drawn with depth behind the max depth of their tile are hidden and get skipped,
+    // and opaque ones in front of the min depth replace what is there without a depth test:
+    f32 *tile_min_depths{nullptr};
+    f32 *tile_max_depths{nullptr};
+
+    AntiAliasing antialias;
+
+    // How many samples pixels have with MSAA (2, 4 or 8), taking effect on the next clear():
+    u8 msaa_sample_count{4};
+
+    // With MSAA, where (in pixels) the samples of each pixel are while they differ (0 while they are all the same),
+    // and how many samples of each tile's pool are in use (see CANVAS_MSAA_TILE_SAMPLES).
+    // Only set by clear() for canvases with memory of their own, without it pixels are drawn into by covered fractions instead:
+    u32 *sample_offsets{nullptr};
+    u32 *tile_sample_counts{nullptr};
+    bool has_sample_memory{false};
+
+    // When set on a NoAA canvas, fillTriangle(), fillCircle() and fillRect() of a float Rect blend the pixels along their edges
+    // by how much of each the shape covers (computed analytically from the distances of pixel centers to the edges):
+    bool smooth_edges{false};
+
+    // While set, drawing calls are recorded into the display list instead of drawn, for drawToWindow() to draw them
+    // tile by tile in parallel (each tile only getting the commands whose bounds overlap it, in the order they were recorded).
+    // Setting pixels, drawing images or other canvases still draws right away, so these are not to be mixed with recording.
+    DisplayList *display_list{nullptr};
+
+    // When set (taking effect on the next clear), translucent pixels drawn with depth are added to the fragment buffer instead,
+    // to be composited in depth order by drawToWindow() (or on drawFragments()) regardless of the order they were drawn in.
+    // Fragments behind the pixel already drawn are composited under it, as they would be when drawn right away.
+    // When the buffer is full (or too small for the canvas), pixels are drawn right away instead:
+    FragmentBuffer *fragments{nullptr};
+
+    // What drawToWindow() encodes the (linear) pixels into, through a lookup table unless it is the default gamma 2:
+    ColorSpace color_space{ColorSpaceGamma2};
+
+    // When set, nothing gets drawn outside of these bounds (in window pixels):
+    const RectI *clip_bounds{nullptr};
+
+    // What the canvas was last cleared to, with CANVAS_LAZY_CLEAR tiles behind the clear epoch read as these values:
+    CanvasPixel clear_pixel;
+    f32 clear_depth{INFINITY};
+    u32 clear_epoch{0};
+
+    // The anti-aliasing mode and color space the window content was last resolved with, changing either requires resolving it all over again:
+    AntiAliasing resolved_antialias{NoAA};
+    ColorSpace resolved_color_space{ColorSpaceGamma2};
+
+    Canvas(u16 width = MAX_WIDTH, u16 height = MAX_HEIGHT, AntiAliasing antialiasing = NoAA) : antialias{antialiasing} {
+        if (memory::canvas_memory_capacity) {
+            pixels = (CanvasPixel*)memory::canvas_memory;
+            memory::canvas_memory += CANVAS_PIXELS_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_PIXELS_SIZE;
+
+            depths = (f32*)memory::canvas_memory;
+            memory::canvas_memory += CANVAS_DEPTHS_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_DEPTHS_SIZE;
+
+            dirty_tiles = memory::canvas_memory;
+            memory::canvas_memory += CANVAS_DIRTY_TILES_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_DIRTY_TILES_SIZE;
+
+            tile_epochs = (u32*)memory::canvas_memory;
+            memory::canvas_memory += CANVAS_TILE_EPOCHS_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_TILE_EPOCHS_SIZE;
+
+            tile_min_depths = (f32*)memory::canvas_memory;
+            tile_max_depths = tile_min_depths + CANVAS_DIRTY_TILES_SIZE;
+            memory::canvas_memory += CANVAS_TILE_DEPTHS_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_TILE_DEPTHS_SIZE;
+
+            has_sample_memory = true;
+
+            dimensions.update(MAX_WIDTH, MAX_HEIGHT);
+            clear();
+            dimensions.update(width, height);
+        } else {
+            pixels = nullptr;
+            depths = nullptr;
+        }
+    }
+
+    Canvas(CanvasPixel *pixels, f32 *depths) noexcept : pixels{pixels}, depths{depths} {}
+
+    void clear(f32 red = 0, f32 green = 0, f32 blue = 0, f32 opacity = 1.0f, f32 depth = INFINITY) {
+        storePixel(clear_pixel, Pixel{red, green, blue, opacity});
+        clear_depth = depth;
+        if (display_list) // Whatever was recorded would have been cleared away:
+            display_list->reset();
+        if (fragments) { // As would any fragments, the lists get laid out anew for the canvas when it changed:
+            u32 sample_count = dimensions.stride * dimensions.height * (antialias == SSAA ? 4 : 1);
+            if (fragments->head_count != sample_count || fragments->count > 1)
+                fragments->reset(sample_count);
+        }
+
+        if (tile_min_depths) // Every pixel is now at the cleared depth, hiding what is behind it only when opaque:
+            for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++) {
+                tile_min_depths[i] = depth;
+                tile_max_depths[i] = opacity == 1.0f ? depth : INFINITY;
+            }
+
+        if (antialias == MSAA && has_sample_memory) {
+            msaa_sample_count = msaa_sample_count >= 8 ? 8 : (msaa_sample_count >= 4 ? 4 : 2);
+            sample_offsets = (u32*)(depths + MAX_WINDOW_SIZE);
+            tile_sample_counts = (u32*)(depths + MAX_WINDOW_SIZE * 2);
+            for (u32 i = 0; i < CANVAS_MAX_TILE_COLUMNS * CANVAS_MAX_TILE_ROWS; i++) tile_sample_counts[i] = 0;
+        } else {
+            sample_offsets = nullptr;
+            tile_sample_counts = nullptr;
+        }
+
+#ifdef CANVAS_LAZY_CLEAR
+        if (tile_epochs) { // Every tile is now stale, and gets cleared in memory only once drawn into:
+            clear_epoch++;
+            if (clear_epoch == CANVAS_TILE_EPOCH_CLEARING) clear_epoch = 0;
+            _markAllTilesDirty();
+            return;
+        }
+#endif
+
+        i32 pixels_width  = dimensions.width;
+        i32 pixels_height = dimensions.height;
+        i32 depths_width  = dimensions.width;
+        i32 depths_height = dimensions.height;
+
+        if (antialias == SSAA) {
+            depths_width *= 2;
+            depths_height *= 2;
+            pixels_width *= 2;
+            pixels_height *= 2;
+        }
+
+        u64 pixels_count = (u64)pixels_width * (u64)pixels_height;
+        u64 depths_count = (u64)depths_width * (u64)depths_height;
+
+        if (pixels) streamFill(pixels, pixels_count, clear_pixel);
+        if (depths) streamFill(depths, depths_count, depth);
+        if (sample_offsets) streamFill(sample_offsets, pixels_count, 0u);
+        _markAllTilesDirty();
+    }
+
+    INLINE u32 getTileColumnCount() const { return (dimensions.width  + CANVAS_TILE_SIZE - 1) >> CANVAS_TILE_SIZE_SHIFT; }
+    INLINE u32 getTileRowCount()    const { return (dimensions.height + CANVAS_TILE_SIZE - 1) >> CANVAS_TILE_SIZE_SHIFT; }
+
+    // Marks the tile containing the given position (in window pixels) as drawn into (with no depth, so in front of everything).
+    // A lazily cleared tile gets cleared in memory first, so for drawing into pixels directly mark them before writing:
+    INLINE void markDirty(i32 x, i32 y) const {
+        if (dirty_tiles)
+            _markTileDirty(_getTileIndex(x, y));
+    }
+
+    // Marks all tiles overlapping the given bounds (in window pixels), for drawing into pixels directly:
+    void markDirty(RectI bounds) const {
+        if (!dirty_tiles) return;
+        bounds -= RectI{0, dimensions.width - 1, 0, dimensions.height - 1};
+        if (!bounds) return;
+
+        u32 tile_column_count = getTileColumnCount();
+        for (i32 tile_y = bounds.top >> CANVAS_TILE_SIZE_SHIFT; tile_y <= (bounds.bottom >> CANVAS_TILE_SIZE_SHIFT); tile_y++)
+            for (i32 tile_x = bounds.left >> CANVAS_TILE_SIZE_SHIFT; tile_x <= (bounds.right >> CANVAS_TILE_SIZE_SHIFT); tile_x++)
+                _markTileDirty(tile_y * tile_column_count + tile_x);
+    }
+
+    void markDirty() const {
+        if (!dirty_tiles) return;
+        u32 tile_count = getTileColumnCount() * getTileRowCount();
+        for (u32 i = 0; i < tile_count; i++) _markTileDirty(i);
+    }
+
+    // Marks the tiles lying entirely within the given bounds (in window pixels) as covered by opaque pixels with no depth,
+    // hiding whatever gets drawn behind them with depth until the next clear. For shapes to call once they are drawn:
+    void markOpaque(RectI bounds) const {
+        if (!tile_max_depths) return;
+        bounds -= RectI{0, dimensions.width - 1, 0, dimensions.height - 1};
+        if (!bounds) return;
+
+        for (i32 tile_y = bounds.top >> CANVAS_TILE_SIZE_SHIFT; tile_y <= (bounds.bottom >> CANVAS_TILE_SIZE_SHIFT); tile_y++) {
+            i32 top = tile_y << CANVAS_TILE_SIZE_SHIFT;
+            i32 bottom = clampedValue(top + CANVAS_TILE_SIZE - 1, dimensions.height - 1);
+            if (top < bounds.top || bottom > bounds.bottom) continue;
+
+            for (i32 tile_x = bounds.left >> CANVAS_TILE_SIZE_SHIFT; tile_x <= (bounds.right >> CANVAS_TILE_SIZE_SHIFT); tile_x++) {
+                i32 left = tile_x << CANVAS_TILE_SIZE_SHIFT;
+                i32 right = clampedValue(left + CANVAS_TILE_SIZE - 1, dimensions.width - 1);
+                if (left >= bounds.left && right <= bounds.right)
+                    tile_max_depths[_getTileIndex(left, top)] = 0;
+            }
+        }
+    }
+
+    // Whether the tile containing the given position (in window pixels) holds the clear value without it being in memory:
+    INLINE bool isClearedLazily(i32 x, i32 y) const {
+#ifdef CANVAS_LAZY_CLEAR
+        return tile_epochs && tile_epochs[(y >> CANVAS_TILE_SIZE_SHIFT) * getTileColumnCount() + (x >> CANVAS_TILE_SIZE_SHIFT)] != clear_epoch;
+#else
+        (void)x;
+        (void)y;
+        return false;
+#endif
+    }
+
+    // Records a drawing call into the display list, given the bounds of what it would draw (in its own coordinates, before
+    // being offset into the viewport). Returns the command for the call to fill in its arguments, or nullptr when it draws nothing:
+    DrawCommand* record(ReplayDrawCommand replay, RectI bounds, const Color &color, f32 opacity,
+                        const RectI *viewport_bounds, u8 line_width = 0, u32 payload_size = 0) const {
+        if (viewport_bounds) {
+            bounds.x_range += viewport_bounds->left;
+            bounds.y_range += viewport_bounds->top;
+            bounds -= *viewport_bounds;
+        }
+        bounds -= RectI{0, dimensions.width - 1, 0, dimensions.height - 1};
+        if (!bounds)
+            return nullptr;
+
+        DrawCommand *command = display_list->allocate(payload_size);
+        if (!command) { // Full, draw what was recorded so far to make room:
+            drawDisplayList();
+            command = display_list->allocate(payload_size);
+            if (!command) return nullptr;
+        }
+
+        command->replay = replay;
+        command->line_width = line_width;
+        command->has_viewport_bounds = viewport_bounds != nullptr;
+        command->bounds = bounds;
+        if (viewport_bounds) command->viewport_bounds = *viewport_bounds;
+        command->color = color;
+        command->opacity = opacity;
+        return command;
+    }
+
+    // Composites the fragments into the canvas tile by tile in parallel, and empties the fragment buffer:
+    void drawFragments() const {
+        if (!fragments || fragments->count <= 1) return;
+
+        RectI bounds{0, dimensions.width - 1, 0, dimensions.height - 1};
+        parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) {
+            u32 tile_index = _getTileIndex(tile.left, tile.top);
+            if (fragments->tiles[tile_index]) _compositeFragments(tile, tile_index);
+        });
+        _releaseFragments();
+    }
+
+    // Draws the recorded commands into the canvas tile by tile in parallel, and empties the display list:
+    void drawDisplayList() const {
+        if (!display_list || !display_list->command_count) return;
+
+        RectI bounds{0, dimensions.width - 1, 0, dimensions.height - 1};
+        parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { _replayTile(tile); });
+        display_list->reset();
+    }
+
+    void drawFrom(Canvas& source_canvas, const RectI* source_bounds = nullptr, const RectI* target_bounds = nullptr, f32 opacity = 1.0f, bool blend = true, bool include_depths = false) {
+        RectI src{
+                0, source_canvas.dimensions.width,
+                0, source_canvas.dimensions.height
+        };
+        if (source_bounds)
+            src -= *source_bounds;
+
+        RectI trg{
+                0, dimensions.width,
+                0, dimensions.height
+        };
+        if (target_bounds)
+            trg = *target_bounds;
+
+        if ((antialias == SSAA) && (source_canvas.antialias == SSAA)) {
+            src *= 2;
+            trg *= 2;
+        }
+
+        switch (antialias) { // Specialized on both the target's and the source's anti-aliasing:
+            case NoAA: source_canvas.antialias == SSAA ? _drawFrom<NoAA, SSAA>(source_canvas, src, trg, opacity, blend, include_depths) : _drawFrom<NoAA, NoAA>(source_canvas, src, trg, opacity, blend, include_depths); break;
+            case MSAA: source_canvas.antialias == SSAA ? _drawFrom<MSAA, SSAA>(source_canvas, src, trg, opacity, blend, include_depths) : _drawFrom<MSAA, NoAA>(source_canvas, src, trg, opacity, blend, include_depths); break;
+            case SSAA: source_canvas.antialias == SSAA ? _drawFrom<SSAA, SSAA>(source_canvas, src, trg, opacity, blend, include_depths) : _drawFrom<SSAA, NoAA>(source_canvas, src, trg, opacity, blend, include_depths); break;
+        }
+    }
+
+    // Resolves the tiles drawn into since the last call into the window content, and lets the platform present only those.
+    // Everything is resolved and presented when the window was resized, when the anti-aliasing or color space changed,
+    // when pixels were written without marking them, or when anything else (like another canvas) wrote into the window content
+    // since this canvas last resolved into it:
+    void drawToWindow() {
+        if (!window::width || !window::height)
+            return;
+
+        const u32 width = window::width;
+        const u32 height = window::height;
+        bool resolve_all = !dirty_tiles ||
+                width != dimensions.width || height != dimensions.height ||
+                window::content_source != this || antialias != resolved_antialias || color_space != resolved_color_space ||
+                width != window::content_source_width || height != window::content_source_height;
+        window::content_source = this;
+        window::content_source_width = (u16)width;
+        window::content_source_height = (u16)height;
+        resolved_antialias = antialias;
+        resolved_color_space = color_space;
+
+        const bool pixel_quads = antialias == SSAA;
+        const ResolveKernel kernel = resolve::kernel;
+        const u8 *encode_table = color_space == ColorSpaceGamma2 ? nullptr : getColorEncodeTable(color_space);
+        const u32 tile_column_count = getTileColumnCount();
+#ifdef CANVAS_LAZY_CLEAR
+        // Lazily cleared tiles all resolve to the same content, without reading their pixels:
+        CanvasPixel clear_pixel_quad[4] = {clear_pixel, clear_pixel, clear_pixel, clear_pixel};
+        u32 clear_content;
+        _resolvePixels(clear_pixel_quad, &clear_content, 1, pixel_quads, kernel, encode_table);
+#endif
+        const bool replay = display_list && display_list->command_count;
+        auto resolveTile = [&](const RectI &tile) {
+            if (replay)
+                _replayTile(tile);
+
+            u32 tile_index = (tile.top >> CANVAS_TILE_SIZE_SHIFT) * tile_column_count + (tile.left >> CANVAS_TILE_SIZE_SHIFT);
+            if (fragments && fragments->tiles[tile_index])
+                _compositeFragments(tile, tile_index);
+            if (!resolve_all && !dirty_tiles[tile_index])
+                return;
+
+            u32 tile_width = (u32)(tile.right - tile.left + 1);
+#ifdef CANVAS_LAZY_CLEAR
+            if (tile_epochs && tile_epochs[tile_index] != clear_epoch) {
+                for (i32 y = tile.top; y <= tile.bottom; y++)
+                    streamFill(window::content + width * y + tile.left, tile_width, clear_content);
+                return;
+            }
+#endif
+            if (sample_offsets && tile_sample_counts[tile_index]) {
+                for (i32 y = tile.top; y <= tile.bottom; y++)
+                    _resolveMultiSampledPixels(width * y + tile.left, tile_width, kernel, encode_table);
+                return;
+            }
+            for (i32 y = tile.top; y <= tile.bottom; y++) {
+                u32 offset = width * y + tile.left;
+                _resolvePixels(pixels + (pixel_quads ? 4 : 1) * offset, window::content + offset, tile_width, pixel_quads, kernel, encode_table);
+            }
+        };
+
+        RectI bounds{0, (i32)width - 1, 0, (i32)height - 1};
+        if (resolve::multithreaded)
+            parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, resolveTile);
+        else
+            for (i32 y = 0; y < (i32)height; y += CANVAS_TILE_SIZE)
+                for (i32 x = 0; x < (i32)width; x += CANVAS_TILE_SIZE)
+                    resolveTile(RectI{x, clampedValue(x + CANVAS_TILE_SIZE, (i32)width) - 1, y, clampedValue(y + CANVAS_TILE_SIZE, (i32)height) - 1});
+
+        if (replay)
+            display_list->reset();
+        if (fragments)
+            _releaseFragments();
+
+        if (resolve_all)
+            window::present_partially = false;
+        else
+            _collectDirtyRects();
+
+        if (dirty_tiles)
+            for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++) dirty_tiles[i] = 0;
+    }
+
+    // Per-pixel drawing is specialized on the anti-aliasing mode (as in setPixel<SSAA>(...)) for branch-free inner loops.
+    // The non-template versions dispatch on the antialias field at runtime, once per call:
+    INLINE void setPixel(i32 x, i32 y, const Color &color, f32 opacity = 1.0f, f32 depth = 0) const {
+        switch (antialias) {
+            case NoAA: setPixel<NoAA>(x, y, color, opacity, depth); break;
+            case MSAA: setPixel<MSAA>(x, y, color, opacity, depth); break;
+            case SSAA: setPixel<SSAA>(x, y, color, opacity, depth); break;
+        }
+    }
+
+    template <AntiAliasing AA>
+    INLINE void setPixel(i32 x, i32 y, const Color &color, f32 opacity = 1.0f, f32 depth = 0) const {
+        typedef AntiAliasingLayout<AA> Layout;
+        if (x < 0 || y < 0 || x >= (dimensions.width << Layout::sample_shift) || y >= (dimensions.height << Layout::sample_shift))
+            return;
+
+        if (clip_bounds && !clip_bounds->contains(x >> Layout::sample_shift, y >> Layout::sample_shift))
+            return;
+
+        opacity = clampedValue(opacity);
+        Pixel pixel{toPixel(color, opacity)};
+
+        u32 offset = Layout::sampleOffset(dimensions.stride, x, y);
+        f32 *out_depth = depths ? (depths + offset) : nullptr;
+        if (dirty_tiles) {
+            u32 tile_index = _getTileIndex(x >> Layout::sample_shift, y >> Layout::sample_shift);
+            if (out_depth && depth != 0.0f && tile_min_depths) {
+                if (depth >= tile_max_depths[tile_index]) // Hidden behind the opaque pixels of the tile
+                    return;
+
+                if (opacity == 1.0f && depth < tile_min_depths[tile_index]) { // In front of everything in the tile
+                    _markTileDirty(tile_index, depth);
+                    storePixel(pixels[offset], pixel);
+                    *out_depth = depth;
+                    if (AA == MSAA && sample_offsets) sample_offsets[offset] = 0;
+                    return;
+                }
+
+                if (fragments && opacity < 1.0f && fragments->add(offset, pixel, depth)) { // Composited later on, in depth order
+                    dirty_tiles[tile_index] = 1;
+                    fragments->tiles[tile_index] = 1;
+                    return;
+                }
+            }
+            _markTileDirty(tile_index, depth);
+        }
+        if (AA == MSAA && sample_offsets && sample_offsets[offset]) {
+            if (opacity == 1.0f && depth == 0.0f) // Covering all of the samples, which are then all the same again:
+                sample_offsets[offset] = 0;
+            else {
+                // All samples are drawn into against the depth of the pixel:
+                CanvasPixel *samples = pixels + sample_offsets[offset];
+                f32 sample_depth = 0;
+                for (u32 i = 0; i < msaa_sample_count; i++) {
+                    if (out_depth) sample_depth = *out_depth;
+                    _setStoredPixel(samples[i], pixel, opacity, depth, out_depth ? &sample_depth : nullptr);
+                }
+                if (out_depth) *out_depth = sample_depth;
+                return;
+            }
+        }
+        _setStoredPixel(pixels[offset], pixel, opacity, depth, out_depth);
+    }
+
+    // Draws a flat color (with no depth) into a run of samples in a row, the same way setPixel() would for each of them.
+    // Coordinates are in samples (twice the window's with SSAA) and must lie within the canvas, which is not marked dirty here.
+    // The pixel is as setPixel() stores it (squared and premultiplied), see toPixel().
+    INLINE void fillSamples(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        switch (antialias) {
+            case NoAA: fillSamples<NoAA>(x, y, count, pixel); break;
+            case MSAA: fillSamples<MSAA>(x, y, count, pixel); break;
+            case SSAA: fillSamples<SSAA>(x, y, count, pixel); break;
+        }
+    }
+
+    template <AntiAliasing AA>
+    void fillSamples(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        if (AA != SSAA) {
+            fillPixels<AA>(x, y, count, pixel);
+            return;
+        }
+
+        // Samples of a row come in pairs, 4 samples apart:
+        u32 offset = AntiAliasingLayout<SSAA>::sampleOffset(dimensions.stride, x, y);
+        if (pixel.opacity == 1.0f) {
+            CanvasPixel stored_pixel;
+            storePixel(stored_pixel, pixel);
+            for (i32 i = 0; i < count; i++, x++, offset += (x & 1) ? 1 : 3) {
+                pixels[offset] = stored_pixel;
+                if (depths) depths[offset] = 0;
+            }
+        } else
+            for (i32 i = 0; i < count; i++, x++, offset += (x & 1) ? 1 : 3)
+                blendSpan(pixels + offset, depths ? depths + offset : nullptr, 1, pixel);
+    }
+
+    // Draws a flat color (with no depth) into a run of whole pixels in a row, the same way setPixel() would for each of their samples.
+    // Coordinates are in window pixels and must lie within the canvas, which is not marked dirty here.
+    // All samples of a run of pixels are contiguous in memory (with SSAA as well), so opaque runs are plain vector stores.
+    INLINE void fillPixels(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        switch (antialias) {
+            case NoAA: fillPixels<NoAA>(x, y, count, pixel); break;
+            case MSAA: fillPixels<MSAA>(x, y, count, pixel); break;
+            case SSAA: fillPixels<SSAA>(x, y, count, pixel); break;
+        }
+    }
+
+    template <AntiAliasing AA>
+    void fillPixels(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        typedef AntiAliasingLayout<AA> Layout;
+        u32 offset = (dimensions.stride * y + x) * Layout::samples_per_pixel;
+        u32 sample_count = (u32)count * Layout::samples_per_pixel;
+        CanvasPixel *sample_span = pixels + offset;
+        f32 *depth_span = depths ? depths + offset : nullptr;
+        if (pixel.opacity == 1.0f) {
+            CanvasPixel stored_pixel;
+            storePixel(stored_pixel, pixel);
+            spanFill(sample_span, sample_count, stored_pixel);
+            if (depth_span) spanFill(depth_span, sample_count, 0.0f);
+            if (AA == MSAA && sample_offsets) spanFill(sample_offsets + offset, sample_count, 0u);
+        } else {
+            blendSpan(sample_span, depth_span, sample_count, pixel);
+            if (AA == MSAA && sample_offsets)
+                for (u32 i = offset; i < offset + sample_count; i++)
+                    if (sample_offsets[i])
+                        blendSpan(pixels + sample_offsets[i], nullptr, msaa_sample_count, pixel);
+        }
+    }
+
+    // Draws a run of pixels (with no depth) into a row, the same way fillPixels() would for each of them, skipping transparent ones.
+    // The pixels come as separate arrays of their components, as setPixel() stores them (see toPixel()).
+    // Coordinates are in window pixels and must lie within the canvas, which is not marked dirty here:
+    template <AntiAliasing AA>
+    void drawPixels(i32 x, i32 y, u32 count, const f32 *reds, const f32 *greens, const f32 *blues, const f32 *opacities) const {
+        typedef AntiAliasingLayout<AA> Layout;
+        u32 offset = (dimensions.stride * y + x) * Layout::samples_per_pixel;
+        for (u32 i = 0; i < count; i++, offset += Layout::samples_per_pixel) {
+            Pixel pixel{reds[i], greens[i], blues[i], opacities[i]};
+            if (pixel.opacity == 1.0f) {
+                CanvasPixel stored_pixel;
+                storePixel(stored_pixel, pixel);
+                for (u32 s = 0; s < Layout::samples_per_pixel; s++) pixels[offset + s] = stored_pixel;
+                if (depths) for (u32 s = 0; s < Layout::samples_per_pixel; s++) depths[offset + s] = 0;
+                if (AA == MSAA && sample_offsets) sample_offsets[offset] = 0;
+            } else if (pixel.opacity > 0.0f) {
+                blendSpan(pixels + offset, depths ? depths + offset : nullptr, Layout::samples_per_pixel, pixel);
+                if (AA == MSAA && sample_offsets && sample_offsets[offset])
+                    blendSpan(pixels + sample_offsets[offset], nullptr, msaa_sample_count, pixel);
+            }
+        }
+    }
+
+    // Draws a flat color (with no depth) into the samples of a pixel that are in the given coverage mask (with MSAA only).
+    // Coordinates are in window pixels and must lie within the canvas, which is not marked dirty here.
+    // Pixels get their samples stored separately once these differ, and are stored once again when these end up all the same.
+    // When the pool of samples of the tile is used up, the pixel is drawn into as a whole by the covered fraction instead:
+    void coverSamples(i32 x, i32 y, u32 mask, const Pixel &pixel) const {
+        const u32 sample_count = msaa_sample_count;
+        const u32 all_samples = (1u << sample_count) - 1;
+        if ((mask & all_samples) == all_samples) {
+            fillPixels<MSAA>(x, y, 1, pixel);
+            return;
+        }
+        if (!mask)
+            return;
+
+        u32 offset = dimensions.stride * y + x;
+        u32 samples_offset = sample_offsets ? sample_offsets[offset] : 0;
+        if (!samples_offset) {
+            samples_offset = _allocateSamples(x, y);
+            if (!samples_offset) {
+                u32 covered_count = 0;
+                for (u32 i = 0; i < sample_count; i++) covered_count += (mask >> i) & 1;
+                fillPixels<MSAA>(x, y, 1, pixel * ((f32)covered_count / (f32)sample_count));
+                return;
+            }
+            for (u32 i = 0; i < sample_count; i++) pixels[samples_offset + i] = pixels[offset];
+            sample_offsets[offset] = samples_offset;
+        }
+        if (depths) depths[offset] = 0;
+
+        CanvasPixel *samples = pixels + samples_offset;
+        if (pixel.opacity != 1.0f) {
+            for (u32 i = 0; i < sample_count; i++)
+                if ((mask >> i) & 1)
+                    blendSpan(samples + i, nullptr, 1, pixel);
+            return;
+        }
+
+        // Only opaque pixels can make the samples all the same again (by covering the ones that differ):
+        CanvasPixel stored_pixel;
+        storePixel(stored_pixel, pixel);
+        for (u32 i = 0; i < sample_count; i++)
+            if ((mask >> i) & 1)
+                samples[i] = stored_pixel;
+        for (u32 i = 0; i < sample_count; i++)
+            if (!isSameStoredPixel(samples[i], stored_pixel))
+                return;
+
+        pixels[offset] = stored_pixel;
+        sample_offsets[offset] = 0;
+    }
+
+    // Converts a color into a pixel as setPixel() stores it, squared (approximating linear color) and premultiplied:
+    static INLINE Pixel toPixel(const Color &color, f32 opacity) {
+        opacity = clampedValue(opacity);
+        Pixel pixel{color.clamped(), opacity};
+        pixel.color *= pixel.color;
+        if (opacity != 1.0f)
+            pixel.color *= pixel.opacity;
+        return pixel;
+    }
+
+    INLINE u32 getPixelContent(Pixel *pixel) const {
+        return antialias == SSAA ? getPixelContent<SSAA>(pixel) : getPixelContent<NoAA>(pixel);
+    }
+
+    template <AntiAliasing AA>
+    INLINE u32 getPixelContent(Pixel *pixel) const {
+        if (color_space != ColorSpaceGamma2) {
+            u32 content;
+            encodePixels(pixel, &content, 1, getColorEncodeTable(color_space), AA == SSAA, ResolveScalar);
+            return content;
+        }
+        return AA == SSAA ? _isTransparentPixelQuad(pixel) ? 0 : _blendPixelQuad(pixel).asContent() :
+               pixel->opacity == 0.0f ? 0 : pixel->asContent();
+    }
+
+    INLINE void drawText(char *str, i32 x, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+#ifdef SLIM_VEC2
+    INLINE void drawText(char *str, vec2i position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawText(char *str, vec2 position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+#endif
+
+    INLINE void drawNumber(i32 number, i32 x, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+#ifdef SLIM_VEC2
+    INLINE void drawNumber(i32 number, vec2i position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawNumber(i32 number, vec2 position, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+#endif
+
+    INLINE void drawHLine(RangeI x_range, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawHLine(i32 x_start, i32 x_end, i32 y, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawVLine(RangeI y_range, i32 x, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawVLine(i32 y_start, i32 y_end, i32 x, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawLine(f32 x1, f32 y1, f32 x2, f32 y2, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
+
+#ifdef SLIM_VEC2
+    INLINE void drawLine(vec2 from, vec2 to, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawLine(vec2i from, vec2i to, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
+#endif
+
+    INLINE void drawRect(RectI rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawRect(Rect rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillRect(RectI rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillRect(Rect rect, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+
+    INLINE void drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+
+#ifdef SLIM_VEC2
+    INLINE void drawTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors = nullptr, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+#endif
+
+    INLINE void fillCircle(i32 center_x, i32 center_y, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawCircle(i32 center_x, i32 center_y, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+#ifdef SLIM_VEC2
+    INLINE void drawCircle(vec2i center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillCircle(vec2i center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void drawCircle(vec2 center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillCircle(vec2 center, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+#endif
+
+private:
+    // Replays the recorded commands overlapping a tile (in window pixels) into a copy of the canvas that is clipped to it:
+    void _replayTile(const RectI &tile) const {
+        Canvas tile_canvas{*this};
+        tile_canvas.display_list = nullptr;
+        tile_canvas.clip_bounds = &tile;
+
+        for (u8 *at = display_list->commands; at < display_list->end(); at += ((DrawCommand*)at)->size) {
+            const DrawCommand &command = *(DrawCommand*)at;
+            if (command.bounds.left <= tile.right && tile.left <= command.bounds.right &&
+                command.bounds.top <= tile.bottom && tile.top <= command.bounds.bottom)
+                command.replay(command, tile_canvas);
+        }
+    }
+
+    // Draws a pixel into a stored one, behind or in front of it by depth (a depth of 0 being in front of everything).
+    // Background (black with no depth in front) gets replaced, as does anything by an opaque pixel with no depth:
+    static INLINE void _setStoredPixel(CanvasPixel &stored_pixel, Pixel pixel, f32 opacity, f32 depth, f32 *out_depth) {
+        Pixel current_pixel{loadPixel(stored_pixel)};
+        if (
+                (
+                        (out_depth == nullptr ||
+                         *out_depth == INFINITY) &&
+                        (current_pixel.color.r == 0) &&
+                        (current_pixel.color.g == 0) &&
+                        (current_pixel.color.b == 0)
+                ) ||
+                (
+                        (opacity == 1.0f) &&
+                        (depth == 0.0f)
+                )
+                ) {
+            storePixel(stored_pixel, pixel);
+            if (out_depth) *out_depth = depth;
+            return;
+        }
+
+        Pixel *bg{&current_pixel}, *fg{&pixel};
+        if (out_depth)
+            _sortPixelsByDepth(depth, &pixel, out_depth, &current_pixel, &bg, &fg);
+        storePixel(stored_pixel, fg->opacity == 1 ? *fg : fg->alphaBlendOver(*bg));
+    }
+
+    // Composites the fragments of a tile into its samples, emptying their lists:
+    void _compositeFragments(const RectI &tile, u32 tile_index) const {
+        FragmentBuffer &buffer = *fragments;
+        buffer.tiles[tile_index] = 0;
+        _markTileDirty(tile_index, INFINITY); // Clearing a lazily cleared tile in memory first
+
+        const u32 samples_per_pixel = antialias == SSAA ? 4 : 1;
+        f32 nearest_depth = INFINITY;
+        for (i32 y = tile.top; y <= tile.bottom; y++) {
+            u32 offset = (dimensions.stride * y + tile.left) * samples_per_pixel;
+            u32 end = offset + (u32)(tile.right - tile.left + 1) * samples_per_pixel;
+            for (; offset < end; offset++) {
+                u32 head = buffer.heads[offset];
+                if (!head) continue;
+
+                buffer.heads[offset] = 0;
+                u32 samples_offset = sample_offsets ? sample_offsets[offset] : 0;
+                f32 depth = _compositeFragmentList(buffer.fragments, head,
+                                                   pixels + (samples_offset ? samples_offset : offset),
+                                                   samples_offset ? msaa_sample_count : 1,
+                                                   depths ? depths + offset : nullptr);
+                if (depth < nearest_depth) nearest_depth = depth;
+            }
+        }
+        if (tile_min_depths && nearest_depth < tile_min_depths[tile_index])
+            tile_min_depths[tile_index] = nearest_depth;
+    }
+
+    // Composites a list of fragments into the samples of a stored pixel (all against its depth), returning its new depth.
+    // The nearest fragments are sorted from near to far, the ones added later being nearer among equal depths.
+    // Going from far to near, those behind the stored pixel are composited under it and the rest over it:
+    static f32 _compositeFragmentList(const Fragment *all_fragments, u32 head, CanvasPixel *samples, u32 sample_count, f32 *depth) {
+        const Fragment *sorted[FRAGMENTS_PER_SAMPLE];
+        u32 count = 0;
+        for (u32 i = head; i; i = all_fragments[i].next) {
+            const Fragment *fragment = all_fragments + i;
+            u32 at = count;
+            while (at && sorted[at - 1]->depth > fragment->depth) at--;
+            if (at == FRAGMENTS_PER_SAMPLE) continue;
+
+            if (count < FRAGMENTS_PER_SAMPLE) count++;
+            for (u32 j = count - 1; j > at; j--) sorted[j] = sorted[j - 1];
+            sorted[at] = fragment;
+        }
+
+        f32 stored_depth = depth ? *depth : INFINITY;
+        for (u32 s = 0; s < sample_count; s++) {
+            Pixel stored_pixel{loadPixel(samples[s])};
+            bool is_background = stored_depth == INFINITY &&
+                                 stored_pixel.color.r == 0 &&
+                                 stored_pixel.color.g == 0 &&
+                                 stored_pixel.color.b == 0;
+            Pixel pixel;
+            i32 i = (i32)count - 1;
+            for (; i >= 0 && sorted[i]->depth >= stored_depth; i--) pixel = sorted[i]->pixel.alphaBlendOver(pixel);
+            if (!is_background) pixel = stored_pixel.alphaBlendOver(pixel);
+            for (; i >= 0; i--) pixel = sorted[i]->pixel.alphaBlendOver(pixel);
+            storePixel(samples[s], pixel);
+        }
+
+        if (count && sorted[0]->depth < stored_depth) stored_depth = sorted[0]->depth;
+        if (depth) *depth = stored_depth;
+        return stored_depth;
+    }
+
+    // Empties the fragment buffer once no tile has any fragments left (tiles outside of the window might):
+    void _releaseFragments() const {
+        for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++)
+            if (fragments->tiles[i]) return;
+        fragments->count = 1;
+    }
+
+    // Takes the samples for a pixel from the pool of its tile, returning where they are (0 when the pool is used up):
+    INLINE u32 _allocateSamples(i32 x, i32 y) const {
+        if (!sample_offsets) return 0;
+
+        u32 tile_index = (y >> CANVAS_TILE_SIZE_SHIFT) * getTileColumnCount() + (x >> CANVAS_TILE_SIZE_SHIFT);
+        u32 &used_count = tile_sample_counts[tile_index];
+        if (used_count + msaa_sample_count > CANVAS_MSAA_TILE_SAMPLES)
+            return 0;
+
+        u32 samples_offset = MAX_WINDOW_SIZE + tile_index * CANVAS_MSAA_TILE_SAMPLES + used_count;
+        used_count += msaa_sample_count;
+        return samples_offset;
+    }
+
+    // Resolves a run of pixels of which some have their samples stored separately, averaging those first:
+    template <typename T>
+    static void _resolvePixels(const T *pixels, u32 *content, u32 count, bool pixel_quads, ResolveKernel kernel, const u8 *encode_table) {
+        if (encode_table) encodePixels(pixels, content, count, encode_table, pixel_quads, kernel);
+        else              resolvePixels(pixels, content, count, pixel_quads, kernel);
+    }
+
+    void _resolveMultiSampledPixels(u32 offset, u32 count, ResolveKernel kernel, const u8 *encode_table) const {
+        Pixel resolved_pixels[CANVAS_TILE_SIZE];
+        for (u32 i = 0; i < count; i++) {
+            u32 samples_offset = sample_offsets[offset + i];
+            resolved_pixels[i] = samples_offset ?
+                    averageSamples(pixels + samples_offset, msaa_sample_count) :
+                    loadPixel(pixels[offset + i]);
+        }
+        _resolvePixels(resolved_pixels, window::content + offset, count, false, kernel, encode_table);
+    }
+
+    INLINE u32 _getTileIndex(i32 x, i32 y) const {
+        return (y >> CANVAS_TILE_SIZE_SHIFT) * getTileColumnCount() + (x >> CANVAS_TILE_SIZE_SHIFT);
+    }
+
+    // Also brings the min depth of the tile to the depth drawn at:
+    INLINE void _markTileDirty(u32 tile_index, f32 depth = 0) const {
+        dirty_tiles[tile_index] = 1;
+        if (tile_min_depths && depth < tile_min_depths[tile_index])
+            tile_min_depths[tile_index] = depth;
+#ifdef CANVAS_LAZY_CLEAR
+        if (tile_epochs[tile_index] != clear_epoch)
+            _claimTile(tile_index);
+#endif
+    }
+
+    // Clears a tile from an earlier clear epoch exactly once when drawn into from several threads at once:
+    // The first thread swaps its epoch for CANVAS_TILE_EPOCH_CLEARING and clears it, the others wait for the clear epoch.
+    void _claimTile(u32 tile_index) const {
+        volatile i32 *epoch = (volatile i32*)(tile_epochs + tile_index);
+        i32 tile_epoch;
+        while ((tile_epoch = atomics::load(epoch)) != (i32)clear_epoch) {
+            if (tile_epoch != (i32)CANVAS_TILE_EPOCH_CLEARING &&
+                atomics::compareAndSwap(epoch, tile_epoch, (i32)CANVAS_TILE_EPOCH_CLEARING)) {
+                _clearTile(tile_index);
+                atomics::store(epoch, (i32)clear_epoch);
+                return;
+            }
+            atomics::pause();
+        }
+    }
+
+    // Marks every tile without clearing lazily cleared ones in memory:
+    void _markAllTilesDirty() const {
+        if (!dirty_tiles) return;
+        u32 tile_count = getTileColumnCount() * getTileRowCount();
+        for (u32 i = 0; i < tile_count; i++) dirty_tiles[i] = 1;
+    }
+
+    // Writes the clear value into the pixels and depths of a tile from an earlier clear epoch, right before it gets drawn into:
+    void _clearTile(u32 tile_index) const {
+        const u32 tile_column_count = getTileColumnCount();
+        const i32 left = (i32)(tile_index % tile_column_count) << CANVAS_TILE_SIZE_SHIFT;
+        const i32 top  = (i32)(tile_index / tile_column_count) << CANVAS_TILE_SIZE_SHIFT;
+        const i32 right  = clampedValue(left + CANVAS_TILE_SIZE, (i32)dimensions.width);
+        const i32 bottom = clampedValue(top  + CANVAS_TILE_SIZE, (i32)dimensions.height);
+        const u32 samples_per_pixel = antialias == SSAA ? 4 : 1;
+        const u32 tile_width = (u32)(right - left);
+
+        for (i32 y = top; y < bottom; y++) {
+            u32 offset = dimensions.stride * y + left;
+            CanvasPixel *pixel = pixels + offset * samples_per_pixel;
+            for (u32 i = 0; i < tile_width * samples_per_pixel; i++) pixel[i] = clear_pixel;
+            if (depths) {
+                f32 *depth = depths + offset * samples_per_pixel;
+                for (u32 i = 0; i < tile_width * samples_per_pixel; i++) depth[i] = clear_depth;
+            }
+            if (sample_offsets)
+                for (u32 i = 0; i < tile_width; i++) sample_offsets[offset + i] = 0;
+        }
+    }
+
+    // Gathers runs of dirty tiles into the window's dirty rectangles, merging runs spanning the same columns vertically:
+    void _collectDirtyRects() const {
+        const i32 tile_column_count = (i32)getTileColumnCount();
+        const i32 tile_row_count = (i32)getTileRowCount();
+        const i32 right_most = (i32)window::width - 1;
+        const i32 bottom_most = (i32)window::height - 1;
+
+        window::present_partially = true;
+        window::dirty_rect_count = 0;
+        for (i32 tile_y = 0; tile_y < tile_row_count; tile_y++) {
+            u8 *row = dirty_tiles + tile_y * tile_column_count;
+            for (i32 tile_x = 0; tile_x < tile_column_count; tile_x++) {
+                if (!row[tile_x]) continue;
+
+                i32 first_tile_x = tile_x;
+                while (tile_x + 1 < tile_column_count && row[tile_x + 1]) tile_x++;
+
+                RectI rect{
+                    first_tile_x << CANVAS_TILE_SIZE_SHIFT, clampedValue((tile_x + 1) << CANVAS_TILE_SIZE_SHIFT, right_most + 1) - 1,
+                    tile_y << CANVAS_TILE_SIZE_SHIFT, clampedValue((tile_y + 1) << CANVAS_TILE_SIZE_SHIFT, bottom_most + 1) - 1
+                };
+
+                bool merged = false;
+                for (u32 i = 0; i < window::dirty_rect_count; i++) {
+                    RectI &above = window::dirty_rects[i];
+                    if (above.left == rect.left && above.right == rect.right && above.bottom + 1 == rect.top) {
+                        above.bottom = rect.bottom;
+                        merged = true;
+                        break;
+                    }
+                }
+                if (merged) continue;
+
+                if (window::dirty_rect_count == WINDOW_MAX_DIRTY_RECT_COUNT) { // Too fragmented, present it all:
+                    window::present_partially = false;
+                    return;
+                }
+                window::dirty_rects[window::dirty_rect_count++] = rect;
+            }
+        }
+    }
+
+    // The source's mode only matters for where its samples are, which is either as with SSAA or as without it:
+    template <AntiAliasing AA, AntiAliasing SOURCE_AA>
+    void _drawFrom(Canvas &source_canvas, RectI src, RectI trg, f32 opacity, bool blend, bool include_depths) {
+        f32 depth = 0;
+
+        i32 src_y = src.top;
+        for (i32 y = trg.top; y < trg.bottom; y++, src_y++) {
+            if (y < 0 || y >= dimensions.height)
+                continue;
+
+            i32 src_x = src.left;
+
+            for (i32 x = trg.left; x < trg.right; x++, src_x++) {
+                if (x < 0 || x >= dimensions.width)
+                    continue;
+
+                i32 src_offset = (i32)AntiAliasingLayout<SOURCE_AA>::sampleOffset(source_canvas.dimensions.stride, src_x, src_y);
+                bool src_cleared = source_canvas.isClearedLazily(src_x >> AntiAliasingLayout<SOURCE_AA>::sample_shift,
+                                                                 src_y >> AntiAliasingLayout<SOURCE_AA>::sample_shift);
+                CanvasPixel src_pixel{src_cleared ? source_canvas.clear_pixel : source_canvas.pixels[src_offset]};
+                if (!src_cleared && source_canvas.sample_offsets && source_canvas.sample_offsets[src_offset])
+                    storePixel(src_pixel, averageSamples(source_canvas.pixels + source_canvas.sample_offsets[src_offset], source_canvas.msaa_sample_count));
+                Pixel pixel{loadPixel(src_pixel)};
+                if ((pixel.opacity == 0.0f) || (
+                        (pixel.color.r == 0.0f) &&
+                        (pixel.color.g == 0.0f) &&
+                        (pixel.color.b == 0.0f)))
+                    continue;
+
+                if (include_depths)
+                    depth = src_cleared ? source_canvas.clear_depth : source_canvas.depths[src_offset];
+
+                if (blend) {
+                    setPixel<AA>(x, y, pixel.color / pixel.opacity, pixel.opacity * opacity, include_depths ? depth : 0.0f);
+                }
+                else {
+                    i32 trg_offset = (i32)AntiAliasingLayout<AA>::sampleOffset(dimensions.stride, x, y);
+                    u32 tile_index = _getTileIndex(x >> AntiAliasingLayout<AA>::sample_shift, y >> AntiAliasingLayout<AA>::sample_shift);
+                    if (dirty_tiles) _markTileDirty(tile_index);
+                    if (tile_max_depths) tile_max_depths[tile_index] = INFINITY; // Pixels get replaced, even by translucent ones
+                    pixels[trg_offset] = src_pixel;
+                    if (AA == MSAA && sample_offsets) sample_offsets[trg_offset] = 0;
+                    if (include_depths && depth < depths[trg_offset])
+                        depths[trg_offset] = depth;
+                }
+            }
+        }
+    }
+
+    static INLINE bool _isTransparentPixelQuad(Pixel *pixel_quad) {
+        return (
+                (pixel_quad[0].opacity == 0.0f) &&
+                (pixel_quad[1].opacity == 0.0f) &&
+                (pixel_quad[2].opacity == 0.0f) &&
+                (pixel_quad[3].opacity == 0.0f)
+        );
+    }
+
+    INLINE Pixel _blendPixelQuad(Pixel *pixel_quad) const {
+        return (pixel_quad[0] + pixel_quad[1] + pixel_quad[2] + pixel_quad[3]) * 0.25f;
+    }
+
+    static INLINE void _sortPixelsByDepth(f32 depth, Pixel *pixel, f32 *out_depth, Pixel *out_pixel, Pixel **background, Pixel **foreground) {
+        if (depth == 0.0f || depth < *out_depth) {
+            *out_depth = depth;
+            *background = out_pixel;
+            *foreground = pixel;
+        } else {
+            *background = pixel;
+            *foreground = out_pixel;
+        }
+    }
+};
+
+
+void _replayHLine(const DrawCommand &command, const Canvas &canvas);
+void _replayVLine(const DrawCommand &command, const Canvas &canvas);
+void _replayLine(const DrawCommand &command, const Canvas &canvas);
+
+void _drawHLine(RangeI x_range, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        DrawCommand *command = canvas.record(_replayHLine, RectI{x_range.first, x_range.last, y, y}, color, opacity, viewport_bounds);
+        if (command) {
+            command->integers[0] = x_range.first;
+            command->integers[1] = x_range.last;
+            command->integers[2] = y;
+        }
+        return;
+    }
+
+    RangeI y_range{0, canvas.dimensions.height - 1};
+
+    if (viewport_bounds) {
+        y += viewport_bounds->top;
+        y_range -= viewport_bounds->y_range;
+
+        x_range += viewport_bounds->left;
+        x_range -= viewport_bounds->x_range;
+    }
+    x_range.sub(0, canvas.dimensions.width - 1);
+    if (canvas.clip_bounds) {
+        x_range -= canvas.clip_bounds->x_range;
+        y_range -= canvas.clip_bounds->y_range;
+    }
+    if (!x_range || !y_range[y])
+        return;
+
+    canvas.markDirty(RectI{x_range.first, x_range.last, y, y});
+    canvas.fillPixels(x_range.first, y, x_range.last - x_range.first + 1, Canvas::toPixel(color, opacity));
+}
+
+void _drawVLine(RangeI y_range, i32 x, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        DrawCommand *command = canvas.record(_replayVLine, RectI{x, x, y_range.first, y_range.last}, color, opacity, viewport_bounds);
+        if (command) {
+            command->integers[0] = y_range.first;
+            command->integers[1] = y_range.last;
+            command->integers[2] = x;
+        }
+        return;
+    }
+
+    RangeI x_range{0, canvas.dimensions.width - 1};
+
+    if (viewport_bounds) {
+        x += viewport_bounds->left;
+        x_range -= viewport_bounds->x_range;
+
+        y_range += viewport_bounds->top;
+        y_range -= viewport_bounds->y_range;
+    }
+    y_range.sub(0, canvas.dimensions.height - 1);
+    if (canvas.clip_bounds) {
+        x_range -= canvas.clip_bounds->x_range;
+        y_range -= canvas.clip_bounds->y_range;
+    }
+    if (!y_range || !x_range[x])
+        return;
+
+    canvas.markDirty(RectI{x, x, y_range.first, y_range.last});
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    for (i32 y = y_range.first; y <= y_range.last; y++)
+        canvas.fillPixels(x, y, 1, pixel);
+}
+
+// Draws the (clipped) line with the Xiaolin Wu algorithm, specialized on the anti-aliasing mode:
+template <AntiAliasing AA>
+void _rasterizeLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, RangeI x_range, RangeI y_range, const Canvas &canvas,
+                    const Color &color, f32 opacity, u8 line_width) {
+    i32 x, y;
+    if (AA == SSAA) {
+        x1 += x1;
+        x2 += x2;
+        y1 += y1;
+        y2 += y2;
+        x_range.first <<= 1;
+        y_range.first <<= 1;
+        x_range.last <<= 1;
+        y_range.last <<= 1;
+        line_width <<= 1;
+        line_width++;
+    }
+    f32 tmp, z_range, range_remap;
+    f32 dx = x2 - x1;
+    f32 dy = y2 - y1;
+    f32 gap, grad, first_offset, last_offset;
+    f32 z, z_curr, z_step;
+    f32 first_x, last_x;
+    f32 first_y, last_y;
+    i32 start_x, end_x;
+    i32 start_y, end_y;
+    bool has_depth = (canvas.depths != nullptr) && ((z1 != 0.0f) || (z2 != 0.0f));
+    if (fabsf(dx) > fabsf(dy)) { // Shallow:
+        if (x2 < x1) { // Left to right:
+            tmp = x2; x2 = x1; x1 = tmp;
+            tmp = y2; y2 = y1; y1 = tmp;
+            tmp = z2; z2 = z1; z1 = tmp;
+        }
+
+        grad = dy / dx;
+
+        first_x = roundf(x1);
+        last_x  = roundf(x2);
+        first_offset = first_x - x1;
+        last_offset  = last_x  - x2;
+
+        first_y = y1 + grad * first_offset;
+        last_y  = y2 + grad * last_offset;
+
+        start_x = (i32)first_x;
+        start_y = (i32)first_y;
+        end_x   = (i32)last_x;
+        end_y   = (i32)last_y;
+
+        x = start_x;
+        y = start_y;
+        gap = oneMinusFractionOf(x1 + 0.5f);
+
+        if (x_range[x]) {
+            if (y_range[y]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(first_y) * gap * opacity, z1);
+            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel<AA>(x, y, color, opacity, z1);
+            if (y_range[++y]) canvas.setPixel<AA>(x, y, color, fractionOf(first_y) * gap * opacity, z1);
+        }
+
+        x = end_x;
+        y = end_y;
+        gap = fractionOf(x2 + 0.5f);
+
+        if (x_range[x]) {
+            if (y_range[y]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(last_y) * gap * opacity, z2);
+            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel<AA>(x, y, color, opacity, z2);
+            if (y_range[++y]) canvas.setPixel<AA>(x, y, color, fractionOf(last_y) * gap * opacity, z2);
+        }
+
+        if (has_depth) { // Compute one-over-depth start and step
+            z1 = 1.0f / z1;
+            z2 = 1.0f / z2;
+            z_range = z2 - z1;
+            range_remap = z_range / (x2 - x1);
+            z1 += range_remap * (first_offset + 1.0f);
+            z2 += range_remap * (last_offset  - 1.0f);
+            z_curr = z1;
+            z_range = z2 - z1;
+            z_step = z_range / (last_x - first_x - 1.0f);
+        } else z = 0.0f;
+
+        gap = first_y + grad;
+        for (x = start_x + 1; x < end_x; x++) {
+            if (x_range[x]) {
+                y = (i32) gap;
+
+                if (has_depth) z = 1.0f / z_curr;
+                if (y_range[y]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(gap) * opacity, z);
+                for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel<AA>(x, y, color, opacity, z);
+                if (y_range[++y]) canvas.setPixel<AA>(x, y, color, fractionOf(gap) * opacity, z);
+            }
+
+            gap += grad;
+            if (has_depth) z_curr += z_step;
+        }
+    } else { // Steep:
+        if (y2 < y1) { // Bottom up:
+            tmp = x2; x2 = x1; x1 = (f32)tmp;
+            tmp = y2; y2 = y1; y1 = (f32)tmp;
+            tmp = z2; z2 = z1; z1 = tmp;
+        }
+
+        grad = dx / dy;
+
+        first_y = roundf(y1);
+        last_y  = roundf(y2);
+
+        first_offset = y1 - first_y;
+        last_offset  = last_y  - y2;
+
+        first_x = x1 + grad * first_offset;
+        last_x  = x2 + grad * last_offset;
+
+        start_y = (i32)first_y;
+        start_x = (i32)first_x;
+
+        end_y = (i32)last_y;
+        end_x = (i32)last_x;
+
+        x = start_x;
+        y = start_y;
+        gap = oneMinusFractionOf(y1 + 0.5f);
+
+        if (y_range[y]) {
+            if (x_range[x]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(first_x) * gap * opacity, z1);
+            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel<AA>(x, y, color, opacity, z1);
+            if (x_range[++x]) canvas.setPixel<AA>(x, y, color, fractionOf(first_x) * gap * opacity, z1);
+        }
+
+        x = end_x;
+        y = end_y;
+        gap = fractionOf(y2 + 0.5f);
+
+        if (y_range[y]) {
+            if (x_range[x]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(last_x) * gap * opacity, z2);
+            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel<AA>(x, y, color, opacity, z2);
+            if (x_range[++x]) canvas.setPixel<AA>(x, y, color, fractionOf(last_x) * gap * opacity, z2);
+        }
+
+        if (has_depth) { // Compute one-over-depth start and step
+            z1 = 1.0f / z1;
+            z2 = 1.0f / z2;
+            z_range = z2 - z1;
+            range_remap = z_range / (y2 - y1);
+            z1 += range_remap * (first_offset + 1.0f);
+            z2 += range_remap * (last_offset  - 1.0f);
+            z_range = z2 - z1;
+            z_step = z_range / (last_y - first_y - 1.0f);
+            z_curr = z1;
+        } else z = 0.0f;
+
+        gap = first_x + grad;
+        for (y = start_y + 1; y < end_y; y++) {
+            if (y_range[y]) {
+                if (has_depth) z = 1.0f / z_curr;
+                x = (i32)gap;
+
+                if (x_range[x]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(gap) * opacity, z);
+                for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel<AA>(x, y, color, opacity, z);
+                if (x_range[++x]) canvas.setPixel<AA>(x, y, color, fractionOf(gap) * opacity, z);
+            }
+
+            gap += grad;
+            if (has_depth) z_curr += z_step;
+        }
+    }
+}
+
+void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &canvas,
+               const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) {
+    Range float_x_range{x1 <= x2 ? x1 : x2, x1 <= x2 ? x2 : x1};
+    Range float_y_range{y1 <= y2 ? y1 : y2, y1 <= y2 ? y2 : y1};
+    if (canvas.display_list) { // Wide lines extend to one side, and the anti-aliased edges a pixel beyond:
+        RectI bounds{
+            (i32)floorf(float_x_range.first) - line_width - 2, (i32)ceilf(float_x_range.last) + line_width + 2,
+            (i32)floorf(float_y_range.first) - line_width - 2, (i32)ceilf(float_y_range.last) + line_width + 2
+        };
+        DrawCommand *command = canvas.record(_replayLine, bounds, color, opacity, viewport_bounds, line_width);
+        if (command) {
+            command->values[0] = x1;
+            command->values[1] = y1;
+            command->values[2] = z1;
+            command->values[3] = x2;
+            command->values[4] = y2;
+            command->values[5] = z2;
+        }
+        return;
+    }
+    if (viewport_bounds) {
+        const f32 left = (f32)viewport_bounds->left;
+        const f32 right = (f32)viewport_bounds->right;
+        const f32 top = (f32)viewport_bounds->top;
+        const f32 bottom = (f32)viewport_bounds->bottom;
+        x1 += left;
+        x2 += left;
+        y1 += top;
+        y2 += top;
+        float_x_range += left;
+        float_y_range += top;
+        float_x_range.sub(left, right);
+        float_y_range.sub(top, bottom);
+    }
+    float_x_range.sub(0, canvas.dimensions.f_width - 1.0f);
+    float_y_range.sub(0, canvas.dimensions.f_height - 1.0f);
+    if (!float_x_range || !float_y_range)
+        return;
+
+    RangeI x_range{(i32)float_x_range.first, (i32)(ceilf(float_x_range.last))};
+    RangeI y_range{(i32)float_y_range.first, (i32)(ceilf(float_y_range.last))};
+    if (x_range.last == (i32)canvas.dimensions.width) x_range.last--;
+    if (y_range.last == (i32)canvas.dimensions.height) y_range.last--;
+
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeLine<NoAA>(x1, y1, z1, x2, y2, z2, x_range, y_range, canvas, color, opacity, line_width); break;
+        case MSAA: _rasterizeLine<MSAA>(x1, y1, z1, x2, y2, z2, x_range, y_range, canvas, color, opacity, line_width); break;
+        case SSAA: _rasterizeLine<SSAA>(x1, y1, z1, x2, y2, z2, x_range, y_range, canvas, color, opacity, line_width); break;
+    }
+}
+
+void _replayHLine(const DrawCommand &command, const Canvas &canvas) {
+    _drawHLine(RangeI{command.integers[0], command.integers[1]}, command.integers[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _replayVLine(const DrawCommand &command, const Canvas &canvas) {
+    _drawVLine(RangeI{command.integers[0], command.integers[1]}, command.integers[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _replayLine(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _drawLine(v[0], v[1], v[2], v[3], v[4], v[5], canvas, command.color, command.opacity, command.line_width, command.getViewportBounds());
+}
+
+
+INLINE void Canvas::drawHLine(RangeI x_range, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawHLine(x_range, y, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::drawHLine(i32 x_start, i32 x_end, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawHLine(RangeI{x_start, x_end}, y, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::drawVLine(RangeI y_range, i32 x, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawVLine(y_range, x, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::drawVLine(i32 y_start, i32 y_end, i32 x, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawVLine(RangeI{y_start, y_end}, x, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawLine(x1, y1, z1, x2, y2, z2, *this, color, opacity, line_width, viewport_bounds);
+}
+INLINE void Canvas::drawLine(f32 x1, f32 y1, f32 x2, f32 y2, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawLine(x1, y1, 0, x2, y2, 0, *this, color, opacity, line_width, viewport_bounds);
+}
+
+#ifdef SLIM_VEC2
+INLINE void Canvas::drawLine(vec2 from, vec2 to, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawLine(from.x, from.y, 0, to.x, to.y, 0, *this, color, opacity, line_width, viewport_bounds);
+}
+INLINE void Canvas::drawLine(vec2i from, vec2i to, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawLine((f32)from.x, (f32)from.y, 0, (f32)to.x, (f32)to.y, 0, *this, color, opacity, line_width, viewport_bounds);
+}
+#endif
+
+
+INLINE void drawHLine(RangeI x_range, i32 y, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawHLine(x_range, y, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void drawHLine(i32 x_start, i32 x_end, i32 y, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawHLine(RangeI{x_start, x_end}, y, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void drawVLine(RangeI y_range, i32 x, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawVLine(y_range, x, canvas, color, opacity, viewport_bounds);
+}
+INLINE void drawVLine(i32 y_start, i32 y_end, i32 x, const Canvas &canvas, const Color &color, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawVLine(RangeI{y_start, y_end}, x, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
+    _drawLine(x1, y1, z1, x2, y2, z2, canvas, color, opacity, line_width, viewport_bounds);
+}
+
+INLINE void drawLine(f32 x1, f32 y1, f32 x2, f32 y2, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
+    _drawLine(x1, y1, 0, x2, y2, 0, canvas, color, opacity, line_width, viewport_bounds);
+}
+
+#ifdef SLIM_VEC2
+void drawLine(vec2 from, vec2 to, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
+    _drawLine(from.x, from.y, 0, to.x, to.y, 0, canvas, color, opacity, line_width, viewport_bounds);
+}
+#endif
+
+
+void _replayRect(const DrawCommand &command, const Canvas &canvas);
+
+INLINE bool _recordRect(bool fill, const RectI &rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (!canvas.display_list)
+        return false;
+
+    DrawCommand *command = canvas.record(_replayRect, rect, color, opacity, viewport_bounds);
+    if (command) {
+        command->integers[0] = rect.left;
+        command->integers[1] = rect.right;
+        command->integers[2] = rect.top;
+        command->integers[3] = rect.bottom;
+        command->integers[4] = fill;
+    }
+    return true;
+}
+
+void _drawRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (_recordRect(false, rect, canvas, color, opacity, viewport_bounds))
+        return;
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+    if (viewport_bounds) {
+        bounds -= *viewport_bounds;
+        rect.x_range += viewport_bounds->left;
+        rect.y_range += viewport_bounds->top;
+    }
+    if (rect.isOutsideOf(bounds))
+        return;
+
+    const bool draw_top = bounds.y_range[rect.top];
+    const bool draw_bottom = bounds.y_range[rect.bottom];
+    const bool draw_left = bounds.x_range[rect.left];
+    const bool draw_right = bounds.x_range[rect.right];
+
+    const bool draw_horizontal = draw_top || draw_bottom;
+    const bool draw_vertical = draw_left || draw_right;
+    if (!(draw_horizontal || draw_vertical))
+        return;
+
+    rect = bounds - rect;
+    if (!rect)
+        return;
+
+    // Edges are drawn as spans of whole pixels, in the order the pixels always were (corners get drawn twice):
+    canvas.markDirty(rect);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    i32 width = rect.right - rect.left + 1;
+    if (draw_horizontal) {
+        if (draw_bottom) canvas.fillPixels(rect.left, rect.bottom, width, pixel);
+        if (draw_top) canvas.fillPixels(rect.left, rect.top, width, pixel);
+    }
+
+    if (draw_vertical) {
+        for (i32 y = rect.top; y <= rect.bottom; y++) {
+            if (draw_right) canvas.fillPixels(rect.right, y, 1, pixel);
+            if (draw_left) canvas.fillPixels(rect.left, y, 1, pixel);
+        }
+    }
+}
+
+void _fillRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (_recordRect(true, rect, canvas, color, opacity, viewport_bounds))
+        return;
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+    if (viewport_bounds) {
+        bounds -= *viewport_bounds;
+        rect.x_range += viewport_bounds->left;
+        rect.y_range += viewport_bounds->top;
+    }
+    if (rect.isOutsideOf(bounds))
+        return;
+
+    rect = bounds - rect;
+    if (!rect)
+        return;
+
+    // Clipped once, then filled row by row with the pixel computed once:
+    canvas.markDirty(rect);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    i32 width = rect.right - rect.left + 1;
+    for (i32 y = rect.top; y <= rect.bottom; y++)
+        canvas.fillPixels(rect.left, y, width, pixel);
+    if (pixel.opacity == 1.0f)
+        canvas.markOpaque(rect);
+}
+
+void _replayRect(const DrawCommand &command, const Canvas &canvas) {
+    const i32 *v = command.integers;
+    RectI rect{v[0], v[1], v[2], v[3]};
+    if (v[4])
+        _fillRect(rect, canvas, command.color, command.opacity, command.getViewportBounds());
+    else
+        _drawRect(rect, canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _replayRectSmoothly(const DrawCommand &command, const Canvas &canvas);
+
+INLINE f32 _getSpanCoverage(f32 first, f32 end, i32 pixel) {
+    f32 start = first > (f32)pixel ? first : (f32)pixel;
+    f32 stop = end < (f32)(pixel + 1) ? end : (f32)(pixel + 1);
+    return stop - start;
+}
+
+INLINE void _blendPixel(const Canvas &canvas, i32 x, i32 y, const Pixel &pixel, f32 coverage) {
+    if (coverage >= 1)
+        canvas.fillPixels<NoAA>(x, y, 1, pixel);
+    else if (coverage > 0)
+        canvas.fillPixels<NoAA>(x, y, 1, pixel * coverage);
+}
+
+// Fills a rectangle with fractional edges on a NoAA canvas, blending the pixels along its edges by how much of each it covers.
+// Like with RectI, edges are inclusive (the rectangle ending one pixel past its right and bottom edges),
+// so integral rectangles fill exactly the same pixels as they would without smooth edges:
+void _fillRectSmoothly(Rect rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        RectI bounds{(i32)floorf(rect.left), (i32)ceilf(rect.right), (i32)floorf(rect.top), (i32)ceilf(rect.bottom)};
+        DrawCommand *command = canvas.record(_replayRectSmoothly, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->values[0] = rect.left;
+            command->values[1] = rect.right;
+            command->values[2] = rect.top;
+            command->values[3] = rect.bottom;
+        }
+        return;
+    }
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+    f32 left = rect.left, right = rect.right + 1.0f, top = rect.top, bottom = rect.bottom + 1.0f;
+    if (viewport_bounds) {
+        bounds -= *viewport_bounds;
+        left   += (f32)viewport_bounds->left;
+        right  += (f32)viewport_bounds->left;
+        top    += (f32)viewport_bounds->top;
+        bottom += (f32)viewport_bounds->top;
+    }
+    if (left   < (f32)bounds.left)         left   = (f32)bounds.left;
+    if (right  > (f32)(bounds.right + 1))  right  = (f32)(bounds.right + 1);
+    if (top    < (f32)bounds.top)          top    = (f32)bounds.top;
+    if (bottom > (f32)(bounds.bottom + 1)) bottom = (f32)(bounds.bottom + 1);
+    if (left >= right || top >= bottom)
+        return;
+
+    // Partially covered pixels are those at the ends of rows and columns, the ones in between being filled as spans:
+    RectI pixels{(i32)floorf(left), (i32)ceilf(right) - 1, (i32)floorf(top), (i32)ceilf(bottom) - 1};
+    f32 first_column_coverage = _getSpanCoverage(left, right, pixels.left);
+    f32 last_column_coverage = _getSpanCoverage(left, right, pixels.right);
+    i32 span_first = first_column_coverage < 1 ? pixels.left + 1 : pixels.left;
+    i32 span_last = pixels.right > pixels.left && last_column_coverage < 1 ? pixels.right - 1 : pixels.right;
+
+    canvas.markDirty(pixels);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    for (i32 y = pixels.top; y <= pixels.bottom; y++) {
+        f32 row_coverage = _getSpanCoverage(top, bottom, y);
+        Pixel row_pixel{row_coverage < 1 ? pixel * row_coverage : pixel};
+        if (span_first > pixels.left) _blendPixel(canvas, pixels.left, y, row_pixel, first_column_coverage);
+        if (span_last >= span_first) canvas.fillPixels<NoAA>(span_first, y, span_last - span_first + 1, row_pixel);
+        if (span_last < pixels.right) _blendPixel(canvas, pixels.right, y, row_pixel, last_column_coverage);
+    }
+    // Only the fully covered pixels become opaque:
+    RangeI covered_x{(i32)ceilf(left), (i32)floorf(right) - 1};
+    RangeI covered_y{(i32)ceilf(top), (i32)floorf(bottom) - 1};
+    if (pixel.opacity == 1.0f && covered_x.first <= covered_x.last && covered_y.first <= covered_y.last)
+        canvas.markOpaque(RectI{covered_x, covered_y});
+}
+
+void _replayRectSmoothly(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _fillRectSmoothly(Rect{v[0], v[1], v[2], v[3]}, canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+
+INLINE void Canvas::drawRect(RectI rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawRect(rect, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::drawRect(Rect rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
+    _drawRect(rectI, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::fillRect(RectI rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _fillRect(rect, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::fillRect(Rect rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    if (smooth_edges && antialias == NoAA) {
+        _fillRectSmoothly(rect, *this, color, opacity, viewport_bounds);
+        return;
+    }
+    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
+    _fillRect(rectI, *this, color, opacity, viewport_bounds);
+}
+
+
+INLINE void drawRect(RectI rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawRect(rect, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void drawRect(Rect rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
+    _drawRect(rectI, canvas, color, opacity, viewport_bounds);
+}
+
+
+INLINE void fillRect(RectI rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _fillRect(rect, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void fillRect(Rect rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    if (canvas.smooth_edges && canvas.antialias == NoAA) {
+        _fillRectSmoothly(rect, canvas, color, opacity, viewport_bounds);
+        return;
+    }
+    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
+    _fillRect(rectI, canvas, color, opacity, viewport_bounds);
+}
+
+
+void _replayCircle(const DrawCommand &command, const Canvas &canvas);
+
+// Draws the (clipped) circle with the midpoint algorithm, specialized on the anti-aliasing mode:
+template <AntiAliasing AA>
+void _rasterizeCircle(bool fill, i32 center_x, i32 center_y, i32 radius, RectI bounds, const Canvas &canvas,
+                      const Color &color, f32 opacity) {
+    if (radius <= 1) {
+        if (AA == SSAA) {
+            center_x *= 2;
+            center_y *= 2;
+            canvas.setPixel<AA>(center_x, center_y, color, opacity);
+            canvas.setPixel<AA>(center_x+1, center_y, color, opacity);
+            canvas.setPixel<AA>(center_x, center_y+1, color, opacity);
+            canvas.setPixel<AA>(center_x+1, center_y+1, color, opacity);
+        } else
+            canvas.setPixel<AA>(center_x, center_y, color, opacity);
+
+        return;
+    }
+
+    if (AA == SSAA) {
+        center_x *= 2;
+        center_y *= 2;
+        radius *= 2;
+        bounds *= 2;
+    }
+    if (canvas.clip_bounds) { // Clip to whole pixels, covering both of their samples with SSAA:
+        RectI clip{*canvas.clip_bounds};
+        if (AA == SSAA) {
+            clip *= 2;
+            clip.right++;
+            clip.bottom++;
+        }
+        bounds -= clip;
+    }
+
+    i32 x = radius, y = 0, y2 = 0;
+    i32 r2 = radius * radius;
+    i32 x2 = r2;
+
+    RangeI x_range1{center_x - radius, center_x + radius};
+    RangeI y_range2{center_y - radius, center_y + radius};
+    RangeI y_range1{center_y, center_y};
+    RangeI x_range2{center_x, center_x};
+    RangeI range1, range2;
+    i32 i;
+
+    while (y <= x) {
+        if (fill) {
+            range1 = bounds.x_range - x_range1;
+            range2 = bounds.x_range - x_range2;
+            if (bounds.y_range[y_range1.first]) for (i = range1.first; i <= range1.last; i++) canvas.setPixel<AA>(i, y_range1.first, color, opacity);
+            if (bounds.y_range[y_range1.last])  for (i = range1.first; i <= range1.last; i++) canvas.setPixel<AA>(i, y_range1.last , color, opacity);
+            if (bounds.y_range[y_range2.first]) for (i = range2.first; i <= range2.last; i++) canvas.setPixel<AA>(i, y_range2.first, color, opacity);
+            if (bounds.y_range[y_range2.last])  for (i = range2.first; i <= range2.last; i++) canvas.setPixel<AA>(i, y_range2.last , color, opacity);
+        } else {
+            if (bounds.y_range[y_range1.first]) {
+                if (bounds.x_range[x_range1.first]) canvas.setPixel<AA>(x_range1.first, y_range1.first, color, opacity);
+                if (bounds.x_range[x_range1.last ]) canvas.setPixel<AA>(x_range1.last,  y_range1.first, color, opacity);
             }
-            texel_quad += remainder_x;
+            if (bounds.y_range[y_range1.last]) {
+                if (bounds.x_range[x_range1.first]) canvas.setPixel<AA>(x_range1.first, y_range1.last, color, opacity);
+                if (bounds.x_range[x_range1.last ]) canvas.setPixel<AA>(x_range1.last,  y_range1.last, color, opacity);
+            }
+
+            if (bounds.y_range[y_range2.first]) {
+                if (bounds.x_range[x_range2.first]) canvas.setPixel<AA>(x_range2.first, y_range2.first, color, opacity);
+                if (bounds.x_range[x_range2.last ]) canvas.setPixel<AA>(x_range2.last,  y_range2.first, color, opacity);
+            }
+            if (bounds.y_range[y_range2.last]) {
+                if (bounds.x_range[x_range2.first]) canvas.setPixel<AA>(x_range2.first, y_range2.last, color, opacity);
+                if (bounds.x_range[x_range2.last ]) canvas.setPixel<AA>(x_range2.last,  y_range2.last, color, opacity);
+            }
+        }
+
+        if ((x2 + y2) > r2) {
+            x--;
+            x2 = x * x;
+
+            x_range1.first++;
+            y_range2.first++;
+            x_range1.last--;
+            y_range2.last--;
+        }
+
+        y++;
+        y2 = y * y;
+
+        y_range1.first--;
+        x_range2.first--;
+        y_range1.last++;
+        x_range2.last++;
+    }
+}
+
+void _replayCircleSmoothly(const DrawCommand &command, const Canvas &canvas);
+
+// Fills a disc on a NoAA canvas, blending the pixels along its edge by how much of each it covers
+// (approximated from the distance of the pixel center to the edge). The center is given in pixels (the center of pixel x being x + 0.5).
+// Each row is filled as a span between the pixels that are fully inside, with only the ones around it being blended:
+void _fillCircleSmoothly(f32 center_x, f32 center_y, f32 radius, const Canvas &canvas,
+                         const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        RectI bounds{(i32)floorf(center_x - radius - 0.5f), (i32)ceilf(center_x + radius + 0.5f),
+                     (i32)floorf(center_y - radius - 0.5f), (i32)ceilf(center_y + radius + 0.5f)};
+        DrawCommand *command = canvas.record(_replayCircleSmoothly, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->values[0] = center_x;
+            command->values[1] = center_y;
+            command->values[2] = radius;
+        }
+        return;
+    }
+    if (radius <= 0)
+        return;
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+    if (viewport_bounds) {
+        bounds -= *viewport_bounds;
+        center_x += (f32)viewport_bounds->left;
+        center_y += (f32)viewport_bounds->top;
+    }
+
+    // Pixels are covered (partially) as long as their centers are within half a pixel outside of the edge:
+    f32 outer_radius = radius + 0.5f;
+    f32 inner_radius = radius - 0.5f;
+    f32 outer_radius_squared = outer_radius * outer_radius;
+    f32 inner_radius_squared = inner_radius > 0 ? inner_radius * inner_radius : 0;
+    RectI rect{(i32)floorf(center_x - outer_radius), (i32)ceilf(center_x + outer_radius),
+               (i32)floorf(center_y - outer_radius), (i32)ceilf(center_y + outer_radius)};
+    rect -= bounds;
+    if (!rect)
+        return;
+
+    canvas.markDirty(rect);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    for (i32 y = rect.top; y <= rect.bottom; y++) {
+        f32 dy = (f32)y + 0.5f - center_y;
+        f32 dy_squared = dy * dy;
+        if (dy_squared >= outer_radius_squared)
+            continue;
+
+        // The pixels fully inside, if any (with centers at least half a pixel inside of the edge):
+        i32 span_first = 0;
+        i32 span_last = -1;
+        if (inner_radius > 0 && dy_squared < inner_radius_squared) {
+            f32 half_width = sqrtf(inner_radius_squared - dy_squared);
+            span_first = (i32)ceilf(center_x - half_width - 0.5f);
+            span_last = (i32)floorf(center_x + half_width - 0.5f);
+            if (span_first < rect.left) span_first = rect.left;
+            if (span_last > rect.right) span_last = rect.right;
+            if (span_last >= span_first)
+                canvas.fillPixels<NoAA>(span_first, y, span_last - span_first + 1, pixel);
+        }
+
+        // Blend the pixels on either side of the span that are (partially) covered:
+        f32 half_width = sqrtf(outer_radius_squared - dy_squared);
+        i32 first = (i32)floorf(center_x - half_width - 0.5f);
+        i32 last = (i32)ceilf(center_x + half_width - 0.5f);
+        if (first < rect.left) first = rect.left;
+        if (last > rect.right) last = rect.right;
+        for (i32 x = first; x <= last; x++) {
+            if (x >= span_first && x <= span_last) {
+                x = span_last;
+                continue;
+            }
+            f32 dx = (f32)x + 0.5f - center_x;
+            f32 coverage = outer_radius - sqrtf(dx*dx + dy_squared);
+            if (coverage >= 1)
+                canvas.fillPixels<NoAA>(x, y, 1, pixel);
+            else if (coverage > 0)
+                canvas.fillPixels<NoAA>(x, y, 1, pixel * coverage);
+        }
+    }
+}
+
+void _replayCircleSmoothly(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _fillCircleSmoothly(v[0], v[1], v[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _paintCircle(bool fill, i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
+                  const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (fill && canvas.smooth_edges && canvas.antialias == NoAA) {
+        _fillCircleSmoothly((f32)center_x + 0.5f, (f32)center_y + 0.5f, (f32)radius + 0.5f, canvas, color, opacity, viewport_bounds);
+        return;
+    }
+
+    if (canvas.display_list) {
+        RectI bounds{center_x - radius - 1, center_x + radius + 1, center_y - radius - 1, center_y + radius + 1};
+        DrawCommand *command = canvas.record(_replayCircle, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->integers[0] = center_x;
+            command->integers[1] = center_y;
+            command->integers[2] = radius;
+            command->integers[3] = fill;
         }
+        return;
+    }
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    RectI rect{center_x - radius,
+               center_x + radius,
+               center_y - radius,
+               center_y + radius};
+    if (viewport_bounds) {
+        center_x += viewport_bounds->left;
+        center_y += viewport_bounds->top;
+        rect.x_range += viewport_bounds->left;
+        rect.y_range += viewport_bounds->top;
+        rect -= *viewport_bounds;
+        bounds -= *viewport_bounds;
+    }
+    if (canvas.clip_bounds) rect -= *canvas.clip_bounds;
+    rect -= bounds;
+    if (!rect)
+        return;
+
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeCircle<NoAA>(fill, center_x, center_y, radius, bounds, canvas, color, opacity); break;
+        case MSAA: _rasterizeCircle<MSAA>(fill, center_x, center_y, radius, bounds, canvas, color, opacity); break;
+        case SSAA: _rasterizeCircle<SSAA>(fill, center_x, center_y, radius, bounds, canvas, color, opacity); break;
+    }
+}
+
+void _replayCircle(const DrawCommand &command, const Canvas &canvas) {
+    const i32 *v = command.integers;
+    _paintCircle(v[3] != 0, v[0], v[1], v[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+INLINE void Canvas::fillCircle(i32 center_x, i32 center_y, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _paintCircle(true, center_x, center_y, radius, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::drawCircle(i32 center_x, i32 center_y, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _paintCircle(false, center_x, center_y, radius, *this, color, opacity, viewport_bounds);
+}
+
+#ifdef SLIM_VEC2
+INLINE void Canvas::drawCircle(vec2i center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _paintCircle(false, center.x, center.y, radius, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::fillCircle(vec2i center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _paintCircle(true, center.x, center.y, radius, *this, color, opacity, viewport_bounds);
+}
+INLINE void Canvas::drawCircle(vec2 center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _paintCircle(false, (i32)center.x, (i32)center.y, radius, *this, color, opacity, viewport_bounds);
+}
+INLINE void Canvas::fillCircle(vec2 center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    if (smooth_edges && antialias == NoAA) {
+        _fillCircleSmoothly(center.x + 0.5f, center.y + 0.5f, (f32)radius + 0.5f, *this, color, opacity, viewport_bounds);
+        return;
+    }
+    _paintCircle(true, (i32)center.x, (i32)center.y, radius, *this, color, opacity, viewport_bounds);
+}
+#endif
+
+
+INLINE void fillCircle(i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
+                       Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _paintCircle(true, center_x, center_y, radius, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void drawCircle(i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
+                       Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _paintCircle(false, center_x, center_y, radius, canvas, color, opacity, viewport_bounds);
+}
+
+#ifdef SLIM_VEC2
+INLINE void drawCircle(vec2i center, i32 radius, const Canvas &canvas,
+                       Color color = White, f32 opacity = 1.0f,
+                       const RectI *viewport_bounds = nullptr) {
+    _paintCircle(false, center.x, center.y, radius, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void fillCircle(vec2i center, i32 radius,
+                       const Canvas &canvas,
+                       Color color = White, f32 opacity = 1.0f,
+                       const RectI *viewport_bounds = nullptr) {
+    _paintCircle(true, center.x, center.y, radius, canvas, color, opacity, viewport_bounds);
+}
+INLINE void drawCircle(vec2 center, i32 radius, const Canvas &canvas,
+                       Color color = White, f32 opacity = 1.0f,
+                       const RectI *viewport_bounds = nullptr) {
+    _paintCircle(false, (i32)center.x, (i32)center.y, radius, canvas, color, opacity, viewport_bounds);
+}
+
+INLINE void fillCircle(vec2 center, i32 radius,
+                       const Canvas &canvas,
+                       Color color = White, f32 opacity = 1.0f,
+                       const RectI *viewport_bounds = nullptr) {
+    if (canvas.smooth_edges && canvas.antialias == NoAA) {
+        _fillCircleSmoothly(center.x + 0.5f, center.y + 0.5f, (f32)radius + 0.5f, canvas, color, opacity, viewport_bounds);
+        return;
+    }
+    _paintCircle(true, (i32)center.x, (i32)center.y, radius, canvas, color, opacity, viewport_bounds);
+}
+#endif
+
+
+INLINE void _drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3,
+                         const Canvas &canvas, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) {
+    drawLine(x1, y1, 0, x2, y2, 0, canvas, color, opacity, line_width, viewport_bounds);
+    drawLine(x2, y2, 0, x3, y3, 0, canvas, color, opacity, line_width, viewport_bounds);
+    drawLine(x3, y3, 0, x1, y1, 0, canvas, color, opacity, line_width, viewport_bounds);
+}
+
+
+// Triangles are filled in 8x8 blocks of samples: Blocks entirely outside of an edge are skipped, blocks entirely inside
+// of all edges are filled row by row, and only blocks straddling an edge evaluate the edges for each of their samples.
+// Edges are evaluated as the barycentric weights (B, C and A = 1 - B - C) at sample centers, a sample being inside when none is negative.
+#define TRIANGLE_BLOCK_SIZE 8
+
+// Returns a bit mask of which of 8 consecutive samples of a row are inside, given the weights of the first one.
+// Samples can be required to be further inside than that (or be let further outside) by minimum weights:
+INLINE u32 _getTriangleRowMask(f32 B, f32 C, f32 Bdx, f32 Cdx, f32 A_min = 0, f32 B_min = 0, f32 C_min = 0) {
+#ifdef SLIM_SSE2
+    const __m128 steps_low  = _mm_setr_ps(0, 1, 2, 3);
+    const __m128 steps_high = _mm_setr_ps(4, 5, 6, 7);
+    const __m128 a_min = _mm_set1_ps(A_min);
+    const __m128 b_min = _mm_set1_ps(B_min);
+    const __m128 c_min = _mm_set1_ps(C_min);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 b_dx = _mm_set1_ps(Bdx);
+    __m128 c_dx = _mm_set1_ps(Cdx);
+    __m128 b = _mm_set1_ps(B);
+    __m128 c = _mm_set1_ps(C);
+
+    __m128 B_low  = _mm_add_ps(b, _mm_mul_ps(b_dx, steps_low));
+    __m128 C_low  = _mm_add_ps(c, _mm_mul_ps(c_dx, steps_low));
+    __m128 B_high = _mm_add_ps(b, _mm_mul_ps(b_dx, steps_high));
+    __m128 C_high = _mm_add_ps(c, _mm_mul_ps(c_dx, steps_high));
+    __m128 A_low  = _mm_sub_ps(_mm_sub_ps(one, B_low),  C_low);
+    __m128 A_high = _mm_sub_ps(_mm_sub_ps(one, B_high), C_high);
+
+    __m128 inside_low  = _mm_and_ps(_mm_cmpge_ps(A_low,  a_min), _mm_and_ps(_mm_cmpge_ps(B_low,  b_min), _mm_cmpge_ps(C_low,  c_min)));
+    __m128 inside_high = _mm_and_ps(_mm_cmpge_ps(A_high, a_min), _mm_and_ps(_mm_cmpge_ps(B_high, b_min), _mm_cmpge_ps(C_high, c_min)));
+    return (u32)_mm_movemask_ps(inside_low) | ((u32)_mm_movemask_ps(inside_high) << 4);
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < TRIANGLE_BLOCK_SIZE; i++) {
+        f32 b = B + Bdx * (f32)i;
+        f32 c = C + Cdx * (f32)i;
+        f32 a = 1 - b - c;
+        if (a >= A_min && b >= B_min && c >= C_min) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// A triangle ready for rasterization: Its weights as linear functions of sample coordinates, and its bounds in samples:
+// With smooth edges, the weights are also scaled into (signed) distances in pixels from their edges, and samples are covered
+// partially up to half a pixel outside of the edges (the margins being how far that is in terms of weights).
+// With MSAA, the margins are how far the weights may get at the samples of a pixel from where they are at its center:
+struct TriangleSetup {
+    f32 B_origin, Bdx, Bdy;
+    f32 C_origin, Cdx, Cdy;
+    f32 A_scale, B_scale, C_scale;
+    f32 A_margin{0}, B_margin{0}, C_margin{0};
+    i32 first_x, first_y, last_x, last_y;
+    bool smooth_edges{false};
+};
+
+// Culls a triangle against the viewport and against facing backwards, returning false when there is nothing to draw:
+bool _setupTriangle(f32 x1, f32 y1,
+                    f32 x2, f32 y2,
+                    f32 x3, f32 y3,
+                    const Canvas &canvas, const RectI *viewport_bounds, TriangleSetup &setup) {
+    // Cull this triangle against the edges of the viewport:
+    Rect bounds{0, canvas.dimensions.f_width - 1.0f, 0, canvas.dimensions.f_height - 1.0f};
+    Rect rect{
+        x1 < x2 ? x1 : x2,
+        x1 > x2 ? x1 : x2,
+        y1 < y2 ? y1 : y2,
+        y1 > y2 ? y1 : y2,
+    };
+    if (x3 < rect.left) rect.left = x3;
+    if (x3 > rect.right) rect.right = x3;
+    if (y3 < rect.top) rect.top = y3;
+    if (y3 > rect.bottom) rect.bottom = y3;
+    if (viewport_bounds) {
+        Rect float_bounds{
+            (f32)viewport_bounds->left,
+            (f32)viewport_bounds->right,
+            (f32)viewport_bounds->top,
+            (f32)viewport_bounds->bottom,
+        };
+        x1 += float_bounds.left;
+        x2 += float_bounds.left;
+        x3 += float_bounds.left;
+        y1 += float_bounds.top;
+        y2 += float_bounds.top;
+        y3 += float_bounds.top;
+        rect.x_range += float_bounds.left;
+        rect.y_range += float_bounds.top;
+        rect -= float_bounds;
+        bounds -= float_bounds;
+    }
+    rect -= bounds;
+    if (!rect)
+        return false;
+
+    if (canvas.antialias == SSAA) {
+        x1 *= 2.0f;
+        x2 *= 2.0f;
+        x3 *= 2.0f;
+        y1 *= 2.0f;
+        y2 *= 2.0f;
+        y3 *= 2.0f;
+        rect *= 2.0f;;
+    }
+
+    // Compute area components:
+    f32 ABx = x2 - x1;
+    f32 ABy = y2 - y1;
+
+    f32 ACx = x3 - x1;
+    f32 ACy = y3 - y1;
+
+    f32 ABC = ACx*ABy - ACy*ABx;
+
+    // Cull faces facing backwards:
+    if (ABC < 0) {
+        f32 tmp = x3;
+        x3 = x2;
+        x2 = tmp;
+
+        tmp = y3;
+        y3 = y2;
+        y2 = tmp;
+
+        ABx = x2 - x1;
+        ABy = y2 - y1;
+
+        ACx = x3 - x1;
+        ACy = y3 - y1;
+        ABC = ACx*ABy - ACy*ABx;
+    } else if (ABC == 0)
+        return false;
+
+    // Floor bounds coordinates down to their integral component:
+    setup.first_x = (i32)rect.left;
+    setup.first_y = (i32)rect.top;
+    setup.last_x  = (i32)rect.right;
+    setup.last_y  = (i32)rect.bottom;
+
+    // Drawing: Top-down
+    // Origin: Top-left
+
+    // Compute weight constants:
+    f32 one_over_ABC = 1.0f / ABC;
+
+    setup.Cdx =  ABy * one_over_ABC;
+    setup.Bdx = -ACy * one_over_ABC;
+
+    setup.Cdy = -ABx * one_over_ABC;
+    setup.Bdy =  ACx * one_over_ABC;
+
+    // Weights at the origin, to be evaluated at sample centers:
+    setup.C_origin = (y1*x2 - x1*y2) * one_over_ABC + (setup.Cdx + setup.Cdy) * 0.5f;
+    setup.B_origin = (y3*x1 - x3*y1) * one_over_ABC + (setup.Bdx + setup.Bdy) * 0.5f;
+
+    setup.smooth_edges = canvas.smooth_edges && canvas.antialias == NoAA;
+    if (setup.smooth_edges) {
+        f32 Adx = -setup.Bdx - setup.Cdx;
+        f32 Ady = -setup.Bdy - setup.Cdy;
+        f32 A_length = sqrtf(Adx*Adx + Ady*Ady);
+        f32 B_length = sqrtf(setup.Bdx*setup.Bdx + setup.Bdy*setup.Bdy);
+        f32 C_length = sqrtf(setup.Cdx*setup.Cdx + setup.Cdy*setup.Cdy);
+        setup.A_scale = 1.0f / A_length;
+        setup.B_scale = 1.0f / B_length;
+        setup.C_scale = 1.0f / C_length;
+        setup.A_margin = 0.5f * A_length;
+        setup.B_margin = 0.5f * B_length;
+        setup.C_margin = 0.5f * C_length;
+    } else if (canvas.antialias == MSAA) {
+        setup.A_scale = setup.B_scale = setup.C_scale = 1.0f;
+        setup.A_margin = 0.5f * (fabsf(setup.Bdx + setup.Cdx) + fabsf(setup.Bdy + setup.Cdy));
+        setup.B_margin = 0.5f * (fabsf(setup.Bdx) + fabsf(setup.Bdy));
+        setup.C_margin = 0.5f * (fabsf(setup.Cdx) + fabsf(setup.Cdy));
     } else {
-        f32 u_step = 1.0f / (f32)draw_width;
-        f32 v_step = 1.0f / (f32)draw_height;
-        f32 v = v_step * 0.5f;
-        i32 Y = draw_bounds.top;
-        for (i32 y = 0; y < draw_height; y++, Y++, v += v_step) {
-            i32 X = draw_bounds.left;
-            f32 u = u_step * 0.5f;
-            for (i32 x = 0; x < draw_width; x++, X++, u += u_step) {
-                texel_color = texture_mip.sample(u, v).color;
-                canvas.setPixel(X, Y, texel_color, opacity);
+        setup.A_scale = setup.B_scale = setup.C_scale = 1.0f;
+        setup.A_margin = setup.B_margin = setup.C_margin = 0.0f;
+    }
+
+    return true;
+}
+
+// Classifies a rectangle of samples (inclusive) against a triangle, the weights being linear their extremes are at its corners.
+// Returns whether any of it could be inside, and sets fully_inside when all of it is:
+INLINE bool _overlapsTriangle(const TriangleSetup &setup, i32 left, i32 right, i32 top, i32 bottom, bool &fully_inside) {
+    f32 B_min = INFINITY, B_max = -INFINITY;
+    f32 C_min = INFINITY, C_max = -INFINITY;
+    f32 A_min = INFINITY, A_max = -INFINITY;
+    for (u8 corner = 0; corner < 4; corner++) {
+        f32 x = (f32)(corner & 1 ? right : left);
+        f32 y = (f32)(corner & 2 ? bottom : top);
+        f32 B = setup.B_origin + setup.Bdx*x + setup.Bdy*y;
+        f32 C = setup.C_origin + setup.Cdx*x + setup.Cdy*y;
+        f32 A = 1 - B - C;
+        B_min = B < B_min ? B : B_min;
+        B_max = B > B_max ? B : B_max;
+        C_min = C < C_min ? C : C_min;
+        C_max = C > C_max ? C : C_max;
+        A_min = A < A_min ? A : A_min;
+        A_max = A > A_max ? A : A_max;
+    }
+    fully_inside = B_min >= setup.B_margin && C_min >= setup.C_margin && A_min >= setup.A_margin;
+    return B_max >= -setup.B_margin && C_max >= -setup.C_margin && A_max >= -setup.A_margin;
+}
+
+INLINE f32 _getEdgeCoverage(f32 distance) {
+    distance += 0.5f;
+    return distance <= 0 ? 0 : (distance >= 1 ? 1 : distance);
+}
+
+// Blends the pixels of a block along the edges of a triangle by how much of each the triangle covers,
+// approximated by the product of how much of it each edge covers (given its distance to the pixel center):
+INLINE void _blendTriangleEdges(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                                i32 left, i32 right, i32 top, i32 bottom) {
+    for (i32 y = top; y <= bottom; y++) {
+        f32 B = setup.B_origin + setup.Bdx*(f32)left + setup.Bdy*(f32)y;
+        f32 C = setup.C_origin + setup.Cdx*(f32)left + setup.Cdy*(f32)y;
+        i32 run_start = -1; // Fully covered pixels are filled as spans
+        for (i32 x = left; x <= right; x++, B += setup.Bdx, C += setup.Cdx) {
+            f32 coverage = _getEdgeCoverage(B * setup.B_scale);
+            if (coverage > 0) coverage *= _getEdgeCoverage(C * setup.C_scale);
+            if (coverage > 0) coverage *= _getEdgeCoverage((1 - B - C) * setup.A_scale);
+            if (coverage >= 1) {
+                if (run_start < 0) run_start = x;
+                continue;
             }
+            if (run_start >= 0) {
+                canvas.fillPixels<NoAA>(run_start, y, x - run_start, pixel);
+                run_start = -1;
+            }
+            if (coverage > 0)
+                canvas.fillPixels<NoAA>(x, y, 1, pixel * coverage);
         }
+        if (run_start >= 0)
+            canvas.fillPixels<NoAA>(run_start, y, right - run_start + 1, pixel);
+    }
+}
+
+// Returns a bit mask of which samples of a pixel are inside, given the weights at its center and their offsets at each sample:
+INLINE u32 _getTriangleSampleMask(f32 B, f32 C, const f32 *B_offsets, const f32 *C_offsets, u32 sample_count) {
+    u32 mask = 0;
+#ifdef SLIM_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 b = _mm_set1_ps(B);
+    __m128 c = _mm_set1_ps(C);
+    for (u32 i = 0; i < sample_count; i += 4) {
+        __m128 B_samples = _mm_add_ps(b, _mm_loadu_ps(B_offsets + i));
+        __m128 C_samples = _mm_add_ps(c, _mm_loadu_ps(C_offsets + i));
+        __m128 A_samples = _mm_sub_ps(_mm_sub_ps(one, B_samples), C_samples);
+        __m128 inside = _mm_cmpge_ps(_mm_min_ps(A_samples, _mm_min_ps(B_samples, C_samples)), zero);
+        mask |= (u32)_mm_movemask_ps(inside) << i;
+    }
+    return mask & ((1u << sample_count) - 1);
+#else
+    for (u32 i = 0; i < sample_count; i++) {
+        f32 b = B + B_offsets[i];
+        f32 c = C + C_offsets[i];
+        f32 a = 1 - b - c;
+        if (a >= 0 && b >= 0 && c >= 0) mask |= 1 << i;
     }
+    return mask;
+#endif
 }
 
-void drawTexture(const Texture &texture, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f) {
-    if (draw_bounds.right < 0 ||
-        draw_bounds.bottom < 0 ||
-        draw_bounds.left >= canvas.dimensions.width ||
-        draw_bounds.top >= canvas.dimensions.height)
-        return;
-
-    u32 mip_level = 0;
-    if (!cropped) {
-        i32 draw_width = draw_bounds.right - draw_bounds.left+1;
-        i32 draw_height = draw_bounds.bottom - draw_bounds.top+1;
-        f32 texel_area = (f32)(texture.width * texture.height) / (f32)(draw_width * draw_height);
-        mip_level = Texture::GetMipLevel(texel_area, texture.mip_count);
+// Covers the samples of the pixels of a block that are inside a triangle (with MSAA), filling fully covered runs as spans.
+// Pixels are first classified by their centers (given the margins) as entirely inside or outside, only the rest testing each sample:
+INLINE void _coverTriangleSamples(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                                  i32 left, i32 right, i32 top, i32 bottom) {
+    const u32 sample_count = canvas.msaa_sample_count;
+    const u32 all_samples = (1u << sample_count) - 1;
+    const f32 (*positions)[2] = getSamplePositions(sample_count);
+    f32 B_offsets[8] = {}, C_offsets[8] = {};
+    for (u32 i = 0; i < sample_count; i++) {
+        B_offsets[i] = setup.Bdx*positions[i][0] + setup.Bdy*positions[i][1];
+        C_offsets[i] = setup.Cdx*positions[i][0] + setup.Cdy*positions[i][1];
+    }
+
+    u32 columns_mask = (1u << (right - left + 1)) - 1;
+    for (i32 y = top; y <= bottom; y++) {
+        f32 B = setup.B_origin + setup.Bdx*(f32)left + setup.Bdy*(f32)y;
+        f32 C = setup.C_origin + setup.Cdx*(f32)left + setup.Cdy*(f32)y;
+        u32 touched = _getTriangleRowMask(B, C, setup.Bdx, setup.Cdx, -setup.A_margin, -setup.B_margin, -setup.C_margin) & columns_mask;
+        if (!touched)
+            continue;
+        u32 covered = _getTriangleRowMask(B, C, setup.Bdx, setup.Cdx, setup.A_margin, setup.B_margin, setup.C_margin) & touched;
+
+        i32 run_start = -1;
+        i32 i = 0;
+        for (; touched >> i; i++) {
+            u32 mask = 0;
+            if ((covered >> i) & 1)
+                mask = all_samples;
+            else if ((touched >> i) & 1)
+                mask = _getTriangleSampleMask(B + setup.Bdx*(f32)i, C + setup.Cdx*(f32)i, B_offsets, C_offsets, sample_count);
+
+            if (mask == all_samples) {
+                if (run_start < 0) run_start = i;
+                continue;
+            }
+            if (run_start >= 0) {
+                canvas.fillPixels<MSAA>(left + run_start, y, i - run_start, pixel);
+                run_start = -1;
+            }
+            if (mask)
+                canvas.coverSamples(left + i, y, mask, pixel);
+        }
+        if (run_start >= 0)
+            canvas.fillPixels<MSAA>(left + run_start, y, i - run_start, pixel);
+    }
+}
+
+// Marks the canvas tiles entirely inside of an opaque triangle and of the given (inclusive) bounds, in samples, as opaque:
+INLINE void _markOpaqueTiles(const TriangleSetup &setup, const Canvas &canvas, i32 sample_shift,
+                             i32 first_x, i32 last_x, i32 first_y, i32 last_y) {
+    const i32 tile_shift = CANVAS_TILE_SIZE_SHIFT + sample_shift;
+    const i32 last_column = (canvas.dimensions.width << sample_shift) - 1;
+    const i32 last_row = (canvas.dimensions.height << sample_shift) - 1;
+    bool fully_inside;
+    for (i32 tile_y = first_y >> tile_shift; tile_y <= (last_y >> tile_shift); tile_y++) {
+        i32 top = tile_y << tile_shift;
+        i32 bottom = clampedValue(top + (1 << tile_shift) - 1, last_row);
+        if (top < first_y || bottom > last_y) continue;
+
+        for (i32 tile_x = first_x >> tile_shift; tile_x <= (last_x >> tile_shift); tile_x++) {
+            i32 left = tile_x << tile_shift;
+            i32 right = clampedValue(left + (1 << tile_shift) - 1, last_column);
+            if (left >= first_x && right <= last_x &&
+                _overlapsTriangle(setup, left, right, top, bottom, fully_inside) && fully_inside)
+                canvas.markOpaque(RectI{left >> sample_shift, right >> sample_shift, top >> sample_shift, bottom >> sample_shift});
+        }
     }
-    drawTextureMip(texture.mips[mip_level], canvas, draw_bounds, cropped, opacity);
 }
 
-void _drawHLine(RangeI x_range, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RangeI y_range{0, canvas.dimensions.height - 1};
+// Fills the samples of a triangle that are within the given (inclusive) clip bounds, in samples:
+template <AntiAliasing AA>
+void _rasterizeTriangle(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                        i32 clip_left, i32 clip_right, i32 clip_top, i32 clip_bottom) {
+    const i32 sample_shift = AntiAliasingLayout<AA>::sample_shift;
+    const i32 first_x = setup.first_x < clip_left ? clip_left : setup.first_x;
+    const i32 first_y = setup.first_y < clip_top  ? clip_top  : setup.first_y;
+    const i32 last_x  = clampedValue(setup.last_x, clip_right);
+    const i32 last_y  = clampedValue(setup.last_y, clip_bottom);
+    bool fully_inside;
 
-    if (viewport_bounds) {
-        y += viewport_bounds->top;
-        y_range -= viewport_bounds->y_range;
+    // Scan the bounds block by block:
+    for (i32 block_top = first_y & ~(TRIANGLE_BLOCK_SIZE - 1); block_top <= last_y; block_top += TRIANGLE_BLOCK_SIZE) {
+        i32 top    = block_top < first_y ? first_y : block_top;
+        i32 bottom = clampedValue(block_top + TRIANGLE_BLOCK_SIZE - 1, last_y);
 
-        x_range += viewport_bounds->left;
-        x_range -= viewport_bounds->x_range;
-    }
-    x_range.sub(0, canvas.dimensions.width - 1);
-    if (!x_range || !y_range[y])
-        return;
+        for (i32 block_left = first_x & ~(TRIANGLE_BLOCK_SIZE - 1); block_left <= last_x; block_left += TRIANGLE_BLOCK_SIZE) {
+            i32 left  = block_left < first_x ? first_x : block_left;
+            i32 right = clampedValue(block_left + TRIANGLE_BLOCK_SIZE - 1, last_x);
+            if (!_overlapsTriangle(setup, left, right, top, bottom, fully_inside))
+                continue;
 
-    if (canvas.antialias == SSAA) {
-        y *= 2;
-        x_range *= 2;
-        for (i32 x = x_range.first; x <= x_range.last; x += 2) {
-            canvas.setPixel(x, y, color, opacity);
-            canvas.setPixel(x+1, y, color, opacity);
-            canvas.setPixel(x, y+1, color, opacity);
-            canvas.setPixel(x+1, y+1, color, opacity);
-        }
-    } else
-        for (i32 x = x_range.first; x <= x_range.last; x += 1)
-            canvas.setPixel(x, y, color, opacity);
-}
+            // Blocks never straddle canvas tiles:
+            canvas.markDirty(left >> sample_shift, top >> sample_shift);
 
-void _drawVLine(RangeI y_range, i32 x, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RangeI x_range{0, canvas.dimensions.width - 1};
+            if (fully_inside) {
+                for (i32 y = top; y <= bottom; y++)
+                    canvas.fillSamples<AA>(left, y, right - left + 1, pixel);
+                continue;
+            }
 
-    if (viewport_bounds) {
-        x += viewport_bounds->left;
-        x_range -= viewport_bounds->x_range;
+            if (AA == NoAA && setup.smooth_edges) {
+                _blendTriangleEdges(setup, canvas, pixel, left, right, top, bottom);
+                continue;
+            }
+            if (AA == MSAA) {
+                _coverTriangleSamples(setup, canvas, pixel, left, right, top, bottom);
+                continue;
+            }
 
-        y_range += viewport_bounds->top;
-        y_range -= viewport_bounds->y_range;
+            u32 columns_mask = (1u << (right - left + 1)) - 1;
+            for (i32 y = top; y <= bottom; y++) {
+                u32 mask = _getTriangleRowMask(
+                        setup.B_origin + setup.Bdx*(f32)left + setup.Bdy*(f32)y,
+                        setup.C_origin + setup.Cdx*(f32)left + setup.Cdy*(f32)y,
+                        setup.Bdx, setup.Cdx) & columns_mask;
+
+                // Fill each run of inside samples as a span:
+                for (i32 i = 0; mask >> i; ) {
+                    if (!((mask >> i) & 1)) { i++; continue; }
+                    i32 run_start = i;
+                    while ((mask >> i) & 1) i++;
+                    canvas.fillSamples<AA>(left + run_start, y, i - run_start, pixel);
+                }
+            }
+        }
     }
-    y_range.sub(0, canvas.dimensions.height - 1);
-    if (!y_range || !x_range[x])
-        return;
 
-    if (canvas.antialias == SSAA) {
-        x *= 2;
-        y_range *= 2;
-        for (i32 y = y_range.first; y <= y_range.last; y += 2) {
-            canvas.setPixel(x, y, color, opacity);
-            canvas.setPixel(x+1, y, color, opacity);
-            canvas.setPixel(x, y+1, color, opacity);
-            canvas.setPixel(x+1, y+1, color, opacity);
-        }
-    } else
-        for (i32 y = y_range.first; y <= y_range.last; y += 1)
-            canvas.setPixel(x, y, color, opacity);
+    if (pixel.opacity == 1.0f && canvas.tile_max_depths)
+        _markOpaqueTiles(setup, canvas, sample_shift, first_x, last_x, first_y, last_y);
 }
 
-void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &canvas,
-               const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) {
-    Range float_x_range{x1 <= x2 ? x1 : x2, x1 <= x2 ? x2 : x1};
-    Range float_y_range{y1 <= y2 ? y1 : y2, y1 <= y2 ? y2 : y1};
-    if (viewport_bounds) {
-        const f32 left = (f32)viewport_bounds->left;
-        const f32 right = (f32)viewport_bounds->right;
-        const f32 top = (f32)viewport_bounds->top;
-        const f32 bottom = (f32)viewport_bounds->bottom;
-        x1 += left;
-        x2 += left;
-        y1 += top;
-        y2 += top;
-        float_x_range += left;
-        float_y_range += top;
-        float_x_range.sub(left, right);
-        float_y_range.sub(top, bottom);
+INLINE void _rasterizeTriangle(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                               i32 clip_left, i32 clip_right, i32 clip_top, i32 clip_bottom) {
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeTriangle<NoAA>(setup, canvas, pixel, clip_left, clip_right, clip_top, clip_bottom); break;
+        case MSAA: _rasterizeTriangle<MSAA>(setup, canvas, pixel, clip_left, clip_right, clip_top, clip_bottom); break;
+        case SSAA: _rasterizeTriangle<SSAA>(setup, canvas, pixel, clip_left, clip_right, clip_top, clip_bottom); break;
     }
-    float_x_range.sub(0, canvas.dimensions.f_width - 1.0f);
-    float_y_range.sub(0, canvas.dimensions.f_height - 1.0f);
-    if (!float_x_range || !float_y_range)
-        return;
+}
 
-    RangeI x_range{(i32)float_x_range.first, (i32)(ceilf(float_x_range.last))};
-    RangeI y_range{(i32)float_y_range.first, (i32)(ceilf(float_y_range.last))};
-    if (x_range.last == (i32)canvas.dimensions.width) x_range.last--;
-    if (y_range.last == (i32)canvas.dimensions.height) y_range.last--;
+void _replayTriangle(const DrawCommand &command, const Canvas &canvas);
 
-    i32 x, y;
-    if (canvas.antialias == SSAA) {
-        x1 += x1;
-        x2 += x2;
-        y1 += y1;
-        y2 += y2;
-        x_range.first <<= 1;
-        y_range.first <<= 1;
-        x_range.last <<= 1;
-        y_range.last <<= 1;
-        line_width <<= 1;
-        line_width++;
-    }
-    f32 tmp, z_range, range_remap;
-    f32 dx = x2 - x1;
-    f32 dy = y2 - y1;
-    f32 gap, grad, first_offset, last_offset;
-    f32 z, z_curr, z_step;
-    f32 first_x, last_x;
-    f32 first_y, last_y;
-    i32 start_x, end_x;
-    i32 start_y, end_y;
-    bool has_depth = (canvas.depths != nullptr) && ((z1 != 0.0f) || (z2 != 0.0f));
-    if (fabsf(dx) > fabsf(dy)) { // Shallow:
-        if (x2 < x1) { // Left to right:
-            tmp = x2; x2 = x1; x1 = tmp;
-            tmp = y2; y2 = y1; y1 = tmp;
-            tmp = z2; z2 = z1; z1 = tmp;
+void _fillTriangle(f32 x1, f32 y1,
+                   f32 x2, f32 y2,
+                   f32 x3, f32 y3,
+                   const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        RectI bounds{
+            (i32)floorf(x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3)),
+            (i32)ceilf( x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3)),
+            (i32)floorf(y1 < y2 ? (y1 < y3 ? y1 : y3) : (y2 < y3 ? y2 : y3)),
+            (i32)ceilf( y1 > y2 ? (y1 > y3 ? y1 : y3) : (y2 > y3 ? y2 : y3))
+        };
+        DrawCommand *command = canvas.record(_replayTriangle, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->values[0] = x1;
+            command->values[1] = y1;
+            command->values[2] = x2;
+            command->values[3] = y2;
+            command->values[4] = x3;
+            command->values[5] = y3;
         }
+        return;
+    }
 
-        grad = dy / dx;
-
-        first_x = roundf(x1);
-        last_x  = roundf(x2);
-        first_offset = first_x - x1;
-        last_offset  = last_x  - x2;
+    TriangleSetup setup;
+    if (!_setupTriangle(x1, y1, x2, y2, x3, y3, canvas, viewport_bounds, setup))
+        return;
 
-        first_y = y1 + grad * first_offset;
-        last_y  = y2 + grad * last_offset;
+    if (canvas.clip_bounds) {
+        i32 scale = canvas.antialias == SSAA ? 2 : 1;
+        const RectI &clip = *canvas.clip_bounds;
+        _rasterizeTriangle(setup, canvas, Canvas::toPixel(color, opacity),
+                           clip.left * scale, (clip.right + 1) * scale - 1, clip.top * scale, (clip.bottom + 1) * scale - 1);
+    } else
+        _rasterizeTriangle(setup, canvas, Canvas::toPixel(color, opacity),
+                           setup.first_x, setup.last_x, setup.first_y, setup.last_y);
+}
 
-        start_x = (i32)first_x;
-        start_y = (i32)first_y;
-        end_x   = (i32)last_x;
-        end_y   = (i32)last_y;
+void _replayTriangle(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _fillTriangle(v[0], v[1], v[2], v[3], v[4], v[5], canvas, command.color, command.opacity, command.getViewportBounds());
+}
 
-        x = start_x;
-        y = start_y;
-        gap = oneMinusFractionOf(x1 + 0.5f);
+#ifdef SLIM_VEC2
+// Batches of triangles are set up and binned into the canvas tiles they overlap in chunks (in parallel),
+// then the tiles are rasterized in parallel. Each tile gathers its triangles chunk after chunk,
+// so triangles are drawn into any tile in the order they were given in (keeping blending correct).
+// The scratch memory is shared, so batches are to be submitted from one thread at a time.
+// Binning only pays off when tiles get rasterized in parallel: With a single worker (or only a few triangles)
+// they are drawn one by one instead, as binning costs 5-10% more per triangle plus about 25us per batch on a core.
+#define TRIANGLES_PER_CHUNK 4096
+#define TRIANGLES_SCRATCH_SIZE Megabytes(64)
+#ifndef TRIANGLES_MIN_BATCH_COUNT
+#define TRIANGLES_MIN_BATCH_COUNT 256
+#endif
 
-        if (x_range[x]) {
-            if (y_range[y]) canvas.setPixel(x, y, color, oneMinusFractionOf(first_y) * gap * opacity, z1);
-            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel(x, y, color, opacity, z1);
-            if (y_range[++y]) canvas.setPixel(x, y, color, fractionOf(first_y) * gap * opacity, z1);
+namespace triangles {
+    memory::MonotonicAllocator scratch;
+
+    struct Batch {
+        const Canvas *canvas;
+        const vec2 *vertices;
+        const u32 *indices;
+        const Color *colors;
+        const RectI *viewport_bounds;
+        f32 opacity;
+        u32 count;
+
+        u32 tile_column_count;
+        u32 tile_count;
+        u32 chunk_count;
+        i32 tile_size; // In samples
+
+        TriangleSetup *setups;
+        u8 *is_visible;
+        u32 *bin_offsets; // Per chunk and tile: Counts, then where the chunk's triangles go in the tile's bin
+        u32 *tile_offsets; // Per tile, where its bin starts
+        u32 *bins;
+
+        INLINE u32 firstTriangle(u32 chunk) const { return chunk * TRIANGLES_PER_CHUNK; }
+        INLINE u32 endTriangle(u32 chunk) const { return chunk + 1 < chunk_count ? firstTriangle(chunk + 1) : count; }
+
+        // Calls tile_function(tile_index) for each tile overlapped by the triangle:
+        template <typename TileFunction>
+        INLINE void forEachTile(const TriangleSetup &setup, const TileFunction &tile_function) const {
+            bool fully_inside;
+            for (i32 tile_y = setup.first_y / tile_size; tile_y <= setup.last_y / tile_size; tile_y++) {
+                i32 top = tile_y * tile_size;
+                i32 bottom = clampedValue(top + tile_size - 1, setup.last_y);
+                if (top < setup.first_y) top = setup.first_y;
+
+                for (i32 tile_x = setup.first_x / tile_size; tile_x <= setup.last_x / tile_size; tile_x++) {
+                    i32 left = tile_x * tile_size;
+                    i32 right = clampedValue(left + tile_size - 1, setup.last_x);
+                    if (left < setup.first_x) left = setup.first_x;
+
+                    if (_overlapsTriangle(setup, left, right, top, bottom, fully_inside))
+                        tile_function(tile_y * tile_column_count + tile_x);
+                }
+            }
         }
 
-        x = end_x;
-        y = end_y;
-        gap = fractionOf(x2 + 0.5f);
-
-        if (x_range[x]) {
-            if (y_range[y]) canvas.setPixel(x, y, color, oneMinusFractionOf(last_y) * gap * opacity, z2);
-            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel(x, y, color, opacity, z2);
-            if (y_range[++y]) canvas.setPixel(x, y, color, fractionOf(last_y) * gap * opacity, z2);
+        static void setupChunk(void *data, u32 chunk) {
+            Batch &batch = *(Batch*)data;
+            u32 *tile_counts = batch.bin_offsets + chunk * batch.tile_count;
+            for (u32 i = 0; i < batch.tile_count; i++) tile_counts[i] = 0;
+
+            for (u32 t = batch.firstTriangle(chunk); t < batch.endTriangle(chunk); t++) {
+                const vec2 &v1 = batch.vertices[batch.indices ? batch.indices[3 * t    ] : 3 * t    ];
+                const vec2 &v2 = batch.vertices[batch.indices ? batch.indices[3 * t + 1] : 3 * t + 1];
+                const vec2 &v3 = batch.vertices[batch.indices ? batch.indices[3 * t + 2] : 3 * t + 2];
+                TriangleSetup &setup = batch.setups[t];
+                batch.is_visible[t] = _setupTriangle(v1.x, v1.y, v2.x, v2.y, v3.x, v3.y, *batch.canvas, batch.viewport_bounds, setup);
+                if (batch.is_visible[t])
+                    batch.forEachTile(setup, [&](u32 tile) { tile_counts[tile]++; });
+            }
         }
 
-        if (has_depth) { // Compute one-over-depth start and step
-            z1 = 1.0f / z1;
-            z2 = 1.0f / z2;
-            z_range = z2 - z1;
-            range_remap = z_range / (x2 - x1);
-            z1 += range_remap * (first_offset + 1.0f);
-            z2 += range_remap * (last_offset  - 1.0f);
-            z_curr = z1;
-            z_range = z2 - z1;
-            z_step = z_range / (last_x - first_x - 1.0f);
-        } else z = 0.0f;
-
-        gap = first_y + grad;
-        for (x = start_x + 1; x < end_x; x++) {
-            if (x_range[x]) {
-                y = (i32) gap;
+        static void binChunk(void *data, u32 chunk) {
+            Batch &batch = *(Batch*)data;
+            u32 *bin_offsets = batch.bin_offsets + chunk * batch.tile_count;
+            for (u32 t = batch.firstTriangle(chunk); t < batch.endTriangle(chunk); t++)
+                if (batch.is_visible[t])
+                    batch.forEachTile(batch.setups[t], [&](u32 tile) { batch.bins[bin_offsets[tile]++] = t; });
+        }
 
-                if (has_depth) z = 1.0f / z_curr;
-                if (y_range[y]) canvas.setPixel(x, y, color, oneMinusFractionOf(gap) * opacity, z);
-                for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel(x, y, color, opacity, z);
-                if (y_range[++y]) canvas.setPixel(x, y, color, fractionOf(gap) * opacity, z);
+        void rasterizeTile(const RectI &tile) const {
+            u32 tile_index = (tile.top >> CANVAS_TILE_SIZE_SHIFT) * tile_column_count + (tile.left >> CANVAS_TILE_SIZE_SHIFT);
+            i32 scale = canvas->antialias == SSAA ? 2 : 1;
+            i32 clip_left   = tile.left * scale;
+            i32 clip_top    = tile.top  * scale;
+            i32 clip_right  = (tile.right  + 1) * scale - 1;
+            i32 clip_bottom = (tile.bottom + 1) * scale - 1;
+
+            for (u32 i = tile_offsets[tile_index]; i < tile_offsets[tile_index + 1]; i++) {
+                u32 t = bins[i];
+                _rasterizeTriangle(setups[t], *canvas, Canvas::toPixel(colors ? colors[t] : Color(White), opacity),
+                                   clip_left, clip_right, clip_top, clip_bottom);
             }
-
-            gap += grad;
-            if (has_depth) z_curr += z_step;
-        }
-    } else { // Steep:
-        if (y2 < y1) { // Bottom up:
-            tmp = x2; x2 = x1; x1 = (f32)tmp;
-            tmp = y2; y2 = y1; y1 = (f32)tmp;
-            tmp = z2; z2 = z1; z1 = tmp;
         }
+    };
+}
 
-        grad = dx / dy;
-
-        first_y = roundf(y1);
-        last_y  = roundf(y2);
-
-        first_offset = y1 - first_y;
-        last_offset  = last_y  - y2;
-
-        first_x = x1 + grad * first_offset;
-        last_x  = x2 + grad * last_offset;
-
-        start_y = (i32)first_y;
-        start_x = (i32)first_x;
-
-        end_y = (i32)last_y;
-        end_x = (i32)last_x;
-
-        x = start_x;
-        y = start_y;
-        gap = oneMinusFractionOf(y1 + 0.5f);
-
-        if (y_range[y]) {
-            if (x_range[x]) canvas.setPixel(x, y, color, oneMinusFractionOf(first_x) * gap * opacity, z1);
-            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel(x, y, color, opacity, z1);
-            if (x_range[++x]) canvas.setPixel(x, y, color, fractionOf(first_x) * gap * opacity, z1);
+// Fills count triangles, each given by 3 indices into the vertices (or by 3 consecutive vertices when there are no indices),
+// in the color given for each (or in white when there are none):
+void _fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors,
+                    const Canvas &canvas, f32 opacity, const RectI *viewport_bounds) {
+    if (!count || !vertices) return;
+
+    triangles::Batch batch;
+    batch.canvas = &canvas;
+    batch.vertices = vertices;
+    batch.indices = indices;
+    batch.colors = colors;
+    batch.viewport_bounds = viewport_bounds;
+    batch.opacity = opacity;
+    batch.count = count;
+    batch.tile_column_count = canvas.getTileColumnCount();
+    batch.tile_count = batch.tile_column_count * canvas.getTileRowCount();
+    batch.chunk_count = (count + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK;
+    batch.tile_size = canvas.antialias == SSAA ? CANVAS_TILE_SIZE * 2 : CANVAS_TILE_SIZE;
+
+    if (!jobs::queues) jobs::initialize();
+    bool one_by_one = canvas.display_list || canvas.clip_bounds || // Each gets recorded, or is clipped
+            jobs::worker_count < 2 || count < TRIANGLES_MIN_BATCH_COUNT;
+    if (!one_by_one) {
+        memory::MonotonicAllocator &scratch = triangles::scratch;
+        if (!scratch.capacity) scratch = memory::MonotonicAllocator{TRIANGLES_SCRATCH_SIZE};
+        scratch.reset();
+        batch.setups       = (TriangleSetup*)scratch.allocate(sizeof(TriangleSetup) * count);
+        batch.is_visible   = (u8*)scratch.allocate(count);
+        batch.bin_offsets  = (u32*)scratch.allocate(sizeof(u32) * batch.chunk_count * batch.tile_count);
+        batch.tile_offsets = (u32*)scratch.allocate(sizeof(u32) * (batch.tile_count + 1));
+        one_by_one = !batch.setups || !batch.is_visible || !batch.bin_offsets || !batch.tile_offsets; // Too many
+    }
+    if (one_by_one) {
+        for (u32 t = 0; t < count; t++) {
+            const vec2 &v1 = vertices[indices ? indices[3 * t    ] : 3 * t    ];
+            const vec2 &v2 = vertices[indices ? indices[3 * t + 1] : 3 * t + 1];
+            const vec2 &v3 = vertices[indices ? indices[3 * t + 2] : 3 * t + 2];
+            _fillTriangle(v1.x, v1.y, v2.x, v2.y, v3.x, v3.y, canvas, colors ? colors[t] : Color(White), opacity, viewport_bounds);
         }
+        return;
+    }
 
-        x = end_x;
-        y = end_y;
-        gap = fractionOf(y2 + 0.5f);
+    jobs::run(triangles::Batch::setupChunk, &batch, batch.chunk_count);
 
-        if (y_range[y]) {
-            if (x_range[x]) canvas.setPixel(x, y, color, oneMinusFractionOf(last_x) * gap * opacity, z2);
-            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel(x, y, color, opacity, z2);
-            if (x_range[++x]) canvas.setPixel(x, y, color, fractionOf(last_x) * gap * opacity, z2);
+    // Lay the bins out tile after tile, each one chunk after chunk:
+    u32 offset = 0;
+    for (u32 tile = 0; tile < batch.tile_count; tile++) {
+        batch.tile_offsets[tile] = offset;
+        for (u32 chunk = 0; chunk < batch.chunk_count; chunk++) {
+            u32 &bin_offset = batch.bin_offsets[chunk * batch.tile_count + tile];
+            u32 tile_count = bin_offset;
+            bin_offset = offset;
+            offset += tile_count;
         }
+    }
+    batch.tile_offsets[batch.tile_count] = offset;
+    batch.bins = (u32*)triangles::scratch.allocate(sizeof(u32) * offset);
+    if (!batch.bins) { // Too many tiles overlapped, draw them one by one:
+        for (u32 t = 0; t < count; t++)
+            if (batch.is_visible[t])
+                _rasterizeTriangle(batch.setups[t], canvas, Canvas::toPixel(colors ? colors[t] : Color(White), opacity),
+                                   batch.setups[t].first_x, batch.setups[t].last_x, batch.setups[t].first_y, batch.setups[t].last_y);
+        return;
+    }
 
-        if (has_depth) { // Compute one-over-depth start and step
-            z1 = 1.0f / z1;
-            z2 = 1.0f / z2;
-            z_range = z2 - z1;
-            range_remap = z_range / (y2 - y1);
-            z1 += range_remap * (first_offset + 1.0f);
-            z2 += range_remap * (last_offset  - 1.0f);
-            z_range = z2 - z1;
-            z_step = z_range / (last_y - first_y - 1.0f);
-            z_curr = z1;
-        } else z = 0.0f;
+    jobs::run(triangles::Batch::binChunk, &batch, batch.chunk_count);
 
-        gap = first_x + grad;
-        for (y = start_y + 1; y < end_y; y++) {
-            if (y_range[y]) {
-                if (has_depth) z = 1.0f / z_curr;
-                x = (i32)gap;
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { batch.rasterizeTile(tile); });
+}
+#endif
 
-                if (x_range[x]) canvas.setPixel(x, y, color, oneMinusFractionOf(gap) * opacity, z);
-                for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel(x, y, color, opacity, z);
-                if (x_range[++x]) canvas.setPixel(x, y, color, fractionOf(gap) * opacity, z);
-            }
 
-            gap += grad;
-            if (has_depth) z_curr += z_step;
-        }
-    }
+INLINE void Canvas::drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawTriangle(x1, y1, x2, y2, x3, y3, *this, color, opacity, line_width, viewport_bounds);
 }
 
+INLINE void Canvas::drawTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, *this, color, opacity, line_width, viewport_bounds);
+}
 
-INLINE void Canvas::drawHLine(RangeI x_range, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawHLine(x_range, y, *this, color, opacity, viewport_bounds);
+INLINE void Canvas::fillTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _fillTriangle(x1, y1, x2, y2, x3, y3, *this, color, opacity, viewport_bounds);
 }
 
-INLINE void Canvas::drawHLine(i32 x_start, i32 x_end, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawHLine(RangeI{x_start, x_end}, y, *this, color, opacity, viewport_bounds);
+INLINE void Canvas::fillTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _fillTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, *this, color, opacity, viewport_bounds);
 }
 
-INLINE void Canvas::drawVLine(RangeI y_range, i32 x, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawVLine(y_range, x, *this, color, opacity, viewport_bounds);
+#ifdef SLIM_VEC2
+INLINE void Canvas::drawTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, *this, color, opacity, line_width, viewport_bounds);
 }
 
-INLINE void Canvas::drawVLine(i32 y_start, i32 y_end, i32 x, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawVLine(RangeI{y_start, y_end}, x, *this, color, opacity, viewport_bounds);
+INLINE void Canvas::fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _fillTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, *this, color, opacity, viewport_bounds);
+}
+
+INLINE void Canvas::fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors, f32 opacity, const RectI *viewport_bounds) const {
+    _fillTriangles(vertices, indices, count, colors, *this, opacity, viewport_bounds);
 }
 
-INLINE void Canvas::drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawLine(x1, y1, z1, x2, y2, z2, *this, color, opacity, line_width, viewport_bounds);
+INLINE void Canvas::drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
+    _drawTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, *this, color, opacity, line_width, viewport_bounds);
 }
-INLINE void Canvas::drawLine(f32 x1, f32 y1, f32 x2, f32 y2, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawLine(x1, y1, 0, x2, y2, 0, *this, color, opacity, line_width, viewport_bounds);
+
+INLINE void Canvas::fillTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _fillTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, *this, color, opacity, viewport_bounds);
 }
+#endif
 
-#ifdef SLIM_VEC2
-INLINE void Canvas::drawLine(vec2 from, vec2 to, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawLine(from.x, from.y, 0, to.x, to.y, 0, *this, color, opacity, line_width, viewport_bounds);
+
+INLINE void drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Canvas &canvas,
+                         Color color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
+    _drawTriangle(x1, y1, x2, y2, x3, y3, canvas, color, opacity, line_width, viewport_bounds);
 }
-INLINE void Canvas::drawLine(vec2i from, vec2i to, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawLine((f32)from.x, (f32)from.y, 0, (f32)to.x, (f32)to.y, 0, *this, color, opacity, line_width, viewport_bounds);
+
+INLINE void drawTriangle(i32 x1, i32 y1,
+                         i32 x2, i32 y2,
+                         i32 x3, i32 y3,
+                         const Canvas &canvas,
+                         Color color = White, f32 opacity = 0.5f, u8 line_width = 0,
+                         const RectI *viewport_bounds = nullptr) {
+    _drawTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, canvas, color, opacity, line_width, viewport_bounds);
 }
-#endif
 
 
-INLINE void drawHLine(RangeI x_range, i32 y, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawHLine(x_range, y, canvas, color, opacity, viewport_bounds);
+INLINE void fillTriangle(f32 x1, f32 y1,
+                         f32 x2, f32 y2,
+                         f32 x3, f32 y3,
+                         const Canvas &canvas, Color color = White, f32 opacity = 1.0f,
+                         const RectI *viewport_bounds = nullptr) {
+    _fillTriangle(x1, y1, x2, y2, x3, y3, canvas, color, opacity, viewport_bounds);
 }
 
-INLINE void drawHLine(i32 x_start, i32 x_end, i32 y, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawHLine(RangeI{x_start, x_end}, y, canvas, color, opacity, viewport_bounds);
+INLINE void fillTriangle(i32 x1, i32 y1,
+                         i32 x2, i32 y2,
+                         i32 x3, i32 y3,
+                         const Canvas &canvas, Color color = White, f32 opacity = 1.0f,
+                         const RectI *viewport_bounds = nullptr) {
+    _fillTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, canvas, color, opacity, viewport_bounds);
 }
 
-INLINE void drawVLine(RangeI y_range, i32 x, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawVLine(y_range, x, canvas, color, opacity, viewport_bounds);
+#ifdef SLIM_VEC2
+void drawTriangle(vec2 p1, vec2 p2, vec2 p3, const Canvas &canvas,
+                  Color color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) {
+    _drawTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, canvas, color, opacity, line_width, viewport_bounds);
 }
-INLINE void drawVLine(i32 y_start, i32 y_end, i32 x, const Canvas &canvas, const Color &color, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawVLine(RangeI{y_start, y_end}, x, canvas, color, opacity, viewport_bounds);
+
+void fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Canvas &canvas,
+                  Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _fillTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, canvas, color, opacity, viewport_bounds);
 }
 
-INLINE void drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
-    _drawLine(x1, y1, z1, x2, y2, z2, canvas, color, opacity, line_width, viewport_bounds);
+void fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors, const Canvas &canvas,
+                   f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _fillTriangles(vertices, indices, count, colors, canvas, opacity, viewport_bounds);
 }
 
-INLINE void drawLine(f32 x1, f32 y1, f32 x2, f32 y2, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
-    _drawLine(x1, y1, 0, x2, y2, 0, canvas, color, opacity, line_width, viewport_bounds);
+void drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Canvas &canvas,
+                  Color color = White, f32 opacity = 0.5f, u8 line_width = 0,
+                  const RectI *viewport_bounds = nullptr) {
+    _drawTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, canvas, color, opacity, line_width, viewport_bounds);
 }
 
-#ifdef SLIM_VEC2
-void drawLine(vec2 from, vec2 to, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
-    _drawLine(from.x, from.y, 0, to.x, to.y, 0, canvas, color, opacity, line_width, viewport_bounds);
+void fillTriangle(vec2i p1, vec2i p2, vec2i p3,
+                  const Canvas &canvas,
+                  Color color = White, f32 opacity = 1.0f,
+                  const RectI *viewport_bounds = nullptr) {
+    _fillTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, canvas, color, opacity, viewport_bounds);
 }
 #endif
 
 
+#define LINE_HEIGHT 14
+#define FIRST_CHARACTER_CODE 32
+#define LAST_CHARACTER_CODE 126
+#define INTERNAL_FONT_WIDTH (FONT_WIDTH * 2)
+#define INTERNAL_FONT_HEIGHT (FONT_HEIGHT * 2)
+
+// Header File for SSD1306 characters
+// Generated with TTF2BMH
+// Font JetBrains Mono Regular
+// Font Size: 24
+u8 bitmap_32[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_33[] = {0,0,0,0,0,0,62,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0};
+u8 bitmap_34[] = {0,0,0,0,254,254,0,0,0,254,254,254,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_35[] = {0,0,192,192,192,252,254,192,192,192,192,252,254,192,192,0,0,0,0,96,96,240,255,111,96,96,96,240,255,111,96,96,0,0,0,0,0,0,12,15,1,0,0,0,12,15,1,0,0,0,0,0,0,0};
+u8 bitmap_36[] = {0,0,112,248,252,14,6,255,255,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,6,255,255,12,28,248,240,192,0,0,0,0,0,0,3,7,14,12,12,255,255,12,12,15,7,1,0,0,0,0};
+u8 bitmap_37[] = {0,252,206,2,2,6,252,120,0,0,0,128,192,64,96,0,0,0,0,192,97,49,17,25,13,4,246,59,9,9,24,240,224,0,0,0,0,0,0,0,0,0,0,0,7,14,8,8,12,7,3,0,0,0};
+u8 bitmap_38[] = {0,0,0,252,252,142,6,6,6,14,28,24,0,0,0,0,0,0,0,248,252,254,3,3,15,28,120,240,224,248,60,12,4,0,0,0,0,1,7,7,14,12,12,14,6,7,1,7,14,12,8,0,0,0};
+u8 bitmap_39[] = {0,0,0,0,0,0,126,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_40[] = {0,0,0,0,0,240,252,62,7,3,1,1,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,7,15,28,56,112,96,96,0,0,0,0,0};
+u8 bitmap_41[] = {0,0,0,0,1,1,3,15,254,248,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,96,112,48,56,30,15,3,0,0,0,0,0,0,0,0};
+u8 bitmap_42[] = {0,0,0,0,0,0,0,240,240,0,0,0,0,0,0,0,0,0,0,3,3,131,198,246,124,15,61,118,230,199,131,3,2,0,0,0,0,0,0,1,1,0,0,0,0,0,1,1,0,0,0,0,0,0};
+u8 bitmap_43[] = {0,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,0,0,0,0,24,24,24,24,24,255,255,24,24,24,24,24,0,0,0,0,0,0,0,0,0,0,0,3,3,0,0,0,0,0,0,0,0,0};
+u8 bitmap_44[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,15,1,0,0,0,0,0,0,0,0};
+u8 bitmap_45[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,6,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_46[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,7,0,0,0,0,0,0,0,0};
+u8 bitmap_47[] = {0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,96,120,127,15,1,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_48[] = {0,0,240,248,60,14,6,134,134,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,31,63,63,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_49[] = {0,0,0,56,24,28,14,254,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,15,12,12,12,12,0,0,0,0};
+u8 bitmap_50[] = {0,0,56,60,28,14,6,6,6,14,28,252,248,0,0,0,0,0,0,0,0,0,128,192,224,112,48,28,15,7,3,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_51[] = {0,0,6,6,6,6,134,198,102,54,62,30,14,0,0,0,0,0,0,0,128,128,0,3,3,3,3,7,14,254,252,96,0,0,0,0,0,0,1,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
+u8 bitmap_52[] = {0,0,0,0,0,128,192,240,120,30,14,2,0,0,0,0,0,0,0,0,240,252,254,199,195,192,192,192,192,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_53[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,7,7,7,6,3,3,3,3,7,254,252,240,0,0,0,0,0,0,1,7,7,14,12,12,12,14,14,7,3,0,0,0,0,0};
+u8 bitmap_54[] = {0,0,0,0,128,224,240,60,30,6,2,0,0,0,0,0,0,0,0,0,248,254,15,5,2,3,3,3,7,254,252,240,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_55[] = {0,0,62,62,6,6,6,6,6,6,230,254,126,14,0,0,0,0,0,0,0,0,0,0,128,224,252,63,15,1,0,0,0,0,0,0,0,0,0,0,8,14,15,7,1,0,0,0,0,0,0,0,0,0};
+u8 bitmap_56[] = {0,0,112,248,252,14,6,6,6,14,12,252,248,0,0,0,0,0,0,0,240,249,29,15,6,6,6,7,15,253,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_57[] = {0,0,240,248,28,14,6,6,6,6,12,252,248,224,0,0,0,0,0,0,3,7,15,14,12,140,204,244,126,31,7,1,0,0,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,0,0,0,0};
+u8 bitmap_58[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,6,0,0,0,0,0,0,0,0};
+u8 bitmap_59[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,7,1,0,0,0,0,0,0,0,0};
+u8 bitmap_60[] = {0,0,0,0,0,128,128,192,192,224,96,112,48,0,0,0,0,0,0,0,14,15,27,27,49,49,96,96,192,192,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0};
+u8 bitmap_61[] = {0,0,192,192,192,192,192,192,192,192,192,192,192,192,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_62[] = {0,0,48,112,96,96,192,192,128,128,0,0,0,0,0,0,0,0,0,0,128,192,192,224,96,112,49,57,27,27,14,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_63[] = {0,0,0,0,6,6,6,6,6,12,252,248,224,0,0,0,0,0,0,0,0,0,0,124,124,124,12,14,7,3,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0,0};
+u8 bitmap_64[] = {0,192,240,120,28,14,6,6,134,134,142,12,252,248,192,0,0,0,0,255,255,0,0,0,252,255,7,1,1,3,253,255,255,0,0,0,0,15,63,120,224,192,193,131,135,134,6,2,1,7,7,0,0,0};
+u8 bitmap_65[] = {0,0,0,0,128,240,254,14,62,254,224,0,0,0,0,0,0,0,0,0,128,248,255,127,97,96,96,99,127,254,224,0,0,0,0,0,0,8,15,15,1,0,0,0,0,0,0,3,15,15,0,0,0,0};
+u8 bitmap_66[] = {0,0,254,254,254,6,6,6,6,14,14,252,248,32,0,0,0,0,0,0,255,255,255,6,6,6,6,6,15,253,249,240,0,0,0,0,0,0,15,15,15,12,12,12,12,12,14,7,3,1,0,0,0,0};
+u8 bitmap_67[] = {0,0,224,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_68[] = {0,0,254,254,254,6,6,6,6,14,28,252,248,192,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,15,15,15,12,12,12,12,14,7,7,3,0,0,0,0,0};
+u8 bitmap_69[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_70[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_71[] = {0,0,240,248,60,14,6,6,6,14,14,60,56,32,0,0,0,0,0,0,255,255,128,0,0,12,12,12,12,252,252,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_72[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_73[] = {0,0,6,6,6,6,6,254,254,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0,0};
+u8 bitmap_74[] = {0,0,0,6,6,6,6,6,6,6,6,254,254,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,1,0,0,0,0,0};
+u8 bitmap_75[] = {0,0,254,254,254,0,0,0,128,224,240,124,30,6,2,0,0,0,0,0,255,255,255,6,6,6,31,127,248,224,128,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,1,7,15,14,8,0,0,0};
+u8 bitmap_76[] = {0,0,0,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_77[] = {0,0,254,254,14,248,192,0,0,224,124,230,254,254,0,0,0,0,0,0,255,255,0,0,7,14,15,3,0,255,255,255,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,15,15,15,0,0,0,0};
+u8 bitmap_78[] = {0,0,254,254,14,124,240,128,0,0,0,254,254,0,0,0,0,0,0,0,255,255,0,0,3,15,126,240,128,255,255,0,0,0,0,0,0,0,15,15,0,0,0,0,0,3,15,15,15,0,0,0,0,0};
+u8 bitmap_79[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_80[] = {0,0,254,254,254,6,6,6,6,6,14,28,252,248,0,0,0,0,0,0,255,255,255,12,12,12,12,12,14,7,7,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_81[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,62,254,231,131,0,0,0,0,0};
+u8 bitmap_82[] = {0,0,254,254,254,6,6,6,6,6,14,188,248,240,0,0,0,0,0,0,255,255,255,12,12,12,28,252,254,199,3,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,3,15,15,12,0,0,0,0};
+u8 bitmap_83[] = {0,0,96,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,7,6,14,12,28,248,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,12,14,7,3,1,0,0,0,0};
+u8 bitmap_84[] = {0,6,6,6,6,6,6,254,254,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
+u8 bitmap_85[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_86[] = {0,2,62,254,224,0,0,0,0,0,128,248,254,30,0,0,0,0,0,0,0,3,63,254,224,0,128,248,255,15,0,0,0,0,0,0,0,0,0,0,0,3,15,14,15,15,0,0,0,0,0,0,0,0};
+u8 bitmap_87[] = {0,254,254,0,0,0,252,62,254,224,0,0,240,254,62,0,0,0,0,3,255,255,0,252,63,0,1,255,224,0,255,255,0,0,0,0,0,0,15,15,8,15,0,0,0,3,15,15,15,0,0,0,0,0};
+u8 bitmap_88[] = {0,2,6,30,124,240,192,0,128,224,248,62,14,2,0,0,0,0,0,0,0,0,192,241,127,31,63,249,224,192,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,1,7,15,12,8,0,0,0};
+u8 bitmap_89[] = {0,6,30,124,240,192,0,0,0,128,224,248,62,14,2,0,0,0,0,0,0,0,1,7,31,252,252,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
+u8 bitmap_90[] = {0,0,6,6,6,6,6,6,134,230,246,62,14,0,0,0,0,0,0,0,0,0,192,240,124,30,7,1,0,0,0,0,0,0,0,0,0,0,14,15,15,12,12,12,12,12,12,12,12,0,0,0,0,0};
+u8 bitmap_91[] = {0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,63,48,48,48,48,0,0,0,0,0,0};
+u8 bitmap_92[] = {0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,126,112,64,0,0,0,0};
+u8 bitmap_93[] = {0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,48,48,48,48,63,63,0,0,0,0,0,0,0,0};
+u8 bitmap_94[] = {0,0,0,0,224,248,62,7,15,60,240,192,0,0,0,0,0,0,0,0,4,7,3,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_95[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0};
+u8 bitmap_96[] = {0,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_97[] = {0,0,0,192,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,225,241,57,24,24,24,24,24,24,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,6,3,15,15,0,0,0,0,0};
+u8 bitmap_98[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,15,15,15,6,12,12,12,14,14,7,3,0,0,0,0,0};
+u8 bitmap_99[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,131,131,130,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_100[] = {0,0,0,192,192,224,96,96,96,192,128,254,254,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,1,7,7,14,12,12,12,6,3,15,15,0,0,0,0,0};
+u8 bitmap_101[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,255,255,155,24,24,24,24,24,24,31,31,28,0,0,0,0,0,0,1,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_102[] = {0,0,128,128,128,128,252,254,142,134,134,134,134,134,0,0,0,0,0,0,1,1,1,1,255,255,1,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_103[] = {0,0,0,192,192,224,96,96,96,192,128,224,224,0,0,0,0,0,0,0,255,255,129,0,0,0,0,0,129,255,255,0,0,0,0,0,0,0,0,3,135,135,134,134,134,194,225,255,127,0,0,0,0,0};
+u8 bitmap_104[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_105[] = {0,0,0,96,96,96,98,103,231,231,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0};
+u8 bitmap_106[] = {0,0,0,96,96,96,96,96,103,231,231,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,128,128,128,128,128,192,224,127,63,0,0,0,0,0,0,0};
+u8 bitmap_107[] = {0,0,254,254,254,0,0,0,0,0,128,192,224,96,32,0,0,0,0,0,255,255,255,48,48,48,124,254,199,3,0,0,0,0,0,0,0,0,15,15,15,0,0,0,0,1,3,7,14,12,8,0,0,0};
+u8 bitmap_108[] = {0,6,6,6,6,6,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,7,14,12,12,12,12,12,0,0,0,0};
+u8 bitmap_109[] = {0,0,224,224,64,96,224,192,0,192,96,224,224,192,0,0,0,0,0,0,255,255,0,0,0,255,255,0,0,0,255,255,0,0,0,0,0,0,15,15,0,0,0,15,15,0,0,0,15,15,0,0,0,0};
+u8 bitmap_110[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_111[] = {0,0,0,128,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_112[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,255,255,255,6,12,12,12,14,14,7,3,0,0,0,0,0};
+u8 bitmap_113[] = {0,0,0,128,192,224,96,96,96,192,128,224,224,224,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,6,2,255,255,255,0,0,0,0};
+u8 bitmap_114[] = {0,0,0,224,224,128,192,96,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,1,0,0,0,0,0,1,7,7,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_115[] = {0,0,0,192,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,3,15,31,24,24,24,56,48,48,241,225,0,0,0,0,0,0,0,3,7,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_116[] = {0,0,96,96,96,96,254,254,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,7,14,12,12,12,12,0,0,0,0,0};
+u8 bitmap_117[] = {0,0,224,224,224,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
+u8 bitmap_118[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,63,252,224,0,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,1,15,15,15,7,0,0,0,0,0,0,0,0};
+u8 bitmap_119[] = {0,224,224,0,0,0,192,224,224,0,0,0,128,224,96,0,0,0,0,3,255,252,0,224,255,1,15,254,0,128,255,127,0,0,0,0,0,0,3,15,8,15,0,0,0,7,15,15,15,0,0,0,0,0};
+u8 bitmap_120[] = {0,0,32,224,224,128,0,0,0,0,192,224,96,32,0,0,0,0,0,0,0,0,129,199,255,124,126,239,195,1,0,0,0,0,0,0,0,8,12,14,7,3,0,0,0,1,3,15,14,8,0,0,0,0};
+u8 bitmap_121[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,31,254,240,128,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,128,243,255,63,7,0,0,0,0,0,0,0,0};
+u8 bitmap_122[] = {0,0,96,96,96,96,96,96,96,96,96,224,224,0,0,0,0,0,0,0,0,0,192,224,112,56,28,14,7,3,1,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_123[] = {0,0,0,0,0,0,0,135,255,255,0,0,0,0,0,0,0,0,0,0,3,3,3,3,3,7,253,248,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,31,31,56,48,48,0,0,0,0,0};
+u8 bitmap_124[] = {0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,127,127,0,0,0,0,0,0,0,0,0};
+u8 bitmap_125[] = {0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,252,255,7,3,3,3,3,0,0,0,0,0,0,0,48,48,48,56,31,15,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_126[] = {0,0,0,128,128,128,128,0,0,0,0,0,128,128,0,0,0,0,0,0,15,15,1,1,3,7,14,12,12,14,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 *char_addr[] = {bitmap_32,bitmap_33,bitmap_34,bitmap_35,bitmap_36,bitmap_37,bitmap_38,bitmap_39,bitmap_40,bitmap_41,bitmap_42,bitmap_43,bitmap_44,bitmap_45,bitmap_46,bitmap_47,bitmap_48,bitmap_49,bitmap_50,bitmap_51,bitmap_52,bitmap_53,bitmap_54,bitmap_55,bitmap_56,bitmap_57,bitmap_58,bitmap_59,bitmap_60,bitmap_61,bitmap_62,bitmap_63,bitmap_64,bitmap_65,bitmap_66,bitmap_67,bitmap_68,bitmap_69,bitmap_70,bitmap_71,bitmap_72,bitmap_73,bitmap_74,bitmap_75,bitmap_76,bitmap_77,bitmap_78,bitmap_79,bitmap_80,bitmap_81,bitmap_82,bitmap_83,bitmap_84,bitmap_85,bitmap_86,bitmap_87,bitmap_88,bitmap_89,bitmap_90,bitmap_91,bitmap_92,bitmap_93,bitmap_94,bitmap_95,bitmap_96,bitmap_97,bitmap_98,bitmap_99,bitmap_100,bitmap_101,bitmap_102,bitmap_103,bitmap_104,bitmap_105,bitmap_106,bitmap_107,bitmap_108,bitmap_109,bitmap_110,bitmap_111,bitmap_112,bitmap_113,bitmap_114,bitmap_115,bitmap_116,bitmap_117,bitmap_118,bitmap_119,bitmap_120,bitmap_121,bitmap_122,bitmap_123,bitmap_124,bitmap_125,bitmap_126};
+
+
+void _replayText(const DrawCommand &command, const Canvas &canvas);
 
+// Records the text along with the command, as a copy, bounded by its lines (which get cut off at the right edge):
+void _recordText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    i32 columns = 0, max_columns = 0, lines = 1;
+    u32 length = 0;
+    for (char *character = str; *character; character++, length++) {
+        if (*character == '\n') {
+            lines++;
+            columns = 0;
+        } else {
+            columns += *character == '\t' ? 4 : 1;
+            if (columns > max_columns) max_columns = columns;
+        }
+    }
 
-void _drawRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
-    if (viewport_bounds) {
-        bounds -= *viewport_bounds;
-        rect.x_range += viewport_bounds->left;
-        rect.y_range += viewport_bounds->top;
+    RectI bounds{x - FONT_WIDTH, x + (max_columns + 1) * FONT_WIDTH, y - FONT_HEIGHT, y + lines * LINE_HEIGHT + FONT_HEIGHT};
+    DrawCommand *command = canvas.record(_replayText, bounds, color, opacity, viewport_bounds, 0, length + 1);
+    if (command) {
+        command->integers[0] = x;
+        command->integers[1] = y;
+        char *text = command->getPayload();
+        for (u32 i = 0; i <= length; i++) text[i] = str[i];
     }
-    if (rect.isOutsideOf(bounds))
-        return;
+}
 
-    const bool draw_top = bounds.y_range[rect.top];
-    const bool draw_bottom = bounds.y_range[rect.bottom];
-    const bool draw_left = bounds.x_range[rect.left];
-    const bool draw_right = bounds.x_range[rect.right];
+// Draws the glyphs of the text within the given bounds, specialized on the anti-aliasing mode:
+template <AntiAliasing AA>
+void _rasterizeText(char *str, i32 x, i32 y, const RectI &bounds, const Canvas &canvas, const Color &color, f32 opacity) {
+    f32 pixel_opacity;
+    u16 current_x = (u16)x;
+    u16 current_y = (u16)y;
+    u16 pixel_x, sub_pixel_x;
+    u16 pixel_y, sub_pixel_y;
+    u16 t_offset;
+    u8 *byte_ptr, byte, next_column_byte;
+    char character = *str;
+    while (character) {
+        if (character == '\n') {
+            if (current_y > bounds.bottom)
+                break;
 
-    const bool draw_horizontal = draw_top || draw_bottom;
-    const bool draw_vertical = draw_left || draw_right;
-    if (!(draw_horizontal || draw_vertical))
-        return;
+            current_x = (u16)x;
+            current_y += LINE_HEIGHT;
+        } else if (character == '\t') {
+            t_offset = FONT_WIDTH * (4 - ((current_x / FONT_WIDTH) & 3));
+            current_x += t_offset;
+        } else if ((character >= FIRST_CHARACTER_CODE) &&
+                   (character <= LAST_CHARACTER_CODE)) {
+            byte_ptr = char_addr[character - FIRST_CHARACTER_CODE];
+            byte = *byte_ptr;
+            next_column_byte = *(byte_ptr + 1);
+            // Characters entirely outside of the clip bounds are skipped (positions left/above the canvas wrap around):
+            bool is_clipped = canvas.clip_bounds && (
+                    (i16)current_x > canvas.clip_bounds->right || (i16)current_x + FONT_WIDTH < canvas.clip_bounds->left ||
+                    (i16)current_y > canvas.clip_bounds->bottom || (i16)current_y + FONT_HEIGHT < canvas.clip_bounds->top);
+            for (int i = 1; i < 4 && !is_clipped; i++) {
+                pixel_x = current_x;
+                pixel_y = current_y + i * FONT_HEIGHT / 3;
+                for (int w = 0; w < INTERNAL_FONT_WIDTH ; w += 2) {
+                    for (int h = 0; h < 8; h += 2) {
+                        /* skip background bits */
+                        if (bounds.contains(pixel_x, pixel_y)) {
+                            if (AA == SSAA) {
+                                sub_pixel_x = pixel_x << 1;
+                                sub_pixel_y = pixel_y << 1;
 
-    rect = bounds - rect;
-    if (!rect)
-        return;
+                                if (byte & (0x80 >> h)) canvas.setPixel<AA>(sub_pixel_x, sub_pixel_y + 1, color, opacity);
+                                if (byte & (0x80 >> (h+1))) canvas.setPixel<AA>(sub_pixel_x, sub_pixel_y, color, opacity);
+                                if (next_column_byte & (0x80 >> h)) canvas.setPixel<AA>(sub_pixel_x+1, sub_pixel_y + 1, color, opacity);
+                                if (next_column_byte & (0x80 >> (h+1))) canvas.setPixel<AA>(sub_pixel_x+1, sub_pixel_y, color, opacity);
+                            } else {
+                                pixel_opacity = (byte & (0x80 >> h)) ? 0.25f : 0;
+                                if (byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
+                                if (next_column_byte & (0x80 >> h)) pixel_opacity += 0.25f;
+                                if (next_column_byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
+                                if (pixel_opacity != 0.0f) canvas.setPixel<AA>(pixel_x, pixel_y, color, pixel_opacity);
+                            }
+                        }
 
-    if (canvas.antialias == SSAA) {
-        rect *= 2;
-
-        if (draw_horizontal) {
-            for (i32 x = rect.left; x <= rect.right; x += 2) {
-                if (draw_bottom) {
-                    canvas.setPixel(x, rect.bottom, color, opacity);
-                    canvas.setPixel(x+1, rect.bottom, color, opacity);
-                    canvas.setPixel(x, rect.bottom+1, color, opacity);
-                    canvas.setPixel(x+1, rect.bottom+1, color, opacity);
-                }
-                if (draw_top) {
-                    canvas.setPixel(x, rect.top, color, opacity);
-                    canvas.setPixel(x+1, rect.top, color, opacity);
-                    canvas.setPixel(x, rect.top+1, color, opacity);
-                    canvas.setPixel(x+1, rect.top+1, color, opacity);
-                }
-            }
-        }
+                        pixel_y--;
+                    }
+                    byte_ptr += 2;
+                    byte = *byte_ptr;
+                    next_column_byte = *(byte_ptr + 1);
 
-        if (draw_vertical) {
-            for (i32 y = rect.top; y <= rect.bottom; y += 2) {
-                if (draw_left) {
-                    canvas.setPixel(rect.left, y, color, opacity);
-                    canvas.setPixel(rect.left+1, y, color, opacity);
-                    canvas.setPixel(rect.left, y+1, color, opacity);
-                    canvas.setPixel(rect.left+1, y+1, color, opacity);
-                }
-                if (draw_right) {
-                    canvas.setPixel(rect.right, y, color, opacity);
-                    canvas.setPixel(rect.right+1, y, color, opacity);
-                    canvas.setPixel(rect.right, y+1, color, opacity);
-                    canvas.setPixel(rect.right+1, y+1, color, opacity);
-                }
-            }
-        }
-    } else {
-        if (draw_horizontal) {
-            for (i32 x = rect.left; x <= rect.right; x++) {
-                if (draw_bottom) canvas.setPixel(x, rect.bottom, color, opacity);
-                if (draw_top) canvas.setPixel(x, rect.top, color, opacity);
+                    pixel_y += FONT_HEIGHT / 3;
+                    pixel_x++;
+                }
             }
-        }
 
-        if (draw_vertical) {
-            for (i32 y = rect.top; y <= rect.bottom; y++) {
-                if (draw_right) canvas.setPixel(rect.right, y, color, opacity);
-                if (draw_left) canvas.setPixel(rect.left, y, color, opacity);
+            current_x += FONT_WIDTH;
+            if (current_x > bounds.right) {
+                if (current_y > bounds.bottom)
+                    break;
+
+                while (character && (character != '\n')) character = *++str;
+                if (!character)
+                    break;
+
+                current_x = (u16)x;
+                current_y += LINE_HEIGHT;
             }
         }
+        character = *++str;
     }
 }
 
-void _fillRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        _recordText(str, x, y, canvas, color, opacity, viewport_bounds);
+        return;
+    }
+
+    RectI bounds{
+        0, canvas.dimensions.width - 1,
+        0, canvas.dimensions.height - 1
+    };
     if (viewport_bounds) {
+        x += viewport_bounds->left;
+        y += viewport_bounds->top;
         bounds -= *viewport_bounds;
-        rect.x_range += viewport_bounds->left;
-        rect.y_range += viewport_bounds->top;
     }
-    if (rect.isOutsideOf(bounds))
-        return;
 
-    rect = bounds - rect;
-    if (!rect)
+    if (x + FONT_WIDTH < bounds.left || x - FONT_WIDTH > bounds.right ||
+        y + FONT_HEIGHT < bounds.top || y - FONT_HEIGHT > bounds.bottom)
         return;
 
-    if (canvas.antialias == SSAA) {
-        rect *= 2;
-
-        for (i32 y = rect.top; y <= rect.bottom; y += 2) {
-            for (i32 x = rect.left; x <= rect.right; x += 2) {
-                canvas.setPixel(x, y, color, opacity);
-                canvas.setPixel(x+1, y, color, opacity);
-                canvas.setPixel(x, y+1, color, opacity);
-                canvas.setPixel(x+1, y+1, color, opacity);
-            }
-        }
-    } else
-        for (i32 y = rect.top; y <= rect.bottom; y++)
-            for (i32 x = rect.left; x <= rect.right; x++)
-                canvas.setPixel(x, y, color, opacity);
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeText<NoAA>(str, x, y, bounds, canvas, color, opacity); break;
+        case MSAA: _rasterizeText<MSAA>(str, x, y, bounds, canvas, color, opacity); break;
+        case SSAA: _rasterizeText<SSAA>(str, x, y, bounds, canvas, color, opacity); break;
+    }
 }
 
-INLINE void Canvas::drawRect(RectI rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawRect(rect, *this, color, opacity, viewport_bounds);
+void _replayText(const DrawCommand &command, const Canvas &canvas) {
+    _drawText(command.getPayload(), command.integers[0], command.integers[1], canvas, command.color, command.opacity, command.getViewportBounds());
 }
 
-INLINE void Canvas::drawRect(Rect rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
-    _drawRect(rectI, *this, color, opacity, viewport_bounds);
+INLINE void Canvas::drawText(char *str, i32 x, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawText(str, x, y, *this, color, opacity, viewport_bounds);
+}
+#ifdef SLIM_VEC2
+INLINE void Canvas::drawText(char *str, vec2i position, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawText(str, position.x, position.y, *this, color, opacity, viewport_bounds);
+}
+INLINE void Canvas::drawText(char *str, vec2 position, const Color &color, f32 opacity, const RectI *viewport_bounds) const  {
+    _drawText(str, (i32)position.x, (i32)position.y, *this, color, opacity, viewport_bounds);
 }
+#endif
 
-INLINE void Canvas::fillRect(RectI rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _fillRect(rect, *this, color, opacity, viewport_bounds);
+
+INLINE void drawText(char *str, i32 x, i32 y, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawText(str, x, y, canvas, color, opacity, viewport_bounds);
 }
 
-INLINE void Canvas::fillRect(Rect rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
-    _fillRect(rectI, *this, color, opacity, viewport_bounds);
+#ifdef SLIM_VEC2
+INLINE void drawText(char *str, vec2i position, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawText(str, position.x, position.y, canvas, color, opacity, viewport_bounds);
 }
+INLINE void drawText(char *str, vec2 position, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawText(str, (i32)position.x, (i32)position.y, canvas, color, opacity, viewport_bounds);
+}
+#endif
 
-INLINE void drawRect(RectI rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawRect(rect, canvas, color, opacity, viewport_bounds);
+void _drawNumber(i32 number, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    static NumberString number_string;
+    number_string = number;
+    _drawText(number_string.string.char_ptr, x - (i32)number_string.string.length * FONT_WIDTH, y, canvas, color, opacity, viewport_bounds);
 }
 
-INLINE void drawRect(Rect rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
-    _drawRect(rectI, canvas, color, opacity, viewport_bounds);
+INLINE void Canvas::drawNumber(i32 number, i32 x, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawNumber(number, x, y, *this, color, opacity, viewport_bounds);
+}
+
+#ifdef SLIM_VEC2
+INLINE void Canvas::drawNumber(i32 number, vec2i position, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawNumber(number, position.x, position.y, *this, color, opacity, viewport_bounds);
 }
+INLINE void Canvas::drawNumber(i32 number, vec2 position, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    _drawNumber(number, (i32)position.x, (i32)position.y, *this, color, opacity, viewport_bounds);
+}
+#endif
 
 
-INLINE void fillRect(RectI rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _fillRect(rect, canvas, color, opacity, viewport_bounds);
+INLINE void drawNumber(i32 number, i32 x, i32 y, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawNumber(number, x, y, canvas, color, opacity, viewport_bounds);
 }
 
-INLINE void fillRect(Rect rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
-    _fillRect(rectI, canvas, color, opacity, viewport_bounds);
+#ifdef SLIM_VEC2
+INLINE void drawNumber(i32 number, vec2i position, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawNumber(number, position.x, position.y, canvas, color, opacity, viewport_bounds);
+}
+INLINE void drawNumber(i32 number, vec2 position, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawNumber(number, (i32)position.x, (i32)position.y, canvas, color, opacity, viewport_bounds);
 }
+#endif
 
 
+void drawHUD(const HUD &hud, const Canvas &canvas, const RectI *viewport_bounds = nullptr) {
+    i32 x = hud.left;
+    i32 y = hud.top;
 
-void _paintCircle(bool fill, i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
-                  const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
-    RectI rect{center_x - radius,
-               center_x + radius,
-               center_y - radius,
-               center_y + radius};
-    if (viewport_bounds) {
-        center_x += viewport_bounds->left;
-        center_y += viewport_bounds->top;
-        rect.x_range += viewport_bounds->left;
-        rect.y_range += viewport_bounds->top;
-        rect -= *viewport_bounds;
-        bounds -= *viewport_bounds;
+    HUDLine *line = hud.lines;
+    bool alt;
+    for (u32 i = 0; i < hud.settings.line_count; i++, line++) {
+        if (line->use_alternate) {
+            alt = *line->use_alternate;
+            if (line->invert_alternate_use)
+                alt = !alt;
+        } else
+            alt = false;
+
+        ColorID color = alt ? line->alternate_value_color : line->value_color;
+        char *text = alt ? line->alternate_value.char_ptr : line->value.string.char_ptr;
+        _drawText(line->title.char_ptr, x, y, canvas, line->title_color, 1.0f, viewport_bounds);
+        _drawText(text, x + (i32)line->title.length * FONT_WIDTH, y, canvas, color, 1.0f, viewport_bounds);
+        y += (i32)(hud.settings.line_height * (f32)FONT_HEIGHT);
     }
-    rect -= bounds;
-    if (!rect)
-        return;
+}
 
-    if (radius <= 1) {
-        if (canvas.antialias == SSAA) {
-            center_x *= 2;
-            center_y *= 2;
-            canvas.setPixel(center_x, center_y, color, opacity);
-            canvas.setPixel(center_x+1, center_y, color, opacity);
-            canvas.setPixel(center_x, center_y+1, color, opacity);
-            canvas.setPixel(center_x+1, center_y+1, color, opacity);
-        } else
-            canvas.setPixel(center_x, center_y, color, opacity);
 
-        return;
+// Drawing images and textures through affine transforms (scaled, rotated, skewed or flipped), with nearest or bilinear filtering.
+// Each row of canvas pixels gets mapped back into the source (its pixel centers stepping by a constant offset in the source),
+// clipped to the run of pixels whose centers land within the source, then sampled a packet of pixels at a time.
+
+enum ImageFilter {
+    ImageFilterNearest,
+    ImageFilterBilinear
+};
+
+// How the texels of a source are laid out in memory:
+enum BlitFormat {
+    BlitFormatByteColors, // ByteColor
+    BlitFormatRGB,        // 3 floats
+    BlitFormatRGBA,       // 4 floats (as in Pixel)
+    BlitFormatTexelQuads, // TexelQuad (of a TextureMip, holding each texel along with the ones above and to the left of it)
+    BlitFormatTiledTexelQuads // TexelQuad in 4x4 tiles (of a TextureMip of a texture with tiled mips, see TexelLayout)
+};
+
+// How many pixels of a row get sampled at a time, how many rows a job draws, and how many pixels a blit needs for drawing it with jobs:
+#define BLIT_SPAN_SIZE 128
+#define BLIT_BAND_HEIGHT 16
+#define BLIT_PARALLEL_MIN_PIXELS (CANVAS_TILE_SIZE * CANVAS_TILE_SIZE)
+
+struct ImageBlit {
+    const void *content{nullptr};
+    i32 width{0};
+    i32 height{0};
+    i32 stride{0}; // In texels (or texel quads)
+    i32 tile_width{0}; // Of tiled images, which get sampled a texel at a time (0 for the rest)
+    i32 tile_height{0};
+    i32 quad_x{0}; // Where tiled texel quads start within their mip (sub-images of those can't start at an offset pointer)
+    i32 quad_y{0};
+    BlitFormat format{BlitFormatRGBA};
+    ImageFilter filter{ImageFilterBilinear};
+    bool has_alpha{false};
+    f32 opacity{1.0f};
+    Color tint{1.0f, 1.0f, 1.0f}; // Multiplies the sampled colors
+
+    // Where in the source (in texels) the center of canvas pixel (0, 0) lands, and how far it moves per pixel to the right and down:
+    vec2 origin;
+    vec2 step_x;
+    vec2 step_y;
+
+    // The canvas pixels that may get drawn into (within the canvas and its clip bounds):
+    RectI bounds;
+
+    ImageBlit() = default;
+
+    ImageBlit(const ImageInfo &image, const void *content, BlitFormat format, ImageFilter filter, f32 opacity = 1.0f) :
+            content{content},
+            width{(i32)image.width},
+            height{(i32)image.height},
+            stride{(i32)(image.stride ? image.stride : image.width)},
+            tile_width{image.flags.tile ? (i32)image.tile_width : 0},
+            tile_height{image.flags.tile ? (i32)image.tile_height : 0},
+            format{format},
+            filter{filter},
+            has_alpha{format == BlitFormatRGB ? false : (bool)image.flags.alpha},
+            opacity{clampedValue(opacity)} {}
+
+    ImageBlit(const TextureMip &texture_mip, ImageFilter filter, f32 opacity = 1.0f, TexelLayout layout = TexelLayoutRows) :
+            content{texture_mip.texel_quads},
+            width{(i32)texture_mip.width},
+            height{(i32)texture_mip.height},
+            stride{(i32)texture_mip.width + 1},
+            format{layout == TexelLayoutTiles ? BlitFormatTiledTexelQuads : BlitFormatTexelQuads},
+            filter{filter},
+            opacity{clampedValue(opacity)} {}
+
+    // Maps the source onto the canvas through a transform from source texels to canvas pixels (then translated).
+    // Returns false when nothing would get drawn:
+    bool map(const mat2 &transform, const vec2 &translation, const Canvas &canvas) {
+        if (!content || width <= 0 || height <= 0 || opacity == 0.0f || !transform.has_inverse())
+            return false;
+
+        mat2 inverse = transform.inverted();
+        step_x = inverse.X;
+        step_y = inverse.Y;
+        origin = inverse * (vec2{0.5f, 0.5f} - translation);
+
+        // The bounding box of the transformed source (clamped to around the canvas first, as it may be far larger):
+        vec2 corners[4] = {
+                translation,
+                transform.X * (f32)width + translation,
+                transform.Y * (f32)height + translation,
+                transform * vec2{(f32)width, (f32)height} + translation
+        };
+        Rect box{corners[0].x, corners[0].x, corners[0].y, corners[0].y};
+        for (const vec2 &corner : corners) {
+            if (corner.x < box.left) box.left = corner.x;
+            if (corner.x > box.right) box.right = corner.x;
+            if (corner.y < box.top) box.top = corner.y;
+            if (corner.y > box.bottom) box.bottom = corner.y;
+        }
+        const f32 canvas_width = (f32)canvas.dimensions.width;
+        const f32 canvas_height = (f32)canvas.dimensions.height;
+        bounds.left   = (i32)floorf(clampedValue(box.left,   -1.0f, canvas_width));
+        bounds.right  = (i32)ceilf( clampedValue(box.right,  -1.0f, canvas_width));
+        bounds.top    = (i32)floorf(clampedValue(box.top,    -1.0f, canvas_height));
+        bounds.bottom = (i32)ceilf( clampedValue(box.bottom, -1.0f, canvas_height));
+        bounds -= RectI{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+        if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+
+        return !!bounds;
     }
 
-    if (canvas.antialias == SSAA) {
-        center_x *= 2;
-        center_y *= 2;
-        radius *= 2;
-        bounds *= 2;
+    // Where in the source the center of the pixel at column 0 of a row lands:
+    INLINE vec2 rowStart(i32 y) const {
+        return origin + step_y * (f32)y;
     }
 
-    i32 x = radius, y = 0, y2 = 0;
-    i32 r2 = radius * radius;
-    i32 x2 = r2;
+    INLINE bool covers(const vec2 &row_start, i32 x) const {
+        vec2 position = row_start + step_x * (f32)x;
+        return position.x >= 0 && position.x < (f32)width &&
+               position.y >= 0 && position.y < (f32)height;
+    }
 
-    RangeI x_range1{center_x - radius, center_x + radius};
-    RangeI y_range2{center_y - radius, center_y + radius};
-    RangeI y_range1{center_y, center_y};
-    RangeI x_range2{center_x, center_x};
-    RangeI range1, range2;
-    i32 i;
+    // Narrows the given range of columns to the pixels of a row whose centers land within the source.
+    // These are found along each axis by where the row crosses the edges of the source, then settled by testing the pixels
+    // at the ends (as the divisions round, while the pixels within the source make for a single run):
+    void clipRow(const vec2 &row_start, i32 &first, i32 &last) const {
+        const i32 left = first;
+        const i32 right = last;
+        _clipRowAlong(row_start.x, step_x.x, (f32)width, first, last);
+        _clipRowAlong(row_start.y, step_x.y, (f32)height, first, last);
 
-    while (y <= x) {
-        if (fill) {
-            range1 = bounds.x_range - x_range1;
-            range2 = bounds.x_range - x_range2;
-            if (bounds.y_range[y_range1.first]) for (i = range1.first; i <= range1.last; i++) canvas.setPixel(i, y_range1.first, color, opacity);
-            if (bounds.y_range[y_range1.last])  for (i = range1.first; i <= range1.last; i++) canvas.setPixel(i, y_range1.last , color, opacity);
-            if (bounds.y_range[y_range2.first]) for (i = range2.first; i <= range2.last; i++) canvas.setPixel(i, y_range2.first, color, opacity);
-            if (bounds.y_range[y_range2.last])  for (i = range2.first; i <= range2.last; i++) canvas.setPixel(i, y_range2.last , color, opacity);
-        } else {
-            if (bounds.y_range[y_range1.first]) {
-                if (bounds.x_range[x_range1.first]) canvas.setPixel(x_range1.first, y_range1.first, color, opacity);
-                if (bounds.x_range[x_range1.last ]) canvas.setPixel(x_range1.last,  y_range1.first, color, opacity);
-            }
-            if (bounds.y_range[y_range1.last]) {
-                if (bounds.x_range[x_range1.first]) canvas.setPixel(x_range1.first, y_range1.last, color, opacity);
-                if (bounds.x_range[x_range1.last ]) canvas.setPixel(x_range1.last,  y_range1.last, color, opacity);
-            }
+        while (first <= last && !covers(row_start, first)) first++;
+        while (first <= last && !covers(row_start, last)) last--;
+        if (first > last) return;
 
-            if (bounds.y_range[y_range2.first]) {
-                if (bounds.x_range[x_range2.first]) canvas.setPixel(x_range2.first, y_range2.first, color, opacity);
-                if (bounds.x_range[x_range2.last ]) canvas.setPixel(x_range2.last,  y_range2.first, color, opacity);
-            }
-            if (bounds.y_range[y_range2.last]) {
-                if (bounds.x_range[x_range2.first]) canvas.setPixel(x_range2.first, y_range2.last, color, opacity);
-                if (bounds.x_range[x_range2.last ]) canvas.setPixel(x_range2.last,  y_range2.last, color, opacity);
-            }
-        }
+        while (first > left && covers(row_start, first - 1)) first--;
+        while (last < right && covers(row_start, last + 1)) last++;
+    }
 
-        if ((x2 + y2) > r2) {
-            x--;
-            x2 = x * x;
+    static INLINE void _clipRowAlong(f32 start, f32 step, f32 end, i32 &first, i32 &last) {
+        if (step == 0) {
+            if (!(start >= 0 && start < end)) last = first - 1;
+            return;
+        }
 
-            x_range1.first++;
-            y_range2.first++;
-            x_range1.last--;
-            y_range2.last--;
+        // The columns at which the row crosses 0 and the end, kept around the range so as to convert them safely:
+        const f32 from = (f32)first - 1;
+        const f32 to = (f32)last + 1;
+        const f32 at_start = clampedValue(-start / step, from, to);
+        const f32 at_end = clampedValue((end - start) / step, from, to);
+        i32 inside_first, inside_last;
+        if (step > 0) { // Within from the start crossing on, up to the end crossing
+            inside_first = (i32)ceilf(at_start);
+            inside_last = (i32)ceilf(at_end) - 1;
+        } else { // Within after the end crossing, up to the start crossing
+            inside_first = (i32)floorf(at_end) + 1;
+            inside_last = (i32)floorf(at_start);
         }
+        if (inside_first > first) first = inside_first;
+        if (inside_last < last) last = inside_last;
+    }
+};
 
-        y++;
-        y2 = y * y;
+// A run of sampled pixels, as the canvas stores them (see Canvas::toPixel()) with their components in separate arrays:
+struct BlitSpan {
+    f32 reds[BLIT_SPAN_SIZE];
+    f32 greens[BLIT_SPAN_SIZE];
+    f32 blues[BLIT_SPAN_SIZE];
+    f32 opacities[BLIT_SPAN_SIZE];
+};
 
-        y_range1.first--;
-        x_range2.first--;
-        y_range1.last++;
-        x_range2.last++;
+// A texel of a source as a color and an opacity (not premultiplied):
+INLINE void _fetchBlitTexel(const ImageBlit &blit, i32 x, i32 y, f32 *texel) {
+    i32 offset = y * blit.stride + x;
+    if (blit.tile_width) { // Tiles are stored one after the other, with the ones in the last column and row cut short:
+        i32 column = x / blit.tile_width;
+        i32 row = y / blit.tile_height;
+        i32 right_tile_width = blit.stride % blit.tile_width;
+        i32 bottom_tile_height = blit.height % blit.tile_height;
+        i32 tile_width = (column == (blit.width - 1) / blit.tile_width && right_tile_width) ? right_tile_width : blit.tile_width;
+        i32 tile_height = (row == (blit.height - 1) / blit.tile_height && bottom_tile_height) ? bottom_tile_height : blit.tile_height;
+        offset = row * blit.stride * blit.tile_height + column * blit.tile_width * tile_height +
+                 (y - row * blit.tile_height) * tile_width + (x - column * blit.tile_width);
+    }
+
+    if (blit.format == BlitFormatByteColors) {
+        ByteColor byte_color = ((const ByteColor*)blit.content)[offset];
+        texel[0] = (f32)byte_color.R * COLOR_COMPONENT_TO_FLOAT;
+        texel[1] = (f32)byte_color.G * COLOR_COMPONENT_TO_FLOAT;
+        texel[2] = (f32)byte_color.B * COLOR_COMPONENT_TO_FLOAT;
+        texel[3] = blit.has_alpha ? (f32)byte_color.A * COLOR_COMPONENT_TO_FLOAT : 1.0f;
+    } else {
+        const f32 *channels = (const f32*)blit.content + offset * (blit.format == BlitFormatRGB ? 3 : 4);
+        texel[0] = channels[0];
+        texel[1] = channels[1];
+        texel[2] = channels[2];
+        texel[3] = blit.has_alpha ? channels[3] : 1.0f;
     }
 }
 
-INLINE void Canvas::fillCircle(i32 center_x, i32 center_y, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _paintCircle(true, center_x, center_y, radius, *this, color, opacity, viewport_bounds);
-}
+INLINE const TexelQuad& _blitTexelQuad(const ImageBlit &blit, i32 x, i32 y) {
+    const TexelQuad *texel_quads = (const TexelQuad*)blit.content;
+    if (blit.format == BlitFormatTiledTexelQuads)
+        return texel_quads[TextureMip::GetQuadIndex<TexelLayoutTiles>(x + blit.quad_x, y + blit.quad_y, blit.stride)];
 
-INLINE void Canvas::drawCircle(i32 center_x, i32 center_y, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _paintCircle(false, center_x, center_y, radius, *this, color, opacity, viewport_bounds);
+    return texel_quads[y * blit.stride + x];
 }
 
-#ifdef SLIM_VEC2
-INLINE void Canvas::drawCircle(vec2i center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _paintCircle(false, center.x, center.y, radius, *this, color, opacity, viewport_bounds);
-}
+// Samples a source at a position (in texels), clamping to its edges. Bilinear filtering weighs colors by their opacities:
+INLINE void _sampleBlitTexel(const ImageBlit &blit, vec2 position, f32 *texel) {
+    const f32 max_x = (f32)(blit.width - 1);
+    const f32 max_y = (f32)(blit.height - 1);
+    if (blit.format == BlitFormatTexelQuads || blit.format == BlitFormatTiledTexelQuads) {
+        if (blit.filter == ImageFilterNearest) {
+            const TexelQuad &texel_quad = _blitTexelQuad(blit, (i32)clampedValue(position.x, 0.0f, max_x), (i32)clampedValue(position.y, 0.0f, max_y));
+            texel[0] = (f32)texel_quad.R.BR * COLOR_COMPONENT_TO_FLOAT;
+            texel[1] = (f32)texel_quad.G.BR * COLOR_COMPONENT_TO_FLOAT;
+            texel[2] = (f32)texel_quad.B.BR * COLOR_COMPONENT_TO_FLOAT;
+        } else {
+            // Quads are offset by half a texel, so that the 4 texels around a position are all in one of them:
+            const f32 U = position.x + 0.5f;
+            const f32 V = position.y + 0.5f;
+            const f32 left = floorf(U);
+            const f32 top = floorf(V);
+            const f32 r = U - left;
+            const f32 b = V - top;
+            const f32 l = 1.0f - r;
+            const f32 t = 1.0f - b;
+            const f32 tl = t * l, tr = t * r, bl = b * l, br = b * r;
+            const TexelQuad &texel_quad = _blitTexelQuad(blit, (i32)clampedValue(left, 0.0f, (f32)blit.width), (i32)clampedValue(top, 0.0f, (f32)blit.height));
+            const TexelQuadComponent *components = &texel_quad.R;
+            for (u32 i = 0; i < 3; i++)
+                texel[i] = (((f32)components[i].TL * tl + (f32)components[i].TR * tr) +
+                            ((f32)components[i].BL * bl + (f32)components[i].BR * br)) * COLOR_COMPONENT_TO_FLOAT;
+        }
+        texel[3] = 1.0f;
+        return;
+    }
 
-INLINE void Canvas::fillCircle(vec2i center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _paintCircle(true, center.x, center.y, radius, *this, color, opacity, viewport_bounds);
-}
-INLINE void Canvas::drawCircle(vec2 center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _paintCircle(false, (i32)center.x, (i32)center.y, radius, *this, color, opacity, viewport_bounds);
-}
-INLINE void Canvas::fillCircle(vec2 center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _paintCircle(true, (i32)center.x, (i32)center.y, radius, *this, color, opacity, viewport_bounds);
+    if (blit.filter == ImageFilterNearest) {
+        _fetchBlitTexel(blit, (i32)clampedValue(position.x, 0.0f, max_x), (i32)clampedValue(position.y, 0.0f, max_y), texel);
+        return;
+    }
+
+    const f32 X = position.x - 0.5f;
+    const f32 Y = position.y - 0.5f;
+    const f32 left = floorf(X);
+    const f32 top = floorf(Y);
+    const f32 r = X - left;
+    const f32 b = Y - top;
+    const f32 l = 1.0f - r;
+    const f32 t = 1.0f - b;
+    const i32 x0 = (i32)clampedValue(left, 0.0f, max_x);
+    const i32 x1 = (i32)clampedValue(left + 1.0f, 0.0f, max_x);
+    const i32 y0 = (i32)clampedValue(top, 0.0f, max_y);
+    const i32 y1 = (i32)clampedValue(top + 1.0f, 0.0f, max_y);
+    f32 TL[4], TR[4], BL[4], BR[4];
+    _fetchBlitTexel(blit, x0, y0, TL);
+    _fetchBlitTexel(blit, x1, y0, TR);
+    _fetchBlitTexel(blit, x0, y1, BL);
+    _fetchBlitTexel(blit, x1, y1, BR);
+    f32 tl = t * l, tr = t * r, bl = b * l, br = b * r;
+    if (blit.has_alpha) {
+        tl *= TL[3];
+        tr *= TR[3];
+        bl *= BL[3];
+        br *= BR[3];
+        const f32 opacity = (tl + tr) + (bl + br);
+        for (u32 i = 0; i < 3; i++) {
+            f32 premultiplied = (TL[i] * tl + TR[i] * tr) + (BL[i] * bl + BR[i] * br);
+            texel[i] = opacity > 0 ? premultiplied / opacity : 0.0f;
+        }
+        texel[3] = opacity;
+    } else {
+        for (u32 i = 0; i < 3; i++)
+            texel[i] = (TL[i] * tl + TR[i] * tr) + (BL[i] * bl + BR[i] * br);
+        texel[3] = 1.0f;
+    }
 }
-#endif
 
+// Samples pixels first to count - 1 of a span of a row starting at column x (positioned as in ImageBlit::covers()):
+void _blitSpanScalar(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    f32 texel[4];
+    for (u32 i = first; i < count; i++) {
+        _sampleBlitTexel(blit, row_start + blit.step_x * (f32)(x + (i32)i), texel);
+        f32 opacity = clampedValue(texel[3], 0.0f, 1.0f) * blit.opacity;
+        f32 red = clampedValue(texel[0] * blit.tint.r, 0.0f, 1.0f);
+        f32 green = clampedValue(texel[1] * blit.tint.g, 0.0f, 1.0f);
+        f32 blue = clampedValue(texel[2] * blit.tint.b, 0.0f, 1.0f);
+        span.reds[i] = red * red * opacity;
+        span.greens[i] = green * green * opacity;
+        span.blues[i] = blue * blue * opacity;
+        span.opacities[i] = opacity;
+    }
+}
 
+// The wide kernels do the same operations in the same order as the scalar one, for the same results:
+const f32 blit_lane_offsets[8] = {0, 1, 2, 3, 4, 5, 6, 7};
 
-INLINE void fillCircle(i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
-                       Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _paintCircle(true, center_x, center_y, radius, canvas, color, opacity, viewport_bounds);
+template <typename F32>
+SLIM_INLINE_KERNEL F32 _clampLanes(const F32 &value, const F32 &from, const F32 &to) {
+    return maximum(minimum(value, to), from);
 }
 
-INLINE void drawCircle(i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
-                       Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _paintCircle(false, center_x, center_y, radius, canvas, color, opacity, viewport_bounds);
+// Weighs the 4 texels around each position (as the scalar kernel does, in the same order):
+template <typename F32>
+SLIM_INLINE_KERNEL F32 _blendLanes(const F32 &TL, const F32 &TR, const F32 &BL, const F32 &BR,
+                                   const F32 &tl, const F32 &tr, const F32 &bl, const F32 &br) {
+    return (TL * tl + TR * tr) + (BL * bl + BR * br);
 }
 
-#ifdef SLIM_VEC2
-INLINE void drawCircle(vec2i center, i32 radius, const Canvas &canvas,
-                       Color color = White, f32 opacity = 1.0f,
-                       const RectI *viewport_bounds = nullptr) {
-    _paintCircle(false, center.x, center.y, radius, canvas, color, opacity, viewport_bounds);
+// The same for a component of texel quads, its 4 bytes being the texels around each position:
+template <typename F32, typename I32>
+SLIM_INLINE_KERNEL F32 _blendTexelQuadLanes(const I32 &values, const F32 &tl, const F32 &tr, const F32 &bl, const F32 &br) {
+    const I32 byte_mask{255};
+    return _blendLanes(toF32(values & byte_mask), toF32((values >> 8) & byte_mask),
+                       toF32((values >> 16) & byte_mask), toF32((values >> 24) & byte_mask), tl, tr, bl, br);
 }
 
-INLINE void fillCircle(vec2i center, i32 radius,
-                       const Canvas &canvas,
-                       Color color = White, f32 opacity = 1.0f,
-                       const RectI *viewport_bounds = nullptr) {
-    _paintCircle(true, center.x, center.y, radius, canvas, color, opacity, viewport_bounds);
-}
-INLINE void drawCircle(vec2 center, i32 radius, const Canvas &canvas,
-                       Color color = White, f32 opacity = 1.0f,
-                       const RectI *viewport_bounds = nullptr) {
-    _paintCircle(false, (i32)center.x, (i32)center.y, radius, canvas, color, opacity, viewport_bounds);
+template <BlitFormat FORMAT, typename F32, typename I32>
+SLIM_INLINE_KERNEL void _fetchBlitTexels(const ImageBlit &blit, const I32 &offsets, F32 &r, F32 &g, F32 &b, F32 &a) {
+    if (FORMAT == BlitFormatByteColors) {
+        const I32 values = gather((const i32*)blit.content, offsets);
+        const I32 byte_mask{255};
+        const F32 to_float{COLOR_COMPONENT_TO_FLOAT};
+        b = toF32(values & byte_mask) * to_float;
+        g = toF32((values >> 8) & byte_mask) * to_float;
+        r = toF32((values >> 16) & byte_mask) * to_float;
+        a = blit.has_alpha ? toF32((values >> 24) & byte_mask) * to_float : F32{1.0f};
+    } else {
+        const f32 *channels = (const f32*)blit.content;
+        const I32 first = FORMAT == BlitFormatRGB ? offsets + offsets + offsets : offsets << 2;
+        r = gather(channels, first);
+        g = gather(channels, first + I32{1});
+        b = gather(channels, first + I32{2});
+        a = blit.has_alpha ? gather(channels, first + I32{3}) : F32{1.0f};
+    }
+}
+
+template <BlitFormat FORMAT, typename I32>
+SLIM_INLINE_KERNEL I32 _blitTexelQuadIndices(const ImageBlit &blit, const I32 &x, const I32 &y) {
+    if (FORMAT == BlitFormatTiledTexelQuads)
+        return _texelQuadIndexLanes<TexelLayoutTiles>(x + I32{blit.quad_x}, y + I32{blit.quad_y}, blit.stride);
+
+    return _texelQuadIndexLanes<TexelLayoutRows>(x, y, blit.stride);
+}
+
+template <BlitFormat FORMAT, ImageFilter FILTER, typename F32, typename I32>
+SLIM_INLINE_KERNEL u32 _sampleBlitSpanWide(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    const F32 lanes = F32::load(blit_lane_offsets);
+    const vec2x<F32> start{row_start};
+    const vec2x<F32> step{blit.step_x};
+    const F32 zero{0.0f};
+    const F32 one{1.0f};
+    const F32 half{0.5f};
+    const F32 max_x{(f32)(blit.width - 1)};
+    const F32 max_y{(f32)(blit.height - 1)};
+    const F32 blit_opacity{blit.opacity};
+    const F32 tint_r{blit.tint.r};
+    const F32 tint_g{blit.tint.g};
+    const F32 tint_b{blit.tint.b};
+    const I32 stride{blit.stride};
+    u32 i = first;
+    for (; i + F32::width <= count; i += F32::width) {
+        const vec2x<F32> position = start + step * (lanes + F32{(f32)(x + (i32)i)});
+        F32 r, g, b, a;
+        if (FORMAT == BlitFormatTexelQuads || FORMAT == BlitFormatTiledTexelQuads) {
+            const i32 *components = (const i32*)blit.content;
+            const I32 byte_mask{255};
+            const F32 to_float{COLOR_COMPONENT_TO_FLOAT};
+            if (FILTER == ImageFilterNearest) {
+                I32 quad = _blitTexelQuadIndices<FORMAT>(blit, truncateToI32(_clampLanes(position.x, zero, max_x)), truncateToI32(_clampLanes(position.y, zero, max_y)));
+                I32 offset = quad + quad + quad;
+                r = toF32((gather(components, offset) >> 24) & byte_mask) * to_float;
+                g = toF32((gather(components, offset + I32{1}) >> 24) & byte_mask) * to_float;
+                b = toF32((gather(components, offset + I32{2}) >> 24) & byte_mask) * to_float;
+            } else {
+                const F32 U = position.x + half;
+                const F32 V = position.y + half;
+                const F32 left = floor(U);
+                const F32 top = floor(V);
+                const F32 fr = U - left;
+                const F32 fb = V - top;
+                const F32 fl = one - fr;
+                const F32 ft = one - fb;
+                const F32 tl = ft * fl, tr = ft * fr, bl = fb * fl, br = fb * fr;
+                I32 quad = _blitTexelQuadIndices<FORMAT>(blit, truncateToI32(_clampLanes(left, zero, F32{(f32)blit.width})), truncateToI32(_clampLanes(top, zero, F32{(f32)blit.height})));
+                I32 offset = quad + quad + quad;
+                r = _blendTexelQuadLanes(gather(components, offset), tl, tr, bl, br) * to_float;
+                g = _blendTexelQuadLanes(gather(components, offset + I32{1}), tl, tr, bl, br) * to_float;
+                b = _blendTexelQuadLanes(gather(components, offset + I32{2}), tl, tr, bl, br) * to_float;
+            }
+            a = one;
+        } else if (FILTER == ImageFilterNearest) {
+            I32 offset = mulLow(truncateToI32(_clampLanes(position.y, zero, max_y)), stride) + truncateToI32(_clampLanes(position.x, zero, max_x));
+            _fetchBlitTexels<FORMAT>(blit, offset, r, g, b, a);
+        } else {
+            const F32 X = position.x - half;
+            const F32 Y = position.y - half;
+            const F32 left = floor(X);
+            const F32 top = floor(Y);
+            const F32 fr = X - left;
+            const F32 fb = Y - top;
+            const F32 fl = one - fr;
+            const F32 ft = one - fb;
+            const I32 x0 = truncateToI32(_clampLanes(left, zero, max_x));
+            const I32 x1 = truncateToI32(_clampLanes(left + one, zero, max_x));
+            const I32 row0 = mulLow(truncateToI32(_clampLanes(top, zero, max_y)), stride);
+            const I32 row1 = mulLow(truncateToI32(_clampLanes(top + one, zero, max_y)), stride);
+            F32 TL[4], TR[4], BL[4], BR[4];
+            _fetchBlitTexels<FORMAT>(blit, row0 + x0, TL[0], TL[1], TL[2], TL[3]);
+            _fetchBlitTexels<FORMAT>(blit, row0 + x1, TR[0], TR[1], TR[2], TR[3]);
+            _fetchBlitTexels<FORMAT>(blit, row1 + x0, BL[0], BL[1], BL[2], BL[3]);
+            _fetchBlitTexels<FORMAT>(blit, row1 + x1, BR[0], BR[1], BR[2], BR[3]);
+            F32 tl = ft * fl, tr = ft * fr, bl = fb * fl, br = fb * fr;
+            if (blit.has_alpha) {
+                tl = tl * TL[3];
+                tr = tr * TR[3];
+                bl = bl * BL[3];
+                br = br * BR[3];
+                a = (tl + tr) + (bl + br);
+                const F32 is_visible = a > zero;
+                r = select(is_visible, _blendLanes(TL[0], TR[0], BL[0], BR[0], tl, tr, bl, br) / a, zero);
+                g = select(is_visible, _blendLanes(TL[1], TR[1], BL[1], BR[1], tl, tr, bl, br) / a, zero);
+                b = select(is_visible, _blendLanes(TL[2], TR[2], BL[2], BR[2], tl, tr, bl, br) / a, zero);
+            } else {
+                r = _blendLanes(TL[0], TR[0], BL[0], BR[0], tl, tr, bl, br);
+                g = _blendLanes(TL[1], TR[1], BL[1], BR[1], tl, tr, bl, br);
+                b = _blendLanes(TL[2], TR[2], BL[2], BR[2], tl, tr, bl, br);
+                a = one;
+            }
+        }
+
+        const F32 opacity = _clampLanes(a, zero, one) * blit_opacity;
+        r = _clampLanes(r * tint_r, zero, one);
+        g = _clampLanes(g * tint_g, zero, one);
+        b = _clampLanes(b * tint_b, zero, one);
+        (r * r * opacity).store(span.reds + i);
+        (g * g * opacity).store(span.greens + i);
+        (b * b * opacity).store(span.blues + i);
+        opacity.store(span.opacities + i);
+    }
+    return i;
+}
+
+template <typename F32, typename I32>
+SLIM_INLINE_KERNEL u32 _blitSpanWide(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    if (blit.tile_width) // Tiled images get sampled a texel at a time
+        return first;
+
+    const bool bilinear = blit.filter == ImageFilterBilinear;
+    switch (blit.format) {
+        case BlitFormatByteColors: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatByteColors, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatByteColors, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatRGB: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatRGB, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatRGB, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatRGBA: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatRGBA, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatRGBA, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatTexelQuads: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatTexelQuads, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatTexelQuads, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatTiledTexelQuads: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatTiledTexelQuads, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatTiledTexelQuads, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+    }
+    return first;
+}
+
+#ifdef SLIM_SSE2
+void _blitSpanSSE2(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    u32 i = _blitSpanWide<f32x4, i32x4>(blit, row_start, x, first, count, span);
+    if (i < count) _blitSpanScalar(blit, row_start, x, i, count, span);
 }
+#endif
 
-INLINE void fillCircle(vec2 center, i32 radius,
-                       const Canvas &canvas,
-                       Color color = White, f32 opacity = 1.0f,
-                       const RectI *viewport_bounds = nullptr) {
-    _paintCircle(true, (i32)center.x, (i32)center.y, radius, canvas, color, opacity, viewport_bounds);
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 void _blitSpanAVX2(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    u32 i = _blitSpanWide<f32x8, i32x8>(blit, row_start, x, first, count, span);
+    if (i < count) _blitSpanSSE2(blit, row_start, x, i, count, span);
 }
 #endif
 
+typedef void (*BlitSpanKernel)(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span);
+BlitSpanKernel blit_span_kernel = selectKernel<BlitSpanKernel>(
+        _blitSpanScalar,
+        SIMD_SSE2_KERNEL(_blitSpanSSE2),
+        SIMD_AVX2_KERNEL(_blitSpanAVX2));
+
+// The mip to draw a texture from through a transform from its texels to canvas pixels (see Texture::getMipLevel()).
+// The columns of the inverse are where a pixel's step right and down land in texels:
+INLINE u32 getMipLevel(const Texture &texture, const mat2 &transform) {
+    const mat2 inverse = transform.inverted();
+    const f32 width = (f32)texture.width;
+    const f32 height = (f32)texture.height;
+    return texture.getMipLevel(inverse.X.x / width, inverse.X.y / height, inverse.Y.x / width, inverse.Y.y / height);
+}
+
+// Draws the rows of a blit within the given bounds (which the canvas must have been marked dirty for), on the calling thread:
+template <AntiAliasing AA>
+void drawBlitRows(const ImageBlit &blit, const Canvas &canvas, const RectI &rows) {
+    BlitSpan span;
+    for (i32 y = rows.top; y <= rows.bottom; y++) {
+        const vec2 row_start = blit.rowStart(y);
+        i32 first = rows.left;
+        i32 last = rows.right;
+        blit.clipRow(row_start, first, last);
+        for (i32 x = first; x <= last; x += BLIT_SPAN_SIZE) {
+            u32 count = (u32)(last - x + 1 < BLIT_SPAN_SIZE ? last - x + 1 : BLIT_SPAN_SIZE);
+
+            // Sampled in whole packets (of up to 8), rather than leaving a tail of pixels for the narrower kernels.
+            // The pixels past the end get clamped into the source like any other, and are just not drawn:
+            blit_span_kernel(blit, row_start, x, 0, (count + 7) & ~7u, span);
+            canvas.drawPixels<AA>(x, y, count, span.reds, span.greens, span.blues, span.opacities);
+        }
+    }
+}
 
-INLINE void _drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3,
-                          const Canvas &canvas, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) {
-    drawLine(x1, y1, 0, x2, y2, 0, canvas, color, opacity, line_width, viewport_bounds);
-    drawLine(x2, y2, 0, x3, y3, 0, canvas, color, opacity, line_width, viewport_bounds);
-    drawLine(x3, y3, 0, x1, y1, 0, canvas, color, opacity, line_width, viewport_bounds);
+// Draws a (mapped) blit, splitting its rows into bands that get drawn in parallel when there are enough pixels to draw:
+template <AntiAliasing AA>
+void _drawBlit(const ImageBlit &blit, const Canvas &canvas) {
+    const i32 width = blit.bounds.right - blit.bounds.left + 1;
+    const i32 height = blit.bounds.bottom - blit.bounds.top + 1;
+    if (width * height < BLIT_PARALLEL_MIN_PIXELS)
+        drawBlitRows<AA>(blit, canvas, blit.bounds);
+    else
+        parallelFor2D(blit.bounds, width, BLIT_BAND_HEIGHT, [&](const RectI &band) { drawBlitRows<AA>(blit, canvas, band); });
 }
 
+void drawBlit(const ImageBlit &blit, const Canvas &canvas) {
+    canvas.markDirty(blit.bounds); // Up front, as lazily cleared tiles get cleared in memory when marked
+    switch (canvas.antialias) {
+        case NoAA: _drawBlit<NoAA>(blit, canvas); break;
+        case MSAA: _drawBlit<MSAA>(blit, canvas); break;
+        case SSAA: _drawBlit<SSAA>(blit, canvas); break;
+    }
+}
 
-void _fillTriangle(f32 x1, f32 y1,
-                   f32 x2, f32 y2,
-                   f32 x3, f32 y3,
-                   const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    // Cull this triangle against the edges of the viewport:
-    Rect bounds{0, canvas.dimensions.f_width - 1.0f, 0, canvas.dimensions.f_height - 1.0f};
-    Rect rect{
-            x1 < x2 ? x1 : x2,
-            x1 > x2 ? x1 : x2,
-            y1 < y2 ? y1 : y2,
-            y1 > y2 ? y1 : y2,
-    };
-    if (x3 < rect.left) rect.left = x3;
-    if (x3 > rect.right) rect.right = x3;
-    if (y3 < rect.top) rect.top = y3;
-    if (y3 > rect.bottom) rect.bottom = y3;
-    if (viewport_bounds) {
-        Rect float_bounds{
-                (f32)viewport_bounds->left,
-                (f32)viewport_bounds->right,
-                (f32)viewport_bounds->top,
-                (f32)viewport_bounds->bottom,
-        };
-        x1 += float_bounds.left;
-        x2 += float_bounds.left;
-        x3 += float_bounds.left;
-        y1 += float_bounds.top;
-        y2 += float_bounds.top;
-        y3 += float_bounds.top;
-        rect.x_range += float_bounds.left;
-        rect.y_range += float_bounds.top;
-        rect -= float_bounds;
-        bounds -= float_bounds;
+
+void drawImage(const PixelImage &image, const Canvas &canvas, RectI bounds, f32 opacity = 1.0f) {
+    if (bounds.right < 0 ||
+        bounds.bottom < 0 ||
+        bounds.left >= canvas.dimensions.width ||
+        bounds.top >= canvas.dimensions.height)
+        return;
+
+    i32 image_width = (i32)image.width;
+    i32 image_height = (i32)image.height;
+    i32 width = bounds.right - bounds.left;
+    i32 height = bounds.bottom - bounds.top;
+    if (width > image_width) {
+        width = image_width;
+        bounds.right = bounds.left + width;
     }
-    rect -= bounds;
-    if (!rect)
+    if (height > image_height) {
+        height = image_height;
+        bounds.bottom = bounds.top + height;
+    }
+
+    Pixel *pixel = image.content;
+    if (image.flags.tile) {
+        TiledGridInfo grid{image};
+        u32 X, Y = 0;
+        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
+            X = 0;
+            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
+            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
+                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
+
+                for (u32 y = 0; y < tile_height; y++)
+                    for (u32 x = 0; x < tile_width; x++, pixel++)
+                        canvas.setPixel(X + x, Y + y, pixel->color, image.flags.alpha ? (pixel->opacity * opacity) : opacity);
+
+                X += image.tile_width;
+            }
+            Y += image.tile_height;
+        }
+    } else {
+        i32 remainder_x = image_width - width;
+        for (i32 y = bounds.top; y <= bounds.bottom; y++) {
+            for (i32 x = bounds.left; x <= bounds.right; x++, pixel++)
+                canvas.setPixel(x, y, pixel->color, image.flags.alpha ? (pixel->opacity * opacity) : opacity);
+
+            pixel += remainder_x;
+        }
+    }
+}
+
+void drawImage(const FloatImage &image, const Canvas &canvas, RectI bounds, f32 opacity = 1.0f) {
+    if (bounds.right < 0 ||
+        bounds.bottom < 0 ||
+        bounds.left >= canvas.dimensions.width ||
+        bounds.top >= canvas.dimensions.height)
         return;
 
-    if (canvas.antialias == SSAA) {
-        x1 *= 2.0f;
-        x2 *= 2.0f;
-        x3 *= 2.0f;
-        y1 *= 2.0f;
-        y2 *= 2.0f;
-        y3 *= 2.0f;
-        rect *= 2.0f;;
+    i32 image_width = (i32)image.width;
+    i32 image_height = (i32)image.height;
+    i32 width = bounds.right - bounds.left;
+    i32 height = bounds.bottom - bounds.top;
+    if (width > image_width) {
+        width = image_width;
+        bounds.right = bounds.left + width;
+    }
+    if (height > image_height) {
+        height = image_height;
+        bounds.bottom = bounds.top + height;
     }
 
-    // Compute area components:
-    f32 ABx = x2 - x1;
-    f32 ABy = y2 - y1;
+    bool has_opacity = image.flags.alpha;
+    i32 channels_per_pixel = has_opacity ? 4 : 3;
+    Color color;
+    f32 pixel_opacity;
+    f32 *channel = image.content;
+    if (image.flags.tile) {
+        TiledGridInfo grid{image};
+        u32 X, Y = 0;
+        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
+            X = 0;
+            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
+            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
+                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
 
-    f32 ACx = x3 - x1;
-    f32 ACy = y3 - y1;
+                for (u32 y = 0; y < tile_height; y++) {
+                    for (u32 x = 0; x < tile_width; x++) {
+                        color.r = *(channel++);
+                        color.g = *(channel++);
+                        color.b = *(channel++);
+                        if (has_opacity)
+                            pixel_opacity = *(channel++);
+                        else
+                            pixel_opacity = 1.0f;
 
-    f32 ABC = ACx*ABy - ACy*ABx;
+                        canvas.setPixel(X + x, Y + y, color, pixel_opacity * opacity);
+                    }
+                }
 
-    // Cull faces facing backwards:
-    if (ABC < 0) {
-        f32 tmp = x3;
-        x3 = x2;
-        x2 = tmp;
+                X += image.tile_width;
+            }
+            Y += image.tile_height;
+        }
+    } else {
+        i32 remainder_x = ((i32)image.stride - width) * channels_per_pixel;
+        for (i32 y = bounds.top; y <= bounds.bottom; y++) {
+            for (i32 x = bounds.left; x <= bounds.right; x++) {
+                color.r = *(channel++);
+                color.g = *(channel++);
+                color.b = *(channel++);
+                if (has_opacity)
+                    pixel_opacity = *(channel++);
+                else
+                    pixel_opacity = 1.0f;
 
-        tmp = y3;
-        y3 = y2;
-        y2 = tmp;
+                canvas.setPixel(x, y, color, pixel_opacity * opacity);
+            }
 
-        ABx = x2 - x1;
-        ABy = y2 - y1;
+            channel += remainder_x;
+        }
+    }
+}
 
-        ACx = x3 - x1;
-        ACy = y3 - y1;
-        ABC = ACx*ABy - ACy*ABx;
-    } else if (ABC == 0)
+void drawImage(const ByteColorImage &image, const Canvas &canvas, RectI bounds, f32 opacity = 1.0f) {
+    if (bounds.right < 0 ||
+        bounds.bottom < 0 ||
+        bounds.left >= canvas.dimensions.width ||
+        bounds.top >= canvas.dimensions.height)
         return;
 
-    // Floor bounds coordinates down to their integral component:
-    u32 first_x = (u32)rect.left;
-    u32 first_y = (u32)rect.top;
-    u32 last_x  = (u32)rect.right;
-    u32 last_y  = (u32)rect.bottom;
-
-    rect.left   = (f32)first_x;
-    rect.top    = (f32)first_y;
-    rect.right  = (f32)last_x;
-    rect.bottom = (f32)last_y;
+    i32 image_width = (i32)image.width;
+    i32 image_height = (i32)image.height;
+    i32 width = bounds.right - bounds.left;
+    i32 height = bounds.bottom - bounds.top;
+    if (width > image_width) {
+        width = image_width;
+        bounds.right = bounds.left + width;
+    }
+    if (height > image_height) {
+        height = image_height;
+        bounds.bottom = bounds.top + height;
+    }
 
-    // Drawing: Top-down
-    // Origin: Top-left
+    Pixel pixel;;
+    ByteColor *byte_color = image.content;
+    if (image.flags.tile) {
+        TiledGridInfo grid{image};
+        u32 X, Y = 0;
+        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
+            X = 0;
+            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
+            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
+                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
 
-    // Compute weight constants:
-    f32 one_over_ABC = 1.0f / ABC;
+                for (u32 y = 0; y < tile_height; y++) {
+                    for (u32 x = 0; x < tile_width; x++, byte_color++) {
+                        pixel = *byte_color;
+                        canvas.setPixel(X + x, Y + y, pixel.color, image.flags.alpha ? (pixel.opacity * opacity) : opacity);
+                    }
+                }
 
-    f32 Cdx =  ABy * one_over_ABC;
-    f32 Bdx = -ACy * one_over_ABC;
+                X += image.tile_width;
+            }
+            Y += image.tile_height;
+        }
+    } else {
+        i32 remainder_x = (i32)image.stride - width;
+        for (i32 y = bounds.top; y < bounds.bottom; y++) {
+            for (i32 x = bounds.left; x < bounds.right; x++, byte_color++) {
+                pixel = *byte_color;
+                canvas.setPixel(x, y, pixel.color, image.flags.alpha ? (pixel.opacity * opacity) : opacity);
+            }
 
-    f32 Cdy = -ABx * one_over_ABC;
-    f32 Bdy =  ACx * one_over_ABC;
+            byte_color += remainder_x;
+        }
+    }
+}
 
-    // Compute initial areal coordinates for the first pixel center:
-    rect.left += 0.5f;
-    rect.top += 0.5f;
-    f32 C_start = Cdx*rect.left + Cdy*rect.top + (y1*x2 - x1*y2) * one_over_ABC;
-    f32 B_start = Bdx*rect.left + Bdy*rect.top + (y3*x1 - x3*y1) * one_over_ABC;
+void drawImageToWindow(const ByteColorImage &image, RectI bounds, f32 opacity = 1.0f) {
+    if (bounds.right < 0 ||
+        bounds.bottom < 0 ||
+        bounds.left >= window::width ||
+        bounds.top >= window::height)
+        return;
 
-    f32 A, B, C;
+    window::content_source = nullptr; // Canvases can no longer resolve just their dirty tiles over it
 
-    // Scan the bounds:
-    for (u32 y = first_y; y <= last_y; y++, C_start += Cdy, B_start += Bdy) {
-        B = B_start;
-        C = C_start;
+    i32 image_width = (i32)image.width;
+    i32 image_height = (i32)image.height;
+    i32 width = bounds.right - bounds.left;
+    i32 height = bounds.bottom - bounds.top;
+    if (width > image_width) {
+        width = image_width;
+        bounds.right = bounds.left + width;
+    }
+    if (height > image_height) {
+        height = image_height;
+        bounds.bottom = bounds.top + height;
+    }
 
-        for (u32 x = first_x; x <= last_x; x++, B += Bdx, C += Cdx) {
-            if (((Bdx < 0) && (B < 0)) ||
-                ((Cdx < 0) && (C < 0)))
-                break;
+    ByteColor *byte_color = image.content;
+    if (image.flags.tile) {
+        TiledGridInfo grid{image};
+        u32 X, Y = 0;
+        for (grid.row = 0; grid.row < grid.rows; grid.row++) {
+            X = 0;
+            u32 tile_height = grid.row == grid.bottom_row ? grid.bottom_row_tile_height : image.tile_height;
+            for (grid.column = 0; grid.column < grid.columns; grid.column++) {
+                u32 tile_width = grid.column == grid.right_column ? grid.right_column_tile_stride : image.tile_width;
 
-            A = 1 - B - C;
+                for (u32 y = 0; y < tile_height; y++)
+                    for (u32 x = 0; x < tile_width; x++, byte_color++)
+                        window::content[window::width * (Y + y) + X + x] = byte_color->value;
 
-            // Skip the pixel if it's outside:
-            if (fminf(A, fminf(B, C)) < 0)
-                continue;
+                X += image.tile_width;
+            }
+            Y += image.tile_height;
+        }
+    } else {
+        i32 remainder_x = (i32)image.stride - width;
+        for (i32 y = bounds.top; y <= bounds.bottom; y++) {
+            for (i32 x = bounds.left; x <= bounds.right; x++, byte_color++)
+                window::content[window::width * y + x] = byte_color->value;
 
-            canvas.setPixel(x, y, color, opacity);
+            byte_color += remainder_x;
         }
     }
 }
 
-INLINE void Canvas::drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawTriangle(x1, y1, x2, y2, x3, y3, *this, color, opacity, line_width, viewport_bounds);
-}
-
-INLINE void Canvas::drawTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, *this, color, opacity, line_width, viewport_bounds);
-}
-
-INLINE void Canvas::fillTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _fillTriangle(x1, y1, x2, y2, x3, y3, *this, color, opacity, viewport_bounds);
-}
-
-INLINE void Canvas::fillTriangle(i32 x1, i32 y1, i32 x2, i32 y2, i32 x3, i32 y3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _fillTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, *this, color, opacity, viewport_bounds);
+// Draws an image through an affine transform from image pixels to canvas pixels (then translated), see draw/blit.h.
+// Pixels get drawn where their centers land within the transformed image, sampled from it with the given filter:
+void drawImage(const PixelImage &image, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    ImageBlit blit{image, image.content, BlitFormatRGBA, filter, opacity};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
 }
 
-#ifdef SLIM_VEC2
-INLINE void Canvas::drawTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, *this, color, opacity, line_width, viewport_bounds);
+void drawImage(const FloatImage &image, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    ImageBlit blit{image, image.content, image.flags.alpha ? BlitFormatRGBA : BlitFormatRGB, filter, opacity};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
 }
 
-INLINE void Canvas::fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _fillTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, *this, color, opacity, viewport_bounds);
+void drawImage(const ByteColorImage &image, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    ImageBlit blit{image, image.content, BlitFormatByteColors, filter, opacity};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
 }
 
-INLINE void Canvas::drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
-    _drawTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, *this, color, opacity, line_width, viewport_bounds);
-}
 
-INLINE void Canvas::fillTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _fillTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, *this, color, opacity, viewport_bounds);
+// Draws a texture mip through an affine transform from texels to canvas pixels (then translated), see draw/blit.h:
+void drawImage(const TextureMip &texture_mip, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f, TexelLayout layout = TexelLayoutRows) {
+    ImageBlit blit{texture_mip, filter, opacity, layout};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
 }
-#endif
-
 
-INLINE void drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Canvas &canvas,
-                         Color color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
-    _drawTriangle(x1, y1, x2, y2, x3, y3, canvas, color, opacity, line_width, viewport_bounds);
-}
+// Mipmapped textures get drawn from the mip closest to a texel per pixel, along the axis the transform shrinks the most
+// (judging by areas alone would alias textures squashed along one axis):
+void drawImage(const Texture &texture, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    if (!texture.mips || !transform.has_inverse())
+        return;
 
-INLINE void drawTriangle(i32 x1, i32 y1,
-                         i32 x2, i32 y2,
-                         i32 x3, i32 y3,
-                         const Canvas &canvas,
-                         Color color = White, f32 opacity = 0.5f, u8 line_width = 0,
-                         const RectI *viewport_bounds = nullptr) {
-    _drawTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, canvas, color, opacity, line_width, viewport_bounds);
+    u32 mip_level = getMipLevel(texture, transform);
+    const TextureMip &texture_mip = texture.mips[mip_level];
+    const f32 scale_x = (f32)texture.width / (f32)texture_mip.width;
+    const f32 scale_y = (f32)texture.height / (f32)texture_mip.height;
+    drawImage(texture_mip, canvas, mat2{transform.X * scale_x, transform.Y * scale_y}, translation, filter, opacity, texture.texelLayout());
 }
 
+void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f,
+                    TexelLayout layout = TexelLayoutRows) {
+    Color texel_color;
+    i32 draw_width = draw_bounds.right - draw_bounds.left+1;
+    i32 draw_height = draw_bounds.bottom - draw_bounds.top+1;
+    if (cropped) {
+        if (draw_width > (i32)texture_mip.width) draw_width = (i32)texture_mip.width;
+        if (draw_height > (i32)texture_mip.height) draw_height = (i32)texture_mip.height;
+        i32 remainder_x = 1 + (i32)texture_mip.width - draw_width;
+        TexelQuad *texel_quad = texture_mip.texel_quads;
+        i32 Y = draw_bounds.top;
+        for (i32 y = 0; y < draw_height; y++, Y++) {
+            i32 X = draw_bounds.left;
+            for (i32 x = 0; x < draw_width; x++, X++, texel_quad++) {
+                if (layout == TexelLayoutTiles)
+                    texel_quad = texture_mip.texel_quads + TextureMip::GetQuadIndex<TexelLayoutTiles>(x, y, texture_mip.width + 1);
 
-INLINE void fillTriangle(f32 x1, f32 y1,
-                         f32 x2, f32 y2,
-                         f32 x3, f32 y3,
-                         const Canvas &canvas, Color color = White, f32 opacity = 1.0f,
-                         const RectI *viewport_bounds = nullptr) {
-    _fillTriangle(x1, y1, x2, y2, x3, y3, canvas, color, opacity, viewport_bounds);
-}
-
-INLINE void fillTriangle(i32 x1, i32 y1,
-                         i32 x2, i32 y2,
-                         i32 x3, i32 y3,
-                         const Canvas &canvas, Color color = White, f32 opacity = 1.0f,
-                         const RectI *viewport_bounds = nullptr) {
-    _fillTriangle((f32)x1, (f32)y1, (f32)x2, (f32)y2, (f32)x3, (f32)y3, canvas, color, opacity, viewport_bounds);
+                texel_color.r = (f32)texel_quad->R.BR * COLOR_COMPONENT_TO_FLOAT;
+                texel_color.g = (f32)texel_quad->G.BR * COLOR_COMPONENT_TO_FLOAT;
+                texel_color.b = (f32)texel_quad->B.BR * COLOR_COMPONENT_TO_FLOAT;
+                canvas.setPixel(X, Y, texel_color, opacity);
+            }
+            texel_quad += remainder_x;
+        }
+    } else
+        drawImage(texture_mip, canvas, mat2{
+                (f32)draw_width / (f32)texture_mip.width, 0.0f,
+                0.0f, (f32)draw_height / (f32)texture_mip.height
+        }, vec2{(f32)draw_bounds.left, (f32)draw_bounds.top}, ImageFilterBilinear, opacity, layout);
 }
 
-#ifdef SLIM_VEC2
-void drawTriangle(vec2 p1, vec2 p2, vec2 p3, const Canvas &canvas,
-                  Color color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) {
-    _drawTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, canvas, color, opacity, line_width, viewport_bounds);
-}
+void drawTexture(const Texture &texture, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f) {
+    if (draw_bounds.right < 0 ||
+        draw_bounds.bottom < 0 ||
+        draw_bounds.left >= canvas.dimensions.width ||
+        draw_bounds.top >= canvas.dimensions.height)
+        return;
 
-void fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Canvas &canvas,
-                  Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _fillTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, canvas, color, opacity, viewport_bounds);
+    u32 mip_level = 0;
+    if (!cropped) {
+        i32 draw_width = draw_bounds.right - draw_bounds.left+1;
+        i32 draw_height = draw_bounds.bottom - draw_bounds.top+1;
+        mip_level = texture.getMipLevel(1.0f / (f32)draw_width, 0.0f, 0.0f, 1.0f / (f32)draw_height);
+    }
+    drawTextureMip(texture.mips[mip_level], canvas, draw_bounds, cropped, opacity, texture.texelLayout());
 }
 
-void drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Canvas &canvas,
-                  Color color = White, f32 opacity = 0.5f, u8 line_width = 0,
-                  const RectI *viewport_bounds = nullptr) {
-    _drawTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, canvas, color, opacity, line_width, viewport_bounds);
-}
 
-void fillTriangle(vec2i p1, vec2i p2, vec2i p3,
-                  const Canvas &canvas,
-                  Color color = White, f32 opacity = 1.0f,
-                  const RectI *viewport_bounds = nullptr) {
-    _fillTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, canvas, color, opacity, viewport_bounds);
-}
+// Batches of textured rectangles (sprites), drawn all at once at the end of a frame:
+// Sprites get added into a frame arena, then set up and culled against the canvas in chunks (in parallel),
+// sorted by layer, texture and mip, binned into the canvas tiles they overlap and drawn tile by tile in parallel
+// (through the same sampling kernels as drawImage(), see draw/blit.h).
+// Within a layer, sprites of the same texture and mip keep the order they were added in, while sprites of
+// different ones may get drawn in either order. So sprites that overlap and need to be drawn in order go in separate layers.
+#ifndef SPRITE_BATCH_CAPACITY
+#define SPRITE_BATCH_CAPACITY Megabytes(64)
 #endif
 
-#define LINE_HEIGHT 14
-#define FIRST_CHARACTER_CODE 32
-#define LAST_CHARACTER_CODE 126
-#define INTERNAL_FONT_WIDTH (FONT_WIDTH * 2)
-#define INTERNAL_FONT_HEIGHT (FONT_HEIGHT * 2)
-
-// Header File for SSD1306 characters
-// Generated with TTF2BMH
-// Font JetBrains Mono Regular
-// Font Size: 24
-u8 bitmap_32[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_33[] = {0,0,0,0,0,0,62,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0};
-u8 bitmap_34[] = {0,0,0,0,254,254,0,0,0,254,254,254,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_35[] = {0,0,192,192,192,252,254,192,192,192,192,252,254,192,192,0,0,0,0,96,96,240,255,111,96,96,96,240,255,111,96,96,0,0,0,0,0,0,12,15,1,0,0,0,12,15,1,0,0,0,0,0,0,0};
-u8 bitmap_36[] = {0,0,112,248,252,14,6,255,255,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,6,255,255,12,28,248,240,192,0,0,0,0,0,0,3,7,14,12,12,255,255,12,12,15,7,1,0,0,0,0};
-u8 bitmap_37[] = {0,252,206,2,2,6,252,120,0,0,0,128,192,64,96,0,0,0,0,192,97,49,17,25,13,4,246,59,9,9,24,240,224,0,0,0,0,0,0,0,0,0,0,0,7,14,8,8,12,7,3,0,0,0};
-u8 bitmap_38[] = {0,0,0,252,252,142,6,6,6,14,28,24,0,0,0,0,0,0,0,248,252,254,3,3,15,28,120,240,224,248,60,12,4,0,0,0,0,1,7,7,14,12,12,14,6,7,1,7,14,12,8,0,0,0};
-u8 bitmap_39[] = {0,0,0,0,0,0,126,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_40[] = {0,0,0,0,0,240,252,62,7,3,1,1,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,7,15,28,56,112,96,96,0,0,0,0,0};
-u8 bitmap_41[] = {0,0,0,0,1,1,3,15,254,248,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,96,112,48,56,30,15,3,0,0,0,0,0,0,0,0};
-u8 bitmap_42[] = {0,0,0,0,0,0,0,240,240,0,0,0,0,0,0,0,0,0,0,3,3,131,198,246,124,15,61,118,230,199,131,3,2,0,0,0,0,0,0,1,1,0,0,0,0,0,1,1,0,0,0,0,0,0};
-u8 bitmap_43[] = {0,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,0,0,0,0,24,24,24,24,24,255,255,24,24,24,24,24,0,0,0,0,0,0,0,0,0,0,0,3,3,0,0,0,0,0,0,0,0,0};
-u8 bitmap_44[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,15,1,0,0,0,0,0,0,0,0};
-u8 bitmap_45[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,6,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_46[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,7,0,0,0,0,0,0,0,0};
-u8 bitmap_47[] = {0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,96,120,127,15,1,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_48[] = {0,0,240,248,60,14,6,134,134,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,31,63,63,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_49[] = {0,0,0,56,24,28,14,254,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,15,12,12,12,12,0,0,0,0};
-u8 bitmap_50[] = {0,0,56,60,28,14,6,6,6,14,28,252,248,0,0,0,0,0,0,0,0,0,128,192,224,112,48,28,15,7,3,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_51[] = {0,0,6,6,6,6,134,198,102,54,62,30,14,0,0,0,0,0,0,0,128,128,0,3,3,3,3,7,14,254,252,96,0,0,0,0,0,0,1,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
-u8 bitmap_52[] = {0,0,0,0,0,128,192,240,120,30,14,2,0,0,0,0,0,0,0,0,240,252,254,199,195,192,192,192,192,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_53[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,7,7,7,6,3,3,3,3,7,254,252,240,0,0,0,0,0,0,1,7,7,14,12,12,12,14,14,7,3,0,0,0,0,0};
-u8 bitmap_54[] = {0,0,0,0,128,224,240,60,30,6,2,0,0,0,0,0,0,0,0,0,248,254,15,5,2,3,3,3,7,254,252,240,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_55[] = {0,0,62,62,6,6,6,6,6,6,230,254,126,14,0,0,0,0,0,0,0,0,0,0,128,224,252,63,15,1,0,0,0,0,0,0,0,0,0,0,8,14,15,7,1,0,0,0,0,0,0,0,0,0};
-u8 bitmap_56[] = {0,0,112,248,252,14,6,6,6,14,12,252,248,0,0,0,0,0,0,0,240,249,29,15,6,6,6,7,15,253,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_57[] = {0,0,240,248,28,14,6,6,6,6,12,252,248,224,0,0,0,0,0,0,3,7,15,14,12,140,204,244,126,31,7,1,0,0,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,0,0,0,0};
-u8 bitmap_58[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,6,0,0,0,0,0,0,0,0};
-u8 bitmap_59[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,7,1,0,0,0,0,0,0,0,0};
-u8 bitmap_60[] = {0,0,0,0,0,128,128,192,192,224,96,112,48,0,0,0,0,0,0,0,14,15,27,27,49,49,96,96,192,192,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0};
-u8 bitmap_61[] = {0,0,192,192,192,192,192,192,192,192,192,192,192,192,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_62[] = {0,0,48,112,96,96,192,192,128,128,0,0,0,0,0,0,0,0,0,0,128,192,192,224,96,112,49,57,27,27,14,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_63[] = {0,0,0,0,6,6,6,6,6,12,252,248,224,0,0,0,0,0,0,0,0,0,0,124,124,124,12,14,7,3,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0,0};
-u8 bitmap_64[] = {0,192,240,120,28,14,6,6,134,134,142,12,252,248,192,0,0,0,0,255,255,0,0,0,252,255,7,1,1,3,253,255,255,0,0,0,0,15,63,120,224,192,193,131,135,134,6,2,1,7,7,0,0,0};
-u8 bitmap_65[] = {0,0,0,0,128,240,254,14,62,254,224,0,0,0,0,0,0,0,0,0,128,248,255,127,97,96,96,99,127,254,224,0,0,0,0,0,0,8,15,15,1,0,0,0,0,0,0,3,15,15,0,0,0,0};
-u8 bitmap_66[] = {0,0,254,254,254,6,6,6,6,14,14,252,248,32,0,0,0,0,0,0,255,255,255,6,6,6,6,6,15,253,249,240,0,0,0,0,0,0,15,15,15,12,12,12,12,12,14,7,3,1,0,0,0,0};
-u8 bitmap_67[] = {0,0,224,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_68[] = {0,0,254,254,254,6,6,6,6,14,28,252,248,192,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,15,15,15,12,12,12,12,14,7,7,3,0,0,0,0,0};
-u8 bitmap_69[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_70[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_71[] = {0,0,240,248,60,14,6,6,6,14,14,60,56,32,0,0,0,0,0,0,255,255,128,0,0,12,12,12,12,252,252,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_72[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_73[] = {0,0,6,6,6,6,6,254,254,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0,0};
-u8 bitmap_74[] = {0,0,0,6,6,6,6,6,6,6,6,254,254,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,1,0,0,0,0,0};
-u8 bitmap_75[] = {0,0,254,254,254,0,0,0,128,224,240,124,30,6,2,0,0,0,0,0,255,255,255,6,6,6,31,127,248,224,128,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,1,7,15,14,8,0,0,0};
-u8 bitmap_76[] = {0,0,0,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_77[] = {0,0,254,254,14,248,192,0,0,224,124,230,254,254,0,0,0,0,0,0,255,255,0,0,7,14,15,3,0,255,255,255,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,15,15,15,0,0,0,0};
-u8 bitmap_78[] = {0,0,254,254,14,124,240,128,0,0,0,254,254,0,0,0,0,0,0,0,255,255,0,0,3,15,126,240,128,255,255,0,0,0,0,0,0,0,15,15,0,0,0,0,0,3,15,15,15,0,0,0,0,0};
-u8 bitmap_79[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_80[] = {0,0,254,254,254,6,6,6,6,6,14,28,252,248,0,0,0,0,0,0,255,255,255,12,12,12,12,12,14,7,7,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_81[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,62,254,231,131,0,0,0,0,0};
-u8 bitmap_82[] = {0,0,254,254,254,6,6,6,6,6,14,188,248,240,0,0,0,0,0,0,255,255,255,12,12,12,28,252,254,199,3,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,3,15,15,12,0,0,0,0};
-u8 bitmap_83[] = {0,0,96,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,7,6,14,12,28,248,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,12,14,7,3,1,0,0,0,0};
-u8 bitmap_84[] = {0,6,6,6,6,6,6,254,254,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
-u8 bitmap_85[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_86[] = {0,2,62,254,224,0,0,0,0,0,128,248,254,30,0,0,0,0,0,0,0,3,63,254,224,0,128,248,255,15,0,0,0,0,0,0,0,0,0,0,0,3,15,14,15,15,0,0,0,0,0,0,0,0};
-u8 bitmap_87[] = {0,254,254,0,0,0,252,62,254,224,0,0,240,254,62,0,0,0,0,3,255,255,0,252,63,0,1,255,224,0,255,255,0,0,0,0,0,0,15,15,8,15,0,0,0,3,15,15,15,0,0,0,0,0};
-u8 bitmap_88[] = {0,2,6,30,124,240,192,0,128,224,248,62,14,2,0,0,0,0,0,0,0,0,192,241,127,31,63,249,224,192,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,1,7,15,12,8,0,0,0};
-u8 bitmap_89[] = {0,6,30,124,240,192,0,0,0,128,224,248,62,14,2,0,0,0,0,0,0,0,1,7,31,252,252,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
-u8 bitmap_90[] = {0,0,6,6,6,6,6,6,134,230,246,62,14,0,0,0,0,0,0,0,0,0,192,240,124,30,7,1,0,0,0,0,0,0,0,0,0,0,14,15,15,12,12,12,12,12,12,12,12,0,0,0,0,0};
-u8 bitmap_91[] = {0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,63,48,48,48,48,0,0,0,0,0,0};
-u8 bitmap_92[] = {0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,126,112,64,0,0,0,0};
-u8 bitmap_93[] = {0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,48,48,48,48,63,63,0,0,0,0,0,0,0,0};
-u8 bitmap_94[] = {0,0,0,0,224,248,62,7,15,60,240,192,0,0,0,0,0,0,0,0,4,7,3,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_95[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0};
-u8 bitmap_96[] = {0,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_97[] = {0,0,0,192,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,225,241,57,24,24,24,24,24,24,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,6,3,15,15,0,0,0,0,0};
-u8 bitmap_98[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,15,15,15,6,12,12,12,14,14,7,3,0,0,0,0,0};
-u8 bitmap_99[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,131,131,130,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_100[] = {0,0,0,192,192,224,96,96,96,192,128,254,254,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,1,7,7,14,12,12,12,6,3,15,15,0,0,0,0,0};
-u8 bitmap_101[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,255,255,155,24,24,24,24,24,24,31,31,28,0,0,0,0,0,0,1,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_102[] = {0,0,128,128,128,128,252,254,142,134,134,134,134,134,0,0,0,0,0,0,1,1,1,1,255,255,1,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_103[] = {0,0,0,192,192,224,96,96,96,192,128,224,224,0,0,0,0,0,0,0,255,255,129,0,0,0,0,0,129,255,255,0,0,0,0,0,0,0,0,3,135,135,134,134,134,194,225,255,127,0,0,0,0,0};
-u8 bitmap_104[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_105[] = {0,0,0,96,96,96,98,103,231,231,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0};
-u8 bitmap_106[] = {0,0,0,96,96,96,96,96,103,231,231,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,128,128,128,128,128,192,224,127,63,0,0,0,0,0,0,0};
-u8 bitmap_107[] = {0,0,254,254,254,0,0,0,0,0,128,192,224,96,32,0,0,0,0,0,255,255,255,48,48,48,124,254,199,3,0,0,0,0,0,0,0,0,15,15,15,0,0,0,0,1,3,7,14,12,8,0,0,0};
-u8 bitmap_108[] = {0,6,6,6,6,6,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,7,14,12,12,12,12,12,0,0,0,0};
-u8 bitmap_109[] = {0,0,224,224,64,96,224,192,0,192,96,224,224,192,0,0,0,0,0,0,255,255,0,0,0,255,255,0,0,0,255,255,0,0,0,0,0,0,15,15,0,0,0,15,15,0,0,0,15,15,0,0,0,0};
-u8 bitmap_110[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_111[] = {0,0,0,128,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_112[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,255,255,255,6,12,12,12,14,14,7,3,0,0,0,0,0};
-u8 bitmap_113[] = {0,0,0,128,192,224,96,96,96,192,128,224,224,224,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,6,2,255,255,255,0,0,0,0};
-u8 bitmap_114[] = {0,0,0,224,224,128,192,96,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,1,0,0,0,0,0,1,7,7,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_115[] = {0,0,0,192,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,3,15,31,24,24,24,56,48,48,241,225,0,0,0,0,0,0,0,3,7,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_116[] = {0,0,96,96,96,96,254,254,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,7,14,12,12,12,12,0,0,0,0,0};
-u8 bitmap_117[] = {0,0,224,224,224,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
-u8 bitmap_118[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,63,252,224,0,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,1,15,15,15,7,0,0,0,0,0,0,0,0};
-u8 bitmap_119[] = {0,224,224,0,0,0,192,224,224,0,0,0,128,224,96,0,0,0,0,3,255,252,0,224,255,1,15,254,0,128,255,127,0,0,0,0,0,0,3,15,8,15,0,0,0,7,15,15,15,0,0,0,0,0};
-u8 bitmap_120[] = {0,0,32,224,224,128,0,0,0,0,192,224,96,32,0,0,0,0,0,0,0,0,129,199,255,124,126,239,195,1,0,0,0,0,0,0,0,8,12,14,7,3,0,0,0,1,3,15,14,8,0,0,0,0};
-u8 bitmap_121[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,31,254,240,128,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,128,243,255,63,7,0,0,0,0,0,0,0,0};
-u8 bitmap_122[] = {0,0,96,96,96,96,96,96,96,96,96,224,224,0,0,0,0,0,0,0,0,0,192,224,112,56,28,14,7,3,1,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_123[] = {0,0,0,0,0,0,0,135,255,255,0,0,0,0,0,0,0,0,0,0,3,3,3,3,3,7,253,248,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,31,31,56,48,48,0,0,0,0,0};
-u8 bitmap_124[] = {0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,127,127,0,0,0,0,0,0,0,0,0};
-u8 bitmap_125[] = {0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,252,255,7,3,3,3,3,0,0,0,0,0,0,0,48,48,48,56,31,15,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_126[] = {0,0,0,128,128,128,128,0,0,0,0,0,128,128,0,0,0,0,0,0,15,15,1,1,3,7,14,12,12,14,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 *char_addr[] = {bitmap_32,bitmap_33,bitmap_34,bitmap_35,bitmap_36,bitmap_37,bitmap_38,bitmap_39,bitmap_40,bitmap_41,bitmap_42,bitmap_43,bitmap_44,bitmap_45,bitmap_46,bitmap_47,bitmap_48,bitmap_49,bitmap_50,bitmap_51,bitmap_52,bitmap_53,bitmap_54,bitmap_55,bitmap_56,bitmap_57,bitmap_58,bitmap_59,bitmap_60,bitmap_61,bitmap_62,bitmap_63,bitmap_64,bitmap_65,bitmap_66,bitmap_67,bitmap_68,bitmap_69,bitmap_70,bitmap_71,bitmap_72,bitmap_73,bitmap_74,bitmap_75,bitmap_76,bitmap_77,bitmap_78,bitmap_79,bitmap_80,bitmap_81,bitmap_82,bitmap_83,bitmap_84,bitmap_85,bitmap_86,bitmap_87,bitmap_88,bitmap_89,bitmap_90,bitmap_91,bitmap_92,bitmap_93,bitmap_94,bitmap_95,bitmap_96,bitmap_97,bitmap_98,bitmap_99,bitmap_100,bitmap_101,bitmap_102,bitmap_103,bitmap_104,bitmap_105,bitmap_106,bitmap_107,bitmap_108,bitmap_109,bitmap_110,bitmap_111,bitmap_112,bitmap_113,bitmap_114,bitmap_115,bitmap_116,bitmap_117,bitmap_118,bitmap_119,bitmap_120,bitmap_121,bitmap_122,bitmap_123,bitmap_124,bitmap_125,bitmap_126};
+#define SPRITE_BATCH_MAX_TEXTURES 256
+#define SPRITES_PER_CHUNK 4096
 
+struct Sprite {
+    const Texture *texture;
+    Rect bounds; // Where it goes on the canvas (in pixels, the right and bottom edges being where it ends)
+    Rect uv; // The part of the texture it shows
+    Color tint;
+    f32 opacity;
+    u32 key; // The layer, texture and mip it gets sorted by (the lowest 8 bits being the mip level)
+};
 
+namespace sprites {
+    // Maps a sprite onto the canvas as a blit of the texels its uv rect covers (widened to whole texels).
+    // Returns false when nothing of it would get drawn:
+    bool map(const Sprite &sprite, ImageFilter filter, const Canvas &canvas, ImageBlit &blit) {
+        const Texture &texture = *sprite.texture;
+        const TextureMip &texture_mip = texture.mips[sprite.key & 255];
+        const Rect &uv = sprite.uv;
+        const f32 mip_width = (f32)texture_mip.width;
+        const f32 mip_height = (f32)texture_mip.height;
+
+        // From texels of the texture to canvas pixels, then scaled to texels of the mip (as in drawImage() of a Texture):
+        const f32 scale_x = (sprite.bounds.right - sprite.bounds.left) / ((uv.right - uv.left) * (f32)texture.width);
+        const f32 scale_y = (sprite.bounds.bottom - sprite.bounds.top) / ((uv.bottom - uv.top) * (f32)texture.height);
+        const mat2 transform{
+                scale_x * ((f32)texture.width / mip_width), 0.0f,
+                0.0f, scale_y * ((f32)texture.height / mip_height)
+        };
 
-void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RectI bounds{
-            0, canvas.dimensions.width - 1,
-            0, canvas.dimensions.height - 1
-    };
-    if (viewport_bounds) {
-        x += viewport_bounds->left;
-        y += viewport_bounds->top;
-        bounds -= *viewport_bounds;
-    }
-
-    if (x + FONT_WIDTH < bounds.left || x - FONT_WIDTH > bounds.right ||
-        y + FONT_HEIGHT < bounds.top || y - FONT_HEIGHT > bounds.bottom)
-        return;
-
-    f32 pixel_opacity;
-    u16 current_x = (u16)x;
-    u16 current_y = (u16)y;
-    u16 pixel_x, sub_pixel_x;
-    u16 pixel_y, sub_pixel_y;
-    u16 t_offset;
-    u8 *byte_ptr, byte, next_column_byte;
-    char character = *str;
-    while (character) {
-        if (character == '\n') {
-            if (current_y > bounds.bottom)
-                break;
+        const f32 u0 = uv.left * mip_width;
+        const f32 u1 = uv.right * mip_width;
+        const f32 v0 = uv.top * mip_height;
+        const f32 v1 = uv.bottom * mip_height;
+        const i32 x0 = (i32)clampedValue(floorf(u0), 0.0f, mip_width);
+        const i32 x1 = (i32)clampedValue(ceilf(u1), 0.0f, mip_width);
+        const i32 y0 = (i32)clampedValue(floorf(v0), 0.0f, mip_height);
+        const i32 y1 = (i32)clampedValue(ceilf(v1), 0.0f, mip_height);
+        if (x1 <= x0 || y1 <= y0)
+            return false;
+
+        blit = ImageBlit{texture_mip, filter, sprite.opacity, texture.texelLayout()};
+        if (blit.format == BlitFormatTiledTexelQuads) {
+            blit.quad_x = x0;
+            blit.quad_y = y0;
+        } else
+            blit.content = texture_mip.texel_quads + y0 * blit.stride + x0;
+        blit.width = x1 - x0;
+        blit.height = y1 - y0;
+        blit.tint = sprite.tint;
+        vec2 translation{
+                sprite.bounds.left + ((f32)x0 - u0) * transform.X.x,
+                sprite.bounds.top  + ((f32)y0 - v0) * transform.Y.y
+        };
+        if (!blit.map(transform, translation, canvas))
+            return false;
+
+        if ((f32)x0 == u0 && (f32)x1 == u1 && (f32)y0 == v0 && (f32)y1 == v1)
+            return true;
+
+        // The texels it was widened by get cut off at the pixels whose centers are outside of the sprite:
+        const i32 left = (i32)ceilf(sprite.bounds.left - 0.5f);
+        const i32 right = (i32)ceilf(sprite.bounds.right - 0.5f) - 1;
+        const i32 top = (i32)ceilf(sprite.bounds.top - 0.5f);
+        const i32 bottom = (i32)ceilf(sprite.bounds.bottom - 0.5f) - 1;
+        if (right < left || bottom < top)
+            return false;
+
+        blit.bounds -= RectI{left, right, top, bottom};
+        return !!blit.bounds;
+    }
+
+    // Sorts the keys along with the sprite indices (stably, a byte at a time), skipping bytes that all keys share.
+    // The sorted keys and indices end up in either of the given pairs of buffers, which get swapped accordingly:
+    void sort(u32 *&keys, u32 *&indices, u32 *&other_keys, u32 *&other_indices, u32 count) {
+        u32 offsets[256];
+        for (u32 shift = 0; shift < 32; shift += 8) {
+            for (u32 i = 0; i < 256; i++) offsets[i] = 0;
+            for (u32 i = 0; i < count; i++) offsets[(keys[i] >> shift) & 255]++;
+            if (offsets[(keys[0] >> shift) & 255] == count)
+                continue;
 
-            current_x = (u16)x;
-            current_y += LINE_HEIGHT;
-        } else if (character == '\t') {
-            t_offset = FONT_WIDTH * (4 - ((current_x / FONT_WIDTH) & 3));
-            current_x += t_offset;
-        } else if ((character >= FIRST_CHARACTER_CODE) &&
-                   (character <= LAST_CHARACTER_CODE)) {
-            byte_ptr = char_addr[character - FIRST_CHARACTER_CODE];
-            byte = *byte_ptr;
-            next_column_byte = *(byte_ptr + 1);
-            for (int i = 1; i < 4; i++) {
-                pixel_x = current_x;
-                pixel_y = current_y + i * FONT_HEIGHT / 3;
-                for (int w = 0; w < INTERNAL_FONT_WIDTH ; w += 2) {
-                    for (int h = 0; h < 8; h += 2) {
-                        /* skip background bits */
-                        if (bounds.contains(pixel_x, pixel_y)) {
-                            if (canvas.antialias == SSAA) {
-                                sub_pixel_x = pixel_x << 1;
-                                sub_pixel_y = pixel_y << 1;
+            u32 offset = 0;
+            for (u32 i = 0; i < 256; i++) {
+                u32 digit_count = offsets[i];
+                offsets[i] = offset;
+                offset += digit_count;
+            }
+            for (u32 i = 0; i < count; i++) {
+                u32 to = offsets[(keys[i] >> shift) & 255]++;
+                other_keys[to] = keys[i];
+                other_indices[to] = indices[i];
+            }
+            swap(&keys, &other_keys);
+            swap(&indices, &other_indices);
+        }
+    }
 
-                                if (byte & (0x80 >> h)) canvas.setPixel(sub_pixel_x, sub_pixel_y + 1, color, opacity);
-                                if (byte & (0x80 >> (h+1))) canvas.setPixel(sub_pixel_x, sub_pixel_y, color, opacity);
-                                if (next_column_byte & (0x80 >> h)) canvas.setPixel(sub_pixel_x+1, sub_pixel_y + 1, color, opacity);
-                                if (next_column_byte & (0x80 >> (h+1))) canvas.setPixel(sub_pixel_x+1, sub_pixel_y, color, opacity);
-                            } else {
-                                pixel_opacity = (byte & (0x80 >> h)) ? 0.25f : 0;
-                                if (byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
-                                if (next_column_byte & (0x80 >> h)) pixel_opacity += 0.25f;
-                                if (next_column_byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
-                                if (pixel_opacity != 0.0f) canvas.setPixel(pixel_x, pixel_y, color, pixel_opacity);
-                            }
-                        }
+    // The state of drawing a batch, with the sprites of each tile listed in their sorted order:
+    struct Frame {
+        const Canvas *canvas;
+        const Sprite *sprites;
+        ImageFilter filter;
+        u32 count;
+        u32 chunk_count;
+        u32 tile_column_count;
+
+        ImageBlit *blits;
+        u8 *is_visible;
+        u32 *tile_offsets; // Per tile, where its bin starts
+        u32 *bins;
+
+        static void setupChunk(void *data, u32 chunk) {
+            Frame &frame = *(Frame*)data;
+            u32 end = (chunk + 1) * SPRITES_PER_CHUNK;
+            if (end > frame.count) end = frame.count;
+            for (u32 i = chunk * SPRITES_PER_CHUNK; i < end; i++)
+                frame.is_visible[i] = map(frame.sprites[i], frame.filter, *frame.canvas, frame.blits[i]);
+        }
 
-                        pixel_y--;
-                    }
-                    byte_ptr += 2;
-                    byte = *byte_ptr;
-                    next_column_byte = *(byte_ptr + 1);
+        // Calls tile_function(tile_index) for each tile overlapped by the bounds:
+        template <typename TileFunction>
+        INLINE void forEachTile(const RectI &bounds, const TileFunction &tile_function) const {
+            for (i32 tile_y = bounds.top >> CANVAS_TILE_SIZE_SHIFT; tile_y <= (bounds.bottom >> CANVAS_TILE_SIZE_SHIFT); tile_y++)
+                for (i32 tile_x = bounds.left >> CANVAS_TILE_SIZE_SHIFT; tile_x <= (bounds.right >> CANVAS_TILE_SIZE_SHIFT); tile_x++)
+                    tile_function(tile_y * tile_column_count + tile_x);
+        }
 
-                    pixel_y += FONT_HEIGHT / 3;
-                    pixel_x++;
-                }
+        template <AntiAliasing AA>
+        void drawTile(const RectI &tile) const {
+            u32 tile_index = (tile.top >> CANVAS_TILE_SIZE_SHIFT) * tile_column_count + (tile.left >> CANVAS_TILE_SIZE_SHIFT);
+            if (tile_offsets[tile_index] == tile_offsets[tile_index + 1])
+                return;
+
+            canvas->markDirty(tile);
+            for (u32 i = tile_offsets[tile_index]; i < tile_offsets[tile_index + 1]; i++) {
+                const ImageBlit &blit = blits[bins[i]];
+                drawBlitRows<AA>(blit, *canvas, blit.bounds - tile);
             }
+        }
+    };
+}
 
-            current_x += FONT_WIDTH;
-            if (current_x > bounds.right) {
-                if (current_y > bounds.bottom)
+// Sprites added for a frame, drawn (and then discarded) by draw(). Sprites are to be added from one thread at a time:
+struct SpriteBatch {
+    memory::MonotonicAllocator memory;
+    Sprite *sprites;
+    u32 count{0};
+    const Texture *textures[SPRITE_BATCH_MAX_TEXTURES];
+    u32 texture_count{0};
+
+    explicit SpriteBatch(u64 capacity = SPRITE_BATCH_CAPACITY) : memory{capacity}, sprites{(Sprite*)memory.address} {}
+
+    // Adds a sprite showing the uv rect of the texture within the given bounds (in pixels), in the layer given (lower ones
+    // being drawn first). Mipmapped textures are drawn from the mip closest to a texel per pixel.
+    // Returns false when the batch is full (of sprites, or of distinct textures):
+    bool add(const Texture &texture, const Rect &bounds, const Rect &uv = Rect{0.0f, 1.0f, 0.0f, 1.0f},
+             const Color &tint = White, f32 opacity = 1.0f, u16 layer = 0) {
+        const f32 width = bounds.right - bounds.left;
+        const f32 height = bounds.bottom - bounds.top;
+        const f32 uv_width = uv.right - uv.left;
+        const f32 uv_height = uv.bottom - uv.top;
+        if (!texture.mips || width <= 0 || height <= 0 || uv_width <= 0 || uv_height <= 0 || opacity <= 0)
+            return true;
+
+        u32 texture_id = texture_count;
+        if (texture_count && textures[texture_count - 1] == &texture) // Likely added in runs of the same texture
+            texture_id = texture_count - 1;
+        else
+            for (u32 i = 0; i < texture_count; i++)
+                if (textures[i] == &texture) {
+                    texture_id = i;
                     break;
+                }
+        if (texture_id == SPRITE_BATCH_MAX_TEXTURES)
+            return false;
+
+        Sprite *sprite = (Sprite*)memory.allocate(sizeof(Sprite));
+        if (!sprite)
+            return false;
+
+        if (texture_id == texture_count)
+            textures[texture_count++] = &texture;
+
+        // The mip gets picked the way drawImage() picks it for a Texture, by how much the sprite shrinks texels:
+        u32 mip_level = getMipLevel(texture, mat2{
+                width / (uv_width * (f32)texture.width), 0.0f,
+                0.0f, height / (uv_height * (f32)texture.height)
+        });
+
+        sprite->texture = &texture;
+        sprite->bounds = bounds;
+        sprite->uv = uv;
+        sprite->tint = tint;
+        sprite->opacity = opacity > 1.0f ? 1.0f : opacity;
+        sprite->key = ((u32)layer << 16) | (texture_id << 8) | mip_level;
+        count++;
+        return true;
+    }
+
+    // Draws all of the sprites added since the last draw (then empties the batch):
+    void draw(const Canvas &canvas, ImageFilter filter = ImageFilterBilinear) {
+        if (!count) return;
+
+        sprites::Frame frame;
+        frame.canvas = &canvas;
+        frame.sprites = sprites;
+        frame.filter = filter;
+        frame.count = count;
+        frame.chunk_count = (count + SPRITES_PER_CHUNK - 1) / SPRITES_PER_CHUNK;
+        frame.tile_column_count = canvas.getTileColumnCount();
+        u32 tile_count = frame.tile_column_count * canvas.getTileRowCount();
+
+        // The scratch memory comes after the sprites (and goes away with them):
+        frame.blits        = (ImageBlit*)memory.allocate(sizeof(ImageBlit) * count);
+        frame.is_visible   = (u8*)memory.allocate(count);
+        u32 *keys          = (u32*)memory.allocate(sizeof(u32) * count);
+        u32 *indices       = (u32*)memory.allocate(sizeof(u32) * count);
+        u32 *other_keys    = (u32*)memory.allocate(sizeof(u32) * count);
+        u32 *other_indices = (u32*)memory.allocate(sizeof(u32) * count);
+        frame.tile_offsets = (u32*)memory.allocate(sizeof(u32) * (tile_count + 1));
+        u32 *tile_ends     = (u32*)memory.allocate(sizeof(u32) * tile_count);
+        if (!frame.blits || !frame.is_visible || !keys || !indices || !other_keys || !other_indices || !frame.tile_offsets || !tile_ends) {
+            // Too many, draw them one by one in the order they were added:
+            ImageBlit blit;
+            for (u32 i = 0; i < count; i++)
+                if (sprites::map(sprites[i], filter, canvas, blit))
+                    drawBlit(blit, canvas);
+            reset();
+            return;
+        }
 
-                while (character && (character != '\n')) character = *++str;
-                if (!character)
-                    break;
+        jobs::run(sprites::Frame::setupChunk, &frame, frame.chunk_count);
 
-                current_x = (u16)x;
-                current_y += LINE_HEIGHT;
+        u32 visible_count = 0;
+        for (u32 i = 0; i < count; i++)
+            if (frame.is_visible[i]) {
+                keys[visible_count] = sprites[i].key;
+                indices[visible_count] = i;
+                visible_count++;
             }
+        if (!visible_count) {
+            reset();
+            return;
         }
-        character = *++str;
+        sprites::sort(keys, indices, other_keys, other_indices, visible_count);
+
+        // Lay the bins out tile after tile, each in sorted order:
+        u32 *tile_offsets = frame.tile_offsets;
+        for (u32 i = 0; i <= tile_count; i++) tile_offsets[i] = 0;
+        for (u32 i = 0; i < visible_count; i++) // Counting into the next tile's offset first
+            frame.forEachTile(frame.blits[indices[i]].bounds, [&](u32 tile) { tile_offsets[tile + 1]++; });
+        for (u32 i = 1; i <= tile_count; i++) tile_offsets[i] += tile_offsets[i - 1];
+
+        frame.bins = (u32*)memory.allocate(sizeof(u32) * frame.tile_offsets[tile_count]);
+        if (!frame.bins) { // Too many tiles overlapped, draw them one by one in sorted order:
+            for (u32 i = 0; i < visible_count; i++)
+                drawBlit(frame.blits[indices[i]], canvas);
+            reset();
+            return;
+        }
+        for (u32 i = 0; i < tile_count; i++) tile_ends[i] = tile_offsets[i];
+        for (u32 i = 0; i < visible_count; i++)
+            frame.forEachTile(frame.blits[indices[i]].bounds, [&](u32 tile) { frame.bins[tile_ends[tile]++] = indices[i]; });
+
+        RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+        switch (canvas.antialias) {
+            case NoAA: parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { frame.drawTile<NoAA>(tile); }); break;
+            case MSAA: parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { frame.drawTile<MSAA>(tile); }); break;
+            case SSAA: parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { frame.drawTile<SSAA>(tile); }); break;
+        }
+        reset();
     }
-}
 
-INLINE void Canvas::drawText(char *str, i32 x, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawText(str, x, y, *this, color, opacity, viewport_bounds);
-}
-#ifdef SLIM_VEC2
-INLINE void Canvas::drawText(char *str, vec2i position, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawText(str, position.x, position.y, *this, color, opacity, viewport_bounds);
+    void reset() {
+        memory.reset();
+        count = 0;
+        texture_count = 0;
+    }
+};
+
+
+template <typename T>
+u32 getSizeInBytes(const Image<T> &image) {
+    return sizeof(T) * image.size * (image.flags.channel ? (image.flags.alpha ? 4 : 3) : 1);
 }
-INLINE void Canvas::drawText(char *str, vec2 position, const Color &color, f32 opacity, const RectI *viewport_bounds) const  {
-    _drawText(str, (i32)position.x, (i32)position.y, *this, color, opacity, viewport_bounds);
+
+template <typename T>
+bool allocateMemory(Image<T> &image, memory::MonotonicAllocator *memory_allocator) {
+    u32 size = getSizeInBytes(image);
+    if (size > (memory_allocator->capacity - memory_allocator->occupied)) return false;
+    image.content = (T*)memory_allocator->allocate(size);
+    return true;
 }
-#endif
 
-INLINE void drawText(char *str, i32 x, i32 y, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawText(str, x, y, canvas, color, opacity, viewport_bounds);
+template <typename T>
+void readContent(Image<T> &image, void *file) {
+    os::readFromFile((void*)image.content, getSizeInBytes(image), file);
 }
 
-#ifdef SLIM_VEC2
-INLINE void drawText(char *str, vec2i position, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawText(str, position.x, position.y, canvas, color, opacity, viewport_bounds);
+template <typename T>
+void writeContent(const Image<T> &image, void *file) {
+    os::writeToFile((void*)image.content, getSizeInBytes(image), file);
 }
-INLINE void drawText(char *str, vec2 position, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawText(str, (i32)position.x, (i32)position.y, canvas, color, opacity, viewport_bounds);
+
+template <typename T>
+u32 getTotalMemoryForImages(String *image_files, u32 image_count) {
+    u32 memory_size{0};
+    for (u32 i = 0; i < image_count; i++) {
+        Image<T> image;
+        loadHeader(image, image_files[i].char_ptr);
+        memory_size += getSizeInBytes(image);
+    }
+    return memory_size;
 }
-#endif
 
+template <typename T>
+struct ImagePack {
+    ImagePack(u8 count, Image<T> *images, char **files, char* adjacent_file, u64 memory_base = Terabytes(3)) {
+        char string_buffer[200];
+        u32 memory_size{0};
+        Image<T> *image = images;
+        for (u32 i = 0; i < count; i++, image++) {
+            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
+            loadHeader(*image, string.char_ptr);
+            memory_size += getSizeInBytes(*image);
+        }
+        memory::MonotonicAllocator memory_allocator{memory_size, memory_base};
 
-void _drawNumber(i32 number, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    static NumberString number_string;
-    number_string = number;
-    _drawText(number_string.string.char_ptr, x - (i32)number_string.string.length * FONT_WIDTH, y, canvas, color, opacity, viewport_bounds);
-}
+        image = images;
+        for (u32 i = 0; i < count; i++, image++) {
+            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
+            load(*image, string.char_ptr, &memory_allocator);
+        }
+    }
+};
 
-INLINE void Canvas::drawNumber(i32 number, i32 x, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawNumber(number, x, y, *this, color, opacity, viewport_bounds);
-}
 
-#ifdef SLIM_VEC2
-INLINE void Canvas::drawNumber(i32 number, vec2i position, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawNumber(number, position.x, position.y, *this, color, opacity, viewport_bounds);
-}
-INLINE void Canvas::drawNumber(i32 number, vec2 position, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
-    _drawNumber(number, (i32)position.x, (i32)position.y, *this, color, opacity, viewport_bounds);
+u32 getSizeInBytes(const Texture &texture) {
+    u32 mip_width  = texture.width;
+    u32 mip_height = texture.height;
+    u32 memory_size = 0;
+
+    do {
+        memory_size += sizeof(TextureMip);
+        memory_size += TextureMip::GetQuadCount(mip_width, mip_height, texture.texelLayout()) * sizeof(TexelQuad);
+
+        mip_width /= 2;
+        mip_height /= 2;
+    } while (texture.flags.mipmap && mip_width > 2 && mip_height > 2);
+
+    return memory_size;
 }
-#endif
 
-INLINE void drawNumber(i32 number, i32 x, i32 y, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawNumber(number, x, y, canvas, color, opacity, viewport_bounds);
+bool allocateMemory(Texture &texture, memory::MonotonicAllocator *memory_allocator) {
+    u32 size = getSizeInBytes(texture);
+    if (size > (memory_allocator->capacity - memory_allocator->occupied)) return false;
+    texture.mips = (TextureMip*)memory_allocator->allocate(sizeof(TextureMip) * texture.mip_count);
+    TextureMip *texture_mip = texture.mips;
+    u32 mip_width  = texture.width;
+    u32 mip_height = texture.height;
+
+    do {
+        texture_mip->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * TextureMip::GetQuadCount(mip_width, mip_height, texture.texelLayout()));
+        mip_width /= 2;
+        mip_height /= 2;
+        texture_mip++;
+    } while (texture.flags.mipmap && mip_width > 2 && mip_height > 2);
+
+    return true;
 }
 
-#ifdef SLIM_VEC2
-INLINE void drawNumber(i32 number, vec2i position, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawNumber(number, position.x, position.y, canvas, color, opacity, viewport_bounds);
+void readContent(Texture &texture, void *file) {
+    TextureMip *texture_mip = texture.mips;
+    for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
+        os::readFromFile(&texture_mip->width,  sizeof(u32), file);
+        os::readFromFile(&texture_mip->height, sizeof(u32), file);
+        os::readFromFile(texture_mip->texel_quads, sizeof(TexelQuad) * TextureMip::GetQuadCount(texture_mip->width, texture_mip->height, texture.texelLayout()), file);
+    }
 }
-INLINE void drawNumber(i32 number, vec2 position, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
-    _drawNumber(number, (i32)position.x, (i32)position.y, canvas, color, opacity, viewport_bounds);
+void writeContent(const Texture &texture, void *file) {
+    TextureMip *texture_mip = texture.mips;
+    for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
+        os::writeToFile(&texture_mip->width,  sizeof(u32), file);
+        os::writeToFile(&texture_mip->height, sizeof(u32), file);
+        os::writeToFile(texture_mip->texel_quads, sizeof(TexelQuad) * TextureMip::GetQuadCount(texture_mip->width, texture_mip->height, texture.texelLayout()), file);
+    }
 }
-#endif
 
-void drawHUD(const HUD &hud, const Canvas &canvas, const RectI *viewport_bounds = nullptr) {
-    i32 x = hud.left;
-    i32 y = hud.top;
-
-    HUDLine *line = hud.lines;
-    bool alt;
-    for (u32 i = 0; i < hud.settings.line_count; i++, line++) {
-        if (line->use_alternate) {
-            alt = *line->use_alternate;
-            if (line->invert_alternate_use)
-                alt = !alt;
-        } else
-            alt = false;
-
-        ColorID color = alt ? line->alternate_value_color : line->value_color;
-        char *text = alt ? line->alternate_value.char_ptr : line->value.string.char_ptr;
-        _drawText(line->title.char_ptr, x, y, canvas, line->title_color, 1.0f, viewport_bounds);
-        _drawText(text, x + (i32)line->title.length * FONT_WIDTH, y, canvas, color, 1.0f, viewport_bounds);
-        y += (i32)(hud.settings.line_height * (f32)FONT_HEIGHT);
+u32 getTotalMemoryForTextures(String *texture_files, u32 texture_count) {
+    u32 memory_size{0};
+    for (u32 i = 0; i < texture_count; i++) {
+        Texture texture;
+        loadHeader(texture, texture_files[i].char_ptr);
+        memory_size += getSizeInBytes(texture);
     }
+    return memory_size;
 }
 
+struct TexturePack {
+    TexturePack(u8 count, Texture *textures, char **files, char* adjacent_file, u64 memory_base = Terabytes(3)) {
+        char string_buffer[200];
+        u32 memory_size{0};
+        Texture *texture = textures;
+        for (u32 i = 0; i < count; i++, texture++) {
+            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
+            loadHeader(*texture, string.char_ptr);
+            memory_size += getSizeInBytes(*texture);
+        }
+        memory::MonotonicAllocator memory_allocator{memory_size, memory_base};
+
+        texture = textures;
+        for (u32 i = 0; i < count; i++, texture++) {
+            String string = String::getFilePath(files[i], string_buffer, adjacent_file);
+            load(*texture, string.char_ptr, &memory_allocator);
+        }
+    }
+};
 
 
 struct SlimApp {
@@ -4318,14 +9081,16 @@ struct SlimApp {
 
 SlimApp* createApp();
 
-
-#ifdef __linux__
-//linux code goes here
-#elif _WIN32
+#ifdef _WIN32
+#ifndef SLIM_SINGLE_HEADER_PLATFORMS_WIN32_H
+#define SLIM_SINGLE_HEADER_PLATFORMS_WIN32_H
+#ifndef SLIM_SINGLE_HEADER_PLATFORMS_WIN32_BASE_H
+#define SLIM_SINGLE_HEADER_PLATFORMS_WIN32_BASE_H
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
+
 #ifndef NDEBUG
 #include <tchar.h>
 #include <stdio.h>
@@ -4451,12 +9216,56 @@ void* os::getMemory(u64 size, u64 base) {
     return VirtualAlloc((LPVOID)base, (SIZE_T)size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
 }
 
+struct Win32ThreadStart {
+    os::ThreadFunction thread_function;
+    void *parameter;
+};
+#define MAX_THREAD_COUNT 256
+Win32ThreadStart win32_thread_starts[MAX_THREAD_COUNT];
+u32 win32_thread_count = 0;
+
+DWORD WINAPI win32_threadProc(LPVOID thread_start) {
+    ((Win32ThreadStart*)thread_start)->thread_function(((Win32ThreadStart*)thread_start)->parameter);
+    return 0;
+}
+
+u32 os::getCoreCount() {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return (u32)system_info.dwNumberOfProcessors;
+}
+
+bool os::createThread(ThreadFunction thread_function, void *parameter) {
+    if (win32_thread_count == MAX_THREAD_COUNT) return false;
+    Win32ThreadStart *thread_start = win32_thread_starts + win32_thread_count;
+    thread_start->thread_function = thread_function;
+    thread_start->parameter = parameter;
+
+    HANDLE thread = CreateThread(nullptr, 0, win32_threadProc, thread_start, 0, nullptr);
+    if (!thread) return false;
+    CloseHandle(thread);
+    win32_thread_count++;
+    return true;
+}
+
+void* os::createSemaphore(u32 initial_count) {
+    return CreateSemaphoreA(nullptr, (LONG)initial_count, MAXLONG, nullptr);
+}
+
+void os::signalSemaphore(void *semaphore, u32 count) {
+    if (count) ReleaseSemaphore(semaphore, (LONG)count, nullptr);
+}
+
+void os::waitForSemaphore(void *semaphore) {
+    WaitForSingleObject(semaphore, INFINITE);
+}
+
 void os::closeFile(void *handle) { return win32_closeFile(handle); }
 void* os::openFileForReading(const char* path) { return win32_openFileForReading(path); }
 void* os::openFileForWriting(const char* path) { return win32_openFileForWriting(path); }
 bool os::readFromFile(LPVOID out, DWORD size, HANDLE handle) { return win32_readFromFile(out, size, handle); }
 bool os::writeToFile(LPVOID out, DWORD size, HANDLE handle) { return win32_writeToFile(out, size, handle); }
-
+#endif
 
 #define GET_X_LPARAM(lp)                        ((int)(short)LOWORD(lp))
 #define GET_Y_LPARAM(lp)                        ((int)(short)HIWORD(lp))
@@ -4488,9 +9297,19 @@ inline bool hasRawMouseInput(LPARAM lParam) {
 }
 
 
-
 SlimApp *CURRENT_APP;
 
+void presentWindowRect(const RectI &rect) {
+    // Presented as a DIB of only the rows covered, so that the source offset does not depend on the DIB orientation:
+    BITMAPINFO rows_info = info;
+    i32 rows = rect.bottom - rect.top + 1;
+    rows_info.bmiHeader.biHeight = -rows;
+    SetDIBitsToDevice(win_dc,
+                      rect.left, rect.top, rect.right - rect.left + 1, rows,
+                      rect.left, 0, 0, rows,
+                      (u32*)window::content + window::width * rect.top, &rows_info, DIB_RGB_COLORS);
+}
+
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
     bool pressed = message == WM_SYSKEYDOWN || message == WM_KEYDOWN;
     u8 key = (u8)wParam;
@@ -4569,150 +9388,1009 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
                     mouse_button = &mouse::left_button;
             }
 
-            switch (message) {
-                case WM_MBUTTONDBLCLK:
-                case WM_RBUTTONDBLCLK:
-                case WM_LBUTTONDBLCLK:
+            switch (message) {
+                case WM_MBUTTONDBLCLK:
+                case WM_RBUTTONDBLCLK:
+                case WM_LBUTTONDBLCLK:
+                    mouse_button->doubleClick(x, y);
+                    mouse::double_clicked = true;
+                    CURRENT_APP->OnMouseButtonDoubleClicked(*mouse_button);
+                    break;
+                case WM_MBUTTONUP:
+                case WM_RBUTTONUP:
+                case WM_LBUTTONUP:
+                    mouse_button->up(x, y);
+                    CURRENT_APP->OnMouseButtonUp(*mouse_button);
+                    break;
+                default:
+                    mouse_button->down(x, y);
+                    CURRENT_APP->OnMouseButtonDown(*mouse_button);
+            }
+
+            break;
+
+        case WM_MOUSEWHEEL:
+            scroll_amount = (f32)(GET_WHEEL_DELTA_WPARAM(wParam)) / (f32)(WHEEL_DELTA);
+            mouse::scroll(scroll_amount); CURRENT_APP->OnMouseWheelScrolled(scroll_amount);
+            break;
+
+        case WM_MOUSEMOVE:
+            x = GET_X_LPARAM(lParam);
+            y = GET_Y_LPARAM(lParam);
+            mouse::move(x, y);        CURRENT_APP->OnMouseMovementSet(x, y);
+            mouse::setPosition(x, y); CURRENT_APP->OnMousePositionSet(x, y);
+            break;
+
+        case WM_INPUT:
+            if ((hasRawMouseInput(lParam)) && (
+                    raw_inputs.data.mouse.lLastX != 0 ||
+                    raw_inputs.data.mouse.lLastY != 0)) {
+                x = raw_inputs.data.mouse.lLastX;
+                y = raw_inputs.data.mouse.lLastY;
+                mouse::moveRaw(x, y); CURRENT_APP->OnMouseRawMovementSet(x, y);
+            }
+
+        default:
+            return DefWindowProcA(hWnd, message, wParam, lParam);
+    }
+
+    return 0;
+}
+
+int APIENTRY WinMain(HINSTANCE hInstance,
+                     HINSTANCE hPrevInstance,
+                     LPSTR     lpCmdLine,
+                     int       nCmdShow) {
+    void* window_content_and_canvas_memory = GlobalAlloc(GPTR, WINDOW_CONTENT_SIZE + (CANVAS_SIZE * CANVAS_COUNT));
+    if (!window_content_and_canvas_memory)
+        return -1;
+
+    window::content = (u32*)window_content_and_canvas_memory;
+    memory::canvas_memory = (u8*)window_content_and_canvas_memory + WINDOW_CONTENT_SIZE;
+
+    controls::key_map::ctrl = VK_CONTROL;
+    controls::key_map::alt = VK_MENU;
+    controls::key_map::shift = VK_SHIFT;
+    controls::key_map::space = VK_SPACE;
+    controls::key_map::tab = VK_TAB;
+    controls::key_map::escape = VK_ESCAPE;
+    controls::key_map::left = VK_LEFT;
+    controls::key_map::right = VK_RIGHT;
+    controls::key_map::up = VK_UP;
+    controls::key_map::down = VK_DOWN;
+
+    LARGE_INTEGER performance_frequency;
+    QueryPerformanceFrequency(&performance_frequency);
+
+    timers::ticks_per_second = (u64)performance_frequency.QuadPart;
+    timers::seconds_per_tick = 1.0 / (f64)(timers::ticks_per_second);
+    timers::milliseconds_per_tick = 1000.0 * timers::seconds_per_tick;
+    timers::microseconds_per_tick = 1000.0 * timers::milliseconds_per_tick;
+    timers::nanoseconds_per_tick  = 1000.0 * timers::microseconds_per_tick;
+
+    CURRENT_APP = createApp();
+    if (!CURRENT_APP->is_running)
+        return -1;
+
+    info.bmiHeader.biSize        = sizeof(info.bmiHeader);
+    info.bmiHeader.biCompression = BI_RGB;
+    info.bmiHeader.biBitCount    = 32;
+    info.bmiHeader.biPlanes      = 1;
+
+    window_class.lpszClassName  = "RnDer";
+    window_class.hInstance      = hInstance;
+    window_class.lpfnWndProc    = WndProc;
+    window_class.style          = CS_OWNDC|CS_HREDRAW|CS_VREDRAW|CS_DBLCLKS;
+    window_class.hCursor        = LoadCursorA(nullptr, MAKEINTRESOURCEA(32512));
+
+    if (!RegisterClassA(&window_class)) return -1;
+
+    win_rect.top = 0;
+    win_rect.left = 0;
+    win_rect.right  = window::width;
+    win_rect.bottom = window::height;
+    AdjustWindowRect(&win_rect, WS_OVERLAPPEDWINDOW, false);
+
+    window_handle = CreateWindowA(
+            window_class.lpszClassName,
+            window::title,
+            WS_OVERLAPPEDWINDOW,
+
+            CW_USEDEFAULT,
+            CW_USEDEFAULT,
+            win_rect.right - win_rect.left,
+            win_rect.bottom - win_rect.top,
+
+            nullptr,
+            nullptr,
+            hInstance,
+            nullptr
+    );
+    if (!window_handle)
+        return -1;
+
+    raw_input_device.usUsagePage = 0x01;
+    raw_input_device.usUsage = 0x02;
+    if (!RegisterRawInputDevices(&raw_input_device, 1, sizeof(raw_input_device)))
+        return -1;
+
+    win_dc = GetDC(window_handle);
+
+    SetICMMode(win_dc, ICM_OFF);
+
+    ShowWindow(window_handle, nCmdShow);
+
+    MSG message;
+    while (CURRENT_APP->is_running) {
+        while (PeekMessageA(&message, nullptr, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&message);
+            DispatchMessageA(&message);
+        }
+        CURRENT_APP->OnWindowRedraw();
+        mouse::resetChanges();
+        if (window::present_partially) {
+            for (u32 i = 0; i < window::dirty_rect_count; i++)
+                presentWindowRect(window::dirty_rects[i]);
+            window::present_partially = false;
+            window::dirty_rect_count = 0;
+        } else
+            InvalidateRgn(window_handle, nullptr, false);
+    }
+
+    return 0;
+}
+#endif
+#elif defined(SLIM_X11)
+#ifndef SLIM_SINGLE_HEADER_PLATFORMS_LINUX_X11_H
+#define SLIM_SINGLE_HEADER_PLATFORMS_LINUX_X11_H
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#ifndef SLIM_SINGLE_HEADER_PLATFORMS_LINUX_BASE_H
+#define SLIM_SINGLE_HEADER_PLATFORMS_LINUX_BASE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+
+#ifndef NDEBUG
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+void DisplayError(const char *function_name) {
+    printf("ERROR: %s failed with error code %d as follows:\n%s\n", function_name, errno, strerror(errno));
+}
+#endif
+
+// File descriptors are stored off-by-one in the opaque handle, so that descriptor 0 is never a null handle:
+#define LINUX_FILE_HANDLE(fd) ((void*)(long)((fd) + 1))
+#define LINUX_FILE_DESCRIPTOR(handle) ((int)((long)(handle) - 1))
+
+void linux_closeFile(void *handle) {
+    close(LINUX_FILE_DESCRIPTOR(handle));
+}
+
+void* linux_openFileForReading(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+#ifndef NDEBUG
+        DisplayError("open");
+        printf("Terminal failure: unable to open file \"%s\" for read.\n", path);
+#endif
+        return nullptr;
+    }
+    return LINUX_FILE_HANDLE(fd);
+}
+
+void* linux_openFileForWriting(const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+#ifndef NDEBUG
+        DisplayError("open");
+        printf("Terminal failure: unable to open file \"%s\" for write.\n", path);
+#endif
+        return nullptr;
+    }
+    return LINUX_FILE_HANDLE(fd);
+}
+
+bool linux_readFromFile(void *out, unsigned long size, void *handle) {
+    int fd = LINUX_FILE_DESCRIPTOR(handle);
+    u8 *bytes = (u8*)out;
+    while (size) { // A single read may return less than requested, reaching the end of the file is not an error:
+        ssize_t bytes_read = read(fd, bytes, size);
+        if (bytes_read == 0) break;
+        if (bytes_read < 0) {
+#ifndef NDEBUG
+            DisplayError("read");
+            printf("Terminal failure: Unable to read from file.\n");
+#endif
+            return false;
+        }
+        bytes += bytes_read;
+        size -= (unsigned long)bytes_read;
+    }
+    return true;
+}
+
+bool linux_writeToFile(void *out, unsigned long size, void *handle) {
+    int fd = LINUX_FILE_DESCRIPTOR(handle);
+    u8 *bytes = (u8*)out;
+    while (size) {
+        ssize_t bytes_written = write(fd, bytes, size);
+        if (bytes_written <= 0) {
+#ifndef NDEBUG
+            DisplayError("write");
+            printf("Terminal failure: Unable to write to file.\n");
+#endif
+            return false;
+        }
+        bytes += bytes_written;
+        size -= (unsigned long)bytes_written;
+    }
+    return true;
+}
+
+timespec performance_counter;
+
+u64 timers::getTicks() {
+    clock_gettime(CLOCK_MONOTONIC, &performance_counter);
+    return (u64)performance_counter.tv_sec * 1000000000ULL + (u64)performance_counter.tv_nsec;
+}
+
+void initTimers() {
+    timers::ticks_per_second = 1000000000ULL;
+    timers::seconds_per_tick = 1.0 / (f64)(timers::ticks_per_second);
+    timers::milliseconds_per_tick = 1000.0 * timers::seconds_per_tick;
+    timers::microseconds_per_tick = 1000.0 * timers::milliseconds_per_tick;
+    timers::nanoseconds_per_tick  = 1000.0 * timers::microseconds_per_tick;
+}
+
+void* os::getMemory(u64 size, u64 base) {
+    // The base address is only a hint here (as opposed to a requirement), pages are committed on first touch:
+    void *address = mmap((void*)base, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+}
+
+struct LinuxThreadStart {
+    os::ThreadFunction thread_function;
+    void *parameter;
+};
+#define MAX_THREAD_COUNT 256
+LinuxThreadStart linux_thread_starts[MAX_THREAD_COUNT];
+u32 linux_thread_count = 0;
+
+void* linux_threadProc(void *thread_start) {
+    ((LinuxThreadStart*)thread_start)->thread_function(((LinuxThreadStart*)thread_start)->parameter);
+    return nullptr;
+}
+
+u32 os::getCoreCount() {
+    long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return core_count > 0 ? (u32)core_count : 1;
+}
+
+bool os::createThread(ThreadFunction thread_function, void *parameter) {
+    if (linux_thread_count == MAX_THREAD_COUNT) return false;
+    LinuxThreadStart *thread_start = linux_thread_starts + linux_thread_count;
+    thread_start->thread_function = thread_function;
+    thread_start->parameter = parameter;
+
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    bool created = pthread_create(&thread, &attributes, linux_threadProc, thread_start) == 0;
+    pthread_attr_destroy(&attributes);
+    if (created) linux_thread_count++;
+    return created;
+}
+
+void* os::createSemaphore(u32 initial_count) {
+    sem_t *semaphore = (sem_t*)getMemory(sizeof(sem_t));
+    if (semaphore && sem_init(semaphore, 0, initial_count) != 0) {
+        munmap(semaphore, sizeof(sem_t));
+        return nullptr;
+    }
+    return semaphore;
+}
+
+void os::signalSemaphore(void *semaphore, u32 count) {
+    for (u32 i = 0; i < count; i++) sem_post((sem_t*)semaphore);
+}
+
+void os::waitForSemaphore(void *semaphore) {
+    while (sem_wait((sem_t*)semaphore) != 0); // Retry when interrupted by a signal
+}
+
+void os::closeFile(void *handle) { return linux_closeFile(handle); }
+void* os::openFileForReading(const char* path) { return linux_openFileForReading(path); }
+void* os::openFileForWriting(const char* path) { return linux_openFileForWriting(path); }
+bool os::readFromFile(void *out, unsigned long size, void *handle) { return linux_readFromFile(out, size, handle); }
+bool os::writeToFile(void *out, unsigned long size, void *handle) { return linux_writeToFile(out, size, handle); }
+
+#endif
+
+// Key codes are the same as the virtual-key codes of the Win32 platform layer, so apps see identical values:
+#define X11_KEY_BACKSPACE 0x08
+#define X11_KEY_TAB       0x09
+#define X11_KEY_ENTER     0x0D
+#define X11_KEY_SHIFT     0x10
+#define X11_KEY_CONTROL   0x11
+#define X11_KEY_ALT       0x12
+#define X11_KEY_ESCAPE    0x1B
+#define X11_KEY_SPACE     0x20
+#define X11_KEY_LEFT      0x25
+#define X11_KEY_UP        0x26
+#define X11_KEY_RIGHT     0x27
+#define X11_KEY_DOWN      0x28
+#define X11_KEY_F1        0x70
+
+#define X11_DOUBLE_CLICK_TIME 500
+
+Display *display;
+Window window_handle;
+GC graphics_context;
+Visual *visual;
+int screen, depth;
+Atom wm_delete_window;
+Cursor invisible_cursor;
+XImage *window_image{nullptr};
+XShmSegmentInfo shm_info;
+int shm_completion_event_type;
+bool shm_available{false};
+bool shm_put_pending{false};
+bool expose_pending{false}; // Exposed while a put was pending, so the next present covers the whole window
+bool shm_attach_failed{false};
+
+SlimApp *CURRENT_APP;
+
+void os::setWindowTitle(char* str) {
+    window::title = str;
+    XStoreName(display, window_handle, str);
+}
+
+void os::setCursorVisibility(bool on) {
+    if (on) XUndefineCursor(display, window_handle);
+    else XDefineCursor(display, window_handle, invisible_cursor);
+}
+
+void os::setWindowCapture(bool on) {
+    if (on) XGrabPointer(display, window_handle, False,
+                         ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
+                         GrabModeAsync, GrabModeAsync, None, None, CurrentTime);
+    else XUngrabPointer(display, CurrentTime);
+}
+
+u8 translateKey(KeySym key_sym) {
+    if (key_sym >= XK_a && key_sym <= XK_z) return (u8)('A' + (key_sym - XK_a));
+    if (key_sym >= XK_A && key_sym <= XK_Z) return (u8)('A' + (key_sym - XK_A));
+    if (key_sym >= XK_0 && key_sym <= XK_9) return (u8)('0' + (key_sym - XK_0));
+    if (key_sym >= XK_F1 && key_sym <= XK_F12) return (u8)(X11_KEY_F1 + (key_sym - XK_F1));
+    switch (key_sym) {
+        case XK_Control_L: case XK_Control_R: return X11_KEY_CONTROL;
+        case XK_Alt_L: case XK_Alt_R: case XK_Meta_L: case XK_Meta_R: return X11_KEY_ALT;
+        case XK_Shift_L: case XK_Shift_R: return X11_KEY_SHIFT;
+        case XK_space    : return X11_KEY_SPACE;
+        case XK_Tab      : return X11_KEY_TAB;
+        case XK_Escape   : return X11_KEY_ESCAPE;
+        case XK_Left     : return X11_KEY_LEFT;
+        case XK_Right    : return X11_KEY_RIGHT;
+        case XK_Up       : return X11_KEY_UP;
+        case XK_Down     : return X11_KEY_DOWN;
+        case XK_Return   : return X11_KEY_ENTER;
+        case XK_BackSpace: return X11_KEY_BACKSPACE;
+        default: return 0;
+    }
+}
+
+bool createWindowImage(u16 width, u16 height) {
+    if (window_image) {
+        window_image->data = nullptr; // The content is owned by the platform layer, not the image
+        XDestroyImage(window_image);
+    }
+
+    // Both image kinds wrap window::content directly, so drawing to the window needs no intermediate copy:
+    if (shm_available)
+        window_image = XShmCreateImage(display, visual, depth, ZPixmap, (char*)window::content, &shm_info, width, height);
+    else
+        window_image = XCreateImage(display, visual, depth, ZPixmap, 0, (char*)window::content, width, height, 32, 0);
+
+    return window_image != nullptr;
+}
+
+void handleEvent(XEvent &event);
+
+void waitForPresent() {
+    // The X server reads window::content asynchronously, so it must not be written into until it is done:
+    XEvent event;
+    while (shm_put_pending) {
+        XNextEvent(display, &event);
+        handleEvent(event);
+    }
+}
+
+void presentWindowRect(i32 x, i32 y, u32 width, u32 height, bool is_last) {
+    if (shm_available) {
+        // Only the last put asks for a completion event, the X server processes requests in order:
+        XShmPutImage(display, window_handle, graphics_context, window_image, x, y, x, y, width, height, is_last);
+        if (is_last) shm_put_pending = true;
+    } else
+        XPutImage(display, window_handle, graphics_context, window_image, x, y, x, y, width, height);
+}
+
+void presentWindowContent(bool whole_window = false) {
+    if (!window_image) return;
+    if (expose_pending) {
+        expose_pending = false;
+        whole_window = true;
+    }
+    if (window::present_partially && !whole_window) {
+        for (u32 i = 0; i < window::dirty_rect_count; i++) {
+            RectI &rect = window::dirty_rects[i];
+            presentWindowRect(rect.left, rect.top, rect.right - rect.left + 1, rect.bottom - rect.top + 1, i + 1 == window::dirty_rect_count);
+        }
+    } else
+        presentWindowRect(0, 0, window::width, window::height, true);
+
+    window::present_partially = false;
+    window::dirty_rect_count = 0;
+    XFlush(display);
+}
+
+void resizeWindow(u16 width, u16 height) {
+    if (width > MAX_WIDTH) width = MAX_WIDTH;
+    if (height > MAX_HEIGHT) height = MAX_HEIGHT;
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (window_image && width == window::width && height == window::height)
+        return;
+
+    waitForPresent();
+    createWindowImage(width, height);
+    CURRENT_APP->resize(width, height);
+}
+
+mouse::Button* getMouseButton(unsigned int button) {
+    switch (button) {
+        case Button1: return &mouse::left_button;
+        case Button2: return &mouse::middle_button;
+        case Button3: return &mouse::right_button;
+        default: return nullptr;
+    }
+}
+
+void handleEvent(XEvent &event) {
+    static Time last_click_time[3]{0, 0, 0};
+    mouse::Button *mouse_button;
+    bool pressed;
+    i32 x, y;
+    u8 key;
+
+    switch (event.type) {
+        case ClientMessage:
+            if ((Atom)event.xclient.data.l[0] == wm_delete_window)
+                CURRENT_APP->is_running = false;
+            break;
+
+        case ConfigureNotify:
+            resizeWindow((u16)event.xconfigure.width, (u16)event.xconfigure.height);
+            break;
+
+        case Expose:
+            if (event.xexpose.count == 0) {
+                if (shm_put_pending) expose_pending = true;
+                else presentWindowContent(true);
+            }
+            break;
+
+        case KeyPress:
+        case KeyRelease:
+            pressed = event.type == KeyPress;
+            key = translateKey(XLookupKeysym(&event.xkey, 0));
+            if (!key) break;
+            switch (key) {
+                case X11_KEY_CONTROL: controls::is_pressed::ctrl   = pressed; break;
+                case X11_KEY_ALT    : controls::is_pressed::alt    = pressed; break;
+                case X11_KEY_SHIFT  : controls::is_pressed::shift  = pressed; break;
+                case X11_KEY_SPACE  : controls::is_pressed::space  = pressed; break;
+                case X11_KEY_TAB    : controls::is_pressed::tab    = pressed; break;
+                case X11_KEY_ESCAPE : controls::is_pressed::escape = pressed; break;
+                case X11_KEY_LEFT   : controls::is_pressed::left   = pressed; break;
+                case X11_KEY_RIGHT  : controls::is_pressed::right  = pressed; break;
+                case X11_KEY_UP     : controls::is_pressed::up     = pressed; break;
+                case X11_KEY_DOWN   : controls::is_pressed::down   = pressed; break;
+                default: break;
+            }
+            CURRENT_APP->OnKeyChanged(key, pressed);
+            break;
+
+        case ButtonPress:
+        case ButtonRelease:
+            x = event.xbutton.x;
+            y = event.xbutton.y;
+            if (event.xbutton.button == Button4 || event.xbutton.button == Button5) {
+                if (event.type == ButtonPress) {
+                    f32 scroll_amount = event.xbutton.button == Button4 ? 1.0f : -1.0f;
+                    mouse::scroll(scroll_amount); CURRENT_APP->OnMouseWheelScrolled(scroll_amount);
+                }
+                break;
+            }
+            mouse_button = getMouseButton(event.xbutton.button);
+            if (!mouse_button) break;
+
+            if (event.type == ButtonRelease) {
+                mouse_button->up(x, y);
+                CURRENT_APP->OnMouseButtonUp(*mouse_button);
+            } else {
+                // X has no double-click events, so a quick second press is reported as one (like on Win32):
+                Time &last_time = last_click_time[event.xbutton.button - Button1];
+                if (last_time && (event.xbutton.time - last_time) < X11_DOUBLE_CLICK_TIME) {
+                    last_time = 0;
                     mouse_button->doubleClick(x, y);
                     mouse::double_clicked = true;
                     CURRENT_APP->OnMouseButtonDoubleClicked(*mouse_button);
-                    break;
-                case WM_MBUTTONUP:
-                case WM_RBUTTONUP:
-                case WM_LBUTTONUP:
-                    mouse_button->up(x, y);
-                    CURRENT_APP->OnMouseButtonUp(*mouse_button);
-                    break;
-                default:
+                } else {
+                    last_time = event.xbutton.time;
                     mouse_button->down(x, y);
                     CURRENT_APP->OnMouseButtonDown(*mouse_button);
+                }
             }
-
-            break;
-
-        case WM_MOUSEWHEEL:
-            scroll_amount = (f32)(GET_WHEEL_DELTA_WPARAM(wParam)) / (f32)(WHEEL_DELTA);
-            mouse::scroll(scroll_amount); CURRENT_APP->OnMouseWheelScrolled(scroll_amount);
             break;
 
-        case WM_MOUSEMOVE:
-            x = GET_X_LPARAM(lParam);
-            y = GET_Y_LPARAM(lParam);
+        case MotionNotify:
+            x = event.xmotion.x;
+            y = event.xmotion.y;
+            // Without XInput2 there is no raw input, so relative movement is derived from pointer motion:
+            if (x != mouse::pos_x || y != mouse::pos_y) {
+                mouse::moveRaw(x - mouse::pos_x, y - mouse::pos_y);
+                CURRENT_APP->OnMouseRawMovementSet(x - mouse::pos_x, y - mouse::pos_y);
+            }
             mouse::move(x, y);        CURRENT_APP->OnMouseMovementSet(x, y);
             mouse::setPosition(x, y); CURRENT_APP->OnMousePositionSet(x, y);
             break;
 
-        case WM_INPUT:
-            if ((hasRawMouseInput(lParam)) && (
-                    raw_inputs.data.mouse.lLastX != 0 ||
-                    raw_inputs.data.mouse.lLastY != 0)) {
-                x = raw_inputs.data.mouse.lLastX;
-                y = raw_inputs.data.mouse.lLastY;
-                mouse::moveRaw(x, y); CURRENT_APP->OnMouseRawMovementSet(x, y);
-            }
-
         default:
-            return DefWindowProcA(hWnd, message, wParam, lParam);
+            if (event.type == shm_completion_event_type)
+                shm_put_pending = false;
+            break;
     }
+}
 
+// Errors of attaching (as BadAccess on remote displays) are only recorded, as Xlib's default handler would exit:
+int onSharedMemoryAttachError(Display*, XErrorEvent*) {
+    shm_attach_failed = true;
     return 0;
 }
 
-int APIENTRY WinMain(HINSTANCE hInstance,
-                     HINSTANCE hPrevInstance,
-                     LPSTR     lpCmdLine,
-                     int       nCmdShow) {
-    void* window_content_and_canvas_memory = GlobalAlloc(GPTR, WINDOW_CONTENT_SIZE + (CANVAS_SIZE * CANVAS_COUNT));
-    if (!window_content_and_canvas_memory)
+bool attachSharedMemory() {
+    if (!XShmQueryExtension(display))
+        return false;
+
+    shm_info.shmid = shmget(IPC_PRIVATE, WINDOW_CONTENT_SIZE, IPC_CREAT | 0600);
+    if (shm_info.shmid == -1)
+        return false;
+
+    shm_info.shmaddr = (char*)shmat(shm_info.shmid, nullptr, 0);
+    if (shm_info.shmaddr == (char*)-1) {
+        shmctl(shm_info.shmid, IPC_RMID, nullptr);
+        return false;
+    }
+    shm_info.readOnly = False;
+
+    shm_attach_failed = false;
+    XErrorHandler previous_error_handler = XSetErrorHandler(onSharedMemoryAttachError);
+    bool attached = XShmAttach(display, &shm_info) != 0;
+    XSync(display, False);
+    XSetErrorHandler(previous_error_handler);
+    if (shm_attach_failed)
+        attached = false;
+
+    // Mark the segment for removal now, so it is released when both the app and the server detach from it:
+    shmctl(shm_info.shmid, IPC_RMID, nullptr);
+    if (!attached) {
+        shmdt(shm_info.shmaddr);
+        return false;
+    }
+
+    window::content = (u32*)shm_info.shmaddr;
+    shm_completion_event_type = XShmGetEventBase(display) + ShmCompletion;
+    return true;
+}
+
+int main(int, char*[]) {
+    display = XOpenDisplay(nullptr);
+    if (!display)
         return -1;
 
-    window::content = (u32*)window_content_and_canvas_memory;
-    memory::canvas_memory = (u8*)window_content_and_canvas_memory + WINDOW_CONTENT_SIZE;
+    screen = DefaultScreen(display);
+    visual = DefaultVisual(display, screen);
+    depth = DefaultDepth(display, screen);
+    if (depth < 24) // Window content is 32-bit BGRX
+        return -1;
+    shm_completion_event_type = -1;
 
-    controls::key_map::ctrl = VK_CONTROL;
-    controls::key_map::alt = VK_MENU;
-    controls::key_map::shift = VK_SHIFT;
-    controls::key_map::space = VK_SPACE;
-    controls::key_map::tab = VK_TAB;
-    controls::key_map::escape = VK_ESCAPE;
-    controls::key_map::left = VK_LEFT;
-    controls::key_map::right = VK_RIGHT;
-    controls::key_map::up = VK_UP;
-    controls::key_map::down = VK_DOWN;
+    shm_available = attachSharedMemory();
+    if (!shm_available) {
+        window::content = (u32*)os::getMemory(WINDOW_CONTENT_SIZE);
+        if (!window::content)
+            return -1;
+    }
+    memory::canvas_memory = (u8*)os::getMemory(CANVAS_SIZE * CANVAS_COUNT);
+    if (!memory::canvas_memory)
+        return -1;
 
-    LARGE_INTEGER performance_frequency;
-    QueryPerformanceFrequency(&performance_frequency);
+    controls::key_map::ctrl = X11_KEY_CONTROL;
+    controls::key_map::alt = X11_KEY_ALT;
+    controls::key_map::shift = X11_KEY_SHIFT;
+    controls::key_map::space = X11_KEY_SPACE;
+    controls::key_map::tab = X11_KEY_TAB;
+    controls::key_map::escape = X11_KEY_ESCAPE;
+    controls::key_map::left = X11_KEY_LEFT;
+    controls::key_map::right = X11_KEY_RIGHT;
+    controls::key_map::up = X11_KEY_UP;
+    controls::key_map::down = X11_KEY_DOWN;
 
-    timers::ticks_per_second = (u64)performance_frequency.QuadPart;
+    initTimers();
+
+    CURRENT_APP = createApp();
+    if (!CURRENT_APP->is_running)
+        return -1;
+
+    XSetWindowAttributes attributes;
+    attributes.background_pixel = BlackPixel(display, screen);
+    attributes.event_mask = ExposureMask | StructureNotifyMask |
+                            KeyPressMask | KeyReleaseMask |
+                            ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+    window_handle = XCreateWindow(display, RootWindow(display, screen),
+                                  0, 0, window::width, window::height, 0,
+                                  depth, InputOutput, visual,
+                                  CWBackPixel | CWEventMask, &attributes);
+    if (!window_handle)
+        return -1;
+
+    XStoreName(display, window_handle, window::title);
+    wm_delete_window = XInternAtom(display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(display, window_handle, &wm_delete_window, 1);
+
+    // Have key repeats arrive as repeated presses without releases in between (like on Win32):
+    XkbSetDetectableAutoRepeat(display, True, nullptr);
+
+    char no_data[8]{};
+    XColor black{};
+    Pixmap blank = XCreateBitmapFromData(display, window_handle, no_data, 8, 8);
+    invisible_cursor = XCreatePixmapCursor(display, blank, blank, &black, &black, 0, 0);
+    XFreePixmap(display, blank);
+
+    graphics_context = XCreateGC(display, window_handle, 0, nullptr);
+    XMapWindow(display, window_handle);
+
+    resizeWindow(window::width, window::height);
+
+    XEvent event;
+    while (CURRENT_APP->is_running) {
+        while (XPending(display)) {
+            XNextEvent(display, &event);
+            handleEvent(event);
+        }
+        if (!CURRENT_APP->is_running)
+            break;
+
+        waitForPresent();
+        CURRENT_APP->OnWindowRedraw();
+        mouse::resetChanges();
+        presentWindowContent();
+    }
+
+    waitForPresent();
+    if (shm_available) {
+        XShmDetach(display, &shm_info);
+        shmdt(shm_info.shmaddr);
+    }
+    XCloseDisplay(display);
+
+    return 0;
+}
+
+#endif
+#else
+#ifndef SLIM_SINGLE_HEADER_PLATFORMS_LINUX_HEADLESS_H
+#define SLIM_SINGLE_HEADER_PLATFORMS_LINUX_HEADLESS_H
+#ifndef SLIM_SINGLE_HEADER_PLATFORMS_LINUX_BASE_H
+#define SLIM_SINGLE_HEADER_PLATFORMS_LINUX_BASE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+
+#ifndef NDEBUG
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+void DisplayError(const char *function_name) {
+    printf("ERROR: %s failed with error code %d as follows:\n%s\n", function_name, errno, strerror(errno));
+}
+#endif
+
+// File descriptors are stored off-by-one in the opaque handle, so that descriptor 0 is never a null handle:
+#define LINUX_FILE_HANDLE(fd) ((void*)(long)((fd) + 1))
+#define LINUX_FILE_DESCRIPTOR(handle) ((int)((long)(handle) - 1))
+
+void linux_closeFile(void *handle) {
+    close(LINUX_FILE_DESCRIPTOR(handle));
+}
+
+void* linux_openFileForReading(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+#ifndef NDEBUG
+        DisplayError("open");
+        printf("Terminal failure: unable to open file \"%s\" for read.\n", path);
+#endif
+        return nullptr;
+    }
+    return LINUX_FILE_HANDLE(fd);
+}
+
+void* linux_openFileForWriting(const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+#ifndef NDEBUG
+        DisplayError("open");
+        printf("Terminal failure: unable to open file \"%s\" for write.\n", path);
+#endif
+        return nullptr;
+    }
+    return LINUX_FILE_HANDLE(fd);
+}
+
+bool linux_readFromFile(void *out, unsigned long size, void *handle) {
+    int fd = LINUX_FILE_DESCRIPTOR(handle);
+    u8 *bytes = (u8*)out;
+    while (size) { // A single read may return less than requested, reaching the end of the file is not an error:
+        ssize_t bytes_read = read(fd, bytes, size);
+        if (bytes_read == 0) break;
+        if (bytes_read < 0) {
+#ifndef NDEBUG
+            DisplayError("read");
+            printf("Terminal failure: Unable to read from file.\n");
+#endif
+            return false;
+        }
+        bytes += bytes_read;
+        size -= (unsigned long)bytes_read;
+    }
+    return true;
+}
+
+bool linux_writeToFile(void *out, unsigned long size, void *handle) {
+    int fd = LINUX_FILE_DESCRIPTOR(handle);
+    u8 *bytes = (u8*)out;
+    while (size) {
+        ssize_t bytes_written = write(fd, bytes, size);
+        if (bytes_written <= 0) {
+#ifndef NDEBUG
+            DisplayError("write");
+            printf("Terminal failure: Unable to write to file.\n");
+#endif
+            return false;
+        }
+        bytes += bytes_written;
+        size -= (unsigned long)bytes_written;
+    }
+    return true;
+}
+
+timespec performance_counter;
+
+u64 timers::getTicks() {
+    clock_gettime(CLOCK_MONOTONIC, &performance_counter);
+    return (u64)performance_counter.tv_sec * 1000000000ULL + (u64)performance_counter.tv_nsec;
+}
+
+void initTimers() {
+    timers::ticks_per_second = 1000000000ULL;
     timers::seconds_per_tick = 1.0 / (f64)(timers::ticks_per_second);
     timers::milliseconds_per_tick = 1000.0 * timers::seconds_per_tick;
     timers::microseconds_per_tick = 1000.0 * timers::milliseconds_per_tick;
     timers::nanoseconds_per_tick  = 1000.0 * timers::microseconds_per_tick;
+}
 
-    CURRENT_APP = createApp();
-    if (!CURRENT_APP->is_running)
-        return -1;
+void* os::getMemory(u64 size, u64 base) {
+    // The base address is only a hint here (as opposed to a requirement), pages are committed on first touch:
+    void *address = mmap((void*)base, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+}
 
-    info.bmiHeader.biSize        = sizeof(info.bmiHeader);
-    info.bmiHeader.biCompression = BI_RGB;
-    info.bmiHeader.biBitCount    = 32;
-    info.bmiHeader.biPlanes      = 1;
+struct LinuxThreadStart {
+    os::ThreadFunction thread_function;
+    void *parameter;
+};
+#define MAX_THREAD_COUNT 256
+LinuxThreadStart linux_thread_starts[MAX_THREAD_COUNT];
+u32 linux_thread_count = 0;
 
-    window_class.lpszClassName  = "RnDer";
-    window_class.hInstance      = hInstance;
-    window_class.lpfnWndProc    = WndProc;
-    window_class.style          = CS_OWNDC|CS_HREDRAW|CS_VREDRAW|CS_DBLCLKS;
-    window_class.hCursor        = LoadCursorA(nullptr, MAKEINTRESOURCEA(32512));
+void* linux_threadProc(void *thread_start) {
+    ((LinuxThreadStart*)thread_start)->thread_function(((LinuxThreadStart*)thread_start)->parameter);
+    return nullptr;
+}
 
-    if (!RegisterClassA(&window_class)) return -1;
+u32 os::getCoreCount() {
+    long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return core_count > 0 ? (u32)core_count : 1;
+}
 
-    win_rect.top = 0;
-    win_rect.left = 0;
-    win_rect.right  = window::width;
-    win_rect.bottom = window::height;
-    AdjustWindowRect(&win_rect, WS_OVERLAPPEDWINDOW, false);
+bool os::createThread(ThreadFunction thread_function, void *parameter) {
+    if (linux_thread_count == MAX_THREAD_COUNT) return false;
+    LinuxThreadStart *thread_start = linux_thread_starts + linux_thread_count;
+    thread_start->thread_function = thread_function;
+    thread_start->parameter = parameter;
 
-    window_handle = CreateWindowA(
-            window_class.lpszClassName,
-            window::title,
-            WS_OVERLAPPEDWINDOW,
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    bool created = pthread_create(&thread, &attributes, linux_threadProc, thread_start) == 0;
+    pthread_attr_destroy(&attributes);
+    if (created) linux_thread_count++;
+    return created;
+}
 
-            CW_USEDEFAULT,
-            CW_USEDEFAULT,
-            win_rect.right - win_rect.left,
-            win_rect.bottom - win_rect.top,
+void* os::createSemaphore(u32 initial_count) {
+    sem_t *semaphore = (sem_t*)getMemory(sizeof(sem_t));
+    if (semaphore && sem_init(semaphore, 0, initial_count) != 0) {
+        munmap(semaphore, sizeof(sem_t));
+        return nullptr;
+    }
+    return semaphore;
+}
 
-            nullptr,
-            nullptr,
-            hInstance,
-            nullptr
-    );
-    if (!window_handle)
-        return -1;
+void os::signalSemaphore(void *semaphore, u32 count) {
+    for (u32 i = 0; i < count; i++) sem_post((sem_t*)semaphore);
+}
 
-    raw_input_device.usUsagePage = 0x01;
-    raw_input_device.usUsage = 0x02;
-    if (!RegisterRawInputDevices(&raw_input_device, 1, sizeof(raw_input_device)))
+void os::waitForSemaphore(void *semaphore) {
+    while (sem_wait((sem_t*)semaphore) != 0); // Retry when interrupted by a signal
+}
+
+void os::closeFile(void *handle) { return linux_closeFile(handle); }
+void* os::openFileForReading(const char* path) { return linux_openFileForReading(path); }
+void* os::openFileForWriting(const char* path) { return linux_openFileForWriting(path); }
+bool os::readFromFile(void *out, unsigned long size, void *handle) { return linux_readFromFile(out, size, handle); }
+bool os::writeToFile(void *out, unsigned long size, void *handle) { return linux_writeToFile(out, size, handle); }
+
+#endif
+
+// Renders into an offscreen window content buffer without a display server.
+// Defaults can be overridden at compile time or from the command line:
+//   -w <width> -h <height> -f <frame count> -o <file path to save the last frame into, as a byte color image>
+#ifndef HEADLESS_FRAME_COUNT
+#define HEADLESS_FRAME_COUNT 100
+#endif
+
+SlimApp *CURRENT_APP;
+
+void os::setWindowTitle(char* str) {
+    window::title = str;
+}
+
+void os::setCursorVisibility(bool) {}
+void os::setWindowCapture(bool) {}
+
+u32 parseNumber(const char *str) {
+    u32 number = 0;
+    while (*str >= '0' && *str <= '9') number = number * 10 + (u32)(*(str++) - '0');
+    return number;
+}
+
+void printLine(char *title, char *text) {
+    write(STDOUT_FILENO, title, String::getLength(title));
+    write(STDOUT_FILENO, text, String::getLength(text));
+    write(STDOUT_FILENO, "\n", 1);
+}
+
+void printLine(char *title, i32 value) {
+    NumberString number;
+    number = value;
+    write(STDOUT_FILENO, title, String::getLength(title));
+    write(STDOUT_FILENO, number.string.char_ptr, number.string.length);
+    write(STDOUT_FILENO, "\n", 1);
+}
+
+int main(int argc, char *argv[]) {
+    void* window_content_and_canvas_memory = os::getMemory(WINDOW_CONTENT_SIZE + (CANVAS_SIZE * CANVAS_COUNT));
+    if (!window_content_and_canvas_memory)
         return -1;
 
-    win_dc = GetDC(window_handle);
+    window::content = (u32*)window_content_and_canvas_memory;
+    memory::canvas_memory = (u8*)window_content_and_canvas_memory + WINDOW_CONTENT_SIZE;
 
-    SetICMMode(win_dc, ICM_OFF);
+    initTimers();
 
-    ShowWindow(window_handle, nCmdShow);
+    CURRENT_APP = createApp();
+    if (!CURRENT_APP->is_running)
+        return -1;
 
-    MSG message;
-    while (CURRENT_APP->is_running) {
-        while (PeekMessageA(&message, nullptr, 0, 0, PM_REMOVE)) {
-            TranslateMessage(&message);
-            DispatchMessageA(&message);
+    u32 width = window::width;
+    u32 height = window::height;
+    u32 frame_count = HEADLESS_FRAME_COUNT;
+    char *output_file_path = nullptr;
+    for (int i = 1; i < argc - 1; i++) {
+        if (argv[i][0] != '-') continue;
+        switch (argv[i][1]) {
+            case 'w': width = parseNumber(argv[++i]); break;
+            case 'h': height = parseNumber(argv[++i]); break;
+            case 'f': frame_count = parseNumber(argv[++i]); break;
+            case 'o': output_file_path = argv[++i]; break;
+            default: break;
         }
+    }
+    if (width < 1 || width > MAX_WIDTH) width = width ? MAX_WIDTH : 1;
+    if (height < 1 || height > MAX_HEIGHT) height = height ? MAX_HEIGHT : 1;
+
+    CURRENT_APP->resize((u16)width, (u16)height);
+
+    u64 ticks_before = timers::getTicks();
+    u32 frame = 0;
+    f64 presented_fraction = 0;
+    for (; frame < frame_count && CURRENT_APP->is_running; frame++) {
         CURRENT_APP->OnWindowRedraw();
         mouse::resetChanges();
-        InvalidateRgn(window_handle, nullptr, false);
+
+        // Nothing to present to, but keep track of how much of the window would have been presented:
+        u32 presented_area = (u32)window::width * (u32)window::height;
+        if (window::present_partially) {
+            presented_area = 0;
+            for (u32 i = 0; i < window::dirty_rect_count; i++) {
+                RectI &rect = window::dirty_rects[i];
+                presented_area += (u32)(rect.right - rect.left + 1) * (u32)(rect.bottom - rect.top + 1);
+            }
+        }
+        presented_fraction += (f64)presented_area / ((f64)window::width * (f64)window::height);
+        window::present_partially = false;
+        window::dirty_rect_count = 0;
+    }
+    u64 ticks_after = timers::getTicks();
+
+    f64 total_milliseconds = timers::milliseconds_per_tick * (f64)(ticks_after - ticks_before);
+    printLine((char*)"Frames         : ", (i32)frame);
+    printLine((char*)"Total ms       : ", (i32)total_milliseconds);
+    if (window::title && *window::title)
+        printLine((char*)"Window title   : ", window::title);
+    if (frame) {
+        printLine((char*)"Frame us (avg) : ", (i32)(1000.0 * total_milliseconds / (f64)frame));
+        printLine((char*)"Presented %    : ", (i32)(100.0 * presented_fraction / (f64)frame));
+        if (total_milliseconds > 0.0)
+            printLine((char*)"Frames/second  : ", (i32)(1000.0 * (f64)frame / total_milliseconds));
+    }
+
+    if (output_file_path) {
+        ByteColorImage image;
+        image.updateDimensions(window::width, window::height);
+        image.content = (ByteColor*)window::content;
+        if (!save(image, output_file_path))
+            return -1;
     }
 
     return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
+#endif
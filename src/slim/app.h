@@ -38,4 +38,10 @@ struct SlimApp {
 
 SlimApp* createApp();
 
-#include "./platforms/win32.h"
\ No newline at end of file
+#ifdef _WIN32
+#include "./platforms/win32.h"
+#elif defined(SLIM_X11)
+#include "./platforms/linux_x11.h"
+#else
+#include "./platforms/linux_headless.h"
+#endif
\ No newline at end of file
@@ -102,10 +102,11 @@
 
 typedef unsigned char      u8;
 typedef unsigned short     u16;
-typedef unsigned long int  u32;
+typedef unsigned int       u32;
 typedef unsigned long long u64;
 typedef signed   short     i16;
-typedef signed   long int  i32;
+typedef signed   int       i32;
+typedef signed   long long i64;
 
 typedef float  f32;
 typedef double f64;
@@ -830,6 +831,7 @@ union ImageFlags {
         unsigned int mipmap:1;
         unsigned int flip:1;
         unsigned int wrap:1;
+        unsigned int swizzle:1;
     };
     u32 flags = 0;
 };
@@ -850,10 +852,171 @@ struct PixelImage : Image<Pixel> {};
 struct FloatImage : Image<f32> {};
 struct ByteColorImage : Image<ByteColor> {};
 
-#define PIXEL_SIZE (sizeof(Pixel))
+// Half-float conversions (round to nearest even, infinities and NaNs are preserved):
+INLINE_XPU u16 floatToHalf(f32 value) {
+    union { f32 f; u32 u; } bits{value};
+    u32 sign = bits.u & 0x80000000;
+    bits.u ^= sign;
+
+    u16 half;
+    if (bits.u >= (143 << 23)) // Too large for a half (or infinity/NaN)
+        half = bits.u > (255 << 23) ? 0x7E00 : 0x7C00;
+    else if (bits.u < (113 << 23)) { // Denormal half, let the float unit do the rounding
+        union { u32 u; f32 f; } magic{126 << 23};
+        bits.f += magic.f;
+        half = (u16)(bits.u - magic.u);
+    } else {
+        u32 odd_mantissa = (bits.u >> 13) & 1;
+        bits.u += ((u32)(15 - 127) << 23) + 0xFFF + odd_mantissa;
+        half = (u16)(bits.u >> 13);
+    }
+
+    return half | (u16)(sign >> 16);
+}
+
+INLINE_XPU f32 halfToFloat(u16 half) {
+    union { u32 u; f32 f; } bits{(u32)(half & 0x7FFF) << 13};
+    u32 exponent = bits.u & (0x7C00 << 13);
+    bits.u += (127 - 15) << 23;
+    if (exponent == (0x7C00 << 13)) // Infinity/NaN
+        bits.u += (128 - 16) << 23;
+    else if (exponent == 0) { // Denormal
+        union { u32 u; f32 f; } magic{113 << 23};
+        bits.u += 1 << 23;
+        bits.f -= magic.f;
+    }
+    bits.u |= (u32)(half & 0x8000) << 16;
+    return bits.f;
+}
+
+// Canvas pixel storage formats, selected at compile time by defining CANVAS_PIXEL_FORMAT before any include:
+//   CANVAS_PIXEL_FORMAT_F32     : Pixel (16 bytes), the default
+//   CANVAS_PIXEL_FORMAT_RGBA16F : PixelRGBA16F (8 bytes), the same values as Pixel stored as half floats
+//   CANVAS_PIXEL_FORMAT_RGBA8   : PixelRGBA8 (4 bytes), premultiplied color stored gamma-encoded, as presented
+// Drawing always blends in Pixel form, loading and storing samples through loadPixel() and storePixel().
+#define CANVAS_PIXEL_FORMAT_F32 0
+#define CANVAS_PIXEL_FORMAT_RGBA16F 1
+#define CANVAS_PIXEL_FORMAT_RGBA8 2
+
+#ifndef CANVAS_PIXEL_FORMAT
+#define CANVAS_PIXEL_FORMAT CANVAS_PIXEL_FORMAT_F32
+#endif
+
+struct PixelRGBA16F {
+    u16 r, g, b, opacity;
+};
+
+// Byte order matches the window content (0xAARRGGBB as a little-endian u32):
+struct PixelRGBA8 {
+    union {
+        struct { u8 B, G, R, A; };
+        u32 value;
+    };
+};
+
+// Decodes a gamma-encoded byte back to linear, so that encoding the result gives back the same byte:
+struct ByteToLinearTable {
+    f32 values[256];
+
+    ByteToLinearTable() {
+        values[0] = 0.0f;
+        values[255] = 1.0f;
+        for (u32 i = 1; i < 255; i++) {
+            f32 value = ((f32)i + 0.5f) * COLOR_COMPONENT_TO_FLOAT;
+            values[i] = value * value;
+        }
+    }
+};
+ByteToLinearTable byte_to_linear;
+
+// Linear values in 16-bit fixed point (65535 being 1), for storing and blending bytes with integer math:
+struct ByteToLinear16Table {
+    u16 values[256];
+
+    ByteToLinear16Table() {
+        for (u32 i = 0; i < 256; i++) values[i] = (u16)(byte_to_linear.values[i] * 65535.0f + 0.5f);
+    }
+};
+ByteToLinear16Table byte_to_linear16;
+
+// Gamma-encodes a 16-bit linear value to a byte, as Pixel::asContent() does for floats (with decoded bytes encoding back to themselves).
+// Also the gamma 2 color encode table (see getColorEncodeTable()), hence the 3 bytes of padding for AVX2 gathers:
+struct Linear16ToByteTable {
+    u8 values[65536 + 3];
+
+    Linear16ToByteTable() {
+        for (u32 i = 0; i < 65536; i++) values[i] = (u8)(FLOAT_TO_COLOR_COMPONENT * sqrtf((f32)i / 65535.0f));
+        for (u32 i = 0; i < 256; i++) values[byte_to_linear16.values[i]] = (u8)i;
+    }
+};
+Linear16ToByteTable linear16_to_byte;
+
+INLINE u16 toLinear16(f32 value) {
+    return (u16)(clampedValue(value) * 65535.0f + 0.5f);
+}
+
+INLINE_XPU Pixel loadPixel(const Pixel &stored) { return stored; }
+INLINE_XPU void storePixel(Pixel &stored, const Pixel &pixel) { stored = pixel; }
+
+INLINE_XPU Pixel loadPixel(const PixelRGBA16F &stored) {
+    return {halfToFloat(stored.r), halfToFloat(stored.g), halfToFloat(stored.b), halfToFloat(stored.opacity)};
+}
+INLINE_XPU void storePixel(PixelRGBA16F &stored, const Pixel &pixel) {
+    stored.r = floatToHalf(pixel.color.r);
+    stored.g = floatToHalf(pixel.color.g);
+    stored.b = floatToHalf(pixel.color.b);
+    stored.opacity = floatToHalf(pixel.opacity);
+}
+
+INLINE Pixel loadPixel(const PixelRGBA8 &stored) {
+    return {
+        byte_to_linear.values[stored.R],
+        byte_to_linear.values[stored.G],
+        byte_to_linear.values[stored.B],
+        (f32)stored.A * COLOR_COMPONENT_TO_FLOAT
+    };
+}
+INLINE void storePixel(PixelRGBA8 &stored, const Pixel &pixel) {
+    stored.R = linear16_to_byte.values[toLinear16(pixel.color.r)];
+    stored.G = linear16_to_byte.values[toLinear16(pixel.color.g)];
+    stored.B = linear16_to_byte.values[toLinear16(pixel.color.b)];
+    stored.A = (u8)(clampedValue(pixel.opacity) * FLOAT_TO_COLOR_COMPONENT + 0.5f);
+}
+
+#if CANVAS_PIXEL_FORMAT == CANVAS_PIXEL_FORMAT_RGBA8
+typedef PixelRGBA8 CanvasPixel;
+#elif CANVAS_PIXEL_FORMAT == CANVAS_PIXEL_FORMAT_RGBA16F
+typedef PixelRGBA16F CanvasPixel;
+#else
+typedef Pixel CanvasPixel;
+#endif
+
+#define PIXEL_SIZE (sizeof(CanvasPixel))
 #define CANVAS_PIXELS_SIZE (MAX_WINDOW_SIZE * PIXEL_SIZE * 4)
 #define CANVAS_DEPTHS_SIZE (MAX_WINDOW_SIZE * sizeof(f32) * 4)
-#define CANVAS_SIZE (CANVAS_PIXELS_SIZE + CANVAS_DEPTHS_SIZE)
+
+// Canvases track which of their tiles (in window pixels) were drawn into since they were last drawn to the window:
+#define CANVAS_TILE_SIZE_SHIFT 6
+#define CANVAS_TILE_SIZE (1 << CANVAS_TILE_SIZE_SHIFT)
+#define CANVAS_MAX_TILE_COLUMNS ((MAX_WIDTH + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE)
+#define CANVAS_MAX_TILE_ROWS ((MAX_HEIGHT + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE)
+#define CANVAS_DIRTY_TILES_SIZE (((CANVAS_MAX_TILE_COLUMNS * CANVAS_MAX_TILE_ROWS) + 63) & ~63)
+
+// Defining CANVAS_LAZY_CLEAR before any include makes clearing a canvas just start a new clear epoch:
+// Tiles from an older epoch read as the clear value, and are only cleared in memory once drawn into.
+#define CANVAS_TILE_EPOCHS_SIZE (CANVAS_DIRTY_TILES_SIZE * sizeof(u32))
+// The epoch a tile holds while one thread clears it in memory, with others drawing into it waiting for the clear epoch:
+#define CANVAS_TILE_EPOCH_CLEARING 0xFFFFFFFF
+
+// With MSAA pixels are stored once (along with a single depth) for as long as their samples are all the same.
+// The memory SSAA would use for the other 3 samples of each pixel is split into a pool of samples per tile, for pixels whose samples differ.
+// The memory SSAA would use for the other 3 depths of each pixel holds where each pixel's samples are, and how many of each pool are in use:
+#define CANVAS_MSAA_TILE_SAMPLES ((((u32)MAX_WINDOW_SIZE * 3) / (CANVAS_MAX_TILE_COLUMNS * CANVAS_MAX_TILE_ROWS)) & ~7u)
+
+// A coarse depth buffer of a min and a max depth per tile, for pixels drawn with depth to skip per-pixel work:
+#define CANVAS_TILE_DEPTHS_SIZE (CANVAS_DIRTY_TILES_SIZE * sizeof(f32) * 2)
+
+#define CANVAS_SIZE (CANVAS_PIXELS_SIZE + CANVAS_DEPTHS_SIZE + CANVAS_DIRTY_TILES_SIZE + CANVAS_TILE_EPOCHS_SIZE + CANVAS_TILE_DEPTHS_SIZE)
 
 struct Dimensions {
     u32 width_times_height{(u32)DEFAULT_WIDTH * (u32)DEFAULT_HEIGHT};
@@ -933,6 +1096,13 @@ namespace os {
     void* openFileForWriting(const char* file_path);
     bool readFromFile(void *out, unsigned long, void *handle);
     bool writeToFile(void *out, unsigned long, void *handle);
+
+    typedef void (*ThreadFunction)(void *parameter);
+    u32 getCoreCount();
+    bool createThread(ThreadFunction thread_function, void *parameter);
+    void* createSemaphore(u32 initial_count = 0);
+    void signalSemaphore(void *semaphore, u32 count = 1);
+    void waitForSemaphore(void *semaphore);
 }
 
 namespace timers {
@@ -1096,21 +1266,41 @@ namespace memory {
 
         void* allocate(u64 size) {
             if (!address) return nullptr;
+            if (occupied + size > capacity) return nullptr;
             occupied += size;
-            if (occupied > capacity) return nullptr;
 
             void* current_address = address;
             address += size;
             return current_address;
         }
+
+        // Frees everything allocated so far at once, for reusing the memory:
+        void reset() {
+            address -= occupied;
+            occupied = 0;
+        }
     };
 }
 
+#define WINDOW_MAX_DIRTY_RECT_COUNT 64
+
 namespace window {
     u16 width{DEFAULT_WIDTH};
     u16 height{DEFAULT_HEIGHT};
     char* title{(char*)""};
     u32 *content{nullptr};
+
+    // The canvas the content was last resolved from and at what size, for it to resolve only its dirty tiles next time.
+    // Anything else writing into the content resets the source, so that the next canvas resolves everything:
+    const void *content_source{nullptr};
+    u16 content_source_width{0};
+    u16 content_source_height{0};
+
+    // When presenting partially, only the dirty rectangles of the content get presented (possibly none).
+    // Platforms present the whole content otherwise, and reset both after every present:
+    bool present_partially{false};
+    u32 dirty_rect_count{0};
+    RectI dirty_rects[WINDOW_MAX_DIRTY_RECT_COUNT];
 }
 
 void writeHeader(const ImageInfo &info, void *file) {
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "./resolve.h"
+
+// Color spaces that linear pixels get encoded into for the window (and that byte colors get decoded from):
+// By default canvases encode with a square root (gamma 2), as the reference resolve kernels do (see resolve.h).
+// The other color spaces go through lookup tables instead of evaluating their transfer functions per component:
+enum ColorSpace {
+    ColorSpaceGamma2,
+    ColorSpaceSRGB,
+    ColorSpaceGamma22,
+    ColorSpaceLinear
+};
+
+// The transfer functions the tables get built from (values are clamped to [0, 1]):
+f32 encodeColorComponent(f32 linear, ColorSpace color_space) {
+    linear = clampedValue(linear);
+    switch (color_space) {
+        case ColorSpaceGamma2:  return sqrtf(linear);
+        case ColorSpaceSRGB:    return linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+        case ColorSpaceGamma22: return powf(linear, 1.0f / 2.2f);
+        default:                return linear;
+    }
+}
+
+f32 decodeColorComponent(f32 encoded, ColorSpace color_space) {
+    encoded = clampedValue(encoded);
+    switch (color_space) {
+        case ColorSpaceGamma2:  return encoded * encoded;
+        case ColorSpaceSRGB:    return encoded <= 0.04045f ? encoded / 12.92f : powf((encoded + 0.055f) / 1.055f, 2.4f);
+        case ColorSpaceGamma22: return powf(encoded, 2.2f);
+        default:                return encoded;
+    }
+}
+
+// Encodes linear values in 16-bit fixed point (65535 being 1) to bytes, rounding to the nearest byte.
+// Gamma 2 (which truncates like Pixel::asContent() does) is encoded through linear16_to_byte instead.
+// There are 3 bytes of padding at the end, so that AVX2 can gather the bytes as 32-bit values:
+#define COLOR_ENCODE_TABLE_SIZE 65536
+
+struct ColorEncodeTable {
+    u8 values[COLOR_ENCODE_TABLE_SIZE + 3];
+    bool is_built;
+
+    void build(ColorSpace color_space) {
+        for (u32 i = 0; i < COLOR_ENCODE_TABLE_SIZE; i++)
+            values[i] = (u8)(FLOAT_TO_COLOR_COMPONENT * encodeColorComponent((f32)i / 65535.0f, color_space) + 0.5f);
+        is_built = true;
+    }
+};
+ColorEncodeTable color_encode_tables[3]; // Of the color spaces after gamma 2
+
+// Tables are built on first use, so this is to be called before encoding from multiple threads:
+const u8* getColorEncodeTable(ColorSpace color_space) {
+    if (color_space == ColorSpaceGamma2)
+        return linear16_to_byte.values;
+
+    ColorEncodeTable &table = color_encode_tables[color_space - 1];
+    if (!table.is_built) table.build(color_space);
+    return table.values;
+}
+
+// Decodes bytes to linear values, exactly as converting them to floats and applying the transfer function would:
+struct ColorDecodeTable {
+    f32 values[256];
+
+    explicit ColorDecodeTable(ColorSpace color_space) {
+        for (u32 i = 0; i < 256; i++) values[i] = decodeColorComponent((f32)i * COLOR_COMPONENT_TO_FLOAT, color_space);
+    }
+
+    // As Color::applyGamma() does:
+    explicit ColorDecodeTable(f32 gamma) {
+        for (u32 i = 0; i < 256; i++) values[i] = powf((f32)i * COLOR_COMPONENT_TO_FLOAT, gamma);
+    }
+};
+
+// Decodes B, G, R (and A) byte components into pixels, with opacity as a plain fraction (0 without alpha):
+void decodeColorComponents(const u8 *components, Pixel *pixels, u32 count, bool alpha, const ColorDecodeTable &table) {
+    const u32 component_count = alpha ? 4 : 3;
+    for (u32 i = 0; i < count; i++, components += component_count) {
+        f32 opacity = alpha ? (f32)components[3] * COLOR_COMPONENT_TO_FLOAT : 0.0f;
+#ifdef SLIM_SSE2
+        _mm_storeu_ps(&pixels[i].color.r, _mm_setr_ps(table.values[components[2]], table.values[components[1]], table.values[components[0]], opacity));
+#else
+        pixels[i] = Pixel{table.values[components[2]], table.values[components[1]], table.values[components[0]], opacity};
+#endif
+    }
+}
+
+// Encoding linear pixels through a table works like resolving them does (transparent pixels giving 0, pixel quads averaged first),
+// with the components scaled to table indices in batches and the bytes looked up (gathered with AVX2):
+INLINE u32 _encodeComponent(f32 value, const u8 *table) {
+    value = value > 1.0f ? 1.0f : (value > 0.0f ? value : 0.0f); // NaN encodes as 0
+    return table[(u32)(value * 65535.0f + 0.5f)];
+}
+
+INLINE u32 _encodePixel(const Pixel &pixel, const u8 *table) {
+    return _encodeComponent(pixel.color.r, table) << 16 | _encodeComponent(pixel.color.g, table) << 8 | _encodeComponent(pixel.color.b, table);
+}
+
+void _encodePixelsScalar(const Pixel *pixels, u32 *content, u32 count, const u8 *table) {
+    for (u32 i = 0; i < count; i++, pixels++)
+        content[i] = pixels->opacity == 0.0f ? 0 : _encodePixel(*pixels, table);
+}
+
+void _encodePixelQuadsScalar(const Pixel *pixel_quads, u32 *content, u32 count, const u8 *table) {
+    for (u32 i = 0; i < count; i++, pixel_quads += 4)
+        content[i] = (
+                (pixel_quads[0].opacity == 0.0f) &&
+                (pixel_quads[1].opacity == 0.0f) &&
+                (pixel_quads[2].opacity == 0.0f) &&
+                (pixel_quads[3].opacity == 0.0f)
+        ) ? 0 : _encodePixel((pixel_quads[0] + pixel_quads[1] + pixel_quads[2] + pixel_quads[3]) * 0.25f, table);
+}
+
+#ifdef SLIM_SSE2
+INLINE __m128i _toEncodeTableIndicesSSE2(__m128 components) {
+    components = _mm_min_ps(_mm_max_ps(components, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(components, _mm_set1_ps(65535.0f)), _mm_set1_ps(0.5f)));
+}
+
+INLINE __m128i _encodeComponentsSSE2(__m128 components, const u8 *table) {
+    alignas(16) u32 indices[4];
+    _mm_store_si128((__m128i*)indices, _toEncodeTableIndicesSSE2(components));
+    return _mm_setr_epi32(table[indices[0]], table[indices[1]], table[indices[2]], table[indices[3]]);
+}
+
+void _encodePixelsSSE2(const Pixel *pixels, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixels += 4) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r = _mm_loadu_ps(components);
+        __m128 g = _mm_loadu_ps(components + 4);
+        __m128 b = _mm_loadu_ps(components + 8);
+        __m128 a = _mm_loadu_ps(components + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _encodeComponentsSSE2(r, table),
+                _encodeComponentsSSE2(g, table),
+                _encodeComponentsSSE2(b, table),
+                _mm_cmpeq_ps(a, _mm_setzero_ps())));
+    }
+    if (i < count) _encodePixelsScalar(pixels, content + i, count - i, table);
+}
+
+void _encodePixelQuadsSSE2(const Pixel *pixel_quads, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixel_quads += 16) {
+        __m128 r = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a = _blendPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        __m128 t0 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t1 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t2 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(t0, t1, t2, transparent);
+
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _encodeComponentsSSE2(r, table),
+                _encodeComponentsSSE2(g, table),
+                _encodeComponentsSSE2(b, table),
+                transparent));
+    }
+    if (i < count) _encodePixelQuadsScalar(pixel_quads, content + i, count - i, table);
+}
+#endif
+
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 INLINE __m256i _encodeComponentsAVX2(__m128 components0, __m128 components1, const u8 *table) {
+    __m256i indices = _mm256_setr_m128i(_toEncodeTableIndicesSSE2(components0), _toEncodeTableIndicesSSE2(components1));
+    __m256i values = _mm256_i32gather_epi32((const int*)table, indices, 1);
+    return _mm256_and_si256(values, _mm256_set1_epi32(0xFF));
+}
+
+SLIM_TARGET_AVX2 INLINE __m256i _packEncodedContentAVX2(__m256i R, __m256i G, __m256i B, __m128 transparent0, __m128 transparent1) {
+    __m256i transparent = _mm256_castps_si256(_mm256_setr_m128(transparent0, transparent1));
+    __m256i content = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(R, 16), _mm256_slli_epi32(G, 8)), B);
+    return _mm256_andnot_si256(transparent, content);
+}
+
+SLIM_TARGET_AVX2 void _encodePixelsAVX2(const Pixel *pixels, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixels += 8) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r0 = _mm_loadu_ps(components);
+        __m128 g0 = _mm_loadu_ps(components + 4);
+        __m128 b0 = _mm_loadu_ps(components + 8);
+        __m128 a0 = _mm_loadu_ps(components + 12);
+        __m128 r1 = _mm_loadu_ps(components + 16);
+        __m128 g1 = _mm_loadu_ps(components + 20);
+        __m128 b1 = _mm_loadu_ps(components + 24);
+        __m128 a1 = _mm_loadu_ps(components + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+        _mm256_storeu_si256((__m256i*)(content + i), _packEncodedContentAVX2(
+                _encodeComponentsAVX2(r0, r1, table),
+                _encodeComponentsAVX2(g0, g1, table),
+                _encodeComponentsAVX2(b0, b1, table),
+                _mm_cmpeq_ps(a0, _mm_setzero_ps()),
+                _mm_cmpeq_ps(a1, _mm_setzero_ps())));
+    }
+    if (i < count) _encodePixelsSSE2(pixels, content + i, count - i, table);
+}
+
+SLIM_TARGET_AVX2 void _encodePixelQuadsAVX2(const Pixel *pixel_quads, u32 *content, u32 count, const u8 *table) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixel_quads += 32) {
+        __m128 r0 = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g0 = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b0 = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a0 = _blendPixelQuadSSE2(pixel_quads + 12);
+        __m128 r1 = _blendPixelQuadSSE2(pixel_quads + 16);
+        __m128 g1 = _blendPixelQuadSSE2(pixel_quads + 20);
+        __m128 b1 = _blendPixelQuadSSE2(pixel_quads + 24);
+        __m128 a1 = _blendPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+
+        __m128 t00 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t01 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t02 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent0 = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        __m128 t10 = _isTransparentPixelQuadSSE2(pixel_quads + 16);
+        __m128 t11 = _isTransparentPixelQuadSSE2(pixel_quads + 20);
+        __m128 t12 = _isTransparentPixelQuadSSE2(pixel_quads + 24);
+        __m128 transparent1 = _isTransparentPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(t00, t01, t02, transparent0);
+        _MM_TRANSPOSE4_PS(t10, t11, t12, transparent1);
+
+        _mm256_storeu_si256((__m256i*)(content + i), _packEncodedContentAVX2(
+                _encodeComponentsAVX2(r0, r1, table),
+                _encodeComponentsAVX2(g0, g1, table),
+                _encodeComponentsAVX2(b0, b1, table),
+                transparent0, transparent1));
+    }
+    if (i < count) _encodePixelQuadsSSE2(pixel_quads, content + i, count - i, table);
+}
+#endif
+
+// Encodes a row (or any contiguous run) of pixels, or of pixel quads when super-sampled, through a table from getColorEncodeTable():
+void encodePixels(const Pixel *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    switch (kernel) {
+#ifdef SLIM_AVX2
+        case ResolveAVX2:
+            if (pixel_quads) _encodePixelQuadsAVX2(pixels, content, count, table);
+            else             _encodePixelsAVX2(pixels, content, count, table);
+            return;
+#endif
+#ifdef SLIM_SSE2
+        case ResolveSSE2:
+            if (pixel_quads) _encodePixelQuadsSSE2(pixels, content, count, table);
+            else             _encodePixelsSSE2(pixels, content, count, table);
+            return;
+#endif
+        default:
+            if (pixel_quads) _encodePixelQuadsScalar(pixels, content, count, table);
+            else             _encodePixelsScalar(pixels, content, count, table);
+    }
+}
+
+// Other formats are decoded into pixels a chunk at a time, and encoded from there:
+template <typename StoredPixel>
+void _encodeStoredPixels(const StoredPixel *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads, ResolveKernel kernel) {
+    Pixel decoded_pixels[RESOLVE_CHUNK_SIZE];
+    u32 samples_per_pixel = pixel_quads ? 4 : 1;
+    u32 chunk_pixel_count = RESOLVE_CHUNK_SIZE / samples_per_pixel;
+    while (count) {
+        u32 pixel_count = count < chunk_pixel_count ? count : chunk_pixel_count;
+        u32 sample_count = pixel_count * samples_per_pixel;
+        for (u32 i = 0; i < sample_count; i++) decoded_pixels[i] = loadPixel(pixels[i]);
+        encodePixels(decoded_pixels, content, pixel_count, table, pixel_quads, kernel);
+
+        pixels += sample_count;
+        content += pixel_count;
+        count -= pixel_count;
+    }
+}
+
+void encodePixels(const PixelRGBA16F *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    _encodeStoredPixels(pixels, content, count, table, pixel_quads, kernel);
+}
+
+// Bytes are linear in 16-bit fixed point once decoded, which is what the table is indexed by:
+void encodePixels(const PixelRGBA8 *pixels, u32 *content, u32 count, const u8 *table, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    if (pixel_quads) {
+        _encodeStoredPixels(pixels, content, count, table, pixel_quads, kernel);
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++)
+        content[i] = pixels[i].A ? (
+                (u32)table[byte_to_linear16.values[pixels[i].R]] << 16 |
+                (u32)table[byte_to_linear16.values[pixels[i].G]] << 8 |
+                (u32)table[byte_to_linear16.values[pixels[i].B]]) : 0;
+}
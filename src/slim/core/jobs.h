@@ -0,0 +1,305 @@
+#pragma once
+
+#include "./base.h"
+
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+// A fixed pool of worker threads, each owning a work-stealing deque (Chase-Lev).
+// The thread that submits a batch pushes it onto its own deque and helps running it until it is done,
+// while idle workers steal from the other end. Batches may be submitted from within jobs as well.
+// Threads are created lazily on first use (or by calling jobs::initialize() explicitly).
+// The thread that initializes the pool counts as the first worker. Other threads submitting batches claim deques of their own
+// (up to JOBS_MAX_SUBMITTER_COUNT of them, any further ones run their batches by themselves).
+// Lazy initialization is not thread safe, so pools submitted to from several threads are to be initialized up front.
+
+#ifndef JOBS_MAX_WORKER_COUNT
+#define JOBS_MAX_WORKER_COUNT 64
+#endif
+
+#ifndef JOBS_QUEUE_CAPACITY
+#define JOBS_QUEUE_CAPACITY 4096 // Must be a power of 2
+#endif
+
+#ifndef JOBS_MAX_SUBMITTER_COUNT
+#define JOBS_MAX_SUBMITTER_COUNT 8
+#endif
+
+#define JOBS_SPIN_COUNT 1024
+
+namespace atomics {
+#ifdef COMPILER_MSVC
+    INLINE i32 load(volatile i32 *value) { i32 result = *value; _ReadWriteBarrier(); return result; }
+    INLINE i64 load(volatile i64 *value) { return _InterlockedCompareExchange64(value, 0, 0); }
+    INLINE void store(volatile i32 *value, i32 new_value) { _InterlockedExchange((volatile long*)value, (long)new_value); }
+    INLINE void store(volatile i64 *value, i64 new_value) {
+        i64 old_value = *value;
+        i64 seen_value;
+        while ((seen_value = _InterlockedCompareExchange64(value, new_value, old_value)) != old_value) old_value = seen_value;
+    }
+    INLINE i32 add(volatile i32 *value, i32 amount) { return (i32)_InterlockedExchangeAdd((volatile long*)value, (long)amount) + amount; }
+    INLINE bool compareAndSwap(volatile i32 *value, i32 expected, i32 desired) { return _InterlockedCompareExchange((volatile long*)value, (long)desired, (long)expected) == (long)expected; }
+    INLINE bool compareAndSwap(volatile i64 *value, i64 expected, i64 desired) { return _InterlockedCompareExchange64(value, desired, expected) == expected; }
+    INLINE void fence() { _mm_mfence(); }
+    INLINE void pause() { _mm_pause(); }
+#else
+    INLINE i32 load(volatile i32 *value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+    INLINE i64 load(volatile i64 *value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+    INLINE void store(volatile i32 *value, i32 new_value) { __atomic_store_n(value, new_value, __ATOMIC_RELEASE); }
+    INLINE void store(volatile i64 *value, i64 new_value) { __atomic_store_n(value, new_value, __ATOMIC_RELEASE); }
+    INLINE i32 add(volatile i32 *value, i32 amount) { return __atomic_add_fetch(value, amount, __ATOMIC_ACQ_REL); }
+    INLINE bool compareAndSwap(volatile i32 *value, i32 expected, i32 desired) { return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED); }
+    INLINE bool compareAndSwap(volatile i64 *value, i64 expected, i64 desired) { return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED); }
+    INLINE void fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+    #if defined(__i386__) || defined(__x86_64__)
+    INLINE void pause() { __builtin_ia32_pause(); }
+    #else
+    INLINE void pause() {}
+    #endif
+#endif
+}
+
+namespace jobs {
+    typedef void (*JobFunction)(void *data, u32 index);
+
+    struct Job {
+        JobFunction function;
+        void *data;
+        u32 index;
+        volatile i32 *pending;
+    };
+
+    struct WorkQueue {
+        volatile i64 top{0};
+        volatile i64 bottom{0};
+        Job jobs[JOBS_QUEUE_CAPACITY];
+
+        // Only ever called by the owning worker:
+        bool push(const Job &job) {
+            i64 b = atomics::load(&bottom);
+            i64 t = atomics::load(&top);
+            if (b - t >= JOBS_QUEUE_CAPACITY)
+                return false;
+
+            jobs[b & (JOBS_QUEUE_CAPACITY - 1)] = job;
+            atomics::store(&bottom, b + 1);
+            return true;
+        }
+
+        // Only ever called by the owning worker (takes the most recently pushed job):
+        bool pop(Job &job) {
+            i64 b = atomics::load(&bottom) - 1;
+            atomics::store(&bottom, b);
+            atomics::fence();
+            i64 t = atomics::load(&top);
+            if (t > b) { // Empty
+                atomics::store(&bottom, b + 1);
+                return false;
+            }
+
+            job = jobs[b & (JOBS_QUEUE_CAPACITY - 1)];
+            if (t == b) { // Last job, race against thieves for it:
+                bool won = atomics::compareAndSwap(&top, t, t + 1);
+                atomics::store(&bottom, b + 1);
+                return won;
+            }
+
+            return true;
+        }
+
+        // Called by any other worker (takes the least recently pushed job):
+        bool steal(Job &job) {
+            i64 t = atomics::load(&top);
+            atomics::fence();
+            i64 b = atomics::load(&bottom);
+            if (t >= b)
+                return false;
+
+            job = jobs[t & (JOBS_QUEUE_CAPACITY - 1)];
+            return atomics::compareAndSwap(&top, t, t + 1);
+        }
+    };
+
+    WorkQueue *queues{nullptr}; // Of the workers, followed by the ones of other submitting threads
+    u32 worker_count{0};
+    volatile i32 submitter_count{0}; // Deques claimed by other threads (may go past JOBS_MAX_SUBMITTER_COUNT)
+    void *wake_up_semaphore{nullptr};
+    volatile i32 sleeping_worker_count{0};
+    thread_local i32 current_queue{-1}; // -1 until the thread is a worker or claims a deque (-2 when none were left)
+
+    INLINE void runJob(const Job &job) {
+        job.function(job.data, job.index);
+        atomics::add(job.pending, -1);
+    }
+
+    INLINE u32 getQueueCount() {
+        i32 submitters = atomics::load(&submitter_count);
+        return worker_count + (u32)(submitters < JOBS_MAX_SUBMITTER_COUNT ? submitters : JOBS_MAX_SUBMITTER_COUNT);
+    }
+
+    bool findJob(u32 queue, Job &job) {
+        if (queues[queue].pop(job))
+            return true;
+
+        u32 queue_count = getQueueCount();
+        for (u32 i = 1; i < queue_count; i++)
+            if (queues[(queue + i) % queue_count].steal(job))
+                return true;
+
+        return false;
+    }
+
+    // Takes back a worker's count as asleep, unless submitters already took all of them for waking workers up:
+    bool cancelSleep() {
+        i32 sleeping = atomics::load(&sleeping_worker_count);
+        while (sleeping > 0) {
+            if (atomics::compareAndSwap(&sleeping_worker_count, sleeping, sleeping - 1))
+                return true;
+
+            sleeping = atomics::load(&sleeping_worker_count);
+        }
+        return false;
+    }
+
+    void workerThread(void *parameter) {
+        u32 worker = (u32)(u64)parameter;
+        current_queue = (i32)worker;
+
+        Job job;
+        u32 spin_count = 0;
+        for (;;) {
+            if (findJob(worker, job)) {
+                runJob(job);
+                spin_count = 0;
+            } else if (++spin_count < JOBS_SPIN_COUNT)
+                atomics::pause();
+            else {
+                // Submitters only wake as many workers as are asleep, so wake-ups never accumulate.
+                // Jobs pushed before this worker counted itself as asleep woke nobody up, so it looks once more.
+                // When it finds one but a submitter already took its count, a wake-up is on its way and gets waited for:
+                atomics::add(&sleeping_worker_count, 1);
+                atomics::fence();
+                if (findJob(worker, job)) {
+                    runJob(job);
+                    if (!cancelSleep()) os::waitForSemaphore(wake_up_semaphore);
+                } else
+                    os::waitForSemaphore(wake_up_semaphore);
+                spin_count = 0;
+            }
+        }
+    }
+
+    void wakeUpWorkers(u32 count) {
+        atomics::fence(); // The jobs are pushed before checking for sleepers (who check for jobs after counting themselves)
+        i32 sleeping = atomics::load(&sleeping_worker_count);
+        while (count && sleeping > 0) {
+            if (atomics::compareAndSwap(&sleeping_worker_count, sleeping, sleeping - 1)) {
+                os::signalSemaphore(wake_up_semaphore);
+                count--;
+            }
+            sleeping = atomics::load(&sleeping_worker_count);
+        }
+    }
+
+    // The calling thread counts as the first worker, so a worker count of 1 runs everything inline:
+    bool initialize(u32 count = 0) {
+        if (queues) return true;
+
+        if (!count) count = os::getCoreCount();
+        if (count > JOBS_MAX_WORKER_COUNT) count = JOBS_MAX_WORKER_COUNT;
+        if (count < 1) count = 1;
+
+        queues = (WorkQueue*)os::getMemory(sizeof(WorkQueue) * (count + JOBS_MAX_SUBMITTER_COUNT));
+        if (!queues) return false;
+        for (u32 i = 0; i < count + JOBS_MAX_SUBMITTER_COUNT; i++) queues[i].top = queues[i].bottom = 0;
+        current_queue = 0;
+
+        if (count > 1) {
+            wake_up_semaphore = os::createSemaphore(0);
+            if (!wake_up_semaphore) count = 1;
+        }
+
+        // Set before any worker starts reading it, a worker that fails to start just leaves its queue empty:
+        worker_count = count;
+        for (u32 i = 1; i < count; i++)
+            if (!os::createThread(workerThread, (void*)(u64)i))
+                break;
+
+        return true;
+    }
+
+    // Gives a thread that is not a worker a deque of its own to submit from, returning false when none are left:
+    bool claimQueue() {
+        i32 submitter = atomics::add(&submitter_count, 1) - 1;
+        current_queue = submitter < JOBS_MAX_SUBMITTER_COUNT ? (i32)worker_count + submitter : -2;
+        return current_queue >= 0;
+    }
+
+    // Runs function(data, index) for every index in [0, count), returning once all of them are done:
+    void run(JobFunction function, void *data, u32 count) {
+        if (!count) return;
+        if (!queues) initialize();
+        if (current_queue == -2 || (current_queue == -1 && !claimQueue())) {
+            for (u32 i = 0; i < count; i++) function(data, i);
+            return;
+        }
+
+        volatile i32 pending = (i32)count;
+        u32 worker = (u32)current_queue;
+        WorkQueue &queue = queues[worker];
+        Job job{function, data, 0, &pending};
+
+        // Pushed in reverse so that the owner pops the first jobs and thieves take the last ones:
+        u32 pushed = 0;
+        for (u32 i = count; i > 0; i--) {
+            job.index = i - 1;
+            if (!queue.push(job)) { // Full, run this one right away:
+                runJob(job);
+                continue;
+            }
+            if (worker_count > 1 && ++pushed == worker_count)
+                wakeUpWorkers(worker_count - 1);
+        }
+        if (worker_count > 1 && pushed < worker_count)
+            wakeUpWorkers(pushed);
+
+        while (atomics::load(&pending)) {
+            if (findJob(worker, job))
+                runJob(job);
+            else
+                atomics::pause();
+        }
+    }
+
+    template <typename TileFunction>
+    struct TileBatch {
+        const TileFunction *function;
+        RectI bounds;
+        i32 tile_width;
+        i32 tile_height;
+        u32 columns;
+
+        static void runTile(void *data, u32 index) {
+            TileBatch<TileFunction> &batch = *(TileBatch<TileFunction>*)data;
+            i32 left = batch.bounds.left + (i32)(index % batch.columns) * batch.tile_width;
+            i32 top  = batch.bounds.top  + (i32)(index / batch.columns) * batch.tile_height;
+            RectI tile{left, left + batch.tile_width - 1, top, top + batch.tile_height - 1};
+            if (tile.right  > batch.bounds.right)  tile.right  = batch.bounds.right;
+            if (tile.bottom > batch.bounds.bottom) tile.bottom = batch.bounds.bottom;
+            (*batch.function)(tile);
+        }
+    };
+}
+
+// Splits the given (inclusive) bounds into tiles and calls tile_function(const RectI &tile) for each, in parallel:
+template <typename TileFunction>
+void parallelFor2D(RectI bounds, i32 tile_width, i32 tile_height, const TileFunction &tile_function) {
+    if (!bounds || tile_width < 1 || tile_height < 1)
+        return;
+
+    u32 columns = (u32)((bounds.right - bounds.left) / tile_width) + 1;
+    u32 rows = (u32)((bounds.bottom - bounds.top) / tile_height) + 1;
+    jobs::TileBatch<TileFunction> batch{&tile_function, bounds, tile_width, tile_height, columns};
+    jobs::run(jobs::TileBatch<TileFunction>::runTile, &batch, columns * rows);
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include "./simd.h"
+
+// Resolving converts canvas pixels (linear, squared color) into window content (sRGB-ish bytes, 0x00RRGGBB).
+// The scalar kernels define the reference output (Pixel::asContent, averaging pixel quads for SSAA),
+// the SIMD kernels reproduce it bit-for-bit: Components are averaged in single precision in the same order,
+// then square rooted and scaled to bytes in double precision. So is the scalar path, as the unqualified sqrt() of
+// Pixel::asContent resolves to the C library's double sqrt(), with <cmath> declaring the float overload in std only.
+// Both sides have to stay in double precision: Truncating the float sqrtf() * 255 instead rounds some roots that lie
+// just below a byte value up to it (136 of the floats in [0, 1], like 0.000138408301 giving 3 rather than 2).
+// Each canvas pixel storage format (see CanvasPixel) has its own resolvePixels() overload.
+
+enum ResolveKernel {
+    ResolveScalar,
+    ResolveSSE2,
+    ResolveAVX2
+};
+
+// The AVX2 kernels are also the best ones for AVX-512 CPUs:
+ResolveKernel getBestResolveKernel() {
+    switch (simd::level) {
+        case SimdAVX512:
+        case SimdAVX2: return ResolveAVX2;
+        case SimdSSE2: return ResolveSSE2;
+        default:       return ResolveScalar;
+    }
+}
+
+namespace resolve {
+    ResolveKernel kernel = getBestResolveKernel();
+    bool multithreaded = true;
+}
+
+void _resolvePixelsScalar(const Pixel *pixels, u32 *content, u32 count) {
+    for (u32 i = 0; i < count; i++, pixels++)
+        content[i] = pixels->opacity == 0.0f ? 0 : pixels->asContent();
+}
+
+void _resolvePixelQuadsScalar(const Pixel *pixel_quads, u32 *content, u32 count) {
+    for (u32 i = 0; i < count; i++, pixel_quads += 4)
+        content[i] = (
+                (pixel_quads[0].opacity == 0.0f) &&
+                (pixel_quads[1].opacity == 0.0f) &&
+                (pixel_quads[2].opacity == 0.0f) &&
+                (pixel_quads[3].opacity == 0.0f)
+        ) ? 0 : ((pixel_quads[0] + pixel_quads[1] + pixel_quads[2] + pixel_quads[3]) * 0.25f).asContent();
+}
+
+#ifdef SLIM_SSE2
+// Color components above 1 are clamped to 1 (giving 255), min(1, NaN) stays NaN and truncates to 0 like the scalar cast:
+INLINE __m128i _resolveComponentsSSE2(__m128 components) {
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d scale = _mm_set1_pd(FLOAT_TO_COLOR_COMPONENT);
+    __m128d low  = _mm_cvtps_pd(components);
+    __m128d high = _mm_cvtps_pd(_mm_movehl_ps(components, components));
+    low  = _mm_mul_pd(_mm_sqrt_pd(_mm_min_pd(one, low)), scale);
+    high = _mm_mul_pd(_mm_sqrt_pd(_mm_min_pd(one, high)), scale);
+    __m128i values = _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+    return _mm_and_si128(values, _mm_set1_epi32(MAX_COLOR_VALUE));
+}
+
+INLINE __m128i _packContentSSE2(__m128i R, __m128i G, __m128i B, __m128 transparent) {
+    __m128i content = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(R, 16), _mm_slli_epi32(G, 8)), B);
+    return _mm_andnot_si128(_mm_castps_si128(transparent), content);
+}
+
+// Averages 4 consecutive pixels in the same order as the scalar path: ((p0 + p1) + p2) + p3
+INLINE __m128 _blendPixelQuadSSE2(const Pixel *pixel_quad) {
+    const f32 *components = (const f32*)pixel_quad;
+    __m128 sum = _mm_add_ps(_mm_loadu_ps(components), _mm_loadu_ps(components + 4));
+    sum = _mm_add_ps(sum, _mm_loadu_ps(components + 8));
+    sum = _mm_add_ps(sum, _mm_loadu_ps(components + 12));
+    return _mm_mul_ps(sum, _mm_set1_ps(0.25f));
+}
+
+INLINE __m128 _isTransparentPixelQuadSSE2(const Pixel *pixel_quad) {
+    const f32 *components = (const f32*)pixel_quad;
+    const __m128 zero = _mm_setzero_ps();
+    __m128 transparent = _mm_and_ps(_mm_cmpeq_ps(_mm_loadu_ps(components), zero), _mm_cmpeq_ps(_mm_loadu_ps(components + 4), zero));
+    transparent = _mm_and_ps(transparent, _mm_cmpeq_ps(_mm_loadu_ps(components + 8), zero));
+    return _mm_and_ps(transparent, _mm_cmpeq_ps(_mm_loadu_ps(components + 12), zero));
+}
+
+void _resolvePixelsSSE2(const Pixel *pixels, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixels += 4) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r = _mm_loadu_ps(components);
+        __m128 g = _mm_loadu_ps(components + 4);
+        __m128 b = _mm_loadu_ps(components + 8);
+        __m128 a = _mm_loadu_ps(components + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        __m128 transparent = _mm_cmpeq_ps(a, _mm_setzero_ps());
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _resolveComponentsSSE2(r),
+                _resolveComponentsSSE2(g),
+                _resolveComponentsSSE2(b),
+                transparent));
+    }
+    if (i < count) _resolvePixelsScalar(pixels, content + i, count - i);
+}
+
+void _resolvePixelQuadsSSE2(const Pixel *pixel_quads, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4, pixel_quads += 16) {
+        __m128 r = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a = _blendPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        // Only the opacity lane of each quad's mask matters, it ends up as the last row once transposed:
+        __m128 t0 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t1 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t2 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        _MM_TRANSPOSE4_PS(t0, t1, t2, transparent);
+
+        _mm_storeu_si128((__m128i*)(content + i), _packContentSSE2(
+                _resolveComponentsSSE2(r),
+                _resolveComponentsSSE2(g),
+                _resolveComponentsSSE2(b),
+                transparent));
+    }
+    if (i < count) _resolvePixelQuadsScalar(pixel_quads, content + i, count - i);
+}
+#endif
+
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 INLINE __m128i _resolveComponentsAVX2(__m128 components) {
+    __m256d values = _mm256_cvtps_pd(components);
+    values = _mm256_min_pd(_mm256_set1_pd(1.0), values);
+    values = _mm256_mul_pd(_mm256_sqrt_pd(values), _mm256_set1_pd(FLOAT_TO_COLOR_COMPONENT));
+    return _mm256_cvttpd_epi32(values);
+}
+
+SLIM_TARGET_AVX2 INLINE __m256i _packContentAVX2(__m128i R0, __m128i G0, __m128i B0, __m128 transparent0,
+                                                 __m128i R1, __m128i G1, __m128i B1, __m128 transparent1) {
+    const __m256i mask = _mm256_set1_epi32(MAX_COLOR_VALUE);
+    __m256i R = _mm256_and_si256(_mm256_setr_m128i(R0, R1), mask);
+    __m256i G = _mm256_and_si256(_mm256_setr_m128i(G0, G1), mask);
+    __m256i B = _mm256_and_si256(_mm256_setr_m128i(B0, B1), mask);
+    __m256i transparent = _mm256_castps_si256(_mm256_setr_m128(transparent0, transparent1));
+    __m256i content = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(R, 16), _mm256_slli_epi32(G, 8)), B);
+    return _mm256_andnot_si256(transparent, content);
+}
+
+SLIM_TARGET_AVX2 void _resolvePixelsAVX2(const Pixel *pixels, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixels += 8) {
+        const f32 *components = (const f32*)pixels;
+        __m128 r0 = _mm_loadu_ps(components);
+        __m128 g0 = _mm_loadu_ps(components + 4);
+        __m128 b0 = _mm_loadu_ps(components + 8);
+        __m128 a0 = _mm_loadu_ps(components + 12);
+        __m128 r1 = _mm_loadu_ps(components + 16);
+        __m128 g1 = _mm_loadu_ps(components + 20);
+        __m128 b1 = _mm_loadu_ps(components + 24);
+        __m128 a1 = _mm_loadu_ps(components + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+        _mm256_storeu_si256((__m256i*)(content + i), _packContentAVX2(
+                _resolveComponentsAVX2(r0), _resolveComponentsAVX2(g0), _resolveComponentsAVX2(b0), _mm_cmpeq_ps(a0, _mm_setzero_ps()),
+                _resolveComponentsAVX2(r1), _resolveComponentsAVX2(g1), _resolveComponentsAVX2(b1), _mm_cmpeq_ps(a1, _mm_setzero_ps())));
+    }
+    if (i < count) _resolvePixelsSSE2(pixels, content + i, count - i);
+}
+
+SLIM_TARGET_AVX2 void _resolvePixelQuadsAVX2(const Pixel *pixel_quads, u32 *content, u32 count) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8, pixel_quads += 32) {
+        __m128 r0 = _blendPixelQuadSSE2(pixel_quads);
+        __m128 g0 = _blendPixelQuadSSE2(pixel_quads + 4);
+        __m128 b0 = _blendPixelQuadSSE2(pixel_quads + 8);
+        __m128 a0 = _blendPixelQuadSSE2(pixel_quads + 12);
+        __m128 r1 = _blendPixelQuadSSE2(pixel_quads + 16);
+        __m128 g1 = _blendPixelQuadSSE2(pixel_quads + 20);
+        __m128 b1 = _blendPixelQuadSSE2(pixel_quads + 24);
+        __m128 a1 = _blendPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+
+        __m128 t00 = _isTransparentPixelQuadSSE2(pixel_quads);
+        __m128 t01 = _isTransparentPixelQuadSSE2(pixel_quads + 4);
+        __m128 t02 = _isTransparentPixelQuadSSE2(pixel_quads + 8);
+        __m128 transparent0 = _isTransparentPixelQuadSSE2(pixel_quads + 12);
+        __m128 t10 = _isTransparentPixelQuadSSE2(pixel_quads + 16);
+        __m128 t11 = _isTransparentPixelQuadSSE2(pixel_quads + 20);
+        __m128 t12 = _isTransparentPixelQuadSSE2(pixel_quads + 24);
+        __m128 transparent1 = _isTransparentPixelQuadSSE2(pixel_quads + 28);
+        _MM_TRANSPOSE4_PS(t00, t01, t02, transparent0);
+        _MM_TRANSPOSE4_PS(t10, t11, t12, transparent1);
+
+        _mm256_storeu_si256((__m256i*)(content + i), _packContentAVX2(
+                _resolveComponentsAVX2(r0), _resolveComponentsAVX2(g0), _resolveComponentsAVX2(b0), transparent0,
+                _resolveComponentsAVX2(r1), _resolveComponentsAVX2(g1), _resolveComponentsAVX2(b1), transparent1));
+    }
+    if (i < count) _resolvePixelQuadsSSE2(pixel_quads, content + i, count - i);
+}
+#endif
+
+// Resolves a row (or any contiguous run) of pixels, or of pixel quads when super-sampled:
+void resolvePixels(const Pixel *pixels, u32 *content, u32 count, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    switch (kernel) {
+#ifdef SLIM_AVX2
+        case ResolveAVX2:
+            if (pixel_quads) _resolvePixelQuadsAVX2(pixels, content, count);
+            else             _resolvePixelsAVX2(pixels, content, count);
+            return;
+#endif
+#ifdef SLIM_SSE2
+        case ResolveSSE2:
+            if (pixel_quads) _resolvePixelQuadsSSE2(pixels, content, count);
+            else             _resolvePixelsSSE2(pixels, content, count);
+            return;
+#endif
+        default:
+            if (pixel_quads) _resolvePixelQuadsScalar(pixels, content, count);
+            else             _resolvePixelsScalar(pixels, content, count);
+    }
+}
+
+// The byte format is stored as presented, so unless super-sampled its pixels only need their opacity masked out:
+void _resolveBytePixelsScalar(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    for (u32 i = 0; i < count; i++)
+        content[i] = pixels[i].A ? (pixels[i].value & 0x00FFFFFF) : 0;
+}
+
+// Written once for both widths: Returns how many pixels got resolved, leaving the rest for the narrower kernel.
+template <typename I32>
+SLIM_INLINE_KERNEL u32 _resolveBytePixelsWide(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    const I32 color_mask{0x00FFFFFF};
+    const I32 zero{0};
+    u32 i = 0;
+    for (; i + I32::width <= count; i += I32::width) {
+        I32 values = I32::load((const i32*)(pixels + i));
+        I32 transparent = andNot(color_mask, values) == zero;
+        andNot(transparent, values & color_mask).store((i32*)(content + i));
+    }
+    return i;
+}
+
+#ifdef SLIM_SSE2
+void _resolveBytePixelsSSE2(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    u32 i = _resolveBytePixelsWide<i32x4>(pixels, content, count);
+    if (i < count) _resolveBytePixelsScalar(pixels + i, content + i, count - i);
+}
+#endif
+
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 void _resolveBytePixelsAVX2(const PixelRGBA8 *pixels, u32 *content, u32 count) {
+    u32 i = _resolveBytePixelsWide<i32x8>(pixels, content, count);
+    if (i < count) _resolveBytePixelsSSE2(pixels + i, content + i, count - i);
+}
+#endif
+
+// Other formats are decoded into pixels a chunk at a time, and resolved from there:
+#define RESOLVE_CHUNK_SIZE 256
+
+template <typename StoredPixel>
+void _resolveStoredPixels(const StoredPixel *pixels, u32 *content, u32 count, bool pixel_quads, ResolveKernel kernel) {
+    Pixel decoded_pixels[RESOLVE_CHUNK_SIZE];
+    u32 samples_per_pixel = pixel_quads ? 4 : 1;
+    u32 chunk_pixel_count = RESOLVE_CHUNK_SIZE / samples_per_pixel;
+    while (count) {
+        u32 pixel_count = count < chunk_pixel_count ? count : chunk_pixel_count;
+        u32 sample_count = pixel_count * samples_per_pixel;
+        for (u32 i = 0; i < sample_count; i++) decoded_pixels[i] = loadPixel(pixels[i]);
+        resolvePixels(decoded_pixels, content, pixel_count, pixel_quads, kernel);
+
+        pixels += sample_count;
+        content += pixel_count;
+        count -= pixel_count;
+    }
+}
+
+void resolvePixels(const PixelRGBA16F *pixels, u32 *content, u32 count, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    _resolveStoredPixels(pixels, content, count, pixel_quads, kernel);
+}
+
+void resolvePixels(const PixelRGBA8 *pixels, u32 *content, u32 count, bool pixel_quads = false, ResolveKernel kernel = resolve::kernel) {
+    if (pixel_quads) {
+        _resolveStoredPixels(pixels, content, count, pixel_quads, kernel);
+        return;
+    }
+
+    switch (kernel) {
+#ifdef SLIM_AVX2
+        case ResolveAVX2: _resolveBytePixelsAVX2(pixels, content, count); return;
+#endif
+#ifdef SLIM_SSE2
+        case ResolveSSE2: _resolveBytePixelsSSE2(pixels, content, count); return;
+#endif
+        default: _resolveBytePixelsScalar(pixels, content, count);
+    }
+}
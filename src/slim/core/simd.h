@@ -0,0 +1,539 @@
+#pragma once
+
+#include "./base.h"
+
+// SIMD support is detected at compile time (SSE2 being part of x64), and picked at runtime by what the CPU has (see simd::level).
+// AVX2 and AVX-512 code gets compiled per function (with SLIM_TARGET_AVX2/SLIM_TARGET_AVX512), so builds run on any x64 CPU.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SLIM_SSE2 1
+    #include <emmintrin.h>
+    #if defined(COMPILER_MSVC)
+        #define SLIM_AVX2 1
+        #define SLIM_AVX512 1
+        #define SLIM_TARGET_AVX2
+        #define SLIM_TARGET_AVX512
+        #include <intrin.h>
+        #include <immintrin.h>
+    #elif defined(COMPILER_CLANG_OR_GCC)
+        #define SLIM_AVX2 1
+        #define SLIM_AVX512 1
+        #define SLIM_TARGET_AVX2 __attribute__((target("avx2")))
+        #define SLIM_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512vl,avx512bw")))
+        #include <immintrin.h>
+    #endif
+#endif
+
+// Methods of the 8-wide types are only inlined (not forced to be), as forcing them into code compiled
+// without AVX2 (like a template shared by the kernels of all widths) fails to compile.
+// Once such code gets inlined into a function compiled with AVX2, so do they:
+#define SLIM_INLINE_AVX2 SLIM_TARGET_AVX2 inline
+
+// Kernel bodies shared by all widths have to be inlined into the kernels even in debug builds,
+// as passing 8-wide values between code compiled with and without AVX2 does not agree on how to pass them:
+#if defined(COMPILER_MSVC)
+    #define SLIM_INLINE_KERNEL inline __forceinline
+#elif defined(COMPILER_CLANG_OR_GCC)
+    #define SLIM_INLINE_KERNEL inline __attribute__((always_inline))
+#else
+    #define SLIM_INLINE_KERNEL inline
+#endif
+
+enum SimdLevel {
+    SimdScalar,
+    SimdSSE2,
+    SimdAVX2,
+    SimdAVX512
+};
+
+bool cpuHasAVX2() {
+#if defined(SLIM_AVX2) && defined(COMPILER_MSVC)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+    if (!os_saves_ymm) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(SLIM_AVX2)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+// AVX-512 kernels use the foundation, vector length and byte/word extensions:
+bool cpuHasAVX512() {
+#if defined(SLIM_AVX512) && defined(COMPILER_MSVC)
+    if (!cpuHasAVX2()) return false;
+
+    bool os_saves_zmm = (_xgetbv(0) & 0xE6) == 0xE6;
+    if (!os_saves_zmm) return false;
+
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) && (info[1] & (1 << 30)) && (info[1] & (1 << 31));
+#elif defined(SLIM_AVX512)
+    return __builtin_cpu_supports("avx2") &&
+           __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512vl") &&
+           __builtin_cpu_supports("avx512bw");
+#else
+    return false;
+#endif
+}
+
+SimdLevel getBestSimdLevel() {
+#ifdef SLIM_SSE2
+    return cpuHasAVX512() ? SimdAVX512 : (cpuHasAVX2() ? SimdAVX2 : SimdSSE2);
+#else
+    return SimdScalar;
+#endif
+}
+
+namespace simd {
+    SimdLevel level = getBestSimdLevel();
+}
+
+// Picks the widest of the given variants of a kernel that the level allows, falling back to narrower ones (down to scalar).
+// Variants that are not compiled in are given as nullptr, which the SIMD_<LEVEL>_KERNEL() macros take care of:
+template <typename Kernel>
+Kernel selectKernel(Kernel scalar, Kernel sse2, Kernel avx2 = nullptr, Kernel avx512 = nullptr, SimdLevel level = simd::level) {
+    if (avx512 && level >= SimdAVX512) return avx512;
+    if (avx2   && level >= SimdAVX2)   return avx2;
+    if (sse2   && level >= SimdSSE2)   return sse2;
+    return scalar;
+}
+
+#ifdef SLIM_SSE2
+    #define SIMD_SSE2_KERNEL(kernel) (kernel)
+#else
+    #define SIMD_SSE2_KERNEL(kernel) nullptr
+#endif
+#ifdef SLIM_AVX2
+    #define SIMD_AVX2_KERNEL(kernel) (kernel)
+#else
+    #define SIMD_AVX2_KERNEL(kernel) nullptr
+#endif
+#ifdef SLIM_AVX512
+    #define SIMD_AVX512_KERNEL(kernel) (kernel)
+#else
+    #define SIMD_AVX512_KERNEL(kernel) nullptr
+#endif
+
+// Lanes of floats and integers, with a scalar backend where the instruction set is not available.
+// Kernel bodies can be written once as templates over the lane types (of the same width, see the width members):
+// f32x4 and i32x4 (SSE2), f32x8 and i32x8 (AVX2, usable in functions compiled with SLIM_TARGET_AVX2 or SLIM_TARGET_AVX512).
+// Comparisons give masks (all bits set for the lanes where they hold) to select with, or to get as bits with mask().
+
+#ifdef SLIM_SSE2
+struct f32x4 {
+    static constexpr u32 width = 4;
+    __m128 v;
+
+    INLINE f32x4() = default;
+    INLINE f32x4(__m128 v) : v{v} {}
+    INLINE f32x4(f32 value) : v{_mm_set1_ps(value)} {}
+
+    INLINE static f32x4 load(const f32 *values) { return _mm_loadu_ps(values); }
+    INLINE void store(f32 *values) const { _mm_storeu_ps(values, v); }
+
+    INLINE f32x4 operator + (const f32x4 &rhs) const { return _mm_add_ps(v, rhs.v); }
+    INLINE f32x4 operator - (const f32x4 &rhs) const { return _mm_sub_ps(v, rhs.v); }
+    INLINE f32x4 operator * (const f32x4 &rhs) const { return _mm_mul_ps(v, rhs.v); }
+    INLINE f32x4 operator / (const f32x4 &rhs) const { return _mm_div_ps(v, rhs.v); }
+    INLINE f32x4 operator & (const f32x4 &rhs) const { return _mm_and_ps(v, rhs.v); }
+    INLINE f32x4 operator | (const f32x4 &rhs) const { return _mm_or_ps(v, rhs.v); }
+    INLINE f32x4 operator <  (const f32x4 &rhs) const { return _mm_cmplt_ps(v, rhs.v); }
+    INLINE f32x4 operator <= (const f32x4 &rhs) const { return _mm_cmple_ps(v, rhs.v); }
+    INLINE f32x4 operator >  (const f32x4 &rhs) const { return _mm_cmpgt_ps(v, rhs.v); }
+    INLINE f32x4 operator >= (const f32x4 &rhs) const { return _mm_cmpge_ps(v, rhs.v); }
+    INLINE f32x4 operator == (const f32x4 &rhs) const { return _mm_cmpeq_ps(v, rhs.v); }
+    INLINE u32 mask() const { return (u32)_mm_movemask_ps(v); }
+};
+
+INLINE f32x4 minimum(const f32x4 &a, const f32x4 &b) { return _mm_min_ps(a.v, b.v); }
+INLINE f32x4 maximum(const f32x4 &a, const f32x4 &b) { return _mm_max_ps(a.v, b.v); }
+INLINE f32x4 sqrt(const f32x4 &a) { return _mm_sqrt_ps(a.v); }
+INLINE f32x4 approxRsqrt(const f32x4 &a) { return _mm_rsqrt_ps(a.v); } // About 12 bits of precision
+INLINE f32x4 approxRcp(const f32x4 &a) { return _mm_rcp_ps(a.v); }
+#ifdef FP_FAST_FMAF // Fused exactly when fast_mul_add() is, for kernels to match scalar code using it
+INLINE f32x4 mulAdd(const f32x4 &a, const f32x4 &b, const f32x4 &c) { return _mm_fmadd_ps(a.v, b.v, c.v); }
+#else
+INLINE f32x4 mulAdd(const f32x4 &a, const f32x4 &b, const f32x4 &c) { return _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v); }
+#endif
+INLINE f32x4 select(const f32x4 &mask, const f32x4 &a, const f32x4 &b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+INLINE f32x4 floor(const f32x4 &a) { // Truncates, then steps down the negative values that got rounded up (for values within the range of i32)
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+}
+
+// Splits pairs of interleaved values (like the x and y of points) into the lanes of even and odd ones, and back:
+INLINE void deinterleave(const f32x4 &a, const f32x4 &b, f32x4 &even, f32x4 &odd) {
+    even = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0));
+    odd  = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1));
+}
+INLINE void interleave(const f32x4 &even, const f32x4 &odd, f32x4 &a, f32x4 &b) {
+    a = _mm_unpacklo_ps(even.v, odd.v);
+    b = _mm_unpackhi_ps(even.v, odd.v);
+}
+
+struct i32x4 {
+    static constexpr u32 width = 4;
+    __m128i v;
+
+    INLINE i32x4() = default;
+    INLINE i32x4(__m128i v) : v{v} {}
+    INLINE i32x4(i32 value) : v{_mm_set1_epi32(value)} {}
+
+    INLINE static i32x4 load(const i32 *values) { return _mm_loadu_si128((const __m128i*)values); }
+    INLINE void store(i32 *values) const { _mm_storeu_si128((__m128i*)values, v); }
+
+    INLINE i32x4 operator + (const i32x4 &rhs) const { return _mm_add_epi32(v, rhs.v); }
+    INLINE i32x4 operator - (const i32x4 &rhs) const { return _mm_sub_epi32(v, rhs.v); }
+    INLINE i32x4 operator & (const i32x4 &rhs) const { return _mm_and_si128(v, rhs.v); }
+    INLINE i32x4 operator | (const i32x4 &rhs) const { return _mm_or_si128(v, rhs.v); }
+    INLINE i32x4 operator ^ (const i32x4 &rhs) const { return _mm_xor_si128(v, rhs.v); }
+    INLINE i32x4 operator ~ () const { return _mm_xor_si128(v, _mm_set1_epi32(-1)); }
+    INLINE i32x4 operator << (i32 bits) const { return _mm_sll_epi32(v, _mm_cvtsi32_si128(bits)); }
+    INLINE i32x4 operator >> (i32 bits) const { return _mm_sra_epi32(v, _mm_cvtsi32_si128(bits)); }
+    INLINE i32x4 operator == (const i32x4 &rhs) const { return _mm_cmpeq_epi32(v, rhs.v); }
+    INLINE i32x4 operator >  (const i32x4 &rhs) const { return _mm_cmpgt_epi32(v, rhs.v); }
+    INLINE i32x4 operator <  (const i32x4 &rhs) const { return _mm_cmplt_epi32(v, rhs.v); }
+    INLINE u32 mask() const { return (u32)_mm_movemask_ps(_mm_castsi128_ps(v)); }
+};
+
+// SSE2 has no 32-bit lane multiplication (keeping the low halves), so the even and odd lanes get multiplied separately:
+INLINE i32x4 mulLow(const i32x4 &a, const i32x4 &b) {
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+INLINE i32x4 andNot(const i32x4 &mask, const i32x4 &a) { return _mm_andnot_si128(mask.v, a.v); }
+INLINE i32x4 select(const i32x4 &mask, const i32x4 &a, const i32x4 &b) { return _mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v)); }
+INLINE i32x4 truncateToI32(const f32x4 &a) { return _mm_cvttps_epi32(a.v); }
+INLINE f32x4 toF32(const i32x4 &a) { return _mm_cvtepi32_ps(a.v); }
+INLINE i32x4 gather(const i32 *values, const i32x4 &indices) {
+    alignas(16) i32 lanes[4];
+    indices.store(lanes);
+    return _mm_setr_epi32(values[lanes[0]], values[lanes[1]], values[lanes[2]], values[lanes[3]]);
+}
+INLINE f32x4 gather(const f32 *values, const i32x4 &indices) {
+    alignas(16) i32 lanes[4];
+    indices.store(lanes);
+    return _mm_setr_ps(values[lanes[0]], values[lanes[1]], values[lanes[2]], values[lanes[3]]);
+}
+
+struct u8x16 {
+    static constexpr u32 width = 16;
+    __m128i v;
+
+    INLINE u8x16() = default;
+    INLINE u8x16(__m128i v) : v{v} {}
+    INLINE u8x16(u8 value) : v{_mm_set1_epi8((char)value)} {}
+
+    INLINE static u8x16 load(const u8 *values) { return _mm_loadu_si128((const __m128i*)values); }
+    INLINE void store(u8 *values) const { _mm_storeu_si128((__m128i*)values, v); }
+
+    INLINE u8x16 operator + (const u8x16 &rhs) const { return _mm_add_epi8(v, rhs.v); }
+    INLINE u8x16 operator - (const u8x16 &rhs) const { return _mm_sub_epi8(v, rhs.v); }
+    INLINE u8x16 operator & (const u8x16 &rhs) const { return _mm_and_si128(v, rhs.v); }
+    INLINE u8x16 operator | (const u8x16 &rhs) const { return _mm_or_si128(v, rhs.v); }
+    INLINE u8x16 operator == (const u8x16 &rhs) const { return _mm_cmpeq_epi8(v, rhs.v); }
+    INLINE u32 mask() const { return (u32)_mm_movemask_epi8(v); }
+};
+
+INLINE u8x16 addSaturated(const u8x16 &a, const u8x16 &b) { return _mm_adds_epu8(a.v, b.v); }
+INLINE u8x16 subSaturated(const u8x16 &a, const u8x16 &b) { return _mm_subs_epu8(a.v, b.v); }
+INLINE u8x16 average(const u8x16 &a, const u8x16 &b) { return _mm_avg_epu8(a.v, b.v); } // Rounding up
+INLINE u8x16 minimum(const u8x16 &a, const u8x16 &b) { return _mm_min_epu8(a.v, b.v); }
+INLINE u8x16 maximum(const u8x16 &a, const u8x16 &b) { return _mm_max_epu8(a.v, b.v); }
+INLINE u8x16 select(const u8x16 &mask, const u8x16 &a, const u8x16 &b) { return _mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v)); }
+#else
+// The scalar backends keep the lanes in arrays (and masks as lanes with all their bits set):
+INLINE f32 _maskLane(bool is_set) {
+    union { u32 bits; f32 value; } lane{is_set ? 0xFFFFFFFF : 0};
+    return lane.value;
+}
+
+INLINE u32 _laneBits(f32 value) {
+    union { f32 value; u32 bits; } lane{value};
+    return lane.bits;
+}
+
+INLINE f32 _bitsLane(u32 bits) {
+    union { u32 bits; f32 value; } lane{bits};
+    return lane.value;
+}
+
+struct f32x4 {
+    static constexpr u32 width = 4;
+    f32 v[4];
+
+    INLINE f32x4() = default;
+    INLINE f32x4(f32 value) : v{value, value, value, value} {}
+
+    INLINE static f32x4 load(const f32 *values) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[i]; return result; }
+    INLINE void store(f32 *values) const { for (u32 i = 0; i < 4; i++) values[i] = v[i]; }
+
+    INLINE f32x4 operator + (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] + rhs.v[i]; return result; }
+    INLINE f32x4 operator - (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] - rhs.v[i]; return result; }
+    INLINE f32x4 operator * (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] * rhs.v[i]; return result; }
+    INLINE f32x4 operator / (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] / rhs.v[i]; return result; }
+    INLINE f32x4 operator & (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _bitsLane(_laneBits(v[i]) & _laneBits(rhs.v[i])); return result; }
+    INLINE f32x4 operator | (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _bitsLane(_laneBits(v[i]) | _laneBits(rhs.v[i])); return result; }
+    INLINE f32x4 operator <  (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] <  rhs.v[i]); return result; }
+    INLINE f32x4 operator <= (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] <= rhs.v[i]); return result; }
+    INLINE f32x4 operator >  (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] >  rhs.v[i]); return result; }
+    INLINE f32x4 operator >= (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] >= rhs.v[i]); return result; }
+    INLINE f32x4 operator == (const f32x4 &rhs) const { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _maskLane(v[i] == rhs.v[i]); return result; }
+    INLINE u32 mask() const { u32 bits = 0; for (u32 i = 0; i < 4; i++) bits |= (_laneBits(v[i]) >> 31) << i; return bits; }
+};
+
+INLINE f32x4 minimum(const f32x4 &a, const f32x4 &b) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE f32x4 maximum(const f32x4 &a, const f32x4 &b) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE f32x4 sqrt(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = sqrtf(a.v[i]); return result; }
+INLINE f32x4 approxRsqrt(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = 1.0f / sqrtf(a.v[i]); return result; }
+INLINE f32x4 approxRcp(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = 1.0f / a.v[i]; return result; }
+INLINE f32x4 mulAdd(const f32x4 &a, const f32x4 &b, const f32x4 &c) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = fast_mul_add(a.v[i], b.v[i], c.v[i]); return result; }
+INLINE f32x4 select(const f32x4 &mask, const f32x4 &a, const f32x4 &b) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = _laneBits(mask.v[i]) ? a.v[i] : b.v[i]; return result; }
+INLINE f32x4 floor(const f32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = floorf(a.v[i]); return result; }
+INLINE void deinterleave(const f32x4 &a, const f32x4 &b, f32x4 &even, f32x4 &odd) {
+    for (u32 i = 0; i < 2; i++) {
+        even.v[i] = a.v[2 * i]; even.v[i + 2] = b.v[2 * i];
+        odd.v[i] = a.v[2 * i + 1]; odd.v[i + 2] = b.v[2 * i + 1];
+    }
+}
+INLINE void interleave(const f32x4 &even, const f32x4 &odd, f32x4 &a, f32x4 &b) {
+    for (u32 i = 0; i < 2; i++) {
+        a.v[2 * i] = even.v[i]; a.v[2 * i + 1] = odd.v[i];
+        b.v[2 * i] = even.v[i + 2]; b.v[2 * i + 1] = odd.v[i + 2];
+    }
+}
+
+struct i32x4 {
+    static constexpr u32 width = 4;
+    i32 v[4];
+
+    INLINE i32x4() = default;
+    INLINE i32x4(i32 value) : v{value, value, value, value} {}
+
+    INLINE static i32x4 load(const i32 *values) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[i]; return result; }
+    INLINE void store(i32 *values) const { for (u32 i = 0; i < 4; i++) values[i] = v[i]; }
+
+    INLINE i32x4 operator + (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)v[i] + (u32)rhs.v[i]); return result; }
+    INLINE i32x4 operator - (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)v[i] - (u32)rhs.v[i]); return result; }
+    INLINE i32x4 operator & (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] & rhs.v[i]; return result; }
+    INLINE i32x4 operator | (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] | rhs.v[i]; return result; }
+    INLINE i32x4 operator ^ (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] ^ rhs.v[i]; return result; }
+    INLINE i32x4 operator ~ () const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = ~v[i]; return result; }
+    INLINE i32x4 operator << (i32 bits) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)v[i] << bits); return result; }
+    INLINE i32x4 operator >> (i32 bits) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] >> bits; return result; }
+    INLINE i32x4 operator == (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] == rhs.v[i] ? -1 : 0; return result; }
+    INLINE i32x4 operator >  (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] >  rhs.v[i] ? -1 : 0; return result; }
+    INLINE i32x4 operator <  (const i32x4 &rhs) const { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = v[i] <  rhs.v[i] ? -1 : 0; return result; }
+    INLINE u32 mask() const { u32 bits = 0; for (u32 i = 0; i < 4; i++) bits |= ((u32)v[i] >> 31) << i; return bits; }
+};
+
+INLINE i32x4 mulLow(const i32x4 &a, const i32x4 &b) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)((u32)a.v[i] * (u32)b.v[i]); return result; }
+INLINE i32x4 andNot(const i32x4 &mask, const i32x4 &a) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = ~mask.v[i] & a.v[i]; return result; }
+INLINE i32x4 select(const i32x4 &mask, const i32x4 &a, const i32x4 &b) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = mask.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE i32x4 truncateToI32(const f32x4 &a) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (i32)a.v[i]; return result; }
+INLINE f32x4 toF32(const i32x4 &a) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = (f32)a.v[i]; return result; }
+INLINE i32x4 gather(const i32 *values, const i32x4 &indices) { i32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[indices.v[i]]; return result; }
+INLINE f32x4 gather(const f32 *values, const i32x4 &indices) { f32x4 result; for (u32 i = 0; i < 4; i++) result.v[i] = values[indices.v[i]]; return result; }
+
+struct u8x16 {
+    static constexpr u32 width = 16;
+    u8 v[16];
+
+    INLINE u8x16() = default;
+    INLINE u8x16(u8 value) { for (u32 i = 0; i < 16; i++) v[i] = value; }
+
+    INLINE static u8x16 load(const u8 *values) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = values[i]; return result; }
+    INLINE void store(u8 *values) const { for (u32 i = 0; i < 16; i++) values[i] = v[i]; }
+
+    INLINE u8x16 operator + (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = (u8)(v[i] + rhs.v[i]); return result; }
+    INLINE u8x16 operator - (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = (u8)(v[i] - rhs.v[i]); return result; }
+    INLINE u8x16 operator & (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = v[i] & rhs.v[i]; return result; }
+    INLINE u8x16 operator | (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = v[i] | rhs.v[i]; return result; }
+    INLINE u8x16 operator == (const u8x16 &rhs) const { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = v[i] == rhs.v[i] ? 0xFF : 0; return result; }
+    INLINE u32 mask() const { u32 bits = 0; for (u32 i = 0; i < 16; i++) bits |= (u32)(v[i] >> 7) << i; return bits; }
+};
+
+INLINE u8x16 addSaturated(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) { u32 sum = a.v[i] + b.v[i]; result.v[i] = (u8)(sum < 255 ? sum : 255); } return result; }
+INLINE u8x16 subSaturated(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = a.v[i] > b.v[i] ? (u8)(a.v[i] - b.v[i]) : 0; return result; }
+INLINE u8x16 average(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = (u8)((a.v[i] + b.v[i] + 1) >> 1); return result; }
+INLINE u8x16 minimum(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE u8x16 maximum(const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return result; }
+INLINE u8x16 select(const u8x16 &mask, const u8x16 &a, const u8x16 &b) { u8x16 result; for (u32 i = 0; i < 16; i++) result.v[i] = mask.v[i] ? a.v[i] : b.v[i]; return result; }
+#endif
+
+// Without AVX2, the 8-wide types are pairs of 4-wide ones:
+#ifdef SLIM_AVX2
+struct f32x8 {
+    static constexpr u32 width = 8;
+    __m256 v;
+
+    f32x8() = default;
+    SLIM_INLINE_AVX2 f32x8(__m256 v) : v{v} {}
+    SLIM_INLINE_AVX2 f32x8(f32 value) : v{_mm256_set1_ps(value)} {}
+
+    SLIM_INLINE_AVX2 static f32x8 load(const f32 *values) { return _mm256_loadu_ps(values); }
+    SLIM_INLINE_AVX2 void store(f32 *values) const { _mm256_storeu_ps(values, v); }
+
+    SLIM_INLINE_AVX2 f32x8 operator + (const f32x8 &rhs) const { return _mm256_add_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator - (const f32x8 &rhs) const { return _mm256_sub_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator * (const f32x8 &rhs) const { return _mm256_mul_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator / (const f32x8 &rhs) const { return _mm256_div_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator & (const f32x8 &rhs) const { return _mm256_and_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator | (const f32x8 &rhs) const { return _mm256_or_ps(v, rhs.v); }
+    SLIM_INLINE_AVX2 f32x8 operator <  (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_LT_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator <= (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_LE_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator >  (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_GT_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator >= (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_GE_OQ); }
+    SLIM_INLINE_AVX2 f32x8 operator == (const f32x8 &rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_EQ_OQ); }
+    SLIM_INLINE_AVX2 u32 mask() const { return (u32)_mm256_movemask_ps(v); }
+};
+
+SLIM_INLINE_AVX2 f32x8 minimum(const f32x8 &a, const f32x8 &b) { return _mm256_min_ps(a.v, b.v); }
+SLIM_INLINE_AVX2 f32x8 maximum(const f32x8 &a, const f32x8 &b) { return _mm256_max_ps(a.v, b.v); }
+SLIM_INLINE_AVX2 f32x8 sqrt(const f32x8 &a) { return _mm256_sqrt_ps(a.v); }
+SLIM_INLINE_AVX2 f32x8 approxRsqrt(const f32x8 &a) { return _mm256_rsqrt_ps(a.v); }
+SLIM_INLINE_AVX2 f32x8 approxRcp(const f32x8 &a) { return _mm256_rcp_ps(a.v); }
+#ifdef FP_FAST_FMAF
+SLIM_INLINE_AVX2 f32x8 mulAdd(const f32x8 &a, const f32x8 &b, const f32x8 &c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+#else
+SLIM_INLINE_AVX2 f32x8 mulAdd(const f32x8 &a, const f32x8 &b, const f32x8 &c) { return _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v); }
+#endif
+SLIM_INLINE_AVX2 f32x8 select(const f32x8 &mask, const f32x8 &a, const f32x8 &b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+SLIM_INLINE_AVX2 f32x8 floor(const f32x8 &a) { return _mm256_floor_ps(a.v); }
+
+// Shuffles happen within 128-bit halves, so the halves then get put back in order:
+SLIM_INLINE_AVX2 void deinterleave(const f32x8 &a, const f32x8 &b, f32x8 &even, f32x8 &odd) {
+    even = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+    odd  = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+SLIM_INLINE_AVX2 void interleave(const f32x8 &even, const f32x8 &odd, f32x8 &a, f32x8 &b) {
+    __m256 low  = _mm256_unpacklo_ps(even.v, odd.v);
+    __m256 high = _mm256_unpackhi_ps(even.v, odd.v);
+    a = _mm256_permute2f128_ps(low, high, 0x20);
+    b = _mm256_permute2f128_ps(low, high, 0x31);
+}
+
+struct i32x8 {
+    static constexpr u32 width = 8;
+    __m256i v;
+
+    i32x8() = default;
+    SLIM_INLINE_AVX2 i32x8(__m256i v) : v{v} {}
+    SLIM_INLINE_AVX2 i32x8(i32 value) : v{_mm256_set1_epi32(value)} {}
+
+    SLIM_INLINE_AVX2 static i32x8 load(const i32 *values) { return _mm256_loadu_si256((const __m256i*)values); }
+    SLIM_INLINE_AVX2 void store(i32 *values) const { _mm256_storeu_si256((__m256i*)values, v); }
+
+    SLIM_INLINE_AVX2 i32x8 operator + (const i32x8 &rhs) const { return _mm256_add_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator - (const i32x8 &rhs) const { return _mm256_sub_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator & (const i32x8 &rhs) const { return _mm256_and_si256(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator | (const i32x8 &rhs) const { return _mm256_or_si256(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator ^ (const i32x8 &rhs) const { return _mm256_xor_si256(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator ~ () const { return _mm256_xor_si256(v, _mm256_set1_epi32(-1)); }
+    SLIM_INLINE_AVX2 i32x8 operator << (i32 bits) const { return _mm256_sll_epi32(v, _mm_cvtsi32_si128(bits)); }
+    SLIM_INLINE_AVX2 i32x8 operator >> (i32 bits) const { return _mm256_sra_epi32(v, _mm_cvtsi32_si128(bits)); }
+    SLIM_INLINE_AVX2 i32x8 operator == (const i32x8 &rhs) const { return _mm256_cmpeq_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator >  (const i32x8 &rhs) const { return _mm256_cmpgt_epi32(v, rhs.v); }
+    SLIM_INLINE_AVX2 i32x8 operator <  (const i32x8 &rhs) const { return _mm256_cmpgt_epi32(rhs.v, v); }
+    SLIM_INLINE_AVX2 u32 mask() const { return (u32)_mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+};
+
+SLIM_INLINE_AVX2 i32x8 mulLow(const i32x8 &a, const i32x8 &b) { return _mm256_mullo_epi32(a.v, b.v); }
+SLIM_INLINE_AVX2 i32x8 andNot(const i32x8 &mask, const i32x8 &a) { return _mm256_andnot_si256(mask.v, a.v); }
+SLIM_INLINE_AVX2 i32x8 select(const i32x8 &mask, const i32x8 &a, const i32x8 &b) { return _mm256_blendv_epi8(b.v, a.v, mask.v); }
+SLIM_INLINE_AVX2 i32x8 truncateToI32(const f32x8 &a) { return _mm256_cvttps_epi32(a.v); }
+SLIM_INLINE_AVX2 f32x8 toF32(const i32x8 &a) { return _mm256_cvtepi32_ps(a.v); }
+SLIM_INLINE_AVX2 i32x8 gather(const i32 *values, const i32x8 &indices) { return _mm256_i32gather_epi32((const int*)values, indices.v, 4); }
+SLIM_INLINE_AVX2 f32x8 gather(const f32 *values, const i32x8 &indices) { return _mm256_i32gather_ps(values, indices.v, 4); }
+#else
+struct f32x8 {
+    static constexpr u32 width = 8;
+    f32x4 low, high;
+
+    INLINE f32x8() = default;
+    INLINE f32x8(const f32x4 &low, const f32x4 &high) : low{low}, high{high} {}
+    INLINE f32x8(f32 value) : low{value}, high{value} {}
+
+    INLINE static f32x8 load(const f32 *values) { return {f32x4::load(values), f32x4::load(values + 4)}; }
+    INLINE void store(f32 *values) const { low.store(values); high.store(values + 4); }
+
+    INLINE f32x8 operator + (const f32x8 &rhs) const { return {low + rhs.low, high + rhs.high}; }
+    INLINE f32x8 operator - (const f32x8 &rhs) const { return {low - rhs.low, high - rhs.high}; }
+    INLINE f32x8 operator * (const f32x8 &rhs) const { return {low * rhs.low, high * rhs.high}; }
+    INLINE f32x8 operator / (const f32x8 &rhs) const { return {low / rhs.low, high / rhs.high}; }
+    INLINE f32x8 operator & (const f32x8 &rhs) const { return {low & rhs.low, high & rhs.high}; }
+    INLINE f32x8 operator | (const f32x8 &rhs) const { return {low | rhs.low, high | rhs.high}; }
+    INLINE f32x8 operator <  (const f32x8 &rhs) const { return {low <  rhs.low, high <  rhs.high}; }
+    INLINE f32x8 operator <= (const f32x8 &rhs) const { return {low <= rhs.low, high <= rhs.high}; }
+    INLINE f32x8 operator >  (const f32x8 &rhs) const { return {low >  rhs.low, high >  rhs.high}; }
+    INLINE f32x8 operator >= (const f32x8 &rhs) const { return {low >= rhs.low, high >= rhs.high}; }
+    INLINE f32x8 operator == (const f32x8 &rhs) const { return {low == rhs.low, high == rhs.high}; }
+    INLINE u32 mask() const { return low.mask() | high.mask() << 4; }
+};
+
+INLINE f32x8 minimum(const f32x8 &a, const f32x8 &b) { return {minimum(a.low, b.low), minimum(a.high, b.high)}; }
+INLINE f32x8 maximum(const f32x8 &a, const f32x8 &b) { return {maximum(a.low, b.low), maximum(a.high, b.high)}; }
+INLINE f32x8 sqrt(const f32x8 &a) { return {sqrt(a.low), sqrt(a.high)}; }
+INLINE f32x8 approxRsqrt(const f32x8 &a) { return {approxRsqrt(a.low), approxRsqrt(a.high)}; }
+INLINE f32x8 approxRcp(const f32x8 &a) { return {approxRcp(a.low), approxRcp(a.high)}; }
+INLINE f32x8 select(const f32x8 &mask, const f32x8 &a, const f32x8 &b) { return {select(mask.low, a.low, b.low), select(mask.high, a.high, b.high)}; }
+INLINE f32x8 floor(const f32x8 &a) { return {floor(a.low), floor(a.high)}; }
+INLINE void deinterleave(const f32x8 &a, const f32x8 &b, f32x8 &even, f32x8 &odd) {
+    deinterleave(a.low, a.high, even.low, odd.low);
+    deinterleave(b.low, b.high, even.high, odd.high);
+}
+INLINE void interleave(const f32x8 &even, const f32x8 &odd, f32x8 &a, f32x8 &b) {
+    interleave(even.low, odd.low, a.low, a.high);
+    interleave(even.high, odd.high, b.low, b.high);
+}
+
+struct i32x8 {
+    static constexpr u32 width = 8;
+    i32x4 low, high;
+
+    INLINE i32x8() = default;
+    INLINE i32x8(const i32x4 &low, const i32x4 &high) : low{low}, high{high} {}
+    INLINE i32x8(i32 value) : low{value}, high{value} {}
+
+    INLINE static i32x8 load(const i32 *values) { return {i32x4::load(values), i32x4::load(values + 4)}; }
+    INLINE void store(i32 *values) const { low.store(values); high.store(values + 4); }
+
+    INLINE i32x8 operator + (const i32x8 &rhs) const { return {low + rhs.low, high + rhs.high}; }
+    INLINE i32x8 operator - (const i32x8 &rhs) const { return {low - rhs.low, high - rhs.high}; }
+    INLINE i32x8 operator & (const i32x8 &rhs) const { return {low & rhs.low, high & rhs.high}; }
+    INLINE i32x8 operator | (const i32x8 &rhs) const { return {low | rhs.low, high | rhs.high}; }
+    INLINE i32x8 operator ^ (const i32x8 &rhs) const { return {low ^ rhs.low, high ^ rhs.high}; }
+    INLINE i32x8 operator ~ () const { return {~low, ~high}; }
+    INLINE i32x8 operator << (i32 bits) const { return {low << bits, high << bits}; }
+    INLINE i32x8 operator >> (i32 bits) const { return {low >> bits, high >> bits}; }
+    INLINE i32x8 operator == (const i32x8 &rhs) const { return {low == rhs.low, high == rhs.high}; }
+    INLINE i32x8 operator >  (const i32x8 &rhs) const { return {low >  rhs.low, high >  rhs.high}; }
+    INLINE i32x8 operator <  (const i32x8 &rhs) const { return {low <  rhs.low, high <  rhs.high}; }
+    INLINE u32 mask() const { return low.mask() | high.mask() << 4; }
+};
+
+INLINE i32x8 mulLow(const i32x8 &a, const i32x8 &b) { return {mulLow(a.low, b.low), mulLow(a.high, b.high)}; }
+INLINE i32x8 andNot(const i32x8 &mask, const i32x8 &a) { return {andNot(mask.low, a.low), andNot(mask.high, a.high)}; }
+INLINE i32x8 select(const i32x8 &mask, const i32x8 &a, const i32x8 &b) { return {select(mask.low, a.low, b.low), select(mask.high, a.high, b.high)}; }
+INLINE i32x8 truncateToI32(const f32x8 &a) { return {truncateToI32(a.low), truncateToI32(a.high)}; }
+INLINE f32x8 toF32(const i32x8 &a) { return {toF32(a.low), toF32(a.high)}; }
+INLINE i32x8 gather(const i32 *values, const i32x8 &indices) { return {gather(values, indices.low), gather(values, indices.high)}; }
+INLINE f32x8 gather(const f32 *values, const i32x8 &indices) { return {gather(values, indices.low), gather(values, indices.high)}; }
+#endif
+
+// Approximate reciprocal square roots refined by a Newton-Raphson step (to about 22 bits of precision):
+template <typename F32>
+SLIM_INLINE_KERNEL F32 refinedRsqrt(const F32 &value) {
+    F32 estimate = approxRsqrt(value);
+    return estimate * (F32{1.5f} - F32{0.5f} * value * estimate * estimate);
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "./base.h"
+#include "./simd.h"
 
 struct TexelQuadComponent {
     u8 TL, TR, BL, BR;
@@ -10,10 +10,37 @@ struct TexelQuad {
     TexelQuadComponent R, G, B;
 };
 
+// How the texel quads of a mip are laid out in memory. Mips are a grid of (width + 1) by (height + 1) quads,
+// stored either in rows, or in tiles of 4x4 quads (stored one after the other in rows of tiles, the ones along the right
+// and bottom edges padded to whole tiles). Tiles keep the quads around a position close together in memory
+// whichever direction sampling moves in (a tile spans 3 cache lines), rather than only along rows.
+// Textures with `flags.swizzle` set have tiled mips:
+enum TexelLayout {
+    TexelLayoutRows,
+    TexelLayoutTiles
+};
+
 struct TextureMip {
     u32 width, height;
     TexelQuad *texel_quads;
 
+    // The index of the quad at column x and row y of a grid that is stride quads wide:
+    template <TexelLayout LAYOUT = TexelLayoutRows>
+    INLINE_XPU static u32 GetQuadIndex(u32 x, u32 y, u32 stride) {
+        if (LAYOUT == TexelLayoutTiles)
+            return ((((y >> 2) * ((stride + 3) >> 2) + (x >> 2)) << 4) | ((y & 3) << 2) | (x & 3));
+
+        return y * stride + x;
+    }
+
+    INLINE_XPU static u32 GetQuadCount(u32 width, u32 height, TexelLayout layout = TexelLayoutRows) {
+        if (layout == TexelLayoutTiles)
+            return ((width + 4) >> 2) * ((height + 4) >> 2) * 16;
+
+        return (width + 1) * (height + 1);
+    }
+
+    template <TexelLayout LAYOUT = TexelLayoutRows>
     INLINE_XPU Pixel sample(f32 u, f32 v) const {
         if (u > 1) u -= (f32)((u32)u);
         if (v > 1) v -= (f32)((u32)v);
@@ -31,7 +58,7 @@ struct TextureMip {
         const f32 bl = b * l * COLOR_COMPONENT_TO_FLOAT;
         const f32 br = b * r * COLOR_COMPONENT_TO_FLOAT;
 
-        const TexelQuad texel_quad = texel_quads[y * (width + 1) + x];
+        const TexelQuad texel_quad = texel_quads[GetQuadIndex<LAYOUT>(x, y, width + 1)];
         return {
                 fast_mul_add((f32)texel_quad.R.BR, br, fast_mul_add((f32)texel_quad.R.BL, bl, fast_mul_add((f32)texel_quad.R.TR, tr, (f32)texel_quad.R.TL * tl))),
                 fast_mul_add((f32)texel_quad.G.BR, br, fast_mul_add((f32)texel_quad.G.BL, bl, fast_mul_add((f32)texel_quad.G.TR, tr, (f32)texel_quad.G.TL * tl))),
@@ -39,6 +66,127 @@ struct TextureMip {
                 1.0f
         };
     }
+
+    // Sample 4 (or 8) positions at once (given as arrays of u and v), with the same results as sample() for each:
+    template <TexelLayout LAYOUT = TexelLayoutRows> void sample4(const f32 *u, const f32 *v, Pixel *out) const;
+    template <TexelLayout LAYOUT = TexelLayoutRows> void sample8(const f32 *u, const f32 *v, Pixel *out) const;
+};
+
+template <TexelLayout LAYOUT, typename I32>
+SLIM_INLINE_KERNEL I32 _texelQuadIndexLanes(const I32 &x, const I32 &y, i32 stride) {
+    if (LAYOUT == TexelLayoutTiles) {
+        const I32 mask{3};
+        const I32 tile = mulLow(y >> 2, I32{(stride + 3) >> 2}) + (x >> 2);
+        return (tile << 4) | ((y & mask) << 2) | (x & mask);
+    }
+
+    return mulLow(y, I32{stride}) + x;
+}
+
+// Samples packets of positions the way TextureMip::sample() does (the same operations in the same order, fused or not).
+// The components of the texel quads (the 4 texels around a position, a byte each) are gathered as integers,
+// and the pixels get interleaved back into place:
+template <typename F32, typename I32>
+SLIM_INLINE_KERNEL F32 _weighTexelQuadLanes(const I32 &values, const F32 &tl, const F32 &tr, const F32 &bl, const F32 &br) {
+    const I32 byte_mask{255};
+    return mulAdd(toF32((values >> 24) & byte_mask), br,
+           mulAdd(toF32((values >> 16) & byte_mask), bl,
+           mulAdd(toF32((values >> 8) & byte_mask), tr,
+                  toF32(values & byte_mask) * tl)));
+}
+
+template <typename F32>
+SLIM_INLINE_KERNEL void _storePixelLanes(const F32 &red, const F32 &green, const F32 &blue, const F32 &opacity, Pixel *out) {
+    F32 red_blue[2], green_opacity[2], pixels[2];
+    interleave(red, blue, red_blue[0], red_blue[1]);
+    interleave(green, opacity, green_opacity[0], green_opacity[1]);
+    f32 *values = &out->color.r;
+    for (u32 i = 0; i < 2; i++, values += F32::width * 2) {
+        interleave(red_blue[i], green_opacity[i], pixels[0], pixels[1]);
+        pixels[0].store(values);
+        pixels[1].store(values + F32::width);
+    }
+}
+
+template <TexelLayout LAYOUT, typename F32, typename I32>
+SLIM_INLINE_KERNEL void _sampleTextureMipWide(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    const F32 one{1.0f};
+    const F32 half{0.5f};
+    const F32 to_float{COLOR_COMPONENT_TO_FLOAT};
+    F32 U = F32::load(u);
+    F32 V = F32::load(v);
+    U = select(U > one, U - toF32(truncateToI32(U)), U);
+    V = select(V > one, V - toF32(truncateToI32(V)), V);
+    U = U * F32{(f32)texture_mip.width} + half;
+    V = V * F32{(f32)texture_mip.height} + half;
+
+    const I32 x = truncateToI32(U);
+    const I32 y = truncateToI32(V);
+    const F32 r = U - toF32(x);
+    const F32 b = V - toF32(y);
+    const F32 l = one - r;
+    const F32 t = one - b;
+    const F32 tl = t * l * to_float;
+    const F32 tr = t * r * to_float;
+    const F32 bl = b * l * to_float;
+    const F32 br = b * r * to_float;
+
+    const I32 quad = _texelQuadIndexLanes<LAYOUT>(x, y, (i32)texture_mip.width + 1);
+    const I32 offset = quad + quad + quad;
+    const i32 *components = (const i32*)texture_mip.texel_quads;
+    _storePixelLanes(_weighTexelQuadLanes(gather(components, offset), tl, tr, bl, br),
+                     _weighTexelQuadLanes(gather(components, offset + I32{1}), tl, tr, bl, br),
+                     _weighTexelQuadLanes(gather(components, offset + I32{2}), tl, tr, bl, br),
+                     one, out);
+}
+
+template <TexelLayout LAYOUT>
+void _sampleTextureMip8Scalar(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    for (u32 i = 0; i < 8; i++) out[i] = texture_mip.sample<LAYOUT>(u[i], v[i]);
+}
+
+#ifdef SLIM_SSE2
+template <TexelLayout LAYOUT>
+void _sampleTextureMip8SSE2(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    _sampleTextureMipWide<LAYOUT, f32x4, i32x4>(texture_mip, u, v, out);
+    _sampleTextureMipWide<LAYOUT, f32x4, i32x4>(texture_mip, u + 4, v + 4, out + 4);
+}
+#endif
+
+#ifdef SLIM_AVX2
+template <TexelLayout LAYOUT>
+SLIM_TARGET_AVX2 void _sampleTextureMip8AVX2(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out) {
+    _sampleTextureMipWide<LAYOUT, f32x8, i32x8>(texture_mip, u, v, out);
+}
+#endif
+
+typedef void (*SampleTextureMip8Kernel)(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out);
+SampleTextureMip8Kernel sample_texture_mip8_kernel = selectKernel<SampleTextureMip8Kernel>(
+        _sampleTextureMip8Scalar<TexelLayoutRows>,
+        SIMD_SSE2_KERNEL(_sampleTextureMip8SSE2<TexelLayoutRows>),
+        SIMD_AVX2_KERNEL(_sampleTextureMip8AVX2<TexelLayoutRows>));
+SampleTextureMip8Kernel sample_tiled_texture_mip8_kernel = selectKernel<SampleTextureMip8Kernel>(
+        _sampleTextureMip8Scalar<TexelLayoutTiles>,
+        SIMD_SSE2_KERNEL(_sampleTextureMip8SSE2<TexelLayoutTiles>),
+        SIMD_AVX2_KERNEL(_sampleTextureMip8AVX2<TexelLayoutTiles>));
+
+// 4 lanes are either SSE2 or the scalar backend of f32x4, so need no picking:
+template <TexelLayout LAYOUT>
+INLINE void TextureMip::sample4(const f32 *u, const f32 *v, Pixel *out) const {
+    _sampleTextureMipWide<LAYOUT, f32x4, i32x4>(*this, u, v, out);
+}
+
+template <TexelLayout LAYOUT>
+INLINE void TextureMip::sample8(const f32 *u, const f32 *v, Pixel *out) const {
+    if (LAYOUT == TexelLayoutTiles) sample_tiled_texture_mip8_kernel(*this, u, v, out);
+    else                            sample_texture_mip8_kernel(*this, u, v, out);
+}
+
+// Where a pixel lands in a texture, see Texture::getFootprint():
+struct TextureFootprint {
+    f32 lod = 0;          // Level of detail of each tap
+    f32 du = 0, dv = 0;   // From one tap to the next (in uv), along the longer axis
+    u32 tap_count = 1;
 };
 
 struct Texture : ImageInfo {
@@ -53,6 +201,16 @@ struct Texture : ImageInfo {
         return mip_level;
     }
 
+    // The level of detail between mip levels (which GetMipLevel() rounds up to), for filtering across the 2 nearest mips:
+    XPU static f32 GetMipLOD(f32 texel_area, u32 mip_count) {
+        if (texel_area <= 1 || mip_count <= 1)
+            return 0;
+
+        const f32 lod = 0.5f * log2f(texel_area); // Each level halving texels along each axis, so quartering their areas
+        const f32 max_lod = (f32)(mip_count - 1);
+        return lod < max_lod ? lod : max_lod;
+    }
+
     XPU static u32 GetMipLevel(u32 width, u32 height, u32 mip_count, f32 uv_area) {
         return GetMipLevel(uv_area * (f32)(width * height), mip_count);
     }
@@ -61,7 +219,176 @@ struct Texture : ImageInfo {
         return GetMipLevel(uv_area * (f32)(texture.width * texture.height), texture.mip_count);
     }
 
+    INLINE_XPU TexelLayout texelLayout() const {
+        return flags.swizzle ? TexelLayoutTiles : TexelLayoutRows;
+    }
+
     INLINE_XPU Pixel sample(f32 u, f32 v, f32 uv_area) const {
-        return mips[flags.mipmap ? GetMipLevel(uv_area * (f32)(width * height), mip_count) : 0].sample(u, v);
+        return _sampleMip(mips[flags.mipmap ? GetMipLevel(uv_area * (f32)(width * height), mip_count) : 0], u, v);
+    }
+
+    // Samples the 2 mips nearest to the level of detail, blending between them by where it lies in between:
+    INLINE_XPU Pixel sampleTrilinear(f32 u, f32 v, f32 uv_area) const {
+        if (!flags.mipmap)
+            return _sampleMip(mips[0], u, v);
+
+        return sampleLOD(u, v, GetMipLOD(uv_area * (f32)(width * height), mip_count));
+    }
+
+    // Levels of detail are clamped to the mips there are, with the last mip sampled alone:
+    INLINE_XPU Pixel sampleLOD(f32 u, f32 v, f32 lod) const {
+        lod = _clampedLOD(lod);
+        const u32 mip_level = (u32)lod;
+        const f32 fraction = lod - (f32)mip_level;
+        Pixel pixel = _sampleMip(mips[mip_level], u, v);
+        if (fraction > 0)
+            pixel.color = pixel.color.lerpTo(_sampleMip(mips[mip_level + 1], u, v).color, fraction);
+
+        return pixel;
+    }
+
+    // Packets of 4 (or 8) positions sampled trilinearly (with the same results as sampleTrilinear() for each).
+    // The level of detail is shared by all of them, as it would be for neighboring pixels:
+    void sampleTrilinear4(const f32 *u, const f32 *v, f32 uv_area, Pixel *out) const {
+        _sampleTrilinear(u, v, uv_area, out, 4);
+    }
+
+    void sampleTrilinear8(const f32 *u, const f32 *v, f32 uv_area, Pixel *out) const {
+        _sampleTrilinear(u, v, uv_area, out, 8);
+    }
+
+    // The footprint of a pixel in the texture, given the screen-space derivatives of u and v (per pixel to the right and down).
+    // The level of detail comes from the longer of the 2 axes (so that nothing gets under-filtered along either of them).
+    // With an anisotropy above 1, up to that many taps get spread along the longer axis instead, each one only needing
+    // the level of detail of its share of it (no coarser than the shorter axis):
+    XPU TextureFootprint getFootprint(f32 du_dx, f32 dv_dx, f32 du_dy, f32 dv_dy, u32 max_anisotropy = 1) const {
+        TextureFootprint footprint;
+        const f32 x_length_squared = _texelLengthSquared(du_dx, dv_dx);
+        const f32 y_length_squared = _texelLengthSquared(du_dy, dv_dy);
+        const bool x_is_major = x_length_squared >= y_length_squared;
+        f32 major_length_squared = x_is_major ? x_length_squared : y_length_squared;
+        const f32 minor_length_squared = x_is_major ? y_length_squared : x_length_squared;
+
+        if (max_anisotropy > 1 && major_length_squared > minor_length_squared) {
+            const f32 ratio = minor_length_squared > 0 ? sqrtf(major_length_squared / minor_length_squared) : (f32)max_anisotropy;
+            footprint.tap_count = ratio < (f32)max_anisotropy ? (u32)ceilf(ratio) : max_anisotropy;
+            if (footprint.tap_count > 1) {
+                const f32 one_over_tap_count = 1.0f / (f32)footprint.tap_count;
+                footprint.du = (x_is_major ? du_dx : du_dy) * one_over_tap_count;
+                footprint.dv = (x_is_major ? dv_dx : dv_dy) * one_over_tap_count;
+                major_length_squared *= one_over_tap_count * one_over_tap_count;
+            }
+        }
+        if (flags.mipmap)
+            footprint.lod = GetMipLOD(major_length_squared, mip_count);
+
+        return footprint;
+    }
+
+    // The mip closest to a texel per pixel along the longer axis of its footprint (for drawing from a single mip):
+    XPU u32 getMipLevel(f32 du_dx, f32 dv_dx, f32 du_dy, f32 dv_dy) const {
+        if (!flags.mipmap)
+            return 0;
+
+        const f32 x_length_squared = _texelLengthSquared(du_dx, dv_dx);
+        const f32 y_length_squared = _texelLengthSquared(du_dy, dv_dy);
+        return GetMipLevel(x_length_squared > y_length_squared ? x_length_squared : y_length_squared, mip_count);
+    }
+
+    // Samples by the screen-space derivatives of u and v (instead of a uv area, see getFootprint()):
+    INLINE_XPU Pixel sampleGrad(f32 u, f32 v, f32 du_dx, f32 dv_dx, f32 du_dy, f32 dv_dy, u32 max_anisotropy = 1) const {
+        return sample(u, v, getFootprint(du_dx, dv_dx, du_dy, dv_dy, max_anisotropy));
+    }
+
+    // Averages the footprint's taps, centered around the position:
+    INLINE_XPU Pixel sample(f32 u, f32 v, const TextureFootprint &footprint) const {
+        if (footprint.tap_count == 1)
+            return sampleLOD(u, v, footprint.lod);
+
+        Color color{0.0f, 0.0f, 0.0f};
+        f32 offset = -0.5f * (f32)(footprint.tap_count - 1);
+        for (u32 t = 0; t < footprint.tap_count; t++, offset += 1.0f)
+            color += sampleLOD(_wrapped(u + footprint.du * offset),
+                               _wrapped(v + footprint.dv * offset), footprint.lod).color;
+
+        return {color / (f32)footprint.tap_count, 1.0f};
+    }
+
+    // Samples a 2x2 quad of pixels (top-left, top-right, bottom-left, bottom-right), as GPUs do:
+    // The derivatives are taken from the differences between its positions, for a level of detail (and taps) per quad.
+    void sampleQuad(const f32 *u, const f32 *v, Pixel *out, u32 max_anisotropy = 1) const {
+        const TextureFootprint footprint = getFootprint(u[1] - u[0], v[1] - v[0], u[2] - u[0], v[2] - v[0], max_anisotropy);
+        if (footprint.tap_count == 1) {
+            _sampleLOD(u, v, footprint.lod, out, 4);
+            return;
+        }
+
+        Color colors[4] = {};
+        Pixel taps[4];
+        f32 tap_u[4], tap_v[4];
+        f32 offset = -0.5f * (f32)(footprint.tap_count - 1);
+        for (u32 t = 0; t < footprint.tap_count; t++, offset += 1.0f) {
+            for (u32 i = 0; i < 4; i++) {
+                tap_u[i] = _wrapped(u[i] + footprint.du * offset);
+                tap_v[i] = _wrapped(v[i] + footprint.dv * offset);
+            }
+            _sampleLOD(tap_u, tap_v, footprint.lod, taps, 4);
+            for (u32 i = 0; i < 4; i++) colors[i] += taps[i].color;
+        }
+
+        const f32 one_over_tap_count = 1.0f / (f32)footprint.tap_count;
+        for (u32 i = 0; i < 4; i++) out[i] = Pixel{colors[i] * one_over_tap_count, 1.0f};
+    }
+
+    INLINE_XPU f32 _texelLengthSquared(f32 du, f32 dv) const {
+        du *= (f32)width;
+        dv *= (f32)height;
+        return du * du + dv * dv;
+    }
+
+    // Taps offset to before the start of the texture wrap around it (as mips do past its end):
+    INLINE_XPU static f32 _wrapped(f32 coordinate) {
+        return coordinate < 0 ? coordinate - floorf(coordinate) : coordinate;
+    }
+
+    // Mips of textures get sampled by the layout of their texel quads (specialized, see TexelLayout):
+    INLINE_XPU Pixel _sampleMip(const TextureMip &texture_mip, f32 u, f32 v) const {
+        return flags.swizzle ? texture_mip.sample<TexelLayoutTiles>(u, v) : texture_mip.sample(u, v);
+    }
+
+    INLINE void _samplePacket(const TextureMip &texture_mip, const f32 *u, const f32 *v, Pixel *out, u32 count) const {
+        if (flags.swizzle) {
+            if (count == 8) texture_mip.sample8<TexelLayoutTiles>(u, v, out);
+            else            texture_mip.sample4<TexelLayoutTiles>(u, v, out);
+        } else {
+            if (count == 8) texture_mip.sample8(u, v, out);
+            else            texture_mip.sample4(u, v, out);
+        }
+    }
+
+    void _sampleTrilinear(const f32 *u, const f32 *v, f32 uv_area, Pixel *out, u32 count) const {
+        if (!flags.mipmap) {
+            _samplePacket(mips[0], u, v, out, count);
+            return;
+        }
+
+        _sampleLOD(u, v, GetMipLOD(uv_area * (f32)(width * height), mip_count), out, count);
+    }
+
+    INLINE_XPU f32 _clampedLOD(f32 lod) const {
+        const f32 max_lod = mip_count > 1 ? (f32)(mip_count - 1) : 0;
+        return lod > 0 ? (lod < max_lod ? lod : max_lod) : 0; // Also mapping NaNs to the first mip
+    }
+
+    void _sampleLOD(const f32 *u, const f32 *v, f32 lod, Pixel *out, u32 count) const {
+        lod = _clampedLOD(lod);
+        const u32 mip_level = (u32)lod;
+        const f32 fraction = lod - (f32)mip_level;
+        _samplePacket(mips[mip_level], u, v, out, count);
+        if (fraction > 0) {
+            Pixel next[8];
+            _samplePacket(mips[mip_level + 1], u, v, next, count);
+            for (u32 i = 0; i < count; i++) out[i].color = out[i].color.lerpTo(next[i].color, fraction);
+        }
     }
 };
\ No newline at end of file
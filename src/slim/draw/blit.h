@@ -0,0 +1,540 @@
+#pragma once
+
+#include "./canvas.h"
+#include "../core/texture.h"
+#include "../math/vec2x.h"
+
+// Drawing images and textures through affine transforms (scaled, rotated, skewed or flipped), with nearest or bilinear filtering.
+// Each row of canvas pixels gets mapped back into the source (its pixel centers stepping by a constant offset in the source),
+// clipped to the run of pixels whose centers land within the source, then sampled a packet of pixels at a time.
+
+enum ImageFilter {
+    ImageFilterNearest,
+    ImageFilterBilinear
+};
+
+// How the texels of a source are laid out in memory:
+enum BlitFormat {
+    BlitFormatByteColors, // ByteColor
+    BlitFormatRGB,        // 3 floats
+    BlitFormatRGBA,       // 4 floats (as in Pixel)
+    BlitFormatTexelQuads, // TexelQuad (of a TextureMip, holding each texel along with the ones above and to the left of it)
+    BlitFormatTiledTexelQuads // TexelQuad in 4x4 tiles (of a TextureMip of a texture with tiled mips, see TexelLayout)
+};
+
+// How many pixels of a row get sampled at a time, how many rows a job draws, and how many pixels a blit needs for drawing it with jobs:
+#define BLIT_SPAN_SIZE 128
+#define BLIT_BAND_HEIGHT 16
+#define BLIT_PARALLEL_MIN_PIXELS (CANVAS_TILE_SIZE * CANVAS_TILE_SIZE)
+
+struct ImageBlit {
+    const void *content{nullptr};
+    i32 width{0};
+    i32 height{0};
+    i32 stride{0}; // In texels (or texel quads)
+    i32 tile_width{0}; // Of tiled images, which get sampled a texel at a time (0 for the rest)
+    i32 tile_height{0};
+    i32 quad_x{0}; // Where tiled texel quads start within their mip (sub-images of those can't start at an offset pointer)
+    i32 quad_y{0};
+    BlitFormat format{BlitFormatRGBA};
+    ImageFilter filter{ImageFilterBilinear};
+    bool has_alpha{false};
+    f32 opacity{1.0f};
+    Color tint{1.0f, 1.0f, 1.0f}; // Multiplies the sampled colors
+
+    // Where in the source (in texels) the center of canvas pixel (0, 0) lands, and how far it moves per pixel to the right and down:
+    vec2 origin;
+    vec2 step_x;
+    vec2 step_y;
+
+    // The canvas pixels that may get drawn into (within the canvas and its clip bounds):
+    RectI bounds;
+
+    ImageBlit() = default;
+
+    ImageBlit(const ImageInfo &image, const void *content, BlitFormat format, ImageFilter filter, f32 opacity = 1.0f) :
+            content{content},
+            width{(i32)image.width},
+            height{(i32)image.height},
+            stride{(i32)(image.stride ? image.stride : image.width)},
+            tile_width{image.flags.tile ? (i32)image.tile_width : 0},
+            tile_height{image.flags.tile ? (i32)image.tile_height : 0},
+            format{format},
+            filter{filter},
+            has_alpha{format == BlitFormatRGB ? false : (bool)image.flags.alpha},
+            opacity{clampedValue(opacity)} {}
+
+    ImageBlit(const TextureMip &texture_mip, ImageFilter filter, f32 opacity = 1.0f, TexelLayout layout = TexelLayoutRows) :
+            content{texture_mip.texel_quads},
+            width{(i32)texture_mip.width},
+            height{(i32)texture_mip.height},
+            stride{(i32)texture_mip.width + 1},
+            format{layout == TexelLayoutTiles ? BlitFormatTiledTexelQuads : BlitFormatTexelQuads},
+            filter{filter},
+            opacity{clampedValue(opacity)} {}
+
+    // Maps the source onto the canvas through a transform from source texels to canvas pixels (then translated).
+    // Returns false when nothing would get drawn:
+    bool map(const mat2 &transform, const vec2 &translation, const Canvas &canvas) {
+        if (!content || width <= 0 || height <= 0 || opacity == 0.0f || !transform.has_inverse())
+            return false;
+
+        mat2 inverse = transform.inverted();
+        step_x = inverse.X;
+        step_y = inverse.Y;
+        origin = inverse * (vec2{0.5f, 0.5f} - translation);
+
+        // The bounding box of the transformed source (clamped to around the canvas first, as it may be far larger):
+        vec2 corners[4] = {
+                translation,
+                transform.X * (f32)width + translation,
+                transform.Y * (f32)height + translation,
+                transform * vec2{(f32)width, (f32)height} + translation
+        };
+        Rect box{corners[0].x, corners[0].x, corners[0].y, corners[0].y};
+        for (const vec2 &corner : corners) {
+            if (corner.x < box.left) box.left = corner.x;
+            if (corner.x > box.right) box.right = corner.x;
+            if (corner.y < box.top) box.top = corner.y;
+            if (corner.y > box.bottom) box.bottom = corner.y;
+        }
+        const f32 canvas_width = (f32)canvas.dimensions.width;
+        const f32 canvas_height = (f32)canvas.dimensions.height;
+        bounds.left   = (i32)floorf(clampedValue(box.left,   -1.0f, canvas_width));
+        bounds.right  = (i32)ceilf( clampedValue(box.right,  -1.0f, canvas_width));
+        bounds.top    = (i32)floorf(clampedValue(box.top,    -1.0f, canvas_height));
+        bounds.bottom = (i32)ceilf( clampedValue(box.bottom, -1.0f, canvas_height));
+        bounds -= RectI{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+        if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+
+        return !!bounds;
+    }
+
+    // Where in the source the center of the pixel at column 0 of a row lands:
+    INLINE vec2 rowStart(i32 y) const {
+        return origin + step_y * (f32)y;
+    }
+
+    INLINE bool covers(const vec2 &row_start, i32 x) const {
+        vec2 position = row_start + step_x * (f32)x;
+        return position.x >= 0 && position.x < (f32)width &&
+               position.y >= 0 && position.y < (f32)height;
+    }
+
+    // Narrows the given range of columns to the pixels of a row whose centers land within the source.
+    // These are found along each axis by where the row crosses the edges of the source, then settled by testing the pixels
+    // at the ends (as the divisions round, while the pixels within the source make for a single run):
+    void clipRow(const vec2 &row_start, i32 &first, i32 &last) const {
+        const i32 left = first;
+        const i32 right = last;
+        _clipRowAlong(row_start.x, step_x.x, (f32)width, first, last);
+        _clipRowAlong(row_start.y, step_x.y, (f32)height, first, last);
+
+        while (first <= last && !covers(row_start, first)) first++;
+        while (first <= last && !covers(row_start, last)) last--;
+        if (first > last) return;
+
+        while (first > left && covers(row_start, first - 1)) first--;
+        while (last < right && covers(row_start, last + 1)) last++;
+    }
+
+    static INLINE void _clipRowAlong(f32 start, f32 step, f32 end, i32 &first, i32 &last) {
+        if (step == 0) {
+            if (!(start >= 0 && start < end)) last = first - 1;
+            return;
+        }
+
+        // The columns at which the row crosses 0 and the end, kept around the range so as to convert them safely:
+        const f32 from = (f32)first - 1;
+        const f32 to = (f32)last + 1;
+        const f32 at_start = clampedValue(-start / step, from, to);
+        const f32 at_end = clampedValue((end - start) / step, from, to);
+        i32 inside_first, inside_last;
+        if (step > 0) { // Within from the start crossing on, up to the end crossing
+            inside_first = (i32)ceilf(at_start);
+            inside_last = (i32)ceilf(at_end) - 1;
+        } else { // Within after the end crossing, up to the start crossing
+            inside_first = (i32)floorf(at_end) + 1;
+            inside_last = (i32)floorf(at_start);
+        }
+        if (inside_first > first) first = inside_first;
+        if (inside_last < last) last = inside_last;
+    }
+};
+
+// A run of sampled pixels, as the canvas stores them (see Canvas::toPixel()) with their components in separate arrays:
+struct BlitSpan {
+    f32 reds[BLIT_SPAN_SIZE];
+    f32 greens[BLIT_SPAN_SIZE];
+    f32 blues[BLIT_SPAN_SIZE];
+    f32 opacities[BLIT_SPAN_SIZE];
+};
+
+// A texel of a source as a color and an opacity (not premultiplied):
+INLINE void _fetchBlitTexel(const ImageBlit &blit, i32 x, i32 y, f32 *texel) {
+    i32 offset = y * blit.stride + x;
+    if (blit.tile_width) { // Tiles are stored one after the other, with the ones in the last column and row cut short:
+        i32 column = x / blit.tile_width;
+        i32 row = y / blit.tile_height;
+        i32 right_tile_width = blit.stride % blit.tile_width;
+        i32 bottom_tile_height = blit.height % blit.tile_height;
+        i32 tile_width = (column == (blit.width - 1) / blit.tile_width && right_tile_width) ? right_tile_width : blit.tile_width;
+        i32 tile_height = (row == (blit.height - 1) / blit.tile_height && bottom_tile_height) ? bottom_tile_height : blit.tile_height;
+        offset = row * blit.stride * blit.tile_height + column * blit.tile_width * tile_height +
+                 (y - row * blit.tile_height) * tile_width + (x - column * blit.tile_width);
+    }
+
+    if (blit.format == BlitFormatByteColors) {
+        ByteColor byte_color = ((const ByteColor*)blit.content)[offset];
+        texel[0] = (f32)byte_color.R * COLOR_COMPONENT_TO_FLOAT;
+        texel[1] = (f32)byte_color.G * COLOR_COMPONENT_TO_FLOAT;
+        texel[2] = (f32)byte_color.B * COLOR_COMPONENT_TO_FLOAT;
+        texel[3] = blit.has_alpha ? (f32)byte_color.A * COLOR_COMPONENT_TO_FLOAT : 1.0f;
+    } else {
+        const f32 *channels = (const f32*)blit.content + offset * (blit.format == BlitFormatRGB ? 3 : 4);
+        texel[0] = channels[0];
+        texel[1] = channels[1];
+        texel[2] = channels[2];
+        texel[3] = blit.has_alpha ? channels[3] : 1.0f;
+    }
+}
+
+INLINE const TexelQuad& _blitTexelQuad(const ImageBlit &blit, i32 x, i32 y) {
+    const TexelQuad *texel_quads = (const TexelQuad*)blit.content;
+    if (blit.format == BlitFormatTiledTexelQuads)
+        return texel_quads[TextureMip::GetQuadIndex<TexelLayoutTiles>(x + blit.quad_x, y + blit.quad_y, blit.stride)];
+
+    return texel_quads[y * blit.stride + x];
+}
+
+// Samples a source at a position (in texels), clamping to its edges. Bilinear filtering weighs colors by their opacities:
+INLINE void _sampleBlitTexel(const ImageBlit &blit, vec2 position, f32 *texel) {
+    const f32 max_x = (f32)(blit.width - 1);
+    const f32 max_y = (f32)(blit.height - 1);
+    if (blit.format == BlitFormatTexelQuads || blit.format == BlitFormatTiledTexelQuads) {
+        if (blit.filter == ImageFilterNearest) {
+            const TexelQuad &texel_quad = _blitTexelQuad(blit, (i32)clampedValue(position.x, 0.0f, max_x), (i32)clampedValue(position.y, 0.0f, max_y));
+            texel[0] = (f32)texel_quad.R.BR * COLOR_COMPONENT_TO_FLOAT;
+            texel[1] = (f32)texel_quad.G.BR * COLOR_COMPONENT_TO_FLOAT;
+            texel[2] = (f32)texel_quad.B.BR * COLOR_COMPONENT_TO_FLOAT;
+        } else {
+            // Quads are offset by half a texel, so that the 4 texels around a position are all in one of them:
+            const f32 U = position.x + 0.5f;
+            const f32 V = position.y + 0.5f;
+            const f32 left = floorf(U);
+            const f32 top = floorf(V);
+            const f32 r = U - left;
+            const f32 b = V - top;
+            const f32 l = 1.0f - r;
+            const f32 t = 1.0f - b;
+            const f32 tl = t * l, tr = t * r, bl = b * l, br = b * r;
+            const TexelQuad &texel_quad = _blitTexelQuad(blit, (i32)clampedValue(left, 0.0f, (f32)blit.width), (i32)clampedValue(top, 0.0f, (f32)blit.height));
+            const TexelQuadComponent *components = &texel_quad.R;
+            for (u32 i = 0; i < 3; i++)
+                texel[i] = (((f32)components[i].TL * tl + (f32)components[i].TR * tr) +
+                            ((f32)components[i].BL * bl + (f32)components[i].BR * br)) * COLOR_COMPONENT_TO_FLOAT;
+        }
+        texel[3] = 1.0f;
+        return;
+    }
+
+    if (blit.filter == ImageFilterNearest) {
+        _fetchBlitTexel(blit, (i32)clampedValue(position.x, 0.0f, max_x), (i32)clampedValue(position.y, 0.0f, max_y), texel);
+        return;
+    }
+
+    const f32 X = position.x - 0.5f;
+    const f32 Y = position.y - 0.5f;
+    const f32 left = floorf(X);
+    const f32 top = floorf(Y);
+    const f32 r = X - left;
+    const f32 b = Y - top;
+    const f32 l = 1.0f - r;
+    const f32 t = 1.0f - b;
+    const i32 x0 = (i32)clampedValue(left, 0.0f, max_x);
+    const i32 x1 = (i32)clampedValue(left + 1.0f, 0.0f, max_x);
+    const i32 y0 = (i32)clampedValue(top, 0.0f, max_y);
+    const i32 y1 = (i32)clampedValue(top + 1.0f, 0.0f, max_y);
+    f32 TL[4], TR[4], BL[4], BR[4];
+    _fetchBlitTexel(blit, x0, y0, TL);
+    _fetchBlitTexel(blit, x1, y0, TR);
+    _fetchBlitTexel(blit, x0, y1, BL);
+    _fetchBlitTexel(blit, x1, y1, BR);
+    f32 tl = t * l, tr = t * r, bl = b * l, br = b * r;
+    if (blit.has_alpha) {
+        tl *= TL[3];
+        tr *= TR[3];
+        bl *= BL[3];
+        br *= BR[3];
+        const f32 opacity = (tl + tr) + (bl + br);
+        for (u32 i = 0; i < 3; i++) {
+            f32 premultiplied = (TL[i] * tl + TR[i] * tr) + (BL[i] * bl + BR[i] * br);
+            texel[i] = opacity > 0 ? premultiplied / opacity : 0.0f;
+        }
+        texel[3] = opacity;
+    } else {
+        for (u32 i = 0; i < 3; i++)
+            texel[i] = (TL[i] * tl + TR[i] * tr) + (BL[i] * bl + BR[i] * br);
+        texel[3] = 1.0f;
+    }
+}
+
+// Samples pixels first to count - 1 of a span of a row starting at column x (positioned as in ImageBlit::covers()):
+void _blitSpanScalar(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    f32 texel[4];
+    for (u32 i = first; i < count; i++) {
+        _sampleBlitTexel(blit, row_start + blit.step_x * (f32)(x + (i32)i), texel);
+        f32 opacity = clampedValue(texel[3], 0.0f, 1.0f) * blit.opacity;
+        f32 red = clampedValue(texel[0] * blit.tint.r, 0.0f, 1.0f);
+        f32 green = clampedValue(texel[1] * blit.tint.g, 0.0f, 1.0f);
+        f32 blue = clampedValue(texel[2] * blit.tint.b, 0.0f, 1.0f);
+        span.reds[i] = red * red * opacity;
+        span.greens[i] = green * green * opacity;
+        span.blues[i] = blue * blue * opacity;
+        span.opacities[i] = opacity;
+    }
+}
+
+// The wide kernels do the same operations in the same order as the scalar one, for the same results:
+const f32 blit_lane_offsets[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+template <typename F32>
+SLIM_INLINE_KERNEL F32 _clampLanes(const F32 &value, const F32 &from, const F32 &to) {
+    return maximum(minimum(value, to), from);
+}
+
+// Weighs the 4 texels around each position (as the scalar kernel does, in the same order):
+template <typename F32>
+SLIM_INLINE_KERNEL F32 _blendLanes(const F32 &TL, const F32 &TR, const F32 &BL, const F32 &BR,
+                                   const F32 &tl, const F32 &tr, const F32 &bl, const F32 &br) {
+    return (TL * tl + TR * tr) + (BL * bl + BR * br);
+}
+
+// The same for a component of texel quads, its 4 bytes being the texels around each position:
+template <typename F32, typename I32>
+SLIM_INLINE_KERNEL F32 _blendTexelQuadLanes(const I32 &values, const F32 &tl, const F32 &tr, const F32 &bl, const F32 &br) {
+    const I32 byte_mask{255};
+    return _blendLanes(toF32(values & byte_mask), toF32((values >> 8) & byte_mask),
+                       toF32((values >> 16) & byte_mask), toF32((values >> 24) & byte_mask), tl, tr, bl, br);
+}
+
+template <BlitFormat FORMAT, typename F32, typename I32>
+SLIM_INLINE_KERNEL void _fetchBlitTexels(const ImageBlit &blit, const I32 &offsets, F32 &r, F32 &g, F32 &b, F32 &a) {
+    if (FORMAT == BlitFormatByteColors) {
+        const I32 values = gather((const i32*)blit.content, offsets);
+        const I32 byte_mask{255};
+        const F32 to_float{COLOR_COMPONENT_TO_FLOAT};
+        b = toF32(values & byte_mask) * to_float;
+        g = toF32((values >> 8) & byte_mask) * to_float;
+        r = toF32((values >> 16) & byte_mask) * to_float;
+        a = blit.has_alpha ? toF32((values >> 24) & byte_mask) * to_float : F32{1.0f};
+    } else {
+        const f32 *channels = (const f32*)blit.content;
+        const I32 first = FORMAT == BlitFormatRGB ? offsets + offsets + offsets : offsets << 2;
+        r = gather(channels, first);
+        g = gather(channels, first + I32{1});
+        b = gather(channels, first + I32{2});
+        a = blit.has_alpha ? gather(channels, first + I32{3}) : F32{1.0f};
+    }
+}
+
+template <BlitFormat FORMAT, typename I32>
+SLIM_INLINE_KERNEL I32 _blitTexelQuadIndices(const ImageBlit &blit, const I32 &x, const I32 &y) {
+    if (FORMAT == BlitFormatTiledTexelQuads)
+        return _texelQuadIndexLanes<TexelLayoutTiles>(x + I32{blit.quad_x}, y + I32{blit.quad_y}, blit.stride);
+
+    return _texelQuadIndexLanes<TexelLayoutRows>(x, y, blit.stride);
+}
+
+template <BlitFormat FORMAT, ImageFilter FILTER, typename F32, typename I32>
+SLIM_INLINE_KERNEL u32 _sampleBlitSpanWide(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    const F32 lanes = F32::load(blit_lane_offsets);
+    const vec2x<F32> start{row_start};
+    const vec2x<F32> step{blit.step_x};
+    const F32 zero{0.0f};
+    const F32 one{1.0f};
+    const F32 half{0.5f};
+    const F32 max_x{(f32)(blit.width - 1)};
+    const F32 max_y{(f32)(blit.height - 1)};
+    const F32 blit_opacity{blit.opacity};
+    const F32 tint_r{blit.tint.r};
+    const F32 tint_g{blit.tint.g};
+    const F32 tint_b{blit.tint.b};
+    const I32 stride{blit.stride};
+    u32 i = first;
+    for (; i + F32::width <= count; i += F32::width) {
+        const vec2x<F32> position = start + step * (lanes + F32{(f32)(x + (i32)i)});
+        F32 r, g, b, a;
+        if (FORMAT == BlitFormatTexelQuads || FORMAT == BlitFormatTiledTexelQuads) {
+            const i32 *components = (const i32*)blit.content;
+            const I32 byte_mask{255};
+            const F32 to_float{COLOR_COMPONENT_TO_FLOAT};
+            if (FILTER == ImageFilterNearest) {
+                I32 quad = _blitTexelQuadIndices<FORMAT>(blit, truncateToI32(_clampLanes(position.x, zero, max_x)), truncateToI32(_clampLanes(position.y, zero, max_y)));
+                I32 offset = quad + quad + quad;
+                r = toF32((gather(components, offset) >> 24) & byte_mask) * to_float;
+                g = toF32((gather(components, offset + I32{1}) >> 24) & byte_mask) * to_float;
+                b = toF32((gather(components, offset + I32{2}) >> 24) & byte_mask) * to_float;
+            } else {
+                const F32 U = position.x + half;
+                const F32 V = position.y + half;
+                const F32 left = floor(U);
+                const F32 top = floor(V);
+                const F32 fr = U - left;
+                const F32 fb = V - top;
+                const F32 fl = one - fr;
+                const F32 ft = one - fb;
+                const F32 tl = ft * fl, tr = ft * fr, bl = fb * fl, br = fb * fr;
+                I32 quad = _blitTexelQuadIndices<FORMAT>(blit, truncateToI32(_clampLanes(left, zero, F32{(f32)blit.width})), truncateToI32(_clampLanes(top, zero, F32{(f32)blit.height})));
+                I32 offset = quad + quad + quad;
+                r = _blendTexelQuadLanes(gather(components, offset), tl, tr, bl, br) * to_float;
+                g = _blendTexelQuadLanes(gather(components, offset + I32{1}), tl, tr, bl, br) * to_float;
+                b = _blendTexelQuadLanes(gather(components, offset + I32{2}), tl, tr, bl, br) * to_float;
+            }
+            a = one;
+        } else if (FILTER == ImageFilterNearest) {
+            I32 offset = mulLow(truncateToI32(_clampLanes(position.y, zero, max_y)), stride) + truncateToI32(_clampLanes(position.x, zero, max_x));
+            _fetchBlitTexels<FORMAT>(blit, offset, r, g, b, a);
+        } else {
+            const F32 X = position.x - half;
+            const F32 Y = position.y - half;
+            const F32 left = floor(X);
+            const F32 top = floor(Y);
+            const F32 fr = X - left;
+            const F32 fb = Y - top;
+            const F32 fl = one - fr;
+            const F32 ft = one - fb;
+            const I32 x0 = truncateToI32(_clampLanes(left, zero, max_x));
+            const I32 x1 = truncateToI32(_clampLanes(left + one, zero, max_x));
+            const I32 row0 = mulLow(truncateToI32(_clampLanes(top, zero, max_y)), stride);
+            const I32 row1 = mulLow(truncateToI32(_clampLanes(top + one, zero, max_y)), stride);
+            F32 TL[4], TR[4], BL[4], BR[4];
+            _fetchBlitTexels<FORMAT>(blit, row0 + x0, TL[0], TL[1], TL[2], TL[3]);
+            _fetchBlitTexels<FORMAT>(blit, row0 + x1, TR[0], TR[1], TR[2], TR[3]);
+            _fetchBlitTexels<FORMAT>(blit, row1 + x0, BL[0], BL[1], BL[2], BL[3]);
+            _fetchBlitTexels<FORMAT>(blit, row1 + x1, BR[0], BR[1], BR[2], BR[3]);
+            F32 tl = ft * fl, tr = ft * fr, bl = fb * fl, br = fb * fr;
+            if (blit.has_alpha) {
+                tl = tl * TL[3];
+                tr = tr * TR[3];
+                bl = bl * BL[3];
+                br = br * BR[3];
+                a = (tl + tr) + (bl + br);
+                const F32 is_visible = a > zero;
+                r = select(is_visible, _blendLanes(TL[0], TR[0], BL[0], BR[0], tl, tr, bl, br) / a, zero);
+                g = select(is_visible, _blendLanes(TL[1], TR[1], BL[1], BR[1], tl, tr, bl, br) / a, zero);
+                b = select(is_visible, _blendLanes(TL[2], TR[2], BL[2], BR[2], tl, tr, bl, br) / a, zero);
+            } else {
+                r = _blendLanes(TL[0], TR[0], BL[0], BR[0], tl, tr, bl, br);
+                g = _blendLanes(TL[1], TR[1], BL[1], BR[1], tl, tr, bl, br);
+                b = _blendLanes(TL[2], TR[2], BL[2], BR[2], tl, tr, bl, br);
+                a = one;
+            }
+        }
+
+        const F32 opacity = _clampLanes(a, zero, one) * blit_opacity;
+        r = _clampLanes(r * tint_r, zero, one);
+        g = _clampLanes(g * tint_g, zero, one);
+        b = _clampLanes(b * tint_b, zero, one);
+        (r * r * opacity).store(span.reds + i);
+        (g * g * opacity).store(span.greens + i);
+        (b * b * opacity).store(span.blues + i);
+        opacity.store(span.opacities + i);
+    }
+    return i;
+}
+
+template <typename F32, typename I32>
+SLIM_INLINE_KERNEL u32 _blitSpanWide(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    if (blit.tile_width) // Tiled images get sampled a texel at a time
+        return first;
+
+    const bool bilinear = blit.filter == ImageFilterBilinear;
+    switch (blit.format) {
+        case BlitFormatByteColors: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatByteColors, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatByteColors, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatRGB: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatRGB, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatRGB, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatRGBA: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatRGBA, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatRGBA, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatTexelQuads: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatTexelQuads, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatTexelQuads, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+        case BlitFormatTiledTexelQuads: return bilinear ?
+            _sampleBlitSpanWide<BlitFormatTiledTexelQuads, ImageFilterBilinear, F32, I32>(blit, row_start, x, first, count, span) :
+            _sampleBlitSpanWide<BlitFormatTiledTexelQuads, ImageFilterNearest,  F32, I32>(blit, row_start, x, first, count, span);
+    }
+    return first;
+}
+
+#ifdef SLIM_SSE2
+void _blitSpanSSE2(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    u32 i = _blitSpanWide<f32x4, i32x4>(blit, row_start, x, first, count, span);
+    if (i < count) _blitSpanScalar(blit, row_start, x, i, count, span);
+}
+#endif
+
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 void _blitSpanAVX2(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span) {
+    u32 i = _blitSpanWide<f32x8, i32x8>(blit, row_start, x, first, count, span);
+    if (i < count) _blitSpanSSE2(blit, row_start, x, i, count, span);
+}
+#endif
+
+typedef void (*BlitSpanKernel)(const ImageBlit &blit, const vec2 &row_start, i32 x, u32 first, u32 count, BlitSpan &span);
+BlitSpanKernel blit_span_kernel = selectKernel<BlitSpanKernel>(
+        _blitSpanScalar,
+        SIMD_SSE2_KERNEL(_blitSpanSSE2),
+        SIMD_AVX2_KERNEL(_blitSpanAVX2));
+
+// The mip to draw a texture from through a transform from its texels to canvas pixels (see Texture::getMipLevel()).
+// The columns of the inverse are where a pixel's step right and down land in texels:
+INLINE u32 getMipLevel(const Texture &texture, const mat2 &transform) {
+    const mat2 inverse = transform.inverted();
+    const f32 width = (f32)texture.width;
+    const f32 height = (f32)texture.height;
+    return texture.getMipLevel(inverse.X.x / width, inverse.X.y / height, inverse.Y.x / width, inverse.Y.y / height);
+}
+
+// Draws the rows of a blit within the given bounds (which the canvas must have been marked dirty for), on the calling thread:
+template <AntiAliasing AA>
+void drawBlitRows(const ImageBlit &blit, const Canvas &canvas, const RectI &rows) {
+    BlitSpan span;
+    for (i32 y = rows.top; y <= rows.bottom; y++) {
+        const vec2 row_start = blit.rowStart(y);
+        i32 first = rows.left;
+        i32 last = rows.right;
+        blit.clipRow(row_start, first, last);
+        for (i32 x = first; x <= last; x += BLIT_SPAN_SIZE) {
+            u32 count = (u32)(last - x + 1 < BLIT_SPAN_SIZE ? last - x + 1 : BLIT_SPAN_SIZE);
+
+            // Sampled in whole packets (of up to 8), rather than leaving a tail of pixels for the narrower kernels.
+            // The pixels past the end get clamped into the source like any other, and are just not drawn:
+            blit_span_kernel(blit, row_start, x, 0, (count + 7) & ~7u, span);
+            canvas.drawPixels<AA>(x, y, count, span.reds, span.greens, span.blues, span.opacities);
+        }
+    }
+}
+
+// Draws a (mapped) blit, splitting its rows into bands that get drawn in parallel when there are enough pixels to draw:
+template <AntiAliasing AA>
+void _drawBlit(const ImageBlit &blit, const Canvas &canvas) {
+    const i32 width = blit.bounds.right - blit.bounds.left + 1;
+    const i32 height = blit.bounds.bottom - blit.bounds.top + 1;
+    if (width * height < BLIT_PARALLEL_MIN_PIXELS)
+        drawBlitRows<AA>(blit, canvas, blit.bounds);
+    else
+        parallelFor2D(blit.bounds, width, BLIT_BAND_HEIGHT, [&](const RectI &band) { drawBlitRows<AA>(blit, canvas, band); });
+}
+
+void drawBlit(const ImageBlit &blit, const Canvas &canvas) {
+    canvas.markDirty(blit.bounds); // Up front, as lazily cleared tiles get cleared in memory when marked
+    switch (canvas.antialias) {
+        case NoAA: _drawBlit<NoAA>(blit, canvas); break;
+        case MSAA: _drawBlit<MSAA>(blit, canvas); break;
+        case SSAA: _drawBlit<SSAA>(blit, canvas); break;
+    }
+}
@@ -1,6 +1,154 @@
 #pragma once
 
 #include "../core/base.h"
+#include "../core/jobs.h"
+#include "../core/color_pipeline.h"
+
+// Fills values with the given one, using non-temporal stores that bypass the caches where possible:
+// Clearing whole buffers through the caches would only evict everything else from them.
+template <typename T>
+void streamFill(T *values, u64 count, const T &value) {
+#ifdef SLIM_SSE2
+    if (16 % sizeof(T) == 0 && ((u64)values & 15) % sizeof(T) == 0) {
+        for (; count && ((u64)values & 15); count--) *values++ = value;
+
+        alignas(16) T lanes[16 / sizeof(T)];
+        for (T &lane : lanes) lane = value;
+        __m128i pattern = _mm_load_si128((const __m128i*)lanes);
+
+        u64 vector_count = count / (16 / sizeof(T));
+        __m128i *vectors = (__m128i*)values;
+        for (u64 i = 0; i < vector_count; i++) _mm_stream_si128(vectors + i, pattern);
+        _mm_sfence();
+
+        values += vector_count * (16 / sizeof(T));
+        count  -= vector_count * (16 / sizeof(T));
+    }
+#endif
+    for (u64 i = 0; i < count; i++) values[i] = value;
+}
+
+// Fills a (short) span of values with the given one using vector stores, keeping the span in the caches:
+template <typename T>
+INLINE void spanFill(T *values, u32 count, const T &value) {
+#ifdef SLIM_SSE2
+    if (16 % sizeof(T) == 0 && count >= 16 / sizeof(T)) {
+        alignas(16) T lanes[16 / sizeof(T)];
+        for (T &lane : lanes) lane = value;
+        __m128i pattern = _mm_load_si128((const __m128i*)lanes);
+
+        u32 vector_count = count / (16 / sizeof(T));
+        __m128i *vectors = (__m128i*)values;
+        for (u32 i = 0; i < vector_count; i++) _mm_storeu_si128(vectors + i, pattern);
+
+        values += vector_count * (16 / sizeof(T));
+        count  -= vector_count * (16 / sizeof(T));
+    }
+#endif
+    for (u32 i = 0; i < count; i++) values[i] = value;
+}
+
+// Blends a (depth-less) pixel over a span of samples, as setPixel() does when given no depth:
+// Samples that are still background (black with no depth in front) get replaced instead, and their depths are zeroed.
+template <typename T>
+INLINE void blendSpan(T *samples, f32 *depths, u32 count, const Pixel &pixel) {
+    for (u32 i = 0; i < count; i++) {
+        Pixel current_pixel{loadPixel(samples[i])};
+        bool is_background = (depths == nullptr || depths[i] == INFINITY) &&
+                current_pixel.color.r == 0 &&
+                current_pixel.color.g == 0 &&
+                current_pixel.color.b == 0;
+        storePixel(samples[i], is_background ? pixel : pixel.alphaBlendOver(current_pixel));
+        if (depths) depths[i] = 0;
+    }
+}
+
+#ifdef SLIM_SSE2
+// Full-float samples blend 4 components at once (with the same operations as Pixel::alphaBlendOver, so bit-identical):
+template <>
+INLINE void blendSpan<Pixel>(Pixel *samples, f32 *depths, u32 count, const Pixel &pixel) {
+    __m128 foreground = _mm_loadu_ps(&pixel.color.r);
+    __m128 transparency = _mm_set1_ps(1.0f - pixel.opacity);
+    __m128 zero = _mm_setzero_ps();
+    for (u32 i = 0; i < count; i++) {
+        f32 *sample = &samples[i].color.r;
+        __m128 background = _mm_loadu_ps(sample);
+        bool is_background = (depths == nullptr || depths[i] == INFINITY) &&
+                (_mm_movemask_ps(_mm_cmpeq_ps(background, zero)) & 7) == 7;
+        _mm_storeu_ps(sample, is_background ? foreground : _mm_add_ps(foreground, _mm_mul_ps(background, transparency)));
+        if (depths) depths[i] = 0;
+    }
+}
+#endif
+
+// Byte samples blend in 16-bit fixed point with no floats, going through tables to and from linear values.
+// The color of the (premultiplied) pixel and its transparency are converted once, the transparency scaled by 65536 (for a shift):
+INLINE u32 blendLinear16(u32 foreground, u32 background, u32 transparency) {
+    u32 value = foreground + ((background * transparency) >> 16);
+    return value < 65535 ? value : 65535;
+}
+
+template <>
+INLINE void blendSpan<PixelRGBA8>(PixelRGBA8 *samples, f32 *depths, u32 count, const Pixel &pixel) {
+    PixelRGBA8 foreground;
+    storePixel(foreground, pixel);
+    const u32 red = toLinear16(pixel.color.r);
+    const u32 green = toLinear16(pixel.color.g);
+    const u32 blue = toLinear16(pixel.color.b);
+    const u32 opacity = toLinear16(pixel.opacity);
+    const f32 transparency_float = (1.0f - clampedValue(pixel.opacity)) * 65536.0f;
+    const u32 transparency = transparency_float < 65535.0f ? (u32)transparency_float : 65535;
+    // Runs of the same background (common on flat, composited surfaces) reuse the last blended value:
+    u32 last_background = count ? ~samples[0].value : 0;
+    u32 last_blended = 0;
+    for (u32 i = 0; i < count; i++) {
+        u32 background = samples[i].value;
+        bool is_background = (depths == nullptr || depths[i] == INFINITY) && !(background & 0xFFFFFF);
+        if (is_background)
+            samples[i].value = foreground.value;
+        else {
+            if (background != last_background) { // Assembled as a whole, as byte stores could alias anything:
+                last_background = background;
+                last_blended =
+                    (u32)linear16_to_byte.values[blendLinear16(blue,  byte_to_linear16.values[background & 0xFF], transparency)] |
+                    (u32)linear16_to_byte.values[blendLinear16(green, byte_to_linear16.values[(background >> 8) & 0xFF], transparency)] << 8 |
+                    (u32)linear16_to_byte.values[blendLinear16(red,   byte_to_linear16.values[(background >> 16) & 0xFF], transparency)] << 16 |
+                    ((blendLinear16(opacity, (background >> 24) * 257, transparency) * 255 + 32768) >> 16) << 24;
+            }
+            samples[i].value = last_blended;
+        }
+        if (depths) depths[i] = 0;
+    }
+}
+
+// Averages the samples of a pixel (summing them in order, then scaling the sum):
+template <typename T>
+INLINE Pixel averageSamples(const T *samples, u32 count) {
+    Pixel sum{loadPixel(samples[0])};
+    for (u32 i = 1; i < count; i++) sum += loadPixel(samples[i]);
+    return sum * (1.0f / (f32)count);
+}
+
+#ifdef SLIM_SSE2
+template <>
+INLINE Pixel averageSamples<Pixel>(const Pixel *samples, u32 count) {
+    __m128 sum = _mm_loadu_ps(&samples[0].color.r);
+    for (u32 i = 1; i < count; i++) sum = _mm_add_ps(sum, _mm_loadu_ps(&samples[i].color.r));
+    Pixel average;
+    _mm_storeu_ps(&average.color.r, _mm_mul_ps(sum, _mm_set1_ps(1.0f / (f32)count)));
+    return average;
+}
+#endif
+
+// Whether 2 stored pixels are the same, bit for bit:
+INLINE bool isSameStoredPixel(const CanvasPixel &a, const CanvasPixel &b) {
+    const u32 *a_words = (const u32*)&a;
+    const u32 *b_words = (const u32*)&b;
+    for (u32 i = 0; i < sizeof(CanvasPixel) / 4; i++)
+        if (a_words[i] != b_words[i])
+            return false;
+    return true;
+}
 
 enum AntiAliasing {
     NoAA,
@@ -8,16 +156,209 @@ enum AntiAliasing {
     SSAA
 };
 
+// The memory layout of an anti-aliasing mode, known at compile time in code specialized on it (like Canvas::setPixel<SSAA>).
+// Coordinates are in samples, which with SSAA are twice the window's (each pixel's 4 samples being next to each other).
+// With MSAA, coordinates are in pixels as a pixel's samples are only stored separately while they differ (see Canvas::coverSamples):
+template <AntiAliasing AA>
+struct AntiAliasingLayout {
+    static constexpr u32 samples_per_pixel = AA == SSAA ? 4 : 1;
+    static constexpr i32 sample_shift = AA == SSAA ? 1 : 0;
+
+    static INLINE u32 sampleOffset(u32 stride, i32 x, i32 y) {
+        return AA == SSAA ? ((stride * (y >> 1) + (x >> 1)) * 4 + (2 * (y & 1)) + (x & 1)) : (stride * y + x);
+    }
+};
+
+// Where the samples of a pixel are with MSAA, on rotated grids of 2, 4 or 8 samples (as x and y offsets from its center, in pixels):
+const f32 MSAA_SAMPLE_POSITIONS_2[2][2] = {{4.0f / 16, 4.0f / 16}, {-4.0f / 16, -4.0f / 16}};
+const f32 MSAA_SAMPLE_POSITIONS_4[4][2] = {{-2.0f / 16, -6.0f / 16}, {6.0f / 16, -2.0f / 16}, {-6.0f / 16, 2.0f / 16}, {2.0f / 16, 6.0f / 16}};
+const f32 MSAA_SAMPLE_POSITIONS_8[8][2] = {{1.0f / 16, -3.0f / 16}, {-1.0f / 16, 3.0f / 16}, {5.0f / 16, 1.0f / 16}, {-3.0f / 16, -5.0f / 16}, {-5.0f / 16, 5.0f / 16}, {-7.0f / 16, -1.0f / 16}, {3.0f / 16, 7.0f / 16}, {7.0f / 16, -7.0f / 16}};
+
+INLINE const f32 (*getSamplePositions(u32 sample_count))[2] {
+    return sample_count == 8 ? MSAA_SAMPLE_POSITIONS_8 : (sample_count == 4 ? MSAA_SAMPLE_POSITIONS_4 : MSAA_SAMPLE_POSITIONS_2);
+}
+
+struct Canvas;
+struct DrawCommand;
+typedef void (*ReplayDrawCommand)(const DrawCommand &command, const Canvas &canvas);
+
+// A recorded drawing call, followed by its payload (if any, like the text to draw).
+// Replaying it makes the same call again, into a canvas that is clipped to a tile:
+struct DrawCommand {
+    ReplayDrawCommand replay;
+    u32 size; // Including the payload
+    u8 line_width;
+    bool has_viewport_bounds;
+    RectI bounds; // What it may draw into, in window pixels
+    RectI viewport_bounds;
+    Color color;
+    f32 opacity;
+    union {
+        f32 values[6];
+        i32 integers[6];
+    };
+
+    INLINE const RectI* getViewportBounds() const { return has_viewport_bounds ? &viewport_bounds : nullptr; }
+    INLINE char* getPayload() const { return (char*)(this + 1); }
+};
+
+#ifndef DISPLAY_LIST_CAPACITY
+#define DISPLAY_LIST_CAPACITY Megabytes(16)
+#endif
+
+// Drawing calls recorded back to back, to be drawn later on tile by tile in parallel (see Canvas::display_list):
+struct DisplayList {
+    memory::MonotonicAllocator memory;
+    u8 *commands;
+    u32 command_count{0};
+
+    explicit DisplayList(u64 capacity = DISPLAY_LIST_CAPACITY) : memory{capacity}, commands{memory.address} {}
+
+    INLINE u8* end() const { return memory.address; }
+
+    DrawCommand* allocate(u32 payload_size) {
+        u32 size = (u32)(sizeof(DrawCommand) + payload_size + 7) & ~7u;
+        DrawCommand *command = (DrawCommand*)memory.allocate(size);
+        if (command) {
+            command->size = size;
+            command_count++;
+        }
+        return command;
+    }
+
+    void reset() {
+        memory.reset();
+        command_count = 0;
+    }
+};
+
+#ifndef FRAGMENT_BUFFER_CAPACITY
+#define FRAGMENT_BUFFER_CAPACITY Megabytes(64)
+#endif
+
+// How many fragments of a sample get composited (the nearest ones, any farther ones being dropped):
+#ifndef FRAGMENTS_PER_SAMPLE
+#define FRAGMENTS_PER_SAMPLE 16
+#endif
+
+// A translucent pixel drawn with depth, set aside to be composited in depth order (see Canvas::fragments):
+struct Fragment {
+    Pixel pixel;
+    f32 depth;
+    u32 next; // The fragment of the same sample that was added before it (0 for none)
+};
+
+// Fragments linked into a list per sample, from an arena that gets emptied once they are all composited.
+// The arena starts with the heads of the lists (one per sample of the canvas), the rest of it holds fragments:
+struct FragmentBuffer {
+    memory::MonotonicAllocator memory;
+    u32 *heads{nullptr}; // The fragment added last per sample (0 for none)
+    Fragment *fragments{nullptr}; // The first one is not used
+    u32 head_count{0};
+    u32 capacity{0};
+    volatile i32 count{1};
+    u8 tiles[CANVAS_DIRTY_TILES_SIZE]; // Which canvas tiles have any fragments
+
+    explicit FragmentBuffer(u64 capacity = FRAGMENT_BUFFER_CAPACITY) : memory{capacity} {}
+
+    // Lays the memory out for the given number of samples, with all of their lists empty.
+    // When the arena can not even fit the heads (as for large SSAA canvases), it holds no fragments and pixels get drawn right away:
+    void reset(u32 sample_count) {
+        memory.reset();
+        count = 1;
+        for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++) tiles[i] = 0;
+        heads = (u32*)memory.allocate(sizeof(u32) * sample_count);
+        if (!heads) {
+            head_count = capacity = 0;
+            fragments = nullptr;
+            return;
+        }
+
+        head_count = sample_count;
+        for (u32 i = 0; i < sample_count; i++) heads[i] = 0;
+        capacity = (u32)((memory.capacity - memory.occupied) / sizeof(Fragment));
+        fragments = (Fragment*)memory.allocate(sizeof(Fragment) * capacity);
+    }
+
+    // Adds a fragment to the list of the sample at the given offset, returning false when full:
+    INLINE bool add(u32 offset, const Pixel &pixel, f32 depth) {
+        if (!capacity) return false;
+
+        i32 index = atomics::add(&count, 1) - 1;
+        if ((u32)index >= capacity) return false;
+
+        Fragment &fragment = fragments[index];
+        fragment.pixel = pixel;
+        fragment.depth = depth;
+        volatile i32 *head = (volatile i32*)(heads + offset);
+        i32 next;
+        do {
+            next = atomics::load(head);
+            fragment.next = (u32)next;
+        } while (!atomics::compareAndSwap(head, next, index));
+        return true;
+    }
+};
+
 struct Canvas {
     Dimensions dimensions;
-    Pixel *pixels{nullptr};
+    CanvasPixel *pixels{nullptr};
     f32 *depths{nullptr};
+    u8 *dirty_tiles{nullptr};
+    u32 *tile_epochs{nullptr};
+
+    // Per tile, bounds on the depths of its pixels (kept by clear() and the drawing functions, not by writing into pixels directly):
+    // No pixel of a tile is nearer than its min depth, and while its max depth is finite all of its pixels are opaque and no farther.
+    // Pixels drawn with depth behind the max depth of their tile are hidden and get skipped,
+    // and opaque ones in front of the min depth replace what is there without a depth test:
+    f32 *tile_min_depths{nullptr};
+    f32 *tile_max_depths{nullptr};
 
     AntiAliasing antialias;
 
+    // How many samples pixels have with MSAA (2, 4 or 8), taking effect on the next clear():
+    u8 msaa_sample_count{4};
+
+    // With MSAA, where (in pixels) the samples of each pixel are while they differ (0 while they are all the same),
+    // and how many samples of each tile's pool are in use (see CANVAS_MSAA_TILE_SAMPLES).
+    // Only set by clear() for canvases with memory of their own, without it pixels are drawn into by covered fractions instead:
+    u32 *sample_offsets{nullptr};
+    u32 *tile_sample_counts{nullptr};
+    bool has_sample_memory{false};
+
+    // When set on a NoAA canvas, fillTriangle(), fillCircle() and fillRect() of a float Rect blend the pixels along their edges
+    // by how much of each the shape covers (computed analytically from the distances of pixel centers to the edges):
+    bool smooth_edges{false};
+
+    // While set, drawing calls are recorded into the display list instead of drawn, for drawToWindow() to draw them
+    // tile by tile in parallel (each tile only getting the commands whose bounds overlap it, in the order they were recorded).
+    // Setting pixels, drawing images or other canvases still draws right away, so these are not to be mixed with recording.
+    DisplayList *display_list{nullptr};
+
+    // When set (taking effect on the next clear), translucent pixels drawn with depth are added to the fragment buffer instead,
+    // to be composited in depth order by drawToWindow() (or on drawFragments()) regardless of the order they were drawn in.
+    // Fragments behind the pixel already drawn are composited under it, as they would be when drawn right away.
+    // When the buffer is full (or too small for the canvas), pixels are drawn right away instead:
+    FragmentBuffer *fragments{nullptr};
+
+    // What drawToWindow() encodes the (linear) pixels into, through a lookup table unless it is the default gamma 2:
+    ColorSpace color_space{ColorSpaceGamma2};
+
+    // When set, nothing gets drawn outside of these bounds (in window pixels):
+    const RectI *clip_bounds{nullptr};
+
+    // What the canvas was last cleared to, with CANVAS_LAZY_CLEAR tiles behind the clear epoch read as these values:
+    CanvasPixel clear_pixel;
+    f32 clear_depth{INFINITY};
+    u32 clear_epoch{0};
+
+    // The anti-aliasing mode and color space the window content was last resolved with, changing either requires resolving it all over again:
+    AntiAliasing resolved_antialias{NoAA};
+    ColorSpace resolved_color_space{ColorSpaceGamma2};
+
     Canvas(u16 width = MAX_WIDTH, u16 height = MAX_HEIGHT, AntiAliasing antialiasing = NoAA) : antialias{antialiasing} {
         if (memory::canvas_memory_capacity) {
-            pixels = (Pixel*)memory::canvas_memory;
+            pixels = (CanvasPixel*)memory::canvas_memory;
             memory::canvas_memory += CANVAS_PIXELS_SIZE;
             memory::canvas_memory_capacity -= CANVAS_PIXELS_SIZE;
 
@@ -25,6 +366,21 @@ struct Canvas {
             memory::canvas_memory += CANVAS_DEPTHS_SIZE;
             memory::canvas_memory_capacity -= CANVAS_DEPTHS_SIZE;
 
+            dirty_tiles = memory::canvas_memory;
+            memory::canvas_memory += CANVAS_DIRTY_TILES_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_DIRTY_TILES_SIZE;
+
+            tile_epochs = (u32*)memory::canvas_memory;
+            memory::canvas_memory += CANVAS_TILE_EPOCHS_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_TILE_EPOCHS_SIZE;
+
+            tile_min_depths = (f32*)memory::canvas_memory;
+            tile_max_depths = tile_min_depths + CANVAS_DIRTY_TILES_SIZE;
+            memory::canvas_memory += CANVAS_TILE_DEPTHS_SIZE;
+            memory::canvas_memory_capacity -= CANVAS_TILE_DEPTHS_SIZE;
+
+            has_sample_memory = true;
+
             dimensions.update(MAX_WIDTH, MAX_HEIGHT);
             clear();
             dimensions.update(width, height);
@@ -34,30 +390,174 @@ struct Canvas {
         }
     }
 
-    Canvas(Pixel *pixels, f32 *depths) noexcept : pixels{pixels}, depths{depths} {}
+    Canvas(CanvasPixel *pixels, f32 *depths) noexcept : pixels{pixels}, depths{depths} {}
+
+    void clear(f32 red = 0, f32 green = 0, f32 blue = 0, f32 opacity = 1.0f, f32 depth = INFINITY) {
+        storePixel(clear_pixel, Pixel{red, green, blue, opacity});
+        clear_depth = depth;
+        if (display_list) // Whatever was recorded would have been cleared away:
+            display_list->reset();
+        if (fragments) { // As would any fragments, the lists get laid out anew for the canvas when it changed:
+            u32 sample_count = dimensions.stride * dimensions.height * (antialias == SSAA ? 4 : 1);
+            if (fragments->head_count != sample_count || fragments->count > 1)
+                fragments->reset(sample_count);
+        }
+
+        if (tile_min_depths) // Every pixel is now at the cleared depth, hiding what is behind it only when opaque:
+            for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++) {
+                tile_min_depths[i] = depth;
+                tile_max_depths[i] = opacity == 1.0f ? depth : INFINITY;
+            }
+
+        if (antialias == MSAA && has_sample_memory) {
+            msaa_sample_count = msaa_sample_count >= 8 ? 8 : (msaa_sample_count >= 4 ? 4 : 2);
+            sample_offsets = (u32*)(depths + MAX_WINDOW_SIZE);
+            tile_sample_counts = (u32*)(depths + MAX_WINDOW_SIZE * 2);
+            for (u32 i = 0; i < CANVAS_MAX_TILE_COLUMNS * CANVAS_MAX_TILE_ROWS; i++) tile_sample_counts[i] = 0;
+        } else {
+            sample_offsets = nullptr;
+            tile_sample_counts = nullptr;
+        }
+
+#ifdef CANVAS_LAZY_CLEAR
+        if (tile_epochs) { // Every tile is now stale, and gets cleared in memory only once drawn into:
+            clear_epoch++;
+            if (clear_epoch == CANVAS_TILE_EPOCH_CLEARING) clear_epoch = 0;
+            _markAllTilesDirty();
+            return;
+        }
+#endif
 
-    void clear(f32 red = 0, f32 green = 0, f32 blue = 0, f32 opacity = 1.0f, f32 depth = INFINITY) const {
         i32 pixels_width  = dimensions.width;
         i32 pixels_height = dimensions.height;
         i32 depths_width  = dimensions.width;
         i32 depths_height = dimensions.height;
 
-        if (antialias != NoAA) {
+        if (antialias == SSAA) {
             depths_width *= 2;
             depths_height *= 2;
-            if (antialias == SSAA) {
-                pixels_width *= 2;
-                pixels_height *= 2;
+            pixels_width *= 2;
+            pixels_height *= 2;
+        }
+
+        u64 pixels_count = (u64)pixels_width * (u64)pixels_height;
+        u64 depths_count = (u64)depths_width * (u64)depths_height;
+
+        if (pixels) streamFill(pixels, pixels_count, clear_pixel);
+        if (depths) streamFill(depths, depths_count, depth);
+        if (sample_offsets) streamFill(sample_offsets, pixels_count, 0u);
+        _markAllTilesDirty();
+    }
+
+    INLINE u32 getTileColumnCount() const { return (dimensions.width  + CANVAS_TILE_SIZE - 1) >> CANVAS_TILE_SIZE_SHIFT; }
+    INLINE u32 getTileRowCount()    const { return (dimensions.height + CANVAS_TILE_SIZE - 1) >> CANVAS_TILE_SIZE_SHIFT; }
+
+    // Marks the tile containing the given position (in window pixels) as drawn into (with no depth, so in front of everything).
+    // A lazily cleared tile gets cleared in memory first, so for drawing into pixels directly mark them before writing:
+    INLINE void markDirty(i32 x, i32 y) const {
+        if (dirty_tiles)
+            _markTileDirty(_getTileIndex(x, y));
+    }
+
+    // Marks all tiles overlapping the given bounds (in window pixels), for drawing into pixels directly:
+    void markDirty(RectI bounds) const {
+        if (!dirty_tiles) return;
+        bounds -= RectI{0, dimensions.width - 1, 0, dimensions.height - 1};
+        if (!bounds) return;
+
+        u32 tile_column_count = getTileColumnCount();
+        for (i32 tile_y = bounds.top >> CANVAS_TILE_SIZE_SHIFT; tile_y <= (bounds.bottom >> CANVAS_TILE_SIZE_SHIFT); tile_y++)
+            for (i32 tile_x = bounds.left >> CANVAS_TILE_SIZE_SHIFT; tile_x <= (bounds.right >> CANVAS_TILE_SIZE_SHIFT); tile_x++)
+                _markTileDirty(tile_y * tile_column_count + tile_x);
+    }
+
+    void markDirty() const {
+        if (!dirty_tiles) return;
+        u32 tile_count = getTileColumnCount() * getTileRowCount();
+        for (u32 i = 0; i < tile_count; i++) _markTileDirty(i);
+    }
+
+    // Marks the tiles lying entirely within the given bounds (in window pixels) as covered by opaque pixels with no depth,
+    // hiding whatever gets drawn behind them with depth until the next clear. For shapes to call once they are drawn:
+    void markOpaque(RectI bounds) const {
+        if (!tile_max_depths) return;
+        bounds -= RectI{0, dimensions.width - 1, 0, dimensions.height - 1};
+        if (!bounds) return;
+
+        for (i32 tile_y = bounds.top >> CANVAS_TILE_SIZE_SHIFT; tile_y <= (bounds.bottom >> CANVAS_TILE_SIZE_SHIFT); tile_y++) {
+            i32 top = tile_y << CANVAS_TILE_SIZE_SHIFT;
+            i32 bottom = clampedValue(top + CANVAS_TILE_SIZE - 1, dimensions.height - 1);
+            if (top < bounds.top || bottom > bounds.bottom) continue;
+
+            for (i32 tile_x = bounds.left >> CANVAS_TILE_SIZE_SHIFT; tile_x <= (bounds.right >> CANVAS_TILE_SIZE_SHIFT); tile_x++) {
+                i32 left = tile_x << CANVAS_TILE_SIZE_SHIFT;
+                i32 right = clampedValue(left + CANVAS_TILE_SIZE - 1, dimensions.width - 1);
+                if (left >= bounds.left && right <= bounds.right)
+                    tile_max_depths[_getTileIndex(left, top)] = 0;
             }
         }
+    }
 
-        i32 pixels_count = pixels_width * pixels_height;
-        i32 depths_count = depths_width * depths_height;
+    // Whether the tile containing the given position (in window pixels) holds the clear value without it being in memory:
+    INLINE bool isClearedLazily(i32 x, i32 y) const {
+#ifdef CANVAS_LAZY_CLEAR
+        return tile_epochs && tile_epochs[(y >> CANVAS_TILE_SIZE_SHIFT) * getTileColumnCount() + (x >> CANVAS_TILE_SIZE_SHIFT)] != clear_epoch;
+#else
+        (void)x;
+        (void)y;
+        return false;
+#endif
+    }
+
+    // Records a drawing call into the display list, given the bounds of what it would draw (in its own coordinates, before
+    // being offset into the viewport). Returns the command for the call to fill in its arguments, or nullptr when it draws nothing:
+    DrawCommand* record(ReplayDrawCommand replay, RectI bounds, const Color &color, f32 opacity,
+                        const RectI *viewport_bounds, u8 line_width = 0, u32 payload_size = 0) const {
+        if (viewport_bounds) {
+            bounds.x_range += viewport_bounds->left;
+            bounds.y_range += viewport_bounds->top;
+            bounds -= *viewport_bounds;
+        }
+        bounds -= RectI{0, dimensions.width - 1, 0, dimensions.height - 1};
+        if (!bounds)
+            return nullptr;
+
+        DrawCommand *command = display_list->allocate(payload_size);
+        if (!command) { // Full, draw what was recorded so far to make room:
+            drawDisplayList();
+            command = display_list->allocate(payload_size);
+            if (!command) return nullptr;
+        }
+
+        command->replay = replay;
+        command->line_width = line_width;
+        command->has_viewport_bounds = viewport_bounds != nullptr;
+        command->bounds = bounds;
+        if (viewport_bounds) command->viewport_bounds = *viewport_bounds;
+        command->color = color;
+        command->opacity = opacity;
+        return command;
+    }
+
+    // Composites the fragments into the canvas tile by tile in parallel, and empties the fragment buffer:
+    void drawFragments() const {
+        if (!fragments || fragments->count <= 1) return;
+
+        RectI bounds{0, dimensions.width - 1, 0, dimensions.height - 1};
+        parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) {
+            u32 tile_index = _getTileIndex(tile.left, tile.top);
+            if (fragments->tiles[tile_index]) _compositeFragments(tile, tile_index);
+        });
+        _releaseFragments();
+    }
 
-        Pixel pixel{red, green, blue, opacity};
+    // Draws the recorded commands into the canvas tile by tile in parallel, and empties the display list:
+    void drawDisplayList() const {
+        if (!display_list || !display_list->command_count) return;
 
-        if (pixels) for (i32 i = 0; i < pixels_count; i++) pixels[i] = pixel;
-        if (depths) for (i32 i = 0; i < depths_count; i++) depths[i] = depth;
+        RectI bounds{0, dimensions.width - 1, 0, dimensions.height - 1};
+        parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { _replayTile(tile); });
+        display_list->reset();
     }
 
     void drawFrom(Canvas& source_canvas, const RectI* source_bounds = nullptr, const RectI* target_bounds = nullptr, f32 opacity = 1.0f, bool blend = true, bool include_depths = false) {
@@ -80,131 +580,320 @@ struct Canvas {
             trg *= 2;
         }
 
-        f32 depth;
+        switch (antialias) { // Specialized on both the target's and the source's anti-aliasing:
+            case NoAA: source_canvas.antialias == SSAA ? _drawFrom<NoAA, SSAA>(source_canvas, src, trg, opacity, blend, include_depths) : _drawFrom<NoAA, NoAA>(source_canvas, src, trg, opacity, blend, include_depths); break;
+            case MSAA: source_canvas.antialias == SSAA ? _drawFrom<MSAA, SSAA>(source_canvas, src, trg, opacity, blend, include_depths) : _drawFrom<MSAA, NoAA>(source_canvas, src, trg, opacity, blend, include_depths); break;
+            case SSAA: source_canvas.antialias == SSAA ? _drawFrom<SSAA, SSAA>(source_canvas, src, trg, opacity, blend, include_depths) : _drawFrom<SSAA, NoAA>(source_canvas, src, trg, opacity, blend, include_depths); break;
+        }
+    }
 
-        i32 src_y = src.top;
-        for (i32 y = trg.top; y < trg.bottom; y++, src_y++) {
-            if (y < 0 || y >= dimensions.height)
-                continue;
+    // Resolves the tiles drawn into since the last call into the window content, and lets the platform present only those.
+    // Everything is resolved and presented when the window was resized, when the anti-aliasing or color space changed,
+    // when pixels were written without marking them, or when anything else (like another canvas) wrote into the window content
+    // since this canvas last resolved into it:
+    void drawToWindow() {
+        if (!window::width || !window::height)
+            return;
 
-            i32 src_x = src.left;
+        const u32 width = window::width;
+        const u32 height = window::height;
+        bool resolve_all = !dirty_tiles ||
+                width != dimensions.width || height != dimensions.height ||
+                window::content_source != this || antialias != resolved_antialias || color_space != resolved_color_space ||
+                width != window::content_source_width || height != window::content_source_height;
+        window::content_source = this;
+        window::content_source_width = (u16)width;
+        window::content_source_height = (u16)height;
+        resolved_antialias = antialias;
+        resolved_color_space = color_space;
 
-            for (i32 x = trg.left; x < trg.right; x++, src_x++) {
-                if (x < 0 || x >= dimensions.width)
-                    continue;
+        const bool pixel_quads = antialias == SSAA;
+        const ResolveKernel kernel = resolve::kernel;
+        const u8 *encode_table = color_space == ColorSpaceGamma2 ? nullptr : getColorEncodeTable(color_space);
+        const u32 tile_column_count = getTileColumnCount();
+#ifdef CANVAS_LAZY_CLEAR
+        // Lazily cleared tiles all resolve to the same content, without reading their pixels:
+        CanvasPixel clear_pixel_quad[4] = {clear_pixel, clear_pixel, clear_pixel, clear_pixel};
+        u32 clear_content;
+        _resolvePixels(clear_pixel_quad, &clear_content, 1, pixel_quads, kernel, encode_table);
+#endif
+        const bool replay = display_list && display_list->command_count;
+        auto resolveTile = [&](const RectI &tile) {
+            if (replay)
+                _replayTile(tile);
 
-                i32 src_offset = source_canvas.antialias == SSAA ? (
-                        (source_canvas.dimensions.stride * (src_y >> 1) + (src_x >> 1)) * 4 + (2 * (src_y & 1)) + (src_x & 1)
-                ) : (
-                                         source_canvas.dimensions.stride * src_y + src_x
-                                 );
+            u32 tile_index = (tile.top >> CANVAS_TILE_SIZE_SHIFT) * tile_column_count + (tile.left >> CANVAS_TILE_SIZE_SHIFT);
+            if (fragments && fragments->tiles[tile_index])
+                _compositeFragments(tile, tile_index);
+            if (!resolve_all && !dirty_tiles[tile_index])
+                return;
 
-                Pixel& pixel{ source_canvas.pixels[src_offset] };
-                if ((pixel.opacity == 0.0f) || (
-                        (pixel.color.r == 0.0f) &&
-                        (pixel.color.g == 0.0f) &&
-                        (pixel.color.b == 0.0f)))
-                    continue;
+            u32 tile_width = (u32)(tile.right - tile.left + 1);
+#ifdef CANVAS_LAZY_CLEAR
+            if (tile_epochs && tile_epochs[tile_index] != clear_epoch) {
+                for (i32 y = tile.top; y <= tile.bottom; y++)
+                    streamFill(window::content + width * y + tile.left, tile_width, clear_content);
+                return;
+            }
+#endif
+            if (sample_offsets && tile_sample_counts[tile_index]) {
+                for (i32 y = tile.top; y <= tile.bottom; y++)
+                    _resolveMultiSampledPixels(width * y + tile.left, tile_width, kernel, encode_table);
+                return;
+            }
+            for (i32 y = tile.top; y <= tile.bottom; y++) {
+                u32 offset = width * y + tile.left;
+                _resolvePixels(pixels + (pixel_quads ? 4 : 1) * offset, window::content + offset, tile_width, pixel_quads, kernel, encode_table);
+            }
+        };
 
-                if (include_depths)
-                    depth = source_canvas.depths[src_offset];
+        RectI bounds{0, (i32)width - 1, 0, (i32)height - 1};
+        if (resolve::multithreaded)
+            parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, resolveTile);
+        else
+            for (i32 y = 0; y < (i32)height; y += CANVAS_TILE_SIZE)
+                for (i32 x = 0; x < (i32)width; x += CANVAS_TILE_SIZE)
+                    resolveTile(RectI{x, clampedValue(x + CANVAS_TILE_SIZE, (i32)width) - 1, y, clampedValue(y + CANVAS_TILE_SIZE, (i32)height) - 1});
 
-                if (blend) {
-                    setPixel(x, y, pixel.color / pixel.opacity, pixel.opacity * opacity, include_depths ? depth : 0.0f);
+        if (replay)
+            display_list->reset();
+        if (fragments)
+            _releaseFragments();
+
+        if (resolve_all)
+            window::present_partially = false;
+        else
+            _collectDirtyRects();
+
+        if (dirty_tiles)
+            for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++) dirty_tiles[i] = 0;
+    }
+
+    // Per-pixel drawing is specialized on the anti-aliasing mode (as in setPixel<SSAA>(...)) for branch-free inner loops.
+    // The non-template versions dispatch on the antialias field at runtime, once per call:
+    INLINE void setPixel(i32 x, i32 y, const Color &color, f32 opacity = 1.0f, f32 depth = 0) const {
+        switch (antialias) {
+            case NoAA: setPixel<NoAA>(x, y, color, opacity, depth); break;
+            case MSAA: setPixel<MSAA>(x, y, color, opacity, depth); break;
+            case SSAA: setPixel<SSAA>(x, y, color, opacity, depth); break;
+        }
+    }
+
+    template <AntiAliasing AA>
+    INLINE void setPixel(i32 x, i32 y, const Color &color, f32 opacity = 1.0f, f32 depth = 0) const {
+        typedef AntiAliasingLayout<AA> Layout;
+        if (x < 0 || y < 0 || x >= (dimensions.width << Layout::sample_shift) || y >= (dimensions.height << Layout::sample_shift))
+            return;
+
+        if (clip_bounds && !clip_bounds->contains(x >> Layout::sample_shift, y >> Layout::sample_shift))
+            return;
+
+        opacity = clampedValue(opacity);
+        Pixel pixel{toPixel(color, opacity)};
+
+        u32 offset = Layout::sampleOffset(dimensions.stride, x, y);
+        f32 *out_depth = depths ? (depths + offset) : nullptr;
+        if (dirty_tiles) {
+            u32 tile_index = _getTileIndex(x >> Layout::sample_shift, y >> Layout::sample_shift);
+            if (out_depth && depth != 0.0f && tile_min_depths) {
+                if (depth >= tile_max_depths[tile_index]) // Hidden behind the opaque pixels of the tile
+                    return;
+
+                if (opacity == 1.0f && depth < tile_min_depths[tile_index]) { // In front of everything in the tile
+                    _markTileDirty(tile_index, depth);
+                    storePixel(pixels[offset], pixel);
+                    *out_depth = depth;
+                    if (AA == MSAA && sample_offsets) sample_offsets[offset] = 0;
+                    return;
                 }
-                else {
-                    i32 trg_offset = antialias == SSAA ? (
-                            (dimensions.stride * (y >> 1) + (x >> 1)) * 4 + (2 * (y & 1)) + (x & 1)
-                    ) : (
-                                             dimensions.stride * y + x
-                                     );
-                    pixels[trg_offset] = source_canvas.pixels[src_offset];
-                    if (include_depths && depth < depths[trg_offset])
-                        depths[trg_offset] = depth;
+
+                if (fragments && opacity < 1.0f && fragments->add(offset, pixel, depth)) { // Composited later on, in depth order
+                    dirty_tiles[tile_index] = 1;
+                    fragments->tiles[tile_index] = 1;
+                    return;
+                }
+            }
+            _markTileDirty(tile_index, depth);
+        }
+        if (AA == MSAA && sample_offsets && sample_offsets[offset]) {
+            if (opacity == 1.0f && depth == 0.0f) // Covering all of the samples, which are then all the same again:
+                sample_offsets[offset] = 0;
+            else {
+                // All samples are drawn into against the depth of the pixel:
+                CanvasPixel *samples = pixels + sample_offsets[offset];
+                f32 sample_depth = 0;
+                for (u32 i = 0; i < msaa_sample_count; i++) {
+                    if (out_depth) sample_depth = *out_depth;
+                    _setStoredPixel(samples[i], pixel, opacity, depth, out_depth ? &sample_depth : nullptr);
                 }
+                if (out_depth) *out_depth = sample_depth;
+                return;
             }
         }
+        _setStoredPixel(pixels[offset], pixel, opacity, depth, out_depth);
+    }
+
+    // Draws a flat color (with no depth) into a run of samples in a row, the same way setPixel() would for each of them.
+    // Coordinates are in samples (twice the window's with SSAA) and must lie within the canvas, which is not marked dirty here.
+    // The pixel is as setPixel() stores it (squared and premultiplied), see toPixel().
+    INLINE void fillSamples(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        switch (antialias) {
+            case NoAA: fillSamples<NoAA>(x, y, count, pixel); break;
+            case MSAA: fillSamples<MSAA>(x, y, count, pixel); break;
+            case SSAA: fillSamples<SSAA>(x, y, count, pixel); break;
+        }
     }
 
-    void drawToWindow() const {
-        u32 *content_value = window::content;
-        Pixel *pixel = pixels;
-        for (u16 y = 0; y < window::height; y++)
-            for (u16 x = 0; x < window::width; x++, content_value++) {
-                *content_value = getPixelContent(pixel);
+    template <AntiAliasing AA>
+    void fillSamples(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        if (AA != SSAA) {
+            fillPixels<AA>(x, y, count, pixel);
+            return;
+        }
 
-                if (antialias == SSAA)
-                    pixel += 4;
-                else
-                    pixel++;
+        // Samples of a row come in pairs, 4 samples apart:
+        u32 offset = AntiAliasingLayout<SSAA>::sampleOffset(dimensions.stride, x, y);
+        if (pixel.opacity == 1.0f) {
+            CanvasPixel stored_pixel;
+            storePixel(stored_pixel, pixel);
+            for (i32 i = 0; i < count; i++, x++, offset += (x & 1) ? 1 : 3) {
+                pixels[offset] = stored_pixel;
+                if (depths) depths[offset] = 0;
             }
+        } else
+            for (i32 i = 0; i < count; i++, x++, offset += (x & 1) ? 1 : 3)
+                blendSpan(pixels + offset, depths ? depths + offset : nullptr, 1, pixel);
     }
 
-    INLINE void setPixel(i32 x, i32 y, const Color &color, f32 opacity = 1.0f, f32 depth = 0, f32 z_top = 0, f32 z_bottom = 0, f32 z_right = 0) const {
-        int w = dimensions.width;
-        int h = dimensions.height;
-        if (antialias == SSAA) {
-            w <<= 1;
-            h <<= 1;
+    // Draws a flat color (with no depth) into a run of whole pixels in a row, the same way setPixel() would for each of their samples.
+    // Coordinates are in window pixels and must lie within the canvas, which is not marked dirty here.
+    // All samples of a run of pixels are contiguous in memory (with SSAA as well), so opaque runs are plain vector stores.
+    INLINE void fillPixels(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        switch (antialias) {
+            case NoAA: fillPixels<NoAA>(x, y, count, pixel); break;
+            case MSAA: fillPixels<MSAA>(x, y, count, pixel); break;
+            case SSAA: fillPixels<SSAA>(x, y, count, pixel); break;
         }
-        if (x < 0 || y < 0 || x >= w || y >= h)
-            return;
+    }
 
-        opacity = clampedValue(opacity);
-        Pixel pixel{color.clamped(), opacity};
-        pixel.color *= pixel.color;
-        if (opacity != 1.0f)
-            pixel.color *= pixel.opacity;
+    template <AntiAliasing AA>
+    void fillPixels(i32 x, i32 y, i32 count, const Pixel &pixel) const {
+        typedef AntiAliasingLayout<AA> Layout;
+        u32 offset = (dimensions.stride * y + x) * Layout::samples_per_pixel;
+        u32 sample_count = (u32)count * Layout::samples_per_pixel;
+        CanvasPixel *sample_span = pixels + offset;
+        f32 *depth_span = depths ? depths + offset : nullptr;
+        if (pixel.opacity == 1.0f) {
+            CanvasPixel stored_pixel;
+            storePixel(stored_pixel, pixel);
+            spanFill(sample_span, sample_count, stored_pixel);
+            if (depth_span) spanFill(depth_span, sample_count, 0.0f);
+            if (AA == MSAA && sample_offsets) spanFill(sample_offsets + offset, sample_count, 0u);
+        } else {
+            blendSpan(sample_span, depth_span, sample_count, pixel);
+            if (AA == MSAA && sample_offsets)
+                for (u32 i = offset; i < offset + sample_count; i++)
+                    if (sample_offsets[i])
+                        blendSpan(pixels + sample_offsets[i], nullptr, msaa_sample_count, pixel);
+        }
+    }
 
-        u32 offset = antialias == SSAA ? ((dimensions.stride * (y >> 1) + (x >> 1)) * 4 + (2 * (y & 1)) + (x & 1)) : (dimensions.stride * y + x);
-        Pixel *out_pixel = pixels + offset;
-        f32 *out_depth = depths ? (depths + (antialias == MSAA ? offset * 4 : offset)) : nullptr;
-        if (
-                (
-                        (out_depth == nullptr ||
-                         *out_depth == INFINITY) &&
-                        (out_pixel->color.r == 0) &&
-                        (out_pixel->color.g == 0) &&
-                        (out_pixel->color.b == 0)
-                ) ||
-                (
-                        (opacity == 1.0f) &&
-                        (depth == 0.0f) &&
-                        (z_top == 0.0f) &&
-                        (z_bottom == 0.0f) &&
-                        (z_right == 0.0f)
-                )
-                ) {
-            *out_pixel = pixel;
-            if (depths) {
-                out_depth[0] = depth;
-                if (antialias == MSAA) out_depth[1] = out_depth[2] = out_depth[3] = 0;
+    // Draws a run of pixels (with no depth) into a row, the same way fillPixels() would for each of them, skipping transparent ones.
+    // The pixels come as separate arrays of their components, as setPixel() stores them (see toPixel()).
+    // Coordinates are in window pixels and must lie within the canvas, which is not marked dirty here:
+    template <AntiAliasing AA>
+    void drawPixels(i32 x, i32 y, u32 count, const f32 *reds, const f32 *greens, const f32 *blues, const f32 *opacities) const {
+        typedef AntiAliasingLayout<AA> Layout;
+        u32 offset = (dimensions.stride * y + x) * Layout::samples_per_pixel;
+        for (u32 i = 0; i < count; i++, offset += Layout::samples_per_pixel) {
+            Pixel pixel{reds[i], greens[i], blues[i], opacities[i]};
+            if (pixel.opacity == 1.0f) {
+                CanvasPixel stored_pixel;
+                storePixel(stored_pixel, pixel);
+                for (u32 s = 0; s < Layout::samples_per_pixel; s++) pixels[offset + s] = stored_pixel;
+                if (depths) for (u32 s = 0; s < Layout::samples_per_pixel; s++) depths[offset + s] = 0;
+                if (AA == MSAA && sample_offsets) sample_offsets[offset] = 0;
+            } else if (pixel.opacity > 0.0f) {
+                blendSpan(pixels + offset, depths ? depths + offset : nullptr, Layout::samples_per_pixel, pixel);
+                if (AA == MSAA && sample_offsets && sample_offsets[offset])
+                    blendSpan(pixels + sample_offsets[offset], nullptr, msaa_sample_count, pixel);
             }
+        }
+    }
 
+    // Draws a flat color (with no depth) into the samples of a pixel that are in the given coverage mask (with MSAA only).
+    // Coordinates are in window pixels and must lie within the canvas, which is not marked dirty here.
+    // Pixels get their samples stored separately once these differ, and are stored once again when these end up all the same.
+    // When the pool of samples of the tile is used up, the pixel is drawn into as a whole by the covered fraction instead:
+    void coverSamples(i32 x, i32 y, u32 mask, const Pixel &pixel) const {
+        const u32 sample_count = msaa_sample_count;
+        const u32 all_samples = (1u << sample_count) - 1;
+        if ((mask & all_samples) == all_samples) {
+            fillPixels<MSAA>(x, y, 1, pixel);
             return;
         }
+        if (!mask)
+            return;
 
-        Pixel *bg{out_pixel}, *fg{&pixel};
-        if (antialias == MSAA) {
-            Pixel accumulated_pixel{};
-            for (u8 i = 0; i < 4; i++) {
-                if (depths) {
-                    if (i) depth = i == 1 ? z_top : (i == 2 ? z_bottom : z_right);
-                    _sortPixelsByDepth(depth, &pixel, out_depth, out_pixel, &bg, &fg);
-                    out_depth++;
-                }
-                accumulated_pixel += fg->opacity == 1 ? *fg : fg->alphaBlendOver(*bg);
+        u32 offset = dimensions.stride * y + x;
+        u32 samples_offset = sample_offsets ? sample_offsets[offset] : 0;
+        if (!samples_offset) {
+            samples_offset = _allocateSamples(x, y);
+            if (!samples_offset) {
+                u32 covered_count = 0;
+                for (u32 i = 0; i < sample_count; i++) covered_count += (mask >> i) & 1;
+                fillPixels<MSAA>(x, y, 1, pixel * ((f32)covered_count / (f32)sample_count));
+                return;
             }
-            *out_pixel = accumulated_pixel * 0.25f;
-        } else {
-            if (depths)
-                _sortPixelsByDepth(depth, &pixel, out_depth, out_pixel, &bg, &fg);
-            *out_pixel = fg->opacity == 1 ? *fg : fg->alphaBlendOver(*bg);
+            for (u32 i = 0; i < sample_count; i++) pixels[samples_offset + i] = pixels[offset];
+            sample_offsets[offset] = samples_offset;
         }
+        if (depths) depths[offset] = 0;
+
+        CanvasPixel *samples = pixels + samples_offset;
+        if (pixel.opacity != 1.0f) {
+            for (u32 i = 0; i < sample_count; i++)
+                if ((mask >> i) & 1)
+                    blendSpan(samples + i, nullptr, 1, pixel);
+            return;
+        }
+
+        // Only opaque pixels can make the samples all the same again (by covering the ones that differ):
+        CanvasPixel stored_pixel;
+        storePixel(stored_pixel, pixel);
+        for (u32 i = 0; i < sample_count; i++)
+            if ((mask >> i) & 1)
+                samples[i] = stored_pixel;
+        for (u32 i = 0; i < sample_count; i++)
+            if (!isSameStoredPixel(samples[i], stored_pixel))
+                return;
+
+        pixels[offset] = stored_pixel;
+        sample_offsets[offset] = 0;
+    }
+
+    // Converts a color into a pixel as setPixel() stores it, squared (approximating linear color) and premultiplied:
+    static INLINE Pixel toPixel(const Color &color, f32 opacity) {
+        opacity = clampedValue(opacity);
+        Pixel pixel{color.clamped(), opacity};
+        pixel.color *= pixel.color;
+        if (opacity != 1.0f)
+            pixel.color *= pixel.opacity;
+        return pixel;
     }
 
     INLINE u32 getPixelContent(Pixel *pixel) const {
-        return antialias == SSAA ? _isTransparentPixelQuad(pixel) ? 0 : _blendPixelQuad(pixel).asContent() :
+        return antialias == SSAA ? getPixelContent<SSAA>(pixel) : getPixelContent<NoAA>(pixel);
+    }
+
+    template <AntiAliasing AA>
+    INLINE u32 getPixelContent(Pixel *pixel) const {
+        if (color_space != ColorSpaceGamma2) {
+            u32 content;
+            encodePixels(pixel, &content, 1, getColorEncodeTable(color_space), AA == SSAA, ResolveScalar);
+            return content;
+        }
+        return AA == SSAA ? _isTransparentPixelQuad(pixel) ? 0 : _blendPixelQuad(pixel).asContent() :
                pixel->opacity == 0.0f ? 0 : pixel->asContent();
     }
 
@@ -247,6 +936,7 @@ struct Canvas {
     INLINE void fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
     INLINE void drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color = White, f32 opacity = 0.5f, u8 line_width = 0, const RectI *viewport_bounds = nullptr) const;
     INLINE void fillTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
+    INLINE void fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors = nullptr, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
 #endif
 
     INLINE void fillCircle(i32 center_x, i32 center_y, i32 radius, const Color &color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) const;
@@ -259,6 +949,304 @@ struct Canvas {
 #endif
 
 private:
+    // Replays the recorded commands overlapping a tile (in window pixels) into a copy of the canvas that is clipped to it:
+    void _replayTile(const RectI &tile) const {
+        Canvas tile_canvas{*this};
+        tile_canvas.display_list = nullptr;
+        tile_canvas.clip_bounds = &tile;
+
+        for (u8 *at = display_list->commands; at < display_list->end(); at += ((DrawCommand*)at)->size) {
+            const DrawCommand &command = *(DrawCommand*)at;
+            if (command.bounds.left <= tile.right && tile.left <= command.bounds.right &&
+                command.bounds.top <= tile.bottom && tile.top <= command.bounds.bottom)
+                command.replay(command, tile_canvas);
+        }
+    }
+
+    // Draws a pixel into a stored one, behind or in front of it by depth (a depth of 0 being in front of everything).
+    // Background (black with no depth in front) gets replaced, as does anything by an opaque pixel with no depth:
+    static INLINE void _setStoredPixel(CanvasPixel &stored_pixel, Pixel pixel, f32 opacity, f32 depth, f32 *out_depth) {
+        Pixel current_pixel{loadPixel(stored_pixel)};
+        if (
+                (
+                        (out_depth == nullptr ||
+                         *out_depth == INFINITY) &&
+                        (current_pixel.color.r == 0) &&
+                        (current_pixel.color.g == 0) &&
+                        (current_pixel.color.b == 0)
+                ) ||
+                (
+                        (opacity == 1.0f) &&
+                        (depth == 0.0f)
+                )
+                ) {
+            storePixel(stored_pixel, pixel);
+            if (out_depth) *out_depth = depth;
+            return;
+        }
+
+        Pixel *bg{&current_pixel}, *fg{&pixel};
+        if (out_depth)
+            _sortPixelsByDepth(depth, &pixel, out_depth, &current_pixel, &bg, &fg);
+        storePixel(stored_pixel, fg->opacity == 1 ? *fg : fg->alphaBlendOver(*bg));
+    }
+
+    // Composites the fragments of a tile into its samples, emptying their lists:
+    void _compositeFragments(const RectI &tile, u32 tile_index) const {
+        FragmentBuffer &buffer = *fragments;
+        buffer.tiles[tile_index] = 0;
+        _markTileDirty(tile_index, INFINITY); // Clearing a lazily cleared tile in memory first
+
+        const u32 samples_per_pixel = antialias == SSAA ? 4 : 1;
+        f32 nearest_depth = INFINITY;
+        for (i32 y = tile.top; y <= tile.bottom; y++) {
+            u32 offset = (dimensions.stride * y + tile.left) * samples_per_pixel;
+            u32 end = offset + (u32)(tile.right - tile.left + 1) * samples_per_pixel;
+            for (; offset < end; offset++) {
+                u32 head = buffer.heads[offset];
+                if (!head) continue;
+
+                buffer.heads[offset] = 0;
+                u32 samples_offset = sample_offsets ? sample_offsets[offset] : 0;
+                f32 depth = _compositeFragmentList(buffer.fragments, head,
+                                                   pixels + (samples_offset ? samples_offset : offset),
+                                                   samples_offset ? msaa_sample_count : 1,
+                                                   depths ? depths + offset : nullptr);
+                if (depth < nearest_depth) nearest_depth = depth;
+            }
+        }
+        if (tile_min_depths && nearest_depth < tile_min_depths[tile_index])
+            tile_min_depths[tile_index] = nearest_depth;
+    }
+
+    // Composites a list of fragments into the samples of a stored pixel (all against its depth), returning its new depth.
+    // The nearest fragments are sorted from near to far, the ones added later being nearer among equal depths.
+    // Going from far to near, those behind the stored pixel are composited under it and the rest over it:
+    static f32 _compositeFragmentList(const Fragment *all_fragments, u32 head, CanvasPixel *samples, u32 sample_count, f32 *depth) {
+        const Fragment *sorted[FRAGMENTS_PER_SAMPLE];
+        u32 count = 0;
+        for (u32 i = head; i; i = all_fragments[i].next) {
+            const Fragment *fragment = all_fragments + i;
+            u32 at = count;
+            while (at && sorted[at - 1]->depth > fragment->depth) at--;
+            if (at == FRAGMENTS_PER_SAMPLE) continue;
+
+            if (count < FRAGMENTS_PER_SAMPLE) count++;
+            for (u32 j = count - 1; j > at; j--) sorted[j] = sorted[j - 1];
+            sorted[at] = fragment;
+        }
+
+        f32 stored_depth = depth ? *depth : INFINITY;
+        for (u32 s = 0; s < sample_count; s++) {
+            Pixel stored_pixel{loadPixel(samples[s])};
+            bool is_background = stored_depth == INFINITY &&
+                                 stored_pixel.color.r == 0 &&
+                                 stored_pixel.color.g == 0 &&
+                                 stored_pixel.color.b == 0;
+            Pixel pixel;
+            i32 i = (i32)count - 1;
+            for (; i >= 0 && sorted[i]->depth >= stored_depth; i--) pixel = sorted[i]->pixel.alphaBlendOver(pixel);
+            if (!is_background) pixel = stored_pixel.alphaBlendOver(pixel);
+            for (; i >= 0; i--) pixel = sorted[i]->pixel.alphaBlendOver(pixel);
+            storePixel(samples[s], pixel);
+        }
+
+        if (count && sorted[0]->depth < stored_depth) stored_depth = sorted[0]->depth;
+        if (depth) *depth = stored_depth;
+        return stored_depth;
+    }
+
+    // Empties the fragment buffer once no tile has any fragments left (tiles outside of the window might):
+    void _releaseFragments() const {
+        for (u32 i = 0; i < CANVAS_DIRTY_TILES_SIZE; i++)
+            if (fragments->tiles[i]) return;
+        fragments->count = 1;
+    }
+
+    // Takes the samples for a pixel from the pool of its tile, returning where they are (0 when the pool is used up):
+    INLINE u32 _allocateSamples(i32 x, i32 y) const {
+        if (!sample_offsets) return 0;
+
+        u32 tile_index = (y >> CANVAS_TILE_SIZE_SHIFT) * getTileColumnCount() + (x >> CANVAS_TILE_SIZE_SHIFT);
+        u32 &used_count = tile_sample_counts[tile_index];
+        if (used_count + msaa_sample_count > CANVAS_MSAA_TILE_SAMPLES)
+            return 0;
+
+        u32 samples_offset = MAX_WINDOW_SIZE + tile_index * CANVAS_MSAA_TILE_SAMPLES + used_count;
+        used_count += msaa_sample_count;
+        return samples_offset;
+    }
+
+    // Resolves a run of pixels of which some have their samples stored separately, averaging those first:
+    template <typename T>
+    static void _resolvePixels(const T *pixels, u32 *content, u32 count, bool pixel_quads, ResolveKernel kernel, const u8 *encode_table) {
+        if (encode_table) encodePixels(pixels, content, count, encode_table, pixel_quads, kernel);
+        else              resolvePixels(pixels, content, count, pixel_quads, kernel);
+    }
+
+    void _resolveMultiSampledPixels(u32 offset, u32 count, ResolveKernel kernel, const u8 *encode_table) const {
+        Pixel resolved_pixels[CANVAS_TILE_SIZE];
+        for (u32 i = 0; i < count; i++) {
+            u32 samples_offset = sample_offsets[offset + i];
+            resolved_pixels[i] = samples_offset ?
+                    averageSamples(pixels + samples_offset, msaa_sample_count) :
+                    loadPixel(pixels[offset + i]);
+        }
+        _resolvePixels(resolved_pixels, window::content + offset, count, false, kernel, encode_table);
+    }
+
+    INLINE u32 _getTileIndex(i32 x, i32 y) const {
+        return (y >> CANVAS_TILE_SIZE_SHIFT) * getTileColumnCount() + (x >> CANVAS_TILE_SIZE_SHIFT);
+    }
+
+    // Also brings the min depth of the tile to the depth drawn at:
+    INLINE void _markTileDirty(u32 tile_index, f32 depth = 0) const {
+        dirty_tiles[tile_index] = 1;
+        if (tile_min_depths && depth < tile_min_depths[tile_index])
+            tile_min_depths[tile_index] = depth;
+#ifdef CANVAS_LAZY_CLEAR
+        if (tile_epochs[tile_index] != clear_epoch)
+            _claimTile(tile_index);
+#endif
+    }
+
+    // Clears a tile from an earlier clear epoch exactly once when drawn into from several threads at once:
+    // The first thread swaps its epoch for CANVAS_TILE_EPOCH_CLEARING and clears it, the others wait for the clear epoch.
+    void _claimTile(u32 tile_index) const {
+        volatile i32 *epoch = (volatile i32*)(tile_epochs + tile_index);
+        i32 tile_epoch;
+        while ((tile_epoch = atomics::load(epoch)) != (i32)clear_epoch) {
+            if (tile_epoch != (i32)CANVAS_TILE_EPOCH_CLEARING &&
+                atomics::compareAndSwap(epoch, tile_epoch, (i32)CANVAS_TILE_EPOCH_CLEARING)) {
+                _clearTile(tile_index);
+                atomics::store(epoch, (i32)clear_epoch);
+                return;
+            }
+            atomics::pause();
+        }
+    }
+
+    // Marks every tile without clearing lazily cleared ones in memory:
+    void _markAllTilesDirty() const {
+        if (!dirty_tiles) return;
+        u32 tile_count = getTileColumnCount() * getTileRowCount();
+        for (u32 i = 0; i < tile_count; i++) dirty_tiles[i] = 1;
+    }
+
+    // Writes the clear value into the pixels and depths of a tile from an earlier clear epoch, right before it gets drawn into:
+    void _clearTile(u32 tile_index) const {
+        const u32 tile_column_count = getTileColumnCount();
+        const i32 left = (i32)(tile_index % tile_column_count) << CANVAS_TILE_SIZE_SHIFT;
+        const i32 top  = (i32)(tile_index / tile_column_count) << CANVAS_TILE_SIZE_SHIFT;
+        const i32 right  = clampedValue(left + CANVAS_TILE_SIZE, (i32)dimensions.width);
+        const i32 bottom = clampedValue(top  + CANVAS_TILE_SIZE, (i32)dimensions.height);
+        const u32 samples_per_pixel = antialias == SSAA ? 4 : 1;
+        const u32 tile_width = (u32)(right - left);
+
+        for (i32 y = top; y < bottom; y++) {
+            u32 offset = dimensions.stride * y + left;
+            CanvasPixel *pixel = pixels + offset * samples_per_pixel;
+            for (u32 i = 0; i < tile_width * samples_per_pixel; i++) pixel[i] = clear_pixel;
+            if (depths) {
+                f32 *depth = depths + offset * samples_per_pixel;
+                for (u32 i = 0; i < tile_width * samples_per_pixel; i++) depth[i] = clear_depth;
+            }
+            if (sample_offsets)
+                for (u32 i = 0; i < tile_width; i++) sample_offsets[offset + i] = 0;
+        }
+    }
+
+    // Gathers runs of dirty tiles into the window's dirty rectangles, merging runs spanning the same columns vertically:
+    void _collectDirtyRects() const {
+        const i32 tile_column_count = (i32)getTileColumnCount();
+        const i32 tile_row_count = (i32)getTileRowCount();
+        const i32 right_most = (i32)window::width - 1;
+        const i32 bottom_most = (i32)window::height - 1;
+
+        window::present_partially = true;
+        window::dirty_rect_count = 0;
+        for (i32 tile_y = 0; tile_y < tile_row_count; tile_y++) {
+            u8 *row = dirty_tiles + tile_y * tile_column_count;
+            for (i32 tile_x = 0; tile_x < tile_column_count; tile_x++) {
+                if (!row[tile_x]) continue;
+
+                i32 first_tile_x = tile_x;
+                while (tile_x + 1 < tile_column_count && row[tile_x + 1]) tile_x++;
+
+                RectI rect{
+                    first_tile_x << CANVAS_TILE_SIZE_SHIFT, clampedValue((tile_x + 1) << CANVAS_TILE_SIZE_SHIFT, right_most + 1) - 1,
+                    tile_y << CANVAS_TILE_SIZE_SHIFT, clampedValue((tile_y + 1) << CANVAS_TILE_SIZE_SHIFT, bottom_most + 1) - 1
+                };
+
+                bool merged = false;
+                for (u32 i = 0; i < window::dirty_rect_count; i++) {
+                    RectI &above = window::dirty_rects[i];
+                    if (above.left == rect.left && above.right == rect.right && above.bottom + 1 == rect.top) {
+                        above.bottom = rect.bottom;
+                        merged = true;
+                        break;
+                    }
+                }
+                if (merged) continue;
+
+                if (window::dirty_rect_count == WINDOW_MAX_DIRTY_RECT_COUNT) { // Too fragmented, present it all:
+                    window::present_partially = false;
+                    return;
+                }
+                window::dirty_rects[window::dirty_rect_count++] = rect;
+            }
+        }
+    }
+
+    // The source's mode only matters for where its samples are, which is either as with SSAA or as without it:
+    template <AntiAliasing AA, AntiAliasing SOURCE_AA>
+    void _drawFrom(Canvas &source_canvas, RectI src, RectI trg, f32 opacity, bool blend, bool include_depths) {
+        f32 depth = 0;
+
+        i32 src_y = src.top;
+        for (i32 y = trg.top; y < trg.bottom; y++, src_y++) {
+            if (y < 0 || y >= dimensions.height)
+                continue;
+
+            i32 src_x = src.left;
+
+            for (i32 x = trg.left; x < trg.right; x++, src_x++) {
+                if (x < 0 || x >= dimensions.width)
+                    continue;
+
+                i32 src_offset = (i32)AntiAliasingLayout<SOURCE_AA>::sampleOffset(source_canvas.dimensions.stride, src_x, src_y);
+                bool src_cleared = source_canvas.isClearedLazily(src_x >> AntiAliasingLayout<SOURCE_AA>::sample_shift,
+                                                                 src_y >> AntiAliasingLayout<SOURCE_AA>::sample_shift);
+                CanvasPixel src_pixel{src_cleared ? source_canvas.clear_pixel : source_canvas.pixels[src_offset]};
+                if (!src_cleared && source_canvas.sample_offsets && source_canvas.sample_offsets[src_offset])
+                    storePixel(src_pixel, averageSamples(source_canvas.pixels + source_canvas.sample_offsets[src_offset], source_canvas.msaa_sample_count));
+                Pixel pixel{loadPixel(src_pixel)};
+                if ((pixel.opacity == 0.0f) || (
+                        (pixel.color.r == 0.0f) &&
+                        (pixel.color.g == 0.0f) &&
+                        (pixel.color.b == 0.0f)))
+                    continue;
+
+                if (include_depths)
+                    depth = src_cleared ? source_canvas.clear_depth : source_canvas.depths[src_offset];
+
+                if (blend) {
+                    setPixel<AA>(x, y, pixel.color / pixel.opacity, pixel.opacity * opacity, include_depths ? depth : 0.0f);
+                }
+                else {
+                    i32 trg_offset = (i32)AntiAliasingLayout<AA>::sampleOffset(dimensions.stride, x, y);
+                    u32 tile_index = _getTileIndex(x >> AntiAliasingLayout<AA>::sample_shift, y >> AntiAliasingLayout<AA>::sample_shift);
+                    if (dirty_tiles) _markTileDirty(tile_index);
+                    if (tile_max_depths) tile_max_depths[tile_index] = INFINITY; // Pixels get replaced, even by translucent ones
+                    pixels[trg_offset] = src_pixel;
+                    if (AA == MSAA && sample_offsets) sample_offsets[trg_offset] = 0;
+                    if (include_depths && depth < depths[trg_offset])
+                        depths[trg_offset] = depth;
+                }
+            }
+        }
+    }
+
     static INLINE bool _isTransparentPixelQuad(Pixel *pixel_quad) {
         return (
                 (pixel_quad[0].opacity == 0.0f) &&
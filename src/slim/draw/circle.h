@@ -2,45 +2,41 @@
 
 #include "canvas.h"
 
-void _paintCircle(bool fill, i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
-                  const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
-    RectI rect{center_x - radius,
-               center_x + radius,
-               center_y - radius,
-               center_y + radius};
-    if (viewport_bounds) {
-        center_x += viewport_bounds->left;
-        center_y += viewport_bounds->top;
-        rect.x_range += viewport_bounds->left;
-        rect.y_range += viewport_bounds->top;
-        rect -= *viewport_bounds;
-        bounds -= *viewport_bounds;
-    }
-    rect -= bounds;
-    if (!rect)
-        return;
+void _replayCircle(const DrawCommand &command, const Canvas &canvas);
 
+// Draws the (clipped) circle with the midpoint algorithm, specialized on the anti-aliasing mode:
+template <AntiAliasing AA>
+void _rasterizeCircle(bool fill, i32 center_x, i32 center_y, i32 radius, RectI bounds, const Canvas &canvas,
+                      const Color &color, f32 opacity) {
     if (radius <= 1) {
-        if (canvas.antialias == SSAA) {
+        if (AA == SSAA) {
             center_x *= 2;
             center_y *= 2;
-            canvas.setPixel(center_x, center_y, color, opacity);
-            canvas.setPixel(center_x+1, center_y, color, opacity);
-            canvas.setPixel(center_x, center_y+1, color, opacity);
-            canvas.setPixel(center_x+1, center_y+1, color, opacity);
+            canvas.setPixel<AA>(center_x, center_y, color, opacity);
+            canvas.setPixel<AA>(center_x+1, center_y, color, opacity);
+            canvas.setPixel<AA>(center_x, center_y+1, color, opacity);
+            canvas.setPixel<AA>(center_x+1, center_y+1, color, opacity);
         } else
-            canvas.setPixel(center_x, center_y, color, opacity);
+            canvas.setPixel<AA>(center_x, center_y, color, opacity);
 
         return;
     }
 
-    if (canvas.antialias == SSAA) {
+    if (AA == SSAA) {
         center_x *= 2;
         center_y *= 2;
         radius *= 2;
         bounds *= 2;
     }
+    if (canvas.clip_bounds) { // Clip to whole pixels, covering both of their samples with SSAA:
+        RectI clip{*canvas.clip_bounds};
+        if (AA == SSAA) {
+            clip *= 2;
+            clip.right++;
+            clip.bottom++;
+        }
+        bounds -= clip;
+    }
 
     i32 x = radius, y = 0, y2 = 0;
     i32 r2 = radius * radius;
@@ -57,27 +53,27 @@ void _paintCircle(bool fill, i32 center_x, i32 center_y, i32 radius, const Canva
         if (fill) {
             range1 = bounds.x_range - x_range1;
             range2 = bounds.x_range - x_range2;
-            if (bounds.y_range[y_range1.first]) for (i = range1.first; i <= range1.last; i++) canvas.setPixel(i, y_range1.first, color, opacity);
-            if (bounds.y_range[y_range1.last])  for (i = range1.first; i <= range1.last; i++) canvas.setPixel(i, y_range1.last , color, opacity);
-            if (bounds.y_range[y_range2.first]) for (i = range2.first; i <= range2.last; i++) canvas.setPixel(i, y_range2.first, color, opacity);
-            if (bounds.y_range[y_range2.last])  for (i = range2.first; i <= range2.last; i++) canvas.setPixel(i, y_range2.last , color, opacity);
+            if (bounds.y_range[y_range1.first]) for (i = range1.first; i <= range1.last; i++) canvas.setPixel<AA>(i, y_range1.first, color, opacity);
+            if (bounds.y_range[y_range1.last])  for (i = range1.first; i <= range1.last; i++) canvas.setPixel<AA>(i, y_range1.last , color, opacity);
+            if (bounds.y_range[y_range2.first]) for (i = range2.first; i <= range2.last; i++) canvas.setPixel<AA>(i, y_range2.first, color, opacity);
+            if (bounds.y_range[y_range2.last])  for (i = range2.first; i <= range2.last; i++) canvas.setPixel<AA>(i, y_range2.last , color, opacity);
         } else {
             if (bounds.y_range[y_range1.first]) {
-                if (bounds.x_range[x_range1.first]) canvas.setPixel(x_range1.first, y_range1.first, color, opacity);
-                if (bounds.x_range[x_range1.last ]) canvas.setPixel(x_range1.last,  y_range1.first, color, opacity);
+                if (bounds.x_range[x_range1.first]) canvas.setPixel<AA>(x_range1.first, y_range1.first, color, opacity);
+                if (bounds.x_range[x_range1.last ]) canvas.setPixel<AA>(x_range1.last,  y_range1.first, color, opacity);
             }
             if (bounds.y_range[y_range1.last]) {
-                if (bounds.x_range[x_range1.first]) canvas.setPixel(x_range1.first, y_range1.last, color, opacity);
-                if (bounds.x_range[x_range1.last ]) canvas.setPixel(x_range1.last,  y_range1.last, color, opacity);
+                if (bounds.x_range[x_range1.first]) canvas.setPixel<AA>(x_range1.first, y_range1.last, color, opacity);
+                if (bounds.x_range[x_range1.last ]) canvas.setPixel<AA>(x_range1.last,  y_range1.last, color, opacity);
             }
 
             if (bounds.y_range[y_range2.first]) {
-                if (bounds.x_range[x_range2.first]) canvas.setPixel(x_range2.first, y_range2.first, color, opacity);
-                if (bounds.x_range[x_range2.last ]) canvas.setPixel(x_range2.last,  y_range2.first, color, opacity);
+                if (bounds.x_range[x_range2.first]) canvas.setPixel<AA>(x_range2.first, y_range2.first, color, opacity);
+                if (bounds.x_range[x_range2.last ]) canvas.setPixel<AA>(x_range2.last,  y_range2.first, color, opacity);
             }
             if (bounds.y_range[y_range2.last]) {
-                if (bounds.x_range[x_range2.first]) canvas.setPixel(x_range2.first, y_range2.last, color, opacity);
-                if (bounds.x_range[x_range2.last ]) canvas.setPixel(x_range2.last,  y_range2.last, color, opacity);
+                if (bounds.x_range[x_range2.first]) canvas.setPixel<AA>(x_range2.first, y_range2.last, color, opacity);
+                if (bounds.x_range[x_range2.last ]) canvas.setPixel<AA>(x_range2.last,  y_range2.last, color, opacity);
             }
         }
 
@@ -101,6 +97,142 @@ void _paintCircle(bool fill, i32 center_x, i32 center_y, i32 radius, const Canva
     }
 }
 
+void _replayCircleSmoothly(const DrawCommand &command, const Canvas &canvas);
+
+// Fills a disc on a NoAA canvas, blending the pixels along its edge by how much of each it covers
+// (approximated from the distance of the pixel center to the edge). The center is given in pixels (the center of pixel x being x + 0.5).
+// Each row is filled as a span between the pixels that are fully inside, with only the ones around it being blended:
+void _fillCircleSmoothly(f32 center_x, f32 center_y, f32 radius, const Canvas &canvas,
+                         const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        RectI bounds{(i32)floorf(center_x - radius - 0.5f), (i32)ceilf(center_x + radius + 0.5f),
+                     (i32)floorf(center_y - radius - 0.5f), (i32)ceilf(center_y + radius + 0.5f)};
+        DrawCommand *command = canvas.record(_replayCircleSmoothly, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->values[0] = center_x;
+            command->values[1] = center_y;
+            command->values[2] = radius;
+        }
+        return;
+    }
+    if (radius <= 0)
+        return;
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+    if (viewport_bounds) {
+        bounds -= *viewport_bounds;
+        center_x += (f32)viewport_bounds->left;
+        center_y += (f32)viewport_bounds->top;
+    }
+
+    // Pixels are covered (partially) as long as their centers are within half a pixel outside of the edge:
+    f32 outer_radius = radius + 0.5f;
+    f32 inner_radius = radius - 0.5f;
+    f32 outer_radius_squared = outer_radius * outer_radius;
+    f32 inner_radius_squared = inner_radius > 0 ? inner_radius * inner_radius : 0;
+    RectI rect{(i32)floorf(center_x - outer_radius), (i32)ceilf(center_x + outer_radius),
+               (i32)floorf(center_y - outer_radius), (i32)ceilf(center_y + outer_radius)};
+    rect -= bounds;
+    if (!rect)
+        return;
+
+    canvas.markDirty(rect);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    for (i32 y = rect.top; y <= rect.bottom; y++) {
+        f32 dy = (f32)y + 0.5f - center_y;
+        f32 dy_squared = dy * dy;
+        if (dy_squared >= outer_radius_squared)
+            continue;
+
+        // The pixels fully inside, if any (with centers at least half a pixel inside of the edge):
+        i32 span_first = 0;
+        i32 span_last = -1;
+        if (inner_radius > 0 && dy_squared < inner_radius_squared) {
+            f32 half_width = sqrtf(inner_radius_squared - dy_squared);
+            span_first = (i32)ceilf(center_x - half_width - 0.5f);
+            span_last = (i32)floorf(center_x + half_width - 0.5f);
+            if (span_first < rect.left) span_first = rect.left;
+            if (span_last > rect.right) span_last = rect.right;
+            if (span_last >= span_first)
+                canvas.fillPixels<NoAA>(span_first, y, span_last - span_first + 1, pixel);
+        }
+
+        // Blend the pixels on either side of the span that are (partially) covered:
+        f32 half_width = sqrtf(outer_radius_squared - dy_squared);
+        i32 first = (i32)floorf(center_x - half_width - 0.5f);
+        i32 last = (i32)ceilf(center_x + half_width - 0.5f);
+        if (first < rect.left) first = rect.left;
+        if (last > rect.right) last = rect.right;
+        for (i32 x = first; x <= last; x++) {
+            if (x >= span_first && x <= span_last) {
+                x = span_last;
+                continue;
+            }
+            f32 dx = (f32)x + 0.5f - center_x;
+            f32 coverage = outer_radius - sqrtf(dx*dx + dy_squared);
+            if (coverage >= 1)
+                canvas.fillPixels<NoAA>(x, y, 1, pixel);
+            else if (coverage > 0)
+                canvas.fillPixels<NoAA>(x, y, 1, pixel * coverage);
+        }
+    }
+}
+
+void _replayCircleSmoothly(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _fillCircleSmoothly(v[0], v[1], v[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _paintCircle(bool fill, i32 center_x, i32 center_y, i32 radius, const Canvas &canvas,
+                  const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (fill && canvas.smooth_edges && canvas.antialias == NoAA) {
+        _fillCircleSmoothly((f32)center_x + 0.5f, (f32)center_y + 0.5f, (f32)radius + 0.5f, canvas, color, opacity, viewport_bounds);
+        return;
+    }
+
+    if (canvas.display_list) {
+        RectI bounds{center_x - radius - 1, center_x + radius + 1, center_y - radius - 1, center_y + radius + 1};
+        DrawCommand *command = canvas.record(_replayCircle, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->integers[0] = center_x;
+            command->integers[1] = center_y;
+            command->integers[2] = radius;
+            command->integers[3] = fill;
+        }
+        return;
+    }
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    RectI rect{center_x - radius,
+               center_x + radius,
+               center_y - radius,
+               center_y + radius};
+    if (viewport_bounds) {
+        center_x += viewport_bounds->left;
+        center_y += viewport_bounds->top;
+        rect.x_range += viewport_bounds->left;
+        rect.y_range += viewport_bounds->top;
+        rect -= *viewport_bounds;
+        bounds -= *viewport_bounds;
+    }
+    if (canvas.clip_bounds) rect -= *canvas.clip_bounds;
+    rect -= bounds;
+    if (!rect)
+        return;
+
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeCircle<NoAA>(fill, center_x, center_y, radius, bounds, canvas, color, opacity); break;
+        case MSAA: _rasterizeCircle<MSAA>(fill, center_x, center_y, radius, bounds, canvas, color, opacity); break;
+        case SSAA: _rasterizeCircle<SSAA>(fill, center_x, center_y, radius, bounds, canvas, color, opacity); break;
+    }
+}
+
+void _replayCircle(const DrawCommand &command, const Canvas &canvas) {
+    const i32 *v = command.integers;
+    _paintCircle(v[3] != 0, v[0], v[1], v[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
 INLINE void Canvas::fillCircle(i32 center_x, i32 center_y, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
     _paintCircle(true, center_x, center_y, radius, *this, color, opacity, viewport_bounds);
 }
@@ -121,6 +253,10 @@ INLINE void Canvas::drawCircle(vec2 center, i32 radius, const Color &color, f32
     _paintCircle(false, (i32)center.x, (i32)center.y, radius, *this, color, opacity, viewport_bounds);
 }
 INLINE void Canvas::fillCircle(vec2 center, i32 radius, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    if (smooth_edges && antialias == NoAA) {
+        _fillCircleSmoothly(center.x + 0.5f, center.y + 0.5f, (f32)radius + 0.5f, *this, color, opacity, viewport_bounds);
+        return;
+    }
     _paintCircle(true, (i32)center.x, (i32)center.y, radius, *this, color, opacity, viewport_bounds);
 }
 #endif
@@ -159,6 +295,10 @@ INLINE void fillCircle(vec2 center, i32 radius,
                        const Canvas &canvas,
                        Color color = White, f32 opacity = 1.0f,
                        const RectI *viewport_bounds = nullptr) {
+    if (canvas.smooth_edges && canvas.antialias == NoAA) {
+        _fillCircleSmoothly(center.x + 0.5f, center.y + 0.5f, (f32)radius + 0.5f, canvas, color, opacity, viewport_bounds);
+        return;
+    }
     _paintCircle(true, (i32)center.x, (i32)center.y, radius, canvas, color, opacity, viewport_bounds);
 }
 #endif
\ No newline at end of file
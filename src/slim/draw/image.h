@@ -1,6 +1,6 @@
 #pragma once
 
-#include "./canvas.h"
+#include "./blit.h"
 
 void drawImage(const PixelImage &image, const Canvas &canvas, RectI bounds, f32 opacity = 1.0f) {
     if (bounds.right < 0 ||
@@ -185,6 +185,8 @@ void drawImageToWindow(const ByteColorImage &image, RectI bounds, f32 opacity =
         bounds.top >= window::height)
         return;
 
+    window::content_source = nullptr; // Canvases can no longer resolve just their dirty tiles over it
+
     i32 image_width = (i32)image.width;
     i32 image_height = (i32)image.height;
     i32 width = bounds.right - bounds.left;
@@ -225,4 +227,24 @@ void drawImageToWindow(const ByteColorImage &image, RectI bounds, f32 opacity =
             byte_color += remainder_x;
         }
     }
-}
\ No newline at end of file
+}
+
+// Draws an image through an affine transform from image pixels to canvas pixels (then translated), see draw/blit.h.
+// Pixels get drawn where their centers land within the transformed image, sampled from it with the given filter:
+void drawImage(const PixelImage &image, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    ImageBlit blit{image, image.content, BlitFormatRGBA, filter, opacity};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
+}
+
+void drawImage(const FloatImage &image, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    ImageBlit blit{image, image.content, image.flags.alpha ? BlitFormatRGBA : BlitFormatRGB, filter, opacity};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
+}
+
+void drawImage(const ByteColorImage &image, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    ImageBlit blit{image, image.content, BlitFormatByteColors, filter, opacity};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
+}
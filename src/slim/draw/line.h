@@ -2,7 +2,21 @@
 
 #include "./canvas.h"
 
+void _replayHLine(const DrawCommand &command, const Canvas &canvas);
+void _replayVLine(const DrawCommand &command, const Canvas &canvas);
+void _replayLine(const DrawCommand &command, const Canvas &canvas);
+
 void _drawHLine(RangeI x_range, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        DrawCommand *command = canvas.record(_replayHLine, RectI{x_range.first, x_range.last, y, y}, color, opacity, viewport_bounds);
+        if (command) {
+            command->integers[0] = x_range.first;
+            command->integers[1] = x_range.last;
+            command->integers[2] = y;
+        }
+        return;
+    }
+
     RangeI y_range{0, canvas.dimensions.height - 1};
 
     if (viewport_bounds) {
@@ -13,24 +27,28 @@ void _drawHLine(RangeI x_range, i32 y, const Canvas &canvas, const Color &color,
         x_range -= viewport_bounds->x_range;
     }
     x_range.sub(0, canvas.dimensions.width - 1);
+    if (canvas.clip_bounds) {
+        x_range -= canvas.clip_bounds->x_range;
+        y_range -= canvas.clip_bounds->y_range;
+    }
     if (!x_range || !y_range[y])
         return;
 
-    if (canvas.antialias == SSAA) {
-        y *= 2;
-        x_range *= 2;
-        for (i32 x = x_range.first; x <= x_range.last; x += 2) {
-            canvas.setPixel(x, y, color, opacity);
-            canvas.setPixel(x+1, y, color, opacity);
-            canvas.setPixel(x, y+1, color, opacity);
-            canvas.setPixel(x+1, y+1, color, opacity);
-        }
-    } else
-        for (i32 x = x_range.first; x <= x_range.last; x += 1)
-            canvas.setPixel(x, y, color, opacity);
+    canvas.markDirty(RectI{x_range.first, x_range.last, y, y});
+    canvas.fillPixels(x_range.first, y, x_range.last - x_range.first + 1, Canvas::toPixel(color, opacity));
 }
 
 void _drawVLine(RangeI y_range, i32 x, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        DrawCommand *command = canvas.record(_replayVLine, RectI{x, x, y_range.first, y_range.last}, color, opacity, viewport_bounds);
+        if (command) {
+            command->integers[0] = y_range.first;
+            command->integers[1] = y_range.last;
+            command->integers[2] = x;
+        }
+        return;
+    }
+
     RangeI x_range{0, canvas.dimensions.width - 1};
 
     if (viewport_bounds) {
@@ -41,53 +59,25 @@ void _drawVLine(RangeI y_range, i32 x, const Canvas &canvas, const Color &color,
         y_range -= viewport_bounds->y_range;
     }
     y_range.sub(0, canvas.dimensions.height - 1);
+    if (canvas.clip_bounds) {
+        x_range -= canvas.clip_bounds->x_range;
+        y_range -= canvas.clip_bounds->y_range;
+    }
     if (!y_range || !x_range[x])
         return;
 
-    if (canvas.antialias == SSAA) {
-        x *= 2;
-        y_range *= 2;
-        for (i32 y = y_range.first; y <= y_range.last; y += 2) {
-            canvas.setPixel(x, y, color, opacity);
-            canvas.setPixel(x+1, y, color, opacity);
-            canvas.setPixel(x, y+1, color, opacity);
-            canvas.setPixel(x+1, y+1, color, opacity);
-        }
-    } else
-        for (i32 y = y_range.first; y <= y_range.last; y += 1)
-            canvas.setPixel(x, y, color, opacity);
+    canvas.markDirty(RectI{x, x, y_range.first, y_range.last});
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    for (i32 y = y_range.first; y <= y_range.last; y++)
+        canvas.fillPixels(x, y, 1, pixel);
 }
 
-void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &canvas,
-               const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) {
-    Range float_x_range{x1 <= x2 ? x1 : x2, x1 <= x2 ? x2 : x1};
-    Range float_y_range{y1 <= y2 ? y1 : y2, y1 <= y2 ? y2 : y1};
-    if (viewport_bounds) {
-        const f32 left = (f32)viewport_bounds->left;
-        const f32 right = (f32)viewport_bounds->right;
-        const f32 top = (f32)viewport_bounds->top;
-        const f32 bottom = (f32)viewport_bounds->bottom;
-        x1 += left;
-        x2 += left;
-        y1 += top;
-        y2 += top;
-        float_x_range += left;
-        float_y_range += top;
-        float_x_range.sub(left, right);
-        float_y_range.sub(top, bottom);
-    }
-    float_x_range.sub(0, canvas.dimensions.f_width - 1.0f);
-    float_y_range.sub(0, canvas.dimensions.f_height - 1.0f);
-    if (!float_x_range || !float_y_range)
-        return;
-
-    RangeI x_range{(i32)float_x_range.first, (i32)(ceilf(float_x_range.last))};
-    RangeI y_range{(i32)float_y_range.first, (i32)(ceilf(float_y_range.last))};
-    if (x_range.last == (i32)canvas.dimensions.width) x_range.last--;
-    if (y_range.last == (i32)canvas.dimensions.height) y_range.last--;
-
+// Draws the (clipped) line with the Xiaolin Wu algorithm, specialized on the anti-aliasing mode:
+template <AntiAliasing AA>
+void _rasterizeLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, RangeI x_range, RangeI y_range, const Canvas &canvas,
+                    const Color &color, f32 opacity, u8 line_width) {
     i32 x, y;
-    if (canvas.antialias == SSAA) {
+    if (AA == SSAA) {
         x1 += x1;
         x2 += x2;
         y1 += y1;
@@ -136,9 +126,9 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
         gap = oneMinusFractionOf(x1 + 0.5f);
 
         if (x_range[x]) {
-            if (y_range[y]) canvas.setPixel(x, y, color, oneMinusFractionOf(first_y) * gap * opacity, z1);
-            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel(x, y, color, opacity, z1);
-            if (y_range[++y]) canvas.setPixel(x, y, color, fractionOf(first_y) * gap * opacity, z1);
+            if (y_range[y]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(first_y) * gap * opacity, z1);
+            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel<AA>(x, y, color, opacity, z1);
+            if (y_range[++y]) canvas.setPixel<AA>(x, y, color, fractionOf(first_y) * gap * opacity, z1);
         }
 
         x = end_x;
@@ -146,9 +136,9 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
         gap = fractionOf(x2 + 0.5f);
 
         if (x_range[x]) {
-            if (y_range[y]) canvas.setPixel(x, y, color, oneMinusFractionOf(last_y) * gap * opacity, z2);
-            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel(x, y, color, opacity, z2);
-            if (y_range[++y]) canvas.setPixel(x, y, color, fractionOf(last_y) * gap * opacity, z2);
+            if (y_range[y]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(last_y) * gap * opacity, z2);
+            for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel<AA>(x, y, color, opacity, z2);
+            if (y_range[++y]) canvas.setPixel<AA>(x, y, color, fractionOf(last_y) * gap * opacity, z2);
         }
 
         if (has_depth) { // Compute one-over-depth start and step
@@ -169,9 +159,9 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
                 y = (i32) gap;
 
                 if (has_depth) z = 1.0f / z_curr;
-                if (y_range[y]) canvas.setPixel(x, y, color, oneMinusFractionOf(gap) * opacity, z);
-                for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel(x, y, color, opacity, z);
-                if (y_range[++y]) canvas.setPixel(x, y, color, fractionOf(gap) * opacity, z);
+                if (y_range[y]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(gap) * opacity, z);
+                for (u8 i = 0; i < line_width; i++) if (y_range[++y]) canvas.setPixel<AA>(x, y, color, opacity, z);
+                if (y_range[++y]) canvas.setPixel<AA>(x, y, color, fractionOf(gap) * opacity, z);
             }
 
             gap += grad;
@@ -206,9 +196,9 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
         gap = oneMinusFractionOf(y1 + 0.5f);
 
         if (y_range[y]) {
-            if (x_range[x]) canvas.setPixel(x, y, color, oneMinusFractionOf(first_x) * gap * opacity, z1);
-            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel(x, y, color, opacity, z1);
-            if (x_range[++x]) canvas.setPixel(x, y, color, fractionOf(first_x) * gap * opacity, z1);
+            if (x_range[x]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(first_x) * gap * opacity, z1);
+            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel<AA>(x, y, color, opacity, z1);
+            if (x_range[++x]) canvas.setPixel<AA>(x, y, color, fractionOf(first_x) * gap * opacity, z1);
         }
 
         x = end_x;
@@ -216,9 +206,9 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
         gap = fractionOf(y2 + 0.5f);
 
         if (y_range[y]) {
-            if (x_range[x]) canvas.setPixel(x, y, color, oneMinusFractionOf(last_x) * gap * opacity, z2);
-            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel(x, y, color, opacity, z2);
-            if (x_range[++x]) canvas.setPixel(x, y, color, fractionOf(last_x) * gap * opacity, z2);
+            if (x_range[x]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(last_x) * gap * opacity, z2);
+            for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel<AA>(x, y, color, opacity, z2);
+            if (x_range[++x]) canvas.setPixel<AA>(x, y, color, fractionOf(last_x) * gap * opacity, z2);
         }
 
         if (has_depth) { // Compute one-over-depth start and step
@@ -239,9 +229,9 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
                 if (has_depth) z = 1.0f / z_curr;
                 x = (i32)gap;
 
-                if (x_range[x]) canvas.setPixel(x, y, color, oneMinusFractionOf(gap) * opacity, z);
-                for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel(x, y, color, opacity, z);
-                if (x_range[++x]) canvas.setPixel(x, y, color, fractionOf(gap) * opacity, z);
+                if (x_range[x]) canvas.setPixel<AA>(x, y, color, oneMinusFractionOf(gap) * opacity, z);
+                for (u8 i = 0; i < line_width; i++) if (x_range[++x]) canvas.setPixel<AA>(x, y, color, opacity, z);
+                if (x_range[++x]) canvas.setPixel<AA>(x, y, color, fractionOf(gap) * opacity, z);
             }
 
             gap += grad;
@@ -250,6 +240,70 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
     }
 }
 
+void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &canvas,
+               const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) {
+    Range float_x_range{x1 <= x2 ? x1 : x2, x1 <= x2 ? x2 : x1};
+    Range float_y_range{y1 <= y2 ? y1 : y2, y1 <= y2 ? y2 : y1};
+    if (canvas.display_list) { // Wide lines extend to one side, and the anti-aliased edges a pixel beyond:
+        RectI bounds{
+            (i32)floorf(float_x_range.first) - line_width - 2, (i32)ceilf(float_x_range.last) + line_width + 2,
+            (i32)floorf(float_y_range.first) - line_width - 2, (i32)ceilf(float_y_range.last) + line_width + 2
+        };
+        DrawCommand *command = canvas.record(_replayLine, bounds, color, opacity, viewport_bounds, line_width);
+        if (command) {
+            command->values[0] = x1;
+            command->values[1] = y1;
+            command->values[2] = z1;
+            command->values[3] = x2;
+            command->values[4] = y2;
+            command->values[5] = z2;
+        }
+        return;
+    }
+    if (viewport_bounds) {
+        const f32 left = (f32)viewport_bounds->left;
+        const f32 right = (f32)viewport_bounds->right;
+        const f32 top = (f32)viewport_bounds->top;
+        const f32 bottom = (f32)viewport_bounds->bottom;
+        x1 += left;
+        x2 += left;
+        y1 += top;
+        y2 += top;
+        float_x_range += left;
+        float_y_range += top;
+        float_x_range.sub(left, right);
+        float_y_range.sub(top, bottom);
+    }
+    float_x_range.sub(0, canvas.dimensions.f_width - 1.0f);
+    float_y_range.sub(0, canvas.dimensions.f_height - 1.0f);
+    if (!float_x_range || !float_y_range)
+        return;
+
+    RangeI x_range{(i32)float_x_range.first, (i32)(ceilf(float_x_range.last))};
+    RangeI y_range{(i32)float_y_range.first, (i32)(ceilf(float_y_range.last))};
+    if (x_range.last == (i32)canvas.dimensions.width) x_range.last--;
+    if (y_range.last == (i32)canvas.dimensions.height) y_range.last--;
+
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeLine<NoAA>(x1, y1, z1, x2, y2, z2, x_range, y_range, canvas, color, opacity, line_width); break;
+        case MSAA: _rasterizeLine<MSAA>(x1, y1, z1, x2, y2, z2, x_range, y_range, canvas, color, opacity, line_width); break;
+        case SSAA: _rasterizeLine<SSAA>(x1, y1, z1, x2, y2, z2, x_range, y_range, canvas, color, opacity, line_width); break;
+    }
+}
+
+void _replayHLine(const DrawCommand &command, const Canvas &canvas) {
+    _drawHLine(RangeI{command.integers[0], command.integers[1]}, command.integers[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _replayVLine(const DrawCommand &command, const Canvas &canvas) {
+    _drawVLine(RangeI{command.integers[0], command.integers[1]}, command.integers[2], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _replayLine(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _drawLine(v[0], v[1], v[2], v[3], v[4], v[5], canvas, command.color, command.opacity, command.line_width, command.getViewportBounds());
+}
+
 
 INLINE void Canvas::drawHLine(RangeI x_range, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
     _drawHLine(x_range, y, *this, color, opacity, viewport_bounds);
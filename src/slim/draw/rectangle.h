@@ -2,8 +2,29 @@
 
 #include "./line.h"
 
+void _replayRect(const DrawCommand &command, const Canvas &canvas);
+
+INLINE bool _recordRect(bool fill, const RectI &rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (!canvas.display_list)
+        return false;
+
+    DrawCommand *command = canvas.record(_replayRect, rect, color, opacity, viewport_bounds);
+    if (command) {
+        command->integers[0] = rect.left;
+        command->integers[1] = rect.right;
+        command->integers[2] = rect.top;
+        command->integers[3] = rect.bottom;
+        command->integers[4] = fill;
+    }
+    return true;
+}
+
 void _drawRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (_recordRect(false, rect, canvas, color, opacity, viewport_bounds))
+        return;
+
     RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
     if (viewport_bounds) {
         bounds -= *viewport_bounds;
         rect.x_range += viewport_bounds->left;
@@ -26,61 +47,29 @@ void _drawRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity
     if (!rect)
         return;
 
-    if (canvas.antialias == SSAA) {
-        rect *= 2;
-
-        if (draw_horizontal) {
-            for (i32 x = rect.left; x <= rect.right; x += 2) {
-                if (draw_bottom) {
-                    canvas.setPixel(x, rect.bottom, color, opacity);
-                    canvas.setPixel(x+1, rect.bottom, color, opacity);
-                    canvas.setPixel(x, rect.bottom+1, color, opacity);
-                    canvas.setPixel(x+1, rect.bottom+1, color, opacity);
-                }
-                if (draw_top) {
-                    canvas.setPixel(x, rect.top, color, opacity);
-                    canvas.setPixel(x+1, rect.top, color, opacity);
-                    canvas.setPixel(x, rect.top+1, color, opacity);
-                    canvas.setPixel(x+1, rect.top+1, color, opacity);
-                }
-            }
-        }
-
-        if (draw_vertical) {
-            for (i32 y = rect.top; y <= rect.bottom; y += 2) {
-                if (draw_left) {
-                    canvas.setPixel(rect.left, y, color, opacity);
-                    canvas.setPixel(rect.left+1, y, color, opacity);
-                    canvas.setPixel(rect.left, y+1, color, opacity);
-                    canvas.setPixel(rect.left+1, y+1, color, opacity);
-                }
-                if (draw_right) {
-                    canvas.setPixel(rect.right, y, color, opacity);
-                    canvas.setPixel(rect.right+1, y, color, opacity);
-                    canvas.setPixel(rect.right, y+1, color, opacity);
-                    canvas.setPixel(rect.right+1, y+1, color, opacity);
-                }
-            }
-        }
-    } else {
-        if (draw_horizontal) {
-            for (i32 x = rect.left; x <= rect.right; x++) {
-                if (draw_bottom) canvas.setPixel(x, rect.bottom, color, opacity);
-                if (draw_top) canvas.setPixel(x, rect.top, color, opacity);
-            }
-        }
+    // Edges are drawn as spans of whole pixels, in the order the pixels always were (corners get drawn twice):
+    canvas.markDirty(rect);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    i32 width = rect.right - rect.left + 1;
+    if (draw_horizontal) {
+        if (draw_bottom) canvas.fillPixels(rect.left, rect.bottom, width, pixel);
+        if (draw_top) canvas.fillPixels(rect.left, rect.top, width, pixel);
+    }
 
-        if (draw_vertical) {
-            for (i32 y = rect.top; y <= rect.bottom; y++) {
-                if (draw_right) canvas.setPixel(rect.right, y, color, opacity);
-                if (draw_left) canvas.setPixel(rect.left, y, color, opacity);
-            }
+    if (draw_vertical) {
+        for (i32 y = rect.top; y <= rect.bottom; y++) {
+            if (draw_right) canvas.fillPixels(rect.right, y, 1, pixel);
+            if (draw_left) canvas.fillPixels(rect.left, y, 1, pixel);
         }
     }
 }
 
 void _fillRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (_recordRect(true, rect, canvas, color, opacity, viewport_bounds))
+        return;
+
     RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
     if (viewport_bounds) {
         bounds -= *viewport_bounds;
         rect.x_range += viewport_bounds->left;
@@ -93,21 +82,99 @@ void _fillRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity
     if (!rect)
         return;
 
-    if (canvas.antialias == SSAA) {
-        rect *= 2;
+    // Clipped once, then filled row by row with the pixel computed once:
+    canvas.markDirty(rect);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    i32 width = rect.right - rect.left + 1;
+    for (i32 y = rect.top; y <= rect.bottom; y++)
+        canvas.fillPixels(rect.left, y, width, pixel);
+    if (pixel.opacity == 1.0f)
+        canvas.markOpaque(rect);
+}
+
+void _replayRect(const DrawCommand &command, const Canvas &canvas) {
+    const i32 *v = command.integers;
+    RectI rect{v[0], v[1], v[2], v[3]};
+    if (v[4])
+        _fillRect(rect, canvas, command.color, command.opacity, command.getViewportBounds());
+    else
+        _drawRect(rect, canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+void _replayRectSmoothly(const DrawCommand &command, const Canvas &canvas);
+
+INLINE f32 _getSpanCoverage(f32 first, f32 end, i32 pixel) {
+    f32 start = first > (f32)pixel ? first : (f32)pixel;
+    f32 stop = end < (f32)(pixel + 1) ? end : (f32)(pixel + 1);
+    return stop - start;
+}
+
+INLINE void _blendPixel(const Canvas &canvas, i32 x, i32 y, const Pixel &pixel, f32 coverage) {
+    if (coverage >= 1)
+        canvas.fillPixels<NoAA>(x, y, 1, pixel);
+    else if (coverage > 0)
+        canvas.fillPixels<NoAA>(x, y, 1, pixel * coverage);
+}
 
-        for (i32 y = rect.top; y <= rect.bottom; y += 2) {
-            for (i32 x = rect.left; x <= rect.right; x += 2) {
-                canvas.setPixel(x, y, color, opacity);
-                canvas.setPixel(x+1, y, color, opacity);
-                canvas.setPixel(x, y+1, color, opacity);
-                canvas.setPixel(x+1, y+1, color, opacity);
-            }
+// Fills a rectangle with fractional edges on a NoAA canvas, blending the pixels along its edges by how much of each it covers.
+// Like with RectI, edges are inclusive (the rectangle ending one pixel past its right and bottom edges),
+// so integral rectangles fill exactly the same pixels as they would without smooth edges:
+void _fillRectSmoothly(Rect rect, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        RectI bounds{(i32)floorf(rect.left), (i32)ceilf(rect.right), (i32)floorf(rect.top), (i32)ceilf(rect.bottom)};
+        DrawCommand *command = canvas.record(_replayRectSmoothly, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->values[0] = rect.left;
+            command->values[1] = rect.right;
+            command->values[2] = rect.top;
+            command->values[3] = rect.bottom;
         }
-    } else
-        for (i32 y = rect.top; y <= rect.bottom; y++)
-            for (i32 x = rect.left; x <= rect.right; x++)
-                canvas.setPixel(x, y, color, opacity);
+        return;
+    }
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    if (canvas.clip_bounds) bounds -= *canvas.clip_bounds;
+    f32 left = rect.left, right = rect.right + 1.0f, top = rect.top, bottom = rect.bottom + 1.0f;
+    if (viewport_bounds) {
+        bounds -= *viewport_bounds;
+        left   += (f32)viewport_bounds->left;
+        right  += (f32)viewport_bounds->left;
+        top    += (f32)viewport_bounds->top;
+        bottom += (f32)viewport_bounds->top;
+    }
+    if (left   < (f32)bounds.left)         left   = (f32)bounds.left;
+    if (right  > (f32)(bounds.right + 1))  right  = (f32)(bounds.right + 1);
+    if (top    < (f32)bounds.top)          top    = (f32)bounds.top;
+    if (bottom > (f32)(bounds.bottom + 1)) bottom = (f32)(bounds.bottom + 1);
+    if (left >= right || top >= bottom)
+        return;
+
+    // Partially covered pixels are those at the ends of rows and columns, the ones in between being filled as spans:
+    RectI pixels{(i32)floorf(left), (i32)ceilf(right) - 1, (i32)floorf(top), (i32)ceilf(bottom) - 1};
+    f32 first_column_coverage = _getSpanCoverage(left, right, pixels.left);
+    f32 last_column_coverage = _getSpanCoverage(left, right, pixels.right);
+    i32 span_first = first_column_coverage < 1 ? pixels.left + 1 : pixels.left;
+    i32 span_last = pixels.right > pixels.left && last_column_coverage < 1 ? pixels.right - 1 : pixels.right;
+
+    canvas.markDirty(pixels);
+    Pixel pixel{Canvas::toPixel(color, opacity)};
+    for (i32 y = pixels.top; y <= pixels.bottom; y++) {
+        f32 row_coverage = _getSpanCoverage(top, bottom, y);
+        Pixel row_pixel{row_coverage < 1 ? pixel * row_coverage : pixel};
+        if (span_first > pixels.left) _blendPixel(canvas, pixels.left, y, row_pixel, first_column_coverage);
+        if (span_last >= span_first) canvas.fillPixels<NoAA>(span_first, y, span_last - span_first + 1, row_pixel);
+        if (span_last < pixels.right) _blendPixel(canvas, pixels.right, y, row_pixel, last_column_coverage);
+    }
+    // Only the fully covered pixels become opaque:
+    RangeI covered_x{(i32)ceilf(left), (i32)floorf(right) - 1};
+    RangeI covered_y{(i32)ceilf(top), (i32)floorf(bottom) - 1};
+    if (pixel.opacity == 1.0f && covered_x.first <= covered_x.last && covered_y.first <= covered_y.last)
+        canvas.markOpaque(RectI{covered_x, covered_y});
+}
+
+void _replayRectSmoothly(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _fillRectSmoothly(Rect{v[0], v[1], v[2], v[3]}, canvas, command.color, command.opacity, command.getViewportBounds());
 }
 
 
@@ -125,6 +192,10 @@ INLINE void Canvas::fillRect(RectI rect, const Color &color, f32 opacity, const
 }
 
 INLINE void Canvas::fillRect(Rect rect, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
+    if (smooth_edges && antialias == NoAA) {
+        _fillRectSmoothly(rect, *this, color, opacity, viewport_bounds);
+        return;
+    }
     RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
     _fillRect(rectI, *this, color, opacity, viewport_bounds);
 }
@@ -145,6 +216,10 @@ INLINE void fillRect(RectI rect, const Canvas &canvas, Color color = White, f32
 }
 
 INLINE void fillRect(Rect rect, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    if (canvas.smooth_edges && canvas.antialias == NoAA) {
+        _fillRectSmoothly(rect, canvas, color, opacity, viewport_bounds);
+        return;
+    }
     RectI rectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom};
     _fillRect(rectI, canvas, color, opacity, viewport_bounds);
 }
\ No newline at end of file
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "./blit.h"
+
+// Batches of textured rectangles (sprites), drawn all at once at the end of a frame:
+// Sprites get added into a frame arena, then set up and culled against the canvas in chunks (in parallel),
+// sorted by layer, texture and mip, binned into the canvas tiles they overlap and drawn tile by tile in parallel
+// (through the same sampling kernels as drawImage(), see draw/blit.h).
+// Within a layer, sprites of the same texture and mip keep the order they were added in, while sprites of
+// different ones may get drawn in either order. So sprites that overlap and need to be drawn in order go in separate layers.
+#ifndef SPRITE_BATCH_CAPACITY
+#define SPRITE_BATCH_CAPACITY Megabytes(64)
+#endif
+
+#define SPRITE_BATCH_MAX_TEXTURES 256
+#define SPRITES_PER_CHUNK 4096
+
+struct Sprite {
+    const Texture *texture;
+    Rect bounds; // Where it goes on the canvas (in pixels, the right and bottom edges being where it ends)
+    Rect uv; // The part of the texture it shows
+    Color tint;
+    f32 opacity;
+    u32 key; // The layer, texture and mip it gets sorted by (the lowest 8 bits being the mip level)
+};
+
+namespace sprites {
+    // Maps a sprite onto the canvas as a blit of the texels its uv rect covers (widened to whole texels).
+    // Returns false when nothing of it would get drawn:
+    bool map(const Sprite &sprite, ImageFilter filter, const Canvas &canvas, ImageBlit &blit) {
+        const Texture &texture = *sprite.texture;
+        const TextureMip &texture_mip = texture.mips[sprite.key & 255];
+        const Rect &uv = sprite.uv;
+        const f32 mip_width = (f32)texture_mip.width;
+        const f32 mip_height = (f32)texture_mip.height;
+
+        // From texels of the texture to canvas pixels, then scaled to texels of the mip (as in drawImage() of a Texture):
+        const f32 scale_x = (sprite.bounds.right - sprite.bounds.left) / ((uv.right - uv.left) * (f32)texture.width);
+        const f32 scale_y = (sprite.bounds.bottom - sprite.bounds.top) / ((uv.bottom - uv.top) * (f32)texture.height);
+        const mat2 transform{
+                scale_x * ((f32)texture.width / mip_width), 0.0f,
+                0.0f, scale_y * ((f32)texture.height / mip_height)
+        };
+
+        const f32 u0 = uv.left * mip_width;
+        const f32 u1 = uv.right * mip_width;
+        const f32 v0 = uv.top * mip_height;
+        const f32 v1 = uv.bottom * mip_height;
+        const i32 x0 = (i32)clampedValue(floorf(u0), 0.0f, mip_width);
+        const i32 x1 = (i32)clampedValue(ceilf(u1), 0.0f, mip_width);
+        const i32 y0 = (i32)clampedValue(floorf(v0), 0.0f, mip_height);
+        const i32 y1 = (i32)clampedValue(ceilf(v1), 0.0f, mip_height);
+        if (x1 <= x0 || y1 <= y0)
+            return false;
+
+        blit = ImageBlit{texture_mip, filter, sprite.opacity, texture.texelLayout()};
+        if (blit.format == BlitFormatTiledTexelQuads) {
+            blit.quad_x = x0;
+            blit.quad_y = y0;
+        } else
+            blit.content = texture_mip.texel_quads + y0 * blit.stride + x0;
+        blit.width = x1 - x0;
+        blit.height = y1 - y0;
+        blit.tint = sprite.tint;
+        vec2 translation{
+                sprite.bounds.left + ((f32)x0 - u0) * transform.X.x,
+                sprite.bounds.top  + ((f32)y0 - v0) * transform.Y.y
+        };
+        if (!blit.map(transform, translation, canvas))
+            return false;
+
+        if ((f32)x0 == u0 && (f32)x1 == u1 && (f32)y0 == v0 && (f32)y1 == v1)
+            return true;
+
+        // The texels it was widened by get cut off at the pixels whose centers are outside of the sprite:
+        const i32 left = (i32)ceilf(sprite.bounds.left - 0.5f);
+        const i32 right = (i32)ceilf(sprite.bounds.right - 0.5f) - 1;
+        const i32 top = (i32)ceilf(sprite.bounds.top - 0.5f);
+        const i32 bottom = (i32)ceilf(sprite.bounds.bottom - 0.5f) - 1;
+        if (right < left || bottom < top)
+            return false;
+
+        blit.bounds -= RectI{left, right, top, bottom};
+        return !!blit.bounds;
+    }
+
+    // Sorts the keys along with the sprite indices (stably, a byte at a time), skipping bytes that all keys share.
+    // The sorted keys and indices end up in either of the given pairs of buffers, which get swapped accordingly:
+    void sort(u32 *&keys, u32 *&indices, u32 *&other_keys, u32 *&other_indices, u32 count) {
+        u32 offsets[256];
+        for (u32 shift = 0; shift < 32; shift += 8) {
+            for (u32 i = 0; i < 256; i++) offsets[i] = 0;
+            for (u32 i = 0; i < count; i++) offsets[(keys[i] >> shift) & 255]++;
+            if (offsets[(keys[0] >> shift) & 255] == count)
+                continue;
+
+            u32 offset = 0;
+            for (u32 i = 0; i < 256; i++) {
+                u32 digit_count = offsets[i];
+                offsets[i] = offset;
+                offset += digit_count;
+            }
+            for (u32 i = 0; i < count; i++) {
+                u32 to = offsets[(keys[i] >> shift) & 255]++;
+                other_keys[to] = keys[i];
+                other_indices[to] = indices[i];
+            }
+            swap(&keys, &other_keys);
+            swap(&indices, &other_indices);
+        }
+    }
+
+    // The state of drawing a batch, with the sprites of each tile listed in their sorted order:
+    struct Frame {
+        const Canvas *canvas;
+        const Sprite *sprites;
+        ImageFilter filter;
+        u32 count;
+        u32 chunk_count;
+        u32 tile_column_count;
+
+        ImageBlit *blits;
+        u8 *is_visible;
+        u32 *tile_offsets; // Per tile, where its bin starts
+        u32 *bins;
+
+        static void setupChunk(void *data, u32 chunk) {
+            Frame &frame = *(Frame*)data;
+            u32 end = (chunk + 1) * SPRITES_PER_CHUNK;
+            if (end > frame.count) end = frame.count;
+            for (u32 i = chunk * SPRITES_PER_CHUNK; i < end; i++)
+                frame.is_visible[i] = map(frame.sprites[i], frame.filter, *frame.canvas, frame.blits[i]);
+        }
+
+        // Calls tile_function(tile_index) for each tile overlapped by the bounds:
+        template <typename TileFunction>
+        INLINE void forEachTile(const RectI &bounds, const TileFunction &tile_function) const {
+            for (i32 tile_y = bounds.top >> CANVAS_TILE_SIZE_SHIFT; tile_y <= (bounds.bottom >> CANVAS_TILE_SIZE_SHIFT); tile_y++)
+                for (i32 tile_x = bounds.left >> CANVAS_TILE_SIZE_SHIFT; tile_x <= (bounds.right >> CANVAS_TILE_SIZE_SHIFT); tile_x++)
+                    tile_function(tile_y * tile_column_count + tile_x);
+        }
+
+        template <AntiAliasing AA>
+        void drawTile(const RectI &tile) const {
+            u32 tile_index = (tile.top >> CANVAS_TILE_SIZE_SHIFT) * tile_column_count + (tile.left >> CANVAS_TILE_SIZE_SHIFT);
+            if (tile_offsets[tile_index] == tile_offsets[tile_index + 1])
+                return;
+
+            canvas->markDirty(tile);
+            for (u32 i = tile_offsets[tile_index]; i < tile_offsets[tile_index + 1]; i++) {
+                const ImageBlit &blit = blits[bins[i]];
+                drawBlitRows<AA>(blit, *canvas, blit.bounds - tile);
+            }
+        }
+    };
+}
+
+// Sprites added for a frame, drawn (and then discarded) by draw(). Sprites are to be added from one thread at a time:
+struct SpriteBatch {
+    memory::MonotonicAllocator memory;
+    Sprite *sprites;
+    u32 count{0};
+    const Texture *textures[SPRITE_BATCH_MAX_TEXTURES];
+    u32 texture_count{0};
+
+    explicit SpriteBatch(u64 capacity = SPRITE_BATCH_CAPACITY) : memory{capacity}, sprites{(Sprite*)memory.address} {}
+
+    // Adds a sprite showing the uv rect of the texture within the given bounds (in pixels), in the layer given (lower ones
+    // being drawn first). Mipmapped textures are drawn from the mip closest to a texel per pixel.
+    // Returns false when the batch is full (of sprites, or of distinct textures):
+    bool add(const Texture &texture, const Rect &bounds, const Rect &uv = Rect{0.0f, 1.0f, 0.0f, 1.0f},
+             const Color &tint = White, f32 opacity = 1.0f, u16 layer = 0) {
+        const f32 width = bounds.right - bounds.left;
+        const f32 height = bounds.bottom - bounds.top;
+        const f32 uv_width = uv.right - uv.left;
+        const f32 uv_height = uv.bottom - uv.top;
+        if (!texture.mips || width <= 0 || height <= 0 || uv_width <= 0 || uv_height <= 0 || opacity <= 0)
+            return true;
+
+        u32 texture_id = texture_count;
+        if (texture_count && textures[texture_count - 1] == &texture) // Likely added in runs of the same texture
+            texture_id = texture_count - 1;
+        else
+            for (u32 i = 0; i < texture_count; i++)
+                if (textures[i] == &texture) {
+                    texture_id = i;
+                    break;
+                }
+        if (texture_id == SPRITE_BATCH_MAX_TEXTURES)
+            return false;
+
+        Sprite *sprite = (Sprite*)memory.allocate(sizeof(Sprite));
+        if (!sprite)
+            return false;
+
+        if (texture_id == texture_count)
+            textures[texture_count++] = &texture;
+
+        // The mip gets picked the way drawImage() picks it for a Texture, by how much the sprite shrinks texels:
+        u32 mip_level = getMipLevel(texture, mat2{
+                width / (uv_width * (f32)texture.width), 0.0f,
+                0.0f, height / (uv_height * (f32)texture.height)
+        });
+
+        sprite->texture = &texture;
+        sprite->bounds = bounds;
+        sprite->uv = uv;
+        sprite->tint = tint;
+        sprite->opacity = opacity > 1.0f ? 1.0f : opacity;
+        sprite->key = ((u32)layer << 16) | (texture_id << 8) | mip_level;
+        count++;
+        return true;
+    }
+
+    // Draws all of the sprites added since the last draw (then empties the batch):
+    void draw(const Canvas &canvas, ImageFilter filter = ImageFilterBilinear) {
+        if (!count) return;
+
+        sprites::Frame frame;
+        frame.canvas = &canvas;
+        frame.sprites = sprites;
+        frame.filter = filter;
+        frame.count = count;
+        frame.chunk_count = (count + SPRITES_PER_CHUNK - 1) / SPRITES_PER_CHUNK;
+        frame.tile_column_count = canvas.getTileColumnCount();
+        u32 tile_count = frame.tile_column_count * canvas.getTileRowCount();
+
+        // The scratch memory comes after the sprites (and goes away with them):
+        frame.blits        = (ImageBlit*)memory.allocate(sizeof(ImageBlit) * count);
+        frame.is_visible   = (u8*)memory.allocate(count);
+        u32 *keys          = (u32*)memory.allocate(sizeof(u32) * count);
+        u32 *indices       = (u32*)memory.allocate(sizeof(u32) * count);
+        u32 *other_keys    = (u32*)memory.allocate(sizeof(u32) * count);
+        u32 *other_indices = (u32*)memory.allocate(sizeof(u32) * count);
+        frame.tile_offsets = (u32*)memory.allocate(sizeof(u32) * (tile_count + 1));
+        u32 *tile_ends     = (u32*)memory.allocate(sizeof(u32) * tile_count);
+        if (!frame.blits || !frame.is_visible || !keys || !indices || !other_keys || !other_indices || !frame.tile_offsets || !tile_ends) {
+            // Too many, draw them one by one in the order they were added:
+            ImageBlit blit;
+            for (u32 i = 0; i < count; i++)
+                if (sprites::map(sprites[i], filter, canvas, blit))
+                    drawBlit(blit, canvas);
+            reset();
+            return;
+        }
+
+        jobs::run(sprites::Frame::setupChunk, &frame, frame.chunk_count);
+
+        u32 visible_count = 0;
+        for (u32 i = 0; i < count; i++)
+            if (frame.is_visible[i]) {
+                keys[visible_count] = sprites[i].key;
+                indices[visible_count] = i;
+                visible_count++;
+            }
+        if (!visible_count) {
+            reset();
+            return;
+        }
+        sprites::sort(keys, indices, other_keys, other_indices, visible_count);
+
+        // Lay the bins out tile after tile, each in sorted order:
+        u32 *tile_offsets = frame.tile_offsets;
+        for (u32 i = 0; i <= tile_count; i++) tile_offsets[i] = 0;
+        for (u32 i = 0; i < visible_count; i++) // Counting into the next tile's offset first
+            frame.forEachTile(frame.blits[indices[i]].bounds, [&](u32 tile) { tile_offsets[tile + 1]++; });
+        for (u32 i = 1; i <= tile_count; i++) tile_offsets[i] += tile_offsets[i - 1];
+
+        frame.bins = (u32*)memory.allocate(sizeof(u32) * frame.tile_offsets[tile_count]);
+        if (!frame.bins) { // Too many tiles overlapped, draw them one by one in sorted order:
+            for (u32 i = 0; i < visible_count; i++)
+                drawBlit(frame.blits[indices[i]], canvas);
+            reset();
+            return;
+        }
+        for (u32 i = 0; i < tile_count; i++) tile_ends[i] = tile_offsets[i];
+        for (u32 i = 0; i < visible_count; i++)
+            frame.forEachTile(frame.blits[indices[i]].bounds, [&](u32 tile) { frame.bins[tile_ends[tile]++] = indices[i]; });
+
+        RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+        switch (canvas.antialias) {
+            case NoAA: parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { frame.drawTile<NoAA>(tile); }); break;
+            case MSAA: parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { frame.drawTile<MSAA>(tile); }); break;
+            case SSAA: parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { frame.drawTile<SSAA>(tile); }); break;
+        }
+        reset();
+    }
+
+    void reset() {
+        memory.reset();
+        count = 0;
+        texture_count = 0;
+    }
+};
@@ -111,21 +111,35 @@ u8 *char_addr[] = {bitmap_32,bitmap_33,bitmap_34,bitmap_35,bitmap_36,bitmap_37,b
 
 
 
-void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
-    RectI bounds{
-        0, canvas.dimensions.width - 1,
-        0, canvas.dimensions.height - 1
-    };
-    if (viewport_bounds) {
-        x += viewport_bounds->left;
-        y += viewport_bounds->top;
-        bounds -= *viewport_bounds;
+void _replayText(const DrawCommand &command, const Canvas &canvas);
+
+// Records the text along with the command, as a copy, bounded by its lines (which get cut off at the right edge):
+void _recordText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    i32 columns = 0, max_columns = 0, lines = 1;
+    u32 length = 0;
+    for (char *character = str; *character; character++, length++) {
+        if (*character == '\n') {
+            lines++;
+            columns = 0;
+        } else {
+            columns += *character == '\t' ? 4 : 1;
+            if (columns > max_columns) max_columns = columns;
+        }
     }
 
-    if (x + FONT_WIDTH < bounds.left || x - FONT_WIDTH > bounds.right ||
-        y + FONT_HEIGHT < bounds.top || y - FONT_HEIGHT > bounds.bottom)
-        return;
+    RectI bounds{x - FONT_WIDTH, x + (max_columns + 1) * FONT_WIDTH, y - FONT_HEIGHT, y + lines * LINE_HEIGHT + FONT_HEIGHT};
+    DrawCommand *command = canvas.record(_replayText, bounds, color, opacity, viewport_bounds, 0, length + 1);
+    if (command) {
+        command->integers[0] = x;
+        command->integers[1] = y;
+        char *text = command->getPayload();
+        for (u32 i = 0; i <= length; i++) text[i] = str[i];
+    }
+}
 
+// Draws the glyphs of the text within the given bounds, specialized on the anti-aliasing mode:
+template <AntiAliasing AA>
+void _rasterizeText(char *str, i32 x, i32 y, const RectI &bounds, const Canvas &canvas, const Color &color, f32 opacity) {
     f32 pixel_opacity;
     u16 current_x = (u16)x;
     u16 current_y = (u16)y;
@@ -149,27 +163,31 @@ void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color
             byte_ptr = char_addr[character - FIRST_CHARACTER_CODE];
             byte = *byte_ptr;
             next_column_byte = *(byte_ptr + 1);
-            for (int i = 1; i < 4; i++) {
+            // Characters entirely outside of the clip bounds are skipped (positions left/above the canvas wrap around):
+            bool is_clipped = canvas.clip_bounds && (
+                    (i16)current_x > canvas.clip_bounds->right || (i16)current_x + FONT_WIDTH < canvas.clip_bounds->left ||
+                    (i16)current_y > canvas.clip_bounds->bottom || (i16)current_y + FONT_HEIGHT < canvas.clip_bounds->top);
+            for (int i = 1; i < 4 && !is_clipped; i++) {
                 pixel_x = current_x;
                 pixel_y = current_y + i * FONT_HEIGHT / 3;
                 for (int w = 0; w < INTERNAL_FONT_WIDTH ; w += 2) {
                     for (int h = 0; h < 8; h += 2) {
                         /* skip background bits */
                         if (bounds.contains(pixel_x, pixel_y)) {
-                            if (canvas.antialias == SSAA) {
+                            if (AA == SSAA) {
                                 sub_pixel_x = pixel_x << 1;
                                 sub_pixel_y = pixel_y << 1;
 
-                                if (byte & (0x80 >> h)) canvas.setPixel(sub_pixel_x, sub_pixel_y + 1, color, opacity);
-                                if (byte & (0x80 >> (h+1))) canvas.setPixel(sub_pixel_x, sub_pixel_y, color, opacity);
-                                if (next_column_byte & (0x80 >> h)) canvas.setPixel(sub_pixel_x+1, sub_pixel_y + 1, color, opacity);
-                                if (next_column_byte & (0x80 >> (h+1))) canvas.setPixel(sub_pixel_x+1, sub_pixel_y, color, opacity);
+                                if (byte & (0x80 >> h)) canvas.setPixel<AA>(sub_pixel_x, sub_pixel_y + 1, color, opacity);
+                                if (byte & (0x80 >> (h+1))) canvas.setPixel<AA>(sub_pixel_x, sub_pixel_y, color, opacity);
+                                if (next_column_byte & (0x80 >> h)) canvas.setPixel<AA>(sub_pixel_x+1, sub_pixel_y + 1, color, opacity);
+                                if (next_column_byte & (0x80 >> (h+1))) canvas.setPixel<AA>(sub_pixel_x+1, sub_pixel_y, color, opacity);
                             } else {
                                 pixel_opacity = (byte & (0x80 >> h)) ? 0.25f : 0;
                                 if (byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
                                 if (next_column_byte & (0x80 >> h)) pixel_opacity += 0.25f;
                                 if (next_column_byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
-                                if (pixel_opacity != 0.0f) canvas.setPixel(pixel_x, pixel_y, color, pixel_opacity);
+                                if (pixel_opacity != 0.0f) canvas.setPixel<AA>(pixel_x, pixel_y, color, pixel_opacity);
                             }
                         }
 
@@ -201,6 +219,37 @@ void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color
     }
 }
 
+void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        _recordText(str, x, y, canvas, color, opacity, viewport_bounds);
+        return;
+    }
+
+    RectI bounds{
+        0, canvas.dimensions.width - 1,
+        0, canvas.dimensions.height - 1
+    };
+    if (viewport_bounds) {
+        x += viewport_bounds->left;
+        y += viewport_bounds->top;
+        bounds -= *viewport_bounds;
+    }
+
+    if (x + FONT_WIDTH < bounds.left || x - FONT_WIDTH > bounds.right ||
+        y + FONT_HEIGHT < bounds.top || y - FONT_HEIGHT > bounds.bottom)
+        return;
+
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeText<NoAA>(str, x, y, bounds, canvas, color, opacity); break;
+        case MSAA: _rasterizeText<MSAA>(str, x, y, bounds, canvas, color, opacity); break;
+        case SSAA: _rasterizeText<SSAA>(str, x, y, bounds, canvas, color, opacity); break;
+    }
+}
+
+void _replayText(const DrawCommand &command, const Canvas &canvas) {
+    _drawText(command.getPayload(), command.integers[0], command.integers[1], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
 INLINE void Canvas::drawText(char *str, i32 x, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
     _drawText(str, x, y, *this, color, opacity, viewport_bounds);
 }
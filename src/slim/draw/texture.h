@@ -1,9 +1,30 @@
 #pragma once
 
-#include "./canvas.h"
-#include "../core/texture.h"
+#include "./blit.h"
 
-void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f) {
+// Draws a texture mip through an affine transform from texels to canvas pixels (then translated), see draw/blit.h:
+void drawImage(const TextureMip &texture_mip, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f, TexelLayout layout = TexelLayoutRows) {
+    ImageBlit blit{texture_mip, filter, opacity, layout};
+    if (blit.map(transform, translation, canvas)) drawBlit(blit, canvas);
+}
+
+// Mipmapped textures get drawn from the mip closest to a texel per pixel, along the axis the transform shrinks the most
+// (judging by areas alone would alias textures squashed along one axis):
+void drawImage(const Texture &texture, const Canvas &canvas, const mat2 &transform, const vec2 &translation,
+               ImageFilter filter = ImageFilterBilinear, f32 opacity = 1.0f) {
+    if (!texture.mips || !transform.has_inverse())
+        return;
+
+    u32 mip_level = getMipLevel(texture, transform);
+    const TextureMip &texture_mip = texture.mips[mip_level];
+    const f32 scale_x = (f32)texture.width / (f32)texture_mip.width;
+    const f32 scale_y = (f32)texture.height / (f32)texture_mip.height;
+    drawImage(texture_mip, canvas, mat2{transform.X * scale_x, transform.Y * scale_y}, translation, filter, opacity, texture.texelLayout());
+}
+
+void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f,
+                    TexelLayout layout = TexelLayoutRows) {
     Color texel_color;
     i32 draw_width = draw_bounds.right - draw_bounds.left+1;
     i32 draw_height = draw_bounds.bottom - draw_bounds.top+1;
@@ -16,6 +37,9 @@ void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const R
         for (i32 y = 0; y < draw_height; y++, Y++) {
             i32 X = draw_bounds.left;
             for (i32 x = 0; x < draw_width; x++, X++, texel_quad++) {
+                if (layout == TexelLayoutTiles)
+                    texel_quad = texture_mip.texel_quads + TextureMip::GetQuadIndex<TexelLayoutTiles>(x, y, texture_mip.width + 1);
+
                 texel_color.r = (f32)texel_quad->R.BR * COLOR_COMPONENT_TO_FLOAT;
                 texel_color.g = (f32)texel_quad->G.BR * COLOR_COMPONENT_TO_FLOAT;
                 texel_color.b = (f32)texel_quad->B.BR * COLOR_COMPONENT_TO_FLOAT;
@@ -23,20 +47,11 @@ void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const R
             }
             texel_quad += remainder_x;
         }
-    } else {
-        f32 u_step = 1.0f / (f32)draw_width;
-        f32 v_step = 1.0f / (f32)draw_height;
-        f32 v = v_step * 0.5f;
-        i32 Y = draw_bounds.top;
-        for (i32 y = 0; y < draw_height; y++, Y++, v += v_step) {
-            i32 X = draw_bounds.left;
-            f32 u = u_step * 0.5f;
-            for (i32 x = 0; x < draw_width; x++, X++, u += u_step) {
-                texel_color = texture_mip.sample(u, v).color;
-                canvas.setPixel(X, Y, texel_color, opacity);
-            }
-        }
-    }
+    } else
+        drawImage(texture_mip, canvas, mat2{
+                (f32)draw_width / (f32)texture_mip.width, 0.0f,
+                0.0f, (f32)draw_height / (f32)texture_mip.height
+        }, vec2{(f32)draw_bounds.left, (f32)draw_bounds.top}, ImageFilterBilinear, opacity, layout);
 }
 
 void drawTexture(const Texture &texture, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f) {
@@ -50,8 +65,7 @@ void drawTexture(const Texture &texture, const Canvas &canvas, const RectI draw_
     if (!cropped) {
         i32 draw_width = draw_bounds.right - draw_bounds.left+1;
         i32 draw_height = draw_bounds.bottom - draw_bounds.top+1;
-        f32 texel_area = (f32)(texture.width * texture.height) / (f32)(draw_width * draw_height);
-        mip_level = Texture::GetMipLevel(texel_area, texture.mip_count);
+        mip_level = texture.getMipLevel(1.0f / (f32)draw_width, 0.0f, 0.0f, 1.0f / (f32)draw_height);
     }
-    drawTextureMip(texture.mips[mip_level], canvas, draw_bounds, cropped, opacity);
+    drawTextureMip(texture.mips[mip_level], canvas, draw_bounds, cropped, opacity, texture.texelLayout());
 }
\ No newline at end of file
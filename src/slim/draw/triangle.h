@@ -10,10 +10,66 @@ INLINE void _drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3,
 }
 
 
-void _fillTriangle(f32 x1, f32 y1,
-                   f32 x2, f32 y2,
-                   f32 x3, f32 y3,
-                   const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+// Triangles are filled in 8x8 blocks of samples: Blocks entirely outside of an edge are skipped, blocks entirely inside
+// of all edges are filled row by row, and only blocks straddling an edge evaluate the edges for each of their samples.
+// Edges are evaluated as the barycentric weights (B, C and A = 1 - B - C) at sample centers, a sample being inside when none is negative.
+#define TRIANGLE_BLOCK_SIZE 8
+
+// Returns a bit mask of which of 8 consecutive samples of a row are inside, given the weights of the first one.
+// Samples can be required to be further inside than that (or be let further outside) by minimum weights:
+INLINE u32 _getTriangleRowMask(f32 B, f32 C, f32 Bdx, f32 Cdx, f32 A_min = 0, f32 B_min = 0, f32 C_min = 0) {
+#ifdef SLIM_SSE2
+    const __m128 steps_low  = _mm_setr_ps(0, 1, 2, 3);
+    const __m128 steps_high = _mm_setr_ps(4, 5, 6, 7);
+    const __m128 a_min = _mm_set1_ps(A_min);
+    const __m128 b_min = _mm_set1_ps(B_min);
+    const __m128 c_min = _mm_set1_ps(C_min);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 b_dx = _mm_set1_ps(Bdx);
+    __m128 c_dx = _mm_set1_ps(Cdx);
+    __m128 b = _mm_set1_ps(B);
+    __m128 c = _mm_set1_ps(C);
+
+    __m128 B_low  = _mm_add_ps(b, _mm_mul_ps(b_dx, steps_low));
+    __m128 C_low  = _mm_add_ps(c, _mm_mul_ps(c_dx, steps_low));
+    __m128 B_high = _mm_add_ps(b, _mm_mul_ps(b_dx, steps_high));
+    __m128 C_high = _mm_add_ps(c, _mm_mul_ps(c_dx, steps_high));
+    __m128 A_low  = _mm_sub_ps(_mm_sub_ps(one, B_low),  C_low);
+    __m128 A_high = _mm_sub_ps(_mm_sub_ps(one, B_high), C_high);
+
+    __m128 inside_low  = _mm_and_ps(_mm_cmpge_ps(A_low,  a_min), _mm_and_ps(_mm_cmpge_ps(B_low,  b_min), _mm_cmpge_ps(C_low,  c_min)));
+    __m128 inside_high = _mm_and_ps(_mm_cmpge_ps(A_high, a_min), _mm_and_ps(_mm_cmpge_ps(B_high, b_min), _mm_cmpge_ps(C_high, c_min)));
+    return (u32)_mm_movemask_ps(inside_low) | ((u32)_mm_movemask_ps(inside_high) << 4);
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < TRIANGLE_BLOCK_SIZE; i++) {
+        f32 b = B + Bdx * (f32)i;
+        f32 c = C + Cdx * (f32)i;
+        f32 a = 1 - b - c;
+        if (a >= A_min && b >= B_min && c >= C_min) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// A triangle ready for rasterization: Its weights as linear functions of sample coordinates, and its bounds in samples:
+// With smooth edges, the weights are also scaled into (signed) distances in pixels from their edges, and samples are covered
+// partially up to half a pixel outside of the edges (the margins being how far that is in terms of weights).
+// With MSAA, the margins are how far the weights may get at the samples of a pixel from where they are at its center:
+struct TriangleSetup {
+    f32 B_origin, Bdx, Bdy;
+    f32 C_origin, Cdx, Cdy;
+    f32 A_scale, B_scale, C_scale;
+    f32 A_margin{0}, B_margin{0}, C_margin{0};
+    i32 first_x, first_y, last_x, last_y;
+    bool smooth_edges{false};
+};
+
+// Culls a triangle against the viewport and against facing backwards, returning false when there is nothing to draw:
+bool _setupTriangle(f32 x1, f32 y1,
+                    f32 x2, f32 y2,
+                    f32 x3, f32 y3,
+                    const Canvas &canvas, const RectI *viewport_bounds, TriangleSetup &setup) {
     // Cull this triangle against the edges of the viewport:
     Rect bounds{0, canvas.dimensions.f_width - 1.0f, 0, canvas.dimensions.f_height - 1.0f};
     Rect rect{
@@ -46,7 +102,7 @@ void _fillTriangle(f32 x1, f32 y1,
     }
     rect -= bounds;
     if (!rect)
-        return;
+        return false;
 
     if (canvas.antialias == SSAA) {
         x1 *= 2.0f;
@@ -84,18 +140,13 @@ void _fillTriangle(f32 x1, f32 y1,
         ACy = y3 - y1;
         ABC = ACx*ABy - ACy*ABx;
     } else if (ABC == 0)
-        return;
+        return false;
 
     // Floor bounds coordinates down to their integral component:
-    u32 first_x = (u32)rect.left;
-    u32 first_y = (u32)rect.top;
-    u32 last_x  = (u32)rect.right;
-    u32 last_y  = (u32)rect.bottom;
-
-    rect.left   = (f32)first_x;
-    rect.top    = (f32)first_y;
-    rect.right  = (f32)last_x;
-    rect.bottom = (f32)last_y;
+    setup.first_x = (i32)rect.left;
+    setup.first_y = (i32)rect.top;
+    setup.last_x  = (i32)rect.right;
+    setup.last_y  = (i32)rect.bottom;
 
     // Drawing: Top-down
     // Origin: Top-left
@@ -103,41 +154,481 @@ void _fillTriangle(f32 x1, f32 y1,
     // Compute weight constants:
     f32 one_over_ABC = 1.0f / ABC;
 
-    f32 Cdx =  ABy * one_over_ABC;
-    f32 Bdx = -ACy * one_over_ABC;
+    setup.Cdx =  ABy * one_over_ABC;
+    setup.Bdx = -ACy * one_over_ABC;
+
+    setup.Cdy = -ABx * one_over_ABC;
+    setup.Bdy =  ACx * one_over_ABC;
+
+    // Weights at the origin, to be evaluated at sample centers:
+    setup.C_origin = (y1*x2 - x1*y2) * one_over_ABC + (setup.Cdx + setup.Cdy) * 0.5f;
+    setup.B_origin = (y3*x1 - x3*y1) * one_over_ABC + (setup.Bdx + setup.Bdy) * 0.5f;
+
+    setup.smooth_edges = canvas.smooth_edges && canvas.antialias == NoAA;
+    if (setup.smooth_edges) {
+        f32 Adx = -setup.Bdx - setup.Cdx;
+        f32 Ady = -setup.Bdy - setup.Cdy;
+        f32 A_length = sqrtf(Adx*Adx + Ady*Ady);
+        f32 B_length = sqrtf(setup.Bdx*setup.Bdx + setup.Bdy*setup.Bdy);
+        f32 C_length = sqrtf(setup.Cdx*setup.Cdx + setup.Cdy*setup.Cdy);
+        setup.A_scale = 1.0f / A_length;
+        setup.B_scale = 1.0f / B_length;
+        setup.C_scale = 1.0f / C_length;
+        setup.A_margin = 0.5f * A_length;
+        setup.B_margin = 0.5f * B_length;
+        setup.C_margin = 0.5f * C_length;
+    } else if (canvas.antialias == MSAA) {
+        setup.A_scale = setup.B_scale = setup.C_scale = 1.0f;
+        setup.A_margin = 0.5f * (fabsf(setup.Bdx + setup.Cdx) + fabsf(setup.Bdy + setup.Cdy));
+        setup.B_margin = 0.5f * (fabsf(setup.Bdx) + fabsf(setup.Bdy));
+        setup.C_margin = 0.5f * (fabsf(setup.Cdx) + fabsf(setup.Cdy));
+    } else {
+        setup.A_scale = setup.B_scale = setup.C_scale = 1.0f;
+        setup.A_margin = setup.B_margin = setup.C_margin = 0.0f;
+    }
 
-    f32 Cdy = -ABx * one_over_ABC;
-    f32 Bdy =  ACx * one_over_ABC;
+    return true;
+}
 
-    // Compute initial areal coordinates for the first pixel center:
-    rect.left += 0.5f;
-    rect.top += 0.5f;
-    f32 C_start = Cdx*rect.left + Cdy*rect.top + (y1*x2 - x1*y2) * one_over_ABC;
-    f32 B_start = Bdx*rect.left + Bdy*rect.top + (y3*x1 - x3*y1) * one_over_ABC;
+// Classifies a rectangle of samples (inclusive) against a triangle, the weights being linear their extremes are at its corners.
+// Returns whether any of it could be inside, and sets fully_inside when all of it is:
+INLINE bool _overlapsTriangle(const TriangleSetup &setup, i32 left, i32 right, i32 top, i32 bottom, bool &fully_inside) {
+    f32 B_min = INFINITY, B_max = -INFINITY;
+    f32 C_min = INFINITY, C_max = -INFINITY;
+    f32 A_min = INFINITY, A_max = -INFINITY;
+    for (u8 corner = 0; corner < 4; corner++) {
+        f32 x = (f32)(corner & 1 ? right : left);
+        f32 y = (f32)(corner & 2 ? bottom : top);
+        f32 B = setup.B_origin + setup.Bdx*x + setup.Bdy*y;
+        f32 C = setup.C_origin + setup.Cdx*x + setup.Cdy*y;
+        f32 A = 1 - B - C;
+        B_min = B < B_min ? B : B_min;
+        B_max = B > B_max ? B : B_max;
+        C_min = C < C_min ? C : C_min;
+        C_max = C > C_max ? C : C_max;
+        A_min = A < A_min ? A : A_min;
+        A_max = A > A_max ? A : A_max;
+    }
+    fully_inside = B_min >= setup.B_margin && C_min >= setup.C_margin && A_min >= setup.A_margin;
+    return B_max >= -setup.B_margin && C_max >= -setup.C_margin && A_max >= -setup.A_margin;
+}
 
-    f32 A, B, C;
+INLINE f32 _getEdgeCoverage(f32 distance) {
+    distance += 0.5f;
+    return distance <= 0 ? 0 : (distance >= 1 ? 1 : distance);
+}
 
-    // Scan the bounds:
-    for (u32 y = first_y; y <= last_y; y++, C_start += Cdy, B_start += Bdy) {
-        B = B_start;
-        C = C_start;
+// Blends the pixels of a block along the edges of a triangle by how much of each the triangle covers,
+// approximated by the product of how much of it each edge covers (given its distance to the pixel center):
+INLINE void _blendTriangleEdges(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                                i32 left, i32 right, i32 top, i32 bottom) {
+    for (i32 y = top; y <= bottom; y++) {
+        f32 B = setup.B_origin + setup.Bdx*(f32)left + setup.Bdy*(f32)y;
+        f32 C = setup.C_origin + setup.Cdx*(f32)left + setup.Cdy*(f32)y;
+        i32 run_start = -1; // Fully covered pixels are filled as spans
+        for (i32 x = left; x <= right; x++, B += setup.Bdx, C += setup.Cdx) {
+            f32 coverage = _getEdgeCoverage(B * setup.B_scale);
+            if (coverage > 0) coverage *= _getEdgeCoverage(C * setup.C_scale);
+            if (coverage > 0) coverage *= _getEdgeCoverage((1 - B - C) * setup.A_scale);
+            if (coverage >= 1) {
+                if (run_start < 0) run_start = x;
+                continue;
+            }
+            if (run_start >= 0) {
+                canvas.fillPixels<NoAA>(run_start, y, x - run_start, pixel);
+                run_start = -1;
+            }
+            if (coverage > 0)
+                canvas.fillPixels<NoAA>(x, y, 1, pixel * coverage);
+        }
+        if (run_start >= 0)
+            canvas.fillPixels<NoAA>(run_start, y, right - run_start + 1, pixel);
+    }
+}
 
-        for (u32 x = first_x; x <= last_x; x++, B += Bdx, C += Cdx) {
-            if (((Bdx < 0) && (B < 0)) ||
-                ((Cdx < 0) && (C < 0)))
-                break;
+// Returns a bit mask of which samples of a pixel are inside, given the weights at its center and their offsets at each sample:
+INLINE u32 _getTriangleSampleMask(f32 B, f32 C, const f32 *B_offsets, const f32 *C_offsets, u32 sample_count) {
+    u32 mask = 0;
+#ifdef SLIM_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 b = _mm_set1_ps(B);
+    __m128 c = _mm_set1_ps(C);
+    for (u32 i = 0; i < sample_count; i += 4) {
+        __m128 B_samples = _mm_add_ps(b, _mm_loadu_ps(B_offsets + i));
+        __m128 C_samples = _mm_add_ps(c, _mm_loadu_ps(C_offsets + i));
+        __m128 A_samples = _mm_sub_ps(_mm_sub_ps(one, B_samples), C_samples);
+        __m128 inside = _mm_cmpge_ps(_mm_min_ps(A_samples, _mm_min_ps(B_samples, C_samples)), zero);
+        mask |= (u32)_mm_movemask_ps(inside) << i;
+    }
+    return mask & ((1u << sample_count) - 1);
+#else
+    for (u32 i = 0; i < sample_count; i++) {
+        f32 b = B + B_offsets[i];
+        f32 c = C + C_offsets[i];
+        f32 a = 1 - b - c;
+        if (a >= 0 && b >= 0 && c >= 0) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// Covers the samples of the pixels of a block that are inside a triangle (with MSAA), filling fully covered runs as spans.
+// Pixels are first classified by their centers (given the margins) as entirely inside or outside, only the rest testing each sample:
+INLINE void _coverTriangleSamples(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                                  i32 left, i32 right, i32 top, i32 bottom) {
+    const u32 sample_count = canvas.msaa_sample_count;
+    const u32 all_samples = (1u << sample_count) - 1;
+    const f32 (*positions)[2] = getSamplePositions(sample_count);
+    f32 B_offsets[8] = {}, C_offsets[8] = {};
+    for (u32 i = 0; i < sample_count; i++) {
+        B_offsets[i] = setup.Bdx*positions[i][0] + setup.Bdy*positions[i][1];
+        C_offsets[i] = setup.Cdx*positions[i][0] + setup.Cdy*positions[i][1];
+    }
+
+    u32 columns_mask = (1u << (right - left + 1)) - 1;
+    for (i32 y = top; y <= bottom; y++) {
+        f32 B = setup.B_origin + setup.Bdx*(f32)left + setup.Bdy*(f32)y;
+        f32 C = setup.C_origin + setup.Cdx*(f32)left + setup.Cdy*(f32)y;
+        u32 touched = _getTriangleRowMask(B, C, setup.Bdx, setup.Cdx, -setup.A_margin, -setup.B_margin, -setup.C_margin) & columns_mask;
+        if (!touched)
+            continue;
+        u32 covered = _getTriangleRowMask(B, C, setup.Bdx, setup.Cdx, setup.A_margin, setup.B_margin, setup.C_margin) & touched;
+
+        i32 run_start = -1;
+        i32 i = 0;
+        for (; touched >> i; i++) {
+            u32 mask = 0;
+            if ((covered >> i) & 1)
+                mask = all_samples;
+            else if ((touched >> i) & 1)
+                mask = _getTriangleSampleMask(B + setup.Bdx*(f32)i, C + setup.Cdx*(f32)i, B_offsets, C_offsets, sample_count);
+
+            if (mask == all_samples) {
+                if (run_start < 0) run_start = i;
+                continue;
+            }
+            if (run_start >= 0) {
+                canvas.fillPixels<MSAA>(left + run_start, y, i - run_start, pixel);
+                run_start = -1;
+            }
+            if (mask)
+                canvas.coverSamples(left + i, y, mask, pixel);
+        }
+        if (run_start >= 0)
+            canvas.fillPixels<MSAA>(left + run_start, y, i - run_start, pixel);
+    }
+}
+
+// Marks the canvas tiles entirely inside of an opaque triangle and of the given (inclusive) bounds, in samples, as opaque:
+INLINE void _markOpaqueTiles(const TriangleSetup &setup, const Canvas &canvas, i32 sample_shift,
+                             i32 first_x, i32 last_x, i32 first_y, i32 last_y) {
+    const i32 tile_shift = CANVAS_TILE_SIZE_SHIFT + sample_shift;
+    const i32 last_column = (canvas.dimensions.width << sample_shift) - 1;
+    const i32 last_row = (canvas.dimensions.height << sample_shift) - 1;
+    bool fully_inside;
+    for (i32 tile_y = first_y >> tile_shift; tile_y <= (last_y >> tile_shift); tile_y++) {
+        i32 top = tile_y << tile_shift;
+        i32 bottom = clampedValue(top + (1 << tile_shift) - 1, last_row);
+        if (top < first_y || bottom > last_y) continue;
+
+        for (i32 tile_x = first_x >> tile_shift; tile_x <= (last_x >> tile_shift); tile_x++) {
+            i32 left = tile_x << tile_shift;
+            i32 right = clampedValue(left + (1 << tile_shift) - 1, last_column);
+            if (left >= first_x && right <= last_x &&
+                _overlapsTriangle(setup, left, right, top, bottom, fully_inside) && fully_inside)
+                canvas.markOpaque(RectI{left >> sample_shift, right >> sample_shift, top >> sample_shift, bottom >> sample_shift});
+        }
+    }
+}
+
+// Fills the samples of a triangle that are within the given (inclusive) clip bounds, in samples:
+template <AntiAliasing AA>
+void _rasterizeTriangle(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                        i32 clip_left, i32 clip_right, i32 clip_top, i32 clip_bottom) {
+    const i32 sample_shift = AntiAliasingLayout<AA>::sample_shift;
+    const i32 first_x = setup.first_x < clip_left ? clip_left : setup.first_x;
+    const i32 first_y = setup.first_y < clip_top  ? clip_top  : setup.first_y;
+    const i32 last_x  = clampedValue(setup.last_x, clip_right);
+    const i32 last_y  = clampedValue(setup.last_y, clip_bottom);
+    bool fully_inside;
+
+    // Scan the bounds block by block:
+    for (i32 block_top = first_y & ~(TRIANGLE_BLOCK_SIZE - 1); block_top <= last_y; block_top += TRIANGLE_BLOCK_SIZE) {
+        i32 top    = block_top < first_y ? first_y : block_top;
+        i32 bottom = clampedValue(block_top + TRIANGLE_BLOCK_SIZE - 1, last_y);
+
+        for (i32 block_left = first_x & ~(TRIANGLE_BLOCK_SIZE - 1); block_left <= last_x; block_left += TRIANGLE_BLOCK_SIZE) {
+            i32 left  = block_left < first_x ? first_x : block_left;
+            i32 right = clampedValue(block_left + TRIANGLE_BLOCK_SIZE - 1, last_x);
+            if (!_overlapsTriangle(setup, left, right, top, bottom, fully_inside))
+                continue;
 
-            A = 1 - B - C;
+            // Blocks never straddle canvas tiles:
+            canvas.markDirty(left >> sample_shift, top >> sample_shift);
 
-            // Skip the pixel if it's outside:
-            if (fminf(A, fminf(B, C)) < 0)
+            if (fully_inside) {
+                for (i32 y = top; y <= bottom; y++)
+                    canvas.fillSamples<AA>(left, y, right - left + 1, pixel);
+                continue;
+            }
+
+            if (AA == NoAA && setup.smooth_edges) {
+                _blendTriangleEdges(setup, canvas, pixel, left, right, top, bottom);
+                continue;
+            }
+            if (AA == MSAA) {
+                _coverTriangleSamples(setup, canvas, pixel, left, right, top, bottom);
                 continue;
+            }
+
+            u32 columns_mask = (1u << (right - left + 1)) - 1;
+            for (i32 y = top; y <= bottom; y++) {
+                u32 mask = _getTriangleRowMask(
+                        setup.B_origin + setup.Bdx*(f32)left + setup.Bdy*(f32)y,
+                        setup.C_origin + setup.Cdx*(f32)left + setup.Cdy*(f32)y,
+                        setup.Bdx, setup.Cdx) & columns_mask;
+
+                // Fill each run of inside samples as a span:
+                for (i32 i = 0; mask >> i; ) {
+                    if (!((mask >> i) & 1)) { i++; continue; }
+                    i32 run_start = i;
+                    while ((mask >> i) & 1) i++;
+                    canvas.fillSamples<AA>(left + run_start, y, i - run_start, pixel);
+                }
+            }
+        }
+    }
+
+    if (pixel.opacity == 1.0f && canvas.tile_max_depths)
+        _markOpaqueTiles(setup, canvas, sample_shift, first_x, last_x, first_y, last_y);
+}
+
+INLINE void _rasterizeTriangle(const TriangleSetup &setup, const Canvas &canvas, const Pixel &pixel,
+                               i32 clip_left, i32 clip_right, i32 clip_top, i32 clip_bottom) {
+    switch (canvas.antialias) {
+        case NoAA: _rasterizeTriangle<NoAA>(setup, canvas, pixel, clip_left, clip_right, clip_top, clip_bottom); break;
+        case MSAA: _rasterizeTriangle<MSAA>(setup, canvas, pixel, clip_left, clip_right, clip_top, clip_bottom); break;
+        case SSAA: _rasterizeTriangle<SSAA>(setup, canvas, pixel, clip_left, clip_right, clip_top, clip_bottom); break;
+    }
+}
+
+void _replayTriangle(const DrawCommand &command, const Canvas &canvas);
 
-            canvas.setPixel(x, y, color, opacity);
+void _fillTriangle(f32 x1, f32 y1,
+                   f32 x2, f32 y2,
+                   f32 x3, f32 y3,
+                   const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    if (canvas.display_list) {
+        RectI bounds{
+            (i32)floorf(x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3)),
+            (i32)ceilf( x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3)),
+            (i32)floorf(y1 < y2 ? (y1 < y3 ? y1 : y3) : (y2 < y3 ? y2 : y3)),
+            (i32)ceilf( y1 > y2 ? (y1 > y3 ? y1 : y3) : (y2 > y3 ? y2 : y3))
+        };
+        DrawCommand *command = canvas.record(_replayTriangle, bounds, color, opacity, viewport_bounds);
+        if (command) {
+            command->values[0] = x1;
+            command->values[1] = y1;
+            command->values[2] = x2;
+            command->values[3] = y2;
+            command->values[4] = x3;
+            command->values[5] = y3;
         }
+        return;
     }
+
+    TriangleSetup setup;
+    if (!_setupTriangle(x1, y1, x2, y2, x3, y3, canvas, viewport_bounds, setup))
+        return;
+
+    if (canvas.clip_bounds) {
+        i32 scale = canvas.antialias == SSAA ? 2 : 1;
+        const RectI &clip = *canvas.clip_bounds;
+        _rasterizeTriangle(setup, canvas, Canvas::toPixel(color, opacity),
+                           clip.left * scale, (clip.right + 1) * scale - 1, clip.top * scale, (clip.bottom + 1) * scale - 1);
+    } else
+        _rasterizeTriangle(setup, canvas, Canvas::toPixel(color, opacity),
+                           setup.first_x, setup.last_x, setup.first_y, setup.last_y);
 }
 
+void _replayTriangle(const DrawCommand &command, const Canvas &canvas) {
+    const f32 *v = command.values;
+    _fillTriangle(v[0], v[1], v[2], v[3], v[4], v[5], canvas, command.color, command.opacity, command.getViewportBounds());
+}
+
+#ifdef SLIM_VEC2
+// Batches of triangles are set up and binned into the canvas tiles they overlap in chunks (in parallel),
+// then the tiles are rasterized in parallel. Each tile gathers its triangles chunk after chunk,
+// so triangles are drawn into any tile in the order they were given in (keeping blending correct).
+// The scratch memory is shared, so batches are to be submitted from one thread at a time.
+// Binning only pays off when tiles get rasterized in parallel: With a single worker (or only a few triangles)
+// they are drawn one by one instead, as binning costs 5-10% more per triangle plus about 25us per batch on a core.
+#define TRIANGLES_PER_CHUNK 4096
+#define TRIANGLES_SCRATCH_SIZE Megabytes(64)
+#ifndef TRIANGLES_MIN_BATCH_COUNT
+#define TRIANGLES_MIN_BATCH_COUNT 256
+#endif
+
+namespace triangles {
+    memory::MonotonicAllocator scratch;
+
+    struct Batch {
+        const Canvas *canvas;
+        const vec2 *vertices;
+        const u32 *indices;
+        const Color *colors;
+        const RectI *viewport_bounds;
+        f32 opacity;
+        u32 count;
+
+        u32 tile_column_count;
+        u32 tile_count;
+        u32 chunk_count;
+        i32 tile_size; // In samples
+
+        TriangleSetup *setups;
+        u8 *is_visible;
+        u32 *bin_offsets; // Per chunk and tile: Counts, then where the chunk's triangles go in the tile's bin
+        u32 *tile_offsets; // Per tile, where its bin starts
+        u32 *bins;
+
+        INLINE u32 firstTriangle(u32 chunk) const { return chunk * TRIANGLES_PER_CHUNK; }
+        INLINE u32 endTriangle(u32 chunk) const { return chunk + 1 < chunk_count ? firstTriangle(chunk + 1) : count; }
+
+        // Calls tile_function(tile_index) for each tile overlapped by the triangle:
+        template <typename TileFunction>
+        INLINE void forEachTile(const TriangleSetup &setup, const TileFunction &tile_function) const {
+            bool fully_inside;
+            for (i32 tile_y = setup.first_y / tile_size; tile_y <= setup.last_y / tile_size; tile_y++) {
+                i32 top = tile_y * tile_size;
+                i32 bottom = clampedValue(top + tile_size - 1, setup.last_y);
+                if (top < setup.first_y) top = setup.first_y;
+
+                for (i32 tile_x = setup.first_x / tile_size; tile_x <= setup.last_x / tile_size; tile_x++) {
+                    i32 left = tile_x * tile_size;
+                    i32 right = clampedValue(left + tile_size - 1, setup.last_x);
+                    if (left < setup.first_x) left = setup.first_x;
+
+                    if (_overlapsTriangle(setup, left, right, top, bottom, fully_inside))
+                        tile_function(tile_y * tile_column_count + tile_x);
+                }
+            }
+        }
+
+        static void setupChunk(void *data, u32 chunk) {
+            Batch &batch = *(Batch*)data;
+            u32 *tile_counts = batch.bin_offsets + chunk * batch.tile_count;
+            for (u32 i = 0; i < batch.tile_count; i++) tile_counts[i] = 0;
+
+            for (u32 t = batch.firstTriangle(chunk); t < batch.endTriangle(chunk); t++) {
+                const vec2 &v1 = batch.vertices[batch.indices ? batch.indices[3 * t    ] : 3 * t    ];
+                const vec2 &v2 = batch.vertices[batch.indices ? batch.indices[3 * t + 1] : 3 * t + 1];
+                const vec2 &v3 = batch.vertices[batch.indices ? batch.indices[3 * t + 2] : 3 * t + 2];
+                TriangleSetup &setup = batch.setups[t];
+                batch.is_visible[t] = _setupTriangle(v1.x, v1.y, v2.x, v2.y, v3.x, v3.y, *batch.canvas, batch.viewport_bounds, setup);
+                if (batch.is_visible[t])
+                    batch.forEachTile(setup, [&](u32 tile) { tile_counts[tile]++; });
+            }
+        }
+
+        static void binChunk(void *data, u32 chunk) {
+            Batch &batch = *(Batch*)data;
+            u32 *bin_offsets = batch.bin_offsets + chunk * batch.tile_count;
+            for (u32 t = batch.firstTriangle(chunk); t < batch.endTriangle(chunk); t++)
+                if (batch.is_visible[t])
+                    batch.forEachTile(batch.setups[t], [&](u32 tile) { batch.bins[bin_offsets[tile]++] = t; });
+        }
+
+        void rasterizeTile(const RectI &tile) const {
+            u32 tile_index = (tile.top >> CANVAS_TILE_SIZE_SHIFT) * tile_column_count + (tile.left >> CANVAS_TILE_SIZE_SHIFT);
+            i32 scale = canvas->antialias == SSAA ? 2 : 1;
+            i32 clip_left   = tile.left * scale;
+            i32 clip_top    = tile.top  * scale;
+            i32 clip_right  = (tile.right  + 1) * scale - 1;
+            i32 clip_bottom = (tile.bottom + 1) * scale - 1;
+
+            for (u32 i = tile_offsets[tile_index]; i < tile_offsets[tile_index + 1]; i++) {
+                u32 t = bins[i];
+                _rasterizeTriangle(setups[t], *canvas, Canvas::toPixel(colors ? colors[t] : Color(White), opacity),
+                                   clip_left, clip_right, clip_top, clip_bottom);
+            }
+        }
+    };
+}
+
+// Fills count triangles, each given by 3 indices into the vertices (or by 3 consecutive vertices when there are no indices),
+// in the color given for each (or in white when there are none):
+void _fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors,
+                    const Canvas &canvas, f32 opacity, const RectI *viewport_bounds) {
+    if (!count || !vertices) return;
+
+    triangles::Batch batch;
+    batch.canvas = &canvas;
+    batch.vertices = vertices;
+    batch.indices = indices;
+    batch.colors = colors;
+    batch.viewport_bounds = viewport_bounds;
+    batch.opacity = opacity;
+    batch.count = count;
+    batch.tile_column_count = canvas.getTileColumnCount();
+    batch.tile_count = batch.tile_column_count * canvas.getTileRowCount();
+    batch.chunk_count = (count + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK;
+    batch.tile_size = canvas.antialias == SSAA ? CANVAS_TILE_SIZE * 2 : CANVAS_TILE_SIZE;
+
+    if (!jobs::queues) jobs::initialize();
+    bool one_by_one = canvas.display_list || canvas.clip_bounds || // Each gets recorded, or is clipped
+            jobs::worker_count < 2 || count < TRIANGLES_MIN_BATCH_COUNT;
+    if (!one_by_one) {
+        memory::MonotonicAllocator &scratch = triangles::scratch;
+        if (!scratch.capacity) scratch = memory::MonotonicAllocator{TRIANGLES_SCRATCH_SIZE};
+        scratch.reset();
+        batch.setups       = (TriangleSetup*)scratch.allocate(sizeof(TriangleSetup) * count);
+        batch.is_visible   = (u8*)scratch.allocate(count);
+        batch.bin_offsets  = (u32*)scratch.allocate(sizeof(u32) * batch.chunk_count * batch.tile_count);
+        batch.tile_offsets = (u32*)scratch.allocate(sizeof(u32) * (batch.tile_count + 1));
+        one_by_one = !batch.setups || !batch.is_visible || !batch.bin_offsets || !batch.tile_offsets; // Too many
+    }
+    if (one_by_one) {
+        for (u32 t = 0; t < count; t++) {
+            const vec2 &v1 = vertices[indices ? indices[3 * t    ] : 3 * t    ];
+            const vec2 &v2 = vertices[indices ? indices[3 * t + 1] : 3 * t + 1];
+            const vec2 &v3 = vertices[indices ? indices[3 * t + 2] : 3 * t + 2];
+            _fillTriangle(v1.x, v1.y, v2.x, v2.y, v3.x, v3.y, canvas, colors ? colors[t] : Color(White), opacity, viewport_bounds);
+        }
+        return;
+    }
+
+    jobs::run(triangles::Batch::setupChunk, &batch, batch.chunk_count);
+
+    // Lay the bins out tile after tile, each one chunk after chunk:
+    u32 offset = 0;
+    for (u32 tile = 0; tile < batch.tile_count; tile++) {
+        batch.tile_offsets[tile] = offset;
+        for (u32 chunk = 0; chunk < batch.chunk_count; chunk++) {
+            u32 &bin_offset = batch.bin_offsets[chunk * batch.tile_count + tile];
+            u32 tile_count = bin_offset;
+            bin_offset = offset;
+            offset += tile_count;
+        }
+    }
+    batch.tile_offsets[batch.tile_count] = offset;
+    batch.bins = (u32*)triangles::scratch.allocate(sizeof(u32) * offset);
+    if (!batch.bins) { // Too many tiles overlapped, draw them one by one:
+        for (u32 t = 0; t < count; t++)
+            if (batch.is_visible[t])
+                _rasterizeTriangle(batch.setups[t], canvas, Canvas::toPixel(colors ? colors[t] : Color(White), opacity),
+                                   batch.setups[t].first_x, batch.setups[t].last_x, batch.setups[t].first_y, batch.setups[t].last_y);
+        return;
+    }
+
+    jobs::run(triangles::Batch::binChunk, &batch, batch.chunk_count);
+
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    parallelFor2D(bounds, CANVAS_TILE_SIZE, CANVAS_TILE_SIZE, [&](const RectI &tile) { batch.rasterizeTile(tile); });
+}
+#endif
+
 
 INLINE void Canvas::drawTriangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
     _drawTriangle(x1, y1, x2, y2, x3, y3, *this, color, opacity, line_width, viewport_bounds);
@@ -164,6 +655,10 @@ INLINE void Canvas::fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Color &color,
     _fillTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, *this, color, opacity, viewport_bounds);
 }
 
+INLINE void Canvas::fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors, f32 opacity, const RectI *viewport_bounds) const {
+    _fillTriangles(vertices, indices, count, colors, *this, opacity, viewport_bounds);
+}
+
 INLINE void Canvas::drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds) const {
     _drawTriangle((f32)p1.x, (f32)p1.y, (f32)p2.x, (f32)p2.y, (f32)p3.x, (f32)p3.y, *this, color, opacity, line_width, viewport_bounds);
 }
@@ -216,6 +711,11 @@ void fillTriangle(vec2 p1, vec2 p2, vec2 p3, const Canvas &canvas,
     _fillTriangle(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, canvas, color, opacity, viewport_bounds);
 }
 
+void fillTriangles(const vec2 *vertices, const u32 *indices, u32 count, const Color *colors, const Canvas &canvas,
+                   f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _fillTriangles(vertices, indices, count, colors, canvas, opacity, viewport_bounds);
+}
+
 void drawTriangle(vec2i p1, vec2i p2, vec2i p3, const Canvas &canvas,
                   Color color = White, f32 opacity = 0.5f, u8 line_width = 0,
                   const RectI *viewport_bounds = nullptr) {
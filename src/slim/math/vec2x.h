@@ -0,0 +1,144 @@
+#pragma once
+
+#include "./mat2.h"
+#include "../core/simd.h"
+
+// Packets of 2D vectors, with their x and y components in separate lanes (structure of arrays).
+// As with the lane types (see core/simd.h), vec2x8 is for code compiled with AVX2 (or for kernel bodies shared by all widths),
+// and the methods are force-inlined so that they always end up inside such code:
+template <typename F32>
+struct vec2x {
+    static constexpr u32 width = F32::width;
+    F32 x, y;
+
+    SLIM_INLINE_KERNEL vec2x() = default;
+    SLIM_INLINE_KERNEL vec2x(const F32 &x, const F32 &y) : x{x}, y{y} {}
+    SLIM_INLINE_KERNEL explicit vec2x(const vec2 &value) : x{value.x}, y{value.y} {}
+
+    SLIM_INLINE_KERNEL static vec2x load(const f32 *xs, const f32 *ys) {
+        return {F32::load(xs), F32::load(ys)};
+    }
+
+    SLIM_INLINE_KERNEL void store(f32 *xs, f32 *ys) const {
+        x.store(xs);
+        y.store(ys);
+    }
+
+    // From and to arrays of vec2 (or any x, y pairs):
+    SLIM_INLINE_KERNEL static vec2x loadInterleaved(const f32 *values) {
+        vec2x result;
+        deinterleave(F32::load(values), F32::load(values + width), result.x, result.y);
+        return result;
+    }
+
+    SLIM_INLINE_KERNEL void storeInterleaved(f32 *values) const {
+        F32 first, second;
+        interleave(x, y, first, second);
+        first.store(values);
+        second.store(values + width);
+    }
+
+    SLIM_INLINE_KERNEL vec2x operator + (const vec2x &rhs) const { return {x + rhs.x, y + rhs.y}; }
+    SLIM_INLINE_KERNEL vec2x operator - (const vec2x &rhs) const { return {x - rhs.x, y - rhs.y}; }
+    SLIM_INLINE_KERNEL vec2x operator * (const vec2x &rhs) const { return {x * rhs.x, y * rhs.y}; }
+    SLIM_INLINE_KERNEL vec2x operator * (const F32 &rhs) const { return {x * rhs, y * rhs}; }
+    SLIM_INLINE_KERNEL vec2x operator / (const F32 &rhs) const { return {x / rhs, y / rhs}; }
+
+    SLIM_INLINE_KERNEL F32 dot(const vec2x &rhs) const {
+        return (x * rhs.x) + (y * rhs.y);
+    }
+
+    SLIM_INLINE_KERNEL F32 cross(const vec2x &rhs) const {
+        return (x * rhs.y) - (y * rhs.x);
+    }
+
+    SLIM_INLINE_KERNEL F32 squaredLength() const {
+        return x*x + y*y;
+    }
+
+    SLIM_INLINE_KERNEL F32 length() const {
+        return sqrt(squaredLength());
+    }
+
+    SLIM_INLINE_KERNEL vec2x normalized() const {
+        return *this / length();
+    }
+
+    // Through reciprocal square roots, approximated and refined (see refinedRsqrt()) instead of divided by:
+    SLIM_INLINE_KERNEL F32 approxLength() const {
+        F32 squared_length = squaredLength();
+        return squared_length * refinedRsqrt(squared_length);
+    }
+
+    SLIM_INLINE_KERNEL vec2x approxNormalized() const {
+        return *this * refinedRsqrt(squaredLength());
+    }
+
+    // Rotated as by a mat2 set to the rotation (see mat2::setRotation()), given the cosine and sine of the angle per lane:
+    SLIM_INLINE_KERNEL vec2x rotated(const F32 &cos_angle, const F32 &sin_angle) const {
+        return {
+                x*cos_angle + y*sin_angle,
+                y*cos_angle - x*sin_angle
+        };
+    }
+
+    SLIM_INLINE_KERNEL vec2x rotated(f32 angle) const {
+        return rotated(F32{cosf(angle)}, F32{sinf(angle)});
+    }
+
+    SLIM_INLINE_KERNEL vec2x lerpTo(const vec2x &to, const F32 &by) const {
+        return (to - *this) * by + *this;
+    }
+
+    // Transformed as by mat2::operator*, then translated:
+    SLIM_INLINE_KERNEL vec2x transformed(const vec2x &X, const vec2x &Y, const vec2x &translation) const {
+        return X*x + Y*y + translation;
+    }
+};
+
+typedef vec2x<f32x4> vec2x4;
+typedef vec2x<f32x8> vec2x8;
+
+template <typename F32>
+SLIM_INLINE_KERNEL vec2x<F32> lerp(const vec2x<F32> &from, const vec2x<F32> &to, const F32 &by) {
+    return from.lerpTo(to, by);
+}
+
+// Bulk transforms of arrays of points (which may be transformed in place), in packets of the widest width the CPU has:
+void _transformPointsScalar(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    for (u32 i = 0; i < count; i++) out[i] = matrix * in[i] + translation;
+}
+
+template <typename F32>
+SLIM_INLINE_KERNEL u32 _transformPointsWide(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    const vec2x<F32> X{matrix.X}, Y{matrix.Y}, T{translation};
+    u32 i = 0;
+    for (; i + F32::width <= count; i += F32::width)
+        vec2x<F32>::loadInterleaved(&in[i].x).transformed(X, Y, T).storeInterleaved(&out[i].x);
+    return i;
+}
+
+#ifdef SLIM_SSE2
+void _transformPointsSSE2(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    u32 i = _transformPointsWide<f32x4>(matrix, translation, in, out, count);
+    if (i < count) _transformPointsScalar(matrix, translation, in + i, out + i, count - i);
+}
+#endif
+
+#ifdef SLIM_AVX2
+SLIM_TARGET_AVX2 void _transformPointsAVX2(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    u32 i = _transformPointsWide<f32x8>(matrix, translation, in, out, count);
+    if (i < count) _transformPointsSSE2(matrix, translation, in + i, out + i, count - i);
+}
+#endif
+
+typedef void (*TransformPointsKernel)(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count);
+TransformPointsKernel transform_points_kernel = selectKernel<TransformPointsKernel>(
+        _transformPointsScalar,
+        SIMD_SSE2_KERNEL(_transformPointsSSE2),
+        SIMD_AVX2_KERNEL(_transformPointsAVX2));
+
+// Gives the same results as transforming each point with mat2::operator* and adding the translation:
+INLINE void transformPoints(const mat2 &matrix, const vec2 &translation, const vec2 *in, vec2 *out, u32 count) {
+    transform_points_kernel(matrix, translation, in, out, count);
+}
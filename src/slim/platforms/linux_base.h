@@ -0,0 +1,168 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "../core/base.h"
+
+#ifndef NDEBUG
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+void DisplayError(const char *function_name) {
+    printf("ERROR: %s failed with error code %d as follows:\n%s\n", function_name, errno, strerror(errno));
+}
+#endif
+
+// File descriptors are stored off-by-one in the opaque handle, so that descriptor 0 is never a null handle:
+#define LINUX_FILE_HANDLE(fd) ((void*)(long)((fd) + 1))
+#define LINUX_FILE_DESCRIPTOR(handle) ((int)((long)(handle) - 1))
+
+void linux_closeFile(void *handle) {
+    close(LINUX_FILE_DESCRIPTOR(handle));
+}
+
+void* linux_openFileForReading(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+#ifndef NDEBUG
+        DisplayError("open");
+        printf("Terminal failure: unable to open file \"%s\" for read.\n", path);
+#endif
+        return nullptr;
+    }
+    return LINUX_FILE_HANDLE(fd);
+}
+
+void* linux_openFileForWriting(const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+#ifndef NDEBUG
+        DisplayError("open");
+        printf("Terminal failure: unable to open file \"%s\" for write.\n", path);
+#endif
+        return nullptr;
+    }
+    return LINUX_FILE_HANDLE(fd);
+}
+
+bool linux_readFromFile(void *out, unsigned long size, void *handle) {
+    int fd = LINUX_FILE_DESCRIPTOR(handle);
+    u8 *bytes = (u8*)out;
+    while (size) { // A single read may return less than requested, reaching the end of the file is not an error:
+        ssize_t bytes_read = read(fd, bytes, size);
+        if (bytes_read == 0) break;
+        if (bytes_read < 0) {
+#ifndef NDEBUG
+            DisplayError("read");
+            printf("Terminal failure: Unable to read from file.\n");
+#endif
+            return false;
+        }
+        bytes += bytes_read;
+        size -= (unsigned long)bytes_read;
+    }
+    return true;
+}
+
+bool linux_writeToFile(void *out, unsigned long size, void *handle) {
+    int fd = LINUX_FILE_DESCRIPTOR(handle);
+    u8 *bytes = (u8*)out;
+    while (size) {
+        ssize_t bytes_written = write(fd, bytes, size);
+        if (bytes_written <= 0) {
+#ifndef NDEBUG
+            DisplayError("write");
+            printf("Terminal failure: Unable to write to file.\n");
+#endif
+            return false;
+        }
+        bytes += bytes_written;
+        size -= (unsigned long)bytes_written;
+    }
+    return true;
+}
+
+timespec performance_counter;
+
+u64 timers::getTicks() {
+    clock_gettime(CLOCK_MONOTONIC, &performance_counter);
+    return (u64)performance_counter.tv_sec * 1000000000ULL + (u64)performance_counter.tv_nsec;
+}
+
+void initTimers() {
+    timers::ticks_per_second = 1000000000ULL;
+    timers::seconds_per_tick = 1.0 / (f64)(timers::ticks_per_second);
+    timers::milliseconds_per_tick = 1000.0 * timers::seconds_per_tick;
+    timers::microseconds_per_tick = 1000.0 * timers::milliseconds_per_tick;
+    timers::nanoseconds_per_tick  = 1000.0 * timers::microseconds_per_tick;
+}
+
+void* os::getMemory(u64 size, u64 base) {
+    // The base address is only a hint here (as opposed to a requirement), pages are committed on first touch:
+    void *address = mmap((void*)base, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+}
+
+struct LinuxThreadStart {
+    os::ThreadFunction thread_function;
+    void *parameter;
+};
+#define MAX_THREAD_COUNT 256
+LinuxThreadStart linux_thread_starts[MAX_THREAD_COUNT];
+u32 linux_thread_count = 0;
+
+void* linux_threadProc(void *thread_start) {
+    ((LinuxThreadStart*)thread_start)->thread_function(((LinuxThreadStart*)thread_start)->parameter);
+    return nullptr;
+}
+
+u32 os::getCoreCount() {
+    long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return core_count > 0 ? (u32)core_count : 1;
+}
+
+bool os::createThread(ThreadFunction thread_function, void *parameter) {
+    if (linux_thread_count == MAX_THREAD_COUNT) return false;
+    LinuxThreadStart *thread_start = linux_thread_starts + linux_thread_count;
+    thread_start->thread_function = thread_function;
+    thread_start->parameter = parameter;
+
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    bool created = pthread_create(&thread, &attributes, linux_threadProc, thread_start) == 0;
+    pthread_attr_destroy(&attributes);
+    if (created) linux_thread_count++;
+    return created;
+}
+
+void* os::createSemaphore(u32 initial_count) {
+    sem_t *semaphore = (sem_t*)getMemory(sizeof(sem_t));
+    if (semaphore && sem_init(semaphore, 0, initial_count) != 0) {
+        munmap(semaphore, sizeof(sem_t));
+        return nullptr;
+    }
+    return semaphore;
+}
+
+void os::signalSemaphore(void *semaphore, u32 count) {
+    for (u32 i = 0; i < count; i++) sem_post((sem_t*)semaphore);
+}
+
+void os::waitForSemaphore(void *semaphore) {
+    while (sem_wait((sem_t*)semaphore) != 0); // Retry when interrupted by a signal
+}
+
+void os::closeFile(void *handle) { return linux_closeFile(handle); }
+void* os::openFileForReading(const char* path) { return linux_openFileForReading(path); }
+void* os::openFileForWriting(const char* path) { return linux_openFileForWriting(path); }
+bool os::readFromFile(void *out, unsigned long size, void *handle) { return linux_readFromFile(out, size, handle); }
+bool os::writeToFile(void *out, unsigned long size, void *handle) { return linux_writeToFile(out, size, handle); }
@@ -0,0 +1,117 @@
+#include "./linux_base.h"
+#include "../serialization/image.h"
+#include "../app.h"
+
+// Renders into an offscreen window content buffer without a display server.
+// Defaults can be overridden at compile time or from the command line:
+//   -w <width> -h <height> -f <frame count> -o <file path to save the last frame into, as a byte color image>
+#ifndef HEADLESS_FRAME_COUNT
+#define HEADLESS_FRAME_COUNT 100
+#endif
+
+SlimApp *CURRENT_APP;
+
+void os::setWindowTitle(char* str) {
+    window::title = str;
+}
+
+void os::setCursorVisibility(bool) {}
+void os::setWindowCapture(bool) {}
+
+u32 parseNumber(const char *str) {
+    u32 number = 0;
+    while (*str >= '0' && *str <= '9') number = number * 10 + (u32)(*(str++) - '0');
+    return number;
+}
+
+void printLine(char *title, char *text) {
+    write(STDOUT_FILENO, title, String::getLength(title));
+    write(STDOUT_FILENO, text, String::getLength(text));
+    write(STDOUT_FILENO, "\n", 1);
+}
+
+void printLine(char *title, i32 value) {
+    NumberString number;
+    number = value;
+    write(STDOUT_FILENO, title, String::getLength(title));
+    write(STDOUT_FILENO, number.string.char_ptr, number.string.length);
+    write(STDOUT_FILENO, "\n", 1);
+}
+
+int main(int argc, char *argv[]) {
+    void* window_content_and_canvas_memory = os::getMemory(WINDOW_CONTENT_SIZE + (CANVAS_SIZE * CANVAS_COUNT));
+    if (!window_content_and_canvas_memory)
+        return -1;
+
+    window::content = (u32*)window_content_and_canvas_memory;
+    memory::canvas_memory = (u8*)window_content_and_canvas_memory + WINDOW_CONTENT_SIZE;
+
+    initTimers();
+
+    CURRENT_APP = createApp();
+    if (!CURRENT_APP->is_running)
+        return -1;
+
+    u32 width = window::width;
+    u32 height = window::height;
+    u32 frame_count = HEADLESS_FRAME_COUNT;
+    char *output_file_path = nullptr;
+    for (int i = 1; i < argc - 1; i++) {
+        if (argv[i][0] != '-') continue;
+        switch (argv[i][1]) {
+            case 'w': width = parseNumber(argv[++i]); break;
+            case 'h': height = parseNumber(argv[++i]); break;
+            case 'f': frame_count = parseNumber(argv[++i]); break;
+            case 'o': output_file_path = argv[++i]; break;
+            default: break;
+        }
+    }
+    if (width < 1 || width > MAX_WIDTH) width = width ? MAX_WIDTH : 1;
+    if (height < 1 || height > MAX_HEIGHT) height = height ? MAX_HEIGHT : 1;
+
+    CURRENT_APP->resize((u16)width, (u16)height);
+
+    u64 ticks_before = timers::getTicks();
+    u32 frame = 0;
+    f64 presented_fraction = 0;
+    for (; frame < frame_count && CURRENT_APP->is_running; frame++) {
+        CURRENT_APP->OnWindowRedraw();
+        mouse::resetChanges();
+
+        // Nothing to present to, but keep track of how much of the window would have been presented:
+        u32 presented_area = (u32)window::width * (u32)window::height;
+        if (window::present_partially) {
+            presented_area = 0;
+            for (u32 i = 0; i < window::dirty_rect_count; i++) {
+                RectI &rect = window::dirty_rects[i];
+                presented_area += (u32)(rect.right - rect.left + 1) * (u32)(rect.bottom - rect.top + 1);
+            }
+        }
+        presented_fraction += (f64)presented_area / ((f64)window::width * (f64)window::height);
+        window::present_partially = false;
+        window::dirty_rect_count = 0;
+    }
+    u64 ticks_after = timers::getTicks();
+
+    f64 total_milliseconds = timers::milliseconds_per_tick * (f64)(ticks_after - ticks_before);
+    printLine((char*)"Frames         : ", (i32)frame);
+    printLine((char*)"Total ms       : ", (i32)total_milliseconds);
+    if (window::title && *window::title)
+        printLine((char*)"Window title   : ", window::title);
+    if (frame) {
+        printLine((char*)"Frame us (avg) : ", (i32)(1000.0 * total_milliseconds / (f64)frame));
+        printLine((char*)"Presented %    : ", (i32)(100.0 * presented_fraction / (f64)frame));
+        if (total_milliseconds > 0.0)
+            printLine((char*)"Frames/second  : ", (i32)(1000.0 * (f64)frame / total_milliseconds));
+    }
+
+    if (output_file_path) {
+        ByteColorImage image;
+        image.updateDimensions(window::width, window::height);
+        image.content = (ByteColor*)window::content;
+        if (!save(image, output_file_path))
+            return -1;
+    }
+
+    return 0;
+}
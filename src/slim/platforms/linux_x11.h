@@ -0,0 +1,391 @@
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "./linux_base.h"
+#include "../app.h"
+
+// Key codes are the same as the virtual-key codes of the Win32 platform layer, so apps see identical values:
+#define X11_KEY_BACKSPACE 0x08
+#define X11_KEY_TAB       0x09
+#define X11_KEY_ENTER     0x0D
+#define X11_KEY_SHIFT     0x10
+#define X11_KEY_CONTROL   0x11
+#define X11_KEY_ALT       0x12
+#define X11_KEY_ESCAPE    0x1B
+#define X11_KEY_SPACE     0x20
+#define X11_KEY_LEFT      0x25
+#define X11_KEY_UP        0x26
+#define X11_KEY_RIGHT     0x27
+#define X11_KEY_DOWN      0x28
+#define X11_KEY_F1        0x70
+
+#define X11_DOUBLE_CLICK_TIME 500
+
+Display *display;
+Window window_handle;
+GC graphics_context;
+Visual *visual;
+int screen, depth;
+Atom wm_delete_window;
+Cursor invisible_cursor;
+XImage *window_image{nullptr};
+XShmSegmentInfo shm_info;
+int shm_completion_event_type;
+bool shm_available{false};
+bool shm_put_pending{false};
+bool expose_pending{false}; // Exposed while a put was pending, so the next present covers the whole window
+bool shm_attach_failed{false};
+
+SlimApp *CURRENT_APP;
+
+void os::setWindowTitle(char* str) {
+    window::title = str;
+    XStoreName(display, window_handle, str);
+}
+
+void os::setCursorVisibility(bool on) {
+    if (on) XUndefineCursor(display, window_handle);
+    else XDefineCursor(display, window_handle, invisible_cursor);
+}
+
+void os::setWindowCapture(bool on) {
+    if (on) XGrabPointer(display, window_handle, False,
+                         ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
+                         GrabModeAsync, GrabModeAsync, None, None, CurrentTime);
+    else XUngrabPointer(display, CurrentTime);
+}
+
+u8 translateKey(KeySym key_sym) {
+    if (key_sym >= XK_a && key_sym <= XK_z) return (u8)('A' + (key_sym - XK_a));
+    if (key_sym >= XK_A && key_sym <= XK_Z) return (u8)('A' + (key_sym - XK_A));
+    if (key_sym >= XK_0 && key_sym <= XK_9) return (u8)('0' + (key_sym - XK_0));
+    if (key_sym >= XK_F1 && key_sym <= XK_F12) return (u8)(X11_KEY_F1 + (key_sym - XK_F1));
+    switch (key_sym) {
+        case XK_Control_L: case XK_Control_R: return X11_KEY_CONTROL;
+        case XK_Alt_L: case XK_Alt_R: case XK_Meta_L: case XK_Meta_R: return X11_KEY_ALT;
+        case XK_Shift_L: case XK_Shift_R: return X11_KEY_SHIFT;
+        case XK_space    : return X11_KEY_SPACE;
+        case XK_Tab      : return X11_KEY_TAB;
+        case XK_Escape   : return X11_KEY_ESCAPE;
+        case XK_Left     : return X11_KEY_LEFT;
+        case XK_Right    : return X11_KEY_RIGHT;
+        case XK_Up       : return X11_KEY_UP;
+        case XK_Down     : return X11_KEY_DOWN;
+        case XK_Return   : return X11_KEY_ENTER;
+        case XK_BackSpace: return X11_KEY_BACKSPACE;
+        default: return 0;
+    }
+}
+
+bool createWindowImage(u16 width, u16 height) {
+    if (window_image) {
+        window_image->data = nullptr; // The content is owned by the platform layer, not the image
+        XDestroyImage(window_image);
+    }
+
+    // Both image kinds wrap window::content directly, so drawing to the window needs no intermediate copy:
+    if (shm_available)
+        window_image = XShmCreateImage(display, visual, depth, ZPixmap, (char*)window::content, &shm_info, width, height);
+    else
+        window_image = XCreateImage(display, visual, depth, ZPixmap, 0, (char*)window::content, width, height, 32, 0);
+
+    return window_image != nullptr;
+}
+
+void handleEvent(XEvent &event);
+
+void waitForPresent() {
+    // The X server reads window::content asynchronously, so it must not be written into until it is done:
+    XEvent event;
+    while (shm_put_pending) {
+        XNextEvent(display, &event);
+        handleEvent(event);
+    }
+}
+
+void presentWindowRect(i32 x, i32 y, u32 width, u32 height, bool is_last) {
+    if (shm_available) {
+        // Only the last put asks for a completion event, the X server processes requests in order:
+        XShmPutImage(display, window_handle, graphics_context, window_image, x, y, x, y, width, height, is_last);
+        if (is_last) shm_put_pending = true;
+    } else
+        XPutImage(display, window_handle, graphics_context, window_image, x, y, x, y, width, height);
+}
+
+void presentWindowContent(bool whole_window = false) {
+    if (!window_image) return;
+    if (expose_pending) {
+        expose_pending = false;
+        whole_window = true;
+    }
+    if (window::present_partially && !whole_window) {
+        for (u32 i = 0; i < window::dirty_rect_count; i++) {
+            RectI &rect = window::dirty_rects[i];
+            presentWindowRect(rect.left, rect.top, rect.right - rect.left + 1, rect.bottom - rect.top + 1, i + 1 == window::dirty_rect_count);
+        }
+    } else
+        presentWindowRect(0, 0, window::width, window::height, true);
+
+    window::present_partially = false;
+    window::dirty_rect_count = 0;
+    XFlush(display);
+}
+
+void resizeWindow(u16 width, u16 height) {
+    if (width > MAX_WIDTH) width = MAX_WIDTH;
+    if (height > MAX_HEIGHT) height = MAX_HEIGHT;
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (window_image && width == window::width && height == window::height)
+        return;
+
+    waitForPresent();
+    createWindowImage(width, height);
+    CURRENT_APP->resize(width, height);
+}
+
+mouse::Button* getMouseButton(unsigned int button) {
+    switch (button) {
+        case Button1: return &mouse::left_button;
+        case Button2: return &mouse::middle_button;
+        case Button3: return &mouse::right_button;
+        default: return nullptr;
+    }
+}
+
+void handleEvent(XEvent &event) {
+    static Time last_click_time[3]{0, 0, 0};
+    mouse::Button *mouse_button;
+    bool pressed;
+    i32 x, y;
+    u8 key;
+
+    switch (event.type) {
+        case ClientMessage:
+            if ((Atom)event.xclient.data.l[0] == wm_delete_window)
+                CURRENT_APP->is_running = false;
+            break;
+
+        case ConfigureNotify:
+            resizeWindow((u16)event.xconfigure.width, (u16)event.xconfigure.height);
+            break;
+
+        case Expose:
+            if (event.xexpose.count == 0) {
+                if (shm_put_pending) expose_pending = true;
+                else presentWindowContent(true);
+            }
+            break;
+
+        case KeyPress:
+        case KeyRelease:
+            pressed = event.type == KeyPress;
+            key = translateKey(XLookupKeysym(&event.xkey, 0));
+            if (!key) break;
+            switch (key) {
+                case X11_KEY_CONTROL: controls::is_pressed::ctrl   = pressed; break;
+                case X11_KEY_ALT    : controls::is_pressed::alt    = pressed; break;
+                case X11_KEY_SHIFT  : controls::is_pressed::shift  = pressed; break;
+                case X11_KEY_SPACE  : controls::is_pressed::space  = pressed; break;
+                case X11_KEY_TAB    : controls::is_pressed::tab    = pressed; break;
+                case X11_KEY_ESCAPE : controls::is_pressed::escape = pressed; break;
+                case X11_KEY_LEFT   : controls::is_pressed::left   = pressed; break;
+                case X11_KEY_RIGHT  : controls::is_pressed::right  = pressed; break;
+                case X11_KEY_UP     : controls::is_pressed::up     = pressed; break;
+                case X11_KEY_DOWN   : controls::is_pressed::down   = pressed; break;
+                default: break;
+            }
+            CURRENT_APP->OnKeyChanged(key, pressed);
+            break;
+
+        case ButtonPress:
+        case ButtonRelease:
+            x = event.xbutton.x;
+            y = event.xbutton.y;
+            if (event.xbutton.button == Button4 || event.xbutton.button == Button5) {
+                if (event.type == ButtonPress) {
+                    f32 scroll_amount = event.xbutton.button == Button4 ? 1.0f : -1.0f;
+                    mouse::scroll(scroll_amount); CURRENT_APP->OnMouseWheelScrolled(scroll_amount);
+                }
+                break;
+            }
+            mouse_button = getMouseButton(event.xbutton.button);
+            if (!mouse_button) break;
+
+            if (event.type == ButtonRelease) {
+                mouse_button->up(x, y);
+                CURRENT_APP->OnMouseButtonUp(*mouse_button);
+            } else {
+                // X has no double-click events, so a quick second press is reported as one (like on Win32):
+                Time &last_time = last_click_time[event.xbutton.button - Button1];
+                if (last_time && (event.xbutton.time - last_time) < X11_DOUBLE_CLICK_TIME) {
+                    last_time = 0;
+                    mouse_button->doubleClick(x, y);
+                    mouse::double_clicked = true;
+                    CURRENT_APP->OnMouseButtonDoubleClicked(*mouse_button);
+                } else {
+                    last_time = event.xbutton.time;
+                    mouse_button->down(x, y);
+                    CURRENT_APP->OnMouseButtonDown(*mouse_button);
+                }
+            }
+            break;
+
+        case MotionNotify:
+            x = event.xmotion.x;
+            y = event.xmotion.y;
+            // Without XInput2 there is no raw input, so relative movement is derived from pointer motion:
+            if (x != mouse::pos_x || y != mouse::pos_y) {
+                mouse::moveRaw(x - mouse::pos_x, y - mouse::pos_y);
+                CURRENT_APP->OnMouseRawMovementSet(x - mouse::pos_x, y - mouse::pos_y);
+            }
+            mouse::move(x, y);        CURRENT_APP->OnMouseMovementSet(x, y);
+            mouse::setPosition(x, y); CURRENT_APP->OnMousePositionSet(x, y);
+            break;
+
+        default:
+            if (event.type == shm_completion_event_type)
+                shm_put_pending = false;
+            break;
+    }
+}
+
+// Errors of attaching (as BadAccess on remote displays) are only recorded, as Xlib's default handler would exit:
+int onSharedMemoryAttachError(Display*, XErrorEvent*) {
+    shm_attach_failed = true;
+    return 0;
+}
+
+bool attachSharedMemory() {
+    if (!XShmQueryExtension(display))
+        return false;
+
+    shm_info.shmid = shmget(IPC_PRIVATE, WINDOW_CONTENT_SIZE, IPC_CREAT | 0600);
+    if (shm_info.shmid == -1)
+        return false;
+
+    shm_info.shmaddr = (char*)shmat(shm_info.shmid, nullptr, 0);
+    if (shm_info.shmaddr == (char*)-1) {
+        shmctl(shm_info.shmid, IPC_RMID, nullptr);
+        return false;
+    }
+    shm_info.readOnly = False;
+
+    shm_attach_failed = false;
+    XErrorHandler previous_error_handler = XSetErrorHandler(onSharedMemoryAttachError);
+    bool attached = XShmAttach(display, &shm_info) != 0;
+    XSync(display, False);
+    XSetErrorHandler(previous_error_handler);
+    if (shm_attach_failed)
+        attached = false;
+
+    // Mark the segment for removal now, so it is released when both the app and the server detach from it:
+    shmctl(shm_info.shmid, IPC_RMID, nullptr);
+    if (!attached) {
+        shmdt(shm_info.shmaddr);
+        return false;
+    }
+
+    window::content = (u32*)shm_info.shmaddr;
+    shm_completion_event_type = XShmGetEventBase(display) + ShmCompletion;
+    return true;
+}
+
+int main(int, char*[]) {
+    display = XOpenDisplay(nullptr);
+    if (!display)
+        return -1;
+
+    screen = DefaultScreen(display);
+    visual = DefaultVisual(display, screen);
+    depth = DefaultDepth(display, screen);
+    if (depth < 24) // Window content is 32-bit BGRX
+        return -1;
+    shm_completion_event_type = -1;
+
+    shm_available = attachSharedMemory();
+    if (!shm_available) {
+        window::content = (u32*)os::getMemory(WINDOW_CONTENT_SIZE);
+        if (!window::content)
+            return -1;
+    }
+    memory::canvas_memory = (u8*)os::getMemory(CANVAS_SIZE * CANVAS_COUNT);
+    if (!memory::canvas_memory)
+        return -1;
+
+    controls::key_map::ctrl = X11_KEY_CONTROL;
+    controls::key_map::alt = X11_KEY_ALT;
+    controls::key_map::shift = X11_KEY_SHIFT;
+    controls::key_map::space = X11_KEY_SPACE;
+    controls::key_map::tab = X11_KEY_TAB;
+    controls::key_map::escape = X11_KEY_ESCAPE;
+    controls::key_map::left = X11_KEY_LEFT;
+    controls::key_map::right = X11_KEY_RIGHT;
+    controls::key_map::up = X11_KEY_UP;
+    controls::key_map::down = X11_KEY_DOWN;
+
+    initTimers();
+
+    CURRENT_APP = createApp();
+    if (!CURRENT_APP->is_running)
+        return -1;
+
+    XSetWindowAttributes attributes;
+    attributes.background_pixel = BlackPixel(display, screen);
+    attributes.event_mask = ExposureMask | StructureNotifyMask |
+                            KeyPressMask | KeyReleaseMask |
+                            ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+    window_handle = XCreateWindow(display, RootWindow(display, screen),
+                                  0, 0, window::width, window::height, 0,
+                                  depth, InputOutput, visual,
+                                  CWBackPixel | CWEventMask, &attributes);
+    if (!window_handle)
+        return -1;
+
+    XStoreName(display, window_handle, window::title);
+    wm_delete_window = XInternAtom(display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(display, window_handle, &wm_delete_window, 1);
+
+    // Have key repeats arrive as repeated presses without releases in between (like on Win32):
+    XkbSetDetectableAutoRepeat(display, True, nullptr);
+
+    char no_data[8]{};
+    XColor black{};
+    Pixmap blank = XCreateBitmapFromData(display, window_handle, no_data, 8, 8);
+    invisible_cursor = XCreatePixmapCursor(display, blank, blank, &black, &black, 0, 0);
+    XFreePixmap(display, blank);
+
+    graphics_context = XCreateGC(display, window_handle, 0, nullptr);
+    XMapWindow(display, window_handle);
+
+    resizeWindow(window::width, window::height);
+
+    XEvent event;
+    while (CURRENT_APP->is_running) {
+        while (XPending(display)) {
+            XNextEvent(display, &event);
+            handleEvent(event);
+        }
+        if (!CURRENT_APP->is_running)
+            break;
+
+        waitForPresent();
+        CURRENT_APP->OnWindowRedraw();
+        mouse::resetChanges();
+        presentWindowContent();
+    }
+
+    waitForPresent();
+    if (shm_available) {
+        XShmDetach(display, &shm_info);
+        shmdt(shm_info.shmaddr);
+    }
+    XCloseDisplay(display);
+
+    return 0;
+}
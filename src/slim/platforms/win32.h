@@ -34,6 +34,17 @@ inline bool hasRawMouseInput(LPARAM lParam) {
 
 SlimApp *CURRENT_APP;
 
+void presentWindowRect(const RectI &rect) {
+    // Presented as a DIB of only the rows covered, so that the source offset does not depend on the DIB orientation:
+    BITMAPINFO rows_info = info;
+    i32 rows = rect.bottom - rect.top + 1;
+    rows_info.bmiHeader.biHeight = -rows;
+    SetDIBitsToDevice(win_dc,
+                      rect.left, rect.top, rect.right - rect.left + 1, rows,
+                      rect.left, 0, 0, rows,
+                      (u32*)window::content + window::width * rect.top, &rows_info, DIB_RGB_COLORS);
+}
+
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
     bool pressed = message == WM_SYSKEYDOWN || message == WM_KEYDOWN;
     u8 key = (u8)wParam;
@@ -252,7 +263,13 @@ int APIENTRY WinMain(HINSTANCE hInstance,
         }
         CURRENT_APP->OnWindowRedraw();
         mouse::resetChanges();
-        InvalidateRgn(window_handle, nullptr, false);
+        if (window::present_partially) {
+            for (u32 i = 0; i < window::dirty_rect_count; i++)
+                presentWindowRect(window::dirty_rects[i]);
+            window::present_partially = false;
+            window::dirty_rect_count = 0;
+        } else
+            InvalidateRgn(window_handle, nullptr, false);
     }
 
     return 0;
@@ -130,6 +130,50 @@ void* os::getMemory(u64 size, u64 base) {
     return VirtualAlloc((LPVOID)base, (SIZE_T)size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
 }
 
+struct Win32ThreadStart {
+    os::ThreadFunction thread_function;
+    void *parameter;
+};
+#define MAX_THREAD_COUNT 256
+Win32ThreadStart win32_thread_starts[MAX_THREAD_COUNT];
+u32 win32_thread_count = 0;
+
+DWORD WINAPI win32_threadProc(LPVOID thread_start) {
+    ((Win32ThreadStart*)thread_start)->thread_function(((Win32ThreadStart*)thread_start)->parameter);
+    return 0;
+}
+
+u32 os::getCoreCount() {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return (u32)system_info.dwNumberOfProcessors;
+}
+
+bool os::createThread(ThreadFunction thread_function, void *parameter) {
+    if (win32_thread_count == MAX_THREAD_COUNT) return false;
+    Win32ThreadStart *thread_start = win32_thread_starts + win32_thread_count;
+    thread_start->thread_function = thread_function;
+    thread_start->parameter = parameter;
+
+    HANDLE thread = CreateThread(nullptr, 0, win32_threadProc, thread_start, 0, nullptr);
+    if (!thread) return false;
+    CloseHandle(thread);
+    win32_thread_count++;
+    return true;
+}
+
+void* os::createSemaphore(u32 initial_count) {
+    return CreateSemaphoreA(nullptr, (LONG)initial_count, MAXLONG, nullptr);
+}
+
+void os::signalSemaphore(void *semaphore, u32 count) {
+    if (count) ReleaseSemaphore(semaphore, (LONG)count, nullptr);
+}
+
+void os::waitForSemaphore(void *semaphore) {
+    WaitForSingleObject(semaphore, INFINITE);
+}
+
 void os::closeFile(void *handle) { return win32_closeFile(handle); }
 void* os::openFileForReading(const char* path) { return win32_openFileForReading(path); }
 void* os::openFileForWriting(const char* path) { return win32_openFileForWriting(path); }
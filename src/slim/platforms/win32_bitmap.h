@@ -9,6 +9,7 @@
 #endif
 
 #include "./win32_base.h"
+#include "../core/color_pipeline.h"
 
 u8* componentsToByteColor(u8 *component, ByteColor &byte_color, ImageInfo &info) {
     byte_color.B = *(component++);
@@ -22,22 +23,22 @@ u8* componentsToByteColor(u8 *component, ByteColor &byte_color, ImageInfo &info)
     return component;
 }
 
-u8* componentsToPixel(u8 *component, Pixel *pixel, ImageInfo &info, f32 gamma = 2.2f) {
-    ByteColor byte_color;
-    component = componentsToByteColor(component, byte_color, info);
+// Bytes are decoded through a table of the 256 values the gamma maps them to (see ColorDecodeTable):
+u8* componentsToPixel(u8 *component, Pixel *pixel, ImageInfo &info, const ColorDecodeTable &decode) {
+    decodeColorComponents(component, pixel, 1, info.flags.alpha, decode);
+    return component + (info.flags.alpha ? 4 : 3);
+}
 
-    *pixel = byte_color;
-    if (!info.flags.linear) pixel->color.applyGamma(gamma);
+INLINE ColorDecodeTable getColorDecodeTable(ImageInfo &info, f32 gamma) {
+    return info.flags.linear ? ColorDecodeTable{ColorSpaceLinear} : ColorDecodeTable{gamma};
+}
 
-    return component;
+u8* componentsToPixel(u8 *component, Pixel *pixel, ImageInfo &info, f32 gamma = 2.2f) {
+    return componentsToPixel(component, pixel, info, getColorDecodeTable(info, gamma));
 }
 
 void componentsToPixels(u8 *components, ImageInfo &info, Pixel *pixels, f32 gamma = 2.2f) {
-    Pixel* pixel = pixels;
-    u8 *component = components;
-    u32 count = info.width * info.height;
-    for (u32 i = 0; i < count; i++, pixel++)
-        component = componentsToPixel(component, pixel, info, gamma);
+    decodeColorComponents(components, pixels, info.width * info.height, info.flags.alpha, getColorDecodeTable(info, gamma));
 }
 
 void componentsToByteColors(u8 *components, ImageInfo &info, ByteColor *byte_colors, f32 gamma = 2.2f) {
@@ -48,11 +49,13 @@ void componentsToByteColors(u8 *components, ImageInfo &info, ByteColor *byte_col
     if (info.flags.linear)
         for (u32 i = 0; i < count; i++, byte_color++)
             component = componentsToByteColor(component, *byte_color, info);
-    else
+    else {
+        ColorDecodeTable decode{gamma};
         for (u32 i = 0; i < count; i++, byte_color++) {
-            component = componentsToPixel(component, &pixel, info, gamma);
+            component = componentsToPixel(component, &pixel, info, decode);
             *byte_color = pixel.color.toByteColor();
         }
+    }
 }
 
 void componentsToChannels(u8 *components, ImageInfo &info, f32 *channels, f32 gamma = 2.2f) {
@@ -61,8 +64,9 @@ void componentsToChannels(u8 *components, ImageInfo &info, f32 *channels, f32 ga
     u32 component_count = info.flags.alpha ? 4 : 3;
     u32 count = component_count * info.size;
     Pixel pixel;
+    ColorDecodeTable decode{getColorDecodeTable(info, gamma)};
     for (u32 i = 0; i < count; i++) {
-        component = componentsToPixel(component, &pixel, info, gamma);
+        component = componentsToPixel(component, &pixel, info, decode);
 
         *(channel++) = pixel.color.red;
         *(channel++) = pixel.color.green;
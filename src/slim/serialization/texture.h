@@ -11,7 +11,7 @@ u32 getSizeInBytes(const Texture &texture) {
 
     do {
         memory_size += sizeof(TextureMip);
-        memory_size += (mip_width + 1) * (mip_height + 1) * sizeof(TexelQuad);
+        memory_size += TextureMip::GetQuadCount(mip_width, mip_height, texture.texelLayout()) * sizeof(TexelQuad);
 
         mip_width /= 2;
         mip_height /= 2;
@@ -29,7 +29,7 @@ bool allocateMemory(Texture &texture, memory::MonotonicAllocator *memory_allocat
     u32 mip_height = texture.height;
 
     do {
-        texture_mip->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * (mip_height + 1) * (mip_width + 1));
+        texture_mip->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * TextureMip::GetQuadCount(mip_width, mip_height, texture.texelLayout()));
         mip_width /= 2;
         mip_height /= 2;
         texture_mip++;
@@ -43,7 +43,7 @@ void readContent(Texture &texture, void *file) {
     for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
         os::readFromFile(&texture_mip->width,  sizeof(u32), file);
         os::readFromFile(&texture_mip->height, sizeof(u32), file);
-        os::readFromFile(texture_mip->texel_quads, sizeof(TexelQuad) * (texture_mip->width + 1) * (texture_mip->height + 1), file);
+        os::readFromFile(texture_mip->texel_quads, sizeof(TexelQuad) * TextureMip::GetQuadCount(texture_mip->width, texture_mip->height, texture.texelLayout()), file);
     }
 }
 void writeContent(const Texture &texture, void *file) {
@@ -51,7 +51,7 @@ void writeContent(const Texture &texture, void *file) {
     for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
         os::writeToFile(&texture_mip->width,  sizeof(u32), file);
         os::writeToFile(&texture_mip->height, sizeof(u32), file);
-        os::writeToFile(texture_mip->texel_quads, sizeof(TexelQuad) * (texture_mip->width + 1) * (texture_mip->height + 1), file);
+        os::writeToFile(texture_mip->texel_quads, sizeof(TexelQuad) * TextureMip::GetQuadCount(texture_mip->width, texture_mip->height, texture.texelLayout()), file);
     }
 }
 